@@ -9,12 +9,14 @@
  *
  */
 
-#include <json-glib/json-glib.h>
+#include <glib.h>
 #include <uuid.h>
 #include <stdlib.h>
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <string>
 #include <vector>
 #include "deepstream_schema.h"
 
@@ -134,14 +136,231 @@ typedef struct NvDsPersonPoseExt {
   NvDsJoints *poses;
 }NvDsPersonPoseExt;
 
-static JsonObject*
-generate_place_object (void *privData, NvDsEventMsgMeta *meta)
+/*
+ * Streaming JSON writer used to build event payloads.
+ *
+ * Values are appended directly into a growable buffer that is reused across
+ * messages of the same thread, instead of building a JsonObject/JsonNode tree
+ * and serializing it. Output is compact JSON; member order, value types and
+ * number/string formatting follow json_to_string() so only whitespace differs,
+ * except where json-glib would emit invalid JSON: non-finite numbers are
+ * written as null, exponents get no ".0", and 0x1f is escaped.
+ */
+class NvDsJsonWriter
+{
+public:
+  void reset ()
+  {
+    m_buf.clear ();
+    m_needComma = false;
+  }
+
+  void beginObject ()
+  {
+    separator ();
+    m_buf.push_back ('{');
+    m_needComma = false;
+  }
+
+  void endObject ()
+  {
+    m_buf.push_back ('}');
+    m_needComma = true;
+  }
+
+  void beginArray ()
+  {
+    separator ();
+    m_buf.push_back ('[');
+    m_needComma = false;
+  }
+
+  void endArray ()
+  {
+    m_buf.push_back (']');
+    m_needComma = true;
+  }
+
+  /* Key given as a quoted literal with the colon, see JSON_KEY(). */
+  template <size_t N>
+  void key (const char (&quoted)[N])
+  {
+    separator ();
+    m_buf.append (quoted, N - 1);
+    m_needComma = false;
+  }
+
+  /* Key computed at runtime, escaped like a string value. */
+  void dynamicKey (const gchar *name)
+  {
+    separator ();
+    appendEscaped (name);
+    m_buf.push_back (':');
+    m_needComma = false;
+  }
+
+  void null ()
+  {
+    separator ();
+    m_buf.append ("null", 4);
+    m_needComma = true;
+  }
+
+  /* NULL is written as null, as json_object_set_string_member() does. */
+  void string (const gchar *value)
+  {
+    if (!value) {
+      null ();
+      return;
+    }
+    separator ();
+    appendEscaped (value);
+    m_needComma = true;
+  }
+
+  void integer (gint64 value)
+  {
+    gchar tmp[24];
+    gchar *end = tmp + sizeof (tmp);
+    gchar *p = end;
+    guint64 u = value < 0 ? (guint64) 0 - (guint64) value : (guint64) value;
+
+    do {
+      *--p = '0' + (gchar) (u % 10);
+      u /= 10;
+    } while (u);
+    if (value < 0)
+      *--p = '-';
+
+    separator ();
+    m_buf.append (p, end - p);
+    m_needComma = true;
+  }
+
+  void number (gdouble value)
+  {
+    gchar tmp[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (!std::isfinite (value)) {
+      null ();
+      return;
+    }
+
+    /* Integral values (zeros, pixel coordinates, default confidences) skip
+     * the %.17g round trip. The range is checked before the cast so it is
+     * always defined, and -0.0 is left to g_ascii_dtostr() so it prints as
+     * "-0.0" like json-glib. */
+    if (std::fabs (value) < 1e15 && value == std::trunc (value) &&
+        (value != 0 || !std::signbit (value))) {
+      integer ((gint64) value);
+      m_buf.append (".0", 2);
+      return;
+    }
+
+    g_ascii_dtostr (tmp, sizeof (tmp), value);
+    separator ();
+    m_buf.append (tmp);
+    /* json-glib also appends ".0" after an exponent ("1e+20.0"), which no
+     * JSON parser accepts; that is the one place the output differs. */
+    if (!strpbrk (tmp, ".eE"))
+      m_buf.append (".0", 2);
+    m_needComma = true;
+  }
+
+  /* Returns a g_malloc'ed copy that the caller releases with g_free(). */
+  gchar *dup () const
+  {
+    return g_strndup (m_buf.data (), m_buf.size ());
+  }
+
+private:
+  void separator ()
+  {
+    if (m_needComma)
+      m_buf.push_back (',');
+  }
+
+  void appendEscaped (const gchar *value)
+  {
+    static const gchar hex[] = "0123456789abcdef";
+    const gchar *run = value;
+    const gchar *p = value;
+
+    m_buf.push_back ('"');
+    for (; *p; p++) {
+      guchar c = (guchar) *p;
+      const gchar *esc = NULL;
+
+      /* json-glib escapes DEL as well. */
+      if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f)
+        continue;
+
+      m_buf.append (run, p - run);
+      run = p + 1;
+      switch (c) {
+        case '"': esc = "\\\""; break;
+        case '\\': esc = "\\\\"; break;
+        case '\b': esc = "\\b"; break;
+        case '\f': esc = "\\f"; break;
+        case '\n': esc = "\\n"; break;
+        case '\r': esc = "\\r"; break;
+        case '\t': esc = "\\t"; break;
+        default:
+          m_buf.append ("\\u00", 4);
+          m_buf.push_back (hex[c >> 4]);
+          m_buf.push_back (hex[c & 0xf]);
+          continue;
+      }
+      m_buf.append (esc);
+    }
+    m_buf.append (run, p - run);
+    m_buf.push_back ('"');
+  }
+
+  std::string m_buf;
+  bool m_needComma = false;
+};
+
+#define JSON_KEY(name) "\"" name "\":"
+
+/* One writer per thread; its buffer keeps the capacity of the largest
+ * message seen so far. */
+static NvDsJsonWriter&
+get_json_writer ()
+{
+  static thread_local NvDsJsonWriter writer;
+  writer.reset ();
+  return writer;
+}
+
+static void
+write_location (NvDsJsonWriter &w, gdouble lat, gdouble lon, gdouble alt)
+{
+  w.key (JSON_KEY ("location"));
+  w.beginObject ();
+  w.key (JSON_KEY ("lat")); w.number (lat);
+  w.key (JSON_KEY ("lon")); w.number (lon);
+  w.key (JSON_KEY ("alt")); w.number (alt);
+  w.endObject ();
+}
+
+static void
+write_coordinate (NvDsJsonWriter &w, gdouble x, gdouble y, gdouble z)
+{
+  w.key (JSON_KEY ("coordinate"));
+  w.beginObject ();
+  w.key (JSON_KEY ("x")); w.number (x);
+  w.key (JSON_KEY ("y")); w.number (y);
+  w.key (JSON_KEY ("z")); w.number (z);
+  w.endObject ();
+}
+
+static void
+generate_place_object (NvDsJsonWriter &w, void *privData, NvDsEventMsgMeta *meta)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsPlaceObject *dsPlaceObj = NULL;
-  JsonObject *placeObj;
-  JsonObject *jobject;
-  JsonObject *jobject2;
+  const gchar *subObjKey = NULL;
 
   privObj = (NvDsPayloadPriv *) privData;
   auto idMap = privObj->placeObj.find (meta->placeId);
@@ -151,7 +370,8 @@ generate_place_object (void *privData, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_PLACE << meta->placeId
         << " in configuration file" << endl;
-    return NULL;
+    w.null ();
+    return;
   }
 
   /* place object
@@ -160,7 +380,7 @@ generate_place_object (void *privData, NvDsEventMsgMeta *meta)
        "id": "string",
        "name": "endeavor",
        “type”: “garage”,
-       "location": {
+       "location": {
          "lat": 30.333,
          "lon": -40.555,
          "alt": 100.00
@@ -178,48 +398,51 @@ generate_place_object (void *privData, NvDsEventMsgMeta *meta)
      }
    */
 
-  placeObj = json_object_new ();
-  json_object_set_string_member (placeObj, "id", dsPlaceObj->id.c_str());
-  json_object_set_string_member (placeObj, "name", dsPlaceObj->name.c_str());
-  json_object_set_string_member (placeObj, "type", dsPlaceObj->type.c_str());
+  w.beginObject ();
+  w.key (JSON_KEY ("id")); w.string (dsPlaceObj->id.c_str());
+  w.key (JSON_KEY ("name")); w.string (dsPlaceObj->name.c_str());
+  w.key (JSON_KEY ("type")); w.string (dsPlaceObj->type.c_str());
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", dsPlaceObj->location[0]);
-  json_object_set_double_member (jobject, "lon", dsPlaceObj->location[1]);
-  json_object_set_double_member (jobject, "alt", dsPlaceObj->location[2]);
-  json_object_set_object_member (placeObj, "location", jobject);
+  write_location (w, dsPlaceObj->location[0], dsPlaceObj->location[1],
+      dsPlaceObj->location[2]);
 
   // parkingSpot / aisle /entrance sub object
-  jobject = json_object_new ();
-
   switch (meta->type) {
     case NVDS_EVENT_MOVING:
     case NVDS_EVENT_STOPPED:
-      json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-      json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field2.c_str());
-      json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-      json_object_set_object_member (placeObj, "aisle", jobject);
+      w.key (JSON_KEY ("aisle"));
+      w.beginObject ();
+      subObjKey = "name";
+      w.key (JSON_KEY ("id")); w.string (dsPlaceObj->subObj.field1.c_str());
+      w.key (JSON_KEY ("name")); w.string (dsPlaceObj->subObj.field2.c_str());
+      w.key (JSON_KEY ("level")); w.string (dsPlaceObj->subObj.field3.c_str());
       break;
     case NVDS_EVENT_EMPTY:
     case NVDS_EVENT_PARKED:
-      json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-      json_object_set_string_member (jobject, "type", dsPlaceObj->subObj.field2.c_str());
-      json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-      json_object_set_object_member (placeObj, "parkingSpot", jobject);
+      w.key (JSON_KEY ("parkingSpot"));
+      w.beginObject ();
+      subObjKey = "type";
+      w.key (JSON_KEY ("id")); w.string (dsPlaceObj->subObj.field1.c_str());
+      w.key (JSON_KEY ("type")); w.string (dsPlaceObj->subObj.field2.c_str());
+      w.key (JSON_KEY ("level")); w.string (dsPlaceObj->subObj.field3.c_str());
       break;
     case NVDS_EVENT_ENTRY:
     case NVDS_EVENT_EXIT:
       if (meta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-        json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-        json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field2.c_str());
-        json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-        json_object_set_object_member (placeObj, "aisle", jobject);
+        w.key (JSON_KEY ("aisle"));
+        w.beginObject ();
+        subObjKey = "name";
+        w.key (JSON_KEY ("id")); w.string (dsPlaceObj->subObj.field1.c_str());
+        w.key (JSON_KEY ("name")); w.string (dsPlaceObj->subObj.field2.c_str());
+        w.key (JSON_KEY ("level")); w.string (dsPlaceObj->subObj.field3.c_str());
       } else {
-        json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field1.c_str());
-        json_object_set_string_member (jobject, "lane", dsPlaceObj->subObj.field2.c_str());
-        json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-        json_object_set_object_member (placeObj, "entrance", jobject);
+        w.key (JSON_KEY ("entrance"));
+        w.beginObject ();
+        subObjKey = "lane";
+        w.key (JSON_KEY ("name")); w.string (dsPlaceObj->subObj.field1.c_str());
+        w.key (JSON_KEY ("lane")); w.string (dsPlaceObj->subObj.field2.c_str());
+        w.key (JSON_KEY ("level")); w.string (dsPlaceObj->subObj.field3.c_str());
       }
       break;
     default:
@@ -228,22 +451,20 @@ generate_place_object (void *privData, NvDsEventMsgMeta *meta)
   }
 
   // coordinate sub sub object
-  jobject2 = json_object_new ();
-  json_object_set_double_member (jobject2, "x", dsPlaceObj->coordinate[0]);
-  json_object_set_double_member (jobject2, "y", dsPlaceObj->coordinate[1]);
-  json_object_set_double_member (jobject2, "z", dsPlaceObj->coordinate[2]);
-  json_object_set_object_member (jobject, "coordinate", jobject2);
+  if (subObjKey) {
+    write_coordinate (w, dsPlaceObj->coordinate[0], dsPlaceObj->coordinate[1],
+        dsPlaceObj->coordinate[2]);
+    w.endObject ();
+  }
 
-  return placeObj;
+  w.endObject ();
 }
 
-static JsonObject*
-generate_sensor_object (void *privData, NvDsEventMsgMeta *meta)
+static void
+generate_sensor_object (NvDsJsonWriter &w, void *privData, NvDsEventMsgMeta *meta)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsSensorObject *dsSensorObj = NULL;
-  JsonObject *sensorObj;
-  JsonObject *jobject;
 
   privObj = (NvDsPayloadPriv *) privData;
   auto idMap = privObj->sensorObj.find (meta->sensorId);
@@ -253,7 +474,8 @@ generate_sensor_object (void *privData, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_SENSOR << meta->sensorId
          << " in configuration file" << endl;
-    return NULL;
+    w.null ();
+    return;
   }
 
   /* sensor object
@@ -275,34 +497,28 @@ generate_sensor_object (void *privData, NvDsEventMsgMeta *meta)
    */
 
   // sensor object
-  sensorObj = json_object_new ();
-  json_object_set_string_member (sensorObj, "id", dsSensorObj->id.c_str());
-  json_object_set_string_member (sensorObj, "type", dsSensorObj->type.c_str());
-  json_object_set_string_member (sensorObj, "description", dsSensorObj->desc.c_str());
+  w.beginObject ();
+  w.key (JSON_KEY ("id")); w.string (dsSensorObj->id.c_str());
+  w.key (JSON_KEY ("type")); w.string (dsSensorObj->type.c_str());
+  w.key (JSON_KEY ("description")); w.string (dsSensorObj->desc.c_str());
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", dsSensorObj->location[0]);
-  json_object_set_double_member (jobject, "lon", dsSensorObj->location[1]);
-  json_object_set_double_member (jobject, "alt", dsSensorObj->location[2]);
-  json_object_set_object_member (sensorObj, "location", jobject);
+  write_location (w, dsSensorObj->location[0], dsSensorObj->location[1],
+      dsSensorObj->location[2]);
 
   // coordinate sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "x", dsSensorObj->coordinate[0]);
-  json_object_set_double_member (jobject, "y", dsSensorObj->coordinate[1]);
-  json_object_set_double_member (jobject, "z", dsSensorObj->coordinate[2]);
-  json_object_set_object_member (sensorObj, "coordinate", jobject);
+  write_coordinate (w, dsSensorObj->coordinate[0], dsSensorObj->coordinate[1],
+      dsSensorObj->coordinate[2]);
 
-  return sensorObj;
+  w.endObject ();
 }
 
-static JsonObject*
-generate_analytics_module_object (void *privData, NvDsEventMsgMeta *meta)
+static void
+generate_analytics_module_object (NvDsJsonWriter &w, void *privData,
+    NvDsEventMsgMeta *meta)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsAnalyticsObject *dsObj = NULL;
-  JsonObject *analyticsObj;
 
   privObj = (NvDsPayloadPriv *) privData;
 
@@ -313,7 +529,8 @@ generate_analytics_module_object (void *privData, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_ANALYTICS << meta->moduleId
         << " in configuration file" << endl;
-    return NULL;
+    w.null ();
+    return;
   }
 
   /* analytics object
@@ -327,19 +544,17 @@ generate_analytics_module_object (void *privData, NvDsEventMsgMeta *meta)
    */
 
   // analytics object
-  analyticsObj = json_object_new ();
-  json_object_set_string_member (analyticsObj, "id", dsObj->id.c_str());
-  json_object_set_string_member (analyticsObj, "description", dsObj->desc.c_str());
-  json_object_set_string_member (analyticsObj, "source", dsObj->source.c_str());
-  json_object_set_string_member (analyticsObj, "version", dsObj->version.c_str());
-
-  return analyticsObj;
+  w.beginObject ();
+  w.key (JSON_KEY ("id")); w.string (dsObj->id.c_str());
+  w.key (JSON_KEY ("description")); w.string (dsObj->desc.c_str());
+  w.key (JSON_KEY ("source")); w.string (dsObj->source.c_str());
+  w.key (JSON_KEY ("version")); w.string (dsObj->version.c_str());
+  w.endObject ();
 }
 
-static JsonObject*
-generate_event_object (void *privData, NvDsEventMsgMeta *meta)
+static void
+generate_event_object (NvDsJsonWriter &w, void *privData, NvDsEventMsgMeta *meta)
 {
-  JsonObject *eventObj;
   uuid_t uuid;
   gchar uuidStr[37];
 
@@ -353,294 +568,285 @@ generate_event_object (void *privData, NvDsEventMsgMeta *meta)
   uuid_generate_random (uuid);
   uuid_unparse_lower(uuid, uuidStr);
 
-  eventObj = json_object_new ();
-  json_object_set_string_member (eventObj, "id", uuidStr);
+  w.beginObject ();
+  w.key (JSON_KEY ("id")); w.string (uuidStr);
 
   switch (meta->type) {
     case NVDS_EVENT_ENTRY:
-      json_object_set_string_member (eventObj, "type", "entry");
+      w.key (JSON_KEY ("type")); w.string ("entry");
       break;
     case NVDS_EVENT_EXIT:
-      json_object_set_string_member (eventObj, "type", "exit");
+      w.key (JSON_KEY ("type")); w.string ("exit");
       break;
     case NVDS_EVENT_MOVING:
-      json_object_set_string_member (eventObj, "type", "moving");
+      w.key (JSON_KEY ("type")); w.string ("moving");
       break;
     case NVDS_EVENT_STOPPED:
-      json_object_set_string_member (eventObj, "type", "stopped");
+      w.key (JSON_KEY ("type")); w.string ("stopped");
       break;
     case NVDS_EVENT_PARKED:
-      json_object_set_string_member (eventObj, "type", "parked");
+      w.key (JSON_KEY ("type")); w.string ("parked");
       break;
     case NVDS_EVENT_EMPTY:
-      json_object_set_string_member (eventObj, "type", "empty");
+      w.key (JSON_KEY ("type")); w.string ("empty");
       break;
     case NVDS_EVENT_RESET:
-      json_object_set_string_member (eventObj, "type", "reset");
+      w.key (JSON_KEY ("type")); w.string ("reset");
       break;
     default:
       cout << "Unknown event type " << endl;
       break;
   }
 
-  return eventObj;
+  w.endObject ();
+}
+
+static void
+write_vehicle_members (NvDsJsonWriter &w, const gchar *type, const gchar *make,
+    const gchar *model, const gchar *color, const gchar *region,
+    const gchar *license, gdouble confidence)
+{
+  w.key (JSON_KEY ("type")); w.string (type);
+  w.key (JSON_KEY ("make")); w.string (make);
+  w.key (JSON_KEY ("model")); w.string (model);
+  w.key (JSON_KEY ("color")); w.string (color);
+  w.key (JSON_KEY ("licenseState")); w.string (region);
+  w.key (JSON_KEY ("license")); w.string (license);
+  w.key (JSON_KEY ("confidence")); w.number (confidence);
 }
 
-static JsonObject*
-generate_object_object (void *privData, NvDsEventMsgMeta *meta)
+static void
+write_person_members (NvDsJsonWriter &w, gint age, const gchar *gender,
+    const gchar *hair, const gchar *cap, const gchar *apparel,
+    gdouble confidence)
+{
+  w.key (JSON_KEY ("age")); w.integer (age);
+  w.key (JSON_KEY ("gender")); w.string (gender);
+  w.key (JSON_KEY ("hair")); w.string (hair);
+  w.key (JSON_KEY ("cap")); w.string (cap);
+  w.key (JSON_KEY ("apparel")); w.string (apparel);
+  w.key (JSON_KEY ("confidence")); w.number (confidence);
+}
+
+static void
+write_face_members (NvDsJsonWriter &w, gint age, const gchar *gender,
+    const gchar *hair, const gchar *cap, const gchar *glasses,
+    const gchar *facialhair, const gchar *name, const gchar *eyecolor,
+    gdouble confidence)
+{
+  w.key (JSON_KEY ("age")); w.integer (age);
+  w.key (JSON_KEY ("gender")); w.string (gender);
+  w.key (JSON_KEY ("hair")); w.string (hair);
+  w.key (JSON_KEY ("cap")); w.string (cap);
+  w.key (JSON_KEY ("glasses")); w.string (glasses);
+  w.key (JSON_KEY ("facialhair")); w.string (facialhair);
+  w.key (JSON_KEY ("name")); w.string (name);
+  w.key (JSON_KEY ("eyecolor")); w.string (eyecolor);
+  w.key (JSON_KEY ("confidence")); w.number (confidence);
+}
+
+static void
+write_pose_object (NvDsJsonWriter &w, const NvDsJoints *pose)
+{
+  w.beginObject ();
+  for (int joint_index = 0; joint_index < pose->num_joints; joint_index++) {
+    const NvDsJoint *joint = &pose->joints[joint_index];
+
+    if (joint->confidence <= 0.0)
+      continue;
+
+    w.dynamicKey (_joint_maps[pose->pose_type][joint_index].c_str());
+    w.beginObject ();
+    w.key (JSON_KEY ("x")); w.integer ((gint64) joint->x);
+    w.key (JSON_KEY ("y")); w.integer ((gint64) joint->y);
+    // pose3d or pose25d from BodyPose3DNet
+    if (pose->pose_type != 0) {
+      w.key (JSON_KEY ("z")); w.integer ((gint64) joint->z);
+    }
+    w.key (JSON_KEY ("confidence")); w.integer ((gint64) joint->confidence);
+    w.endObject ();
+  }
+  w.endObject ();
+}
+
+static void
+write_pose_members (NvDsJsonWriter &w, NvDsEventMsgMeta *meta,
+    const NvDsPersonPoseExt *pose_meta)
+{
+  static const char *const pose_keys[] = { "pose2D", "pose3D", "pose25D" };
+
+  if (pose_meta->num_poses <= 0)
+    return;
+
+  // bbox sub object
+  w.key (JSON_KEY ("bbox"));
+  w.beginObject ();
+  w.key (JSON_KEY ("topleftx")); w.integer ((gint64) meta->bbox.left);
+  w.key (JSON_KEY ("toplefty")); w.integer ((gint64) meta->bbox.top);
+  w.key (JSON_KEY ("bottomrightx"));
+  w.integer ((gint64) (meta->bbox.left + meta->bbox.width));
+  w.key (JSON_KEY ("bottomrighty"));
+  w.integer ((gint64) (meta->bbox.top + meta->bbox.height));
+  w.endObject ();
+
+  /* A JsonObject member set twice keeps its first position and the last
+   * value, so emit each pose type once, where it first appears, with the
+   * last pose of that type. */
+  for (int i = 0; i < pose_meta->num_poses; i++) {
+    int type = pose_meta->poses[i].pose_type;
+    int last = i;
+    bool seen = false;
+
+    if (type < 0 || type > 2)
+      continue;
+    for (int j = 0; j < i && !seen; j++)
+      seen = pose_meta->poses[j].pose_type == type;
+    if (seen)
+      continue;
+    for (int j = i + 1; j < pose_meta->num_poses; j++) {
+      if (pose_meta->poses[j].pose_type == type)
+        last = j;
+    }
+
+    w.dynamicKey (pose_keys[type]);
+    write_pose_object (w, &pose_meta->poses[last]);
+  }
+}
+
+static void
+generate_object_object (NvDsJsonWriter &w, void *privData, NvDsEventMsgMeta *meta)
 {
-  JsonObject *objectObj;
-  JsonObject *jobject;
-  JsonObject *pobject;
   guint i;
   gchar tracking_id[64];
   GList *objectMask = NULL;
 
   // object object
-  objectObj = json_object_new ();
+  w.beginObject ();
   if (snprintf (tracking_id, sizeof(tracking_id), "%lu", meta->trackingId)
       >= (int) sizeof(tracking_id))
     g_warning("Not enough space to copy trackingId");
-  json_object_set_string_member (objectObj, "id", tracking_id);
-  json_object_set_double_member (objectObj, "speed", 0);
-  json_object_set_double_member (objectObj, "direction", 0);
-  json_object_set_double_member (objectObj, "orientation", 0);
+  w.key (JSON_KEY ("id")); w.string (tracking_id);
+  w.key (JSON_KEY ("speed")); w.number (0);
+  w.key (JSON_KEY ("direction")); w.number (0);
+  w.key (JSON_KEY ("orientation")); w.number (0);
 
   switch (meta->objType) {
     case NVDS_OBJECT_TYPE_VEHICLE:
       // vehicle sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("vehicle"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsVehicleObject *dsObj = (NvDsVehicleObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_string_member (jobject, "type", dsObj->type);
-          json_object_set_string_member (jobject, "make", dsObj->make);
-          json_object_set_string_member (jobject, "model", dsObj->model);
-          json_object_set_string_member (jobject, "color", dsObj->color);
-          json_object_set_string_member (jobject, "licenseState", dsObj->region);
-          json_object_set_string_member (jobject, "license", dsObj->license);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_vehicle_members (w, dsObj->type, dsObj->make, dsObj->model,
+              dsObj->color, dsObj->region, dsObj->license, meta->confidence);
         }
       } else {
         // No vehicle object in meta data. Attach empty vehicle sub object.
-        json_object_set_string_member (jobject, "type", "");
-        json_object_set_string_member (jobject, "make", "");
-        json_object_set_string_member (jobject, "model", "");
-        json_object_set_string_member (jobject, "color", "");
-        json_object_set_string_member (jobject, "licenseState", "");
-        json_object_set_string_member (jobject, "license", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_vehicle_members (w, "", "", "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "vehicle", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_PERSON:
       // person sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("person"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsPersonObject *dsObj = (NvDsPersonObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "apparel", dsObj->apparel);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_person_members (w, dsObj->age, dsObj->gender, dsObj->hair,
+              dsObj->cap, dsObj->apparel, meta->confidence);
         }
       } else {
         // No person object in meta data. Attach empty person sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "apparel", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_person_members (w, 0, "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "person", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_FACE:
       // face sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("face"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsFaceObject *dsObj = (NvDsFaceObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "glasses", dsObj->glasses);
-          json_object_set_string_member (jobject, "facialhair", dsObj->facialhair);
-          json_object_set_string_member (jobject, "name", dsObj->name);
-          json_object_set_string_member (jobject, "eyecolor", dsObj->eyecolor);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_face_members (w, dsObj->age, dsObj->gender, dsObj->hair,
+              dsObj->cap, dsObj->glasses, dsObj->facialhair, dsObj->name,
+              dsObj->eyecolor, meta->confidence);
         }
       } else {
         // No face object in meta data. Attach empty face sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "glasses", "");
-        json_object_set_string_member (jobject, "facialhair", "");
-        json_object_set_string_member (jobject, "name", "");
-        json_object_set_string_member (jobject, "eyecolor", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_face_members (w, 0, "", "", "", "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "face", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_VEHICLE_EXT:
       // vehicle sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("vehicle"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsVehicleObjectExt *dsObj = (NvDsVehicleObjectExt *) meta->extMsg;
         if (dsObj) {
-          json_object_set_string_member (jobject, "type", dsObj->type);
-          json_object_set_string_member (jobject, "make", dsObj->make);
-          json_object_set_string_member (jobject, "model", dsObj->model);
-          json_object_set_string_member (jobject, "color", dsObj->color);
-          json_object_set_string_member (jobject, "licenseState", dsObj->region);
-          json_object_set_string_member (jobject, "license", dsObj->license);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_vehicle_members (w, dsObj->type, dsObj->make, dsObj->model,
+              dsObj->color, dsObj->region, dsObj->license, meta->confidence);
 
           objectMask = dsObj->mask;
         }
       } else {
         // No vehicle object in meta data. Attach empty vehicle sub object.
-        json_object_set_string_member (jobject, "type", "");
-        json_object_set_string_member (jobject, "make", "");
-        json_object_set_string_member (jobject, "model", "");
-        json_object_set_string_member (jobject, "color", "");
-        json_object_set_string_member (jobject, "licenseState", "");
-        json_object_set_string_member (jobject, "license", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_vehicle_members (w, "", "", "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "vehicle", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_PERSON_EXT:
       // person sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("person"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsPersonObjectExt *dsObj = (NvDsPersonObjectExt *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "apparel", dsObj->apparel);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_person_members (w, dsObj->age, dsObj->gender, dsObj->hair,
+              dsObj->cap, dsObj->apparel, meta->confidence);
 
           objectMask = dsObj->mask;
         }
       } else {
         // No person object in meta data. Attach empty person sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "apparel", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_person_members (w, 0, "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "person", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_FACE_EXT:
       // face sub object
-      jobject = json_object_new ();
-
+      w.key (JSON_KEY ("face"));
+      w.beginObject ();
       if (meta->extMsgSize) {
         NvDsFaceObjectExt *dsObj = (NvDsFaceObjectExt *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "glasses", dsObj->glasses);
-          json_object_set_string_member (jobject, "facialhair", dsObj->facialhair);
-          json_object_set_string_member (jobject, "name", dsObj->name);
-          json_object_set_string_member (jobject, "eyecolor", dsObj->eyecolor);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          write_face_members (w, dsObj->age, dsObj->gender, dsObj->hair,
+              dsObj->cap, dsObj->glasses, dsObj->facialhair, dsObj->name,
+              dsObj->eyecolor, meta->confidence);
 
           objectMask = dsObj->mask;
         }
       } else {
         // No face object in meta data. Attach empty face sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "glasses", "");
-        json_object_set_string_member (jobject, "facialhair", "");
-        json_object_set_string_member (jobject, "name", "");
-        json_object_set_string_member (jobject, "eyecolor", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        write_face_members (w, 0, "", "", "", "", "", "", "", 1.0);
       }
-      json_object_set_object_member (objectObj, "face", jobject);
+      w.endObject ();
       break;
     case NVDS_OBJECT_TYPE_UNKNOWN:
       if(!meta->objectId) {
         break;
       }
       /** No information to add; object type unknown within NvDsEventMsgMeta */
-      jobject = json_object_new ();
-      json_object_set_object_member (objectObj, meta->objectId, jobject);
+      w.dynamicKey (meta->objectId);
+      w.beginObject ();
+      w.endObject ();
       break;
     case (NvDsObjectType)NVDS_OBJECT_TYPE_PERSON_EXT_POSE:
-      {
-        if (meta->extMsgSize){
-          NvDsPersonPoseExt *pose_meta = (NvDsPersonPoseExt*)meta->extMsg;
-
-          // // DEBUG
-          // g_message("generate_object_object(): pose_meta->num_poses = %d", pose_meta->num_poses);
-
-          for (int i=0; i<pose_meta->num_poses; i++) {
-            // bbox sub object
-            jobject = json_object_new ();
-            json_object_set_int_member (jobject, "topleftx", meta->bbox.left);
-            json_object_set_int_member (jobject, "toplefty", meta->bbox.top);
-            json_object_set_int_member (jobject, "bottomrightx", meta->bbox.left + meta->bbox.width);
-            json_object_set_int_member (jobject, "bottomrighty", meta->bbox.top + meta->bbox.height);
-            json_object_set_object_member (objectObj, "bbox", jobject);
-
-            pobject = json_object_new ();
-            int joint_index = 0;
-
-            for (joint_index = 0;joint_index < pose_meta->poses[i].num_joints; joint_index++)
-            {
-              if (pose_meta->poses[i].joints[joint_index].confidence > 0.0)
-              {
-                jobject = json_object_new ();
-                std::string s = _joint_maps[pose_meta->poses[i].pose_type][joint_index];
-                char *json_name = const_cast<char*>(s.c_str());
-
-                if (pose_meta->poses[i].pose_type==0) {
-                  json_object_set_int_member (jobject, "x", pose_meta->poses[i].joints[joint_index].x);
-                  json_object_set_int_member (jobject, "y", pose_meta->poses[i].joints[joint_index].y);
-                  json_object_set_int_member (jobject, "confidence", pose_meta->poses[i].joints[joint_index].confidence);
-                  json_object_set_object_member (pobject, reinterpret_cast<const gchar*>(json_name), jobject);
-                }
-                else if ((pose_meta->poses[i].pose_type==1)||(pose_meta->poses[i].pose_type==2)) {
-                  // pose3d or pose25d from BodyPose3DNet
-                  json_object_set_int_member (jobject, "x", pose_meta->poses[i].joints[joint_index].x);
-                  json_object_set_int_member (jobject, "y", pose_meta->poses[i].joints[joint_index].y);
-                  json_object_set_int_member (jobject, "z", pose_meta->poses[i].joints[joint_index].z);
-                  json_object_set_int_member (jobject, "confidence", pose_meta->poses[i].joints[joint_index].confidence);
-                  json_object_set_object_member (pobject, reinterpret_cast<const gchar*>(json_name), jobject);
-                }
-
-              }
-            }
-
-            if      (pose_meta->poses[i].pose_type==0)
-              json_object_set_object_member (objectObj, "pose2D", pobject);
-            else if (pose_meta->poses[i].pose_type==1)
-              json_object_set_object_member (objectObj, "pose3D", pobject);
-            else if (pose_meta->poses[i].pose_type==2)
-              json_object_set_object_member (objectObj, "pose25D", pobject);
-          }
-        }
+      if (meta->extMsgSize) {
+        write_pose_members (w, meta, (NvDsPersonPoseExt *) meta->extMsg);
       }
       break;
     default:
@@ -651,61 +857,45 @@ generate_object_object (void *privData, NvDsEventMsgMeta *meta)
 
   if (objectMask) {
     GList *l;
-    JsonArray *maskArray = json_array_sized_new (g_list_length(objectMask));
 
+    w.key (JSON_KEY ("maskoutline"));
+    w.beginArray ();
     for (l = objectMask; l != NULL; l = l->next) {
       GArray *polygon = (GArray *) l->data;
-      JsonArray *polygonArray = json_array_sized_new (polygon->len);
 
+      w.beginArray ();
       for (i = 0; i < polygon->len; i++) {
-        gdouble value = g_array_index (polygon, gdouble, i);
-
-        json_array_add_double_element (polygonArray, value);
+        w.number (g_array_index (polygon, gdouble, i));
       }
-
-      json_array_add_array_element (maskArray, polygonArray);
+      w.endArray ();
     }
-
-    json_object_set_array_member (objectObj, "maskoutline", maskArray);
+    w.endArray ();
   }
 
   // signature sub array
   if (meta->objSignature.size) {
-    JsonArray *jArray = json_array_sized_new (meta->objSignature.size);
-
+    w.key (JSON_KEY ("signature"));
+    w.beginArray ();
     for (i = 0; i < meta->objSignature.size; i++) {
-      json_array_add_double_element (jArray, meta->objSignature.signature[i]);
+      w.number (meta->objSignature.signature[i]);
     }
-    json_object_set_array_member (objectObj, "signature", jArray);
+    w.endArray ();
   }
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", meta->location.lat);
-  json_object_set_double_member (jobject, "lon", meta->location.lon);
-  json_object_set_double_member (jobject, "alt", meta->location.alt);
-  json_object_set_object_member (objectObj, "location", jobject);
+  write_location (w, meta->location.lat, meta->location.lon,
+      meta->location.alt);
 
   // coordinate sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "x", meta->coordinate.x);
-  json_object_set_double_member (jobject, "y", meta->coordinate.y);
-  json_object_set_double_member (jobject, "z", meta->coordinate.z);
-  json_object_set_object_member (objectObj, "coordinate", jobject);
+  write_coordinate (w, meta->coordinate.x, meta->coordinate.y,
+      meta->coordinate.z);
 
-  return objectObj;
+  w.endObject ();
 }
 
 gchar* generate_event_message (void *privData, NvDsEventMsgMeta *meta)
 {
-  JsonNode *rootNode;
-  JsonObject *rootObj;
-  JsonObject *placeObj;
-  JsonObject *sensorObj;
-  JsonObject *analyticsObj;
-  JsonObject *eventObj;
-  JsonObject *objectObj;
-  gchar *message;
+  NvDsJsonWriter &w = get_json_writer ();
 
   uuid_t msgId;
   gchar msgIdStr[37];
@@ -713,45 +903,37 @@ gchar* generate_event_message (void *privData, NvDsEventMsgMeta *meta)
   uuid_generate_random (msgId);
   uuid_unparse_lower(msgId, msgIdStr);
 
+  // root object
+  w.beginObject ();
+  w.key (JSON_KEY ("messageid")); w.string (msgIdStr);
+  w.key (JSON_KEY ("mdsversion")); w.string ("1.0");
+  w.key (JSON_KEY ("@timestamp")); w.string (meta->ts);
+
   // place object
-  placeObj = generate_place_object (privData, meta);
+  w.key (JSON_KEY ("place"));
+  generate_place_object (w, privData, meta);
 
   // sensor object
-  sensorObj = generate_sensor_object (privData, meta);
+  w.key (JSON_KEY ("sensor"));
+  generate_sensor_object (w, privData, meta);
 
   // analytics object
-  analyticsObj = generate_analytics_module_object (privData, meta);
+  w.key (JSON_KEY ("analyticsModule"));
+  generate_analytics_module_object (w, privData, meta);
 
   // object object
-  objectObj = generate_object_object (privData, meta);
+  w.key (JSON_KEY ("object"));
+  generate_object_object (w, privData, meta);
 
   // event object
-  eventObj = generate_event_object (privData, meta);
+  w.key (JSON_KEY ("event"));
+  generate_event_object (w, privData, meta);
 
-  // root object
-  rootObj = json_object_new ();
-  json_object_set_string_member (rootObj, "messageid", msgIdStr);
-  json_object_set_string_member (rootObj, "mdsversion", "1.0");
-  json_object_set_string_member (rootObj, "@timestamp", meta->ts);
-  json_object_set_object_member (rootObj, "place", placeObj);
-  json_object_set_object_member (rootObj, "sensor", sensorObj);
-  json_object_set_object_member (rootObj, "analyticsModule", analyticsObj);
-  json_object_set_object_member (rootObj, "object", objectObj);
-  json_object_set_object_member (rootObj, "event", eventObj);
-
-  if (meta->videoPath)
-    json_object_set_string_member (rootObj, "videoPath", meta->videoPath);
-  else
-    json_object_set_string_member (rootObj, "videoPath", "");
-
-  rootNode = json_node_new (JSON_NODE_OBJECT);
-  json_node_set_object (rootNode, rootObj);
-
-  message = json_to_string (rootNode, TRUE);
-  json_node_free (rootNode);
-  json_object_unref (rootObj);
-
-  return message;
+  w.key (JSON_KEY ("videoPath"));
+  w.string (meta->videoPath ? meta->videoPath : "");
+  w.endObject ();
+
+  return w.dup ();
 }
 
 static const gchar*
@@ -808,7 +990,8 @@ sensor_id_to_str (void *privData, gint sensorId)
 }
 
 static void
-generate_mask_array (NvDsEventMsgMeta *meta, JsonArray *jArray, GList *mask)
+generate_mask_array (NvDsEventMsgMeta *meta, std::vector<std::string> &masks,
+    GList *mask)
 {
   unsigned int i;
   GList *l;
@@ -830,7 +1013,7 @@ generate_mask_array (NvDsEventMsgMeta *meta, JsonArray *jArray, GList *mask)
       ss << "|" << value;
     }
   }
-  json_array_add_string_element (jArray, ss.str().c_str());
+  masks.push_back (ss.str());
 }
 
 gchar* generate_event_message_minimal (void *privData, NvDsEvent *events, guint size)
@@ -864,16 +1047,29 @@ gchar* generate_event_message_minimal (void *privData, NvDsEvent *events, guint
   }
    */
 
-  JsonNode *rootNode;
-  JsonObject *jobject;
-  JsonArray *jArray;
-  JsonArray *maskArray = NULL;
+  NvDsJsonWriter &w = get_json_writer ();
+  std::vector<std::string> masks;
   guint i;
   stringstream ss;
-  gchar *message = NULL;
 
-  jArray = json_array_new ();
+  // It is assumed that all events / objects are associated with same frame.
+  // Therefore ts / sensorId / frameId of first object can be used.
 
+  w.beginObject ();
+  w.key (JSON_KEY ("version")); w.string ("4.0");
+  w.key (JSON_KEY ("id")); w.integer (events[0].metadata->frameId);
+  w.key (JSON_KEY ("@timestamp")); w.string (events[0].metadata->ts);
+  w.key (JSON_KEY ("sensorId"));
+  if (events[0].metadata->sensorStr) {
+    w.string (events[0].metadata->sensorStr);
+  } else if ((NvDsPayloadPriv *) privData) {
+    w.string (to_str((gchar *) sensor_id_to_str (privData, events[0].metadata->sensorId)));
+  } else {
+    w.string ("0");
+  }
+
+  w.key (JSON_KEY ("objects"));
+  w.beginArray ();
   for (i = 0; i < size; i++) {
     GList *objectMask = NULL;
 
@@ -1004,42 +1200,22 @@ gchar* generate_event_message_minimal (void *privData, NvDsEvent *events, guint
       }
     }
 
-    if (objectMask) {
-      if (maskArray == NULL)
-        maskArray = json_array_new ();
-      generate_mask_array (meta, maskArray, objectMask);
-    }
+    if (objectMask)
+      generate_mask_array (meta, masks, objectMask);
 
-    json_array_add_string_element (jArray, ss.str().c_str());
+    w.string (ss.str().c_str());
   }
-
-  // It is assumed that all events / objects are associated with same frame.
-  // Therefore ts / sensorId / frameId of first object can be used.
-
-  jobject = json_object_new ();
-  json_object_set_string_member (jobject, "version", "4.0");
-  json_object_set_int_member (jobject, "id", events[0].metadata->frameId);
-  json_object_set_string_member (jobject, "@timestamp", events[0].metadata->ts);
-  if (events[0].metadata->sensorStr) {
-    json_object_set_string_member (jobject, "sensorId", events[0].metadata->sensorStr);
-  } else if ((NvDsPayloadPriv *) privData) {
-    json_object_set_string_member (jobject, "sensorId",
-        to_str((gchar *) sensor_id_to_str (privData, events[0].metadata->sensorId)));
-  } else {
-    json_object_set_string_member (jobject, "sensorId", "0");
+  w.endArray ();
+
+  if (!masks.empty()) {
+    w.key (JSON_KEY ("masks"));
+    w.beginArray ();
+    for (const std::string &m : masks)
+      w.string (m.c_str());
+    w.endArray ();
   }
+  w.endObject ();
 
-  json_object_set_array_member (jobject, "objects", jArray);
-  if (maskArray && json_array_get_length (maskArray) > 0)
-    json_object_set_array_member (jobject, "masks", maskArray);
-
-  rootNode = json_node_new (JSON_NODE_OBJECT);
-  json_node_set_object (rootNode, jobject);
-
-  message = json_to_string (rootNode, TRUE);
-  json_node_free (rootNode);
-  json_object_unref (jobject);
-
-  return message;
+  return w.dup ();
 }
 
@@ -0,0 +1,374 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Parity tests and benchmark for the streaming JSON writer in
+ * eventmsg_payload.cpp against json-glib, which the payload was built with
+ * before. The source file is included so its static helpers are visible.
+ */
+
+#include <json-glib/json-glib.h>
+#include <cfloat>
+
+#include "eventmsg_payload.cpp"
+
+/* json-glib's output for a single value node. */
+static gchar *
+json_glib_value (JsonNode *node)
+{
+  gchar *out = json_to_string (node, FALSE);
+  json_node_unref (node);
+  return out;
+}
+
+static gchar *
+json_glib_double (gdouble value)
+{
+  JsonNode *node = json_node_new (JSON_NODE_VALUE);
+  json_node_set_double (node, value);
+  return json_glib_value (node);
+}
+
+static gchar *
+json_glib_string (const gchar *value)
+{
+  JsonNode *node = json_node_new (JSON_NODE_VALUE);
+  json_node_set_string (node, value);
+  return json_glib_value (node);
+}
+
+static gchar *
+writer_double (gdouble value)
+{
+  NvDsJsonWriter &w = get_json_writer ();
+  w.number (value);
+  return w.dup ();
+}
+
+static gchar *
+writer_string (const gchar *value)
+{
+  NvDsJsonWriter &w = get_json_writer ();
+  w.string (value);
+  return w.dup ();
+}
+
+/* json-glib appends ".0" even after an exponent; the writer does not. */
+static void
+check_double (gdouble value)
+{
+  gchar *expected = json_glib_double (value);
+  gchar *actual = writer_double (value);
+  gsize len = strlen (expected);
+
+  if (strpbrk (expected, "eE") && g_str_has_suffix (expected, ".0") &&
+      !memchr (expected, '.', len - 2))
+    expected[len - 2] = '\0';
+  if (g_strcmp0 (expected, actual) != 0) {
+    guint64 bits;
+    memcpy (&bits, &value, sizeof (bits));
+    g_test_message ("value %.17g (bits %016" G_GINT64_MODIFIER "x)", value,
+        bits);
+  }
+  g_assert_cmpstr (actual, ==, expected);
+  g_free (expected);
+  g_free (actual);
+}
+
+static void
+test_number_parity (void)
+{
+  static const gdouble values[] = {
+    0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 0.1, 1.0 / 3.0, 2.5e-7, 100.0,
+    1920.0, 1080.0, 97.79, -40.555,
+    1e15 - 1, -(1e15 - 1), 1e15, -1e15, 1e15 + 1, 123456789012345.0,
+    9007199254740992.0, 9007199254740993.0, 1e17, 1e20, -1e20,
+    9.2233720368547758e18, -9.2233720368547758e18, 1.8446744073709552e19,
+    1e300, -1e300, DBL_MAX, -DBL_MAX, DBL_MIN, -DBL_MIN, 5e-324, -5e-324,
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++)
+    check_double (values[i]);
+
+  /* Random bit patterns cover every exponent; non-finite ones are skipped
+   * because json-glib prints them as "nan"/"inf". */
+  for (i = 0; i < 100000; i++) {
+    guint64 bits = ((guint64) (guint32) g_test_rand_int () << 32) |
+        (guint32) g_test_rand_int ();
+    gdouble value;
+
+    memcpy (&value, &bits, sizeof (value));
+    if (std::isfinite (value))
+      check_double (value);
+    check_double (g_test_rand_double_range (-1e6, 1e6));
+    check_double ((gdouble) g_test_rand_int_range (-100000, 100000));
+  }
+}
+
+static void
+test_non_finite (void)
+{
+  gchar *out;
+
+  out = writer_double (NAN);
+  g_assert_cmpstr (out, ==, "null");
+  g_free (out);
+  out = writer_double (-INFINITY);
+  g_assert_cmpstr (out, ==, "null");
+  g_free (out);
+}
+
+static void
+test_string_parity (void)
+{
+  static const gchar *values[] = {
+    "", "plain", "quote\"inside", "back\\slash", "slash/",
+    "tab\tnew\nline\rret", "\b\f", "\x01\x02\x1e", "del\x7f",
+    "utf-8 \xec\x98\x81\xec\x83\x81 \xc3\xa9",
+    "ab\"cd\\ef\x01gh",
+  };
+  gchar ctrl[2] = { 0, 0 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++) {
+    gchar *expected = json_glib_string (values[i]);
+    gchar *actual = writer_string (values[i]);
+    g_assert_cmpstr (actual, ==, expected);
+    g_free (expected);
+    g_free (actual);
+  }
+
+  /* Every control character except 0x1f, which json-glib leaves raw. */
+  for (i = 1; i < 0x1f; i++) {
+    gchar *expected, *actual;
+
+    ctrl[0] = (gchar) i;
+    expected = json_glib_string (ctrl);
+    actual = writer_string (ctrl);
+    g_assert_cmpstr (actual, ==, expected);
+    g_free (expected);
+    g_free (actual);
+  }
+  ctrl[0] = 0x1f;
+  {
+    gchar *actual = writer_string (ctrl);
+    g_assert_cmpstr (actual, ==, "\"\\u001f\"");
+    g_free (actual);
+  }
+}
+
+static NvDsPayloadPriv *
+payload_priv_new (void)
+{
+  NvDsPayloadPriv *priv = new NvDsPayloadPriv;
+  NvDsSensorObject sensor;
+  NvDsPlaceObject place;
+  NvDsAnalyticsObject analytics;
+
+  sensor.id = "CAMERA_ID";
+  sensor.type = "Camera";
+  sensor.desc = "Entrance of \"Endeavor\" Garage\\Right Lane";
+  sensor.location[0] = 45.293701447;
+  sensor.location[1] = -75.8303914499;
+  sensor.location[2] = 48.1557479338;
+  sensor.coordinate[0] = 5.2;
+  sensor.coordinate[1] = 10.1;
+  sensor.coordinate[2] = -0.0;
+  priv->sensorObj[0] = sensor;
+
+  place.id = "1";
+  place.name = "XYZ";
+  place.type = "garage";
+  place.location[0] = 30.32;
+  place.location[1] = -40.55;
+  place.location[2] = 100.0;
+  place.subObj.field1 = "walsh";
+  place.subObj.field2 = "lane1";
+  place.subObj.field3 = "P2";
+  place.coordinate[0] = 1.0;
+  place.coordinate[1] = 2.0;
+  place.coordinate[2] = 3.0;
+  priv->placeObj[0] = place;
+
+  analytics.id = "XYZ";
+  analytics.desc = "Vehicle Detection and License Plate Recognition";
+  analytics.source = "OpenALR";
+  analytics.version = "1.0";
+  priv->analyticsObj[0] = analytics;
+
+  return priv;
+}
+
+static void
+event_meta_init (NvDsEventMsgMeta *meta, NvDsObjectType obj_type,
+    gpointer ext, guint ext_size)
+{
+  static gdouble signature[] = { 0.25, -0.0, 1e-9, 123456.5 };
+
+  memset (meta, 0, sizeof (*meta));
+  meta->type = NVDS_EVENT_MOVING;
+  meta->objType = obj_type;
+  meta->trackingId = 1234567890123ULL;
+  meta->confidence = 0.87654321;
+  meta->ts = (gchar *) "2023-01-01T00:00:00.000Z";
+  meta->location.lat = 30.333;
+  meta->location.lon = -40.555;
+  meta->location.alt = 100.0;
+  meta->coordinate.x = 640.5;
+  meta->coordinate.y = 360.0;
+  meta->coordinate.z = -0.0;
+  meta->objSignature.signature = signature;
+  meta->objSignature.size = G_N_ELEMENTS (signature);
+  meta->extMsg = ext;
+  meta->extMsgSize = ext_size;
+}
+
+/* A message round-trips through json-glib unchanged, i.e. json-glib would
+ * have produced exactly the same bytes in compact mode. */
+static void
+check_message_roundtrip (const gchar *message)
+{
+  GError *error = NULL;
+  JsonNode *root = json_from_string (message, &error);
+  gchar *regenerated;
+
+  g_assert_no_error (error);
+  g_assert_nonnull (root);
+  regenerated = json_to_string (root, FALSE);
+  g_assert_cmpstr (message, ==, regenerated);
+  g_free (regenerated);
+  json_node_unref (root);
+}
+
+static void
+test_message_parity (void)
+{
+  NvDsPayloadPriv *priv = payload_priv_new ();
+  NvDsVehicleObject vehicle = { 0 };
+  NvDsPersonObject person = { 0 };
+  NvDsEventMsgMeta meta;
+  gchar *message;
+
+  vehicle.type = (gchar *) "sedan";
+  vehicle.make = (gchar *) "Bugatti";
+  vehicle.model = (gchar *) "M";
+  vehicle.color = (gchar *) "blue";
+  vehicle.region = (gchar *) "CA";
+  vehicle.license = (gchar *) "XX1234\t\"";
+  event_meta_init (&meta, NVDS_OBJECT_TYPE_VEHICLE, &vehicle,
+      sizeof (vehicle));
+  message = generate_event_message (priv, &meta);
+  check_message_roundtrip (message);
+  g_free (message);
+
+  person.age = 45;
+  person.gender = (gchar *) "male";
+  person.hair = (gchar *) "black";
+  person.cap = (gchar *) "none";
+  person.apparel = (gchar *) "formal";
+  event_meta_init (&meta, NVDS_OBJECT_TYPE_PERSON, &person, sizeof (person));
+  meta.type = NVDS_EVENT_ENTRY;
+  message = generate_event_message (priv, &meta);
+  check_message_roundtrip (message);
+  g_free (message);
+
+  /* Missing sub objects are written as null. */
+  event_meta_init (&meta, NVDS_OBJECT_TYPE_FACE, NULL, 0);
+  meta.sensorId = 7;
+  message = generate_event_message (priv, &meta);
+  check_message_roundtrip (message);
+  g_assert_nonnull (strstr (message, "\"sensor\":null"));
+  g_free (message);
+
+  delete priv;
+}
+
+/* The json-glib baseline builds the same tree (a copy of the parsed message)
+ * and serializes it, which is what every message used to cost. */
+static void
+bench_throughput (void)
+{
+  NvDsPayloadPriv *priv = NULL;
+  NvDsVehicleObject vehicle = { 0 };
+  NvDsEventMsgMeta meta;
+  JsonNode *tree = NULL;
+  gchar *message = NULL;
+  gdouble elapsed, writer_rate, glib_rate;
+  guint i, n = 100000;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  priv = payload_priv_new ();
+  vehicle.type = (gchar *) "sedan";
+  vehicle.make = (gchar *) "Bugatti";
+  vehicle.model = (gchar *) "M";
+  vehicle.color = (gchar *) "blue";
+  vehicle.region = (gchar *) "CA";
+  vehicle.license = (gchar *) "XX1234";
+  event_meta_init (&meta, NVDS_OBJECT_TYPE_VEHICLE, &vehicle,
+      sizeof (vehicle));
+
+  g_test_timer_start ();
+  for (i = 0; i < n; i++) {
+    message = generate_event_message (priv, &meta);
+    if (i + 1 < n)
+      g_free (message);
+  }
+  elapsed = g_test_timer_elapsed ();
+  writer_rate = n / elapsed;
+
+  tree = json_from_string (message, NULL);
+  g_free (message);
+  g_test_timer_start ();
+  for (i = 0; i < n; i++) {
+    JsonNode *copy = json_node_copy (tree);
+    g_free (json_to_string (copy, FALSE));
+    json_node_unref (copy);
+  }
+  elapsed = g_test_timer_elapsed ();
+  glib_rate = n / elapsed;
+  json_node_unref (tree);
+
+  g_test_minimized_result (1e9 / writer_rate,
+      "writer: %.0f msg/s, json-glib tree: %.0f msg/s (%.1fx)", writer_rate,
+      glib_rate, writer_rate / glib_rate);
+  delete priv;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/eventmsg-payload/number-parity", test_number_parity);
+  g_test_add_func ("/eventmsg-payload/non-finite", test_non_finite);
+  g_test_add_func ("/eventmsg-payload/string-parity", test_string_parity);
+  g_test_add_func ("/eventmsg-payload/message-parity", test_message_parity);
+  g_test_add_func ("/eventmsg-payload/bench/throughput", bench_throughput);
+
+  return g_test_run ();
+}
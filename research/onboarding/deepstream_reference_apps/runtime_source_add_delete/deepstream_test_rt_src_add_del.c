@@ -22,6 +22,7 @@
 #include <gmodule.h>
 #include <string.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include "gstnvdsmeta.h"
 #include "gst-nvmessage.h"
 #include "nvdsmeta.h"
@@ -49,6 +50,11 @@ GMainLoop *loop = NULL;
 #define TRACKER_CONFIG_FILE "dstest_tracker_config.txt"
 #define SGIE1_CONFIG_FILE "dstest_sgie1_config.txt"
 #define SGIE2_CONFIG_FILE "dstest_sgie2_config.txt"
+/* Add/remove loop: time allowed from an add to its first frame */
+#define CYCLE_FIRST_FRAME_TIMEOUT_US (5 * G_USEC_PER_SEC)
+#define CYCLE_POLL_INTERVAL_MS 10
+/* Add/remove check: resident memory the second half of the loop may add */
+#define CYCLE_MAX_RSS_GROWTH_KB (16 * 1024)
 
 
 #define CONFIG_GPU_ID "gpu-id"
@@ -59,13 +65,77 @@ GMainLoop *loop = NULL;
 #define CONFIG_GROUP_TRACKER_LL_LIB_FILE "ll-lib-file"
 #define CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS "enable-batch-process"
 
+/* Codec class of the decode chain kept inside a parked source bin */
+typedef enum
+{
+  CODEC_CLASS_NONE,
+  CODEC_CLASS_H264,
+  CODEC_CLASS_H265,
+  /* Any other codec; uridecodebin decodes it and the chain is not kept */
+  CODEC_CLASS_RAW,
+} CodecClass;
+
+/* One streammux input. The bin is built once and then recycled: on release
+ * uridecodebin is stopped and parked in NULL, the parser and decoder are
+ * parked in READY and the streammux pad stays requested and linked. On the
+ * next add only uridecodebin has to be restarted with the new URI. */
+typedef struct
+{
+  gint source_id;
+  GstElement *bin;
+  GstElement *uridecodebin;
+  GstElement *parser;
+  GstElement *decoder;
+  GstPad *ghost_pad;
+  GstPad *mux_pad;
+  CodecClass codec_class;
+  gboolean recycled;
+  gint64 add_time_us;
+  gulong first_frame_probe;
+  gdouble first_frame_ms;
+} SourceSlot;
+
+typedef struct
+{
+  guint count;
+  gdouble total_ms;
+  gdouble max_ms;
+} LatencyStats;
+
+/* Pipeline size after a cycle. Bins are recycled, so once every slot in use
+ * has been built these stay flat from one cycle to the next. */
+typedef struct
+{
+  guint num_elements;
+  guint num_pads;
+  glong rss_kb;
+} CycleSnapshot;
+
 gint g_num_sources = 0;
-gint g_source_id_list[MAX_NUM_SOURCES];
+SourceSlot g_source_slots[MAX_NUM_SOURCES];
 gboolean g_eos_list[MAX_NUM_SOURCES];
 gboolean g_source_enabled[MAX_NUM_SOURCES];
-GstElement **g_source_bin_list = NULL;
+/* Codec class seen for each URI, used to pick a parked bin whose decode
+ * chain can be reused as is. Written from the streaming thread in cb_newpad
+ * and read from the main loop, so guarded by codec_lock. */
+GHashTable *g_codec_class_by_uri = NULL;
+GMutex codec_lock;
+/* Add-to-first-frame latency of freshly built [0] and recycled [1] bins */
+LatencyStats g_first_frame_stats[2];
 GMutex eos_lock;
+GMutex stats_lock;
 gboolean g_run_forever = FALSE;
+/* Add/remove loop state, used when a cycle count is given */
+guint g_num_cycles = 0;
+guint g_cycles_done = 0;
+guint g_cycle_failures = 0;
+gint g_cycle_source = -1;
+/* Add/remove check, used when a first frame threshold is given */
+gdouble g_max_first_frame_ms = 0;
+/* Slowest add of the loop; the initial source also waits for the engine */
+gdouble g_cycle_first_frame_ms = 0;
+CycleSnapshot g_cycle_mid;
+CycleSnapshot g_cycle_end;
 
 /* Assuming Resnet 10 model packaged in DS SDK */
 gchar pgie_classes_str[4][32] = { "Vehicle", "TwoWheeler", "Person",
@@ -80,6 +150,24 @@ gchar *uri = NULL;
 
 static gboolean add_sources (gpointer data);
 
+static void
+set_decoder_properties (GObject * object)
+{
+  int current_device = -1;
+  cudaGetDevice(&current_device);
+  struct cudaDeviceProp prop;
+  cudaGetDeviceProperties(&prop, current_device);
+
+  if(prop.integrated) {
+    g_object_set (object, "enable-max-performance", TRUE, NULL);
+    g_object_set (object, "bufapi-version", TRUE, NULL);
+    g_object_set (object, "drop-frame-interval", 0, NULL);
+    g_object_set (object, "num-extra-surfaces", 0, NULL);
+  } else {
+    g_object_set (object, "gpu-id", GPU_ID, NULL);
+  }
+}
+
 static void
 decodebin_child_added (GstChildProxy * child_proxy, GObject * object,
     gchar * name, gpointer user_data)
@@ -89,20 +177,9 @@ decodebin_child_added (GstChildProxy * child_proxy, GObject * object,
     g_signal_connect (G_OBJECT (object), "child-added",
         G_CALLBACK (decodebin_child_added), user_data);
   }
-  int current_device = -1;
-  cudaGetDevice(&current_device);
-  struct cudaDeviceProp prop;
-  cudaGetDeviceProperties(&prop, current_device);
 
   if (g_strrstr (name, "nvv4l2decoder") == name) {
-    if(prop.integrated) {
-      g_object_set (object, "enable-max-performance", TRUE, NULL);
-      g_object_set (object, "bufapi-version", TRUE, NULL);
-      g_object_set (object, "drop-frame-interval", 0, NULL);
-      g_object_set (object, "num-extra-surfaces", 0, NULL);
-    } else {
-      g_object_set (object, "gpu-id", GPU_ID, NULL);
-    }
+    set_decoder_properties (object);
   }
 }
 
@@ -138,20 +215,94 @@ get_absolute_file_path (gchar *cfg_file_path, gchar *file_path)
 }
 
 
+static void
+destroy_decode_chain (SourceSlot * slot)
+{
+  if (!slot->parser)
+    return;
+  gst_ghost_pad_set_target (GST_GHOST_PAD (slot->ghost_pad), NULL);
+  gst_element_set_locked_state (slot->parser, TRUE);
+  gst_element_set_locked_state (slot->decoder, TRUE);
+  gst_element_set_state (slot->decoder, GST_STATE_NULL);
+  gst_element_set_state (slot->parser, GST_STATE_NULL);
+  gst_bin_remove_many (GST_BIN (slot->bin), slot->parser, slot->decoder, NULL);
+  slot->parser = slot->decoder = NULL;
+}
+
+/* Build parser ! nvv4l2decoder for codec_class and make the decoder output
+ * the bin's src pad. The chain stays in the bin across recycles. */
+static gboolean
+create_decode_chain (SourceSlot * slot, CodecClass codec_class)
+{
+  gchar name[32];
+
+  g_snprintf (name, sizeof (name), "parser-%02d", slot->source_id);
+  slot->parser = gst_element_factory_make (codec_class == CODEC_CLASS_H264 ?
+      "h264parse" : "h265parse", name);
+  g_snprintf (name, sizeof (name), "decoder-%02d", slot->source_id);
+  slot->decoder = gst_element_factory_make ("nvv4l2decoder", name);
+  if (!slot->parser || !slot->decoder) {
+    g_printerr ("Failed to create decode chain for source %d\n",
+        slot->source_id);
+    if (slot->parser)
+      gst_object_unref (slot->parser);
+    if (slot->decoder)
+      gst_object_unref (slot->decoder);
+    slot->parser = slot->decoder = NULL;
+    return FALSE;
+  }
+  set_decoder_properties (G_OBJECT (slot->decoder));
+
+  gst_bin_add_many (GST_BIN (slot->bin), slot->parser, slot->decoder, NULL);
+  if (!gst_element_link (slot->parser, slot->decoder)) {
+    g_printerr ("Failed to link decode chain for source %d\n",
+        slot->source_id);
+    return FALSE;
+  }
+  GstPad *srcpad = gst_element_get_static_pad (slot->decoder, "src");
+  gst_ghost_pad_set_target (GST_GHOST_PAD (slot->ghost_pad), srcpad);
+  gst_object_unref (srcpad);
+  gst_element_sync_state_with_parent (slot->decoder);
+  gst_element_sync_state_with_parent (slot->parser);
+  return TRUE;
+}
+
 static void
 cb_newpad (GstElement * decodebin, GstPad * pad, gpointer data)
 {
+  SourceSlot *slot = (SourceSlot *) data;
   GstCaps *caps = gst_pad_query_caps (pad, NULL);
   const GstStructure *str = gst_caps_get_structure (caps, 0);
   const gchar *name = gst_structure_get_name (str);
+  CodecClass codec_class = CODEC_CLASS_NONE;
+  gchar *current_uri = NULL;
 
   g_print ("decodebin new pad %s\n", name);
-  if (!strncmp (name, "video", 5)) {
-    gint source_id = (*(gint *) data);
-    gchar pad_name[16] = { 0 };
-    GstPad *sinkpad = NULL;
-    g_snprintf (pad_name, 15, "sink_%u", source_id);
-    sinkpad = gst_element_get_request_pad (streammux, pad_name);
+  if (!strcmp (name, "video/x-h264")) {
+    codec_class = CODEC_CLASS_H264;
+  } else if (!strcmp (name, "video/x-h265")) {
+    codec_class = CODEC_CLASS_H265;
+  } else if (!strncmp (name, "video", 5)) {
+    codec_class = CODEC_CLASS_RAW;
+  }
+  gst_caps_unref (caps);
+  if (codec_class == CODEC_CLASS_NONE)
+    return;
+
+  if (slot->codec_class != codec_class) {
+    destroy_decode_chain (slot);
+    if (codec_class != CODEC_CLASS_RAW &&
+        !create_decode_chain (slot, codec_class)) {
+      return;
+    }
+    slot->codec_class = codec_class;
+  }
+
+  if (codec_class == CODEC_CLASS_RAW) {
+    gst_ghost_pad_set_target (GST_GHOST_PAD (slot->ghost_pad), pad);
+    g_print ("Decodebin linked to pipeline\n");
+  } else {
+    GstPad *sinkpad = gst_element_get_static_pad (slot->parser, "sink");
     if (gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK) {
       g_print ("Failed to link decodebin to pipeline\n");
     } else {
@@ -159,74 +310,230 @@ cb_newpad (GstElement * decodebin, GstPad * pad, gpointer data)
     }
     gst_object_unref (sinkpad);
   }
+
+  g_object_get (G_OBJECT (decodebin), "uri", &current_uri, NULL);
+  if (current_uri) {
+    g_mutex_lock (&codec_lock);
+    g_hash_table_insert (g_codec_class_by_uri, current_uri,
+        GINT_TO_POINTER (codec_class));
+    g_mutex_unlock (&codec_lock);
+  }
+}
+
+static GstPadProbeReturn
+first_frame_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  SourceSlot *slot = (SourceSlot *) u_data;
+  LatencyStats *stats = &g_first_frame_stats[slot->recycled ? 1 : 0];
+  gdouble ms = (g_get_monotonic_time () - slot->add_time_us) / 1000.0;
+
+  g_print ("Source %d: first frame %.1f ms after add (%s bin)\n",
+      slot->source_id, ms, slot->recycled ? "recycled" : "new");
+  g_mutex_lock (&stats_lock);
+  stats->count++;
+  stats->total_ms += ms;
+  stats->max_ms = MAX (stats->max_ms, ms);
+  slot->first_frame_ms = ms;
+  slot->first_frame_probe = 0;
+  g_mutex_unlock (&stats_lock);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static void
+print_first_frame_stats (void)
+{
+  const gchar *names[2] = { "new", "recycled" };
+  guint i;
+
+  g_mutex_lock (&stats_lock);
+  for (i = 0; i < 2; i++) {
+    LatencyStats *stats = &g_first_frame_stats[i];
+    if (!stats->count)
+      continue;
+    g_print ("Add-to-first-frame (%s bins): %u adds, avg %.1f ms, "
+        "max %.1f ms\n", names[i], stats->count,
+        stats->total_ms / stats->count, stats->max_ms);
+  }
+  g_mutex_unlock (&stats_lock);
 }
 
-static GstElement *
-create_uridecode_bin (guint index, gchar * filename)
+/* Pre-construct the parked bin for a streammux input. It is added to the
+ * pipeline and linked on its first use. */
+static gboolean
+create_source_slot (guint index)
 {
-  GstElement *bin = NULL;
+  SourceSlot *slot = &g_source_slots[index];
   gchar bin_name[16] = { };
+  GstCaps *caps = NULL;
 
-  g_print ("creating uridecodebin for [%s]\n", filename);
-  g_source_id_list[index] = index;
+  slot->source_id = index;
   g_snprintf (bin_name, 15, "source-bin-%02d", index);
-  bin = gst_element_factory_make ("uridecodebin", bin_name);
-  g_object_set (G_OBJECT (bin), "uri", filename, NULL);
-  g_signal_connect (G_OBJECT (bin), "pad-added",
-      G_CALLBACK (cb_newpad), &g_source_id_list[index]);
-  g_signal_connect (G_OBJECT (bin), "child-added",
-      G_CALLBACK (decodebin_child_added), &g_source_id_list[index]);
+  slot->bin = gst_object_ref_sink (gst_bin_new (bin_name));
+  slot->uridecodebin = gst_element_factory_make ("uridecodebin", NULL);
+  if (!slot->bin || !slot->uridecodebin) {
+    return FALSE;
+  }
+  /* Stop at the H.264/H.265 elementary stream so that the bin's own decode
+   * chain, which survives recycling, does the decoding. */
+  caps = gst_caps_from_string ("video/x-h264; video/x-h265; "
+      "video/x-raw(ANY); audio/x-raw(ANY)");
+  g_object_set (G_OBJECT (slot->uridecodebin), "caps", caps, NULL);
+  gst_caps_unref (caps);
+  g_signal_connect (G_OBJECT (slot->uridecodebin), "pad-added",
+      G_CALLBACK (cb_newpad), slot);
+  g_signal_connect (G_OBJECT (slot->uridecodebin), "child-added",
+      G_CALLBACK (decodebin_child_added), slot);
+  gst_bin_add (GST_BIN (slot->bin), slot->uridecodebin);
+  gst_element_set_locked_state (slot->uridecodebin, TRUE);
+
+  slot->ghost_pad = gst_ghost_pad_new_no_target ("src", GST_PAD_SRC);
+  gst_element_add_pad (slot->bin, slot->ghost_pad);
+
+  return TRUE;
+}
+
+/* Build one parked H.264 and one parked H.265 decode chain up front, in the
+ * last unused slots, so that the first add of either codec skips the parser
+ * and decoder construction and the decoder open in READY. */
+static void
+prewarm_decode_chains (void)
+{
+  CodecClass codec_classes[] = { CODEC_CLASS_H264, CODEC_CLASS_H265 };
+  gint index = MAX_NUM_SOURCES - 1;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (codec_classes) && index > 0; i++, index--) {
+    SourceSlot *slot = &g_source_slots[index];
+    if (!create_decode_chain (slot, codec_classes[i])) {
+      destroy_decode_chain (slot);
+      continue;
+    }
+    slot->codec_class = codec_classes[i];
+    gst_element_set_locked_state (slot->parser, TRUE);
+    gst_element_set_locked_state (slot->decoder, TRUE);
+    gst_element_set_state (slot->parser, GST_STATE_READY);
+    gst_element_set_state (slot->decoder, GST_STATE_READY);
+    g_print ("Pre-warmed %s decode chain in source bin %d\n",
+        codec_classes[i] == CODEC_CLASS_H264 ? "H.264" : "H.265", index);
+  }
+}
+
+/* Point the slot at filename and start it. With start FALSE the pipeline
+ * state change brings it up. */
+static GstStateChangeReturn
+start_source_slot (guint index, gchar * filename, gboolean start)
+{
+  SourceSlot *slot = &g_source_slots[index];
+  GstStateChangeReturn state_return = GST_STATE_CHANGE_SUCCESS;
+
+  g_print ("starting source bin %d for [%s]\n", index, filename);
+  g_mutex_lock (&eos_lock);
+  g_eos_list[index] = FALSE;
+  g_mutex_unlock (&eos_lock);
   g_source_enabled[index] = TRUE;
 
-  return bin;
+  slot->recycled = slot->mux_pad != NULL;
+  if (!slot->mux_pad) {
+    gchar pad_name[16] = { 0 };
+    gst_bin_add (GST_BIN (pipeline), slot->bin);
+    g_snprintf (pad_name, 15, "sink_%u", index);
+    slot->mux_pad = gst_element_get_request_pad (streammux, pad_name);
+    if (gst_pad_link (slot->ghost_pad, slot->mux_pad) != GST_PAD_LINK_OK) {
+      g_printerr ("Failed to link source bin %d to streammux\n", index);
+      return GST_STATE_CHANGE_FAILURE;
+    }
+  }
+
+  g_object_set (G_OBJECT (slot->uridecodebin), "uri", filename, NULL);
+  g_mutex_lock (&stats_lock);
+  if (slot->first_frame_probe)
+    gst_pad_remove_probe (slot->ghost_pad, slot->first_frame_probe);
+  slot->add_time_us = g_get_monotonic_time ();
+  slot->first_frame_probe = gst_pad_add_probe (slot->ghost_pad,
+      GST_PAD_PROBE_TYPE_BUFFER, first_frame_probe, slot, NULL);
+  g_mutex_unlock (&stats_lock);
+
+  gst_element_set_locked_state (slot->uridecodebin, FALSE);
+  if (slot->parser) {
+    gst_element_set_locked_state (slot->parser, FALSE);
+    gst_element_set_locked_state (slot->decoder, FALSE);
+  }
+  if (!start)
+    return state_return;
+
+  if (slot->parser) {
+    gst_element_sync_state_with_parent (slot->decoder);
+    gst_element_sync_state_with_parent (slot->parser);
+  }
+  state_return = gst_element_set_state (slot->bin, GST_STATE_PLAYING);
+  if (state_return != GST_STATE_CHANGE_FAILURE)
+    state_return = gst_element_set_state (slot->uridecodebin,
+        GST_STATE_PLAYING);
+  return state_return;
+}
+
+/* Pick the slot for the next add: a parked or pre-warmed bin whose decode
+ * chain matches the codec already seen for uri, else any parked bin, else a
+ * free slot. */
+static gint
+pick_source_slot (gchar * filename)
+{
+  CodecClass codec_class;
+  gint parked = -1, unused = -1;
+  gint i;
+
+  g_mutex_lock (&codec_lock);
+  codec_class = GPOINTER_TO_INT (g_hash_table_lookup (g_codec_class_by_uri,
+          filename));
+  g_mutex_unlock (&codec_lock);
+
+  for (i = 0; i < MAX_NUM_SOURCES; i++) {
+    if (g_source_enabled[i])
+      continue;
+    if (codec_class != CODEC_CLASS_NONE &&
+        g_source_slots[i].codec_class == codec_class)
+      return i;
+    if (g_source_slots[i].mux_pad) {
+      if (parked < 0)
+        parked = i;
+    } else if (unused < 0) {
+      unused = i;
+    }
+  }
+  return parked >= 0 ? parked : unused;
 }
 
 static void
 stop_release_source (gint source_id)
 {
+  SourceSlot *slot = &g_source_slots[source_id];
   GstStateChangeReturn state_return;
-  gchar pad_name[16];
-  GstPad *sinkpad = NULL;
-  state_return =
-      gst_element_set_state (g_source_bin_list[source_id], GST_STATE_NULL);
-  switch (state_return) {
-    case GST_STATE_CHANGE_SUCCESS:
-      g_print ("STATE CHANGE SUCCESS\n\n");
-      g_snprintf (pad_name, 15, "sink_%u", source_id);
-      sinkpad = gst_element_get_static_pad (streammux, pad_name);
-      gst_pad_send_event (sinkpad, gst_event_new_eos ());
-      gst_pad_send_event (sinkpad, gst_event_new_flush_stop (FALSE));
-      gst_element_release_request_pad (streammux, sinkpad);
-      g_print ("STATE CHANGE SUCCESS %p\n\n", sinkpad);
-      gst_object_unref (sinkpad);
-      gst_bin_remove (GST_BIN (pipeline), g_source_bin_list[source_id]);
-      source_id--;
-      g_num_sources--;
-      break;
-    case GST_STATE_CHANGE_FAILURE:
-      g_print ("STATE CHANGE FAILURE\n\n");
-      break;
-    case GST_STATE_CHANGE_ASYNC:
-      g_print ("STATE CHANGE ASYNC\n\n");
-      g_snprintf (pad_name, 15, "sink_%u", source_id);
-      sinkpad = gst_element_get_static_pad (streammux, pad_name);
-      gst_pad_send_event (sinkpad, gst_event_new_eos ());
-      gst_pad_send_event (sinkpad, gst_event_new_flush_stop (FALSE));
-      gst_element_release_request_pad (streammux, sinkpad);
-      g_print ("STATE CHANGE ASYNC %p\n\n", sinkpad);
-      gst_object_unref (sinkpad);
-      gst_bin_remove (GST_BIN (pipeline), g_source_bin_list[source_id]);
-      source_id--;
-      g_num_sources--;
-      break;
-    case GST_STATE_CHANGE_NO_PREROLL:
-      g_print ("STATE CHANGE NO PREROLL\n\n");
-      break;
-    default:
-      break;
-  }
 
+  gst_element_set_locked_state (slot->uridecodebin, TRUE);
+  state_return = gst_element_set_state (slot->uridecodebin, GST_STATE_NULL);
+  if (state_return == GST_STATE_CHANGE_FAILURE) {
+    g_print ("STATE CHANGE FAILURE\n\n");
+    gst_element_set_locked_state (slot->uridecodebin, FALSE);
+    return;
+  }
+  g_print ("STATE CHANGE SUCCESS\n\n");
+
+  /* READY drops the stream state (EOS, segment, buffers) but keeps the
+   * elements, so the next add skips their construction. */
+  if (slot->parser) {
+    gst_element_set_locked_state (slot->parser, TRUE);
+    gst_element_set_locked_state (slot->decoder, TRUE);
+    gst_element_set_state (slot->parser, GST_STATE_READY);
+    gst_element_set_state (slot->decoder, GST_STATE_READY);
+  }
 
+  /* End the stream on the streammux pad and make it reusable, but keep it
+   * requested and linked for the parked bin. */
+  gst_pad_send_event (slot->mux_pad, gst_event_new_eos ());
+  gst_pad_send_event (slot->mux_pad, gst_event_new_flush_stop (FALSE));
+  g_print ("Parked source bin %d\n", source_id);
+  g_num_sources--;
 }
 
 static gboolean
@@ -248,7 +555,7 @@ delete_sources (gpointer data)
       g_print ("All sources Stopped quitting\n");
     }
     else {
-      g_timeout_add_seconds (15, add_sources, (gpointer) g_source_bin_list);
+      g_timeout_add_seconds (15, add_sources, NULL);
     }
     return FALSE;
   }
@@ -266,7 +573,7 @@ delete_sources (gpointer data)
       g_print ("All sources Stopped quitting\n");
     }
     else {
-      g_timeout_add_seconds (15, add_sources, (gpointer) g_source_bin_list);
+      g_timeout_add_seconds (15, add_sources, NULL);
     }
     return FALSE;
   }
@@ -277,28 +584,17 @@ delete_sources (gpointer data)
 static gboolean
 add_sources (gpointer data)
 {
-  gint source_id = g_num_sources;
-  GstElement *source_bin;
+  gint source_id;
   GstStateChangeReturn state_return;
 
-  do {
-    /* Generating random source id between 0 - MAX_NUM_SOURCES - 1,
-     * which has not been enabled
-     */
-    source_id = rand () % MAX_NUM_SOURCES;
-  } while (g_source_enabled[source_id]);
-  g_source_enabled[source_id] = TRUE;
+  /* Reuse a parked source bin, preferably one that already decodes the
+   * codec of uri */
+  source_id = pick_source_slot (uri);
+  if (source_id < 0)
+    return FALSE;
 
   g_print ("Calling Start %d \n", source_id);
-  source_bin = create_uridecode_bin (source_id, uri);
-  if (!source_bin) {
-    g_printerr ("Failed to create source bin. Exiting.\n");
-    return -1;
-  }
-  g_source_bin_list[source_id] = source_bin;
-  gst_bin_add (GST_BIN (pipeline), source_bin);
-  state_return =
-      gst_element_set_state (g_source_bin_list[source_id], GST_STATE_PLAYING);
+  state_return = start_source_slot (source_id, uri, TRUE);
   switch (state_return) {
     case GST_STATE_CHANGE_SUCCESS:
       g_print ("STATE CHANGE SUCCESS\n\n");
@@ -310,7 +606,7 @@ add_sources (gpointer data)
     case GST_STATE_CHANGE_ASYNC:
       g_print ("STATE CHANGE ASYNC\n\n");
       state_return =
-          gst_element_get_state (g_source_bin_list[source_id], NULL, NULL,
+          gst_element_get_state (g_source_slots[source_id].bin, NULL, NULL,
           GST_CLOCK_TIME_NONE);
       source_id++;
       break;
@@ -327,13 +623,147 @@ add_sources (gpointer data)
     /* We have reached MAX_NUM_SOURCES to be added, no stop calling this function
      * and enable calling delete sources
      */
-    g_timeout_add_seconds (5, delete_sources, (gpointer) g_source_bin_list);
+    g_timeout_add_seconds (5, delete_sources, NULL);
     return FALSE;
   }
 
   return TRUE;
 }
 
+static glong
+read_rss_kb (void)
+{
+  FILE *statm = fopen ("/proc/self/statm", "r");
+  glong pages = 0;
+
+  if (!statm)
+    return 0;
+  if (fscanf (statm, "%*ld %ld", &pages) != 1)
+    pages = 0;
+  fclose (statm);
+  return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+take_cycle_snapshot (CycleSnapshot * snapshot)
+{
+  GstIterator *it = gst_bin_iterate_recurse (GST_BIN (pipeline));
+  GValue item = G_VALUE_INIT;
+
+  memset (snapshot, 0, sizeof (CycleSnapshot));
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = GST_ELEMENT (g_value_get_object (&item));
+
+    snapshot->num_elements++;
+    GST_OBJECT_LOCK (element);
+    snapshot->num_pads += element->numpads;
+    GST_OBJECT_UNLOCK (element);
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+  snapshot->rss_kb = read_rss_kb ();
+}
+
+/* Add/remove check: every cycle delivered a first frame within
+ * g_max_first_frame_ms, and the second half of the loop grew neither the
+ * pipeline nor, beyond CYCLE_MAX_RSS_GROWTH_KB, the process.
+ * Returns the number of failed checks. */
+static guint
+check_cycles (void)
+{
+  guint failures = g_cycle_failures;
+
+  if (g_cycles_done < g_num_cycles) {
+    g_printerr ("CHECK FAILED: %u of %u cycles done\n", g_cycles_done,
+        g_num_cycles);
+    failures++;
+  }
+  if (g_cycle_first_frame_ms > g_max_first_frame_ms) {
+    g_printerr ("CHECK FAILED: add-to-first-frame %.1f ms > %.1f ms\n",
+        g_cycle_first_frame_ms, g_max_first_frame_ms);
+    failures++;
+  }
+  if (g_cycle_end.num_elements != g_cycle_mid.num_elements ||
+      g_cycle_end.num_pads != g_cycle_mid.num_pads) {
+    g_printerr ("CHECK FAILED: pipeline grew from %u elements/%u pads to "
+        "%u/%u\n", g_cycle_mid.num_elements, g_cycle_mid.num_pads,
+        g_cycle_end.num_elements, g_cycle_end.num_pads);
+    failures++;
+  }
+  if (g_cycle_end.rss_kb - g_cycle_mid.rss_kb > CYCLE_MAX_RSS_GROWTH_KB) {
+    g_printerr ("CHECK FAILED: resident memory grew %ld kB\n",
+        g_cycle_end.rss_kb - g_cycle_mid.rss_kb);
+    failures++;
+  }
+  if (!failures)
+    g_print ("Add/remove check passed: %u cycles, pipeline %u elements/%u "
+        "pads, resident memory %+ld kB over the second half\n",
+        g_cycles_done, g_cycle_end.num_elements, g_cycle_end.num_pads,
+        g_cycle_end.rss_kb - g_cycle_mid.rss_kb);
+  return failures;
+}
+
+/* Add/remove loop: add one source next to the first one, remove it as soon
+ * as its first frame arrives (or it times out) and repeat g_num_cycles
+ * times. The add-to-first-frame summary printed on exit is the benchmark. */
+static gboolean
+cycle_sources (gpointer data)
+{
+  SourceSlot *slot;
+  gboolean first_frame;
+
+  if (g_cycle_source < 0) {
+    if (g_cycles_done == g_num_cycles) {
+      g_print ("Add/remove loop done: %u cycles, %u failed\n",
+          g_cycles_done, g_cycle_failures);
+      g_main_loop_quit (loop);
+      return FALSE;
+    }
+    g_cycle_source = pick_source_slot (uri);
+    if (g_cycle_source < 0)
+      return TRUE;
+    if (start_source_slot (g_cycle_source, uri, TRUE) ==
+        GST_STATE_CHANGE_FAILURE) {
+      /* Counted as a failure when the first frame times out */
+      g_printerr ("Cycle %u: failed to start source bin %d\n",
+          g_cycles_done, g_cycle_source);
+    }
+    g_num_sources++;
+    return TRUE;
+  }
+
+  slot = &g_source_slots[g_cycle_source];
+  g_mutex_lock (&stats_lock);
+  first_frame = slot->first_frame_probe == 0;
+  if (first_frame)
+    g_cycle_first_frame_ms = MAX (g_cycle_first_frame_ms,
+        slot->first_frame_ms);
+  g_mutex_unlock (&stats_lock);
+  if (!first_frame) {
+    if (g_get_monotonic_time () - slot->add_time_us <
+        CYCLE_FIRST_FRAME_TIMEOUT_US)
+      return TRUE;
+    g_printerr ("Cycle %u: no first frame from source bin %d\n",
+        g_cycles_done, g_cycle_source);
+    g_cycle_failures++;
+  }
+
+  g_mutex_lock (&eos_lock);
+  g_source_enabled[g_cycle_source] = FALSE;
+  stop_release_source (g_cycle_source);
+  g_mutex_unlock (&eos_lock);
+  g_cycle_source = -1;
+  g_cycles_done++;
+  if (g_max_first_frame_ms > 0) {
+    if (g_cycles_done == (g_num_cycles + 1) / 2)
+      take_cycle_snapshot (&g_cycle_mid);
+    if (g_cycles_done == g_num_cycles)
+      take_cycle_snapshot (&g_cycle_end);
+  }
+  return TRUE;
+}
+
 static gboolean
 bus_call (GstBus * bus, GstMessage * msg, gpointer data)
 {
@@ -485,6 +915,7 @@ main (int argc, char *argv[])
   guint i, num_sources;
   guint tiler_rows, tiler_columns;
   guint pgie_batch_size;
+  guint check_failures = 0;
 
   int current_device = -1;
   cudaGetDevice(&current_device);
@@ -510,11 +941,13 @@ main (int argc, char *argv[])
   }
 
   /* Check input arguments */
-  if ((argc != 5)) {
-    g_printerr ("Usage: %s <uri> <run forever> <sink> <sync>\n", argv[0]);
+  if (argc < 5 || argc > 7) {
+    g_printerr ("Usage: %s <uri> <run forever> <sink> <sync> [<cycles> [<max first frame ms>]]\n", argv[0]);
     g_printerr ("     : <run forever> 0 or 1 \n");
     g_printerr ("     : <sink> filesink (generates test.mkv) or nveglglessink (dGPU) or nv3dsink (Jetson)\n");
-    g_printerr ("     : <sync> 0 or 1 \n\n");
+    g_printerr ("     : <sync> 0 or 1 \n");
+    g_printerr ("     : <cycles> optional, run that many add/remove cycles back to back and exit\n");
+    g_printerr ("     : <max first frame ms> optional, fail on a slower add or on pipeline/memory growth\n\n");
     g_printerr ("example: %s file:///opt/nvidia/deepstream/deepstream/samples/streams/sample_1080p_h264.mp4 0 filesink 1\n", argv[0]);
     return -1;
   }
@@ -532,6 +965,10 @@ main (int argc, char *argv[])
   num_sources = 1;
   g_run_forever = atoi(argv[2]);
   sync = atoi(argv[4]);
+  if (argc >= 6)
+    g_num_cycles = atoi(argv[5]);
+  if (argc == 7)
+    g_max_first_frame_ms = g_ascii_strtod (argv[6], NULL);
 
   /* Standard GStreamer initialization */
   gst_init (&argc, &argv);
@@ -547,7 +984,9 @@ main (int argc, char *argv[])
   streammux = gst_element_factory_make ("nvstreammux", "stream-muxer");
   g_object_set (G_OBJECT (streammux), "batched-push-timeout", 25000, NULL);
   g_object_set (G_OBJECT (streammux), "batch-size", 30, NULL);
-  g_object_set (G_OBJECT (streammux), "drop-pipeline-eos", g_run_forever, NULL);
+  /* The add/remove loop outlives the first source, keep the pipeline up */
+  g_object_set (G_OBJECT (streammux), "drop-pipeline-eos",
+      g_run_forever || g_num_cycles > 0, NULL);
   SET_GPU_ID (streammux, GPU_ID);
 
   if (!pipeline || !streammux) {
@@ -557,16 +996,25 @@ main (int argc, char *argv[])
   gst_bin_add (GST_BIN (pipeline), streammux);
   g_object_set (G_OBJECT (streammux), "live-source", 1, NULL);
 
-  g_source_bin_list = g_malloc0 (sizeof (GstElement *) * MAX_NUM_SOURCES);
+  g_mutex_init (&stats_lock);
+  g_mutex_init (&codec_lock);
+  g_codec_class_by_uri = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
   uri = g_strdup (argv[1]);
-  for (i = 0; i < /*num_sources */ 1; i++) {
-    GstElement *source_bin = create_uridecode_bin (i, argv[i + 1]);
-    if (!source_bin) {
+  /* Pre-construct a parked source bin for every streammux input */
+  for (i = 0; i < MAX_NUM_SOURCES; i++) {
+    if (!create_source_slot (i)) {
       g_printerr ("Failed to create source bin. Exiting.\n");
       return -1;
     }
-    g_source_bin_list[i] = source_bin;
-    gst_bin_add (GST_BIN (pipeline), source_bin);
+  }
+  prewarm_decode_chains ();
+  for (i = 0; i < /*num_sources */ 1; i++) {
+    if (start_source_slot (i, argv[i + 1], FALSE) ==
+        GST_STATE_CHANGE_FAILURE) {
+      g_printerr ("Failed to start source bin. Exiting.\n");
+      return -1;
+    }
   }
 
   g_num_sources = num_sources;
@@ -690,19 +1138,40 @@ main (int argc, char *argv[])
 
   /* Wait till pipeline encounters an error or EOS */
   g_print ("Running...\n");
-  g_timeout_add_seconds (15, add_sources, (gpointer) g_source_bin_list);
+  if (g_num_cycles > 0)
+    g_timeout_add (CYCLE_POLL_INTERVAL_MS, cycle_sources, NULL);
+  else
+    g_timeout_add_seconds (15, add_sources, NULL);
   g_main_loop_run (loop);
 
   /* Out of the main loop, clean up nicely */
   g_print ("Returned, stopping playback\n");
+  print_first_frame_stats ();
+  if (g_num_cycles > 0 && g_max_first_frame_ms > 0)
+    check_failures = check_cycles ();
   gst_element_set_state (pipeline, GST_STATE_NULL);
+  /* Parked elements are locked and were skipped by the pipeline */
+  for (i = 0; i < MAX_NUM_SOURCES; i++) {
+    SourceSlot *slot = &g_source_slots[i];
+    if (slot->parser) {
+      gst_element_set_state (slot->decoder, GST_STATE_NULL);
+      gst_element_set_state (slot->parser, GST_STATE_NULL);
+    }
+    gst_element_set_state (slot->uridecodebin, GST_STATE_NULL);
+    if (slot->mux_pad)
+      gst_object_unref (slot->mux_pad);
+  }
   g_print ("Deleting pipeline\n");
   gst_object_unref (GST_OBJECT (pipeline));
   g_source_remove (bus_watch_id);
   g_main_loop_unref (loop);
-  g_free (g_source_bin_list);
+  for (i = 0; i < MAX_NUM_SOURCES; i++)
+    gst_object_unref (g_source_slots[i].bin);
+  g_hash_table_destroy (g_codec_class_by_uri);
   g_free (uri);
   g_mutex_clear (&eos_lock);
-  return 0;
+  g_mutex_clear (&stats_lock);
+  g_mutex_clear (&codec_lock);
+  return g_cycle_failures || check_failures ? -1 : 0;
 }
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __NVGSTDS_BATCH_TIMEOUT_H__
+#define __NVGSTDS_BATCH_TIMEOUT_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+  /** streammux batch-size. */
+  guint batch_size;
+  /** Smallest fraction of the batch the timeout aims to fill. The batch
+   * capacity is min(batch-size, sources that sent frames in the window). */
+  gdouble target_fill;
+  /** Upper bound of the 99th percentile time a frame waits in the muxer,
+   * in microseconds. Also the largest timeout chosen. */
+  guint max_latency_us;
+  /** Smallest timeout chosen, in microseconds. */
+  guint min_timeout_us;
+  /** Length of the arrival trace replayed by each update, in milliseconds. */
+  guint window_ms;
+} NvDsBatchTimeoutConfig;
+
+/** One frame arriving at a streammux sink pad. */
+typedef struct
+{
+  gint64 ts_us;
+  guint source_id;
+} NvDsBatchArrival;
+
+/** Result of replaying an arrival trace with a fixed timeout. */
+typedef struct
+{
+  guint num_batches;
+  guint num_frames;
+  /** Mean of frames per batch over the batch capacity. */
+  gdouble fill;
+  /** 99th percentile time from arrival to batch push, in microseconds. */
+  gdouble p99_wait_us;
+} NvDsBatchReplay;
+
+typedef struct
+{
+  /** Timeout currently chosen, in microseconds. */
+  gint timeout_us;
+  /** Replay of the last window with the chosen timeout. */
+  NvDsBatchReplay predicted;
+  /** Batches pushed by the muxer since the last update. */
+  guint64 num_batches;
+  /** Mean fill of the batches pushed since the last update. */
+  gdouble achieved_fill;
+} NvDsBatchTimeoutStats;
+
+/**
+ * Adaptive batched-push-timeout for the legacy nvstreammux.
+ * Frame arrivals of every source are kept for the last window. Each update
+ * replays them through a model of the muxer (a batch takes at most one frame
+ * per source and is pushed when full or @c timeout after its first frame),
+ * so the per-source inter-arrival distributions, jitter and phase are used
+ * as observed. The smallest timeout that reaches target_fill is chosen,
+ * lowered until the p99 wait fits max_latency_us.
+ */
+typedef struct _NvDsBatchTimeout NvDsBatchTimeout;
+
+NvDsBatchTimeout *nvds_batch_timeout_new (NvDsBatchTimeoutConfig * config,
+    gint initial_timeout_us);
+
+void nvds_batch_timeout_free (NvDsBatchTimeout * ctl);
+
+/** Record a frame reaching the muxer. Safe to call from streaming threads. */
+void nvds_batch_timeout_record_arrival (NvDsBatchTimeout * ctl,
+    guint source_id, gint64 now_us);
+
+/** Record a batch pushed by the muxer with @p num_frames frames. */
+void nvds_batch_timeout_record_batch (NvDsBatchTimeout * ctl,
+    guint num_frames);
+
+/** Forget the arrivals of a removed source. */
+void nvds_batch_timeout_remove_source (NvDsBatchTimeout * ctl,
+    guint source_id);
+
+/**
+ * Replay the arrivals of the last window and choose a new timeout.
+ * Changes smaller than 10% are ignored.
+ *
+ * @return TRUE if @p timeout_us was changed.
+ */
+gboolean nvds_batch_timeout_update (NvDsBatchTimeout * ctl, gint64 now_us,
+    gint * timeout_us);
+
+void nvds_batch_timeout_get_stats (NvDsBatchTimeout * ctl,
+    NvDsBatchTimeoutStats * stats);
+
+/**
+ * Replay @p arrivals (sorted by time) through the muxer model.
+ * Batches whose timeout would end after the last arrival are not counted.
+ */
+void nvds_batch_timeout_replay (const NvDsBatchArrival * arrivals,
+    guint num_arrivals, guint batch_size, gint timeout_us,
+    NvDsBatchReplay * result);
+
+/**
+ * Choose the timeout for @p arrivals (sorted by time) as
+ * nvds_batch_timeout_update() does.
+ *
+ * @return the timeout in microseconds, or -1 if the trace has fewer than
+ *         two sources.
+ */
+gint nvds_batch_timeout_select (NvDsBatchTimeoutConfig * config,
+    const NvDsBatchArrival * arrivals, guint num_arrivals,
+    NvDsBatchReplay * result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __NVGSTDS_LABEL_TABLE_H__
+#define __NVGSTDS_LABEL_TABLE_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "nvdsmeta.h"
+
+/**
+ * Process-wide table of interned classifier labels.
+ *
+ * Each distinct label is stored once and gets a small integer id; id 0 means
+ * "no label". The strings are never freed, so the pointer returned by
+ * nvds_label_table_name() stays valid for the lifetime of the process and
+ * may be stored in schema objects (e.g. NvDsVehicleObject) without copying.
+ * Such pointers must not be g_free()d.
+ */
+
+/** Upper bound of distinct labels. Further labels are not interned. */
+#define NVDS_LABEL_TABLE_MAX_LABELS (65536)
+
+/**
+ * Return the id of @p label, adding it to the table if needed.
+ *
+ * @return 0 if @p label is NULL or empty, or the table is full.
+ */
+guint nvds_label_table_intern (const gchar * label);
+
+/** Return the id of @p label without adding it, 0 if it is unknown. */
+guint nvds_label_table_find (const gchar * label);
+
+/** Return the interned string of @p id, NULL for 0 or unknown ids. */
+const gchar *nvds_label_table_name (guint id);
+
+/**
+ * Intern the labels parsed from the label file of the GIE @p gie_id and
+ * index them by (label_id, result_class_id) so that classifier results of
+ * that GIE resolve without hashing. Registering the same @p gie_id again
+ * replaces its index.
+ */
+void nvds_label_table_add_gie (guint gie_id, guint n_labels,
+    const guint * n_label_outputs, gchar *** labels);
+
+/**
+ * Return the label id of a classifier result of the GIE @p gie_id.
+ * Results of GIEs whose label file was not registered, or whose label
+ * differs from the registered one, are resolved by string.
+ */
+guint nvds_label_table_classifier_label (guint gie_id,
+    const NvDsLabelInfo * info);
+
+/**
+ * Return the id of the first non-empty result label of @p classifier_meta,
+ * 0 if there is none.
+ */
+guint nvds_label_table_first_result (const NvDsClassifierMeta *
+    classifier_meta);
+
+/** Number of interned labels. */
+guint nvds_label_table_size (void);
+
+/**
+ * Number of labels added while resolving classifier results, i.e. labels
+ * that were not in any registered label file. Once the pipeline is warm
+ * this stays constant and resolving a result allocates nothing.
+ */
+guint64 nvds_label_table_runtime_inserts (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -48,10 +48,11 @@ typedef struct
 
 typedef struct
 {
-  gdouble fps[MAX_SOURCE_BINS];
-  gdouble fps_avg[MAX_SOURCE_BINS];
+  /** num_instances entries, valid only during the callback. */
+  gdouble *fps;
+  gdouble *fps_avg;
   guint num_instances;
-  NvDsAppSourceDetail source_detail[MAX_SOURCE_BINS];
+  NvDsAppSourceDetail *source_detail;
   guint active_source_size;
   gboolean stream_name_display;
   gboolean use_nvmultiurisrcbin;
@@ -80,7 +81,11 @@ typedef struct
   perf_callback callback;
   GstPad *sink_bin_pad;
   gulong fps_measure_probe_id;
-  NvDsInstancePerfStruct instance_str[MAX_SOURCE_BINS];
+  /** max_instances entries allocated by @ref enable_perf_measurement. */
+  NvDsInstancePerfStruct *instance_str;
+  /** Filled by the application before @ref enable_perf_measurement: largest
+   * source id + 1 that can be measured. Raised to num_sources when smaller. */
+  guint max_instances;
   guint dewarper_surfaces_per_frame;
   GHashTable *FPSInfoHash;
   gboolean stream_name_display;
@@ -92,6 +97,8 @@ gboolean enable_perf_measurement (NvDsAppPerfStructInt *str,
     guint num_surfaces_per_frame, perf_callback callback);
 
 void pause_perf_measurement (NvDsAppPerfStructInt *str);
+/** Stop measuring and free the per-source state. */
+void destroy_perf_measurement (NvDsAppPerfStructInt *str);
 void resume_perf_measurement (NvDsAppPerfStructInt *str);
 
 #ifdef __cplusplus
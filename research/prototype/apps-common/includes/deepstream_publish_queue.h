@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __NVGSTDS_PUBLISH_QUEUE_H__
+#define __NVGSTDS_PUBLISH_QUEUE_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Upper bound of distinct priorities. Larger class priorities are clamped. */
+#define NVDS_PUBLISH_QUEUE_MAX_PRIORITIES (16)
+
+typedef enum
+{
+  /** Wait in the streaming thread until the queue has room. */
+  NVDS_PUBLISH_QUEUE_BLOCK,
+  /** Drop the oldest queued event. */
+  NVDS_PUBLISH_QUEUE_DROP_OLDEST,
+  /** Drop the oldest event of the lowest queued priority, or the new event
+   * if every queued event has a higher priority. */
+  NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY,
+} NvDsPublishQueuePolicy;
+
+typedef struct
+{
+  /** Maximum number of queued events. 0 disables the publish queue and
+   * the sink uses nvmsgbroker. */
+  guint size;
+  NvDsPublishQueuePolicy policy;
+  /** Priority of each class id; classes outside the list get 0.
+   * Higher values are kept longer by drop-lowest-priority. */
+  gint *class_priorities;
+  guint num_class_priorities;
+  /** Maximum number of events handed to the protocol adaptor and not yet
+   * completed. */
+  guint max_in_flight;
+  /** Print per-topic counters every N seconds. 0 disables. */
+  guint stats_interval;
+} NvDsPublishQueueConfig;
+
+typedef struct
+{
+  const gchar *topic;
+  guint64 enqueued;
+  guint64 sent;
+  guint64 failed;
+  guint64 dropped;
+  /** Events currently queued or in flight. */
+  guint64 depth;
+} NvDsPublishQueueTopicStats;
+
+typedef struct _NvDsPublishQueue NvDsPublishQueue;
+
+typedef void (*NvDsPublishQueueStatsFunc) (const NvDsPublishQueueTopicStats *
+    stats, gpointer user_data);
+
+/**
+ * Load @p proto_lib, start the publishing thread and connect to the broker.
+ * Connection failures are retried from the publishing thread.
+ *
+ * @return NULL if the protocol adaptor cannot be loaded.
+ */
+NvDsPublishQueue *nvds_publish_queue_new (NvDsPublishQueueConfig * config,
+    const gchar * proto_lib, const gchar * conn_str,
+    const gchar * broker_config, const gchar * topic);
+
+/**
+ * Stop the publishing thread, wait up to two seconds for the events already
+ * handed to the protocol adaptor to complete, then disconnect. Events still
+ * queued are dropped and counted; events that never complete are counted
+ * as failed.
+ */
+void nvds_publish_queue_free (NvDsPublishQueue * queue);
+
+/**
+ * Copy the NvDsPayload metas of @p buf with component id @p comp_id
+ * (0 matches all) into the queue. A payload attached to a frame takes the
+ * class priority of the NvDsEventMsgMeta it was generated from, matched by
+ * order within the frame; when the counts do not pair up it takes the
+ * highest priority of the frame. Payloads attached to the batch take the
+ * highest priority of the batch.
+ */
+void nvds_publish_queue_push_buffer (NvDsPublishQueue * queue, GstBuffer * buf,
+    guint comp_id);
+
+/**
+ * Call @p func with the counters of each topic, summed over all publish
+ * queues of the process.
+ */
+void nvds_publish_queue_foreach_stats (NvDsPublishQueueStatsFunc func,
+    gpointer user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
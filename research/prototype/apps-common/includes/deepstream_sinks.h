@@ -29,6 +29,8 @@
 
 #include <gst/gst.h>
 
+#include "deepstream_publish_queue.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -132,6 +134,8 @@ typedef struct
   gboolean  disable_msgconv;
   gint sync;
   gboolean  new_api;
+  /** publish-queue-* 설정. size가 0이면 nvmsgbroker를 사용합니다. */
+  NvDsPublishQueueConfig publish_queue;
 } NvDsSinkMsgConvBrokerConfig;
 
 typedef struct
@@ -194,6 +198,20 @@ gboolean create_demux_sink_bin (guint num_sub_bins,
 
 void set_rtsp_udp_port_num (guint rtsp_port_num, guint udp_port_num);
 
+/**
+ * Function called from the default main context when a client connects to
+ * an RTSP server started for a UDP sink (@p connected TRUE) or when that
+ * client connection is closed (@p connected FALSE).
+ */
+typedef void (*NvDsRtspClientFunc) (gboolean connected, gpointer user_data);
+
+/**
+ * Set the function notified of RTSP client connections. It applies to RTSP
+ * servers started after the call, so set it before creating sink bins.
+ * Pass NULL to unset.
+ */
+void set_rtsp_client_func (NvDsRtspClientFunc func, gpointer user_data);
+
 #ifdef __cplusplus
 }
 #endif
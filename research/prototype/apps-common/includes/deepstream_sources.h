@@ -95,6 +95,42 @@ typedef struct
 
 typedef struct NvDsSrcParentBin NvDsSrcParentBin;
 
+/**
+ * Startup state of an RTSP sub bin managed by the startup window of
+ * @ref create_multi_source_bin.
+ */
+typedef enum
+{
+  /** Not managed; started together with the pipeline. */
+  NV_DS_SOURCE_STARTUP_NONE,
+  /** Waiting in NULL with locked state for a free startup slot. */
+  NV_DS_SOURCE_STARTUP_QUEUED,
+  /** rtspsrc is running OPTIONS/DESCRIBE/SETUP. */
+  NV_DS_SOURCE_STARTUP_OPENING,
+  /** rtspsrc posted a complete "open" progress message. */
+  NV_DS_SOURCE_STARTUP_OPENED,
+  /** Open failed or did not finish within open-timeout-ms. A failed source
+   * keeps running and is left to the RTSP reconnect logic. A timed-out
+   * source is locked in NULL again and retried when a startup slot is free
+   * and no source is queued. */
+  NV_DS_SOURCE_STARTUP_FAILED,
+} NvDsSourceStartupState;
+
+typedef struct
+{
+  /** Maximum number of RTSP sources opening at the same time.
+   * 0 starts every source together with the pipeline. */
+  guint workers;
+  /** Fraction of RTSP sources that must be opened before
+   * @ref wait_for_source_quorum returns. */
+  gdouble quorum;
+  /** Upper bound of @ref wait_for_source_quorum. */
+  guint quorum_timeout_ms;
+  /** A source still opening after this long is stopped and frees its
+   * startup slot. */
+  guint open_timeout_ms;
+} NvDsSourceStartupConfig;
+
 typedef struct
 {
   GstElement *bin;
@@ -124,6 +160,13 @@ typedef struct
   gint rtsp_reconnect_interval_sec;
   gint rtsp_reconnect_attempts;
   gint num_rtsp_reconnects;
+  /** reset_source_pipeline() 누적 호출 수. num_rtsp_reconnects와 달리
+   * 재연결 성공 시에도 초기화되지 않습니다. g_atomic_int_*로 접근합니다. */
+  gint num_source_resets;
+  /** watch_source_status / smart_record_event_generator 타이머 ID.
+   * remove_source_sub_bin()에서 제거합니다. */
+  guint source_watch_id;
+  guint smart_rec_event_id;
   gboolean have_eos;
   struct timeval last_buffer_time;
   struct timeval last_reconnect_time;
@@ -150,6 +193,11 @@ typedef struct
   NvDsSourceConfig *config;
   NvDsSrcParentBin *parent_bin;
   gpointer recordCtx;
+  /** @ref NvDsSourceStartupState. Guarded by the parent's startup_lock. */
+  gint startup_state;
+  /** Monotonic time the source started opening, 0 before the parent
+   * reached PAUSED. */
+  gint64 startup_begin_us;
 } NvDsSrcBin;
 
 struct NvDsSrcParentBin
@@ -158,11 +206,25 @@ struct NvDsSrcParentBin
   GstElement *streammux;
   GstElement *nvmultiurisrcbin;
   GThread *reset_thread;
-  NvDsSrcBin sub_bins[MAX_SOURCE_BINS];
+  /** Allocated by @ref create_multi_source_bin with max_bins entries. The
+   * entries do not move until @ref destroy_multi_source_bin. */
+  NvDsSrcBin *sub_bins;
+  /** Filled by the application before @ref create_multi_source_bin: number
+   * of sub_bins slots including the ones for sources added at runtime.
+   * Raised to num_sub_bins when smaller. */
+  guint max_bins;
+  /** 사용된 sub_bins 인덱스 상한. remove_source_sub_bin() 이후에는
+   * 중간에 bin이 NULL인 빈 슬롯이 있을 수 있습니다. */
   guint num_bins;
   guint num_fr_on;
   gboolean live_source;
   gulong nvstreammux_eosmonitor_probe;
+  /** Filled by the application before @ref create_multi_source_bin. */
+  NvDsSourceStartupConfig startup_config;
+  GThread *startup_thread;
+  GMutex startup_lock;
+  GCond startup_cond;
+  gboolean startup_stop;
 };
 
 
@@ -203,6 +265,65 @@ gboolean
 create_nvmultiurisrcbin_bin (guint num_sub_bins, NvDsSourceConfig *configs,
                          NvDsSrcParentBin *bin);
 
+/**
+ * Free the sub_bins slots of @p bin. Call it after the pipeline holding the
+ * bin reached NULL state.
+ */
+void destroy_multi_source_bin (NvDsSrcParentBin *bin);
+
+/**
+ * Create a source sub bin for @p config at sub_bins[@p index] of a bin
+ * created by @ref create_multi_source_bin, link it to streammux pad
+ * sink_<index> and sync its state with the parent. Used to add sources
+ * while the pipeline is running.
+ *
+ * @param[in] bin parent bin created by create_multi_source_bin().
+ * @param[in] config source configuration. Must stay valid until the sub bin
+ *            is removed.
+ * @param[in] index unused slot index, less than bin->max_bins.
+ *
+ * @return true if the sub bin was added.
+ */
+gboolean
+add_source_sub_bin (NvDsSrcParentBin *bin, NvDsSourceConfig *config,
+                    guint index);
+
+/**
+ * Stop the sub bin at sub_bins[@p index], release its streammux pad, remove
+ * it from the parent bin and clear the slot for reuse.
+ *
+ * @return true if the sub bin was removed.
+ */
+gboolean
+remove_source_sub_bin (NvDsSrcParentBin *bin, guint index);
+
+/**
+ * Feed a message from the pipeline bus to the startup window of @p bin.
+ * Meant to be called from a "sync-message::progress" handler so that open
+ * completions are seen while the main loop is not running yet.
+ *
+ * @return true if the message belonged to a managed RTSP source.
+ */
+gboolean
+handle_source_startup_message (NvDsSrcParentBin *bin, GstMessage *message);
+
+/**
+ * Block until startup_config.quorum of the managed RTSP sources have opened,
+ * no source is left opening or startup_config.quorum_timeout_ms passed.
+ * Call it after setting the pipeline to PAUSED and before PLAYING. Sources
+ * opened later join the running pipeline through
+ * gst_element_sync_state_with_parent().
+ *
+ * @return true if the quorum was reached or no startup window is used.
+ */
+gboolean wait_for_source_quorum (NvDsSrcParentBin *bin);
+
+/**
+ * Stop the startup window thread of @p bin. Sources still queued stay in
+ * NULL.
+ */
+void stop_source_startup (NvDsSrcParentBin *bin);
+
 gboolean reset_source_pipeline (gpointer data);
 gboolean set_source_to_playing (gpointer data);
 gpointer reset_encodebin (gpointer data);
@@ -25,6 +25,8 @@
 
 #include <gst/gst.h>
 
+#include "deepstream_batch_timeout.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -56,12 +58,30 @@ typedef struct
   gboolean async_process;
   gboolean no_pipeline_eos;
   gboolean use_nvmultiurisrcbin;
+  /** Adapt batched-push-timeout to the frame arrivals (legacy muxer only).
+   * See deepstream_batch_timeout.h. */
+  gboolean adaptive_batched_push_timeout;
+  gdouble target_batch_fill;
+  /** p99 frame wait in the muxer to stay under, in microseconds. */
+  guint max_batch_latency;
+  guint min_batched_push_timeout;
+  /** Arrival trace length in milliseconds; updated every half window. */
+  guint adaptive_window;
 } NvDsStreammuxConfig;
 
 // Function to create the bin and set properties
 gboolean
 set_streammux_properties (NvDsStreammuxConfig *config, GstElement *streammux);
 
+/**
+ * Create the adaptive batched-push-timeout controller for @p config.
+ *
+ * @return NULL if adaptive-batched-push-timeout is not set or the new
+ *         nvstreammux is used, which has no batched-push-timeout.
+ */
+NvDsBatchTimeout *
+create_streammux_batch_timeout (NvDsStreammuxConfig *config);
+
 #ifdef __cplusplus
 }
 #endif
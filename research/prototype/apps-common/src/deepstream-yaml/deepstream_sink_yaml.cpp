@@ -44,6 +44,9 @@ parse_sink_yaml (NvDsSinkSubBinConfig *config, std::string group_str, gchar * cf
   config->msg_conv_broker_config.new_api = FALSE;
   config->msg_conv_broker_config.conv_msg2p_new_api = FALSE;
   config->msg_conv_broker_config.conv_frame_interval = 30;
+  config->msg_conv_broker_config.publish_queue.policy =
+      NVDS_PUBLISH_QUEUE_DROP_OLDEST;
+  config->msg_conv_broker_config.publish_queue.max_in_flight = 32;
 
   if (configyml[group_str]["enable"]) {
     gboolean val= configyml[group_str]["enable"].as<gboolean>();
@@ -168,6 +171,39 @@ parse_sink_yaml (NvDsSinkSubBinConfig *config, std::string group_str, gchar * cf
     } else if (paramKey == "new-api") {
       config->msg_conv_broker_config.new_api =
           itr->second.as<gboolean>();
+    } else if (paramKey == "publish-queue-size") {
+      config->msg_conv_broker_config.publish_queue.size =
+          itr->second.as<guint>();
+    } else if (paramKey == "publish-queue-policy") {
+      std::string temp = itr->second.as<std::string>();
+      NvDsPublishQueueConfig *queue = &config->msg_conv_broker_config.publish_queue;
+      if (temp == "block") {
+        queue->policy = NVDS_PUBLISH_QUEUE_BLOCK;
+      } else if (temp == "drop-oldest") {
+        queue->policy = NVDS_PUBLISH_QUEUE_DROP_OLDEST;
+      } else if (temp == "drop-lowest-priority") {
+        queue->policy = NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY;
+      } else {
+        g_printerr ("Error: Unknown publish-queue-policy '%s' in sink.\n",
+            temp.c_str ());
+        goto done;
+      }
+    } else if (paramKey == "publish-queue-class-priority") {
+      std::string str = itr->second.as<std::string>();
+      std::vector<std::string> vec = split_string (str);
+      int length = vec.size();
+      int *arr = (int *) malloc(length * sizeof(int));
+      for (unsigned int i = 0; i < vec.size(); i++) {
+        arr[i] = std::stoi(vec[i]);
+      }
+      config->msg_conv_broker_config.publish_queue.class_priorities = arr;
+      config->msg_conv_broker_config.publish_queue.num_class_priorities = length;
+    } else if (paramKey == "publish-queue-max-in-flight") {
+      config->msg_conv_broker_config.publish_queue.max_in_flight =
+          itr->second.as<guint>();
+    } else if (paramKey == "publish-queue-stats-interval") {
+      config->msg_conv_broker_config.publish_queue.stats_interval =
+          itr->second.as<guint>();
     } else {
       cout << "[WARNING] Unknown param found in sink: " << paramKey << endl;
     }
@@ -39,6 +39,9 @@ parse_streammux_yaml (NvDsStreammuxConfig *config, gchar *cfg_file_path)
   config->attach_sys_ts_as_ntp = TRUE;
   config->async_process = TRUE;
   config->no_pipeline_eos = FALSE;
+  config->target_batch_fill = 0.9;
+  config->min_batched_push_timeout = 1000;
+  config->adaptive_window = 2000;
 
   YAML::Node configyml = YAML::LoadFile(cfg_file_path);
   for(YAML::const_iterator itr = configyml["streammux"].begin(); itr != configyml["streammux"].end(); ++itr)
@@ -116,11 +119,35 @@ parse_streammux_yaml (NvDsStreammuxConfig *config, gchar *cfg_file_path)
     else if (paramKey == "drop-pipeline-eos")  {
       config->no_pipeline_eos = itr->second.as<gboolean>();
     }
+    else if (paramKey == "adaptive-batched-push-timeout")  {
+      config->adaptive_batched_push_timeout = itr->second.as<gboolean>();
+    }
+    else if (paramKey == "target-batch-fill")  {
+      config->target_batch_fill = itr->second.as<gdouble>();
+    }
+    else if (paramKey == "max-batch-latency")  {
+      config->max_batch_latency = itr->second.as<guint>();
+    }
+    else if (paramKey == "min-batched-push-timeout")  {
+      config->min_batched_push_timeout = itr->second.as<guint>();
+    }
+    else if (paramKey == "adaptive-window")  {
+      config->adaptive_window = itr->second.as<guint>();
+    }
     else {
       cout << "[WARNING] Unknown param found in streammux: " << paramKey << endl;
       goto done;
     }
   }
+  if (config->target_batch_fill <= 0 || config->target_batch_fill > 1) {
+    g_printerr ("Error: target-batch-fill must be in (0, 1] in streammux.\n");
+    goto done;
+  }
+  if (config->adaptive_batched_push_timeout && config->adaptive_window < 100) {
+    g_printerr ("Error: adaptive-window must be at least 100 ms in "
+        "streammux.\n");
+    goto done;
+  }
   config->is_parsed = TRUE;
 
   ret = TRUE;
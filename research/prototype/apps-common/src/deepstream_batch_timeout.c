@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "deepstream_batch_timeout.h"
+
+/** 보관하는 최근 도착 수. 넘치면 창이 그만큼 짧아집니다. */
+#define ARRIVAL_RING_SIZE (16384)
+/** 제거된 소스의 도착 표시 */
+#define REMOVED_SOURCE G_MAXUINT
+#define NO_ARRIVAL G_MAXUINT
+/** 이 비율보다 작은 변경은 무시합니다. */
+#define MIN_CHANGE_RATIO (0.1)
+/** 이분 탐색을 멈추는 timeout 간격 (us) */
+#define SEARCH_RESOLUTION_US (500)
+
+struct _NvDsBatchTimeout
+{
+  NvDsBatchTimeoutConfig config;
+  GMutex lock;
+  NvDsBatchArrival *ring;
+  guint ring_head;
+  guint ring_count;
+
+  gint timeout_us;
+  NvDsBatchReplay predicted;
+  guint capacity;
+  /** 누적 배치 수와 마지막 갱신 이후 배치의 프레임 수 */
+  guint64 batches;
+  guint64 batch_frames;
+  guint64 last_batches;
+  guint64 period_batches;
+  gdouble achieved_fill;
+};
+
+/* 재생용 도착 목록. next[i]는 같은 소스의 다음 도착 인덱스입니다. */
+typedef struct
+{
+  const NvDsBatchArrival *arrivals;
+  guint num_arrivals;
+  guint *next;
+  guint *first;
+  guint num_sources;
+  gint64 end_us;
+} BatchTrace;
+
+typedef struct
+{
+  gint64 ts_us;
+  guint source;
+} BatchCandidate;
+
+static void
+trace_init (BatchTrace * trace, const NvDsBatchArrival * arrivals,
+    guint num_arrivals)
+{
+  GHashTable *dense = g_hash_table_new (g_direct_hash, g_direct_equal);
+  guint *last = g_new (guint, num_arrivals + 1);
+  guint i;
+
+  memset (trace, 0, sizeof (BatchTrace));
+  trace->arrivals = arrivals;
+  trace->num_arrivals = num_arrivals;
+  trace->next = g_new (guint, num_arrivals + 1);
+  trace->first = g_new (guint, num_arrivals + 1);
+  for (i = 0; i < num_arrivals; i++) {
+    gpointer value = NULL;
+    guint s;
+
+    trace->next[i] = NO_ARRIVAL;
+    if (g_hash_table_lookup_extended (dense,
+            GUINT_TO_POINTER (arrivals[i].source_id), NULL, &value)) {
+      s = GPOINTER_TO_UINT (value);
+      trace->next[last[s]] = i;
+    } else {
+      s = trace->num_sources++;
+      g_hash_table_insert (dense, GUINT_TO_POINTER (arrivals[i].source_id),
+          GUINT_TO_POINTER (s));
+      trace->first[s] = i;
+    }
+    last[s] = i;
+    trace->end_us = MAX (trace->end_us, arrivals[i].ts_us);
+  }
+
+  g_free (last);
+  g_hash_table_destroy (dense);
+}
+
+static void
+trace_clear (BatchTrace * trace)
+{
+  g_free (trace->next);
+  g_free (trace->first);
+}
+
+static gint
+compare_candidate (gconstpointer a, gconstpointer b)
+{
+  gint64 ta = ((const BatchCandidate *) a)->ts_us;
+  gint64 tb = ((const BatchCandidate *) b)->ts_us;
+
+  return ta < tb ? -1 : ta > tb;
+}
+
+static gint
+compare_double (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db;
+}
+
+/*
+ * legacy nvstreammux의 배치 구성을 재생합니다. 배치는 첫 프레임이 준비된
+ * 시각(이전 push 이후)에 시작하고, 서로 다른 capacity개 소스의 프레임이
+ * 모이거나 timeout이 지나면 push됩니다. 한 배치에는 소스당 한 프레임만
+ * 들어가고 나머지는 다음 배치를 기다립니다.
+ */
+static void
+trace_replay (BatchTrace * trace, guint capacity, gint timeout_us,
+    NvDsBatchReplay * result)
+{
+  const NvDsBatchArrival *arrivals = trace->arrivals;
+  guint *heads = g_new (guint, trace->num_sources + 1);
+  BatchCandidate *candidates = g_new (BatchCandidate, trace->num_sources + 1);
+  gdouble *waits = g_new (gdouble, trace->num_arrivals + 1);
+  gint64 last_push = G_MININT64;
+  guint num_waits = 0;
+  guint s, j;
+
+  memset (result, 0, sizeof (NvDsBatchReplay));
+  memcpy (heads, trace->first, trace->num_sources * sizeof (guint));
+  capacity = MAX (capacity, 1);
+
+  while (TRUE) {
+    gint64 start = G_MAXINT64, deadline, push;
+    guint k = 0;
+
+    for (s = 0; s < trace->num_sources; s++) {
+      if (heads[s] != NO_ARRIVAL)
+        start = MIN (start, arrivals[heads[s]].ts_us);
+    }
+    if (start == G_MAXINT64)
+      break;
+    start = MAX (start, last_push);
+    deadline = start + MAX (timeout_us, 0);
+    if (deadline > trace->end_us)
+      break;
+
+    for (s = 0; s < trace->num_sources; s++) {
+      if (heads[s] != NO_ARRIVAL && arrivals[heads[s]].ts_us <= deadline) {
+        candidates[k].ts_us = arrivals[heads[s]].ts_us;
+        candidates[k].source = s;
+        k++;
+      }
+    }
+    if (k >= capacity) {
+      qsort (candidates, k, sizeof (BatchCandidate), compare_candidate);
+      k = capacity;
+      push = MAX (start, candidates[k - 1].ts_us);
+    } else {
+      push = deadline;
+    }
+
+    for (j = 0; j < k; j++) {
+      waits[num_waits++] = push - candidates[j].ts_us;
+      heads[candidates[j].source] = trace->next[heads[candidates[j].source]];
+    }
+    result->num_batches++;
+    result->num_frames += k;
+    last_push = push;
+  }
+
+  if (result->num_batches)
+    result->fill = (gdouble) result->num_frames /
+        ((gdouble) result->num_batches * capacity);
+  if (num_waits) {
+    qsort (waits, num_waits, sizeof (gdouble), compare_double);
+    result->p99_wait_us = waits[MIN (num_waits - 1,
+            (guint) (num_waits * 0.99))];
+  }
+
+  g_free (waits);
+  g_free (candidates);
+  g_free (heads);
+}
+
+void
+nvds_batch_timeout_replay (const NvDsBatchArrival * arrivals,
+    guint num_arrivals, guint batch_size, gint timeout_us,
+    NvDsBatchReplay * result)
+{
+  BatchTrace trace;
+
+  trace_init (&trace, arrivals, num_arrivals);
+  trace_replay (&trace, MIN (batch_size, trace.num_sources), timeout_us,
+      result);
+  trace_clear (&trace);
+}
+
+/*
+ * fill은 timeout에 대해, p99 대기는 timeout에 대해 대체로 증가하므로
+ * 각각 이분 탐색합니다. target-fill을 만족하는 가장 작은 timeout을 찾고,
+ * 그 timeout의 p99 대기가 max-latency를 넘으면 넘지 않는 가장 큰 timeout으로
+ * 낮춥니다.
+ */
+static gint
+trace_select (NvDsBatchTimeoutConfig * config, BatchTrace * trace,
+    NvDsBatchReplay * result)
+{
+  guint capacity = MIN (config->batch_size, trace->num_sources);
+  gint low = MIN (config->min_timeout_us, config->max_latency_us);
+  gint high = config->max_latency_us;
+  gint timeout;
+  NvDsBatchReplay replay;
+
+  if (trace->num_sources < 2)
+    return -1;
+
+  trace_replay (trace, capacity, high, &replay);
+  if (replay.fill >= config->target_fill) {
+    trace_replay (trace, capacity, low, &replay);
+    if (replay.fill >= config->target_fill) {
+      high = low;
+    } else {
+      while (high - low > SEARCH_RESOLUTION_US) {
+        gint mid = low + (high - low) / 2;
+
+        trace_replay (trace, capacity, mid, &replay);
+        if (replay.fill >= config->target_fill)
+          high = mid;
+        else
+          low = mid;
+      }
+    }
+  }
+  timeout = high;
+
+  trace_replay (trace, capacity, timeout, result);
+  if (result->p99_wait_us > config->max_latency_us) {
+    low = MIN (config->min_timeout_us, timeout);
+    high = timeout;
+    while (high - low > SEARCH_RESOLUTION_US) {
+      gint mid = low + (high - low) / 2;
+
+      trace_replay (trace, capacity, mid, &replay);
+      if (replay.p99_wait_us <= config->max_latency_us)
+        low = mid;
+      else
+        high = mid;
+    }
+    timeout = low;
+    trace_replay (trace, capacity, timeout, result);
+  }
+
+  return timeout;
+}
+
+gint
+nvds_batch_timeout_select (NvDsBatchTimeoutConfig * config,
+    const NvDsBatchArrival * arrivals, guint num_arrivals,
+    NvDsBatchReplay * result)
+{
+  BatchTrace trace;
+  gint timeout;
+
+  trace_init (&trace, arrivals, num_arrivals);
+  timeout = trace_select (config, &trace, result);
+  trace_clear (&trace);
+  return timeout;
+}
+
+NvDsBatchTimeout *
+nvds_batch_timeout_new (NvDsBatchTimeoutConfig * config,
+    gint initial_timeout_us)
+{
+  NvDsBatchTimeout *ctl = g_new0 (NvDsBatchTimeout, 1);
+
+  ctl->config = *config;
+  if (ctl->config.max_latency_us == 0)
+    ctl->config.max_latency_us = MAX (initial_timeout_us, 1);
+  ctl->config.target_fill = CLAMP (config->target_fill, 0, 1);
+  g_mutex_init (&ctl->lock);
+  ctl->ring = g_new0 (NvDsBatchArrival, ARRIVAL_RING_SIZE);
+  ctl->timeout_us = initial_timeout_us;
+  ctl->capacity = MAX (config->batch_size, 1);
+  return ctl;
+}
+
+void
+nvds_batch_timeout_free (NvDsBatchTimeout * ctl)
+{
+  if (!ctl)
+    return;
+
+  g_mutex_clear (&ctl->lock);
+  g_free (ctl->ring);
+  g_free (ctl);
+}
+
+void
+nvds_batch_timeout_record_arrival (NvDsBatchTimeout * ctl, guint source_id,
+    gint64 now_us)
+{
+  guint index;
+
+  g_mutex_lock (&ctl->lock);
+  index = (ctl->ring_head + ctl->ring_count) % ARRIVAL_RING_SIZE;
+  ctl->ring[index].ts_us = now_us;
+  ctl->ring[index].source_id = source_id;
+  if (ctl->ring_count < ARRIVAL_RING_SIZE)
+    ctl->ring_count++;
+  else
+    ctl->ring_head = (ctl->ring_head + 1) % ARRIVAL_RING_SIZE;
+  g_mutex_unlock (&ctl->lock);
+}
+
+void
+nvds_batch_timeout_record_batch (NvDsBatchTimeout * ctl, guint num_frames)
+{
+  g_mutex_lock (&ctl->lock);
+  ctl->batches++;
+  ctl->batch_frames += num_frames;
+  g_mutex_unlock (&ctl->lock);
+}
+
+void
+nvds_batch_timeout_remove_source (NvDsBatchTimeout * ctl, guint source_id)
+{
+  guint i;
+
+  g_mutex_lock (&ctl->lock);
+  for (i = 0; i < ctl->ring_count; i++) {
+    NvDsBatchArrival *arrival =
+        &ctl->ring[(ctl->ring_head + i) % ARRIVAL_RING_SIZE];
+    if (arrival->source_id == source_id)
+      arrival->source_id = REMOVED_SOURCE;
+  }
+  g_mutex_unlock (&ctl->lock);
+}
+
+static gint
+compare_arrival (gconstpointer a, gconstpointer b)
+{
+  gint64 ta = ((const NvDsBatchArrival *) a)->ts_us;
+  gint64 tb = ((const NvDsBatchArrival *) b)->ts_us;
+
+  return ta < tb ? -1 : ta > tb;
+}
+
+gboolean
+nvds_batch_timeout_update (NvDsBatchTimeout * ctl, gint64 now_us,
+    gint * timeout_us)
+{
+  gint64 window_start = now_us - (gint64) ctl->config.window_ms * 1000;
+  NvDsBatchArrival *arrivals = NULL;
+  guint num_arrivals = 0;
+  guint64 batches, frames;
+  NvDsBatchReplay replay;
+  BatchTrace trace;
+  gboolean changed = FALSE;
+  gint timeout;
+  guint i;
+
+  /* 스트리밍 스레드를 막지 않도록 창 안의 도착만 복사한 뒤 잠금 밖에서
+   * 재생합니다. */
+  g_mutex_lock (&ctl->lock);
+  arrivals = g_new (NvDsBatchArrival, ctl->ring_count + 1);
+  for (i = 0; i < ctl->ring_count; i++) {
+    NvDsBatchArrival *arrival =
+        &ctl->ring[(ctl->ring_head + i) % ARRIVAL_RING_SIZE];
+    if (arrival->ts_us >= window_start && arrival->source_id != REMOVED_SOURCE)
+      arrivals[num_arrivals++] = *arrival;
+  }
+  batches = ctl->batches - ctl->last_batches;
+  frames = ctl->batch_frames;
+  ctl->last_batches = ctl->batches;
+  ctl->batch_frames = 0;
+  g_mutex_unlock (&ctl->lock);
+
+  /* 시각은 잠금 전에 읽으므로 스레드 간 순서가 약간 뒤바뀔 수 있습니다. */
+  qsort (arrivals, num_arrivals, sizeof (NvDsBatchArrival), compare_arrival);
+  trace_init (&trace, arrivals, num_arrivals);
+  timeout = trace_select (&ctl->config, &trace, &replay);
+
+  g_mutex_lock (&ctl->lock);
+  ctl->capacity = MAX (MIN (ctl->config.batch_size, trace.num_sources), 1);
+  ctl->period_batches = batches;
+  ctl->achieved_fill = batches ?
+      (gdouble) frames / ((gdouble) batches * ctl->capacity) : 0;
+  if (timeout >= 0) {
+    ctl->predicted = replay;
+    if (ABS (timeout - ctl->timeout_us) >
+        ctl->timeout_us * MIN_CHANGE_RATIO) {
+      ctl->timeout_us = timeout;
+      changed = TRUE;
+    }
+  }
+  *timeout_us = ctl->timeout_us;
+  g_mutex_unlock (&ctl->lock);
+
+  trace_clear (&trace);
+  g_free (arrivals);
+  return changed;
+}
+
+void
+nvds_batch_timeout_get_stats (NvDsBatchTimeout * ctl,
+    NvDsBatchTimeoutStats * stats)
+{
+  g_mutex_lock (&ctl->lock);
+  stats->timeout_us = ctl->timeout_us;
+  stats->predicted = ctl->predicted;
+  stats->num_batches = ctl->period_batches;
+  stats->achieved_fill = ctl->achieved_fill;
+  g_mutex_unlock (&ctl->lock);
+}
@@ -86,6 +86,10 @@ subscribe_cb (NvMsgBrokerErrorType flag, void *msg, int msg_len, char *topic,
           sensorId = atoi (msgSR->sensorStr);
         }
 
+        if (sensorId < 0 || (guint) sensorId >= pBin->max_bins) {
+          NVGSTDS_WARN_MSG_V ("%s: Sensor id out of range", msgSR->sensorStr);
+          goto error;
+        }
         srCtx = (NvDsSRContext *) pBin->sub_bins[sensorId].recordCtx;
         if (!srCtx) {
           NVGSTDS_WARN_MSG_V ("Null SR context handle.");
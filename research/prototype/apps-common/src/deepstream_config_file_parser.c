@@ -22,6 +22,7 @@
 
 #include "deepstream_common.h"
 #include "deepstream_config_file_parser.h"
+#include "deepstream_label_table.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -392,6 +393,19 @@ parse_labels_file (NvDsGieConfig * config)
   g_list_free (labels_list);
   g_list_free (label_outputs_length_list);
 
+  /* 분류 결과를 문자열 복사 없이 라벨 id로 다룰 수 있도록 등록합니다.
+   * unique-id가 없으면 nvinfer 설정이 id를 정하므로 문자열만 등록합니다. */
+  if (config->is_unique_id_set) {
+    nvds_label_table_add_gie (config->unique_id, config->n_labels,
+        config->n_label_outputs, config->labels);
+  } else {
+    for (j = 0; j < config->n_labels; j++) {
+      guint k;
+      for (k = 0; k < config->n_label_outputs[j]; k++)
+        nvds_label_table_intern (config->labels[j][k]);
+    }
+  }
+
 done:
   return ret;
 }
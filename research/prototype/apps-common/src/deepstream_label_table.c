@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "deepstream_common.h"
+#include "deepstream_label_table.h"
+
+/** 라벨 파일 하나의 (label_id, result_class_id) -> 라벨 id 인덱스 */
+typedef struct
+{
+  guint n_labels;
+  guint *n_label_outputs;
+  guint **ids;
+} NvDsGieLabels;
+
+/*
+ * 라벨은 파이프라인 시작 전 설정 파싱에서 대부분 등록되고 이후에는 조회만 하므로
+ * GRWLock으로 읽기끼리는 경합하지 않게 합니다.
+ * 문자열은 GStringChunk에 보관하며 해제하지 않습니다.
+ */
+static GRWLock table_lock;
+static GStringChunk *label_chunk = NULL;
+/** 라벨 문자열(label_chunk 소유) -> id */
+static GHashTable *label_ids = NULL;
+/** id -> 라벨 문자열. 0번은 NULL */
+static GPtrArray *label_names = NULL;
+/** GIE unique id -> NvDsGieLabels */
+static GHashTable *gie_labels = NULL;
+static guint64 runtime_inserts = 0;
+static gboolean full_warned = FALSE;
+
+static void
+gie_labels_free (gpointer data)
+{
+  NvDsGieLabels *gie = (NvDsGieLabels *) data;
+  guint i;
+
+  for (i = 0; i < gie->n_labels; i++)
+    g_free (gie->ids[i]);
+  g_free (gie->ids);
+  g_free (gie->n_label_outputs);
+  g_free (gie);
+}
+
+/* table_lock을 쓰기로 잡은 상태에서 호출합니다. */
+static void
+ensure_tables (void)
+{
+  if (label_ids)
+    return;
+
+  label_chunk = g_string_chunk_new (4096);
+  label_ids = g_hash_table_new (g_str_hash, g_str_equal);
+  label_names = g_ptr_array_new ();
+  g_ptr_array_add (label_names, NULL);
+  gie_labels = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      gie_labels_free);
+}
+
+/* table_lock을 읽기 또는 쓰기로 잡은 상태에서 호출합니다. */
+static guint
+find_locked (const gchar * label)
+{
+  if (!label_ids)
+    return 0;
+  return GPOINTER_TO_UINT (g_hash_table_lookup (label_ids, label));
+}
+
+/* table_lock을 쓰기로 잡은 상태에서 호출합니다. */
+static guint
+intern_locked (const gchar * label)
+{
+  gchar *name;
+  guint id;
+
+  ensure_tables ();
+  id = find_locked (label);
+  if (id)
+    return id;
+
+  if (label_names->len > NVDS_LABEL_TABLE_MAX_LABELS) {
+    if (!full_warned) {
+      NVGSTDS_WARN_MSG_V ("Label table is full (%d labels), '%s' and later "
+          "labels are dropped", NVDS_LABEL_TABLE_MAX_LABELS, label);
+      full_warned = TRUE;
+    }
+    return 0;
+  }
+
+  name = g_string_chunk_insert (label_chunk, label);
+  id = label_names->len;
+  g_ptr_array_add (label_names, name);
+  g_hash_table_insert (label_ids, name, GUINT_TO_POINTER (id));
+  return id;
+}
+
+guint
+nvds_label_table_intern (const gchar * label)
+{
+  guint id;
+
+  if (!label || label[0] == '\0')
+    return 0;
+
+  g_rw_lock_reader_lock (&table_lock);
+  id = find_locked (label);
+  g_rw_lock_reader_unlock (&table_lock);
+  if (id)
+    return id;
+
+  g_rw_lock_writer_lock (&table_lock);
+  id = intern_locked (label);
+  g_rw_lock_writer_unlock (&table_lock);
+  return id;
+}
+
+guint
+nvds_label_table_find (const gchar * label)
+{
+  guint id;
+
+  if (!label || label[0] == '\0')
+    return 0;
+
+  g_rw_lock_reader_lock (&table_lock);
+  id = find_locked (label);
+  g_rw_lock_reader_unlock (&table_lock);
+  return id;
+}
+
+const gchar *
+nvds_label_table_name (guint id)
+{
+  const gchar *name = NULL;
+
+  g_rw_lock_reader_lock (&table_lock);
+  if (label_names && id < label_names->len)
+    name = (const gchar *) g_ptr_array_index (label_names, id);
+  g_rw_lock_reader_unlock (&table_lock);
+  return name;
+}
+
+void
+nvds_label_table_add_gie (guint gie_id, guint n_labels,
+    const guint * n_label_outputs, gchar *** labels)
+{
+  NvDsGieLabels *gie = NULL;
+  guint i, j;
+
+  g_rw_lock_writer_lock (&table_lock);
+  ensure_tables ();
+
+  gie = g_new0 (NvDsGieLabels, 1);
+  gie->n_labels = n_labels;
+  gie->n_label_outputs = g_new0 (guint, n_labels);
+  gie->ids = g_new0 (guint *, n_labels);
+  for (i = 0; i < n_labels; i++) {
+    gie->n_label_outputs[i] = n_label_outputs[i];
+    gie->ids[i] = g_new0 (guint, n_label_outputs[i]);
+    for (j = 0; j < n_label_outputs[i]; j++) {
+      if (labels[i][j] && labels[i][j][0] != '\0')
+        gie->ids[i][j] = intern_locked (labels[i][j]);
+    }
+  }
+  g_hash_table_replace (gie_labels, GUINT_TO_POINTER (gie_id), gie);
+
+  g_rw_lock_writer_unlock (&table_lock);
+}
+
+guint
+nvds_label_table_classifier_label (guint gie_id, const NvDsLabelInfo * info)
+{
+  const gchar *label = info->pResult_label ? info->pResult_label :
+      info->result_label;
+  NvDsGieLabels *gie = NULL;
+  guint id = 0;
+
+  if (label[0] == '\0')
+    return 0;
+
+  g_rw_lock_reader_lock (&table_lock);
+  if (gie_labels)
+    gie = (NvDsGieLabels *) g_hash_table_lookup (gie_labels,
+        GUINT_TO_POINTER (gie_id));
+  if (gie && info->label_id < gie->n_labels &&
+      info->result_class_id < gie->n_label_outputs[info->label_id]) {
+    id = gie->ids[info->label_id][info->result_class_id];
+    /* nvinfer 설정의 라벨 파일이 앱 설정과 다를 수 있으므로 문자열을 확인합니다. */
+    if (id && strcmp ((const gchar *) g_ptr_array_index (label_names, id),
+            label) != 0)
+      id = 0;
+  }
+  if (!id)
+    id = find_locked (label);
+  g_rw_lock_reader_unlock (&table_lock);
+  if (id)
+    return id;
+
+  /* 등록된 라벨 파일에 없는 라벨은 처음 한 번만 추가합니다. */
+  g_rw_lock_writer_lock (&table_lock);
+  id = find_locked (label);
+  if (!id) {
+    id = intern_locked (label);
+    if (id)
+      runtime_inserts++;
+  }
+  g_rw_lock_writer_unlock (&table_lock);
+  return id;
+}
+
+guint
+nvds_label_table_first_result (const NvDsClassifierMeta * classifier_meta)
+{
+  GList *l;
+
+  for (l = classifier_meta->label_info_list; l != NULL; l = l->next) {
+    NvDsLabelInfo *label_info = (NvDsLabelInfo *) l->data;
+    guint id = nvds_label_table_classifier_label
+        (classifier_meta->unique_component_id, label_info);
+
+    if (id)
+      return id;
+  }
+  return 0;
+}
+
+guint
+nvds_label_table_size (void)
+{
+  guint size = 0;
+
+  g_rw_lock_reader_lock (&table_lock);
+  if (label_names)
+    size = label_names->len - 1;
+  g_rw_lock_reader_unlock (&table_lock);
+  return size;
+}
+
+guint64
+nvds_label_table_runtime_inserts (void)
+{
+  guint64 inserts;
+
+  g_rw_lock_reader_lock (&table_lock);
+  inserts = runtime_inserts;
+  g_rw_lock_reader_unlock (&table_lock);
+  return inserts;
+}
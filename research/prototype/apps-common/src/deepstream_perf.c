@@ -51,7 +51,11 @@ sink_bin_buf_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
     for (NvDsMetaList * l_frame = batch_meta->frame_meta_list; l_frame;
         l_frame = l_frame->next) {
       NvDsFrameMeta *frame_meta = (NvDsFrameMeta *) l_frame->data;
-      NvDsInstancePerfStruct *str1 = &str->instance_str[frame_meta->pad_index];
+      NvDsInstancePerfStruct *str1 = NULL;
+
+      if (frame_meta->pad_index >= str->max_instances)
+        continue;
+      str1 = &str->instance_str[frame_meta->pad_index];
       gettimeofday (&str1->last_fps_time, NULL);
       if (str1->start_fps_time.tv_sec == 0 && str1->start_fps_time.tv_usec == 0) {
         str1->start_fps_time = str1->last_fps_time;
@@ -68,15 +72,21 @@ static gboolean
 perf_measurement_callback (gpointer data)
 {
   NvDsAppPerfStructInt *str = (NvDsAppPerfStructInt *) data;
-  guint buffer_cnt[MAX_SOURCE_BINS];
+  guint *buffer_cnt = NULL;
   NvDsAppPerfStruct perf_struct;
   struct timeval current_fps_time;
   guint i;
   g_mutex_lock (&str->struct_lock);
   if (str->stop) {
+    /* 타이머가 제거되므로 resume_perf_measurement()가 다시 등록하게 합니다. */
+    str->perf_measurement_timeout_id = 0;
     g_mutex_unlock (&str->struct_lock);
     return FALSE;
   }
+  buffer_cnt = g_new0 (guint, str->max_instances);
+  perf_struct.fps = g_new0 (gdouble, str->max_instances);
+  perf_struct.fps_avg = g_new0 (gdouble, str->max_instances);
+  perf_struct.source_detail = g_new0 (NvDsAppSourceDetail, str->max_instances);
   perf_struct.use_nvmultiurisrcbin = str->use_nvmultiurisrcbin;
   perf_struct.stream_name_display = str->stream_name_display;
   /*if (str->use_nvmultiurisrcbin) {
@@ -111,6 +121,8 @@ perf_measurement_callback (gpointer data)
 
     for (guint j = 0; j < g_hash_table_size(str->FPSInfoHash); j++){
       i = perf_struct.source_detail[j].source_id;
+      if (i >= str->max_instances)
+        continue;
       buffer_cnt[i] =
         str->instance_str[i].buffer_cnt / str->dewarper_surfaces_per_frame;
       str->instance_str[i].buffer_cnt = 0;
@@ -160,6 +172,8 @@ perf_measurement_callback (gpointer data)
   } else {
     for (guint j = 0; j < g_hash_table_size(str->FPSInfoHash); j++){
       i = perf_struct.source_detail[j].source_id;
+      if (i >= str->max_instances)
+        continue;
       NvDsInstancePerfStruct *str1 = &str->instance_str[i];
       gdouble time1 =
         (str1->total_fps_time.tv_sec +
@@ -201,6 +215,10 @@ perf_measurement_callback (gpointer data)
 
   str->callback (str->context, &perf_struct);
 
+  g_free (buffer_cnt);
+  g_free (perf_struct.fps);
+  g_free (perf_struct.fps_avg);
+  g_free (perf_struct.source_detail);
   return TRUE;
 }
 
@@ -258,13 +276,13 @@ enable_perf_measurement (NvDsAppPerfStructInt * str,
     GstPad * sink_bin_pad, guint num_sources,
     gulong interval_sec, guint num_surfaces_per_frame, perf_callback callback)
 {
-  guint i;
-
   if (!callback) {
     return FALSE;
   }
 
   str->num_instances = num_sources;
+  str->max_instances = MAX (str->max_instances, num_sources);
+  str->instance_str = g_new0 (NvDsInstancePerfStruct, str->max_instances);
 
   str->measurement_interval_ms = interval_sec * 1000;
   str->callback = callback;
@@ -276,9 +294,6 @@ enable_perf_measurement (NvDsAppPerfStructInt * str,
     str->dewarper_surfaces_per_frame = 1;
   }
 
-  for (i = 0; i < num_sources; i++) {
-    str->instance_str[i].buffer_cnt = 0;
-  }
   str->sink_bin_pad = sink_bin_pad;
   str->fps_measure_probe_id =
       gst_pad_add_probe (sink_bin_pad, GST_PAD_PROBE_TYPE_BUFFER,
@@ -288,3 +303,20 @@ enable_perf_measurement (NvDsAppPerfStructInt * str,
 
   return TRUE;
 }
+
+void
+destroy_perf_measurement (NvDsAppPerfStructInt * str)
+{
+  pause_perf_measurement (str);
+
+  g_mutex_lock (&str->struct_lock);
+  if (str->perf_measurement_timeout_id) {
+    g_source_remove (str->perf_measurement_timeout_id);
+    str->perf_measurement_timeout_id = 0;
+  }
+  g_free (str->instance_str);
+  str->instance_str = NULL;
+  str->max_instances = 0;
+  str->num_instances = 0;
+  g_mutex_unlock (&str->struct_lock);
+}
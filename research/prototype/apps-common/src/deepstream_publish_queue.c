@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include "deepstream_common.h"
+#include "deepstream_publish_queue.h"
+#include "gstnvdsmeta.h"
+#include "nvdsmeta_schema.h"
+#include "nvds_msgapi.h"
+
+/** 보낼 이벤트가 없어도 이 주기로 do_work를 호출합니다. */
+#define DO_WORK_INTERVAL_US (10 * 1000)
+#define CONNECT_RETRY_INTERVAL_US (G_USEC_PER_SEC)
+/** 해제할 때 어댑터에 넘긴 이벤트의 완료 콜백을 기다리는 최대 시간 */
+#define DRAIN_TIMEOUT_US (2 * G_USEC_PER_SEC)
+
+typedef NvDsMsgApiHandle (*nvds_msgapi_connect_ptr) (char *connection_str,
+    nvds_msgapi_connect_cb_t connect_cb, char *config_path);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_ptr) (NvDsMsgApiHandle
+    h_ptr, char *topic, const uint8_t * payload, size_t nbuf,
+    nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+typedef void (*nvds_msgapi_do_work_ptr) (NvDsMsgApiHandle h_ptr);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_disconnect_ptr) (NvDsMsgApiHandle
+    h_ptr);
+
+typedef struct
+{
+  NvDsPublishQueue *queue;
+  guint8 *data;
+  gsize len;
+  gint priority;
+  guint64 seq;
+} NvDsPublishItem;
+
+struct _NvDsPublishQueue
+{
+  NvDsPublishQueueConfig config;
+  gchar *conn_str;
+  gchar *broker_config;
+  gchar *topic;
+
+  void *lib_handle;
+  nvds_msgapi_connect_ptr connect;
+  nvds_msgapi_send_async_ptr send_async;
+  nvds_msgapi_do_work_ptr do_work;
+  nvds_msgapi_disconnect_ptr disconnect;
+  /** 발행 스레드에서만 바꾸고, 대기 조건을 위해 lock 안에서 씁니다. */
+  NvDsMsgApiHandle handle;
+
+  GMutex lock;
+  GCond cond;
+  /** 우선순위별 FIFO. 보낼 때는 seq가 가장 작은(가장 오래된) 항목을 꺼냅니다. */
+  GQueue levels[NVDS_PUBLISH_QUEUE_MAX_PRIORITIES];
+  guint length;
+  guint in_flight;
+  guint64 next_seq;
+  gboolean stop;
+  GThread *thread;
+
+  guint64 enqueued;
+  guint64 sent;
+  guint64 failed;
+  guint64 dropped;
+};
+
+static GMutex registry_lock;
+static GList *registry = NULL;
+
+static void
+free_item (NvDsPublishItem * item)
+{
+  g_free (item->data);
+  g_free (item);
+}
+
+static gint
+class_priority (NvDsPublishQueueConfig * config, gint class_id)
+{
+  if (class_id < 0 || (guint) class_id >= config->num_class_priorities)
+    return 0;
+  return CLAMP (config->class_priorities[class_id], 0,
+      NVDS_PUBLISH_QUEUE_MAX_PRIORITIES - 1);
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static GQueue *
+oldest_level (NvDsPublishQueue * queue)
+{
+  GQueue *oldest = NULL;
+  guint i;
+
+  for (i = 0; i < NVDS_PUBLISH_QUEUE_MAX_PRIORITIES; i++) {
+    NvDsPublishItem *head =
+        (NvDsPublishItem *) g_queue_peek_head (&queue->levels[i]);
+    if (head && (!oldest ||
+            head->seq < ((NvDsPublishItem *) g_queue_peek_head (oldest))->seq))
+      oldest = &queue->levels[i];
+  }
+  return oldest;
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static NvDsPublishItem *
+pop_from (NvDsPublishQueue * queue, GQueue * level)
+{
+  NvDsPublishItem *item = (NvDsPublishItem *) g_queue_pop_head (level);
+
+  queue->length--;
+  return item;
+}
+
+/*
+ * lock을 잡은 상태에서 호출합니다. 큐가 가득 찼을 때 정책에 따라 자리를 만듭니다.
+ * 새 이벤트를 버려야 하면 FALSE를 반환합니다.
+ */
+static gboolean
+make_room (NvDsPublishQueue * queue, gint priority)
+{
+  GQueue *victim = NULL;
+  guint i;
+
+  switch (queue->config.policy) {
+    case NVDS_PUBLISH_QUEUE_BLOCK:
+      while (queue->length >= queue->config.size && !queue->stop)
+        g_cond_wait (&queue->cond, &queue->lock);
+      return !queue->stop;
+    case NVDS_PUBLISH_QUEUE_DROP_OLDEST:
+      victim = oldest_level (queue);
+      break;
+    case NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY:
+      for (i = 0; i <= (guint) priority && !victim; i++) {
+        if (!g_queue_is_empty (&queue->levels[i]))
+          victim = &queue->levels[i];
+      }
+      if (!victim)
+        return FALSE;
+      break;
+  }
+
+  free_item (pop_from (queue, victim));
+  queue->dropped++;
+  return TRUE;
+}
+
+static void
+push (NvDsPublishQueue * queue, const guint8 * data, gsize len, gint priority)
+{
+  NvDsPublishItem *item = NULL;
+
+  g_mutex_lock (&queue->lock);
+  if (queue->length >= queue->config.size && !make_room (queue, priority)) {
+    queue->dropped++;
+    g_mutex_unlock (&queue->lock);
+    return;
+  }
+
+  item = g_new (NvDsPublishItem, 1);
+  item->queue = queue;
+  item->data = (guint8 *) g_memdup2 (data, len);
+  item->len = len;
+  item->priority = priority;
+  item->seq = queue->next_seq++;
+  g_queue_push_tail (&queue->levels[priority], item);
+  queue->length++;
+  queue->enqueued++;
+  g_cond_broadcast (&queue->cond);
+  g_mutex_unlock (&queue->lock);
+}
+
+static gint
+event_priority (NvDsPublishQueue * queue, NvDsUserMeta * user_meta)
+{
+  NvDsEventMsgMeta *meta = (NvDsEventMsgMeta *) user_meta->user_meta_data;
+
+  return meta ? class_priority (&queue->config, meta->objClassId) : 0;
+}
+
+/* l부터(NULL이면 head부터) 다음 이벤트 메타를 찾고, 끝에 닿으면 head부터 다시 찾습니다. */
+static NvDsMetaList *
+next_event_meta (NvDsMetaList * l, NvDsMetaList * head)
+{
+  NvDsMetaList *start = l ? l : head;
+
+  for (l = start; l; l = l->next) {
+    if (((NvDsUserMeta *) l->data)->base_meta.meta_type == NVDS_EVENT_MSG_META)
+      return l;
+  }
+  for (l = head; l != start; l = l->next) {
+    if (((NvDsUserMeta *) l->data)->base_meta.meta_type == NVDS_EVENT_MSG_META)
+      return l;
+  }
+  return NULL;
+}
+
+static void
+push_payload (NvDsPublishQueue * queue, NvDsUserMeta * user_meta,
+    guint comp_id, gint priority)
+{
+  NvDsPayload *payload = (NvDsPayload *) user_meta->user_meta_data;
+
+  if (!payload || !payload->payload || !payload->payloadSize)
+    return;
+  if (comp_id && payload->componentId != comp_id)
+    return;
+  push (queue, (const guint8 *) payload->payload, payload->payloadSize,
+      priority);
+}
+
+/*
+ * 프레임에 붙은 payload는 같은 프레임의 이벤트 메타로 우선순위를 정합니다.
+ * nvmsgconv는 이벤트마다 payload를 하나씩 같은 순서로 붙이므로(컴포넌트가 여럿이면
+ * 컴포넌트마다 한 벌) payload 수가 이벤트 수의 배수이면 순서대로 짝을 짓습니다.
+ * 짝이 맞지 않으면(multiple-payloads 등) 프레임 이벤트 중 가장 높은 우선순위를,
+ * 배치에 붙은 payload는 배치 전체에서 가장 높은 우선순위를 씁니다.
+ */
+void
+nvds_publish_queue_push_buffer (NvDsPublishQueue * queue, GstBuffer * buf,
+    guint comp_id)
+{
+  NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta (buf);
+  NvDsMetaList *l_frame, *l_user;
+  gint batch_priority = 0;
+
+  if (!batch_meta)
+    return;
+
+  for (l_frame = batch_meta->frame_meta_list; l_frame; l_frame = l_frame->next) {
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *) l_frame->data;
+    NvDsMetaList *l_event = NULL;
+    guint num_events = 0, num_payloads = 0;
+    gint frame_priority = 0;
+    gboolean paired;
+
+    for (l_user = frame_meta->frame_user_meta_list; l_user;
+        l_user = l_user->next) {
+      NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+
+      if (user_meta->base_meta.meta_type == NVDS_EVENT_MSG_META) {
+        num_events++;
+        frame_priority = MAX (frame_priority,
+            event_priority (queue, user_meta));
+      } else if (user_meta->base_meta.meta_type == NVDS_PAYLOAD_META) {
+        num_payloads++;
+      }
+    }
+    batch_priority = MAX (batch_priority, frame_priority);
+    if (!num_payloads)
+      continue;
+
+    paired = num_events > 0 && num_payloads % num_events == 0;
+    for (l_user = frame_meta->frame_user_meta_list; l_user;
+        l_user = l_user->next) {
+      NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+      gint priority = frame_priority;
+
+      if (user_meta->base_meta.meta_type != NVDS_PAYLOAD_META)
+        continue;
+      if (paired) {
+        l_event = next_event_meta (l_event ? l_event->next : NULL,
+            frame_meta->frame_user_meta_list);
+        priority = event_priority (queue, (NvDsUserMeta *) l_event->data);
+      }
+      push_payload (queue, user_meta, comp_id, priority);
+    }
+  }
+
+  for (l_user = batch_meta->batch_user_meta_list; l_user;
+      l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+
+    if (user_meta->base_meta.meta_type == NVDS_PAYLOAD_META)
+      push_payload (queue, user_meta, comp_id, batch_priority);
+  }
+}
+
+static void
+send_done_cb (void *user_ptr, NvDsMsgApiErrorType completion_flag)
+{
+  NvDsPublishItem *item = (NvDsPublishItem *) user_ptr;
+  NvDsPublishQueue *queue = item->queue;
+
+  g_mutex_lock (&queue->lock);
+  queue->in_flight--;
+  if (completion_flag == NVDS_MSGAPI_OK)
+    queue->sent++;
+  else
+    queue->failed++;
+  g_cond_broadcast (&queue->cond);
+  g_mutex_unlock (&queue->lock);
+
+  free_item (item);
+}
+
+static void
+connect_cb (NvDsMsgApiHandle h_ptr, NvDsMsgApiEventType ds_evt)
+{
+  if (ds_evt != NVDS_MSGAPI_EVT_SUCCESS)
+    NVGSTDS_WARN_MSG_V ("publish queue: broker event %d", ds_evt);
+}
+
+static void
+print_stats (NvDsPublishQueue * queue)
+{
+  g_mutex_lock (&queue->lock);
+  g_print ("publish queue [%s]: enqueued %" G_GUINT64_FORMAT ", sent %"
+      G_GUINT64_FORMAT ", failed %" G_GUINT64_FORMAT ", dropped %"
+      G_GUINT64_FORMAT ", depth %u\n", queue->topic, queue->enqueued,
+      queue->sent, queue->failed, queue->dropped,
+      queue->length + queue->in_flight);
+  g_mutex_unlock (&queue->lock);
+}
+
+/*
+ * 발행 스레드. 큐에서 가장 오래된 이벤트를 꺼내 max-in-flight 이내에서 send_async로 넘기고
+ * 주기적으로 do_work를 호출해 완료 콜백을 받습니다.
+ */
+static gpointer
+publish_thread (gpointer data)
+{
+  NvDsPublishQueue *queue = (NvDsPublishQueue *) data;
+  gint64 next_connect_us = 0;
+  gint64 next_stats_us = g_get_monotonic_time () +
+      (gint64) queue->config.stats_interval * G_USEC_PER_SEC;
+  gint64 last_work_us = 0;
+
+  while (TRUE) {
+    NvDsPublishItem *item = NULL;
+    gint64 now_us;
+
+    g_mutex_lock (&queue->lock);
+    while (!queue->stop && (!queue->handle || queue->length == 0 ||
+            queue->in_flight >= queue->config.max_in_flight)) {
+      if (!g_cond_wait_until (&queue->cond, &queue->lock,
+              g_get_monotonic_time () + DO_WORK_INTERVAL_US))
+        break;
+    }
+    if (queue->stop) {
+      g_mutex_unlock (&queue->lock);
+      break;
+    }
+    if (queue->handle && queue->length > 0 &&
+        queue->in_flight < queue->config.max_in_flight) {
+      item = pop_from (queue, oldest_level (queue));
+      queue->in_flight++;
+      /* block 정책에서 기다리는 스트리밍 스레드를 깨웁니다. */
+      g_cond_broadcast (&queue->cond);
+    }
+    g_mutex_unlock (&queue->lock);
+
+    now_us = g_get_monotonic_time ();
+    if (!queue->handle && now_us >= next_connect_us) {
+      NvDsMsgApiHandle handle = queue->connect (queue->conn_str, connect_cb,
+          queue->broker_config);
+
+      if (!handle) {
+        NVGSTDS_WARN_MSG_V ("publish queue [%s]: connection failed, retrying",
+            queue->topic);
+        next_connect_us = now_us + CONNECT_RETRY_INTERVAL_US;
+      }
+      g_mutex_lock (&queue->lock);
+      queue->handle = handle;
+      g_mutex_unlock (&queue->lock);
+    }
+
+    if (item && queue->send_async (queue->handle, queue->topic, item->data,
+            item->len, send_done_cb, item) != NVDS_MSGAPI_OK) {
+      send_done_cb (item, NVDS_MSGAPI_ERR);
+    }
+
+    if (queue->handle && (!item || now_us - last_work_us >= DO_WORK_INTERVAL_US)) {
+      queue->do_work (queue->handle);
+      last_work_us = now_us;
+    }
+
+    if (queue->config.stats_interval && now_us >= next_stats_us) {
+      print_stats (queue);
+      next_stats_us = now_us +
+          (gint64) queue->config.stats_interval * G_USEC_PER_SEC;
+    }
+  }
+
+  return NULL;
+}
+
+static gboolean
+load_proto_lib (NvDsPublishQueue * queue, const gchar * proto_lib)
+{
+  queue->lib_handle = dlopen (proto_lib, RTLD_LAZY);
+  if (!queue->lib_handle) {
+    NVGSTDS_ERR_MSG_V ("Failed to load %s: %s", proto_lib, dlerror ());
+    return FALSE;
+  }
+
+  queue->connect = (nvds_msgapi_connect_ptr)
+      dlsym (queue->lib_handle, "nvds_msgapi_connect");
+  queue->send_async = (nvds_msgapi_send_async_ptr)
+      dlsym (queue->lib_handle, "nvds_msgapi_send_async");
+  queue->do_work = (nvds_msgapi_do_work_ptr)
+      dlsym (queue->lib_handle, "nvds_msgapi_do_work");
+  queue->disconnect = (nvds_msgapi_disconnect_ptr)
+      dlsym (queue->lib_handle, "nvds_msgapi_disconnect");
+
+  if (!queue->connect || !queue->send_async || !queue->do_work ||
+      !queue->disconnect) {
+    NVGSTDS_ERR_MSG_V ("%s is not a msgapi protocol adaptor", proto_lib);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+NvDsPublishQueue *
+nvds_publish_queue_new (NvDsPublishQueueConfig * config,
+    const gchar * proto_lib, const gchar * conn_str,
+    const gchar * broker_config, const gchar * topic)
+{
+  NvDsPublishQueue *queue = NULL;
+  guint i;
+
+  if (!proto_lib || !topic) {
+    NVGSTDS_ERR_MSG_V ("publish queue needs msg-broker-proto-lib and topic");
+    return NULL;
+  }
+
+  queue = g_new0 (NvDsPublishQueue, 1);
+  queue->config = *config;
+  queue->config.class_priorities = (gint *) g_memdup2 (config->class_priorities,
+      config->num_class_priorities * sizeof (gint));
+  if (!queue->config.max_in_flight)
+    queue->config.max_in_flight = 1;
+  queue->conn_str = g_strdup (conn_str);
+  queue->broker_config = g_strdup (broker_config);
+  queue->topic = g_strdup (topic);
+  g_mutex_init (&queue->lock);
+  g_cond_init (&queue->cond);
+  for (i = 0; i < NVDS_PUBLISH_QUEUE_MAX_PRIORITIES; i++)
+    g_queue_init (&queue->levels[i]);
+
+  if (!load_proto_lib (queue, proto_lib)) {
+    nvds_publish_queue_free (queue);
+    return NULL;
+  }
+
+  queue->thread = g_thread_new ("publish-queue", publish_thread, queue);
+
+  g_mutex_lock (&registry_lock);
+  registry = g_list_prepend (registry, queue);
+  g_mutex_unlock (&registry_lock);
+
+  return queue;
+}
+
+void
+nvds_publish_queue_free (NvDsPublishQueue * queue)
+{
+  guint i, pending;
+
+  if (!queue)
+    return;
+
+  g_mutex_lock (&registry_lock);
+  registry = g_list_remove (registry, queue);
+  g_mutex_unlock (&registry_lock);
+
+  if (queue->thread) {
+    g_mutex_lock (&queue->lock);
+    queue->stop = TRUE;
+    g_cond_broadcast (&queue->cond);
+    g_mutex_unlock (&queue->lock);
+    g_thread_join (queue->thread);
+  }
+
+  /*
+   * 어댑터에 넘긴 이벤트는 완료 콜백에서 해제되므로 연결을 닫기 전에 in_flight가 0이
+   * 될 때까지 do_work를 부르며 기다립니다. 발행 스레드는 멈췄으므로 여기서 부릅니다.
+   */
+  if (queue->handle) {
+    gint64 deadline_us = g_get_monotonic_time () + DRAIN_TIMEOUT_US;
+
+    g_mutex_lock (&queue->lock);
+    while (queue->in_flight > 0 && g_get_monotonic_time () < deadline_us) {
+      g_mutex_unlock (&queue->lock);
+      queue->do_work (queue->handle);
+      g_mutex_lock (&queue->lock);
+      if (queue->in_flight > 0)
+        g_cond_wait_until (&queue->cond, &queue->lock,
+            MIN (deadline_us, g_get_monotonic_time () + DO_WORK_INTERVAL_US));
+    }
+    g_mutex_unlock (&queue->lock);
+
+    queue->disconnect (queue->handle);
+  }
+
+  /*
+   * disconnect 후에도 완료되지 않은 이벤트는 어댑터가 아직 참조할 수 있으므로
+   * 해제하지 않고 실패로 셉니다.
+   */
+  if (queue->in_flight > 0) {
+    NVGSTDS_WARN_MSG_V ("publish queue [%s]: %u events not completed within "
+        "%d ms", queue->topic, queue->in_flight,
+        (gint) (DRAIN_TIMEOUT_US / 1000));
+    queue->failed += queue->in_flight;
+    queue->in_flight = 0;
+  }
+
+  pending = queue->length;
+  for (i = 0; i < NVDS_PUBLISH_QUEUE_MAX_PRIORITIES; i++)
+    g_queue_clear_full (&queue->levels[i], (GDestroyNotify) free_item);
+  queue->dropped += pending;
+  if (queue->thread)
+    print_stats (queue);
+
+  if (queue->lib_handle)
+    dlclose (queue->lib_handle);
+  g_mutex_clear (&queue->lock);
+  g_cond_clear (&queue->cond);
+  g_free (queue->config.class_priorities);
+  g_free (queue->conn_str);
+  g_free (queue->broker_config);
+  g_free (queue->topic);
+  g_free (queue);
+}
+
+void
+nvds_publish_queue_foreach_stats (NvDsPublishQueueStatsFunc func,
+    gpointer user_data)
+{
+  GHashTable *topics = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      g_free);
+  GHashTableIter iter;
+  gpointer value;
+  GList *l;
+
+  g_mutex_lock (&registry_lock);
+  for (l = registry; l; l = l->next) {
+    NvDsPublishQueue *queue = (NvDsPublishQueue *) l->data;
+    NvDsPublishQueueTopicStats *stats = (NvDsPublishQueueTopicStats *)
+        g_hash_table_lookup (topics, queue->topic);
+
+    if (!stats) {
+      stats = g_new0 (NvDsPublishQueueTopicStats, 1);
+      stats->topic = queue->topic;
+      g_hash_table_insert (topics, queue->topic, stats);
+    }
+    g_mutex_lock (&queue->lock);
+    stats->enqueued += queue->enqueued;
+    stats->sent += queue->sent;
+    stats->failed += queue->failed;
+    stats->dropped += queue->dropped;
+    stats->depth += queue->length + queue->in_flight;
+    g_mutex_unlock (&queue->lock);
+  }
+
+  /* 큐가 해제되지 않도록 registry_lock을 잡은 채로 콜백을 호출합니다. */
+  g_hash_table_iter_init (&iter, topics);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    func ((NvDsPublishQueueTopicStats *) value, user_data);
+  g_mutex_unlock (&registry_lock);
+
+  g_hash_table_destroy (topics);
+}
@@ -36,6 +36,11 @@ static guint uid = 0;
 static GstRTSPServer *server[MAX_SINK_BINS];
 static guint server_count = 0;
 static GMutex server_cnt_lock;
+static NvDsRtspClientFunc rtsp_client_func;
+static gpointer rtsp_client_data;
+/** 서버별로 시작 시점의 클라이언트 콜백을 보관합니다. */
+static NvDsRtspClientFunc server_client_func[MAX_SINK_BINS];
+static gpointer server_client_data[MAX_SINK_BINS];
 
 GST_DEBUG_CATEGORY_EXTERN (NVDS_APP);
 
@@ -206,6 +211,58 @@ broker_queue_overrun (GstElement * sink_queue, gpointer user_data)
       "Dropped; Network bandwidth might be insufficient\n");
 }
 
+static GstPadProbeReturn
+publish_queue_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  NvDsSinkMsgConvBrokerConfig *config = (NvDsSinkMsgConvBrokerConfig *) u_data;
+  NvDsPublishQueue *queue = (NvDsPublishQueue *)
+      g_object_get_data (G_OBJECT (GST_PAD_PARENT (pad)), "publish-queue");
+
+  if (queue)
+    nvds_publish_queue_push_buffer (queue, GST_PAD_PROBE_INFO_BUFFER (info),
+        config->broker_comp_id);
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * publish-queue-size가 설정된 경우 nvmsgbroker 대신 fakesink를 두고,
+ * 버퍼의 payload를 복사해 발행 큐에 넣습니다. 버퍼는 바로 반환되므로
+ * 브로커가 느려도 파이프라인은 멈추지 않고 큐 정책에 따라 이벤트가 버려집니다.
+ */
+static GstElement *
+create_publish_queue_sink (NvDsSinkMsgConvBrokerConfig * config,
+    const gchar * elem_name)
+{
+  GstElement *sink = NULL;
+  GstPad *pad = NULL;
+  NvDsPublishQueue *queue = NULL;
+
+  if (config->new_api)
+    NVGSTDS_WARN_MSG_V ("new-api is ignored when publish-queue-size is set");
+
+  queue = nvds_publish_queue_new (&config->publish_queue, config->proto_lib,
+      config->conn_str, config->broker_config_file_path, config->topic);
+  if (!queue)
+    return NULL;
+
+  sink = gst_element_factory_make (NVDS_ELEM_SINK_FAKESINK, elem_name);
+  if (!sink) {
+    nvds_publish_queue_free (queue);
+    return NULL;
+  }
+  g_object_set (G_OBJECT (sink), "sync", config->sync, "async", FALSE, NULL);
+  /* sink가 해제될 때 발행 스레드를 멈추고 연결을 닫습니다. */
+  g_object_set_data_full (G_OBJECT (sink), "publish-queue", queue,
+      (GDestroyNotify) nvds_publish_queue_free);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, publish_queue_probe,
+      config, NULL);
+  gst_object_unref (pad);
+
+  return sink;
+}
+
 /**
  * Function to create sink bin to generate meta-msg, convert to json based on
  * a schema and send over msgbroker.
@@ -264,17 +321,25 @@ create_msg_conv_broker_bin (NvDsSinkMsgConvBrokerConfig * config,
 
   /* Create msg broker to send payload to server */
   g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_sink%d", uid);
-  bin->sink = gst_element_factory_make (NVDS_ELEM_MSG_BROKER, elem_name);
-  if (!bin->sink) {
-    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
-    goto done;
+  if (config->publish_queue.size) {
+    bin->sink = create_publish_queue_sink (config, elem_name);
+    if (!bin->sink) {
+      NVGSTDS_ERR_MSG_V ("Failed to create publish queue '%s'", elem_name);
+      goto done;
+    }
+  } else {
+    bin->sink = gst_element_factory_make (NVDS_ELEM_MSG_BROKER, elem_name);
+    if (!bin->sink) {
+      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+      goto done;
+    }
+    g_object_set (G_OBJECT (bin->sink), "proto-lib", config->proto_lib,
+        "conn-str", config->conn_str,
+        "topic", config->topic,
+        "sync", config->sync, "async", FALSE,
+        "config", config->broker_config_file_path,
+        "comp-id", config->broker_comp_id, "new-api", config->new_api, NULL);
   }
-  g_object_set (G_OBJECT (bin->sink), "proto-lib", config->proto_lib,
-      "conn-str", config->conn_str,
-      "topic", config->topic,
-      "sync", config->sync, "async", FALSE,
-      "config", config->broker_config_file_path,
-      "comp-id", config->broker_comp_id, "new-api", config->new_api, NULL);
 
   gst_bin_add_many (GST_BIN (bin->bin),
       bin->queue, bin->transform, bin->sink, NULL);
@@ -524,6 +589,37 @@ done:
   return ret;
 }
 
+void
+set_rtsp_client_func (NvDsRtspClientFunc func, gpointer user_data)
+{
+  g_mutex_lock (&server_cnt_lock);
+  rtsp_client_func = func;
+  rtsp_client_data = user_data;
+  g_mutex_unlock (&server_cnt_lock);
+}
+
+static void
+rtsp_client_closed_cb (GstRTSPClient * client, gpointer user_data)
+{
+  guint i = GPOINTER_TO_UINT (user_data);
+
+  if (server_client_func[i])
+    server_client_func[i] (FALSE, server_client_data[i]);
+}
+
+static void
+rtsp_client_connected_cb (GstRTSPServer * rtsp_server, GstRTSPClient * client,
+    gpointer user_data)
+{
+  guint i = GPOINTER_TO_UINT (user_data);
+
+  if (!server_client_func[i])
+    return;
+  g_signal_connect (client, "closed", G_CALLBACK (rtsp_client_closed_cb),
+      user_data);
+  server_client_func[i] (TRUE, server_client_data[i]);
+}
+
 static gboolean
 start_rtsp_streaming (guint rtsp_port_num, guint updsink_port_num,
     NvDsEncoderType enctype, guint64 udp_buffer_size)
@@ -568,6 +664,13 @@ start_rtsp_streaming (guint rtsp_port_num, guint updsink_port_num,
 
   g_object_unref (mounts);
 
+  server_client_func[server_count] = rtsp_client_func;
+  server_client_data[server_count] = rtsp_client_data;
+  if (rtsp_client_func)
+    g_signal_connect (server[server_count], "client-connected",
+        G_CALLBACK (rtsp_client_connected_cb),
+        GUINT_TO_POINTER (server_count));
+
   gst_rtsp_server_attach (server[server_count], NULL);
 
   server_count++;
@@ -755,11 +858,399 @@ done:
   return ret;
 }
 
+/** 공유 인코더 뒤 출력 가지별 큐 길이 (인코딩된 프레임 수) */
+#define SHARED_ENCODER_BRANCH_QUEUE_BUFFERS 30
+
+/** 공유 인코더 출력 가지의 keyframe 게이트 상태 */
+typedef struct
+{
+  GstElement *queue;
+  gboolean wait_keyframe;
+} SharedEncoderBranchGate;
+
+/**
+ * 출력 가지 큐의 sink pad에서 tee 스레드로 불립니다. 큐가 가득 차면 밀어
+ * 넣지 않고 버리며(큐는 non-leaky라 막히지 않음), 그 뒤로는 다음 keyframe까지
+ * delta 프레임을 버립니다. leaky 큐처럼 GOP 중간을 빼먹지 않으므로 파일은
+ * 잘린 구간 없이 디코딩 가능한 GOP만 담고, 느린 출력이 인코더와 다른 가지를
+ * 막지도 않습니다. 큐 수위는 이 스레드만 올리므로 확인 뒤 push는 막히지 않습니다.
+ */
+static GstPadProbeReturn
+shared_encoder_branch_gate_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer u_data)
+{
+  SharedEncoderBranchGate *gate = (SharedEncoderBranchGate *) u_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  guint level = 0;
+
+  if (gate->wait_keyframe &&
+      GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT))
+    return GST_PAD_PROBE_DROP;
+  g_object_get (G_OBJECT (gate->queue), "current-level-buffers", &level, NULL);
+  if (level >= SHARED_ENCODER_BRANCH_QUEUE_BUFFERS) {
+    if (!gate->wait_keyframe)
+      NVGSTDS_WARN_MSG_V ("%s: output too slow, dropping until the next "
+          "keyframe", GST_ELEMENT_NAME (gate->queue));
+    gate->wait_keyframe = TRUE;
+    return GST_PAD_PROBE_DROP;
+  }
+  gate->wait_keyframe = FALSE;
+  return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+is_encoder_sink (NvDsSinkSubBinConfig * config)
+{
+  return (config->type == NV_DS_SINK_ENCODE_FILE ||
+      config->type == NV_DS_SINK_UDPSINK) &&
+      (config->encoder_config.codec == NV_DS_ENCODER_H264 ||
+      config->encoder_config.codec == NV_DS_ENCODER_H265);
+}
+
+static gboolean
+same_encoder_settings (NvDsSinkEncoderConfig * a, NvDsSinkEncoderConfig * b)
+{
+  return a->codec == b->codec && a->enc_type == b->enc_type &&
+      a->bitrate == b->bitrate && a->profile == b->profile &&
+      a->iframeinterval == b->iframeinterval && a->gpu_id == b->gpu_id &&
+      a->sw_preset == b->sw_preset;
+}
+
+/**
+ * config_array[i]와 같은 sink bin(같은 입력 화면)에 붙고 인코더 설정이 같은
+ * file/UDP sink들의 인덱스를 members에 모읍니다. members[0]은 i입니다.
+ * i보다 앞선 sink와 묶이면 그 sink에서 이미 만들었으므로 0을 돌려줍니다.
+ */
+static guint
+find_shared_encoder_sinks (NvDsSinkSubBinConfig * config_array,
+    guint num_sub_bins, guint i, gboolean demux, guint index, guint * members)
+{
+  guint j, n = 0;
+
+  if (!is_encoder_sink (&config_array[i])) {
+    members[0] = i;
+    return 1;
+  }
+
+  for (j = 0; j < num_sub_bins; j++) {
+    NvDsSinkSubBinConfig *other = &config_array[j];
+
+    if (!other->enable || !is_encoder_sink (other) ||
+        !other->link_to_demux != !demux ||
+        (!demux && other->source_id != index))
+      continue;
+    if (!same_encoder_settings (&other->encoder_config,
+            &config_array[i].encoder_config))
+      continue;
+    if (j < i)
+      return 0;
+    members[n++] = j;
+  }
+  return n;
+}
+
+/**
+ * 공유 인코더 tee 뒤의 출력 가지 하나를 만듭니다.
+ * 큐 -> parser -> (mux -> filesink | rtppay -> udpsink)
+ * 느린 출력은 큐 앞의 keyframe 게이트에서 다음 GOP까지 버리고 다른 출력을
+ * 막지 않습니다.
+ */
+static gboolean
+create_shared_encoder_branch (NvDsSinkSubBinConfig * config,
+    NvDsSinkBinSubBin * branch, GstElement * parent, GstElement * tee)
+{
+  NvDsSinkEncoderConfig *enc_config = &config->encoder_config;
+  gboolean ret = FALSE;
+  gchar elem_name[50];
+  GstElement *queue = NULL;
+  GstPad *pad = NULL;
+  SharedEncoderBranchGate *gate = NULL;
+  const gchar *latency = g_getenv ("NVDS_ENABLE_LATENCY_MEASUREMENT");
+
+  uid++;
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_queue%d", uid);
+  queue = gst_element_factory_make (NVDS_ELEM_QUEUE, elem_name);
+  if (!queue) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+  /* 게이트가 가득 찬 큐에 밀어 넣지 않으므로 한도는 버퍼 수만 둡니다. */
+  g_object_set (G_OBJECT (queue),
+      "max-size-buffers", SHARED_ENCODER_BRANCH_QUEUE_BUFFERS + 1,
+      "max-size-bytes", 0, "max-size-time", (guint64) 0, NULL);
+  gate = g_new0 (SharedEncoderBranchGate, 1);
+  gate->queue = queue;
+  pad = gst_element_get_static_pad (queue, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      shared_encoder_branch_gate_probe, gate, g_free);
+  gst_object_unref (pad);
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_parser%d", uid);
+  branch->codecparse = gst_element_factory_make (enc_config->codec ==
+      NV_DS_ENCODER_H264 ? "h264parse" : "h265parse", elem_name);
+  if (!branch->codecparse) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+
+  if (config->type == NV_DS_SINK_UDPSINK) {
+    g_object_set (G_OBJECT (branch->codecparse), "config-interval", -1, NULL);
+
+    g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_rtppay%d", uid);
+    branch->rtppay = gst_element_factory_make (enc_config->codec ==
+        NV_DS_ENCODER_H264 ? "rtph264pay" : "rtph265pay", elem_name);
+    if (!branch->rtppay) {
+      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+      goto done;
+    }
+
+    g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_udpsink%d", uid);
+    branch->sink = gst_element_factory_make ("udpsink", elem_name);
+    if (!branch->sink) {
+      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+      goto done;
+    }
+    g_object_set (G_OBJECT (branch->sink), "host", "224.224.255.255", "port",
+        enc_config->udp_port, "async", FALSE, "sync", 0, NULL);
+
+    gst_bin_add_many (GST_BIN (parent), queue, branch->codecparse,
+        branch->rtppay, branch->sink, NULL);
+    NVGSTDS_LINK_ELEMENT (queue, branch->codecparse);
+    NVGSTDS_LINK_ELEMENT (branch->codecparse, branch->rtppay);
+    NVGSTDS_LINK_ELEMENT (branch->rtppay, branch->sink);
+
+    if (!start_rtsp_streaming (enc_config->rtsp_port, enc_config->udp_port,
+            enc_config->codec, enc_config->udp_buffer_size)) {
+      g_print ("%s: start_rtsp_straming function failed\n", __func__);
+      goto done;
+    }
+  } else {
+    g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_mux%d", uid);
+    //disabling the mux when latency measurement logs are enabled
+    if (latency) {
+      branch->mux = gst_element_factory_make (NVDS_ELEM_IDENTITY, elem_name);
+    } else if (enc_config->container == NV_DS_CONTAINER_MP4) {
+      branch->mux = gst_element_factory_make (NVDS_ELEM_MUX_MP4, elem_name);
+    } else if (enc_config->container == NV_DS_CONTAINER_MKV) {
+      branch->mux = gst_element_factory_make (NVDS_ELEM_MKV, elem_name);
+    }
+    if (!branch->mux) {
+      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+      goto done;
+    }
+
+    g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_sink%d", uid);
+    branch->sink = gst_element_factory_make (NVDS_ELEM_SINK_FILE, elem_name);
+    if (!branch->sink) {
+      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+      goto done;
+    }
+    g_object_set (G_OBJECT (branch->sink), "location",
+        enc_config->output_file_path, "sync", config->sync, "async", FALSE,
+        NULL);
+
+    gst_bin_add_many (GST_BIN (parent), queue, branch->codecparse,
+        branch->mux, branch->sink, NULL);
+    NVGSTDS_LINK_ELEMENT (queue, branch->codecparse);
+    NVGSTDS_LINK_ELEMENT (branch->codecparse, branch->mux);
+    NVGSTDS_LINK_ELEMENT (branch->mux, branch->sink);
+  }
+
+  if (!link_element_to_tee_src_pad (tee, queue))
+    goto done;
+
+  ret = TRUE;
+
+done:
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
+/**
+ * 인코더 설정이 같은 file/UDP sink들이 인코더 하나를 나눠 쓰는 sink sub bin.
+ * queue -> nvvideoconvert -> capsfilter -> encoder -> tee -> 출력 가지들
+ * 결과 bin은 sub_bins[members[0]]에 두고, 나머지 sink의 sub_bins에는
+ * 자기 출력 가지의 요소만 채웁니다.
+ */
+static gboolean
+create_shared_encode_bin (NvDsSinkSubBinConfig * config_array,
+    guint * members, guint num_members, NvDsSinkBin * sink_bin)
+{
+  NvDsSinkBinSubBin *bin = &sink_bin->sub_bins[members[0]];
+  NvDsSinkEncoderConfig *config = &config_array[members[0]].encoder_config;
+  GstCaps *caps = NULL;
+  GstElement *tee = NULL;
+  gboolean ret = FALSE;
+  gboolean has_udp = FALSE;
+  gboolean copy_meta = FALSE;
+  gchar elem_name[50];
+  int probe_id = 0;
+  guint k;
+
+  for (k = 0; k < num_members; k++) {
+    NvDsSinkSubBinConfig *member = &config_array[members[k]];
+    if (member->type == NV_DS_SINK_UDPSINK)
+      has_udp = TRUE;
+    else if (member->encoder_config.copy_meta == 1)
+      copy_meta = TRUE;
+  }
+
+  uid++;
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin%d", uid);
+  bin->bin = gst_bin_new (elem_name);
+  if (!bin->bin) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_queue%d", uid);
+  bin->queue = gst_element_factory_make (NVDS_ELEM_QUEUE, elem_name);
+  if (!bin->queue) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_transform%d", uid);
+  bin->transform = gst_element_factory_make (NVDS_ELEM_VIDEO_CONV, elem_name);
+  if (!bin->transform) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_cap_filter%d", uid);
+  bin->cap_filter = gst_element_factory_make (NVDS_ELEM_CAPS_FILTER, elem_name);
+  if (!bin->cap_filter) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_encoder%d", uid);
+  if (config->enc_type == NV_DS_ENCODER_TYPE_HW) {
+    bin->encoder = gst_element_factory_make (config->codec ==
+        NV_DS_ENCODER_H264 ? NVDS_ELEM_ENC_H264_HW : NVDS_ELEM_ENC_H265_HW,
+        elem_name);
+    if (!bin->encoder) {
+      NVGSTDS_INFO_MSG_V("Could not create HW encoder. Falling back to SW encoder");
+      config->enc_type = NV_DS_ENCODER_TYPE_SW;
+    }
+  }
+  if (config->enc_type == NV_DS_ENCODER_TYPE_SW) {
+    bin->encoder = gst_element_factory_make (config->codec ==
+        NV_DS_ENCODER_H264 ? NVDS_ELEM_ENC_H264_SW : NVDS_ELEM_ENC_H265_SW,
+        elem_name);
+  }
+  if (!bin->encoder) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+  for (k = 1; k < num_members; k++)
+    config_array[members[k]].encoder_config.enc_type = config->enc_type;
+
+  if (config->enc_type == NV_DS_ENCODER_TYPE_SW)
+    caps = gst_caps_from_string ("video/x-raw, format=I420");
+  else
+    caps = gst_caps_from_string ("video/x-raw(memory:NVMM), format=I420");
+  g_object_set (G_OBJECT (bin->cap_filter), "caps", caps, NULL);
+
+  NVGSTDS_ELEM_ADD_PROBE (probe_id,
+      bin->encoder, "sink",
+      seek_query_drop_prob, GST_PAD_PROBE_TYPE_QUERY_UPSTREAM, bin);
+
+  probe_id = probe_id;
+
+  struct cudaDeviceProp prop;
+  cudaGetDeviceProperties (&prop, config->gpu_id);
+
+  if (config->enc_type == NV_DS_ENCODER_TYPE_HW) {
+    if (copy_meta) {
+      g_object_set (G_OBJECT (bin->encoder), "copy-meta", TRUE, NULL);
+    }
+    g_object_set (G_OBJECT (bin->encoder), "output-io-mode",
+        config->output_io_mode == NV_DS_ENCODER_OUTPUT_IO_MODE_DMABUF_IMPORT ?
+        NV_DS_ENCODER_OUTPUT_IO_MODE_DMABUF_IMPORT :
+        NV_DS_ENCODER_OUTPUT_IO_MODE_MMAP, NULL);
+    g_object_set (G_OBJECT (bin->encoder), "profile", config->profile, NULL);
+    g_object_set (G_OBJECT (bin->encoder), "iframeinterval",
+        config->iframeinterval, NULL);
+    g_object_set (G_OBJECT (bin->encoder), "bitrate", config->bitrate, NULL);
+    g_object_set (G_OBJECT (bin->encoder), "gpu-id", config->gpu_id, NULL);
+    if (prop.integrated && has_udp) {
+      g_object_set (G_OBJECT (bin->encoder), "preset-level", 1, NULL);
+      g_object_set (G_OBJECT (bin->encoder), "insert-sps-pps", 1, NULL);
+    }
+  } else {
+    //bitrate is in kbits/sec for software encoder x264enc and x265enc
+    g_object_set (G_OBJECT (bin->encoder), "bitrate", config->bitrate / 1000,
+        NULL);
+    g_object_set (G_OBJECT (bin->encoder), "speed-preset", config->sw_preset,
+        NULL);
+    /* 출력 가지 게이트가 keyframe에서 다시 열리므로 GOP 길이를 지킵니다. */
+    if (config->iframeinterval)
+      g_object_set (G_OBJECT (bin->encoder), "key-int-max",
+          config->iframeinterval, NULL);
+  }
+
+  g_snprintf (elem_name, sizeof (elem_name), "sink_sub_bin_enc_tee%d", uid);
+  tee = gst_element_factory_make (NVDS_ELEM_TEE, elem_name);
+  if (!tee) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    goto done;
+  }
+  g_object_set (G_OBJECT (tee), "allow-not-linked", TRUE, NULL);
+
+  g_object_set (G_OBJECT (bin->transform), "gpu-id", config->gpu_id, NULL);
+  gst_bin_add_many (GST_BIN (bin->bin), bin->queue, bin->transform,
+      bin->cap_filter, bin->encoder, tee, NULL);
+
+  NVGSTDS_LINK_ELEMENT (bin->queue, bin->transform);
+  NVGSTDS_LINK_ELEMENT (bin->transform, bin->cap_filter);
+  NVGSTDS_LINK_ELEMENT (bin->cap_filter, bin->encoder);
+  NVGSTDS_LINK_ELEMENT (bin->encoder, tee);
+
+  NVGSTDS_BIN_ADD_GHOST_PAD (bin->bin, bin->queue, "sink");
+
+  for (k = 0; k < num_members; k++) {
+    NvDsSinkSubBinConfig *member = &config_array[members[k]];
+    NvDsSinkBinSubBin branch = { 0 };
+
+    if (!create_shared_encoder_branch (member, &branch, bin->bin, tee))
+      goto done;
+    if (k == 0) {
+      bin->codecparse = branch.codecparse;
+      bin->mux = branch.mux;
+      bin->rtppay = branch.rtppay;
+      bin->sink = branch.sink;
+    } else {
+      sink_bin->sub_bins[members[k]] = branch;
+    }
+  }
+
+  NVGSTDS_INFO_MSG_V ("One %s encoder shared by %u sinks",
+      config->codec == NV_DS_ENCODER_H264 ? "H264" : "H265", num_members);
+
+  ret = TRUE;
+
+done:
+  if (caps) {
+    gst_caps_unref (caps);
+  }
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
 gboolean
 create_sink_bin (guint num_sub_bins, NvDsSinkSubBinConfig * config_array,
     NvDsSinkBin * bin, guint index)
 {
   gboolean ret = FALSE;
+  guint shared[MAX_SINK_BINS];
+  guint num_shared = 0;
   guint i;
 
   bin->bin = gst_bin_new ("sink_bin");
@@ -815,15 +1306,27 @@ create_sink_bin (guint num_sub_bins, NvDsSinkSubBinConfig * config_array,
           goto done;
         break;
       case NV_DS_SINK_ENCODE_FILE:
-        config_array[i].encoder_config.sync = config_array[i].sync;
-        if (!create_encode_file_bin (&config_array[i].encoder_config,
-                &bin->sub_bins[i]))
-          goto done;
-        break;
       case NV_DS_SINK_UDPSINK:
-        if (!create_udpsink_bin (&config_array[i].encoder_config,
-                &bin->sub_bins[i]))
-          goto done;
+        num_shared = find_shared_encoder_sinks (config_array, num_sub_bins, i,
+            FALSE, index, shared);
+        if (num_shared == 0) {
+          /* 앞선 sink의 공유 인코더 bin에 이미 포함됨 */
+          bin->num_bins++;
+          continue;
+        }
+        if (num_shared > 1) {
+          if (!create_shared_encode_bin (config_array, shared, num_shared, bin))
+            goto done;
+        } else if (config_array[i].type == NV_DS_SINK_ENCODE_FILE) {
+          config_array[i].encoder_config.sync = config_array[i].sync;
+          if (!create_encode_file_bin (&config_array[i].encoder_config,
+                  &bin->sub_bins[i]))
+            goto done;
+        } else {
+          if (!create_udpsink_bin (&config_array[i].encoder_config,
+                  &bin->sub_bins[i]))
+            goto done;
+        }
         break;
       case NV_DS_SINK_MSG_CONV_BROKER:
         config_array[i].msg_conv_broker_config.sync = config_array[i].sync;
@@ -870,6 +1373,8 @@ create_demux_sink_bin (guint num_sub_bins, NvDsSinkSubBinConfig * config_array,
     NvDsSinkBin * bin, guint index)
 {
   gboolean ret = FALSE;
+  guint shared[MAX_SINK_BINS];
+  guint num_shared = 0;
   guint i;
 
   bin->bin = gst_bin_new ("sink_bin");
@@ -920,15 +1425,27 @@ create_demux_sink_bin (guint num_sub_bins, NvDsSinkSubBinConfig * config_array,
           goto done;
         break;
       case NV_DS_SINK_ENCODE_FILE:
-        config_array[i].encoder_config.sync = config_array[i].sync;
-        if (!create_encode_file_bin (&config_array[i].encoder_config,
-                &bin->sub_bins[i]))
-          goto done;
-        break;
       case NV_DS_SINK_UDPSINK:
-        if (!create_udpsink_bin (&config_array[i].encoder_config,
-                &bin->sub_bins[i]))
-          goto done;
+        num_shared = find_shared_encoder_sinks (config_array, num_sub_bins, i,
+            TRUE, index, shared);
+        if (num_shared == 0) {
+          /* 앞선 sink의 공유 인코더 bin에 이미 포함됨 */
+          bin->num_bins++;
+          continue;
+        }
+        if (num_shared > 1) {
+          if (!create_shared_encode_bin (config_array, shared, num_shared, bin))
+            goto done;
+        } else if (config_array[i].type == NV_DS_SINK_ENCODE_FILE) {
+          config_array[i].encoder_config.sync = config_array[i].sync;
+          if (!create_encode_file_bin (&config_array[i].encoder_config,
+                  &bin->sub_bins[i]))
+            goto done;
+        } else {
+          if (!create_udpsink_bin (&config_array[i].encoder_config,
+                  &bin->sub_bins[i]))
+            goto done;
+        }
         break;
       case NV_DS_SINK_MSG_CONV_BROKER:
         config_array[i].msg_conv_broker_config.sync = config_array[i].sync;
@@ -987,6 +1504,7 @@ destroy_sink_bin ()
     gst_rtsp_mount_points_remove_factory (mounts, "/ds-test");
     g_object_unref (mounts);
     gst_rtsp_server_client_filter (server[i], client_filter, NULL);
+    server_client_func[i] = NULL;
     pool = gst_rtsp_server_get_session_pool (server[i]);
     gst_rtsp_session_pool_cleanup (pool);
     g_object_unref (pool);
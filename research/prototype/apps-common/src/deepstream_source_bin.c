@@ -22,6 +22,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "gstnvdsmeta.h"
 #include "deepstream_common.h"
@@ -650,7 +651,9 @@ check_rtsp_reconnection_attempts (NvDsSrcBin * src_bin)
   gboolean remove_probe = TRUE;
   guint i = 0;
   for (i = 0; i < src_bin->parent_bin->num_bins; i++) {
-    if (src_bin->parent_bin->sub_bins[i].config->type != NV_DS_SOURCE_RTSP)
+    /* remove_source_sub_bin()으로 비워진 슬롯은 config가 NULL입니다. */
+    if (!src_bin->parent_bin->sub_bins[i].config ||
+        src_bin->parent_bin->sub_bins[i].config->type != NV_DS_SOURCE_RTSP)
       continue;
     if (src_bin->parent_bin->sub_bins[i].have_eos &&
         (src_bin->parent_bin->sub_bins[i].rtsp_reconnect_interval_sec == 0 ||
@@ -1067,16 +1070,18 @@ create_rtsp_src_bin (NvDsSourceConfig * config, NvDsSrcBin * bin)
 
   ret = TRUE;
 
-  g_timeout_add (1000, watch_source_status, bin);
+  bin->source_watch_id = g_timeout_add (1000, watch_source_status, bin);
 
   // Enable local start / stop events in addition to the one
   // received from the server.
   if (config->smart_record == 2) {
     if (bin->config->smart_rec_interval)
-      g_timeout_add (bin->config->smart_rec_interval * 1000,
+      bin->smart_rec_event_id =
+          g_timeout_add (bin->config->smart_rec_interval * 1000,
           smart_record_event_generator, bin);
     else
-      g_timeout_add (10000, smart_record_event_generator, bin);
+      bin->smart_rec_event_id =
+          g_timeout_add (10000, smart_record_event_generator, bin);
   }
 
   GST_CAT_DEBUG (NVDS_APP,
@@ -1473,6 +1478,330 @@ create_source_bin (NvDsSourceConfig * config, NvDsSrcBin * bin)
   return TRUE;
 }
 
+static gboolean
+create_source_sub_bin (NvDsSrcParentBin * bin, NvDsSourceConfig * config,
+    guint i)
+{
+  gchar elem_name[50];
+  g_snprintf (elem_name, sizeof (elem_name), "src_sub_bin%d", i);
+  bin->sub_bins[i].bin = gst_bin_new (elem_name);
+  if (!bin->sub_bins[i].bin) {
+    NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
+    return FALSE;
+  }
+
+  bin->sub_bins[i].bin_id = bin->sub_bins[i].source_id = i;
+  config->live_source = TRUE;
+  bin->live_source = TRUE;
+  bin->sub_bins[i].eos_done = TRUE;
+  bin->sub_bins[i].reset_done = TRUE;
+
+  bin->sub_bins[i].parent_bin = bin;
+
+  switch (config->type) {
+    case NV_DS_SOURCE_CAMERA_CSI:
+    case NV_DS_SOURCE_CAMERA_V4L2:
+      if (!create_camera_source_bin (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      break;
+    case NV_DS_SOURCE_URI:
+      if (!create_uridecode_src_bin (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      bin->live_source = config->live_source;
+      break;
+    case NV_DS_SOURCE_RTSP:
+      if (!create_rtsp_src_bin (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      break;
+    case NV_DS_SOURCE_AUDIO_WAV:
+      if (!create_audio_source_bin (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      break;
+    case NV_DS_SOURCE_AUDIO_URI:
+      if (!create_uridecode_src_bin_audio (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      bin->live_source = config->live_source;
+      break;
+    case NV_DS_SOURCE_ALSA_SRC:
+      if (!create_audio_source_bin (config, &bin->sub_bins[i])) {
+        return FALSE;
+      }
+      break;
+    default:
+      NVGSTDS_ERR_MSG_V ("Source type not yet implemented!\n");
+      return FALSE;
+  }
+
+  gst_bin_add (GST_BIN (bin->bin), bin->sub_bins[i].bin);
+
+  if (!link_element_to_streammux_sink_pad (bin->streammux,
+          bin->sub_bins[i].bin, i)) {
+    NVGSTDS_ERR_MSG_V ("source %d cannot be linked to mux's sink pad %p\n", i,
+        bin->streammux);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * 시작 창(startup window) 스레드.
+ * RTSP 소스의 OPTIONS/DESCRIBE/SETUP은 rtspsrc의 태스크에서 비동기로
+ * 진행되므로 여기서는 동시에 여는 소스 수만 workers로 제한합니다.
+ * 슬롯이 비면 대기 중인 sub bin의 locked state를 풀고 부모 상태에 맞춰
+ * 시작합니다. 파이프라인이 이미 PLAYING이면 런타임 추가와 같은 경로로
+ * 합류합니다. open-timeout-ms 안에 열리지 않은 소스는 다시 잠가 NULL로
+ * 내리고(연결을 끊어 슬롯 수를 지킵니다), 대기 중인 소스가 모두 시작된 뒤
+ * 가장 오래전에 시도한 것부터 다시 엽니다.
+ */
+static gpointer
+source_startup_thread_func (gpointer data)
+{
+  NvDsSrcParentBin *bin = (NvDsSrcParentBin *) data;
+  NvDsSourceStartupConfig *config = &bin->startup_config;
+  gint64 open_timeout_us = (gint64) config->open_timeout_ms * 1000;
+
+  g_mutex_lock (&bin->startup_lock);
+  while (!bin->startup_stop) {
+    gint64 now = g_get_monotonic_time ();
+    GstState state = GST_STATE_NULL;
+    gboolean started = FALSE;
+    guint opening = 0;
+    gint queued = -1, retry = -1, timed_out = -1;
+    guint i;
+
+    /* 부모가 PAUSED에 이르기 전에는 rtspsrc가 아직 열기를 시작하지 않습니다.
+     * GST_STATE()는 객체 잠금 없이 읽으므로 get_state로 현재 상태만 봅니다. */
+    gst_element_get_state (bin->bin, &state, NULL, 0);
+    started = state >= GST_STATE_PAUSED;
+
+    for (i = 0; i < bin->num_bins; i++) {
+      NvDsSrcBin *sub_bin = &bin->sub_bins[i];
+
+      if (sub_bin->startup_state == NV_DS_SOURCE_STARTUP_QUEUED) {
+        if (queued < 0)
+          queued = i;
+      } else if (sub_bin->startup_state == NV_DS_SOURCE_STARTUP_OPENING) {
+        if (started && sub_bin->startup_begin_us == 0)
+          sub_bin->startup_begin_us = now;
+        if (timed_out < 0 && sub_bin->startup_begin_us &&
+            open_timeout_us > 0 &&
+            now - sub_bin->startup_begin_us >= open_timeout_us) {
+          timed_out = i;
+        } else {
+          opening++;
+        }
+      } else if (sub_bin->startup_state == NV_DS_SOURCE_STARTUP_FAILED &&
+          gst_element_is_locked_state (sub_bin->bin)) {
+        if (retry < 0 || sub_bin->startup_begin_us <
+            bin->sub_bins[retry].startup_begin_us)
+          retry = i;
+      }
+    }
+
+    if (timed_out >= 0) {
+      NvDsSrcBin *sub_bin = &bin->sub_bins[timed_out];
+      GstElement *sub = gst_object_ref (sub_bin->bin);
+
+      NVGSTDS_WARN_MSG_V ("Source %d did not open within %u ms", timed_out,
+          config->open_timeout_ms);
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_FAILED;
+      g_cond_broadcast (&bin->startup_cond);
+      g_mutex_unlock (&bin->startup_lock);
+
+      /* 열기를 계속하는 rtspsrc는 슬롯 밖에서 서버에 요청을 보내므로 멈춥니다. */
+      gst_element_set_locked_state (sub, TRUE);
+      gst_element_set_state (sub, GST_STATE_NULL);
+      gst_object_unref (sub);
+
+      g_mutex_lock (&bin->startup_lock);
+      continue;
+    }
+
+    if (queued < 0 && retry < 0 && opening == 0)
+      break;
+
+    if (queued < 0)
+      queued = retry;
+    if (started && queued >= 0 && opening < config->workers) {
+      NvDsSrcBin *sub_bin = &bin->sub_bins[queued];
+      GstElement *sub = gst_object_ref (sub_bin->bin);
+
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_OPENING;
+      sub_bin->startup_begin_us = now;
+      g_mutex_unlock (&bin->startup_lock);
+
+      gst_element_set_locked_state (sub, FALSE);
+      if (!gst_element_sync_state_with_parent (sub)) {
+        NVGSTDS_WARN_MSG_V ("Failed to start source %d", queued);
+      }
+      gst_object_unref (sub);
+
+      g_mutex_lock (&bin->startup_lock);
+      continue;
+    }
+
+    g_cond_wait_until (&bin->startup_cond, &bin->startup_lock,
+        now + 50 * G_TIME_SPAN_MILLISECOND);
+  }
+  g_mutex_unlock (&bin->startup_lock);
+
+  return NULL;
+}
+
+/* RTSP 소스를 시작 창에 등록합니다. workers 수를 넘는 소스는 locked
+ * state로 NULL에 묶어 두어 파이프라인 상태 변경에서 제외합니다. */
+static gboolean
+start_source_startup (NvDsSrcParentBin * bin)
+{
+  guint num_rtsp = 0;
+  guint i;
+
+  for (i = 0; i < bin->num_bins; i++) {
+    NvDsSrcBin *sub_bin = &bin->sub_bins[i];
+
+    if (!sub_bin->bin || !sub_bin->config ||
+        sub_bin->config->type != NV_DS_SOURCE_RTSP)
+      continue;
+
+    if (num_rtsp < bin->startup_config.workers) {
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_OPENING;
+    } else {
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_QUEUED;
+      gst_element_set_locked_state (sub_bin->bin, TRUE);
+    }
+    num_rtsp++;
+  }
+
+  if (num_rtsp == 0)
+    return TRUE;
+
+  g_mutex_init (&bin->startup_lock);
+  g_cond_init (&bin->startup_cond);
+  bin->startup_stop = FALSE;
+  bin->startup_thread = g_thread_new ("nvds-src-startup",
+      source_startup_thread_func, bin);
+
+  return bin->startup_thread != NULL;
+}
+
+gboolean
+handle_source_startup_message (NvDsSrcParentBin * bin, GstMessage * message)
+{
+  gboolean ret = FALSE;
+  GstProgressType type;
+  gchar *code = NULL;
+  guint i;
+
+  if (!bin->startup_thread || GST_MESSAGE_TYPE (message) != GST_MESSAGE_PROGRESS)
+    return FALSE;
+
+  gst_message_parse_progress (message, &type, &code, NULL);
+  if (g_strcmp0 (code, "open") != 0 || type == GST_PROGRESS_TYPE_START ||
+      type == GST_PROGRESS_TYPE_CONTINUE)
+    goto done;
+
+  g_mutex_lock (&bin->startup_lock);
+  for (i = 0; i < bin->num_bins; i++) {
+    NvDsSrcBin *sub_bin = &bin->sub_bins[i];
+
+    if (!sub_bin->bin ||
+        GST_MESSAGE_SRC (message) != GST_OBJECT_CAST (sub_bin->src_elem))
+      continue;
+
+    ret = TRUE;
+    /* 시간 초과로 슬롯을 내준 소스도 늦게 열리면 쿼럼에 셉니다. */
+    if (sub_bin->startup_state != NV_DS_SOURCE_STARTUP_OPENING &&
+        sub_bin->startup_state != NV_DS_SOURCE_STARTUP_FAILED)
+      break;
+
+    if (type == GST_PROGRESS_TYPE_COMPLETE) {
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_OPENED;
+      GST_CAT_DEBUG (NVDS_APP, "Source %u opened in %" G_GINT64_FORMAT " ms",
+          i, sub_bin->startup_begin_us ?
+          (g_get_monotonic_time () - sub_bin->startup_begin_us) / 1000 : 0);
+    } else {
+      sub_bin->startup_state = NV_DS_SOURCE_STARTUP_FAILED;
+    }
+    g_cond_broadcast (&bin->startup_cond);
+    break;
+  }
+  g_mutex_unlock (&bin->startup_lock);
+
+done:
+  g_free (code);
+  return ret;
+}
+
+gboolean
+wait_for_source_quorum (NvDsSrcParentBin * bin)
+{
+  NvDsSourceStartupConfig *config = &bin->startup_config;
+  gint64 begin = g_get_monotonic_time ();
+  gint64 deadline = begin + (gint64) config->quorum_timeout_ms * 1000;
+  guint total = 0, opened = 0, pending = 0, needed = 0;
+  guint i;
+
+  if (!bin->startup_thread)
+    return TRUE;
+
+  g_mutex_lock (&bin->startup_lock);
+  while (TRUE) {
+    total = opened = pending = 0;
+    for (i = 0; i < bin->num_bins; i++) {
+      switch (bin->sub_bins[i].startup_state) {
+        case NV_DS_SOURCE_STARTUP_QUEUED:
+        case NV_DS_SOURCE_STARTUP_OPENING:
+          pending++;
+          break;
+        case NV_DS_SOURCE_STARTUP_OPENED:
+          opened++;
+          break;
+        case NV_DS_SOURCE_STARTUP_FAILED:
+          break;
+        default:
+          continue;
+      }
+      total++;
+    }
+    needed = (guint) ceil (config->quorum * total);
+
+    if (opened >= needed || pending == 0)
+      break;
+    if (!g_cond_wait_until (&bin->startup_cond, &bin->startup_lock, deadline))
+      break;
+  }
+  g_mutex_unlock (&bin->startup_lock);
+
+  g_print ("** INFO: <%s:%d>: %u/%u RTSP sources opened in %" G_GINT64_FORMAT
+      " ms (quorum %u)\n", __func__, __LINE__, opened, total,
+      (g_get_monotonic_time () - begin) / 1000, needed);
+
+  return opened >= needed;
+}
+
+void
+stop_source_startup (NvDsSrcParentBin * bin)
+{
+  if (!bin->startup_thread)
+    return;
+
+  g_mutex_lock (&bin->startup_lock);
+  bin->startup_stop = TRUE;
+  g_cond_broadcast (&bin->startup_cond);
+  g_mutex_unlock (&bin->startup_lock);
+
+  g_thread_join (bin->startup_thread);
+  bin->startup_thread = NULL;
+  g_mutex_clear (&bin->startup_lock);
+  g_cond_clear (&bin->startup_cond);
+}
+
 gboolean
 create_multi_source_bin (guint num_sub_bins, NvDsSourceConfig * configs,
     NvDsSrcParentBin * bin)
@@ -1482,6 +1811,11 @@ create_multi_source_bin (guint num_sub_bins, NvDsSourceConfig * configs,
 
   bin->reset_thread = NULL;
 
+  /* sub_bins[i]의 주소가 시그널/프로브 user_data로 쓰이므로 실행 중 추가될
+   * 소스까지 포함해 한 번에 할당합니다. */
+  bin->max_bins = MAX (bin->max_bins, num_sub_bins);
+  bin->sub_bins = g_new0 (NvDsSrcBin, MAX (bin->max_bins, 1));
+
   bin->bin = gst_bin_new ("multi_src_bin");
   if (!bin->bin) {
     NVGSTDS_ERR_MSG_V ("Failed to create element 'multi_src_bin'");
@@ -1503,67 +1837,7 @@ create_multi_source_bin (guint num_sub_bins, NvDsSourceConfig * configs,
       continue;
     }
 
-    gchar elem_name[50];
-    g_snprintf (elem_name, sizeof (elem_name), "src_sub_bin%d", i);
-    bin->sub_bins[i].bin = gst_bin_new (elem_name);
-    if (!bin->sub_bins[i].bin) {
-      NVGSTDS_ERR_MSG_V ("Failed to create '%s'", elem_name);
-      goto done;
-    }
-
-    bin->sub_bins[i].bin_id = bin->sub_bins[i].source_id = i;
-    configs[i].live_source = TRUE;
-    bin->live_source = TRUE;
-    bin->sub_bins[i].eos_done = TRUE;
-    bin->sub_bins[i].reset_done = TRUE;
-
-    bin->sub_bins[i].parent_bin = bin;
-
-    switch (configs[i].type) {
-      case NV_DS_SOURCE_CAMERA_CSI:
-      case NV_DS_SOURCE_CAMERA_V4L2:
-        if (!create_camera_source_bin (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        break;
-      case NV_DS_SOURCE_URI:
-        if (!create_uridecode_src_bin (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        bin->live_source = configs[i].live_source;
-        break;
-      case NV_DS_SOURCE_RTSP:
-        if (!create_rtsp_src_bin (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        break;
-      case NV_DS_SOURCE_AUDIO_WAV:
-        if (!create_audio_source_bin (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        break;
-      case NV_DS_SOURCE_AUDIO_URI:
-        if (!create_uridecode_src_bin_audio (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        bin->live_source = configs->live_source;
-        break;
-      case NV_DS_SOURCE_ALSA_SRC:
-        if (!create_audio_source_bin (&configs[i], &bin->sub_bins[i])) {
-          return FALSE;
-        }
-        break;
-      default:
-        NVGSTDS_ERR_MSG_V ("Source type not yet implemented!\n");
-        return FALSE;
-    }
-
-    gst_bin_add (GST_BIN (bin->bin), bin->sub_bins[i].bin);
-
-    if (!link_element_to_streammux_sink_pad (bin->streammux,
-            bin->sub_bins[i].bin, i)) {
-      NVGSTDS_ERR_MSG_V ("source %d cannot be linked to mux's sink pad %p\n", i,
-          bin->streammux);
+    if (!create_source_sub_bin (bin, &configs[i], i)) {
       goto done;
     }
 
@@ -1577,6 +1851,11 @@ create_multi_source_bin (guint num_sub_bins, NvDsSourceConfig * configs,
         GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, bin);
   }
 
+  if (bin->startup_config.workers > 0 && !start_source_startup (bin)) {
+    NVGSTDS_ERR_MSG_V ("Failed to start source startup thread");
+    goto done;
+  }
+
   ret = TRUE;
 
 done:
@@ -1680,6 +1959,115 @@ done:
   return ret;
 }
 
+void
+destroy_multi_source_bin (NvDsSrcParentBin * bin)
+{
+  g_free (bin->sub_bins);
+  bin->sub_bins = NULL;
+  bin->max_bins = 0;
+  bin->num_bins = 0;
+}
+
+gboolean
+add_source_sub_bin (NvDsSrcParentBin * bin, NvDsSourceConfig * config,
+    guint index)
+{
+  gboolean ret = FALSE;
+
+  if (index >= bin->max_bins || bin->sub_bins[index].bin ||
+      bin->nvmultiurisrcbin) {
+    NVGSTDS_ERR_MSG_V ("Source slot %u is not available", index);
+    goto done;
+  }
+
+  if (!create_source_sub_bin (bin, config, index)) {
+    if (bin->sub_bins[index].bin) {
+      if (GST_OBJECT_PARENT (bin->sub_bins[index].bin))
+        gst_bin_remove (GST_BIN (bin->bin), bin->sub_bins[index].bin);
+      else
+        gst_object_unref (bin->sub_bins[index].bin);
+    }
+    memset (&bin->sub_bins[index], 0, sizeof (NvDsSrcBin));
+    goto done;
+  }
+
+  if (!gst_element_sync_state_with_parent (bin->sub_bins[index].bin)) {
+    NVGSTDS_ERR_MSG_V ("Failed to start source %u", index);
+    remove_source_sub_bin (bin, index);
+    goto done;
+  }
+
+  bin->num_bins = MAX (bin->num_bins, index + 1);
+  ret = TRUE;
+
+done:
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
+gboolean
+remove_source_sub_bin (NvDsSrcParentBin * bin, guint index)
+{
+  gboolean ret = FALSE;
+  NvDsSrcBin *sub_bin = NULL;
+  GstPad *sinkpad = NULL;
+  gchar pad_name[16];
+
+  if (index >= bin->max_bins || !bin->sub_bins[index].bin) {
+    NVGSTDS_ERR_MSG_V ("Source slot %u is not in use", index);
+    goto done;
+  }
+  sub_bin = &bin->sub_bins[index];
+
+  if (sub_bin->source_watch_id)
+    g_source_remove (sub_bin->source_watch_id);
+  if (sub_bin->smart_rec_event_id)
+    g_source_remove (sub_bin->smart_rec_event_id);
+
+  if (bin->startup_thread) {
+    g_mutex_lock (&bin->startup_lock);
+    sub_bin->startup_state = NV_DS_SOURCE_STARTUP_NONE;
+    g_mutex_unlock (&bin->startup_lock);
+  }
+
+  if (gst_element_set_state (sub_bin->bin,
+          GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE) {
+    NVGSTDS_ERR_MSG_V ("Can't set source %u to NULL", index);
+    goto done;
+  }
+
+  /* 해제되는 패드에서 대기 중인 배치가 끝나도록 flush-stop을 보낸 뒤
+   * 요청 패드를 반환합니다. */
+  g_snprintf (pad_name, sizeof (pad_name), "sink_%u", index);
+  sinkpad = gst_element_get_static_pad (bin->streammux, pad_name);
+  if (sinkpad) {
+    gst_pad_send_event (sinkpad, gst_event_new_flush_stop (FALSE));
+    gst_element_release_request_pad (bin->streammux, sinkpad);
+    gst_object_unref (sinkpad);
+  }
+
+  if (sub_bin->recordCtx)
+    NvDsSRDestroy ((NvDsSRContext *) sub_bin->recordCtx);
+
+  gst_bin_remove (GST_BIN (bin->bin), sub_bin->bin);
+  if (sub_bin->config && sub_bin->config->type == NV_DS_SOURCE_RTSP)
+    g_mutex_clear (&sub_bin->bin_lock);
+  memset (sub_bin, 0, sizeof (NvDsSrcBin));
+
+  while (bin->num_bins > 0 && !bin->sub_bins[bin->num_bins - 1].bin)
+    bin->num_bins--;
+
+  ret = TRUE;
+
+done:
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
 gboolean
 reset_source_pipeline (gpointer data)
 {
@@ -1691,6 +2079,7 @@ reset_source_pipeline (gpointer data)
   gettimeofday (&src_bin->last_buffer_time, NULL);
   gettimeofday (&src_bin->last_reconnect_time, NULL);
   g_mutex_unlock (&src_bin->bin_lock);
+  g_atomic_int_inc (&src_bin->num_source_resets);
 
   GstElement *send_event_element = NULL;
   if (src_bin->dewarper_bin.bin != NULL) {
@@ -99,3 +99,31 @@ set_streammux_properties (NvDsStreammuxConfig * config, GstElement * element)
 
   return ret;
 }
+
+NvDsBatchTimeout *
+create_streammux_batch_timeout (NvDsStreammuxConfig * config)
+{
+  NvDsBatchTimeoutConfig timeout_config;
+  gint initial_timeout = config->batched_push_timeout;
+
+  if (!config->adaptive_batched_push_timeout)
+    return NULL;
+  if (!g_strcmp0 (g_getenv ("USE_NEW_NVSTREAMMUX"), "yes")) {
+    NVGSTDS_WARN_MSG_V ("adaptive-batched-push-timeout is ignored with the "
+        "new nvstreammux");
+    return NULL;
+  }
+
+  /* max-batch-latency가 없으면 고정 timeout을 지연 상한으로 씁니다. */
+  if (initial_timeout <= 0)
+    initial_timeout = 40000;
+  memset (&timeout_config, 0, sizeof (timeout_config));
+  timeout_config.batch_size = MAX (config->batch_size, 1);
+  timeout_config.target_fill = config->target_batch_fill;
+  timeout_config.max_latency_us = config->max_batch_latency ?
+      config->max_batch_latency : (guint) initial_timeout;
+  timeout_config.min_timeout_us = config->min_batched_push_timeout;
+  timeout_config.window_ms = config->adaptive_window;
+
+  return nvds_batch_timeout_new (&timeout_config, initial_timeout);
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nvds_filelog.h"
+
+struct _NvDsFileLogWriter
+{
+  gchar *dir;
+  gsize segment_size;
+
+  /** 현재 세그먼트. map이 NULL이면 다음 append에서 만듭니다. */
+  gint fd;
+  guint8 *map;
+  gsize map_size;
+  gsize pos;
+
+  guint64 next_offset;
+};
+
+static gsize
+record_size (gsize len)
+{
+  gsize size = NVDS_FILELOG_RECORD_HEADER_SIZE + len;
+  return (size + NVDS_FILELOG_RECORD_ALIGN - 1) &
+      ~((gsize) NVDS_FILELOG_RECORD_ALIGN - 1);
+}
+
+static void
+set_errno_error (GError ** error, gint err, const gchar * what,
+    const gchar * path)
+{
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (err),
+      "%s '%s': %s", what, path, g_strerror (err));
+}
+
+static void
+finish_segment (NvDsFileLogWriter * writer)
+{
+  if (!writer->map)
+    return;
+
+  munmap (writer->map, writer->map_size);
+  if (ftruncate (writer->fd, writer->pos) < 0)
+    g_printerr ("filelog: truncate failed: %s\n", g_strerror (errno));
+  close (writer->fd);
+  writer->map = NULL;
+  writer->fd = -1;
+  writer->map_size = 0;
+  writer->pos = 0;
+}
+
+static gboolean
+new_segment (NvDsFileLogWriter * writer, gsize min_size, GError ** error)
+{
+  gchar name[32];
+  gchar *path = NULL;
+  gsize size = MAX (writer->segment_size, min_size);
+  gint fd = -1;
+  gint err;
+  void *map = NULL;
+  gboolean ret = FALSE;
+
+  g_snprintf (name, sizeof (name), "%020" G_GUINT64_FORMAT
+      NVDS_FILELOG_SEGMENT_SUFFIX, writer->next_offset);
+  path = g_build_filename (writer->dir, name, NULL);
+
+  fd = open (path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    set_errno_error (error, errno, "Failed to create", path);
+    goto done;
+  }
+
+  /* 희소 파일에 mmap으로 쓰다 디스크가 차면 SIGBUS가 나므로 미리 할당합니다. */
+  err = posix_fallocate (fd, 0, size);
+  if (err) {
+    set_errno_error (error, err, "Failed to allocate", path);
+    goto done;
+  }
+
+  map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    set_errno_error (error, errno, "Failed to map", path);
+    goto done;
+  }
+
+  writer->fd = fd;
+  writer->map = (guint8 *) map;
+  writer->map_size = size;
+  writer->pos = 0;
+  fd = -1;
+  ret = TRUE;
+
+done:
+  if (fd >= 0) {
+    close (fd);
+    unlink (path);
+  }
+  g_free (path);
+  return ret;
+}
+
+static gboolean
+count_record (guint64 offset, gint64 timestamp_us, const guint8 * data,
+    gsize len, gpointer user_data)
+{
+  return TRUE;
+}
+
+NvDsFileLogWriter *
+nvds_filelog_writer_open (const gchar * dir, gsize segment_size,
+    GError ** error)
+{
+  NvDsFileLogWriter *writer = NULL;
+  GPtrArray *segments = NULL;
+
+  if (g_mkdir_with_parents (dir, 0755) < 0) {
+    set_errno_error (error, errno, "Failed to create", dir);
+    return NULL;
+  }
+
+  writer = g_new0 (NvDsFileLogWriter, 1);
+  writer->dir = g_strdup (dir);
+  writer->segment_size =
+      segment_size ? segment_size : NVDS_FILELOG_DEFAULT_SEGMENT_SIZE;
+  writer->fd = -1;
+
+  /* 마지막 세그먼트의 레코드 수로 다음 offset을 정하고, 새 세그먼트에 이어 씁니다. */
+  segments = nvds_filelog_list_segments (dir);
+  if (segments->len > 0) {
+    const gchar *last =
+        (const gchar *) g_ptr_array_index (segments, segments->len - 1);
+    gsize pos = 0;
+
+    writer->next_offset = nvds_filelog_segment_base (last);
+    if (!nvds_filelog_scan_segment (last, &pos, &writer->next_offset,
+            count_record, NULL, error)) {
+      g_ptr_array_unref (segments);
+      nvds_filelog_writer_close (writer);
+      return NULL;
+    }
+  }
+  g_ptr_array_unref (segments);
+
+  return writer;
+}
+
+gboolean
+nvds_filelog_writer_append (NvDsFileLogWriter * writer, const guint8 * data,
+    gsize len, gint64 timestamp_us, guint64 * offset, GError ** error)
+{
+  gsize size = record_size (len);
+  guint8 *rec = NULL;
+  guint64 ts = GUINT64_TO_LE ((guint64) timestamp_us);
+
+  g_return_val_if_fail (writer && data && len > 0 && len <= G_MAXUINT32,
+      FALSE);
+
+  if (!writer->map || writer->pos + size > writer->map_size) {
+    finish_segment (writer);
+    if (!new_segment (writer, size, error))
+      return FALSE;
+  }
+
+  rec = writer->map + writer->pos;
+  memcpy (rec + 8, &ts, sizeof (ts));
+  memcpy (rec + NVDS_FILELOG_RECORD_HEADER_SIZE, data, len);
+  /* 읽는 쪽이 len을 보면 payload도 보이도록 len을 마지막에 release로 씁니다. */
+  __atomic_store_n ((guint32 *) rec, GUINT32_TO_LE ((guint32) len),
+      __ATOMIC_RELEASE);
+
+  writer->pos += size;
+  if (offset)
+    *offset = writer->next_offset;
+  writer->next_offset++;
+
+  return TRUE;
+}
+
+void
+nvds_filelog_writer_close (NvDsFileLogWriter * writer)
+{
+  if (!writer)
+    return;
+
+  finish_segment (writer);
+  g_free (writer->dir);
+  g_free (writer);
+}
+
+static gint
+compare_segment_path (gconstpointer a, gconstpointer b)
+{
+  /* 이름이 0으로 채운 고정 길이 숫자이므로 문자열 순서가 offset 순서입니다. */
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+GPtrArray *
+nvds_filelog_list_segments (const gchar * dir)
+{
+  GPtrArray *segments = g_ptr_array_new_with_free_func (g_free);
+  GDir *d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  if (!d)
+    return segments;
+
+  while ((name = g_dir_read_name (d))) {
+    if (strlen (name) == 20 + strlen (NVDS_FILELOG_SEGMENT_SUFFIX) &&
+        g_str_has_suffix (name, NVDS_FILELOG_SEGMENT_SUFFIX) &&
+        g_ascii_isdigit (name[0]))
+      g_ptr_array_add (segments, g_build_filename (dir, name, NULL));
+  }
+  g_dir_close (d);
+
+  g_ptr_array_sort (segments, compare_segment_path);
+  return segments;
+}
+
+guint64
+nvds_filelog_segment_base (const gchar * path)
+{
+  gchar *name = g_path_get_basename (path);
+  guint64 base = g_ascii_strtoull (name, NULL, 10);
+
+  g_free (name);
+  return base;
+}
+
+gboolean
+nvds_filelog_scan_segment (const gchar * path, gsize * pos, guint64 * offset,
+    NvDsFileLogRecordFunc func, gpointer user_data, GError ** error)
+{
+  struct stat st;
+  guint8 *map = NULL;
+  gint fd;
+
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    set_errno_error (error, errno, "Failed to open", path);
+    return FALSE;
+  }
+  if (fstat (fd, &st) < 0) {
+    set_errno_error (error, errno, "Failed to stat", path);
+    close (fd);
+    return FALSE;
+  }
+  if (st.st_size == 0) {
+    close (fd);
+    return TRUE;
+  }
+
+  map = (guint8 *) mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if ((void *) map == MAP_FAILED) {
+    set_errno_error (error, errno, "Failed to map", path);
+    return FALSE;
+  }
+
+  while (*pos + NVDS_FILELOG_RECORD_HEADER_SIZE <= (gsize) st.st_size) {
+    const guint8 *rec = map + *pos;
+    guint32 len = GUINT32_FROM_LE (__atomic_load_n ((const guint32 *) rec,
+            __ATOMIC_ACQUIRE));
+    guint64 ts;
+
+    /* 0이면 아직 쓰이지 않은 영역, 크기를 넘으면 잘린 레코드입니다. */
+    if (len == 0 || *pos + record_size (len) > (gsize) st.st_size)
+      break;
+
+    memcpy (&ts, rec + 8, sizeof (ts));
+    if (!func (*offset, (gint64) GUINT64_FROM_LE (ts),
+            rec + NVDS_FILELOG_RECORD_HEADER_SIZE, len, user_data))
+      break;
+
+    *pos += record_size (len);
+    (*offset)++;
+  }
+
+  munmap (map, st.st_size);
+  return TRUE;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __NVDS_FILELOG_H__
+#define __NVDS_FILELOG_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * 토픽별 세그먼트 로그
+ *
+ *  <root>/<topic>/<base offset 20자리>.log
+ *
+ *  segment := record* | 0으로 채워진 미사용 영역
+ *  record  := u32le len | u32 reserved(0) | u64le timestamp_us | payload[len]
+ *             | 0 패딩 (다음 레코드가 8바이트 경계에서 시작하도록)
+ *
+ * - offset은 토픽 안에서 레코드 순번이며 세그먼트 이름은 첫 레코드의 offset입니다.
+ * - 세그먼트는 segment-size로 미리 할당해 mmap으로 씁니다. 닫을 때 실제 길이로 줄입니다.
+ * - 쓰기는 payload를 먼저 쓰고 len을 마지막에 기록하므로, 같은 파일을 읽는 쪽은
+ *   len이 0이 아닌 레코드까지만 읽으면 됩니다.
+ * - 빈 payload는 len 0과 구분되지 않으므로 기록하지 않습니다.
+ */
+
+#define NVDS_FILELOG_SEGMENT_SUFFIX ".log"
+#define NVDS_FILELOG_RECORD_HEADER_SIZE (16)
+#define NVDS_FILELOG_RECORD_ALIGN (8)
+#define NVDS_FILELOG_DEFAULT_SEGMENT_SIZE (64 * 1024 * 1024)
+
+typedef struct _NvDsFileLogWriter NvDsFileLogWriter;
+
+/**
+ * @brief  토픽 디렉터리를 열어 새 세그먼트에 이어 씁니다.
+ *         기존 마지막 세그먼트를 읽어 다음 offset을 정합니다.
+ */
+NvDsFileLogWriter *nvds_filelog_writer_open (const gchar * dir,
+    gsize segment_size, GError ** error);
+
+/**
+ * @brief  레코드 하나를 씁니다. 세그먼트가 차면 새 세그먼트를 만듭니다.
+ * @param  offset [OUT] 기록된 레코드의 offset (NULL 가능)
+ */
+gboolean nvds_filelog_writer_append (NvDsFileLogWriter * writer,
+    const guint8 * data, gsize len, gint64 timestamp_us, guint64 * offset,
+    GError ** error);
+
+/** 현재 세그먼트를 실제 길이로 줄이고 닫습니다. */
+void nvds_filelog_writer_close (NvDsFileLogWriter * writer);
+
+/**
+ * @brief  dir의 세그먼트를 base offset 순으로 나열합니다.
+ * @return 세그먼트 경로(gchar *) 배열. g_ptr_array_unref로 해제합니다.
+ */
+GPtrArray *nvds_filelog_list_segments (const gchar * dir);
+
+/** 세그먼트 경로에서 base offset을 읽습니다. */
+guint64 nvds_filelog_segment_base (const gchar * path);
+
+/** FALSE를 반환하면 읽기를 멈춥니다. */
+typedef gboolean (*NvDsFileLogRecordFunc) (guint64 offset, gint64 timestamp_us,
+    const guint8 * data, gsize len, gpointer user_data);
+
+/**
+ * @brief  세그먼트를 *pos 바이트 위치(레코드 경계)부터 끝까지 읽습니다.
+ *         *pos와 *offset은 마지막으로 읽은 레코드 다음으로 갱신됩니다.
+ * @return 세그먼트를 열 수 없으면 FALSE
+ */
+gboolean nvds_filelog_scan_segment (const gchar * path, gsize * pos,
+    guint64 * offset, NvDsFileLogRecordFunc func, gpointer user_data,
+    GError ** error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
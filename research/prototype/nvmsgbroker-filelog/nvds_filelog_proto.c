@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * 파일 로그 nvmsgbroker 프로토콜 어댑터 (libnvds_filelog_proto.so)
+ *
+ * Kafka 대신 <root>/<topic>/ 아래 세그먼트 로그(nvds_filelog.h)에 payload를 추가합니다.
+ * 브로커 없이 type 6 sink의 publish 경로를 돌려보기 위한 것으로
+ * 지연과 실패를 설정 파일로 흉내낼 수 있습니다.
+ *
+ * conn-str: <root 디렉터리>[;...]    (';' 뒤는 무시)
+ *
+ * [message-broker]
+ * root-dir=/tmp/ds-filelog        # conn-str가 없을 때 사용
+ * segment-size=67108864
+ * latency-ms=5                    # 완료 콜백 / 동기 send 지연
+ * latency-jitter-ms=2             # 0 ~ jitter 만큼 추가 지연
+ * failure-rate=0.01               # 이 비율의 send는 기록하지 않고 NVDS_MSGAPI_ERR
+ * seed=1                          # 실패/jitter 난수 seed, 0이면 임의
+ */
+
+#include <string.h>
+
+#include "nvds_msgapi.h"
+#include "nvds_filelog.h"
+
+#define CONFIG_GROUP_MSG_BROKER "message-broker"
+#define PROTOCOL_NAME "FILELOG"
+#define PROTOCOL_VERSION "4.0"
+
+typedef struct
+{
+  nvds_msgapi_send_cb_t cb;
+  void *user_ptr;
+  NvDsMsgApiErrorType result;
+  /** 콜백을 호출할 시각 (g_get_monotonic_time) */
+  gint64 due_us;
+} NvDsFileLogCompletion;
+
+typedef struct
+{
+  gchar *root;
+  gsize segment_size;
+  guint latency_ms;
+  guint latency_jitter_ms;
+  gdouble failure_rate;
+
+  GMutex lock;
+  GRand *rand;
+  /** topic -> NvDsFileLogWriter */
+  GHashTable *writers;
+  /** 아직 호출하지 않은 send_async 완료 */
+  GQueue completions;
+} NvDsFileLogConn;
+
+static gboolean
+parse_config (NvDsFileLogConn * conn, const gchar * config_path,
+    guint32 * seed)
+{
+  GKeyFile *key_file = NULL;
+  GError *error = NULL;
+  gboolean ret = FALSE;
+
+  if (!config_path || !*config_path)
+    return TRUE;
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, config_path, G_KEY_FILE_NONE,
+          &error)) {
+    g_printerr ("filelog: failed to load %s: %s\n", config_path,
+        error->message);
+    goto done;
+  }
+
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_MSG_BROKER)) {
+    ret = TRUE;
+    goto done;
+  }
+
+  if (!conn->root)
+    conn->root = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
+        "root-dir", NULL);
+  if (g_key_file_has_key (key_file, CONFIG_GROUP_MSG_BROKER, "segment-size",
+          NULL))
+    conn->segment_size = g_key_file_get_uint64 (key_file,
+        CONFIG_GROUP_MSG_BROKER, "segment-size", NULL);
+  conn->latency_ms = g_key_file_get_integer (key_file,
+      CONFIG_GROUP_MSG_BROKER, "latency-ms", NULL);
+  conn->latency_jitter_ms = g_key_file_get_integer (key_file,
+      CONFIG_GROUP_MSG_BROKER, "latency-jitter-ms", NULL);
+  conn->failure_rate = g_key_file_get_double (key_file,
+      CONFIG_GROUP_MSG_BROKER, "failure-rate", NULL);
+  *seed = g_key_file_get_integer (key_file, CONFIG_GROUP_MSG_BROKER, "seed",
+      NULL);
+  ret = TRUE;
+
+done:
+  if (error)
+    g_error_free (error);
+  g_key_file_free (key_file);
+  return ret;
+}
+
+static void
+free_conn (NvDsFileLogConn * conn)
+{
+  g_hash_table_destroy (conn->writers);
+  g_queue_clear_full (&conn->completions, g_free);
+  if (conn->rand)
+    g_rand_free (conn->rand);
+  g_mutex_clear (&conn->lock);
+  g_free (conn->root);
+  g_free (conn);
+}
+
+static gboolean
+valid_topic (const gchar * topic)
+{
+  return topic && *topic && !strchr (topic, '/') && strcmp (topic, ".") &&
+      strcmp (topic, "..");
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static gint64
+next_latency_us (NvDsFileLogConn * conn)
+{
+  gint64 latency_us = (gint64) conn->latency_ms * 1000;
+
+  if (conn->latency_jitter_ms)
+    latency_us += g_rand_int_range (conn->rand, 0,
+        conn->latency_jitter_ms * 1000 + 1);
+  return latency_us;
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static NvDsMsgApiErrorType
+append_locked (NvDsFileLogConn * conn, const gchar * topic,
+    const uint8_t * payload, size_t nbuf)
+{
+  NvDsFileLogWriter *writer = NULL;
+  GError *error = NULL;
+
+  if (!valid_topic (topic))
+    return NVDS_MSGAPI_UNKNOWN_TOPIC;
+  if (!payload || nbuf == 0)
+    return NVDS_MSGAPI_ERR;
+
+  if (conn->failure_rate > 0 && g_rand_double (conn->rand) < conn->failure_rate)
+    return NVDS_MSGAPI_ERR;
+
+  writer = (NvDsFileLogWriter *) g_hash_table_lookup (conn->writers, topic);
+  if (!writer) {
+    gchar *dir = g_build_filename (conn->root, topic, NULL);
+
+    writer = nvds_filelog_writer_open (dir, conn->segment_size, &error);
+    g_free (dir);
+    if (!writer)
+      goto error;
+    g_hash_table_insert (conn->writers, g_strdup (topic), writer);
+  }
+
+  if (!nvds_filelog_writer_append (writer, payload, nbuf,
+          g_get_real_time (), NULL, &error))
+    goto error;
+
+  return NVDS_MSGAPI_OK;
+
+error:
+  g_printerr ("filelog: topic '%s': %s\n", topic, error->message);
+  g_error_free (error);
+  return NVDS_MSGAPI_ERR;
+}
+
+NvDsMsgApiHandle
+nvds_msgapi_connect (char *connection_str, nvds_msgapi_connect_cb_t connect_cb,
+    char *config_path)
+{
+  NvDsFileLogConn *conn = g_new0 (NvDsFileLogConn, 1);
+  guint32 seed = 0;
+
+  g_mutex_init (&conn->lock);
+  g_queue_init (&conn->completions);
+  conn->writers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) nvds_filelog_writer_close);
+  conn->segment_size = NVDS_FILELOG_DEFAULT_SEGMENT_SIZE;
+
+  if (connection_str && *connection_str) {
+    gchar **fields = g_strsplit (connection_str, ";", 2);
+
+    if (fields[0] && *fields[0])
+      conn->root = g_strdup (fields[0]);
+    g_strfreev (fields);
+  }
+
+  if (!parse_config (conn, config_path, &seed))
+    goto error;
+
+  if (!conn->root) {
+    g_printerr ("filelog: no root directory in connection string or %s\n",
+        CONFIG_GROUP_MSG_BROKER "/root-dir");
+    goto error;
+  }
+  if (g_mkdir_with_parents (conn->root, 0755) < 0) {
+    g_printerr ("filelog: failed to create %s\n", conn->root);
+    goto error;
+  }
+
+  conn->rand = seed ? g_rand_new_with_seed (seed) : g_rand_new ();
+  return (NvDsMsgApiHandle) conn;
+
+error:
+  free_conn (conn);
+  return NULL;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_send (NvDsMsgApiHandle h_ptr, char *topic, const uint8_t * payload,
+    size_t nbuf)
+{
+  NvDsFileLogConn *conn = (NvDsFileLogConn *) h_ptr;
+  NvDsMsgApiErrorType result;
+  gint64 latency_us;
+
+  g_return_val_if_fail (conn, NVDS_MSGAPI_ERR);
+
+  g_mutex_lock (&conn->lock);
+  result = append_locked (conn, topic, payload, nbuf);
+  latency_us = next_latency_us (conn);
+  g_mutex_unlock (&conn->lock);
+
+  if (latency_us > 0)
+    g_usleep (latency_us);
+  return result;
+}
+
+/**
+ * 기록은 바로 하고, 완료 콜백은 지연 시간이 지난 뒤 do_work에서 호출합니다.
+ * 잘못된 topic은 콜백 없이 바로 반환합니다.
+ */
+NvDsMsgApiErrorType
+nvds_msgapi_send_async (NvDsMsgApiHandle h_ptr, char *topic,
+    const uint8_t * payload, size_t nbuf, nvds_msgapi_send_cb_t send_callback,
+    void *user_ptr)
+{
+  NvDsFileLogConn *conn = (NvDsFileLogConn *) h_ptr;
+  NvDsFileLogCompletion *completion = NULL;
+  NvDsMsgApiErrorType result;
+
+  g_return_val_if_fail (conn, NVDS_MSGAPI_ERR);
+
+  g_mutex_lock (&conn->lock);
+  result = append_locked (conn, topic, payload, nbuf);
+  if (result != NVDS_MSGAPI_UNKNOWN_TOPIC && send_callback) {
+    completion = g_new (NvDsFileLogCompletion, 1);
+    completion->cb = send_callback;
+    completion->user_ptr = user_ptr;
+    completion->result = result;
+    completion->due_us = g_get_monotonic_time () + next_latency_us (conn);
+    g_queue_push_tail (&conn->completions, completion);
+  }
+  g_mutex_unlock (&conn->lock);
+
+  return result == NVDS_MSGAPI_UNKNOWN_TOPIC ? result : NVDS_MSGAPI_OK;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_subscribe (NvDsMsgApiHandle h_ptr, char **topics, int num_topics,
+    nvds_msgapi_subscribe_request_cb_t cb, void *user_ctx)
+{
+  g_printerr ("filelog: subscribe is not supported\n");
+  return NVDS_MSGAPI_ERR;
+}
+
+/* 호출 시각이 지난 완료를 lock 밖에서 호출합니다. all이면 시각과 관계없이 모두 호출합니다. */
+static void
+dispatch_completions (NvDsFileLogConn * conn, gboolean all)
+{
+  GQueue due = G_QUEUE_INIT;
+  gint64 now_us = g_get_monotonic_time ();
+  GList *l, *next;
+  NvDsFileLogCompletion *completion;
+
+  g_mutex_lock (&conn->lock);
+  for (l = conn->completions.head; l; l = next) {
+    next = l->next;
+    completion = (NvDsFileLogCompletion *) l->data;
+    if (all || completion->due_us <= now_us) {
+      g_queue_unlink (&conn->completions, l);
+      g_queue_push_tail_link (&due, l);
+    }
+  }
+  g_mutex_unlock (&conn->lock);
+
+  while ((completion = (NvDsFileLogCompletion *) g_queue_pop_head (&due))) {
+    completion->cb (completion->user_ptr, completion->result);
+    g_free (completion);
+  }
+}
+
+void
+nvds_msgapi_do_work (NvDsMsgApiHandle h_ptr)
+{
+  NvDsFileLogConn *conn = (NvDsFileLogConn *) h_ptr;
+
+  if (!conn)
+    return;
+  dispatch_completions (conn, FALSE);
+}
+
+/* 남은 완료 콜백을 모두 호출한 뒤 세그먼트를 닫습니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_disconnect (NvDsMsgApiHandle h_ptr)
+{
+  NvDsFileLogConn *conn = (NvDsFileLogConn *) h_ptr;
+
+  if (!conn)
+    return NVDS_MSGAPI_ERR;
+
+  dispatch_completions (conn, TRUE);
+  free_conn (conn);
+  return NVDS_MSGAPI_OK;
+}
+
+char *
+nvds_msgapi_getversion (void)
+{
+  return (char *) PROTOCOL_VERSION;
+}
+
+char *
+nvds_msgapi_get_protocol_name (void)
+{
+  return (char *) PROTOCOL_NAME;
+}
+
+/* 연결을 공유하지 않으므로 항상 빈 문자열입니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_connection_signature (char *broker_str, char *cfg,
+    char *output_str, int max_len)
+{
+  if (!output_str || max_len <= 0)
+    return NVDS_MSGAPI_ERR;
+  output_str[0] = '\0';
+  return NVDS_MSGAPI_OK;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * 토픽 디렉터리의 세그먼트 로그를 offset 순으로 출력합니다.
+ *
+ *   nvds-filelog-read /tmp/ds-filelog/ds-events            # offset, 시각, payload
+ *   nvds-filelog-read -o 1000 -f /tmp/ds-filelog/ds-events  # 1000부터, 이어서 대기
+ *   nvds-filelog-read -r /tmp/ds-filelog/ds-events | nvds-binary-decode
+ *   nvds-filelog-read -s /tmp/ds-filelog/ds-events          # 레코드 수/크기/속도
+ */
+
+#include <stdio.h>
+
+#include "nvds_filelog.h"
+
+#define FOLLOW_POLL_US (100 * 1000)
+
+static gint64 start_offset = 0;
+static gboolean follow = FALSE;
+static gboolean raw = FALSE;
+static gboolean stats_only = FALSE;
+
+GOptionEntry entries[] = {
+  {"offset", 'o', 0, G_OPTION_ARG_INT64, &start_offset,
+      "Start from this record offset", NULL},
+  {"follow", 'f', 0, G_OPTION_ARG_NONE, &follow,
+      "Keep waiting for new records", NULL},
+  {"raw", 'r', 0, G_OPTION_ARG_NONE, &raw,
+      "Write payloads back to back without framing", NULL},
+  {"stats", 's', 0, G_OPTION_ARG_NONE, &stats_only,
+      "Print record count, bytes and publish rate only", NULL},
+  {NULL},
+};
+
+typedef struct
+{
+  guint64 records;
+  guint64 bytes;
+  gint64 first_us;
+  gint64 last_us;
+} ReadStats;
+
+static gboolean
+print_record (guint64 offset, gint64 timestamp_us, const guint8 * data,
+    gsize len, gpointer user_data)
+{
+  ReadStats *stats = (ReadStats *) user_data;
+
+  if (offset < (guint64) start_offset)
+    return TRUE;
+
+  if (!stats->records)
+    stats->first_us = timestamp_us;
+  stats->last_us = timestamp_us;
+  stats->records++;
+  stats->bytes += len;
+
+  if (stats_only)
+    return TRUE;
+
+  if (raw) {
+    fwrite (data, 1, len, stdout);
+  } else {
+    g_print ("%" G_GUINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%.*s\n", offset,
+        timestamp_us, (gint) len, (const gchar *) data);
+  }
+  return TRUE;
+}
+
+/* start_offset이 들어 있는 세그먼트의 인덱스 */
+static guint
+first_segment (GPtrArray * segments)
+{
+  guint i;
+
+  for (i = segments->len; i > 0; i--) {
+    if (nvds_filelog_segment_base ((const gchar *)
+            g_ptr_array_index (segments, i - 1)) <= (guint64) start_offset)
+      return i - 1;
+  }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  GPtrArray *segments = NULL;
+  ReadStats stats = { 0 };
+  gchar *current = NULL;
+  gsize pos = 0;
+  guint64 offset = 0;
+  guint index = 0;
+  int ret = -1;
+
+  ctx = g_option_context_new ("TOPIC_DIR - read a file log topic");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    goto done;
+  }
+  if (argc != 2) {
+    g_printerr ("Usage: %s [OPTION...] TOPIC_DIR\n", g_get_prgname ());
+    goto done;
+  }
+
+  /*
+   * 세그먼트를 차례로 읽습니다. 다음 세그먼트가 생겼으면 현재 세그먼트는 더 늘지 않으므로
+   * 한 번 더 끝까지 읽은 뒤 넘어갑니다.
+   */
+  while (TRUE) {
+    gboolean has_next;
+
+    segments = nvds_filelog_list_segments (argv[1]);
+    if (!current && segments->len > 0) {
+      index = first_segment (segments);
+      current = g_strdup ((const gchar *) g_ptr_array_index (segments, index));
+      offset = nvds_filelog_segment_base (current);
+      pos = 0;
+    }
+
+    if (current) {
+      has_next = index + 1 < segments->len;
+      if (!nvds_filelog_scan_segment (current, &pos, &offset, print_record,
+              &stats, &error)) {
+        g_printerr ("%s\n", error->message);
+        goto done;
+      }
+      if (has_next) {
+        g_free (current);
+        index++;
+        current = g_strdup ((const gchar *) g_ptr_array_index (segments, index));
+        offset = nvds_filelog_segment_base (current);
+        pos = 0;
+        g_ptr_array_unref (segments);
+        segments = NULL;
+        continue;
+      }
+    }
+
+    g_ptr_array_unref (segments);
+    segments = NULL;
+    if (!follow)
+      break;
+    fflush (stdout);
+    g_usleep (FOLLOW_POLL_US);
+  }
+
+  if (stats_only) {
+    gdouble seconds = (stats.last_us - stats.first_us) / 1e6;
+
+    g_print ("records: %" G_GUINT64_FORMAT "\n", stats.records);
+    g_print ("payload bytes: %" G_GUINT64_FORMAT "\n", stats.bytes);
+    if (seconds > 0) {
+      g_print ("span: %.3f s\n", seconds);
+      g_print ("records/s: %.1f\n", stats.records / seconds);
+      g_print ("MB/s: %.2f\n", stats.bytes / seconds / (1024 * 1024));
+    }
+  }
+
+  ret = 0;
+done:
+  if (error)
+    g_error_free (error);
+  if (segments)
+    g_ptr_array_unref (segments);
+  g_free (current);
+  if (ctx)
+    g_option_context_free (ctx);
+  return ret;
+}
@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * nvds_msgapi 경로(libnvds_filelog_proto)와 세그먼트 로그 테스트, send_async 벤치마크
+ *
+ *   make check   테스트 실행
+ *   make bench   -m perf 로 벤치마크까지 실행
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "nvds_msgapi.h"
+#include "nvds_filelog.h"
+
+#define TOPIC "events"
+
+typedef struct
+{
+  gchar *root;
+  gchar *config;
+} Fixture;
+
+typedef struct
+{
+  guint ok;
+  guint err;
+} Completions;
+
+static void
+remove_tree (const gchar * path)
+{
+  GDir *d = g_dir_open (path, 0, NULL);
+  const gchar *name;
+
+  if (d) {
+    while ((name = g_dir_read_name (d))) {
+      gchar *child = g_build_filename (path, name, NULL);
+      remove_tree (child);
+      g_free (child);
+    }
+    g_dir_close (d);
+    g_rmdir (path);
+  } else {
+    g_remove (path);
+  }
+}
+
+static void
+fixture_set_up (Fixture * fixture, gconstpointer data)
+{
+  GError *error = NULL;
+
+  fixture->root = g_dir_make_tmp ("filelog-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->config = g_build_filename (fixture->root, "cfg_filelog.txt", NULL);
+  /* 데이터 없이 쓰면 설정 파일 없이 연결합니다. */
+  if (data)
+    g_assert_true (g_file_set_contents (fixture->config,
+            (const gchar *) data, -1, NULL));
+}
+
+static void
+fixture_tear_down (Fixture * fixture, gconstpointer data)
+{
+  remove_tree (fixture->root);
+  g_free (fixture->config);
+  g_free (fixture->root);
+}
+
+static NvDsMsgApiHandle
+connect_fixture (Fixture * fixture, gconstpointer data)
+{
+  gchar *conn_str = g_strdup_printf ("%s;ignored", fixture->root);
+  NvDsMsgApiHandle handle;
+
+  handle = nvds_msgapi_connect (conn_str, NULL,
+      data ? fixture->config : NULL);
+  g_assert_nonnull (handle);
+  g_free (conn_str);
+  return handle;
+}
+
+static void
+on_complete (void *user_ptr, NvDsMsgApiErrorType flag)
+{
+  Completions *completions = (Completions *) user_ptr;
+
+  if (flag == NVDS_MSGAPI_OK)
+    completions->ok++;
+  else
+    completions->err++;
+}
+
+typedef struct
+{
+  guint64 first_offset;
+  GPtrArray *payloads;
+} ReadResult;
+
+static gboolean
+collect_record (guint64 offset, gint64 timestamp_us, const guint8 * data,
+    gsize len, gpointer user_data)
+{
+  ReadResult *result = (ReadResult *) user_data;
+
+  g_assert_cmpuint (offset, ==, result->first_offset + result->payloads->len);
+  g_assert_cmpint (timestamp_us, >, 0);
+  g_ptr_array_add (result->payloads, g_strndup ((const gchar *) data, len));
+  return TRUE;
+}
+
+/* 토픽의 모든 세그먼트를 offset 순으로 읽습니다. */
+static GPtrArray *
+read_topic (Fixture * fixture, guint * num_segments)
+{
+  gchar *dir = g_build_filename (fixture->root, TOPIC, NULL);
+  GPtrArray *segments = nvds_filelog_list_segments (dir);
+  ReadResult result = { 0, g_ptr_array_new_with_free_func (g_free) };
+  guint64 offset = 0;
+  guint i;
+
+  for (i = 0; i < segments->len; i++) {
+    const gchar *path = (const gchar *) g_ptr_array_index (segments, i);
+    gsize pos = 0;
+
+    /* 세그먼트 이름은 이전 세그먼트의 마지막 레코드 다음 offset입니다. */
+    g_assert_cmpuint (nvds_filelog_segment_base (path), ==, offset);
+    g_assert_true (nvds_filelog_scan_segment (path, &pos, &offset,
+            collect_record, &result, NULL));
+  }
+  if (num_segments)
+    *num_segments = segments->len;
+
+  g_ptr_array_unref (segments);
+  g_free (dir);
+  return result.payloads;
+}
+
+static void
+send_text (NvDsMsgApiHandle handle, const gchar * text, Completions * c)
+{
+  NvDsMsgApiErrorType ret;
+
+  if (c)
+    ret = nvds_msgapi_send_async (handle, (char *) TOPIC,
+        (const uint8_t *) text, strlen (text), on_complete, c);
+  else
+    ret = nvds_msgapi_send (handle, (char *) TOPIC, (const uint8_t *) text,
+        strlen (text));
+  g_assert_cmpint (ret, ==, NVDS_MSGAPI_OK);
+}
+
+static void
+test_send_and_read (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+  Completions c = { 0, 0 };
+  GPtrArray *payloads;
+  gchar text[32];
+  guint i;
+
+  for (i = 0; i < 6; i++) {
+    g_snprintf (text, sizeof (text), "payload-%u", i);
+    send_text (handle, text, i % 2 ? &c : NULL);
+  }
+  /* latency-ms 0 이면 다음 do_work에서 완료됩니다. */
+  nvds_msgapi_do_work (handle);
+  g_assert_cmpuint (c.ok, ==, 3);
+  g_assert_cmpint (nvds_msgapi_disconnect (handle), ==, NVDS_MSGAPI_OK);
+
+  payloads = read_topic (fixture, NULL);
+  g_assert_cmpuint (payloads->len, ==, 6);
+  for (i = 0; i < 6; i++) {
+    g_snprintf (text, sizeof (text), "payload-%u", i);
+    g_assert_cmpstr ((const gchar *) g_ptr_array_index (payloads, i), ==,
+        text);
+  }
+  g_ptr_array_unref (payloads);
+}
+
+static void
+test_async_latency (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+  Completions c = { 0, 0 };
+
+  send_text (handle, "late", &c);
+  nvds_msgapi_do_work (handle);
+  g_assert_cmpuint (c.ok, ==, 0);
+
+  g_usleep (300 * 1000);
+  nvds_msgapi_do_work (handle);
+  g_assert_cmpuint (c.ok, ==, 1);
+
+  /* disconnect는 지연과 관계없이 남은 완료를 모두 호출합니다. */
+  send_text (handle, "pending", &c);
+  nvds_msgapi_disconnect (handle);
+  g_assert_cmpuint (c.ok, ==, 2);
+}
+
+static void
+test_failure_rate (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+  Completions c = { 0, 0 };
+  GPtrArray *payloads;
+  guint i;
+
+  /* send_async는 실패해도 OK를 반환하고 결과는 완료 콜백으로만 알립니다. */
+  for (i = 0; i < 10; i++)
+    send_text (handle, "dropped", &c);
+  g_assert_cmpint (nvds_msgapi_send (handle, (char *) TOPIC,
+          (const uint8_t *) "x", 1), ==, NVDS_MSGAPI_ERR);
+  nvds_msgapi_disconnect (handle);
+  g_assert_cmpuint (c.ok, ==, 0);
+  g_assert_cmpuint (c.err, ==, 10);
+
+  payloads = read_topic (fixture, NULL);
+  g_assert_cmpuint (payloads->len, ==, 0);
+  g_ptr_array_unref (payloads);
+}
+
+static void
+test_invalid_send (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+  Completions c = { 0, 0 };
+
+  g_assert_cmpint (nvds_msgapi_send_async (handle, (char *) "../escape",
+          (const uint8_t *) "x", 1, on_complete, &c), ==,
+      NVDS_MSGAPI_UNKNOWN_TOPIC);
+  g_assert_cmpint (nvds_msgapi_send (handle, (char *) "a/b",
+          (const uint8_t *) "x", 1), ==, NVDS_MSGAPI_UNKNOWN_TOPIC);
+  /* 빈 payload는 기록하지 않고 실패로 완료합니다. */
+  g_assert_cmpint (nvds_msgapi_send_async (handle, (char *) TOPIC,
+          (const uint8_t *) "", 0, on_complete, &c), ==, NVDS_MSGAPI_OK);
+  g_assert_cmpint (nvds_msgapi_subscribe (handle, NULL, 0, NULL, NULL), ==,
+      NVDS_MSGAPI_ERR);
+  nvds_msgapi_disconnect (handle);
+  g_assert_cmpuint (c.ok, ==, 0);
+  g_assert_cmpuint (c.err, ==, 1);
+}
+
+/* 다시 연결하면 마지막 offset 다음부터 새 세그먼트에 이어 씁니다. */
+static void
+test_reconnect (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle;
+  GPtrArray *payloads;
+  gchar text[32];
+  guint i, round, num_segments;
+
+  for (round = 0; round < 3; round++) {
+    handle = connect_fixture (fixture, data);
+    for (i = 0; i < 4; i++) {
+      g_snprintf (text, sizeof (text), "%u-%u", round, i);
+      send_text (handle, text, NULL);
+    }
+    nvds_msgapi_disconnect (handle);
+  }
+
+  payloads = read_topic (fixture, &num_segments);
+  g_assert_cmpuint (num_segments, ==, 3);
+  g_assert_cmpuint (payloads->len, ==, 12);
+  g_assert_cmpstr ((const gchar *) g_ptr_array_index (payloads, 4), ==, "1-0");
+  g_assert_cmpstr ((const gchar *) g_ptr_array_index (payloads, 11), ==,
+      "2-3");
+  g_ptr_array_unref (payloads);
+}
+
+/* segment-size보다 많이 쓰면 세그먼트가 나뉘고, 큰 payload는 한 세그먼트를 차지합니다. */
+static void
+test_segment_roll (Fixture * fixture, gconstpointer data)
+{
+  NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+  GPtrArray *payloads;
+  gchar *big = g_strnfill (10000, 'b');
+  gchar text[1001];
+  guint i, num_segments;
+
+  for (i = 0; i < 20; i++) {
+    memset (text, 'a' + i, sizeof (text) - 1);
+    text[sizeof (text) - 1] = '\0';
+    send_text (handle, i == 10 ? big : text, NULL);
+  }
+  nvds_msgapi_disconnect (handle);
+
+  payloads = read_topic (fixture, &num_segments);
+  g_assert_cmpuint (payloads->len, ==, 20);
+  g_assert_cmpuint (num_segments, >=, 6);
+  g_assert_cmpstr ((const gchar *) g_ptr_array_index (payloads, 10), ==, big);
+  g_assert_cmpuint (strlen ((const gchar *) g_ptr_array_index (payloads, 19)),
+      ==, 1000);
+  g_ptr_array_unref (payloads);
+  g_free (big);
+}
+
+/* 닫지 않은(비정상 종료한) 세그먼트는 기록된 레코드까지만 읽힙니다. */
+static void
+test_unclosed_segment (Fixture * fixture, gconstpointer data)
+{
+  gchar *dir = g_build_filename (fixture->root, TOPIC, NULL);
+  NvDsFileLogWriter *writer = nvds_filelog_writer_open (dir, 65536, NULL);
+  GPtrArray *payloads;
+  guint64 offset;
+  guint i;
+
+  g_assert_nonnull (writer);
+  for (i = 0; i < 3; i++) {
+    g_assert_true (nvds_filelog_writer_append (writer,
+            (const guint8 *) "abc", 3, g_get_real_time (), &offset, NULL));
+    g_assert_cmpuint (offset, ==, i);
+  }
+
+  payloads = read_topic (fixture, NULL);
+  g_assert_cmpuint (payloads->len, ==, 3);
+  g_ptr_array_unref (payloads);
+
+  nvds_filelog_writer_close (writer);
+  g_free (dir);
+}
+
+/*
+ * send_async + 주기적 do_work 처리량. nvmsgbroker처럼 한 스레드가 보내고
+ * 100건마다 do_work를 부릅니다.
+ */
+static void
+bench_send_async (Fixture * fixture, gconstpointer data)
+{
+  static const gsize sizes[] = { 256, 4096 };
+  guint8 *payload = (guint8 *) g_malloc (4096);
+  guint s, i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    g_free (payload);
+    return;
+  }
+
+  memset (payload, 'x', 4096);
+  for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+    NvDsMsgApiHandle handle = connect_fixture (fixture, data);
+    Completions c = { 0, 0 };
+    guint n = 200000;
+    gdouble elapsed;
+
+    g_test_timer_start ();
+    for (i = 0; i < n; i++) {
+      nvds_msgapi_send_async (handle, (char *) TOPIC, payload, sizes[s],
+          on_complete, &c);
+      if (i % 100 == 99)
+        nvds_msgapi_do_work (handle);
+    }
+    nvds_msgapi_disconnect (handle);
+    elapsed = g_test_timer_elapsed ();
+    g_assert_cmpuint (c.ok, ==, n);
+
+    g_test_minimized_result (elapsed * 1e9 / n,
+        "send_async %" G_GSIZE_FORMAT " B: %.0f ns/msg, %.0f msg/s, %.1f MB/s",
+        sizes[s], elapsed * 1e9 / n, n / elapsed,
+        n * sizes[s] / elapsed / (1024 * 1024));
+  }
+  g_free (payload);
+}
+
+#define ADD_TEST(path, func, config) \
+  g_test_add (path, Fixture, config, fixture_set_up, func, fixture_tear_down)
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  ADD_TEST ("/filelog/msgapi/send-and-read", test_send_and_read, NULL);
+  ADD_TEST ("/filelog/msgapi/async-latency", test_async_latency,
+      "[message-broker]\nlatency-ms=100\nlatency-jitter-ms=50\nseed=1\n");
+  ADD_TEST ("/filelog/msgapi/failure-rate", test_failure_rate,
+      "[message-broker]\nfailure-rate=1.0\nseed=1\n");
+  ADD_TEST ("/filelog/msgapi/invalid-send", test_invalid_send, NULL);
+  ADD_TEST ("/filelog/msgapi/reconnect", test_reconnect, NULL);
+  ADD_TEST ("/filelog/msgapi/segment-roll", test_segment_roll,
+      "[message-broker]\nsegment-size=4096\n");
+  ADD_TEST ("/filelog/unclosed-segment", test_unclosed_segment, NULL);
+  ADD_TEST ("/filelog/bench/send-async", bench_send_async,
+      "[message-broker]\nsegment-size=16777216\n");
+
+  return g_test_run ();
+}
@@ -0,0 +1,740 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "nvds_spool.h"
+
+#define CURSOR_FILE "cursor"
+
+typedef struct
+{
+  guint64 seq;
+  guint64 size;
+  guint64 records;
+} NvDsSpoolSegment;
+
+struct _NvDsSpool
+{
+  gchar *dir;
+  gsize segment_size;
+  guint64 max_size;
+
+  /** NvDsSpoolSegment, seq 순. 마지막 세그먼트에만 씁니다. */
+  GQueue segments;
+  guint64 total_size;
+  gint write_fd;
+
+  NvDsSpoolPos read;
+  NvDsSpoolPos commit;
+  gint read_fd;
+  guint64 read_fd_seq;
+
+  GByteArray *buffer;
+  GString *topic;
+  /** sync 이후 쓰기나 commit이 있었는지 */
+  gboolean dirty;
+
+  guint64 appended;
+  guint64 evicted;
+  guint64 corrupt;
+};
+
+static guint32 crc32c_table[256];
+
+static void
+crc32c_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    guint32 i, k, c;
+
+    for (i = 0; i < 256; i++) {
+      c = i;
+      for (k = 0; k < 8; k++)
+        c = (c & 1) ? 0x82F63B78 ^ (c >> 1) : c >> 1;
+      crc32c_table[i] = c;
+    }
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+static guint32
+crc32c (const guint8 * data, gsize len)
+{
+  guint32 c = ~0U;
+
+  while (len--)
+    c = crc32c_table[(c ^ *data++) & 0xff] ^ (c >> 8);
+  return ~c;
+}
+
+static void
+set_errno_error (GError ** error, gint err, const gchar * what,
+    const gchar * path)
+{
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (err),
+      "%s '%s': %s", what, path, g_strerror (err));
+}
+
+static gchar *
+segment_path (NvDsSpool * spool, guint64 seq)
+{
+  return g_strdup_printf ("%s/%020" G_GUINT64_FORMAT NVDS_SPOOL_SEGMENT_SUFFIX,
+      spool->dir, seq);
+}
+
+static gboolean
+pread_full (gint fd, guint8 * buf, gsize len, guint64 offset)
+{
+  while (len > 0) {
+    gssize n = pread (fd, buf, len, offset);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return TRUE;
+}
+
+static gboolean
+write_full (gint fd, const guint8 * buf, gsize len)
+{
+  while (len > 0) {
+    gssize n = write (fd, buf, len);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return FALSE;
+    buf += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static NvDsSpoolSegment *
+find_segment (NvDsSpool * spool, guint64 seq)
+{
+  GList *l;
+
+  for (l = spool->segments.head; l; l = l->next) {
+    NvDsSpoolSegment *seg = (NvDsSpoolSegment *) l->data;
+    if (seg->seq == seq)
+      return seg;
+  }
+  return NULL;
+}
+
+static void
+set_pos (NvDsSpoolPos * pos, guint64 seq, guint64 offset, guint64 index)
+{
+  pos->seq = seq;
+  pos->pos = offset;
+  pos->index = index;
+}
+
+static void
+close_read_fd (NvDsSpool * spool)
+{
+  if (spool->read_fd >= 0)
+    close (spool->read_fd);
+  spool->read_fd = -1;
+}
+
+/*
+ * 레코드 하나를 읽어 검사합니다. 잘리거나 CRC가 맞지 않으면 FALSE.
+ * 성공하면 spool->buffer에 body가 들어 있습니다.
+ */
+static gboolean
+load_record (NvDsSpool * spool, gint fd, guint64 pos, guint64 size,
+    guint32 * body_len)
+{
+  guint8 header[NVDS_SPOOL_RECORD_HEADER_SIZE];
+  guint32 len, crc;
+
+  if (pos + NVDS_SPOOL_RECORD_HEADER_SIZE > size ||
+      !pread_full (fd, header, sizeof (header), pos))
+    return FALSE;
+
+  memcpy (&len, header, 4);
+  memcpy (&crc, header + 4, 4);
+  len = GUINT32_FROM_LE (len);
+  crc = GUINT32_FROM_LE (crc);
+  if (len < 2 || len > NVDS_SPOOL_MAX_RECORD_SIZE ||
+      pos + NVDS_SPOOL_RECORD_HEADER_SIZE + len > size)
+    return FALSE;
+
+  g_byte_array_set_size (spool->buffer, len);
+  if (!pread_full (fd, spool->buffer->data, len,
+          pos + NVDS_SPOOL_RECORD_HEADER_SIZE))
+    return FALSE;
+  if (crc32c (spool->buffer->data, len) != crc)
+    return FALSE;
+
+  *body_len = len;
+  return TRUE;
+}
+
+static gboolean
+write_segment_header (gint fd)
+{
+  guint8 header[NVDS_SPOOL_SEGMENT_HEADER_SIZE] =
+      { 'D', 'S', 'S', 'P', NVDS_SPOOL_VERSION, 0, 0, 0 };
+
+  return write_full (fd, header, sizeof (header));
+}
+
+static gboolean
+check_segment_header (gint fd)
+{
+  guint8 header[NVDS_SPOOL_SEGMENT_HEADER_SIZE];
+
+  return pread_full (fd, header, sizeof (header), 0) && header[0] == 'D' &&
+      header[1] == 'S' && header[2] == 'S' && header[3] == 'P' &&
+      header[4] == NVDS_SPOOL_VERSION;
+}
+
+/*
+ * 세그먼트의 레코드를 검사하고 잘못된 첫 레코드부터 잘라냅니다.
+ * 헤더가 잘못된 세그먼트는 비어 있는 것으로 다시 씁니다.
+ */
+static gboolean
+recover_segment (NvDsSpool * spool, NvDsSpoolSegment * seg, GError ** error)
+{
+  gchar *path = segment_path (spool, seg->seq);
+  struct stat st;
+  guint64 pos = NVDS_SPOOL_SEGMENT_HEADER_SIZE;
+  guint32 len;
+  gboolean ret = FALSE;
+  gint fd;
+
+  fd = open (path, O_RDWR | O_CLOEXEC);
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    set_errno_error (error, errno, "Failed to open", path);
+    goto done;
+  }
+
+  if (!check_segment_header (fd)) {
+    g_printerr ("spool: %s: bad header, resetting segment\n", path);
+    if (ftruncate (fd, 0) < 0 || !write_segment_header (fd)) {
+      set_errno_error (error, errno, "Failed to reset", path);
+      goto done;
+    }
+    st.st_size = NVDS_SPOOL_SEGMENT_HEADER_SIZE;
+  }
+
+  while (load_record (spool, fd, pos, st.st_size, &len)) {
+    pos += NVDS_SPOOL_RECORD_HEADER_SIZE + len;
+    seg->records++;
+  }
+
+  if (pos < (guint64) st.st_size) {
+    g_printerr ("spool: %s: dropping %" G_GUINT64_FORMAT
+        " bytes after the last valid record\n", path, st.st_size - pos);
+    spool->corrupt++;
+    if (ftruncate (fd, pos) < 0) {
+      set_errno_error (error, errno, "Failed to truncate", path);
+      goto done;
+    }
+  }
+
+  seg->size = pos;
+  ret = TRUE;
+
+done:
+  if (fd >= 0)
+    close (fd);
+  g_free (path);
+  return ret;
+}
+
+static gboolean
+new_segment (NvDsSpool * spool, guint64 seq, GError ** error)
+{
+  gchar *path = segment_path (spool, seq);
+  NvDsSpoolSegment *seg = NULL;
+  gint fd;
+
+  fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0 || !write_segment_header (fd)) {
+    set_errno_error (error, errno, "Failed to create", path);
+    if (fd >= 0)
+      close (fd);
+    g_free (path);
+    return FALSE;
+  }
+  g_free (path);
+
+  /* 이전 세그먼트는 더 이상 쓰지 않으므로 디스크에 반영해 둡니다. */
+  if (spool->write_fd >= 0) {
+    fdatasync (spool->write_fd);
+    close (spool->write_fd);
+  }
+  spool->write_fd = fd;
+
+  seg = g_new0 (NvDsSpoolSegment, 1);
+  seg->seq = seq;
+  seg->size = NVDS_SPOOL_SEGMENT_HEADER_SIZE;
+  g_queue_push_tail (&spool->segments, seg);
+  spool->total_size += seg->size;
+
+  return TRUE;
+}
+
+static void
+remove_head_segment (NvDsSpool * spool)
+{
+  NvDsSpoolSegment *seg =
+      (NvDsSpoolSegment *) g_queue_pop_head (&spool->segments);
+  gchar *path = segment_path (spool, seg->seq);
+
+  if (spool->read_fd_seq == seg->seq)
+    close_read_fd (spool);
+  if (unlink (path) < 0)
+    g_printerr ("spool: failed to remove %s: %s\n", path, g_strerror (errno));
+  spool->total_size -= seg->size;
+
+  g_free (path);
+  g_free (seg);
+}
+
+/* 크기 제한을 넘으면 전달되지 않은 레코드가 있어도 가장 오래된 세그먼트를 지웁니다. */
+static void
+evict (NvDsSpool * spool)
+{
+  while (spool->total_size > spool->max_size && spool->segments.length > 1) {
+    NvDsSpoolSegment *seg = (NvDsSpoolSegment *) spool->segments.head->data;
+    NvDsSpoolSegment *next =
+        (NvDsSpoolSegment *) spool->segments.head->next->data;
+    guint64 dropped = seg->records;
+
+    if (spool->commit.seq == seg->seq)
+      dropped -= spool->commit.index;
+    spool->evicted += dropped;
+    g_printerr ("spool: size limit reached, dropping %" G_GUINT64_FORMAT
+        " undelivered records\n", dropped);
+
+    if (spool->commit.seq <= seg->seq)
+      set_pos (&spool->commit, next->seq, NVDS_SPOOL_SEGMENT_HEADER_SIZE, 0);
+    if (spool->read.seq <= seg->seq)
+      set_pos (&spool->read, next->seq, NVDS_SPOOL_SEGMENT_HEADER_SIZE, 0);
+    spool->dirty = TRUE;
+    remove_head_segment (spool);
+  }
+}
+
+static gint
+compare_seq (gconstpointer a, gconstpointer b)
+{
+  guint64 x = *(const guint64 *) a;
+  guint64 y = *(const guint64 *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static GArray *
+list_segments (const gchar * dir)
+{
+  GArray *seqs = g_array_new (FALSE, FALSE, sizeof (guint64));
+  GDir *d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  if (!d)
+    return seqs;
+
+  while ((name = g_dir_read_name (d))) {
+    guint64 seq;
+
+    if (strlen (name) == 20 + strlen (NVDS_SPOOL_SEGMENT_SUFFIX) &&
+        g_str_has_suffix (name, NVDS_SPOOL_SEGMENT_SUFFIX) &&
+        g_ascii_isdigit (name[0])) {
+      seq = g_ascii_strtoull (name, NULL, 10);
+      g_array_append_val (seqs, seq);
+    }
+  }
+  g_dir_close (d);
+
+  g_array_sort (seqs, compare_seq);
+  return seqs;
+}
+
+/* 저장된 commit 위치를 남아 있는 세그먼트 범위로 맞춰 읽습니다. */
+static void
+load_cursor (NvDsSpool * spool)
+{
+  NvDsSpoolSegment *head = (NvDsSpoolSegment *) spool->segments.head->data;
+  NvDsSpoolSegment *tail = (NvDsSpoolSegment *) spool->segments.tail->data;
+  NvDsSpoolSegment *seg = NULL;
+  gchar *path = g_build_filename (spool->dir, CURSOR_FILE, NULL);
+  gchar *contents = NULL;
+  guint64 seq, pos, index;
+
+  set_pos (&spool->commit, head->seq, NVDS_SPOOL_SEGMENT_HEADER_SIZE, 0);
+
+  if (g_file_get_contents (path, &contents, NULL, NULL) &&
+      sscanf (contents, "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %"
+          G_GUINT64_FORMAT, &seq, &pos, &index) == 3) {
+    if (seq > tail->seq) {
+      set_pos (&spool->commit, tail->seq, tail->size, tail->records);
+    } else if ((seg = find_segment (spool, seq))) {
+      if (pos > seg->size || index > seg->records)
+        set_pos (&spool->commit, seq, seg->size, seg->records);
+      else
+        set_pos (&spool->commit, seq, pos, index);
+    }
+  }
+
+  spool->read = spool->commit;
+  g_free (contents);
+  g_free (path);
+}
+
+NvDsSpool *
+nvds_spool_open (const gchar * dir, gsize segment_size, guint64 max_size,
+    GError ** error)
+{
+  NvDsSpool *spool = NULL;
+  GArray *seqs = NULL;
+  NvDsSpoolSegment *tail = NULL;
+  gchar *path = NULL;
+  guint i;
+
+  crc32c_init ();
+
+  if (g_mkdir_with_parents (dir, 0755) < 0) {
+    set_errno_error (error, errno, "Failed to create", dir);
+    return NULL;
+  }
+
+  spool = g_new0 (NvDsSpool, 1);
+  spool->dir = g_strdup (dir);
+  spool->segment_size = segment_size;
+  spool->max_size = MAX (max_size, (guint64) segment_size * 2);
+  spool->write_fd = -1;
+  spool->read_fd = -1;
+  spool->buffer = g_byte_array_new ();
+  spool->topic = g_string_new (NULL);
+  g_queue_init (&spool->segments);
+
+  seqs = list_segments (dir);
+  for (i = 0; i < seqs->len; i++) {
+    NvDsSpoolSegment *seg = g_new0 (NvDsSpoolSegment, 1);
+
+    seg->seq = g_array_index (seqs, guint64, i);
+    g_queue_push_tail (&spool->segments, seg);
+    if (!recover_segment (spool, seg, error))
+      goto error;
+    spool->total_size += seg->size;
+  }
+
+  if (spool->segments.length == 0) {
+    if (!new_segment (spool, 1, error))
+      goto error;
+  } else {
+    tail = (NvDsSpoolSegment *) spool->segments.tail->data;
+    path = segment_path (spool, tail->seq);
+    spool->write_fd = open (path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (spool->write_fd < 0) {
+      set_errno_error (error, errno, "Failed to open", path);
+      goto error;
+    }
+  }
+
+  load_cursor (spool);
+  /* 다 전달된 세그먼트를 정리합니다. */
+  nvds_spool_commit (spool, &spool->commit);
+
+  g_array_unref (seqs);
+  g_free (path);
+  return spool;
+
+error:
+  g_array_unref (seqs);
+  g_free (path);
+  nvds_spool_close (spool);
+  return NULL;
+}
+
+void
+nvds_spool_close (NvDsSpool * spool)
+{
+  GError *error = NULL;
+
+  if (!spool)
+    return;
+
+  if (spool->write_fd >= 0 && !nvds_spool_sync (spool, &error)) {
+    g_printerr ("spool: %s\n", error->message);
+    g_error_free (error);
+  }
+
+  if (spool->write_fd >= 0)
+    close (spool->write_fd);
+  close_read_fd (spool);
+  g_queue_clear_full (&spool->segments, g_free);
+  g_byte_array_unref (spool->buffer);
+  g_string_free (spool->topic, TRUE);
+  g_free (spool->dir);
+  g_free (spool);
+}
+
+gboolean
+nvds_spool_append (NvDsSpool * spool, const gchar * topic,
+    const guint8 * data, gsize len, GError ** error)
+{
+  NvDsSpoolSegment *tail = (NvDsSpoolSegment *) spool->segments.tail->data;
+  gsize topic_len = strlen (topic);
+  gsize body_len = 2 + topic_len + len;
+  gsize record_len = NVDS_SPOOL_RECORD_HEADER_SIZE + body_len;
+  guint8 *rec = NULL;
+  guint32 v32;
+  guint16 v16;
+
+  if (topic_len > G_MAXUINT16 || body_len > NVDS_SPOOL_MAX_RECORD_SIZE) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "record too large (%" G_GSIZE_FORMAT " bytes)", record_len);
+    return FALSE;
+  }
+
+  if (tail->records > 0 && tail->size + record_len > spool->segment_size) {
+    if (!new_segment (spool, tail->seq + 1, error))
+      return FALSE;
+    tail = (NvDsSpoolSegment *) spool->segments.tail->data;
+  }
+
+  /* 헤더와 body를 한 번의 write로 씁니다. */
+  g_byte_array_set_size (spool->buffer, record_len);
+  rec = spool->buffer->data;
+  v16 = GUINT16_TO_LE ((guint16) topic_len);
+  memcpy (rec + NVDS_SPOOL_RECORD_HEADER_SIZE, &v16, 2);
+  memcpy (rec + NVDS_SPOOL_RECORD_HEADER_SIZE + 2, topic, topic_len);
+  memcpy (rec + NVDS_SPOOL_RECORD_HEADER_SIZE + 2 + topic_len, data, len);
+  v32 = GUINT32_TO_LE ((guint32) body_len);
+  memcpy (rec, &v32, 4);
+  v32 = GUINT32_TO_LE (crc32c (rec + NVDS_SPOOL_RECORD_HEADER_SIZE,
+          body_len));
+  memcpy (rec + 4, &v32, 4);
+
+  if (!write_full (spool->write_fd, rec, record_len)) {
+    gint err = errno;
+    gchar *path = segment_path (spool, tail->seq);
+
+    /* 일부만 쓰였을 수 있으므로 마지막 레코드 경계로 되돌립니다. */
+    if (ftruncate (spool->write_fd, tail->size) < 0)
+      g_printerr ("spool: failed to truncate %s\n", path);
+    set_errno_error (error, err, "Failed to write", path);
+    g_free (path);
+    return FALSE;
+  }
+
+  tail->size += record_len;
+  tail->records++;
+  spool->total_size += record_len;
+  spool->appended++;
+  spool->dirty = TRUE;
+
+  evict (spool);
+  return TRUE;
+}
+
+gboolean
+nvds_spool_read (NvDsSpool * spool, NvDsSpoolPos * end, const gchar ** topic,
+    const guint8 ** data, gsize * len)
+{
+  while (TRUE) {
+    NvDsSpoolSegment *seg = find_segment (spool, spool->read.seq);
+    guint32 body_len;
+    guint16 topic_len;
+
+    if (!seg)
+      return FALSE;
+
+    if (spool->read.pos >= seg->size) {
+      NvDsSpoolSegment *next = find_segment (spool, seg->seq + 1);
+
+      if (!next)
+        return FALSE;
+      set_pos (&spool->read, next->seq, NVDS_SPOOL_SEGMENT_HEADER_SIZE, 0);
+      continue;
+    }
+
+    if (spool->read_fd < 0 || spool->read_fd_seq != seg->seq) {
+      gchar *path = segment_path (spool, seg->seq);
+
+      close_read_fd (spool);
+      spool->read_fd = open (path, O_RDONLY | O_CLOEXEC);
+      spool->read_fd_seq = seg->seq;
+      if (spool->read_fd < 0)
+        g_printerr ("spool: failed to open %s: %s\n", path,
+            g_strerror (errno));
+      g_free (path);
+    }
+
+    if (spool->read_fd < 0 ||
+        !load_record (spool, spool->read_fd, spool->read.pos, seg->size,
+            &body_len)) {
+      /* 열 때 검사한 뒤 손상된 경우입니다. 세그먼트의 나머지를 건너뜁니다. */
+      g_printerr ("spool: segment %" G_GUINT64_FORMAT
+          " is corrupt at %" G_GUINT64_FORMAT ", skipping the rest\n",
+          seg->seq, spool->read.pos);
+      spool->corrupt++;
+      set_pos (&spool->read, seg->seq, seg->size, seg->records);
+      continue;
+    }
+
+    memcpy (&topic_len, spool->buffer->data, 2);
+    topic_len = GUINT16_FROM_LE (topic_len);
+    if (2 + (gsize) topic_len > body_len) {
+      spool->corrupt++;
+      spool->read.pos += NVDS_SPOOL_RECORD_HEADER_SIZE + body_len;
+      spool->read.index++;
+      continue;
+    }
+
+    g_string_truncate (spool->topic, 0);
+    g_string_append_len (spool->topic,
+        (const gchar *) spool->buffer->data + 2, topic_len);
+
+    spool->read.pos += NVDS_SPOOL_RECORD_HEADER_SIZE + body_len;
+    spool->read.index++;
+
+    *end = spool->read;
+    *topic = spool->topic->str;
+    *data = spool->buffer->data + 2 + topic_len;
+    *len = body_len - 2 - topic_len;
+    return TRUE;
+  }
+}
+
+void
+nvds_spool_rewind (NvDsSpool * spool)
+{
+  spool->read = spool->commit;
+}
+
+void
+nvds_spool_commit (NvDsSpool * spool, const NvDsSpoolPos * pos)
+{
+  NvDsSpoolSegment *head = (NvDsSpoolSegment *) spool->segments.head->data;
+
+  /* 이미 지워진 세그먼트나 commit 이전 위치는 무시합니다. */
+  if (pos->seq < head->seq || pos->seq < spool->commit.seq ||
+      (pos->seq == spool->commit.seq && pos->pos < spool->commit.pos))
+    return;
+
+  spool->commit = *pos;
+  spool->dirty = TRUE;
+
+  while (spool->segments.length > 1) {
+    head = (NvDsSpoolSegment *) spool->segments.head->data;
+    if (head->seq > spool->commit.seq)
+      break;
+    if (head->seq == spool->commit.seq) {
+      NvDsSpoolSegment *next =
+          (NvDsSpoolSegment *) spool->segments.head->next->data;
+
+      if (spool->commit.pos < head->size)
+        break;
+      set_pos (&spool->commit, next->seq, NVDS_SPOOL_SEGMENT_HEADER_SIZE, 0);
+      if (spool->read.seq == head->seq && spool->read.pos >= head->size)
+        spool->read = spool->commit;
+    }
+    remove_head_segment (spool);
+  }
+}
+
+gboolean
+nvds_spool_caught_up (NvDsSpool * spool)
+{
+  GList *l;
+
+  for (l = spool->segments.head; l; l = l->next) {
+    NvDsSpoolSegment *seg = (NvDsSpoolSegment *) l->data;
+
+    if (seg->seq < spool->read.seq)
+      continue;
+    if (seg->seq == spool->read.seq ? spool->read.pos < seg->size :
+        seg->records > 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+gboolean
+nvds_spool_sync (NvDsSpool * spool, GError ** error)
+{
+  gchar *path = NULL;
+  gchar *contents = NULL;
+  gboolean ret = FALSE;
+
+  if (!spool->dirty)
+    return TRUE;
+
+  if (fdatasync (spool->write_fd) < 0) {
+    set_errno_error (error, errno, "Failed to sync", spool->dir);
+    return FALSE;
+  }
+
+  path = g_build_filename (spool->dir, CURSOR_FILE, NULL);
+  contents = g_strdup_printf ("%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %"
+      G_GUINT64_FORMAT "\n", spool->commit.seq, spool->commit.pos,
+      spool->commit.index);
+  ret = g_file_set_contents (path, contents, -1, error);
+  if (ret)
+    spool->dirty = FALSE;
+
+  g_free (contents);
+  g_free (path);
+  return ret;
+}
+
+void
+nvds_spool_get_stats (NvDsSpool * spool, NvDsSpoolStats * stats)
+{
+  GList *l;
+
+  memset (stats, 0, sizeof (*stats));
+  for (l = spool->segments.head; l; l = l->next) {
+    NvDsSpoolSegment *seg = (NvDsSpoolSegment *) l->data;
+
+    stats->pending += seg->records;
+    if (seg->seq == spool->commit.seq)
+      stats->pending -= spool->commit.index;
+  }
+  stats->segments = spool->segments.length;
+  stats->bytes = spool->total_size;
+  stats->appended = spool->appended;
+  stats->evicted = spool->evicted;
+  stats->corrupt = spool->corrupt;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __NVDS_SPOOL_H__
+#define __NVDS_SPOOL_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * 브로커 장애 동안 payload를 보관하는 로컬 디스크 스풀
+ *
+ *  <dir>/<seq 20자리>.spool    세그먼트, seq는 1씩 증가
+ *  <dir>/cursor               전달이 확인된 위치 "seq pos index"
+ *
+ *  segment := 'D' 'S' 'S' 'P' | u8 version | 3 reserved | record*
+ *  record  := u32le body_len | u32le crc32c(body) | body
+ *  body    := u16le topic_len | topic | payload
+ *
+ * - 레코드는 마지막 세그먼트 끝에만 추가합니다.
+ * - 열 때 각 세그먼트를 검사해 길이/CRC가 맞지 않는 첫 레코드부터 잘라냅니다.
+ *   (쓰는 도중 종료된 경우 마지막 레코드만 잃습니다.)
+ * - 전체 크기가 max-size를 넘으면 전달 여부와 관계없이 가장 오래된 세그먼트를 지웁니다.
+ * - 읽기 위치(read)와 전달 확인 위치(commit)를 따로 두고, 전송 실패 시 commit으로 되돌립니다.
+ *   commit 위치는 nvds_spool_sync에서 저장하므로 재시작 후 일부 레코드는 다시 전송될 수 있습니다.
+ */
+
+#define NVDS_SPOOL_SEGMENT_SUFFIX ".spool"
+#define NVDS_SPOOL_SEGMENT_HEADER_SIZE (8)
+#define NVDS_SPOOL_RECORD_HEADER_SIZE (8)
+#define NVDS_SPOOL_VERSION (1)
+/** 손상된 길이로 과도한 메모리를 잡지 않도록 하는 레코드 크기 상한 */
+#define NVDS_SPOOL_MAX_RECORD_SIZE (64 * 1024 * 1024)
+
+typedef struct _NvDsSpool NvDsSpool;
+
+/** 스풀 안의 레코드 경계 */
+typedef struct
+{
+  guint64 seq;
+  /** 세그먼트 안의 바이트 위치 */
+  guint64 pos;
+  /** 세그먼트 안의 레코드 순번 */
+  guint64 index;
+} NvDsSpoolPos;
+
+typedef struct
+{
+  guint segments;
+  /** 디스크에 있는 전체 크기 */
+  guint64 bytes;
+  /** commit 이후 아직 전달되지 않은 레코드 수 */
+  guint64 pending;
+  guint64 appended;
+  /** 크기 제한으로 전달 전에 지워진 레코드 수 */
+  guint64 evicted;
+  /** 열 때 잘라냈거나 읽다가 CRC가 맞지 않아 건너뛴 레코드/꼬리 수 */
+  guint64 corrupt;
+} NvDsSpoolStats;
+
+/**
+ * @brief  스풀을 열고 복구합니다. 저장된 commit 위치부터 읽습니다.
+ * @param  segment_size 세그먼트 크기 상한
+ * @param  max_size     전체 크기 상한 (segment_size의 2배 이상이어야 합니다)
+ */
+NvDsSpool *nvds_spool_open (const gchar * dir, gsize segment_size,
+    guint64 max_size, GError ** error);
+
+/** commit 위치를 저장하고 닫습니다. */
+void nvds_spool_close (NvDsSpool * spool);
+
+gboolean nvds_spool_append (NvDsSpool * spool, const gchar * topic,
+    const guint8 * data, gsize len, GError ** error);
+
+/**
+ * @brief  read 위치의 레코드를 읽고 다음 레코드로 넘어갑니다.
+ *         topic/data는 다음 read 또는 append 전까지 유효합니다.
+ * @param  end [OUT] 읽은 레코드 바로 다음 위치 (commit에 사용)
+ * @return 읽을 레코드가 없으면 FALSE
+ */
+gboolean nvds_spool_read (NvDsSpool * spool, NvDsSpoolPos * end,
+    const gchar ** topic, const guint8 ** data, gsize * len);
+
+/** read 위치를 commit 위치로 되돌립니다. */
+void nvds_spool_rewind (NvDsSpool * spool);
+
+/** pos 이전 레코드가 전달되었음을 기록하고 다 읽은 세그먼트를 지웁니다. */
+void nvds_spool_commit (NvDsSpool * spool, const NvDsSpoolPos * pos);
+
+/** read 위치가 마지막 레코드 뒤에 있으면 TRUE */
+gboolean nvds_spool_caught_up (NvDsSpool * spool);
+
+/** 쓴 데이터를 디스크에 반영하고 commit 위치를 저장합니다. */
+gboolean nvds_spool_sync (NvDsSpool * spool, GError ** error);
+
+void nvds_spool_get_stats (NvDsSpool * spool, NvDsSpoolStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
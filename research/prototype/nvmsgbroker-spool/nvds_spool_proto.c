@@ -0,0 +1,610 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * 저장 후 전달(store-and-forward) nvmsgbroker 프로토콜 어댑터 (libnvds_spool_proto.so)
+ *
+ * send/send_async로 받은 payload를 먼저 로컬 스풀(nvds_spool.h)에 기록하고,
+ * do_work에서 proto-lib로 지정한 실제 어댑터(예: libnvds_kafka_proto.so)로 순서대로 보냅니다.
+ * 전송이 실패하면 마지막으로 전달이 확인된 위치로 되돌리고 retry-interval-ms 후
+ * 한 건씩 보내 보며, 성공하면 replay-rate로 제한해 밀린 레코드를 다시 보냅니다.
+ *
+ * msg-broker-conn-str와 msg-broker-config는 그대로 실제 어댑터에 전달됩니다.
+ *
+ * [spool]
+ * proto-lib=/opt/nvidia/deepstream/deepstream/lib/libnvds_kafka_proto.so
+ * dir=/var/spool/ds-events
+ * segment-size=16777216
+ * max-size=1073741824       # 넘으면 가장 오래된 세그먼트부터 지웁니다.
+ * max-in-flight=64
+ * replay-rate=500           # 장애 후 재전송 속도 (레코드/초), 0이면 제한 없음
+ * retry-interval-ms=1000
+ * sync-interval-ms=1000     # fdatasync와 전달 위치 저장 주기
+ */
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include "nvds_msgapi.h"
+#include "nvds_spool.h"
+
+#define CONFIG_GROUP_SPOOL "spool"
+#define PROTOCOL_NAME "SPOOL"
+#define PROTOCOL_VERSION "4.0"
+
+#define DEFAULT_SEGMENT_SIZE (16 * 1024 * 1024)
+#define DEFAULT_MAX_SIZE (1024ULL * 1024 * 1024)
+#define DEFAULT_MAX_IN_FLIGHT (64)
+#define DEFAULT_RETRY_INTERVAL_MS (1000)
+#define DEFAULT_SYNC_INTERVAL_MS (1000)
+
+typedef NvDsMsgApiHandle (*nvds_msgapi_connect_ptr) (char *connection_str,
+    nvds_msgapi_connect_cb_t connect_cb, char *config_path);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_ptr) (NvDsMsgApiHandle
+    h_ptr, char *topic, const uint8_t * payload, size_t nbuf,
+    nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+typedef void (*nvds_msgapi_do_work_ptr) (NvDsMsgApiHandle h_ptr);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_disconnect_ptr) (NvDsMsgApiHandle
+    h_ptr);
+
+typedef struct
+{
+  gchar *proto_lib;
+  gchar *dir;
+  guint64 segment_size;
+  guint64 max_size;
+  guint max_in_flight;
+  guint replay_rate;
+  guint retry_interval_ms;
+  guint sync_interval_ms;
+} NvDsSpoolConfig;
+
+typedef struct
+{
+  nvds_msgapi_send_cb_t cb;
+  void *user_ptr;
+} NvDsSpoolCompletion;
+
+/** 실제 어댑터로 보내고 완료를 기다리는 레코드 */
+typedef struct
+{
+  guint64 id;
+  NvDsSpoolPos end;
+  gboolean acked;
+} NvDsSpoolInflight;
+
+struct _NvDsSpoolConn;
+
+/** 실제 어댑터의 완료 콜백 user_ptr */
+typedef struct
+{
+  struct _NvDsSpoolConn *conn;
+  guint64 id;
+} NvDsSpoolTicket;
+
+typedef struct _NvDsSpoolConn
+{
+  NvDsSpoolConfig config;
+  gchar *connection_str;
+  gchar *config_path;
+
+  void *lib_handle;
+  nvds_msgapi_connect_ptr inner_connect;
+  nvds_msgapi_send_async_ptr inner_send_async;
+  nvds_msgapi_do_work_ptr inner_do_work;
+  nvds_msgapi_disconnect_ptr inner_disconnect;
+  NvDsMsgApiHandle inner;
+
+  /* 실제 어댑터가 send_async 안에서 콜백을 부르는 경우를 위해 재진입 가능한 lock */
+  GRecMutex lock;
+  NvDsSpool *spool;
+  /** 호출자에게 돌려줄 send_async 완료 */
+  GQueue completions;
+  /** NvDsSpoolInflight, id 순 */
+  GQueue inflight;
+  guint64 next_id;
+
+  /** 전송 실패 후 이 시각까지 보내지 않습니다. */
+  gint64 retry_us;
+  /** 실패 후 첫 레코드의 전달이 확인될 때까지 한 건씩 보냅니다. */
+  gboolean probing;
+  /** 밀린 레코드를 다 보낼 때까지 replay-rate를 적용합니다. */
+  gboolean replaying;
+  gdouble tokens;
+  gint64 refill_us;
+  gint64 sync_us;
+
+  guint64 forwarded;
+  guint64 failures;
+} NvDsSpoolConn;
+
+static gboolean
+parse_config (NvDsSpoolConfig * config, const gchar * config_path)
+{
+  GKeyFile *key_file = NULL;
+  GError *error = NULL;
+  gboolean ret = FALSE;
+
+  config->segment_size = DEFAULT_SEGMENT_SIZE;
+  config->max_size = DEFAULT_MAX_SIZE;
+  config->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+  config->retry_interval_ms = DEFAULT_RETRY_INTERVAL_MS;
+  config->sync_interval_ms = DEFAULT_SYNC_INTERVAL_MS;
+
+  if (!config_path || !*config_path) {
+    g_printerr ("spool: msg-broker-config with a [%s] group is required\n",
+        CONFIG_GROUP_SPOOL);
+    return FALSE;
+  }
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, config_path, G_KEY_FILE_NONE,
+          &error)) {
+    g_printerr ("spool: failed to load %s: %s\n", config_path, error->message);
+    goto done;
+  }
+
+#define GET_UINT(key, field) \
+  if (g_key_file_has_key (key_file, CONFIG_GROUP_SPOOL, key, NULL)) \
+    config->field = g_key_file_get_uint64 (key_file, CONFIG_GROUP_SPOOL, key, \
+        NULL);
+
+  config->proto_lib = g_key_file_get_string (key_file, CONFIG_GROUP_SPOOL,
+      "proto-lib", NULL);
+  config->dir = g_key_file_get_string (key_file, CONFIG_GROUP_SPOOL, "dir",
+      NULL);
+  GET_UINT ("segment-size", segment_size);
+  GET_UINT ("max-size", max_size);
+  GET_UINT ("max-in-flight", max_in_flight);
+  GET_UINT ("replay-rate", replay_rate);
+  GET_UINT ("retry-interval-ms", retry_interval_ms);
+  GET_UINT ("sync-interval-ms", sync_interval_ms);
+
+#undef GET_UINT
+
+  if (!config->proto_lib || !config->dir) {
+    g_printerr ("spool: [%s] proto-lib and dir are required\n",
+        CONFIG_GROUP_SPOOL);
+    goto done;
+  }
+  if (!config->max_in_flight)
+    config->max_in_flight = 1;
+  ret = TRUE;
+
+done:
+  if (error)
+    g_error_free (error);
+  g_key_file_free (key_file);
+  return ret;
+}
+
+static gboolean
+load_proto_lib (NvDsSpoolConn * conn)
+{
+  conn->lib_handle = dlopen (conn->config.proto_lib, RTLD_LAZY);
+  if (!conn->lib_handle) {
+    g_printerr ("spool: failed to load %s: %s\n", conn->config.proto_lib,
+        dlerror ());
+    return FALSE;
+  }
+
+  conn->inner_connect = (nvds_msgapi_connect_ptr)
+      dlsym (conn->lib_handle, "nvds_msgapi_connect");
+  conn->inner_send_async = (nvds_msgapi_send_async_ptr)
+      dlsym (conn->lib_handle, "nvds_msgapi_send_async");
+  conn->inner_do_work = (nvds_msgapi_do_work_ptr)
+      dlsym (conn->lib_handle, "nvds_msgapi_do_work");
+  conn->inner_disconnect = (nvds_msgapi_disconnect_ptr)
+      dlsym (conn->lib_handle, "nvds_msgapi_disconnect");
+
+  if (!conn->inner_connect || !conn->inner_send_async || !conn->inner_do_work
+      || !conn->inner_disconnect) {
+    g_printerr ("spool: %s is not a msgapi protocol adaptor\n",
+        conn->config.proto_lib);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void
+inner_connect_cb (NvDsMsgApiHandle h_ptr, NvDsMsgApiEventType ds_evt)
+{
+  /* 장애는 전송 실패로 판단하므로 이벤트는 기록만 합니다. */
+  if (ds_evt != NVDS_MSGAPI_EVT_SUCCESS)
+    g_printerr ("spool: broker event %d\n", ds_evt);
+}
+
+static void
+print_stats (NvDsSpoolConn * conn, const gchar * what)
+{
+  NvDsSpoolStats stats;
+
+  nvds_spool_get_stats (conn->spool, &stats);
+  g_printerr ("spool: %s (pending %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT
+      " bytes on disk, forwarded %" G_GUINT64_FORMAT ", evicted %"
+      G_GUINT64_FORMAT ", corrupt %" G_GUINT64_FORMAT ")\n", what,
+      stats.pending, stats.bytes, conn->forwarded, stats.evicted,
+      stats.corrupt);
+}
+
+/* lock을 잡은 상태에서 호출합니다. 보낸 레코드를 버리고 commit 위치부터 다시 보냅니다. */
+static void
+handle_failure (NvDsSpoolConn * conn)
+{
+  conn->failures++;
+  if (!conn->probing)
+    print_stats (conn, "broker unavailable, spooling");
+
+  g_queue_clear_full (&conn->inflight, g_free);
+  nvds_spool_rewind (conn->spool);
+  conn->retry_us = g_get_monotonic_time () +
+      (gint64) conn->config.retry_interval_ms * 1000;
+  conn->probing = TRUE;
+  conn->replaying = TRUE;
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static void
+handle_ack (NvDsSpoolConn * conn, guint64 id, NvDsMsgApiErrorType flag)
+{
+  NvDsSpoolInflight *head =
+      (NvDsSpoolInflight *) g_queue_peek_head (&conn->inflight);
+  NvDsSpoolInflight *entry = NULL;
+  NvDsSpoolPos end;
+  gboolean commit = FALSE;
+
+  /* 되돌리기 전에 보낸 레코드의 완료는 무시합니다. */
+  if (!head || id < head->id || id - head->id >= conn->inflight.length)
+    return;
+  entry = (NvDsSpoolInflight *) g_queue_peek_nth (&conn->inflight,
+      id - head->id);
+
+  if (flag != NVDS_MSGAPI_OK) {
+    handle_failure (conn);
+    return;
+  }
+
+  entry->acked = TRUE;
+  conn->forwarded++;
+  if (conn->probing) {
+    conn->probing = FALSE;
+    print_stats (conn, "broker available, replaying");
+  }
+
+  /* 앞에서부터 연속으로 확인된 레코드까지 commit 합니다. */
+  while ((head = (NvDsSpoolInflight *) g_queue_peek_head (&conn->inflight)) &&
+      head->acked) {
+    end = head->end;
+    commit = TRUE;
+    g_free (g_queue_pop_head (&conn->inflight));
+  }
+  if (commit)
+    nvds_spool_commit (conn->spool, &end);
+}
+
+static void
+inner_send_cb (void *user_ptr, NvDsMsgApiErrorType completion_flag)
+{
+  NvDsSpoolTicket *ticket = (NvDsSpoolTicket *) user_ptr;
+  NvDsSpoolConn *conn = ticket->conn;
+
+  g_rec_mutex_lock (&conn->lock);
+  handle_ack (conn, ticket->id, completion_flag);
+  g_rec_mutex_unlock (&conn->lock);
+  g_free (ticket);
+}
+
+/* lock을 잡은 상태에서 호출합니다. 다음 조건이 될 때까지 스풀의 레코드를 실제 어댑터로 보냅니다. */
+static void
+pump (NvDsSpoolConn * conn)
+{
+  gint64 now_us = g_get_monotonic_time ();
+  gboolean limited = conn->replaying && conn->config.replay_rate > 0;
+
+  if (!conn->inner || now_us < conn->retry_us)
+    return;
+
+  if (limited) {
+    conn->tokens += (now_us - conn->refill_us) * conn->config.replay_rate / 1e6;
+    conn->tokens = MIN (conn->tokens, (gdouble) conn->config.replay_rate);
+  }
+  conn->refill_us = now_us;
+
+  /* 콜백이 send_async 안에서 불려 실패 처리될 수 있으므로 조건을 매번 확인합니다. */
+  while (now_us >= conn->retry_us && conn->inflight.length <
+      (conn->probing ? 1 : conn->config.max_in_flight)) {
+    NvDsSpoolInflight *entry = NULL;
+    NvDsSpoolTicket *ticket = NULL;
+    const gchar *topic;
+    const guint8 *data;
+    gsize len;
+    NvDsSpoolPos end;
+
+    if (limited && conn->tokens < 1)
+      break;
+    if (!nvds_spool_read (conn->spool, &end, &topic, &data, &len))
+      break;
+
+    entry = g_new0 (NvDsSpoolInflight, 1);
+    entry->id = conn->next_id++;
+    entry->end = end;
+    g_queue_push_tail (&conn->inflight, entry);
+
+    ticket = g_new (NvDsSpoolTicket, 1);
+    ticket->conn = conn;
+    ticket->id = entry->id;
+    if (conn->inner_send_async (conn->inner, (char *) topic, data, len,
+            inner_send_cb, ticket) != NVDS_MSGAPI_OK) {
+      g_free (ticket);
+      handle_failure (conn);
+      break;
+    }
+    if (limited)
+      conn->tokens -= 1;
+  }
+
+  if (conn->replaying && !conn->probing && conn->inflight.length == 0 &&
+      nvds_spool_caught_up (conn->spool)) {
+    conn->replaying = FALSE;
+    print_stats (conn, "backlog delivered");
+  }
+}
+
+/* lock을 잡은 상태에서 호출합니다. */
+static NvDsMsgApiErrorType
+append_locked (NvDsSpoolConn * conn, char *topic, const uint8_t * payload,
+    size_t nbuf)
+{
+  GError *error = NULL;
+
+  if (!topic || !*topic)
+    return NVDS_MSGAPI_UNKNOWN_TOPIC;
+  if (!payload || nbuf == 0)
+    return NVDS_MSGAPI_ERR;
+
+  if (!nvds_spool_append (conn->spool, topic, payload, nbuf, &error)) {
+    g_printerr ("spool: %s\n", error->message);
+    g_error_free (error);
+    return NVDS_MSGAPI_ERR;
+  }
+  return NVDS_MSGAPI_OK;
+}
+
+static void
+free_conn (NvDsSpoolConn * conn)
+{
+  g_queue_clear_full (&conn->completions, g_free);
+  g_queue_clear_full (&conn->inflight, g_free);
+  nvds_spool_close (conn->spool);
+  if (conn->lib_handle)
+    dlclose (conn->lib_handle);
+  g_rec_mutex_clear (&conn->lock);
+  g_free (conn->config.proto_lib);
+  g_free (conn->config.dir);
+  g_free (conn->connection_str);
+  g_free (conn->config_path);
+  g_free (conn);
+}
+
+/**
+ * 실제 어댑터 연결에 실패해도 스풀에 기록할 수 있도록 핸들을 돌려주고
+ * do_work에서 다시 연결합니다.
+ */
+NvDsMsgApiHandle
+nvds_msgapi_connect (char *connection_str, nvds_msgapi_connect_cb_t connect_cb,
+    char *config_path)
+{
+  NvDsSpoolConn *conn = g_new0 (NvDsSpoolConn, 1);
+  GError *error = NULL;
+
+  g_rec_mutex_init (&conn->lock);
+  g_queue_init (&conn->completions);
+  g_queue_init (&conn->inflight);
+  conn->connection_str = g_strdup (connection_str);
+  conn->config_path = g_strdup (config_path);
+
+  if (!parse_config (&conn->config, config_path) || !load_proto_lib (conn))
+    goto error;
+
+  conn->spool = nvds_spool_open (conn->config.dir, conn->config.segment_size,
+      conn->config.max_size, &error);
+  if (!conn->spool) {
+    g_printerr ("spool: %s\n", error->message);
+    g_error_free (error);
+    goto error;
+  }
+
+  conn->sync_us = conn->refill_us = g_get_monotonic_time ();
+  /* 이전 실행에서 남은 레코드가 있으면 재전송부터 시작합니다. */
+  conn->replaying = !nvds_spool_caught_up (conn->spool);
+  if (conn->replaying)
+    print_stats (conn, "resuming");
+
+  conn->inner = conn->inner_connect (conn->connection_str, inner_connect_cb,
+      conn->config_path);
+  if (!conn->inner) {
+    g_printerr ("spool: broker connection failed, retrying in do_work\n");
+    conn->retry_us = conn->sync_us +
+        (gint64) conn->config.retry_interval_ms * 1000;
+  }
+
+  return (NvDsMsgApiHandle) conn;
+
+error:
+  free_conn (conn);
+  return NULL;
+}
+
+/* 스풀에 기록되면 성공입니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_send (NvDsMsgApiHandle h_ptr, char *topic, const uint8_t * payload,
+    size_t nbuf)
+{
+  NvDsSpoolConn *conn = (NvDsSpoolConn *) h_ptr;
+  NvDsMsgApiErrorType result;
+
+  g_return_val_if_fail (conn, NVDS_MSGAPI_ERR);
+
+  g_rec_mutex_lock (&conn->lock);
+  result = append_locked (conn, topic, payload, nbuf);
+  if (result == NVDS_MSGAPI_OK)
+    pump (conn);
+  g_rec_mutex_unlock (&conn->lock);
+
+  return result;
+}
+
+/* 스풀에 기록되면 성공이며 완료 콜백은 다음 do_work에서 호출합니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_send_async (NvDsMsgApiHandle h_ptr, char *topic,
+    const uint8_t * payload, size_t nbuf, nvds_msgapi_send_cb_t send_callback,
+    void *user_ptr)
+{
+  NvDsSpoolConn *conn = (NvDsSpoolConn *) h_ptr;
+  NvDsSpoolCompletion *completion = NULL;
+  NvDsMsgApiErrorType result;
+
+  g_return_val_if_fail (conn, NVDS_MSGAPI_ERR);
+
+  g_rec_mutex_lock (&conn->lock);
+  result = append_locked (conn, topic, payload, nbuf);
+  if (result == NVDS_MSGAPI_OK) {
+    if (send_callback) {
+      completion = g_new (NvDsSpoolCompletion, 1);
+      completion->cb = send_callback;
+      completion->user_ptr = user_ptr;
+      g_queue_push_tail (&conn->completions, completion);
+    }
+    pump (conn);
+  }
+  g_rec_mutex_unlock (&conn->lock);
+
+  return result;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_subscribe (NvDsMsgApiHandle h_ptr, char **topics, int num_topics,
+    nvds_msgapi_subscribe_request_cb_t cb, void *user_ctx)
+{
+  g_printerr ("spool: subscribe is not supported\n");
+  return NVDS_MSGAPI_ERR;
+}
+
+static void
+dispatch_completions (NvDsSpoolConn * conn)
+{
+  GQueue done = G_QUEUE_INIT;
+  NvDsSpoolCompletion *completion;
+
+  g_rec_mutex_lock (&conn->lock);
+  done = conn->completions;
+  g_queue_init (&conn->completions);
+  g_rec_mutex_unlock (&conn->lock);
+
+  while ((completion = (NvDsSpoolCompletion *) g_queue_pop_head (&done))) {
+    completion->cb (completion->user_ptr, NVDS_MSGAPI_OK);
+    g_free (completion);
+  }
+}
+
+void
+nvds_msgapi_do_work (NvDsMsgApiHandle h_ptr)
+{
+  NvDsSpoolConn *conn = (NvDsSpoolConn *) h_ptr;
+  NvDsMsgApiHandle inner;
+  GError *error = NULL;
+  gint64 now_us = g_get_monotonic_time ();
+
+  if (!conn)
+    return;
+
+  g_rec_mutex_lock (&conn->lock);
+  if (!conn->inner && now_us >= conn->retry_us) {
+    conn->inner = conn->inner_connect (conn->connection_str, inner_connect_cb,
+        conn->config_path);
+    if (!conn->inner)
+      conn->retry_us = now_us + (gint64) conn->config.retry_interval_ms * 1000;
+  }
+  inner = conn->inner;
+  g_rec_mutex_unlock (&conn->lock);
+
+  /* 실제 어댑터의 완료 콜백은 여기서 호출되며 lock을 직접 잡습니다. */
+  if (inner)
+    conn->inner_do_work (inner);
+
+  g_rec_mutex_lock (&conn->lock);
+  pump (conn);
+  if (now_us - conn->sync_us >= (gint64) conn->config.sync_interval_ms * 1000) {
+    if (!nvds_spool_sync (conn->spool, &error)) {
+      g_printerr ("spool: %s\n", error->message);
+      g_clear_error (&error);
+    }
+    conn->sync_us = now_us;
+  }
+  g_rec_mutex_unlock (&conn->lock);
+
+  dispatch_completions (conn);
+}
+
+/* 아직 보내지 못한 레코드는 스풀에 남겨 두고 다음 실행에서 보냅니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_disconnect (NvDsMsgApiHandle h_ptr)
+{
+  NvDsSpoolConn *conn = (NvDsSpoolConn *) h_ptr;
+
+  if (!conn)
+    return NVDS_MSGAPI_ERR;
+
+  /* 실제 어댑터가 남은 완료를 호출하면서 commit 위치가 갱신됩니다. */
+  if (conn->inner)
+    conn->inner_disconnect (conn->inner);
+  conn->inner = NULL;
+
+  dispatch_completions (conn);
+  print_stats (conn, "disconnected");
+  free_conn (conn);
+  return NVDS_MSGAPI_OK;
+}
+
+char *
+nvds_msgapi_getversion (void)
+{
+  return (char *) PROTOCOL_VERSION;
+}
+
+char *
+nvds_msgapi_get_protocol_name (void)
+{
+  return (char *) PROTOCOL_NAME;
+}
+
+/* 스풀을 연결마다 따로 두므로 연결을 공유하지 않습니다. */
+NvDsMsgApiErrorType
+nvds_msgapi_connection_signature (char *broker_str, char *cfg,
+    char *output_str, int max_len)
+{
+  if (!output_str || max_len <= 0)
+    return NVDS_MSGAPI_ERR;
+  output_str[0] = '\0';
+  return NVDS_MSGAPI_OK;
+}
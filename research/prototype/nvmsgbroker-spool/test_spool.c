@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * 스풀 크래시 일관성 테스트와 처리량 벤치마크
+ *
+ *   make check   테스트 실행
+ *   make bench   -m perf 로 벤치마크까지 실행
+ *
+ * 크래시는 세그먼트를 임의 위치에서 잘라내거나 바이트를 바꾼 뒤 다시 여는 것으로 흉내냅니다.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "nvds_spool.h"
+
+#define SEGMENT_SIZE (4096)
+#define MAX_SIZE (1024 * 1024)
+#define NUM_RECORDS (300)
+
+/* 디스크 위의 레코드 하나 */
+typedef struct
+{
+  guint64 seq;
+  guint64 start;
+  guint64 end;
+  gchar *payload;
+} SpooledRecord;
+
+typedef struct
+{
+  gchar *dir;
+  /** seq -> 원본 세그먼트 내용 */
+  GHashTable *pristine;
+  /** SpooledRecord, 기록 순 */
+  GArray *records;
+  GRand *rand;
+} Fixture;
+
+static gchar *
+make_payload (guint i, GRand * rand)
+{
+  /* 길이가 제각각이어야 잘리는 위치가 레코드 경계와 어긋납니다. */
+  GString *s = g_string_new (NULL);
+  guint len = g_rand_int_range (rand, 1, 200);
+
+  g_string_printf (s, "rec-%u:", i);
+  while (s->len < len)
+    g_string_append_c (s, 'a' + (s->len + i) % 26);
+  return g_string_free (s, FALSE);
+}
+
+static gchar *
+segment_file (Fixture * fixture, guint64 seq)
+{
+  return g_strdup_printf ("%s/%020" G_GUINT64_FORMAT NVDS_SPOOL_SEGMENT_SUFFIX,
+      fixture->dir, seq);
+}
+
+static void
+remove_dir_contents (const gchar * dir)
+{
+  GDir *d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  if (!d)
+    return;
+  while ((name = g_dir_read_name (d))) {
+    gchar *path = g_build_filename (dir, name, NULL);
+    g_remove (path);
+    g_free (path);
+  }
+  g_dir_close (d);
+}
+
+/* 원본 세그먼트만 남기고 cursor를 지웁니다. (commit 전 크래시) */
+static void
+restore_pristine (Fixture * fixture)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  remove_dir_contents (fixture->dir);
+  g_hash_table_iter_init (&iter, fixture->pristine);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    GBytes *bytes = (GBytes *) value;
+    gchar *path = segment_file (fixture, *(guint64 *) key);
+    gsize size;
+    gconstpointer data = g_bytes_get_data (bytes, &size);
+
+    g_assert_true (g_file_set_contents (path, (const gchar *) data, size,
+            NULL));
+    g_free (path);
+  }
+}
+
+/*
+ * NUM_RECORDS개를 기록하고 닫은 뒤, 세그먼트 내용과 레코드 위치를 저장합니다.
+ * 레코드 위치는 스풀 구현이 아닌 형식 정의(nvds_spool.h)로 계산합니다.
+ */
+static void
+fixture_set_up (Fixture * fixture, gconstpointer data)
+{
+  NvDsSpool *spool;
+  GError *error = NULL;
+  guint64 seq = 1, pos = NVDS_SPOOL_SEGMENT_HEADER_SIZE;
+  guint i;
+
+  fixture->dir = g_dir_make_tmp ("spool-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->pristine = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+      g_free, (GDestroyNotify) g_bytes_unref);
+  fixture->records = g_array_new (FALSE, FALSE, sizeof (SpooledRecord));
+  fixture->rand = g_rand_new_with_seed (35);
+
+  spool = nvds_spool_open (fixture->dir, SEGMENT_SIZE, MAX_SIZE, &error);
+  g_assert_no_error (error);
+  for (i = 0; i < NUM_RECORDS; i++) {
+    SpooledRecord rec;
+    gsize len;
+
+    rec.payload = make_payload (i, fixture->rand);
+    len = NVDS_SPOOL_RECORD_HEADER_SIZE + 2 + strlen ("events") +
+        strlen (rec.payload);
+    if (pos > NVDS_SPOOL_SEGMENT_HEADER_SIZE && pos + len > SEGMENT_SIZE) {
+      seq++;
+      pos = NVDS_SPOOL_SEGMENT_HEADER_SIZE;
+    }
+    rec.seq = seq;
+    rec.start = pos;
+    rec.end = pos + len;
+    pos = rec.end;
+    g_array_append_val (fixture->records, rec);
+
+    g_assert_true (nvds_spool_append (spool, "events",
+            (const guint8 *) rec.payload, strlen (rec.payload), &error));
+  }
+  nvds_spool_close (spool);
+
+  for (i = 1; i <= seq; i++) {
+    gchar *path = segment_file (fixture, i);
+    gchar *contents;
+    gsize size;
+    guint64 *key = g_new (guint64, 1);
+
+    g_assert_true (g_file_get_contents (path, &contents, &size, NULL));
+    *key = i;
+    g_hash_table_insert (fixture->pristine, key,
+        g_bytes_new_take (contents, size));
+    g_free (path);
+  }
+  g_assert_cmpuint (seq, >=, 5);
+}
+
+static void
+fixture_tear_down (Fixture * fixture, gconstpointer data)
+{
+  guint i;
+
+  remove_dir_contents (fixture->dir);
+  g_rmdir (fixture->dir);
+  for (i = 0; i < fixture->records->len; i++)
+    g_free (g_array_index (fixture->records, SpooledRecord, i).payload);
+  g_array_unref (fixture->records);
+  g_hash_table_unref (fixture->pristine);
+  g_rand_free (fixture->rand);
+  g_free (fixture->dir);
+}
+
+static guint64
+num_segments (Fixture * fixture)
+{
+  return g_hash_table_size (fixture->pristine);
+}
+
+/* 다시 열어 읽은 payload가 expected(seq, end 기준으로 남아야 할 레코드)와 같은지 확인합니다. */
+static void
+check_reopen (Fixture * fixture, guint64 cut_seq, guint64 cut_end)
+{
+  NvDsSpool *spool;
+  NvDsSpoolPos end;
+  NvDsSpoolStats stats;
+  GError *error = NULL;
+  const gchar *topic;
+  const guint8 *payload;
+  gsize len;
+  guint i = 0, expected = 0;
+
+  spool = nvds_spool_open (fixture->dir, SEGMENT_SIZE, MAX_SIZE, &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < fixture->records->len; i++) {
+    SpooledRecord *rec = &g_array_index (fixture->records, SpooledRecord, i);
+
+    if (rec->seq == cut_seq && rec->end > cut_end)
+      continue;
+    g_assert_true (nvds_spool_read (spool, &end, &topic, &payload, &len));
+    g_assert_cmpstr (topic, ==, "events");
+    g_assert_cmpuint (len, ==, strlen (rec->payload));
+    g_assert_true (memcmp (payload, rec->payload, len) == 0);
+    expected++;
+  }
+  g_assert_false (nvds_spool_read (spool, &end, &topic, &payload, &len));
+  g_assert_true (nvds_spool_caught_up (spool));
+
+  nvds_spool_get_stats (spool, &stats);
+  g_assert_cmpuint (stats.pending, ==, expected);
+
+  /* 복구 후에도 이어서 쓰고 읽을 수 있어야 합니다. */
+  g_assert_true (nvds_spool_append (spool, "events", (const guint8 *) "after",
+          5, &error));
+  g_assert_true (nvds_spool_read (spool, &end, &topic, &payload, &len));
+  g_assert_cmpuint (len, ==, 5);
+  g_assert_true (memcmp (payload, "after", 5) == 0);
+  nvds_spool_close (spool);
+}
+
+/* 쓰는 도중 종료: 마지막 세그먼트를 임의 위치에서 자릅니다. */
+static void
+test_truncate_tail (Fixture * fixture, gconstpointer data)
+{
+  guint64 seq = num_segments (fixture);
+  GBytes *pristine = (GBytes *) g_hash_table_lookup (fixture->pristine, &seq);
+  gchar *path = segment_file (fixture, seq);
+  guint trial;
+
+  for (trial = 0; trial < 200; trial++) {
+    guint64 cut = g_rand_int_range (fixture->rand,
+        NVDS_SPOOL_SEGMENT_HEADER_SIZE, g_bytes_get_size (pristine) + 1);
+
+    restore_pristine (fixture);
+    g_assert_cmpint (truncate (path, cut), ==, 0);
+    check_reopen (fixture, seq, cut);
+  }
+  g_free (path);
+}
+
+/* 잘린 위치가 어느 세그먼트든 그 세그먼트의 꼬리만 잃고 다음 세그먼트는 남아야 합니다. */
+static void
+test_truncate_any_segment (Fixture * fixture, gconstpointer data)
+{
+  guint trial;
+
+  for (trial = 0; trial < 200; trial++) {
+    guint64 seq = g_rand_int_range (fixture->rand, 1, num_segments (fixture) +
+        1);
+    GBytes *pristine = (GBytes *) g_hash_table_lookup (fixture->pristine, &seq);
+    gchar *path = segment_file (fixture, seq);
+    guint64 cut = g_rand_int_range (fixture->rand, 0,
+        g_bytes_get_size (pristine) + 1);
+
+    restore_pristine (fixture);
+    g_assert_cmpint (truncate (path, cut), ==, 0);
+    /* 헤더까지 잘린 세그먼트는 빈 세그먼트로 다시 만듭니다. */
+    check_reopen (fixture, seq, MAX (cut, NVDS_SPOOL_SEGMENT_HEADER_SIZE));
+    g_free (path);
+  }
+}
+
+/* 미리 할당된 0 영역이나 쓰레기 꼬리는 잘라냅니다. */
+static void
+test_garbage_tail (Fixture * fixture, gconstpointer data)
+{
+  guint64 seq = num_segments (fixture);
+  GBytes *pristine = (GBytes *) g_hash_table_lookup (fixture->pristine, &seq);
+  gchar *path = segment_file (fixture, seq);
+  guint trial;
+
+  for (trial = 0; trial < 50; trial++) {
+    gsize size = g_bytes_get_size (pristine);
+    guint extra = g_rand_int_range (fixture->rand, 1, 64);
+    guint8 *contents = (guint8 *) g_malloc (size + extra);
+    guint i;
+
+    memcpy (contents, g_bytes_get_data (pristine, NULL), size);
+    for (i = 0; i < extra; i++)
+      contents[size + i] = trial % 2 ? 0 : (guint8) g_rand_int (fixture->rand);
+
+    restore_pristine (fixture);
+    g_assert_true (g_file_set_contents (path, (const gchar *) contents,
+            size + extra, NULL));
+    check_reopen (fixture, seq, size);
+    g_free (contents);
+  }
+  g_free (path);
+}
+
+/* 바이트가 바뀐 레코드(CRC 불일치)부터 그 세그먼트의 나머지를 버립니다. */
+static void
+test_corrupt_byte (Fixture * fixture, gconstpointer data)
+{
+  guint trial;
+
+  for (trial = 0; trial < 200; trial++) {
+    SpooledRecord *rec = &g_array_index (fixture->records, SpooledRecord,
+        g_rand_int_range (fixture->rand, 0, fixture->records->len));
+    GBytes *pristine =
+        (GBytes *) g_hash_table_lookup (fixture->pristine, &rec->seq);
+    gchar *path = segment_file (fixture, rec->seq);
+    gsize size = g_bytes_get_size (pristine);
+    guint8 *contents =
+        (guint8 *) g_memdup2 (g_bytes_get_data (pristine, NULL), size);
+    guint64 at = g_rand_int_range (fixture->rand, rec->start, rec->end);
+
+    contents[at] ^= 1 << g_rand_int_range (fixture->rand, 0, 8);
+    restore_pristine (fixture);
+    g_assert_true (g_file_set_contents (path, (const gchar *) contents, size,
+            NULL));
+    check_reopen (fixture, rec->seq, rec->start);
+    g_free (contents);
+    g_free (path);
+  }
+}
+
+/*
+ * commit 후 sync된 cursor는 재시작 뒤 읽기 시작 위치가 됩니다. cursor가 잘린 세그먼트의
+ * 끝을 넘으면 그 끝으로 맞춥니다.
+ */
+static void
+test_cursor_after_truncate (Fixture * fixture, gconstpointer data)
+{
+  guint64 last = num_segments (fixture);
+  SpooledRecord *target = NULL;
+  NvDsSpool *spool;
+  NvDsSpoolPos end;
+  GError *error = NULL;
+  const gchar *topic;
+  const guint8 *payload;
+  gsize len;
+  gchar *path = segment_file (fixture, last);
+  guint i, first_in_last = 0, committed;
+
+  for (i = 0; i < fixture->records->len; i++) {
+    if (g_array_index (fixture->records, SpooledRecord, i).seq == last) {
+      first_in_last = i;
+      break;
+    }
+  }
+  /* 마지막 세그먼트의 두 번째 레코드까지 commit 합니다. */
+  committed = first_in_last + 2;
+  target = &g_array_index (fixture->records, SpooledRecord, committed - 1);
+
+  restore_pristine (fixture);
+  spool = nvds_spool_open (fixture->dir, SEGMENT_SIZE, MAX_SIZE, &error);
+  for (i = 0; i < committed; i++)
+    g_assert_true (nvds_spool_read (spool, &end, &topic, &payload, &len));
+  nvds_spool_commit (spool, &end);
+  g_assert_true (nvds_spool_sync (spool, &error));
+  nvds_spool_close (spool);
+
+  /* 전달된 세그먼트는 지워졌어야 합니다. */
+  for (i = 1; i < last; i++) {
+    gchar *old = segment_file (fixture, i);
+    g_assert_false (g_file_test (old, G_FILE_TEST_EXISTS));
+    g_free (old);
+  }
+
+  /* commit 위치보다 앞에서 자르면 남은 레코드가 없습니다. */
+  g_assert_cmpint (truncate (path, target->start), ==, 0);
+  spool = nvds_spool_open (fixture->dir, SEGMENT_SIZE, MAX_SIZE, &error);
+  g_assert_no_error (error);
+  g_assert_false (nvds_spool_read (spool, &end, &topic, &payload, &len));
+  g_assert_true (nvds_spool_append (spool, "events", (const guint8 *) "x", 1,
+          &error));
+  g_assert_true (nvds_spool_read (spool, &end, &topic, &payload, &len));
+  g_assert_cmpuint (len, ==, 1);
+  nvds_spool_close (spool);
+  g_free (path);
+}
+
+/*
+ * 기록(append)과 재전송 경로(read + commit) 처리량.
+ * sync는 proto 어댑터처럼 일정 건수마다 호출합니다.
+ */
+static void
+bench_throughput (Fixture * fixture, gconstpointer data)
+{
+  static const gsize sizes[] = { 256, 4096 };
+  guint8 *payload = (guint8 *) g_malloc (4096);
+  guint s;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    g_free (payload);
+    return;
+  }
+
+  memset (payload, 'x', 4096);
+  for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+    NvDsSpool *spool;
+    NvDsSpoolPos end;
+    GError *error = NULL;
+    const gchar *topic;
+    const guint8 *out;
+    gsize len;
+    guint n = 100000, i;
+    gdouble elapsed;
+
+    remove_dir_contents (fixture->dir);
+    spool = nvds_spool_open (fixture->dir, 16 * 1024 * 1024,
+        (guint64) 4 * 1024 * 1024 * 1024, &error);
+    g_assert_no_error (error);
+
+    g_test_timer_start ();
+    for (i = 0; i < n; i++) {
+      nvds_spool_append (spool, "events", payload, sizes[s], NULL);
+      if (i % 1000 == 999)
+        nvds_spool_sync (spool, NULL);
+    }
+    nvds_spool_sync (spool, NULL);
+    elapsed = g_test_timer_elapsed ();
+    g_test_minimized_result (elapsed * 1e9 / n,
+        "append %" G_GSIZE_FORMAT " B: %.0f ns/record, %.1f MB/s", sizes[s],
+        elapsed * 1e9 / n, n * sizes[s] / elapsed / (1024 * 1024));
+
+    g_test_timer_start ();
+    for (i = 0; nvds_spool_read (spool, &end, &topic, &out, &len); i++) {
+      if (i % 64 == 63)
+        nvds_spool_commit (spool, &end);
+    }
+    nvds_spool_commit (spool, &end);
+    nvds_spool_sync (spool, NULL);
+    elapsed = g_test_timer_elapsed ();
+    g_assert_cmpuint (i, ==, n);
+    g_test_minimized_result (elapsed * 1e9 / n,
+        "replay %" G_GSIZE_FORMAT " B: %.0f ns/record, %.1f MB/s", sizes[s],
+        elapsed * 1e9 / n, n * sizes[s] / elapsed / (1024 * 1024));
+
+    nvds_spool_close (spool);
+  }
+  g_free (payload);
+}
+
+#define ADD_TEST(path, func) \
+  g_test_add (path, Fixture, NULL, fixture_set_up, func, fixture_tear_down)
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  ADD_TEST ("/spool/crash/truncate-tail", test_truncate_tail);
+  ADD_TEST ("/spool/crash/truncate-any-segment", test_truncate_any_segment);
+  ADD_TEST ("/spool/crash/garbage-tail", test_garbage_tail);
+  ADD_TEST ("/spool/crash/corrupt-byte", test_corrupt_byte);
+  ADD_TEST ("/spool/crash/cursor-after-truncate",
+      test_cursor_after_truncate);
+  ADD_TEST ("/spool/bench/throughput", bench_throughput);
+
+  return g_test_run ();
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * 길이 prefix가 붙은 바이너리 레코드를 읽어 프레임마다 한 줄씩 JSON으로 출력합니다.
+ *
+ *   nvds-binary-decode records.bin
+ *   nvds-binary-decode -s records.bin      # 크기 비교만 출력
+ *   cat records.bin | nvds-binary-decode
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "nvds_binary_payload.h"
+
+static gboolean stats_only = FALSE;
+
+GOptionEntry entries[] = {
+  {"stats", 's', 0, G_OPTION_ARG_NONE, &stats_only,
+      "Print record/frame/object counts and binary/JSON sizes instead of JSON", NULL},
+  {NULL},
+};
+
+static gboolean
+read_exact (FILE * fp, guint8 * buf, gsize len)
+{
+  return fread (buf, 1, len, fp) == len;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  FILE *fp = stdin;
+  std::vector<guint8> body;
+  std::string json;
+  guint64 num_records = 0, num_frames = 0, num_objects = 0;
+  guint64 binary_bytes = 0, json_bytes = 0;
+  int ret = -1;
+
+  ctx = g_option_context_new ("[FILE] - decode binary event payloads");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    goto done;
+  }
+
+  if (argc > 1 && !(fp = fopen (argv[1], "rb"))) {
+    g_printerr ("Failed to open '%s'\n", argv[1]);
+    goto done;
+  }
+
+  while (TRUE) {
+    guint8 prefix[NVDS_BINARY_PAYLOAD_PREFIX_SIZE];
+    guint32 len = 0;
+    std::string reason;
+    guint frames = 0, objects = 0;
+    gint i;
+
+    if (!read_exact (fp, prefix, sizeof (prefix)))
+      break;
+    for (i = 0; i < NVDS_BINARY_PAYLOAD_PREFIX_SIZE; i++)
+      len |= (guint32) prefix[i] << (8 * i);
+    if (len > NVDS_BINARY_PAYLOAD_MAX_RECORD_SIZE) {
+      g_printerr ("Record %" G_GUINT64_FORMAT ": length %u too large\n",
+          num_records, len);
+      goto done;
+    }
+
+    body.resize (len);
+    if (!read_exact (fp, body.data (), len)) {
+      g_printerr ("Record %" G_GUINT64_FORMAT ": truncated\n", num_records);
+      goto done;
+    }
+
+    json.clear ();
+    if (!nvds_binary_payload_to_json (body.data (), len, json, reason,
+            &frames, &objects)) {
+      g_printerr ("Record %" G_GUINT64_FORMAT ": %s\n", num_records,
+          reason.c_str ());
+      goto done;
+    }
+
+    num_records++;
+    num_frames += frames;
+    num_objects += objects;
+    binary_bytes += NVDS_BINARY_PAYLOAD_PREFIX_SIZE + len;
+    json_bytes += json.size ();
+    if (!stats_only)
+      fwrite (json.data (), 1, json.size (), stdout);
+  }
+
+  if (stats_only) {
+    g_print ("records: %" G_GUINT64_FORMAT "\n", num_records);
+    g_print ("frames: %" G_GUINT64_FORMAT "\n", num_frames);
+    g_print ("objects: %" G_GUINT64_FORMAT "\n", num_objects);
+    g_print ("binary bytes: %" G_GUINT64_FORMAT "\n", binary_bytes);
+    g_print ("json bytes (minimal, compact): %" G_GUINT64_FORMAT "\n",
+        json_bytes);
+    if (num_objects) {
+      g_print ("binary bytes/object: %.1f\n",
+          (gdouble) binary_bytes / num_objects);
+      g_print ("json bytes/object: %.1f\n", (gdouble) json_bytes / num_objects);
+    }
+    if (binary_bytes)
+      g_print ("ratio: %.2f\n", (gdouble) json_bytes / binary_bytes);
+  }
+
+  ret = 0;
+done:
+  if (fp && fp != stdin)
+    fclose (fp);
+  if (ctx)
+    g_option_context_free (ctx);
+  return ret;
+}
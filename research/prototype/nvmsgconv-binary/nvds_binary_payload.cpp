@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "nvds_binary_payload.h"
+
+/* ---------------------------------------------------------------- encode */
+
+static void
+put_varint (std::string & out, guint64 value)
+{
+  while (value >= 0x80) {
+    out.push_back ((gchar) (value | 0x80));
+    value >>= 7;
+  }
+  out.push_back ((gchar) value);
+}
+
+static void
+put_zigzag (std::string & out, gint64 value)
+{
+  put_varint (out, ((guint64) value << 1) ^ (guint64) (value >> 63));
+}
+
+static void
+put_double (std::string & out, gdouble value)
+{
+  guint64 bits;
+  gint i;
+
+  memcpy (&bits, &value, sizeof (bits));
+  for (i = 0; i < 8; i++)
+    out.push_back ((gchar) (bits >> (8 * i)));
+}
+
+static gint64
+round_pixel (gfloat value)
+{
+  return (gint64) std::lround (value);
+}
+
+void
+NvDsBinaryStringTable::clear ()
+{
+  m_refs.clear ();
+  m_strings.clear ();
+  m_bytes = 0;
+}
+
+guint64
+NvDsBinaryStringTable::ref (const gchar * value)
+{
+  if (!value)
+    return 0;
+
+  auto it = m_refs.find (value);
+  if (it != m_refs.end ())
+    return it->second;
+
+  m_strings.push_back (value);
+  m_refs.emplace (m_strings.back (), m_strings.size ());
+  m_bytes += m_strings.back ().size () + 1;
+  return m_strings.size ();
+}
+
+void
+NvDsBinaryStringTable::write (std::string & out) const
+{
+  put_varint (out, m_strings.size ());
+  for (const std::string & s : m_strings) {
+    put_varint (out, s.size ());
+    out.append (s);
+  }
+}
+
+static void
+encode_ext (std::string & out, NvDsBinaryStringTable & strings,
+    NvDsEventMsgMeta * meta)
+{
+  switch (meta->objType) {
+    case NVDS_OBJECT_TYPE_VEHICLE:
+    case NVDS_OBJECT_TYPE_VEHICLE_EXT:{
+      /* NvDsVehicleObjectExt는 NvDsVehicleObject 뒤에 mask만 추가된 구조입니다. */
+      NvDsVehicleObject *obj = (NvDsVehicleObject *) meta->extMsg;
+      out.push_back (NVDS_BINARY_EXT_VEHICLE);
+      put_varint (out, strings.ref (obj->type));
+      put_varint (out, strings.ref (obj->make));
+      put_varint (out, strings.ref (obj->model));
+      put_varint (out, strings.ref (obj->color));
+      put_varint (out, strings.ref (obj->region));
+      put_varint (out, strings.ref (obj->license));
+      break;
+    }
+    case NVDS_OBJECT_TYPE_PERSON:
+    case NVDS_OBJECT_TYPE_PERSON_EXT:{
+      NvDsPersonObject *obj = (NvDsPersonObject *) meta->extMsg;
+      out.push_back (NVDS_BINARY_EXT_PERSON);
+      put_varint (out, strings.ref (obj->gender));
+      put_varint (out, strings.ref (obj->hair));
+      put_varint (out, strings.ref (obj->cap));
+      put_varint (out, strings.ref (obj->apparel));
+      put_varint (out, obj->age);
+      break;
+    }
+    case NVDS_OBJECT_TYPE_FACE:
+    case NVDS_OBJECT_TYPE_FACE_EXT:{
+      NvDsFaceObject *obj = (NvDsFaceObject *) meta->extMsg;
+      out.push_back (NVDS_BINARY_EXT_FACE);
+      put_varint (out, strings.ref (obj->gender));
+      put_varint (out, strings.ref (obj->hair));
+      put_varint (out, strings.ref (obj->cap));
+      put_varint (out, strings.ref (obj->glasses));
+      put_varint (out, strings.ref (obj->facialhair));
+      put_varint (out, strings.ref (obj->name));
+      put_varint (out, strings.ref (obj->eyecolor));
+      put_varint (out, obj->age);
+      break;
+    }
+    default:
+      out.push_back (NVDS_BINARY_EXT_NONE);
+      break;
+  }
+}
+
+static gboolean
+has_ext (NvDsEventMsgMeta * meta)
+{
+  if (!meta->extMsg || !meta->extMsgSize)
+    return FALSE;
+
+  switch (meta->objType) {
+    case NVDS_OBJECT_TYPE_VEHICLE:
+    case NVDS_OBJECT_TYPE_VEHICLE_EXT:
+    case NVDS_OBJECT_TYPE_PERSON:
+    case NVDS_OBJECT_TYPE_PERSON_EXT:
+    case NVDS_OBJECT_TYPE_FACE:
+    case NVDS_OBJECT_TYPE_FACE_EXT:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+std::string
+nvds_binary_payload_sensor_key (NvDsEventMsgMeta * meta)
+{
+  return meta->sensorStr ? std::string (meta->sensorStr) :
+      std::to_string (meta->sensorId);
+}
+
+void
+NvDsBinaryRecord::reset (const gchar * sensor)
+{
+  m_strings.clear ();
+  m_frames.clear ();
+  m_objects.clear ();
+  m_sensorRef = m_strings.ref (sensor);
+  m_numFrames = 0;
+  m_numObjects = 0;
+  m_inFrame = false;
+}
+
+void
+NvDsBinaryRecord::flushFrame ()
+{
+  if (!m_inFrame)
+    return;
+
+  put_varint (m_frames, (guint32) m_frameId);
+  put_varint (m_frames, m_tsRef);
+  put_varint (m_frames, m_frameObjects);
+  m_frames.append (m_objects);
+  m_objects.clear ();
+  m_numFrames++;
+  m_inFrame = false;
+}
+
+void
+NvDsBinaryRecord::addEvents (NvDsEvent * events, guint size)
+{
+  guint i;
+
+  for (i = 0; i < size; i++) {
+    NvDsEventMsgMeta *meta = events[i].metadata;
+    guint64 ts_ref = m_strings.ref (meta->ts);
+    gint64 left = round_pixel (meta->bbox.left);
+    gint64 top = round_pixel (meta->bbox.top);
+    guint8 flags = 0;
+
+    if (!m_inFrame || meta->frameId != m_frameId || ts_ref != m_tsRef) {
+      flushFrame ();
+      m_inFrame = true;
+      m_frameId = meta->frameId;
+      m_tsRef = ts_ref;
+      m_frameObjects = 0;
+      m_prevLeft = 0;
+      m_prevTop = 0;
+    }
+
+    if (has_ext (meta))
+      flags |= NVDS_BINARY_OBJECT_HAS_EXT;
+    if (meta->location.lat != 0 || meta->location.lon != 0 ||
+        meta->location.alt != 0)
+      flags |= NVDS_BINARY_OBJECT_HAS_LOCATION;
+    if (meta->coordinate.x != 0 || meta->coordinate.y != 0 ||
+        meta->coordinate.z != 0)
+      flags |= NVDS_BINARY_OBJECT_HAS_COORDINATE;
+
+    m_objects.push_back ((gchar) flags);
+    put_varint (m_objects, (guint32) events[i].eventType);
+    put_zigzag (m_objects, (gint32) meta->objType);
+    put_zigzag (m_objects, meta->objClassId);
+    put_varint (m_objects, meta->trackingId);
+
+    put_zigzag (m_objects, left - m_prevLeft);
+    put_zigzag (m_objects, top - m_prevTop);
+    put_varint (m_objects, MAX (round_pixel (meta->bbox.width), 0));
+    put_varint (m_objects, MAX (round_pixel (meta->bbox.height), 0));
+    m_prevLeft = left;
+    m_prevTop = top;
+
+    put_zigzag (m_objects,
+        std::llround (meta->confidence * NVDS_BINARY_PAYLOAD_CONFIDENCE_SCALE));
+    put_varint (m_objects, m_strings.ref (meta->objectId));
+
+    if (flags & NVDS_BINARY_OBJECT_HAS_EXT)
+      encode_ext (m_objects, m_strings, meta);
+    if (flags & NVDS_BINARY_OBJECT_HAS_LOCATION) {
+      put_double (m_objects, meta->location.lat);
+      put_double (m_objects, meta->location.lon);
+      put_double (m_objects, meta->location.alt);
+    }
+    if (flags & NVDS_BINARY_OBJECT_HAS_COORDINATE) {
+      put_double (m_objects, meta->coordinate.x);
+      put_double (m_objects, meta->coordinate.y);
+      put_double (m_objects, meta->coordinate.z);
+    }
+
+    m_frameObjects++;
+    m_numObjects++;
+  }
+}
+
+gsize
+NvDsBinaryRecord::approxSize () const
+{
+  return NVDS_BINARY_PAYLOAD_PREFIX_SIZE + 3 + m_strings.byteSize () +
+      m_frames.size () + m_objects.size () + 16;
+}
+
+gsize
+NvDsBinaryRecord::finish (std::string & out)
+{
+  gsize start = out.size ();
+  guint32 body_len;
+  guint i;
+
+  flushFrame ();
+
+  /* 길이 prefix는 본문을 다 쓴 뒤에 채웁니다. */
+  out.append (NVDS_BINARY_PAYLOAD_PREFIX_SIZE, '\0');
+  out.push_back (NVDS_BINARY_PAYLOAD_MAGIC_0);
+  out.push_back (NVDS_BINARY_PAYLOAD_MAGIC_1);
+  out.push_back (NVDS_BINARY_PAYLOAD_VERSION);
+  m_strings.write (out);
+  put_varint (out, m_sensorRef);
+  put_varint (out, m_numFrames);
+  out.append (m_frames);
+
+  body_len = out.size () - start - NVDS_BINARY_PAYLOAD_PREFIX_SIZE;
+  for (i = 0; i < NVDS_BINARY_PAYLOAD_PREFIX_SIZE; i++)
+    out[start + i] = (gchar) (body_len >> (8 * i));
+
+  return out.size () - start;
+}
+
+gsize
+nvds_binary_payload_encode (NvDsEvent * events, guint size, std::string & out)
+{
+  /* 호출 스레드별로 재사용해 레코드마다 할당하지 않습니다. */
+  static thread_local NvDsBinaryRecord record;
+
+  record.reset (size > 0 ?
+      nvds_binary_payload_sensor_key (events[0].metadata).c_str () : NULL);
+  record.addEvents (events, size);
+  return record.finish (out);
+}
+
+/* ---------------------------------------------------------------- decode */
+
+class Reader
+{
+public:
+  Reader (const guint8 * data, gsize len):m_data (data), m_len (len)
+  {
+  }
+
+  bool u8 (guint8 & value)
+  {
+    if (m_pos >= m_len)
+      return false;
+    value = m_data[m_pos++];
+    return true;
+  }
+
+  bool varint (guint64 & value)
+  {
+    guint shift = 0;
+
+    value = 0;
+    while (m_pos < m_len && shift < 64) {
+      guint8 byte = m_data[m_pos++];
+      value |= (guint64) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+      shift += 7;
+    }
+    return false;
+  }
+
+  bool zigzag (gint64 & value)
+  {
+    guint64 raw;
+
+    if (!varint (raw))
+      return false;
+    value = (gint64) (raw >> 1) ^ -(gint64) (raw & 1);
+    return true;
+  }
+
+  bool f64 (gdouble & value)
+  {
+    guint64 bits = 0;
+    gint i;
+
+    if (m_len - m_pos < 8)
+      return false;
+    for (i = 0; i < 8; i++)
+      bits |= (guint64) m_data[m_pos++] << (8 * i);
+    memcpy (&value, &bits, sizeof (value));
+    return true;
+  }
+
+  bool bytes (gsize len, const gchar * &value)
+  {
+    if (m_len - m_pos < len)
+      return false;
+    value = (const gchar *) m_data + m_pos;
+    m_pos += len;
+    return true;
+  }
+
+private:
+  const guint8 *m_data;
+  gsize m_len;
+  gsize m_pos = 0;
+};
+
+static void
+append_json_string (std::string & json, const std::string & value)
+{
+  static const gchar hex[] = "0123456789abcdef";
+
+  json.push_back ('"');
+  for (guchar c:value) {
+    switch (c) {
+      case '"': json.append ("\\\""); break;
+      case '\\': json.append ("\\\\"); break;
+      case '\n': json.append ("\\n"); break;
+      case '\r': json.append ("\\r"); break;
+      case '\t': json.append ("\\t"); break;
+      default:
+        if (c < 0x20) {
+          json.append ("\\u00");
+          json.push_back (hex[c >> 4]);
+          json.push_back (hex[c & 0xf]);
+        } else {
+          json.push_back ((gchar) c);
+        }
+        break;
+    }
+  }
+  json.push_back ('"');
+}
+
+/* deepstream_schema의 object_enum_to_str()와 같은 이름을 사용합니다. */
+static std::string
+object_type_name (gint64 type, const std::string * label)
+{
+  switch (type) {
+    case NVDS_OBJECT_TYPE_VEHICLE:
+      return "Vehicle";
+    case NVDS_OBJECT_TYPE_FACE:
+      return "Face";
+    case NVDS_OBJECT_TYPE_PERSON:
+      return "Person";
+    case NVDS_OBJECT_TYPE_BAG:
+      return "Bag";
+    case NVDS_OBJECT_TYPE_BICYCLE:
+      return "Bicycle";
+    case NVDS_OBJECT_TYPE_ROADSIGN:
+      return "RoadSign";
+    case NVDS_OBJECT_TYPE_CUSTOM:
+      return "Custom";
+    case NVDS_OBJECT_TYPE_UNKNOWN:
+      return label ? *label : "Unknown";
+    default:
+      return "Unknown";
+  }
+}
+
+#define READ_OR_FAIL(expr, what) \
+  do { \
+    if (!(expr)) { \
+      error = "truncated " what; \
+      return FALSE; \
+    } \
+  } while (0)
+
+/* 프레임 하나를 minimal 스키마 JSON 한 줄로 변환합니다. */
+static gboolean
+decode_frame (Reader & reader, const std::vector<std::string> & strings,
+    guint64 frame_id, guint64 ts_ref, guint64 sensor_ref, guint64 num_objects,
+    std::string & json, std::string & error)
+{
+  gint64 left = 0, top = 0;
+  guint64 i;
+  std::ostringstream ss;
+
+  /* ref -> 문자열. 0(NULL)이나 범위 밖은 빈 문자열입니다. */
+  auto str = [&strings] (guint64 ref)->const std::string * {
+    return (ref > 0 && ref <= strings.size ())? &strings[ref - 1] : NULL;
+  };
+  auto str_or_empty = [&str] (guint64 ref)->std::string {
+    const std::string *s = str (ref);
+    return s ? *s : std::string ();
+  };
+
+  json.append ("{\"version\":\"4.0\",\"id\":");
+  json.append (std::to_string ((gint) frame_id));
+  json.append (",\"@timestamp\":");
+  append_json_string (json, str_or_empty (ts_ref));
+  json.append (",\"sensorId\":");
+  append_json_string (json, str_or_empty (sensor_ref));
+  json.append (",\"objects\":[");
+
+  for (i = 0; i < num_objects; i++) {
+    guint8 flags;
+    guint64 event_type, tracking_id, width, height, label_ref;
+    gint64 obj_type, class_id, dleft, dtop, confidence_q;
+    gdouble confidence;
+
+    READ_OR_FAIL (reader.u8 (flags) && reader.varint (event_type)
+        && reader.zigzag (obj_type) && reader.zigzag (class_id)
+        && reader.varint (tracking_id) && reader.zigzag (dleft)
+        && reader.zigzag (dtop) && reader.varint (width)
+        && reader.varint (height) && reader.zigzag (confidence_q)
+        && reader.varint (label_ref), "object");
+
+    left += dleft;
+    top += dtop;
+    confidence = confidence_q / NVDS_BINARY_PAYLOAD_CONFIDENCE_SCALE;
+
+    ss.str ("");
+    ss.clear ();
+    ss << tracking_id << "|" << left << "|" << top << "|" << left + (gint64) width
+        << "|" << top + (gint64) height << "|"
+        << object_type_name (obj_type, str (label_ref));
+
+    if (flags & NVDS_BINARY_OBJECT_HAS_EXT) {
+      guint8 kind;
+      guint64 ref[7], age;
+
+      READ_OR_FAIL (reader.u8 (kind), "ext");
+      switch (kind) {
+        case NVDS_BINARY_EXT_VEHICLE:
+          for (gint k = 0; k < 6; k++)
+            READ_OR_FAIL (reader.varint (ref[k]), "vehicle");
+          /* type|make|model|color|license|region */
+          ss << "|#|" << str_or_empty (ref[0]) << "|" << str_or_empty (ref[1])
+              << "|" << str_or_empty (ref[2]) << "|" << str_or_empty (ref[3])
+              << "|" << str_or_empty (ref[5]) << "|" << str_or_empty (ref[4])
+              << "|" << confidence;
+          break;
+        case NVDS_BINARY_EXT_PERSON:
+          for (gint k = 0; k < 4; k++)
+            READ_OR_FAIL (reader.varint (ref[k]), "person");
+          READ_OR_FAIL (reader.varint (age), "person");
+          ss << "|#|" << str_or_empty (ref[0]) << "|" << age << "|"
+              << str_or_empty (ref[1]) << "|" << str_or_empty (ref[2]) << "|"
+              << str_or_empty (ref[3]) << "|" << confidence;
+          break;
+        case NVDS_BINARY_EXT_FACE:
+          for (gint k = 0; k < 7; k++)
+            READ_OR_FAIL (reader.varint (ref[k]), "face");
+          READ_OR_FAIL (reader.varint (age), "face");
+          ss << "|#|" << str_or_empty (ref[0]) << "|" << age << "|"
+              << str_or_empty (ref[1]) << "|" << str_or_empty (ref[2]) << "|"
+              << str_or_empty (ref[3]) << "|" << str_or_empty (ref[4]) << "|"
+              << str_or_empty (ref[5]) << "||" << str_or_empty (ref[6])
+              << "|" << confidence;
+          break;
+        case NVDS_BINARY_EXT_NONE:
+          break;
+        default:
+          error = "unknown ext kind " + std::to_string (kind);
+          return FALSE;
+      }
+    }
+
+    /* minimal 스키마에는 location/coordinate가 없으므로 읽고 버립니다. */
+    if (flags & NVDS_BINARY_OBJECT_HAS_LOCATION) {
+      gdouble v[3];
+      READ_OR_FAIL (reader.f64 (v[0]) && reader.f64 (v[1])
+          && reader.f64 (v[2]), "location");
+    }
+    if (flags & NVDS_BINARY_OBJECT_HAS_COORDINATE) {
+      gdouble v[3];
+      READ_OR_FAIL (reader.f64 (v[0]) && reader.f64 (v[1])
+          && reader.f64 (v[2]), "coordinate");
+    }
+
+    (void) event_type;
+    (void) class_id;
+
+    if (i > 0)
+      json.push_back (',');
+    append_json_string (json, ss.str ());
+  }
+
+  json.append ("]}\n");
+  return TRUE;
+}
+
+gboolean
+nvds_binary_payload_to_json (const guint8 * body, gsize len,
+    std::string & json, std::string & error, guint * num_frames,
+    guint * num_objects)
+{
+  Reader reader (body, len);
+  std::vector<std::string> strings;
+  guint64 num_strings, frame_id, ts_ref, sensor_ref, frame_objects, frames, i;
+  guint8 magic0, magic1, version;
+
+  if (num_frames)
+    *num_frames = 0;
+  if (num_objects)
+    *num_objects = 0;
+
+  READ_OR_FAIL (reader.u8 (magic0) && reader.u8 (magic1)
+      && reader.u8 (version), "header");
+  if (magic0 != NVDS_BINARY_PAYLOAD_MAGIC_0 ||
+      magic1 != NVDS_BINARY_PAYLOAD_MAGIC_1) {
+    error = "bad magic";
+    return FALSE;
+  }
+  if (version != 1 && version != NVDS_BINARY_PAYLOAD_VERSION) {
+    error = "unsupported version " + std::to_string (version);
+    return FALSE;
+  }
+
+  READ_OR_FAIL (reader.varint (num_strings), "string table");
+  for (i = 0; i < num_strings; i++) {
+    guint64 slen;
+    const gchar *data;
+
+    READ_OR_FAIL (reader.varint (slen) && reader.bytes (slen, data),
+        "string table");
+    strings.emplace_back (data, slen);
+  }
+
+  if (version == 1) {
+    READ_OR_FAIL (reader.varint (frame_id) && reader.varint (ts_ref)
+        && reader.varint (sensor_ref) && reader.varint (frame_objects),
+        "frame header");
+    if (!decode_frame (reader, strings, frame_id, ts_ref, sensor_ref,
+            frame_objects, json, error))
+      return FALSE;
+    if (num_frames)
+      *num_frames = 1;
+    if (num_objects)
+      *num_objects = frame_objects;
+    return TRUE;
+  }
+
+  READ_OR_FAIL (reader.varint (sensor_ref) && reader.varint (frames),
+      "record header");
+  for (i = 0; i < frames; i++) {
+    READ_OR_FAIL (reader.varint (frame_id) && reader.varint (ts_ref)
+        && reader.varint (frame_objects), "frame header");
+    if (!decode_frame (reader, strings, frame_id, ts_ref, sensor_ref,
+            frame_objects, json, error))
+      return FALSE;
+    if (num_frames)
+      (*num_frames)++;
+    if (num_objects)
+      *num_objects += frame_objects;
+  }
+
+  return TRUE;
+}
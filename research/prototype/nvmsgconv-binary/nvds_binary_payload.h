@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __NVDS_BINARY_PAYLOAD_H__
+#define __NVDS_BINARY_PAYLOAD_H__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+#include "nvdsmeta_schema.h"
+
+/*
+ * 이벤트 바이너리 레코드 (버전 2)
+ *
+ * 한 레코드는 한 센서의 프레임 하나 이상을 담습니다. 배치를 사용하지 않으면
+ * nvds_msg2p_generate 호출(한 프레임의 이벤트들)마다 프레임 하나짜리 레코드가 됩니다.
+ * 정수는 LEB128 varint, 부호 있는 값은 zigzag varint, 실수는 little-endian
+ * IEEE754 double 입니다.
+ *
+ *  record  := u32le body_len | body
+ *  body    := 'D' 'B' | u8 version | varint num_strings | string*
+ *             | varint sensor_ref | varint num_frames | frame*
+ *  string  := varint len | bytes
+ *  frame   := varint frame_id | varint ts_ref | varint num_objects | object*
+ *  object  := u8 flags | varint event_type | zigzag obj_type | zigzag class_id
+ *             | varint tracking_id
+ *             | zigzag dleft | zigzag dtop | varint width | varint height
+ *             | zigzag confidence_q | varint label_ref
+ *             | [EXT] u8 ext_kind | varint ref* | [age] varint age
+ *             | [LOCATION] f64 lat lon alt
+ *             | [COORDINATE] f64 x y z
+ *
+ * - *_ref는 레코드 앞의 문자열 테이블 인덱스 + 1 이며 0은 NULL입니다.
+ *   같은 레이블/속성 문자열은 레코드 안에서 한 번만 기록됩니다.
+ *   레코드마다 테이블을 새로 만들기 때문에 소비자는 임의의 레코드부터 읽을 수 있습니다.
+ * - bbox는 정수 픽셀로 반올림하고 left/top은 같은 프레임의 직전 객체와의 차이로 기록합니다.
+ * - confidence는 NVDS_BINARY_PAYLOAD_CONFIDENCE_SCALE 단위로 양자화합니다.
+ * - 마스크, 포즈, 시그니처, 임베딩은 기록하지 않습니다.
+ *
+ * 버전 1은 프레임이 하나뿐이고 헤더가
+ * "varint frame_id | varint ts_ref | varint sensor_ref | varint num_objects"
+ * 인 것만 다르며 디코더는 두 버전을 모두 읽습니다.
+ */
+
+#define NVDS_BINARY_PAYLOAD_MAGIC_0 'D'
+#define NVDS_BINARY_PAYLOAD_MAGIC_1 'B'
+#define NVDS_BINARY_PAYLOAD_VERSION (2)
+
+/** 길이 prefix 크기 */
+#define NVDS_BINARY_PAYLOAD_PREFIX_SIZE (4)
+
+/** 손상된 입력으로 과도한 메모리를 잡지 않도록 하는 레코드 크기 상한 */
+#define NVDS_BINARY_PAYLOAD_MAX_RECORD_SIZE (64 * 1024 * 1024)
+
+#define NVDS_BINARY_PAYLOAD_CONFIDENCE_SCALE (10000.0)
+
+/** object flags */
+#define NVDS_BINARY_OBJECT_HAS_EXT (1 << 0)
+#define NVDS_BINARY_OBJECT_HAS_LOCATION (1 << 1)
+#define NVDS_BINARY_OBJECT_HAS_COORDINATE (1 << 2)
+
+/** ext_kind 별 문자열 ref 개수와 age 유무는 구조체 필드 순서를 따릅니다. */
+typedef enum
+{
+  NVDS_BINARY_EXT_NONE = 0,
+  /** type, make, model, color, region, license */
+  NVDS_BINARY_EXT_VEHICLE = 1,
+  /** gender, hair, cap, apparel, age */
+  NVDS_BINARY_EXT_PERSON = 2,
+  /** gender, hair, cap, glasses, facialhair, name, eyecolor, age */
+  NVDS_BINARY_EXT_FACE = 3,
+} NvDsBinaryExtKind;
+
+/** 레코드 안에서 문자열을 한 번만 기록하기 위한 테이블 */
+class NvDsBinaryStringTable
+{
+public:
+  void clear ();
+  /** value의 ref (NULL이면 0) */
+  guint64 ref (const gchar * value);
+  void write (std::string & out) const;
+  gsize byteSize () const { return m_bytes; }
+
+private:
+  std::unordered_map<std::string, guint64> m_refs;
+  std::vector<std::string> m_strings;
+  gsize m_bytes = 0;
+};
+
+/**
+ * 한 센서의 레코드를 만듭니다. 프레임을 여러 번에 걸쳐 추가한 뒤 finish()로 마무리하며,
+ * finish() 후에는 reset() 해서 다시 사용합니다.
+ */
+class NvDsBinaryRecord
+{
+public:
+  void reset (const gchar * sensor);
+
+  /**
+   * events를 추가합니다. frameId나 ts가 바뀔 때마다 새 프레임으로 나눕니다.
+   * events의 센서는 reset()에 준 센서와 같아야 합니다.
+   */
+  void addEvents (NvDsEvent * events, guint size);
+
+  /** 길이 prefix를 포함한 레코드를 out 뒤에 덧붙이고 덧붙인 바이트 수를 반환합니다. */
+  gsize finish (std::string & out);
+
+  guint numFrames () const { return m_numFrames; }
+  guint numObjects () const { return m_numObjects; }
+  /** 지금 finish()하면 만들어질 레코드 크기의 근사값 */
+  gsize approxSize () const;
+
+private:
+  void flushFrame ();
+
+  NvDsBinaryStringTable m_strings;
+  std::string m_frames;
+  std::string m_objects;
+  guint64 m_sensorRef = 0;
+  guint m_numFrames = 0;
+  guint m_numObjects = 0;
+
+  /* 진행 중인 프레임 */
+  bool m_inFrame = false;
+  gint m_frameId = 0;
+  guint64 m_tsRef = 0;
+  guint m_frameObjects = 0;
+  gint64 m_prevLeft = 0;
+  gint64 m_prevTop = 0;
+};
+
+/**
+ * @brief  이벤트의 센서 키를 sensorStr, 없으면 sensorId 10진수로 돌려줍니다.
+ */
+std::string nvds_binary_payload_sensor_key (NvDsEventMsgMeta * meta);
+
+/**
+ * @brief  events를 프레임 하나짜리 레코드(길이 prefix 포함)로 out 뒤에 덧붙입니다.
+ *         센서는 첫 이벤트의 것을 사용합니다.
+ * @return 덧붙인 바이트 수
+ */
+gsize nvds_binary_payload_encode (NvDsEvent * events, guint size,
+    std::string & out);
+
+/**
+ * @brief  레코드 본문(길이 prefix 제외)을 프레임마다 DeepStream minimal 스키마
+ *         (version 4.0) JSON 하나로 변환해 json 뒤에 줄 단위로 덧붙입니다.
+ * @param  num_frames [OUT] 변환한 프레임 수 (NULL 가능)
+ * @param  num_objects [OUT] 변환한 객체 수 (NULL 가능)
+ * @return 형식이 잘못되었으면 FALSE이고 error에 이유를 채웁니다.
+ */
+gboolean nvds_binary_payload_to_json (const guint8 * body, gsize len,
+    std::string & json, std::string & error, guint * num_frames,
+    guint * num_objects);
+
+#endif
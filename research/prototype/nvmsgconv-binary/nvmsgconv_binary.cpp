@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * nvmsgconv 사용자 정의 payload 라이브러리 (msg-conv-payload-type: 257)
+ *
+ * NvDsEventMsgMeta를 nvds_binary_payload.h의 바이너리 레코드로 변환합니다.
+ * nvmsgbroker/Kafka 어댑터는 payload를 바이트열 그대로 전송하므로
+ * 브로커 쪽은 변경 없이 libnvds_kafka_proto.so를 사용합니다.
+ */
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "nvmsgconv.h"
+#include "nvds_binary_payload.h"
+
+#define CONFIG_GROUP_BINARY_BATCH "binary-batch"
+
+typedef struct
+{
+  // binary-batch:
+  // enable: 1
+  // window-ms: 200
+  // max-objects: 500
+  // max-bytes: 65536
+  gboolean enable;
+  /** 센서별로 첫 프레임이 들어온 뒤 이 시간이 지나면 다음 호출에서 내보냅니다.
+   * 0이면 호출마다. 호출이 없으면 내보내지 않으므로 지연 상한이 아닙니다. */
+  guint window_ms;
+  /** 배치의 객체 수가 이 값에 도달하면 바로 내보냅니다. 0이면 제한 없음 */
+  guint max_objects;
+  /** 배치의 레코드 크기가 이 값에 도달하면 바로 내보냅니다. 0이면 제한 없음 */
+  guint max_bytes;
+} NvDsBinaryBatchConfig;
+
+typedef struct
+{
+  NvDsBinaryRecord record;
+  /** 배치의 첫 프레임이 들어온 시각 (g_get_monotonic_time) */
+  gint64 first_us;
+  bool active;
+} NvDsBinaryBatch;
+
+typedef struct
+{
+  NvDsBinaryBatchConfig config;
+  std::mutex lock;
+  /** 센서 키 -> 진행 중인 배치 */
+  std::map<std::string, NvDsBinaryBatch> batches;
+} NvDsBinaryCtx;
+
+static NvDsPayload *
+new_payload (const std::string & buffer)
+{
+  NvDsPayload *payload = (NvDsPayload *) g_malloc0 (sizeof (NvDsPayload));
+
+  payload->payload = g_memdup2 (buffer.data (), buffer.size ());
+  payload->payloadSize = buffer.size ();
+  payload->componentId = 0;
+
+  return payload;
+}
+
+static NvDsPayload *
+new_frame_payload (NvDsEvent * events, guint size)
+{
+  /* 스레드별 버퍼에 인코딩한 뒤 정확한 크기로 한 번만 복사합니다. */
+  static thread_local std::string buffer;
+
+  buffer.clear ();
+  nvds_binary_payload_encode (events, size, buffer);
+  return new_payload (buffer);
+}
+
+static gboolean
+parse_batch_config (const gchar * file, NvDsBinaryBatchConfig * config)
+{
+  gboolean ret = FALSE;
+
+  if (!file)
+    return TRUE;
+
+  try {
+    YAML::Node root = YAML::LoadFile (file);
+    YAML::Node group = root[CONFIG_GROUP_BINARY_BATCH];
+
+    if (group) {
+      for (YAML::const_iterator itr = group.begin (); itr != group.end ();
+          ++itr) {
+        std::string paramKey = itr->first.as<std::string> ();
+        if (paramKey == "enable") {
+          config->enable = itr->second.as<gboolean> ();
+        } else if (paramKey == "window-ms") {
+          config->window_ms = itr->second.as<guint> ();
+        } else if (paramKey == "max-objects") {
+          config->max_objects = itr->second.as<guint> ();
+        } else if (paramKey == "max-bytes") {
+          config->max_bytes = itr->second.as<guint> ();
+        } else {
+          g_printerr ("nvmsgconv-binary: unknown key '%s' in %s\n",
+              paramKey.c_str (), CONFIG_GROUP_BINARY_BATCH);
+        }
+      }
+    }
+    ret = TRUE;
+  } catch (const YAML::Exception & e) {
+    g_printerr ("nvmsgconv-binary: failed to parse %s: %s\n", file, e.what ());
+  }
+
+  return ret;
+}
+
+static void
+flush_batch (NvDsBinaryBatch & batch, std::vector<NvDsPayload *> &out)
+{
+  static thread_local std::string buffer;
+
+  buffer.clear ();
+  batch.record.finish (buffer);
+  out.push_back (new_payload (buffer));
+  batch.active = false;
+}
+
+static bool
+batch_full (const NvDsBinaryBatchConfig * config, const NvDsBinaryBatch & batch)
+{
+  return (config->max_objects &&
+      batch.record.numObjects () >= config->max_objects) ||
+      (config->max_bytes && batch.record.approxSize () >= config->max_bytes);
+}
+
+/* 첫 프레임 후 window-ms가 지난 배치를 out에 내보냅니다. */
+static void
+flush_expired (NvDsBinaryCtx * bctx, gint64 now_us,
+    std::vector<NvDsPayload *> &out)
+{
+  gint64 window_us = (gint64) bctx->config.window_ms * 1000;
+
+  for (auto & it : bctx->batches) {
+    NvDsBinaryBatch & batch = it.second;
+
+    if (batch.active && now_us - batch.first_us >= window_us)
+      flush_batch (batch, out);
+  }
+}
+
+/*
+ * 이벤트를 센서별 배치에 추가하고 크기/시간 조건을 만족한 배치를 out에 내보냅니다.
+ * 타이머가 없으므로 시간 조건은 호출마다(이벤트가 없는 호출 포함) 확인합니다.
+ * 만료된 배치는 이벤트를 추가하기 전에 먼저 내보내 새 이벤트가 늦은 배치에
+ * 섞이지 않게 합니다.
+ */
+static void
+batch_events (NvDsBinaryCtx * bctx, NvDsEvent * events, guint size,
+    std::vector<NvDsPayload *> &out)
+{
+  const NvDsBinaryBatchConfig *config = &bctx->config;
+  gint64 now_us = g_get_monotonic_time ();
+  guint i;
+
+  flush_expired (bctx, now_us, out);
+
+  for (i = 0; i < size; i++) {
+    std::string key = nvds_binary_payload_sensor_key (events[i].metadata);
+    NvDsBinaryBatch & batch = bctx->batches[key];
+
+    if (!batch.active) {
+      batch.record.reset (key.c_str ());
+      batch.first_us = now_us;
+      batch.active = true;
+    }
+    batch.record.addEvents (&events[i], 1);
+
+    if (batch_full (config, batch))
+      flush_batch (batch, out);
+  }
+
+  /* window-ms: 0 이면 이번 호출의 배치도 바로 내보냅니다. */
+  if (size > 0 && config->window_ms == 0)
+    flush_expired (bctx, now_us, out);
+}
+
+NvDsMsg2pCtx *
+nvds_msg2p_ctx_create (const gchar * file, NvDsPayloadType type)
+{
+  NvDsMsg2pCtx *ctx = NULL;
+  NvDsBinaryCtx *bctx = NULL;
+
+  if (type != NVDS_PAYLOAD_CUSTOM) {
+    g_printerr ("nvmsgconv-binary: unsupported payload type %d, use %d\n",
+        type, NVDS_PAYLOAD_CUSTOM);
+    return NULL;
+  }
+
+  /* 센서/장소 정보는 레코드에 넣지 않으므로 설정 파일에서는 배치 설정만 읽습니다. */
+  bctx = new NvDsBinaryCtx ();
+  bctx->config = NvDsBinaryBatchConfig ();
+  if (!parse_batch_config (file, &bctx->config)) {
+    delete bctx;
+    return NULL;
+  }
+
+  ctx = (NvDsMsg2pCtx *) g_malloc0 (sizeof (NvDsMsg2pCtx));
+  ctx->payloadType = type;
+  ctx->privData = bctx;
+
+  return ctx;
+}
+
+/*
+ * msg2p API에는 해제 시 payload를 돌려줄 방법이 없어 남은 배치는 버리고
+ * 개수만 출력합니다.
+ */
+void
+nvds_msg2p_ctx_destroy (NvDsMsg2pCtx * ctx)
+{
+  NvDsBinaryCtx *bctx = NULL;
+
+  if (!ctx)
+    return;
+
+  bctx = (NvDsBinaryCtx *) ctx->privData;
+  if (bctx) {
+    guint pending = 0;
+
+    for (auto & it : bctx->batches) {
+      if (it.second.active)
+        pending += it.second.record.numObjects ();
+    }
+    if (pending)
+      g_printerr ("nvmsgconv-binary: dropping %u batched objects\n", pending);
+    delete bctx;
+  }
+  g_free (ctx);
+}
+
+NvDsPayload *
+nvds_msg2p_generate (NvDsMsg2pCtx * ctx, NvDsEvent * events, guint size)
+{
+  g_return_val_if_fail (ctx, NULL);
+  g_return_val_if_fail (events || size == 0, NULL);
+
+  /* payload를 하나만 돌려줄 수 있으므로 배치 설정과 무관하게 호출 단위로 만듭니다. */
+  return new_frame_payload (events, size);
+}
+
+/**
+ * binary-batch가 꺼져 있으면 전체 이벤트를 하나의 레코드로 만들고,
+ * 켜져 있으면 내보낼 배치가 없을 때 *payloadCount = 0, NULL을 반환합니다.
+ * 이벤트가 없는 호출(size 0)은 빈 레코드를 만들지 않고 만료된 배치만 내보냅니다.
+ * 배치를 사용하려면 sink 그룹에 multiple-payloads: 1 이 필요합니다.
+ */
+NvDsPayload **
+nvds_msg2p_generate_multiple (NvDsMsg2pCtx * ctx, NvDsEvent * events,
+    guint size, guint * payloadCount)
+{
+  NvDsBinaryCtx *bctx = NULL;
+  NvDsPayload **payloads = NULL;
+  std::vector<NvDsPayload *> out;
+
+  g_return_val_if_fail (ctx && ctx->privData && payloadCount, NULL);
+  g_return_val_if_fail (events || size == 0, NULL);
+
+  bctx = (NvDsBinaryCtx *) ctx->privData;
+  if (!bctx->config.enable) {
+    if (size > 0)
+      out.push_back (new_frame_payload (events, size));
+  } else {
+    std::lock_guard<std::mutex> guard (bctx->lock);
+    batch_events (bctx, events, size, out);
+  }
+
+  *payloadCount = out.size ();
+  if (out.empty ())
+    return NULL;
+
+  payloads = (NvDsPayload **) g_malloc0 (sizeof (NvDsPayload *) * out.size ());
+  std::copy (out.begin (), out.end (), payloads);
+
+  return payloads;
+}
+
+/* msg2p-newapi(NvDsFrameMeta 기반)는 지원하지 않습니다. */
+NvDsPayload *
+nvds_msg2p_generate_new (NvDsMsg2pCtx * ctx, void *metadataInfo)
+{
+  (void) ctx;
+  (void) metadataInfo;
+  g_printerr ("nvmsgconv-binary: msg2p-newapi is not supported\n");
+  return NULL;
+}
+
+NvDsPayload **
+nvds_msg2p_generate_multiple_new (NvDsMsg2pCtx * ctx,
+    NvDsMsg2pMetaInfo * metaInfo, guint * payloadCount)
+{
+  (void) ctx;
+  (void) metaInfo;
+  g_printerr ("nvmsgconv-binary: msg2p-newapi is not supported\n");
+  if (payloadCount)
+    *payloadCount = 0;
+  return NULL;
+}
+
+void
+nvds_msg2p_release (NvDsMsg2pCtx * ctx, NvDsPayload * payload)
+{
+  (void) ctx;
+
+  if (!payload)
+    return;
+  g_free (payload->payload);
+  g_free (payload);
+}
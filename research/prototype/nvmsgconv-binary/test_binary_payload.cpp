@@ -0,0 +1,844 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * nvds_binary_payload / nvmsgconv_binary 단위 테스트와 벤치마크
+ *
+ *   make check   테스트 실행
+ *   make bench   -m perf 로 벤치마크까지 실행
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glib/gstdio.h>
+
+#include "nvmsgconv.h"
+#include "nvds_binary_payload.h"
+
+/* 한 프레임의 이벤트. add()가 돌려준 참조가 유지되도록 metas를 미리 잡아 둡니다. */
+#define TEST_FRAME_MAX_OBJECTS (64)
+
+struct TestFrame
+{
+  std::vector<NvDsEventMsgMeta> metas;
+  std::vector<NvDsEvent> events;
+
+  TestFrame ()
+  {
+    metas.reserve (TEST_FRAME_MAX_OBJECTS);
+  }
+
+  NvDsEventMsgMeta & add (NvDsObjectType type, gint frame_id, const gchar * ts)
+  {
+    NvDsEventMsgMeta meta;
+
+    g_assert_cmpuint (metas.size (), <, TEST_FRAME_MAX_OBJECTS);
+    memset (&meta, 0, sizeof (meta));
+    meta.objType = type;
+    meta.frameId = frame_id;
+    meta.ts = (gchar *) ts;
+    meta.sensorStr = (gchar *) "cam-0";
+    metas.push_back (meta);
+    return metas.back ();
+  }
+
+  NvDsEvent *build ()
+  {
+    events.clear ();
+    for (NvDsEventMsgMeta & meta : metas)
+      events.push_back ({NVDS_EVENT_ENTRY, &meta});
+    return events.data ();
+  }
+};
+
+static NvDsVehicleObject vehicle = {
+  (gchar *) "sedan", (gchar *) "Bugatti", (gchar *) "M", (gchar *) "blue",
+  (gchar *) "CA", (gchar *) "XX1234"
+};
+
+static NvDsPersonObject person = {
+  (gchar *) "male", (gchar *) "black", (gchar *) "none", (gchar *) "formal", 45
+};
+
+static void
+set_bbox (NvDsEventMsgMeta & meta, gfloat left, gfloat top, gfloat width,
+    gfloat height)
+{
+  meta.bbox.left = left;
+  meta.bbox.top = top;
+  meta.bbox.width = width;
+  meta.bbox.height = height;
+}
+
+/* 길이 prefix를 확인하고 본문을 JSON으로 변환합니다. */
+static std::string
+decode_record (const std::string & record, guint * num_frames,
+    guint * num_objects)
+{
+  std::string json, error;
+  guint32 len = 0;
+  gboolean ok;
+  gint i;
+
+  g_assert_cmpuint (record.size (), >=, NVDS_BINARY_PAYLOAD_PREFIX_SIZE);
+  for (i = 0; i < NVDS_BINARY_PAYLOAD_PREFIX_SIZE; i++)
+    len |= (guint32) (guint8) record[i] << (8 * i);
+  g_assert_cmpuint (len, ==, record.size () - NVDS_BINARY_PAYLOAD_PREFIX_SIZE);
+
+  ok = nvds_binary_payload_to_json ((const guint8 *) record.data () +
+      NVDS_BINARY_PAYLOAD_PREFIX_SIZE, len, json, error, num_frames,
+      num_objects);
+  g_assert_cmpstr (error.c_str (), ==, "");
+  g_assert_true (ok);
+  return json;
+}
+
+static void
+test_round_trip_objects (void)
+{
+  TestFrame frame;
+  std::string record, json;
+  guint frames, objects;
+
+  NvDsEventMsgMeta & v = frame.add (NVDS_OBJECT_TYPE_VEHICLE, 7, "ts-7");
+  set_bbox (v, 100, 50, 40, 30);
+  v.trackingId = 12;
+  v.confidence = 0.75;
+  v.extMsg = &vehicle;
+  v.extMsgSize = sizeof (vehicle);
+  v.location.lat = 37.5;
+
+  NvDsEventMsgMeta & p = frame.add (NVDS_OBJECT_TYPE_PERSON, 7, "ts-7");
+  set_bbox (p, 20, 80, 10, 60);
+  p.trackingId = 13;
+  p.confidence = 0.5;
+  p.extMsg = &person;
+  p.extMsgSize = sizeof (person);
+  p.coordinate.x = 1.0;
+
+  NvDsEventMsgMeta & u = frame.add (NVDS_OBJECT_TYPE_UNKNOWN, 7, "ts-7");
+  set_bbox (u, 300, 10, 5, 5);
+  u.trackingId = 14;
+  u.objectId = (gchar *) "forklift";
+
+  NvDsEventMsgMeta & b = frame.add (NVDS_OBJECT_TYPE_BAG, 7, "ts-7");
+  set_bbox (b, 0, 0, 1, 1);
+  b.trackingId = 15;
+
+  nvds_binary_payload_encode (frame.build (), frame.metas.size (), record);
+  json = decode_record (record, &frames, &objects);
+
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_cmpuint (objects, ==, 4);
+  /* bbox의 left/top은 직전 객체와의 차이로 기록되지만 복원 값은 같아야 합니다. */
+  g_assert_cmpstr (json.c_str (), ==,
+      "{\"version\":\"4.0\",\"id\":7,\"@timestamp\":\"ts-7\","
+      "\"sensorId\":\"cam-0\",\"objects\":["
+      "\"12|100|50|140|80|Vehicle|#|sedan|Bugatti|M|blue|XX1234|CA|0.75\","
+      "\"13|20|80|30|140|Person|#|male|45|black|none|formal|0.5\","
+      "\"14|300|10|305|15|forklift\"," "\"15|0|0|1|1|Bag\"]}\n");
+}
+
+static void
+test_round_trip_quantization (void)
+{
+  TestFrame frame;
+  std::string record, json;
+
+  NvDsEventMsgMeta & a = frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+  set_bbox (a, 10.4, 10.6, 20.5, -3);
+  a.trackingId = 1;
+  a.confidence = 0.12345;
+  a.extMsg = &person;
+  a.extMsgSize = sizeof (person);
+
+  nvds_binary_payload_encode (frame.build (), 1, record);
+  json = decode_record (record, NULL, NULL);
+
+  /* 정수 픽셀 반올림, 음수 크기는 0, confidence는 1e-4 단위입니다. */
+  g_assert_cmpstr (json.c_str (), ==,
+      "{\"version\":\"4.0\",\"id\":1,\"@timestamp\":\"ts\","
+      "\"sensorId\":\"cam-0\",\"objects\":["
+      "\"1|10|11|31|11|Person|#|male|45|black|none|formal|0.1235\"]}\n");
+}
+
+static void
+test_round_trip_frames (void)
+{
+  TestFrame frame;
+  NvDsBinaryRecord record;
+  std::string out, json;
+  guint frames, objects;
+  gint f, k;
+
+  for (f = 0; f < 3; f++) {
+    for (k = 0; k <= f; k++) {
+      NvDsEventMsgMeta & m = frame.add (NVDS_OBJECT_TYPE_BICYCLE, 100 + f,
+          f == 2 ? "ts-b" : "ts-a");
+      set_bbox (m, 10 * k, 0, 2, 2);
+      m.trackingId = k;
+    }
+  }
+  /* 같은 frameId여도 timestamp가 바뀌면 새 프레임입니다. */
+  NvDsEventMsgMeta & m = frame.add (NVDS_OBJECT_TYPE_BICYCLE, 102, "ts-c");
+  m.trackingId = 9;
+
+  record.reset ("cam-0");
+  frame.build ();
+  /* 여러 번에 나눠 추가해도 프레임 경계는 이벤트 순서로 정해집니다. */
+  record.addEvents (frame.events.data (), 2);
+  record.addEvents (frame.events.data () + 2, frame.events.size () - 2);
+  /* 진행 중인 마지막 프레임은 finish()에서 셉니다. */
+  g_assert_cmpuint (record.numFrames (), ==, 3);
+  g_assert_cmpuint (record.numObjects (), ==, 7);
+  g_assert_cmpuint (record.approxSize (), >, 0);
+  record.finish (out);
+
+  json = decode_record (out, &frames, &objects);
+  g_assert_cmpuint (frames, ==, 4);
+  g_assert_cmpuint (objects, ==, 7);
+  g_assert_cmpstr (json.c_str (), ==,
+      "{\"version\":\"4.0\",\"id\":100,\"@timestamp\":\"ts-a\","
+      "\"sensorId\":\"cam-0\",\"objects\":[\"0|0|0|2|2|Bicycle\"]}\n"
+      "{\"version\":\"4.0\",\"id\":101,\"@timestamp\":\"ts-a\","
+      "\"sensorId\":\"cam-0\",\"objects\":[\"0|0|0|2|2|Bicycle\","
+      "\"1|10|0|12|2|Bicycle\"]}\n"
+      "{\"version\":\"4.0\",\"id\":102,\"@timestamp\":\"ts-b\","
+      "\"sensorId\":\"cam-0\",\"objects\":[\"0|0|0|2|2|Bicycle\","
+      "\"1|10|0|12|2|Bicycle\",\"2|20|0|22|2|Bicycle\"]}\n"
+      "{\"version\":\"4.0\",\"id\":102,\"@timestamp\":\"ts-c\","
+      "\"sensorId\":\"cam-0\",\"objects\":[\"9|0|0|0|0|Bicycle\"]}\n");
+
+  /* reset 후 재사용하면 이전 프레임과 문자열이 남지 않아야 합니다. */
+  out.clear ();
+  record.reset ("cam-1");
+  record.addEvents (frame.events.data () + 6, 1);
+  record.finish (out);
+  json = decode_record (out, &frames, &objects);
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_cmpuint (objects, ==, 1);
+  g_assert_true (json.find ("\"sensorId\":\"cam-1\"") != std::string::npos);
+  g_assert_true (json.find ("ts-a") == std::string::npos);
+}
+
+static void
+test_sensor_key (void)
+{
+  NvDsEventMsgMeta meta;
+  std::string key;
+
+  memset (&meta, 0, sizeof (meta));
+  meta.sensorId = 3;
+  key = nvds_binary_payload_sensor_key (&meta);
+  g_assert_cmpstr (key.c_str (), ==, "3");
+  meta.sensorStr = (gchar *) "cam-3";
+  key = nvds_binary_payload_sensor_key (&meta);
+  g_assert_cmpstr (key.c_str (), ==, "cam-3");
+}
+
+static void
+test_string_table (void)
+{
+  TestFrame one, many;
+  std::string a, b;
+  gint i;
+
+  one.add (NVDS_OBJECT_TYPE_VEHICLE, 1, "2024-01-01T00:00:00.000Z");
+  for (i = 0; i < 20; i++) {
+    NvDsEventMsgMeta & m = many.add (NVDS_OBJECT_TYPE_VEHICLE, 1,
+        "2024-01-01T00:00:00.000Z");
+    m.extMsg = &vehicle;
+    m.extMsgSize = sizeof (vehicle);
+  }
+  one.metas[0].extMsg = &vehicle;
+  one.metas[0].extMsgSize = sizeof (vehicle);
+
+  nvds_binary_payload_encode (one.build (), 1, a);
+  nvds_binary_payload_encode (many.build (), 20, b);
+
+  /* 레이블/timestamp는 레코드에 한 번만 들어가므로 객체당 증가분은 고정 필드뿐입니다. */
+  g_assert_cmpuint ((b.size () - a.size ()) / 19, <, 20);
+}
+
+/* 이어 붙인 레코드를 길이 prefix로 나눕니다. 남는 바이트가 없어야 합니다. */
+static std::vector<std::string>
+split_records (const std::string & buffer)
+{
+  std::vector<std::string> records;
+  gsize pos = 0;
+
+  while (pos < buffer.size ()) {
+    guint32 len = 0;
+    gint i;
+
+    g_assert_cmpuint (buffer.size () - pos, >=, NVDS_BINARY_PAYLOAD_PREFIX_SIZE);
+    for (i = 0; i < NVDS_BINARY_PAYLOAD_PREFIX_SIZE; i++)
+      len |= (guint32) (guint8) buffer[pos + i] << (8 * i);
+    g_assert_cmpuint (buffer.size () - pos - NVDS_BINARY_PAYLOAD_PREFIX_SIZE,
+        >=, len);
+    records.push_back (buffer.substr (pos,
+            NVDS_BINARY_PAYLOAD_PREFIX_SIZE + len));
+    pos += NVDS_BINARY_PAYLOAD_PREFIX_SIZE + len;
+  }
+  return records;
+}
+
+static void
+test_framing_concatenated (void)
+{
+  static const gchar *sensors[] = { "cam-0", "cam-1", "cam-2" };
+  TestFrame frames[3];
+  std::vector<std::string> records;
+  std::string buffer, json;
+  gsize total = 0;
+  guint i, objects;
+
+  for (i = 0; i < 3; i++) {
+    guint k;
+
+    for (k = 0; k <= i; k++) {
+      NvDsEventMsgMeta & m = frames[i].add (NVDS_OBJECT_TYPE_PERSON, i, "ts");
+      m.sensorStr = (gchar *) sensors[i];
+      m.trackingId = k;
+    }
+    total += nvds_binary_payload_encode (frames[i].build (), i + 1, buffer);
+  }
+  g_assert_cmpuint (total, ==, buffer.size ());
+
+  records = split_records (buffer);
+  g_assert_cmpuint (records.size (), ==, 3);
+  for (i = 0; i < 3; i++) {
+    json = decode_record (records[i], NULL, &objects);
+    g_assert_cmpuint (objects, ==, i + 1);
+    g_assert_true (json.find (sensors[i]) != std::string::npos);
+  }
+}
+
+static void
+test_framing_truncated (void)
+{
+  TestFrame frame;
+  std::string record, json, error;
+  const guint8 *body;
+  gsize len, n;
+  gint i;
+
+  for (i = 0; i < 3; i++) {
+    NvDsEventMsgMeta & m = frame.add (NVDS_OBJECT_TYPE_VEHICLE, 1, "ts");
+    set_bbox (m, 10 * i, 5, 20, 20);
+    m.extMsg = &vehicle;
+    m.extMsgSize = sizeof (vehicle);
+    m.location.lat = 1.0;
+    m.coordinate.z = 2.0;
+  }
+  nvds_binary_payload_encode (frame.build (), 3, record);
+  body = (const guint8 *) record.data () + NVDS_BINARY_PAYLOAD_PREFIX_SIZE;
+  len = record.size () - NVDS_BINARY_PAYLOAD_PREFIX_SIZE;
+
+  /* 본문이 어디서 잘려도 읽은 만큼 넘어가지 않고 실패해야 합니다. */
+  for (n = 0; n < len; n++) {
+    json.clear ();
+    error.clear ();
+    g_assert_false (nvds_binary_payload_to_json (body, n, json, error, NULL,
+            NULL));
+    g_assert_true (g_str_has_prefix (error.c_str (), "truncated"));
+  }
+  g_assert_true (nvds_binary_payload_to_json (body, len, json, error, NULL,
+          NULL));
+}
+
+static void
+test_framing_corrupt (void)
+{
+  static const guint8 overlong[] = { 'D', 'B', 2, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01
+  };
+  static const guint8 bad_magic[] = { 'J', 'S', 2, 0, 0, 0 };
+  static const guint8 bad_version[] = { 'D', 'B', 3, 0, 0, 0 };
+  static const guint8 bad_ext[] = { 'D', 'B', 2, 0, 0, 1, 0, 0, 1,
+    NVDS_BINARY_OBJECT_HAS_EXT, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9
+  };
+  TestFrame frame;
+  std::string record, json, error;
+  GRand *rand = g_rand_new_with_seed (33);
+  gint i;
+
+  g_assert_false (nvds_binary_payload_to_json (overlong, sizeof (overlong),
+          json, error, NULL, NULL));
+  g_assert_false (nvds_binary_payload_to_json (bad_magic, sizeof (bad_magic),
+          json, error, NULL, NULL));
+  g_assert_cmpstr (error.c_str (), ==, "bad magic");
+  g_assert_false (nvds_binary_payload_to_json (bad_version,
+          sizeof (bad_version), json, error, NULL, NULL));
+  g_assert_cmpstr (error.c_str (), ==, "unsupported version 3");
+  g_assert_false (nvds_binary_payload_to_json (bad_ext, sizeof (bad_ext),
+          json, error, NULL, NULL));
+  g_assert_cmpstr (error.c_str (), ==, "unknown ext kind 9");
+
+  /* 임의의 바이트를 바꾼 레코드는 성공/실패와 관계없이 범위 밖을 읽지 않아야 합니다. */
+  for (i = 0; i < 4; i++) {
+    NvDsEventMsgMeta & m = frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+    m.extMsg = &person;
+    m.extMsgSize = sizeof (person);
+  }
+  nvds_binary_payload_encode (frame.build (), 4, record);
+  for (i = 0; i < 5000; i++) {
+    std::vector<guint8> body (record.begin () + NVDS_BINARY_PAYLOAD_PREFIX_SIZE,
+        record.end ());
+
+    body[g_rand_int (rand) % body.size ()] = (guint8) g_rand_int (rand);
+    json.clear ();
+    nvds_binary_payload_to_json (body.data (), body.size (), json, error, NULL,
+        NULL);
+  }
+  g_rand_free (rand);
+}
+
+static void
+test_framing_version_1 (void)
+{
+  /* strings "ts", "cam" | frame_id 5 | ts_ref 1 | sensor_ref 2 | 객체 1개
+   * (PERSON, tracking 3, left 4, top 6, 2x2) */
+  static const guint8 body[] = { 'D', 'B', 1, 2, 2, 't', 's', 3, 'c', 'a',
+    'm', 5, 1, 2, 1, 0, 0, 2, 0, 3, 8, 12, 2, 2, 0, 0
+  };
+  std::string json, error;
+  guint frames, objects;
+
+  g_assert_true (nvds_binary_payload_to_json (body, sizeof (body), json,
+          error, &frames, &objects));
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_cmpuint (objects, ==, 1);
+  g_assert_cmpstr (json.c_str (), ==,
+      "{\"version\":\"4.0\",\"id\":5,\"@timestamp\":\"ts\","
+      "\"sensorId\":\"cam\",\"objects\":[\"3|4|6|6|8|Person\"]}\n");
+}
+
+/* binary-batch 설정으로 msg2p 컨텍스트를 만듭니다. yaml이 NULL이면 설정 파일 없이 만듭니다. */
+static NvDsMsg2pCtx *
+create_ctx (const gchar * yaml)
+{
+  NvDsMsg2pCtx *ctx;
+  GError *error = NULL;
+  gchar *dir, *path;
+
+  if (!yaml)
+    return nvds_msg2p_ctx_create (NULL, NVDS_PAYLOAD_CUSTOM);
+
+  dir = g_dir_make_tmp ("msgconv-binary-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "config.yml", NULL);
+  g_assert_true (g_file_set_contents (path, yaml, -1, &error));
+  ctx = nvds_msg2p_ctx_create (path, NVDS_PAYLOAD_CUSTOM);
+  g_assert_nonnull (ctx);
+
+  g_remove (path);
+  g_rmdir (dir);
+  g_free (path);
+  g_free (dir);
+  return ctx;
+}
+
+/* nvds_msg2p_generate_multiple 결과를 복사하고 payload를 해제합니다. */
+static std::vector<std::string>
+generate (NvDsMsg2pCtx * ctx, NvDsEvent * events, guint size)
+{
+  std::vector<std::string> records;
+  NvDsPayload **payloads;
+  guint count = G_MAXUINT, i;
+
+  payloads = nvds_msg2p_generate_multiple (ctx, events, size, &count);
+  g_assert_cmpuint (count, !=, G_MAXUINT);
+  g_assert_true ((payloads != NULL) == (count > 0));
+  for (i = 0; i < count; i++) {
+    records.emplace_back ((const gchar *) payloads[i]->payload,
+        payloads[i]->payloadSize);
+    nvds_msg2p_release (ctx, payloads[i]);
+  }
+  g_free (payloads);
+  return records;
+}
+
+static void
+test_batch_disabled (void)
+{
+  NvDsMsg2pCtx *ctx = create_ctx (NULL);
+  TestFrame frame;
+  std::vector<std::string> records;
+  guint objects;
+
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+  frame.build ();
+
+  /* 이벤트가 없으면 빈 레코드를 만들지 않습니다. */
+  g_assert_cmpuint (generate (ctx, NULL, 0).size (), ==, 0);
+  records = generate (ctx, frame.events.data (), 2);
+  g_assert_cmpuint (records.size (), ==, 1);
+  decode_record (records[0], NULL, &objects);
+  g_assert_cmpuint (objects, ==, 2);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+/* window-ms 가 지난 배치는 이벤트가 없는 호출에서도 나가야 합니다. */
+static void
+test_batch_zero_event_flush (void)
+{
+  NvDsMsg2pCtx *ctx =
+      create_ctx ("binary-batch:\n  enable: 1\n  window-ms: 200\n");
+  TestFrame frame;
+  std::vector<std::string> records;
+  guint frames, objects;
+
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts-1");
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 2, "ts-2");
+  frame.build ();
+
+  g_assert_cmpuint (generate (ctx, frame.events.data (), 1).size (), ==, 0);
+  g_assert_cmpuint (generate (ctx, frame.events.data () + 1, 1).size (), ==,
+      0);
+  g_assert_cmpuint (generate (ctx, NULL, 0).size (), ==, 0);
+
+  g_usleep (250 * 1000);
+  records = generate (ctx, NULL, 0);
+  g_assert_cmpuint (records.size (), ==, 1);
+  decode_record (records[0], &frames, &objects);
+  g_assert_cmpuint (frames, ==, 2);
+  g_assert_cmpuint (objects, ==, 2);
+
+  g_assert_cmpuint (generate (ctx, NULL, 0).size (), ==, 0);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+/* 만료된 배치는 새 이벤트를 더하기 전에 나가므로 늦게 온 프레임이 섞이지 않습니다. */
+static void
+test_batch_expired_before_add (void)
+{
+  NvDsMsg2pCtx *ctx =
+      create_ctx ("binary-batch:\n  enable: 1\n  window-ms: 200\n");
+  TestFrame frame;
+  std::vector<std::string> records;
+  std::string json;
+  guint frames;
+
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts-1");
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 2, "ts-2");
+  frame.build ();
+
+  g_assert_cmpuint (generate (ctx, frame.events.data (), 1).size (), ==, 0);
+  g_usleep (250 * 1000);
+  records = generate (ctx, frame.events.data () + 1, 1);
+  g_assert_cmpuint (records.size (), ==, 1);
+  json = decode_record (records[0], &frames, NULL);
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_true (json.find ("ts-1") != std::string::npos);
+
+  g_usleep (250 * 1000);
+  records = generate (ctx, NULL, 0);
+  g_assert_cmpuint (records.size (), ==, 1);
+  json = decode_record (records[0], &frames, NULL);
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_true (json.find ("ts-2") != std::string::npos);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+static void
+test_batch_max_objects (void)
+{
+  NvDsMsg2pCtx *ctx = create_ctx ("binary-batch:\n  enable: 1\n"
+      "  window-ms: 60000\n  max-objects: 5\n");
+  TestFrame frame;
+  std::vector<std::string> records;
+  guint frames, objects, f, k;
+
+  for (f = 0; f < 3; f++)
+    for (k = 0; k < 4; k++)
+      frame.add (NVDS_OBJECT_TYPE_PERSON, f, "ts").trackingId = k;
+  frame.build ();
+
+  records = generate (ctx, frame.events.data (), 12);
+  g_assert_cmpuint (records.size (), ==, 2);
+  /* 프레임 중간에서 잘려도 레코드마다 프레임 경계가 유지됩니다. */
+  decode_record (records[0], &frames, &objects);
+  g_assert_cmpuint (frames, ==, 2);
+  g_assert_cmpuint (objects, ==, 5);
+  decode_record (records[1], &frames, &objects);
+  g_assert_cmpuint (frames, ==, 2);
+  g_assert_cmpuint (objects, ==, 5);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+static void
+test_batch_sensors (void)
+{
+  NvDsMsg2pCtx *ctx =
+      create_ctx ("binary-batch:\n  enable: 1\n  window-ms: 0\n");
+  TestFrame frame;
+  std::vector<std::string> records;
+  std::string a, b;
+  guint objects, i;
+
+  for (i = 0; i < 6; i++) {
+    NvDsEventMsgMeta & m = frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+    m.sensorStr = (gchar *) (i % 2 ? "cam-b" : "cam-a");
+  }
+  frame.build ();
+
+  /* window-ms: 0 이면 호출마다 센서별 레코드 하나씩 나옵니다. */
+  records = generate (ctx, frame.events.data (), 6);
+  g_assert_cmpuint (records.size (), ==, 2);
+  a = decode_record (records[0], NULL, &objects);
+  g_assert_cmpuint (objects, ==, 3);
+  b = decode_record (records[1], NULL, &objects);
+  g_assert_cmpuint (objects, ==, 3);
+  g_assert_true (a.find ("cam-a") != std::string::npos);
+  g_assert_true (b.find ("cam-b") != std::string::npos);
+  g_assert_cmpuint (generate (ctx, NULL, 0).size (), ==, 0);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+/*
+ * 타이머가 없으므로 호출이 없는 조용한 장면에서는 window-ms가 지나도 배치가
+ * 나가지 않고, 다음 호출에서야 window-ms보다 늦게 나갑니다.
+ */
+static void
+test_batch_quiet_scene (void)
+{
+  NvDsMsg2pCtx *ctx =
+      create_ctx ("binary-batch:\n  enable: 1\n  window-ms: 100\n");
+  TestFrame frame;
+  std::vector<std::string> records;
+  std::string json;
+  gint64 begin;
+  guint frames;
+
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts-1");
+  frame.add (NVDS_OBJECT_TYPE_PERSON, 2, "ts-2");
+  frame.build ();
+
+  begin = g_get_monotonic_time ();
+  g_assert_cmpuint (generate (ctx, frame.events.data (), 1).size (), ==, 0);
+  g_usleep (400 * 1000);
+
+  records = generate (ctx, frame.events.data () + 1, 1);
+  g_assert_cmpint (g_get_monotonic_time () - begin, >=, 400 * 1000);
+  g_assert_cmpuint (records.size (), ==, 1);
+  json = decode_record (records[0], &frames, NULL);
+  g_assert_cmpuint (frames, ==, 1);
+  g_assert_true (json.find ("ts-1") != std::string::npos);
+  nvds_msg2p_ctx_destroy (ctx);
+}
+
+/* 컨텍스트를 해제할 때 남은 배치는 내보낼 곳이 없어 버려집니다. */
+static void
+test_batch_destroy_pending (void)
+{
+  if (g_test_subprocess ()) {
+    NvDsMsg2pCtx *ctx =
+        create_ctx ("binary-batch:\n  enable: 1\n  window-ms: 60000\n");
+    TestFrame frame;
+
+    frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+    frame.add (NVDS_OBJECT_TYPE_PERSON, 1, "ts");
+    frame.add (NVDS_OBJECT_TYPE_PERSON, 2, "ts");
+    frame.build ();
+
+    g_assert_cmpuint (generate (ctx, frame.events.data (), 3).size (), ==, 0);
+    nvds_msg2p_ctx_destroy (ctx);
+    return;
+  }
+
+  g_test_trap_subprocess (NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+  g_test_trap_assert_passed ();
+  g_test_trap_assert_stderr ("*dropping 3 batched objects*");
+}
+
+/* 프레임당 objects개의 차량/사람이 움직이는 합성 시퀀스 */
+static void
+make_sequence (std::vector<TestFrame> & frames, guint num_frames,
+    guint objects, std::vector<std::string> & timestamps)
+{
+  guint f, k;
+
+  timestamps.resize (num_frames);
+  frames.resize (num_frames);
+  for (f = 0; f < num_frames; f++) {
+    timestamps[f] = "2024-01-01T00:00:" + std::to_string (10000 + f) + "Z";
+    for (k = 0; k < objects; k++) {
+      gboolean is_vehicle = (k % 2) == 0;
+      NvDsEventMsgMeta & m = frames[f].add (is_vehicle ?
+          NVDS_OBJECT_TYPE_VEHICLE : NVDS_OBJECT_TYPE_PERSON, f,
+          timestamps[f].c_str ());
+      set_bbox (m, 30 * k + f % 50 + 0.3, 100 + 7 * k + f % 20, 48 + k % 7,
+          90 + k % 11);
+      m.trackingId = 1000 + k;
+      m.confidence = 0.5 + (k % 50) / 100.0;
+      m.extMsg = is_vehicle ? (gpointer) & vehicle : (gpointer) & person;
+      m.extMsgSize = is_vehicle ? sizeof (vehicle) : sizeof (person);
+    }
+    frames[f].build ();
+  }
+}
+
+/*
+ * 같은 내용을 바이너리 레코드와 minimal 스키마 compact JSON(nvds-binary-decode -s와 같은
+ * 기준)으로 만들 때의 크기와 프레임당 시간을 비교합니다.
+ */
+static void
+bench_size_throughput (void)
+{
+  std::vector<TestFrame> frames;
+  std::vector<std::string> timestamps;
+  std::vector<std::string> records;
+  std::string buffer, json, error;
+  guint64 binary_bytes = 0, json_bytes = 0;
+  guint num_frames = 2000, objects = 10, f;
+  gdouble encode_s, json_s;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  make_sequence (frames, num_frames, objects, timestamps);
+
+  records.resize (num_frames);
+  g_test_timer_start ();
+  for (f = 0; f < num_frames; f++) {
+    records[f].clear ();
+    nvds_binary_payload_encode (frames[f].events.data (), objects, records[f]);
+  }
+  encode_s = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  for (f = 0; f < num_frames; f++) {
+    json.clear ();
+    nvds_binary_payload_to_json ((const guint8 *) records[f].data () +
+        NVDS_BINARY_PAYLOAD_PREFIX_SIZE,
+        records[f].size () - NVDS_BINARY_PAYLOAD_PREFIX_SIZE, json, error,
+        NULL, NULL);
+    json_bytes += json.size ();
+    binary_bytes += records[f].size ();
+  }
+  json_s = g_test_timer_elapsed ();
+
+  g_test_minimized_result (encode_s * 1e6 / num_frames,
+      "binary encode: %.2f us/frame (%u objects)", encode_s * 1e6 / num_frames,
+      objects);
+  g_test_minimized_result (json_s * 1e6 / num_frames,
+      "binary -> json: %.2f us/frame", json_s * 1e6 / num_frames);
+  g_test_minimized_result ((gdouble) binary_bytes / num_frames,
+      "binary: %.1f bytes/frame", (gdouble) binary_bytes / num_frames);
+  g_test_maximized_result ((gdouble) json_bytes / binary_bytes,
+      "json: %.1f bytes/frame (%.2fx binary)", (gdouble) json_bytes / num_frames,
+      (gdouble) json_bytes / binary_bytes);
+}
+
+/* 한 센서, 프레임당 객체 50개를 배치 없이/10프레임 배치로 변환할 때의 비용과 크기 */
+static void
+run_batch_bench (const gchar * name, const gchar * yaml,
+    std::vector<TestFrame> & frames, guint objects)
+{
+  NvDsMsg2pCtx *ctx = create_ctx (yaml);
+  guint64 bytes = 0, records = 0;
+  gdouble elapsed;
+  guint f, i;
+
+  g_test_timer_start ();
+  for (f = 0; f < frames.size (); f++) {
+    NvDsPayload **payloads;
+    guint count = 0;
+
+    payloads = nvds_msg2p_generate_multiple (ctx, frames[f].events.data (),
+        objects, &count);
+    for (i = 0; i < count; i++) {
+      bytes += payloads[i]->payloadSize;
+      nvds_msg2p_release (ctx, payloads[i]);
+    }
+    records += count;
+    g_free (payloads);
+  }
+  elapsed = g_test_timer_elapsed ();
+  nvds_msg2p_ctx_destroy (ctx);
+
+  g_test_minimized_result (elapsed * 1e6 / frames.size (),
+      "%s: %.2f us/frame, %.1f bytes/object, %" G_GUINT64_FORMAT " records",
+      name, elapsed * 1e6 / frames.size (),
+      (gdouble) bytes / (frames.size () * objects), records);
+}
+
+static void
+bench_batch_50_objects (void)
+{
+  std::vector<TestFrame> frames;
+  std::vector<std::string> timestamps;
+  guint objects = 50;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  make_sequence (frames, 2000, objects, timestamps);
+  run_batch_bench ("per-frame", NULL, frames, objects);
+  run_batch_bench ("batch 500 objects",
+      "binary-batch:\n  enable: 1\n  window-ms: 60000\n"
+      "  max-objects: 500\n", frames, objects);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/binary-payload/round-trip/objects",
+      test_round_trip_objects);
+  g_test_add_func ("/binary-payload/round-trip/quantization",
+      test_round_trip_quantization);
+  g_test_add_func ("/binary-payload/round-trip/frames", test_round_trip_frames);
+  g_test_add_func ("/binary-payload/sensor-key", test_sensor_key);
+  g_test_add_func ("/binary-payload/string-table", test_string_table);
+  g_test_add_func ("/binary-payload/framing/concatenated",
+      test_framing_concatenated);
+  g_test_add_func ("/binary-payload/framing/truncated", test_framing_truncated);
+  g_test_add_func ("/binary-payload/framing/corrupt", test_framing_corrupt);
+  g_test_add_func ("/binary-payload/framing/version-1", test_framing_version_1);
+  g_test_add_func ("/binary-payload/batch/disabled", test_batch_disabled);
+  g_test_add_func ("/binary-payload/batch/zero-event-flush",
+      test_batch_zero_event_flush);
+  g_test_add_func ("/binary-payload/batch/expired-before-add",
+      test_batch_expired_before_add);
+  g_test_add_func ("/binary-payload/batch/max-objects", test_batch_max_objects);
+  g_test_add_func ("/binary-payload/batch/sensors", test_batch_sensors);
+  g_test_add_func ("/binary-payload/batch/quiet-scene",
+      test_batch_quiet_scene);
+  g_test_add_func ("/binary-payload/batch/destroy-pending",
+      test_batch_destroy_pending);
+  g_test_add_func ("/binary-payload/bench/size-throughput",
+      bench_size_throughput);
+  g_test_add_func ("/binary-payload/bench/batch-50-objects",
+      bench_batch_50_objects);
+
+  return g_test_run ();
+}
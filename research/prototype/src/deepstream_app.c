@@ -27,6 +27,7 @@
 
 
 #include "deepstream_app.h"
+#include "gst-nvevent.h"
 
 #define MAX_DISPLAY_LEN 64
 static guint demux_batch_num = 0;
@@ -100,6 +101,152 @@ static void s_sensor_info_callback_stream_removed (AppCtx *appCtx, NvDsSensorInf
   }
 }
 
+NvDsSourceConfig *
+get_source_config (PrototypeConfig * config, guint source_id)
+{
+  if (!config->multi_source_config ||
+      source_id >= config->multi_source_config_size)
+    return NULL;
+  return &config->multi_source_config[source_id];
+}
+
+void
+clear_source_config (NvDsSourceConfig * config)
+{
+  g_free (config->uri);
+  g_free (config->dir_path);
+  g_free (config->file_prefix);
+  g_free (config->alsa_device);
+  g_free (config->video_format);
+  memset (config, 0, sizeof (NvDsSourceConfig));
+}
+
+void
+copy_source_config (NvDsSourceConfig * dst, const NvDsSourceConfig * src)
+{
+  *dst = *src;
+  dst->uri = g_strdup (src->uri);
+  dst->dir_path = g_strdup (src->dir_path);
+  dst->file_prefix = g_strdup (src->file_prefix);
+  dst->alsa_device = g_strdup (src->alsa_device);
+  dst->video_format = g_strdup (src->video_format);
+}
+
+/* "out.mp4" -> "out_shard1.mp4" */
+static gchar *
+shard_file_path (const gchar * path, guint shard)
+{
+  const gchar *base = strrchr (path, '/');
+  const gchar *ext = strrchr (base ? base : path, '.');
+
+  if (!ext)
+    return g_strdup_printf ("%s_shard%u", path, shard);
+  return g_strdup_printf ("%.*s_shard%u%s", (int) (ext - path), path, shard,
+      ext);
+}
+
+/* 같은 설정 파일로 만든 인스턴스끼리 출력 파일, 포트, 토픽이 겹치지 않도록
+ * shard 번호를 반영합니다. shard 0은 설정 그대로 씁니다.
+ * 포트는 shard마다 sink 수만큼 건너뛰어 한 인스턴스 안의 연속 포트와도 겹치지 않습니다. */
+static void
+apply_shard_outputs (PrototypeConfig * config, guint shard)
+{
+  guint stride = MAX (config->num_sink_sub_bins, 1);
+  guint i;
+  gchar *tmp;
+
+  if (shard == 0)
+    return;
+
+  for (i = 0; i < config->num_sink_sub_bins; i++) {
+    NvDsSinkSubBinConfig *sink = &config->sink_bin_sub_bin_config[i];
+    NvDsSinkEncoderConfig *enc = &sink->encoder_config;
+    NvDsSinkMsgConvBrokerConfig *broker = &sink->msg_conv_broker_config;
+
+    if (enc->output_file_path) {
+      tmp = enc->output_file_path;
+      enc->output_file_path = shard_file_path (tmp, shard);
+      g_free (tmp);
+    }
+    if (enc->rtsp_port)
+      enc->rtsp_port += shard * stride;
+    if (enc->udp_port)
+      enc->udp_port += shard * stride;
+    if (broker->topic) {
+      tmp = broker->topic;
+      broker->topic = g_strdup_printf ("%s_shard%u", tmp, shard);
+      g_free (tmp);
+    }
+  }
+
+  if (config->latency_stats_config.http_port)
+    config->latency_stats_config.http_port += shard;
+  if (config->latency_stats_config.csv_file_path) {
+    tmp = config->latency_stats_config.csv_file_path;
+    config->latency_stats_config.csv_file_path = shard_file_path (tmp, shard);
+    g_free (tmp);
+  }
+}
+
+gboolean
+apply_shard_plan (PrototypeConfig * config, const PrototypeShardPlan * plan,
+    guint shard)
+{
+  gboolean ret = FALSE;
+  guint i, n = 0;
+
+  if (plan->num_items != config->num_source_sub_bins) {
+    NVGSTDS_ERR_MSG_V ("Shard plan has %u sources, config has %u",
+        plan->num_items, config->num_source_sub_bins);
+    goto done;
+  }
+
+  /* 배정되지 않은 항목은 해제하고, 배정된 항목은 앞으로 옮깁니다.
+   * n < i인 슬롯은 이미 해제되었거나 옮겨져 비어 있습니다. */
+  for (i = 0; i < config->num_source_sub_bins; i++) {
+    if (plan->assignment[i] != shard) {
+      clear_source_config (&config->multi_source_config[i]);
+      prototype_source_shard_info_clear (&config->source_shard_info[i]);
+      continue;
+    }
+    if (n != i) {
+      config->multi_source_config[n] = config->multi_source_config[i];
+      config->source_shard_info[n] = config->source_shard_info[i];
+      memset (&config->multi_source_config[i], 0, sizeof (NvDsSourceConfig));
+      memset (&config->source_shard_info[i], 0,
+          sizeof (PrototypeSourceShardInfo));
+    }
+    n++;
+  }
+
+  if (n == 0) {
+    NVGSTDS_ERR_MSG_V ("No sources assigned to shard %u", shard);
+    goto done;
+  }
+
+  config->num_source_sub_bins = n;
+  config->max_source_bins = n;
+  /* 인스턴스마다 소스 수가 다르므로 배치 크기도 맞춥니다. */
+  config->streammux_config.batch_size = n;
+  apply_shard_outputs (config, shard);
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
+void
+remove_sensor_info (AppCtx * appCtx, guint source_id)
+{
+  NvDsSensorInfo sensorInfo = { 0 };
+
+  sensorInfo.source_id = source_id;
+  s_sensor_info_callback_stream_removed (appCtx, &sensorInfo);
+}
+
 NvDsSensorInfo* get_sensor_info(AppCtx* appCtx, guint source_id) {
   NvDsSensorInfo* sensorInfo = (NvDsSensorInfo*)g_hash_table_lookup(appCtx->sensorInfoHash,
         source_id + (gchar*)NULL);
@@ -161,6 +308,23 @@ static void s_fps_sensor_info_callback_stream_removed (AppCtx *appCtx, NvDsFPSSe
   }
 }
 
+/**
+ * 메시지가 nvmsgbroker 엘리먼트에서 게시되었는지 확인합니다.
+ * nvmsgbroker는 전송 실패를 버스 에러/경고로 알리므로 게시 실패 메트릭에 사용합니다.
+ */
+static gboolean
+is_msgbroker_message (GstMessage * message)
+{
+  GstElementFactory *factory = NULL;
+
+  if (!GST_IS_ELEMENT (GST_MESSAGE_SRC (message)))
+    return FALSE;
+
+  factory = gst_element_get_factory (GST_ELEMENT (GST_MESSAGE_SRC (message)));
+  return factory &&
+      !g_strcmp0 (GST_OBJECT_NAME (factory), NVDS_ELEM_MSG_BROKER);
+}
+
 /**
  * callback function to receive messages from components
  * in the pipeline.
@@ -193,6 +357,9 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
       GError *error = NULL;
       gchar *debuginfo = NULL;
       gst_message_parse_warning (message, &error, &debuginfo);
+      if (is_msgbroker_message (message)) {
+        prototype_metrics_add (PROTOTYPE_METRIC_MSGBROKER_PUBLISH_FAILURES, 1);
+      }
       g_printerr ("WARNING from %s: %s\n",
           GST_OBJECT_NAME (message->src), error->message);
       if (debuginfo) {
@@ -210,6 +377,9 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
           "Reconnection attempts exceeded for all sources or EOS received.";
       guint i = 0;
       gst_message_parse_error (message, &error, &debuginfo);
+      if (is_msgbroker_message (message)) {
+        prototype_metrics_add (PROTOTYPE_METRIC_MSGBROKER_PUBLISH_FAILURES, 1);
+      }
 
       if (strstr (error->message, attempts_error)) {
         g_print
@@ -243,8 +413,9 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
         msg_src_elem = GST_ELEMENT_PARENT (msg_src_elem);
       }
 
-      if ((i != bin->num_bins) &&
-          (appCtx->config.multi_source_config[0].type == NV_DS_SOURCE_RTSP)) {
+      NvDsSourceConfig *src_config = get_source_config (&appCtx->config, 0);
+      if ((i != bin->num_bins) && src_config &&
+          (src_config->type == NV_DS_SOURCE_RTSP)) {
         // Error from one of RTSP source.
         NvDsSrcBin *subBin = &bin->sub_bins[i];
 
@@ -258,8 +429,7 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
         return TRUE;
       }
 
-      if (appCtx->config.multi_source_config[0].type ==
-          NV_DS_SOURCE_CAMERA_V4L2) {
+      if (src_config && src_config->type == NV_DS_SOURCE_CAMERA_V4L2) {
         if (g_strrstr (debuginfo, "reason not-negotiated (-4)")) {
           NVGSTDS_INFO_MSG_V
               ("incorrect camera parameters provided, please provide supported resolution and frame rate\n");
@@ -570,16 +740,259 @@ gie_processing_done_buf_prob (GstPad * pad, GstPadProbeInfo * info,
   return GST_PAD_PROBE_OK;
 }
 
+/**
+ * streammux 입력(소스별 프레임)의 움직임 게이트 프로브입니다.
+ * 움직임이 없는 소스의 프레임은 배치에 들어가기 전에 버려 추론하지 않습니다.
+ */
+static GstPadProbeReturn
+motion_gate_buf_prob (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  GstBuffer *buf = (GstBuffer *) info->data;
+  AppCtx *appCtx = (AppCtx *) u_data;
+  guint source_id =
+      GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "source-id"));
+  GstMapInfo map;
+  gboolean pass = TRUE;
+
+  if (!appCtx->motion_gate || !GST_BUFFER_PTS_IS_VALID (buf))
+    return GST_PAD_PROBE_OK;
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_PAD_PROBE_OK;
+  pass = prototype_motion_gate_process_surface (appCtx->motion_gate, source_id,
+      (NvBufSurface *) map.data, GST_BUFFER_PTS (buf));
+  gst_buffer_unmap (buf, &map);
+
+  if (pass)
+    return GST_PAD_PROBE_OK;
+  prototype_metrics_source_add (appCtx->index, source_id,
+      PROTOTYPE_METRIC_SOURCE_FRAMES_GATED, 1);
+  return GST_PAD_PROBE_DROP;
+}
+
+/**
+ * streammux 입력의 추론 프레임 스케줄러 프로브입니다. 움직임 게이트 뒤에
+ * 붙으므로 게이트를 통과한 프레임만 스케줄링합니다. 선택되지 않은 프레임은
+ * 배치에 들어가지 않으며, 트래커는 해당 소스를 낮은 fps로 추적합니다.
+ */
+static GstPadProbeReturn
+frame_scheduler_buf_prob (GstPad * pad, GstPadProbeInfo * info,
+    gpointer u_data)
+{
+  AppCtx *appCtx = (AppCtx *) u_data;
+  guint source_id =
+      GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "source-id"));
+
+  if (!appCtx->frame_scheduler ||
+      prototype_frame_scheduler_admit (appCtx->frame_scheduler, source_id,
+          g_get_monotonic_time ()))
+    return GST_PAD_PROBE_OK;
+  prototype_metrics_source_add (appCtx->index, source_id,
+      PROTOTYPE_METRIC_SOURCE_FRAMES_UNSCHEDULED, 1);
+  return GST_PAD_PROBE_DROP;
+}
+
+/**
+ * 게이트와 스케줄러를 통과해 streammux에 들어가는 프레임의 도착을 기록합니다.
+ */
+static GstPadProbeReturn
+batch_timeout_arrival_prob (GstPad * pad, GstPadProbeInfo * info,
+    gpointer u_data)
+{
+  AppCtx *appCtx = (AppCtx *) u_data;
+
+  if (appCtx->batch_timeout)
+    nvds_batch_timeout_record_arrival (appCtx->batch_timeout,
+        GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "source-id")),
+        g_get_monotonic_time ());
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * streammux 출력 배치의 프레임 수를 기록합니다.
+ */
+static GstPadProbeReturn
+batch_timeout_batch_prob (GstPad * pad, GstPadProbeInfo * info,
+    gpointer u_data)
+{
+  AppCtx *appCtx = (AppCtx *) u_data;
+  NvDsBatchMeta *batch_meta =
+      gst_buffer_get_nvds_batch_meta ((GstBuffer *) info->data);
+
+  if (!appCtx->batch_timeout || !batch_meta)
+    return GST_PAD_PROBE_OK;
+  nvds_batch_timeout_record_batch (appCtx->batch_timeout,
+      batch_meta->num_frames_in_batch);
+  prototype_metrics_instance_add (appCtx->index,
+      PROTOTYPE_METRIC_STREAMMUX_BATCHES, 1);
+  prototype_metrics_instance_add (appCtx->index,
+      PROTOTYPE_METRIC_STREAMMUX_BATCH_FRAMES,
+      batch_meta->num_frames_in_batch);
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * 최근 도착으로 batched-push-timeout을 다시 고릅니다. 메인 루프에서 호출됩니다.
+ */
+static gboolean
+batch_timeout_update_cb (gpointer data)
+{
+  AppCtx *appCtx = (AppCtx *) data;
+  NvDsBatchTimeoutStats stats;
+  gint timeout = 0;
+  gboolean changed = FALSE;
+
+  changed = nvds_batch_timeout_update (appCtx->batch_timeout,
+      g_get_monotonic_time (), &timeout);
+  nvds_batch_timeout_get_stats (appCtx->batch_timeout, &stats);
+  if (changed) {
+    g_object_set (appCtx->pipeline.multi_src_bin.streammux,
+        "batched-push-timeout", timeout, NULL);
+    g_print ("batched-push-timeout set to %d us (predicted fill %.2f, "
+        "p99 wait %.1f ms; achieved fill %.2f)\n", timeout,
+        stats.predicted.fill, stats.predicted.p99_wait_us / 1000.0,
+        stats.achieved_fill);
+  }
+  prototype_metrics_instance_set (appCtx->index,
+      PROTOTYPE_METRIC_STREAMMUX_BATCHED_PUSH_TIMEOUT, MAX (timeout, 0));
+  prototype_metrics_instance_set_gauge (appCtx->index,
+      PROTOTYPE_METRIC_STREAMMUX_BATCH_FILL, stats.achieved_fill);
+  return G_SOURCE_CONTINUE;
+}
+
+/** RTSP 클라이언트 연결/종료를 표시 게이트의 시청자 수로 반영합니다. */
+static void
+display_gate_rtsp_client_cb (gboolean connected, gpointer user_data)
+{
+  PrototypeDisplayGate *gate = (PrototypeDisplayGate *) user_data;
+
+  if (connected)
+    prototype_display_gate_viewer_added (gate);
+  else
+    prototype_display_gate_viewer_removed (gate);
+}
+
+/** 시청자가 없는 표시 분기를 idle-timeout-sec 뒤에 닫습니다. */
+static gboolean
+display_gate_update_cb (gpointer data)
+{
+  AppCtx *appCtx = (AppCtx *) data;
+
+  prototype_display_gate_update (appCtx->display_gate,
+      g_get_monotonic_time ());
+  prototype_metrics_instance_set_gauge (appCtx->index,
+      PROTOTYPE_METRIC_DISPLAY_ACTIVE,
+      prototype_display_gate_is_active (appCtx->display_gate));
+  prototype_metrics_instance_set (appCtx->index,
+      PROTOTYPE_METRIC_DISPLAY_FRAMES_DROPPED,
+      prototype_display_gate_get_dropped (appCtx->display_gate));
+  return G_SOURCE_CONTINUE;
+}
+
+/**
+ * 표시 게이트가 닫혀 있는 동안 녹화(file) sink는 프레임을 잃으므로, 같은
+ * 표시 분기에 file sink가 있으면 게이트를 쓰지 않습니다.
+ */
+static gboolean
+has_display_file_sink (PrototypeConfig * config)
+{
+  guint i;
+
+  for (i = 0; i < config->num_sink_sub_bins; i++) {
+    NvDsSinkSubBinConfig *sink = &config->sink_bin_sub_bin_config[i];
+
+    if (sink->enable && sink->source_id == 0 && !sink->link_to_demux &&
+        sink->type == NV_DS_SINK_ENCODE_FILE)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/** 표시 분기 sink들이 닫힌 게이트 뒤에서 preroll을 기다리지 않도록 합니다. */
+static void
+set_display_sinks_async (NvDsSinkBin * sink_bin, gboolean async)
+{
+  guint i;
+
+  for (i = 0; i < MAX_SINK_BINS; i++) {
+    GstElement *sink = sink_bin->sub_bins[i].sink;
+
+    if (sink && g_object_class_find_property (G_OBJECT_GET_CLASS (sink),
+            "async"))
+      g_object_set (sink, "async", async, NULL);
+  }
+}
+
+/**
+ * rtspsrc가 스트리밍 스레드에서 올리는 progress 메시지를 소스 시작 창에
+ * 넘깁니다.
+ */
+static void
+source_startup_sync_message_cb (GstBus * bus, GstMessage * message,
+    gpointer data)
+{
+  handle_source_startup_message ((NvDsSrcParentBin *) data, message);
+}
+
+static gboolean
+add_streammux_sink_probes (GstElement * streammux, GstPad * pad,
+    gpointer u_data)
+{
+  AppCtx *appCtx = (AppCtx *) u_data;
+  guint source_id = 0;
+  gchar *name = gst_pad_get_name (pad);
+
+  if (GST_PAD_IS_SINK (pad) && sscanf (name, "sink_%u", &source_id) == 1) {
+    g_object_set_data (G_OBJECT (pad), "source-id",
+        GUINT_TO_POINTER (source_id));
+    if (appCtx->motion_gate)
+      gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, motion_gate_buf_prob,
+          u_data, NULL);
+    if (appCtx->frame_scheduler)
+      gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+          frame_scheduler_buf_prob, u_data, NULL);
+    /* 버려지는 프레임은 배치에 들어가지 않으므로 마지막에 기록합니다. */
+    if (appCtx->batch_timeout)
+      gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+          batch_timeout_arrival_prob, u_data, NULL);
+  }
+  g_free (name);
+  return TRUE;
+}
+
+/** 런타임에 추가된 소스의 streammux sink 패드에도 프로브를 붙입니다. */
+static void
+streammux_pad_added_cb (GstElement * streammux, GstPad * pad,
+    gpointer u_data)
+{
+  add_streammux_sink_probes (streammux, pad, u_data);
+}
+
 /**
  * 트래커 이후의 버퍼 프로브 함수입니다.
+ * 같은 패드의 stream EOS 이벤트도 받아, 그 소스의 버퍼가 모두 지나간 시점을 알립니다.
  */
 static GstPadProbeReturn
 analytics_done_buf_prob (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
 {
   PrototypeCommonElements *common_elements = (PrototypeCommonElements *) u_data;
   AppCtx *appCtx = common_elements->appCtx;
-  GstBuffer *buf = (GstBuffer *) info->data;
-  NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta (buf);
+  GstBuffer *buf = NULL;
+  NvDsBatchMeta *batch_meta = NULL;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    guint source_id = 0;
+
+    if ((GstNvEventType) GST_EVENT_TYPE (event) == GST_NVEVENT_STREAM_EOS &&
+        appCtx->stream_eos_post_analytics_cb) {
+      gst_nvevent_parse_stream_eos (event, &source_id);
+      appCtx->stream_eos_post_analytics_cb (appCtx, source_id);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  buf = (GstBuffer *) info->data;
+  batch_meta = gst_buffer_get_nvds_batch_meta (buf);
   if (!batch_meta) {
     NVGSTDS_WARN_MSG_V ("Batch meta not found for buffer %p", buf);
     return GST_PAD_PROBE_OK;
@@ -603,14 +1016,27 @@ latency_measurement_buf_prob (GstPad * pad, GstPadProbeInfo * info,
     g_mutex_lock (&appCtx->latency_lock);
     latency_info = appCtx->latency_info;
     guint64 batch_num= GPOINTER_TO_SIZE(g_object_get_data(G_OBJECT(pad),"latency-batch-num"));
-    g_print("\n************BATCH-NUM = %lu**************\n",batch_num);
 
     num_sources_in_batch = nvds_measure_buffer_latency (buf, latency_info);
+    if (appCtx->interval_control) {
+      for (i = 0; i < num_sources_in_batch; i++)
+        prototype_interval_control_record_latency (appCtx->interval_control,
+            latency_info[i].latency);
+    }
 
-    for (i = 0; i < num_sources_in_batch; i++) {
-      g_print ("Source id = %d Frame_num = %d Frame latency = %lf (ms) \n",
-          latency_info[i].source_id,
-          latency_info[i].frame_num, latency_info[i].latency);
+    if (appCtx->latency_stats) {
+      /* 프레임 단위 출력 대신 히스토그램에 누적하여 주기적으로 내보냅니다. */
+      latency_stats_record_frames (appCtx->latency_stats, latency_info,
+          num_sources_in_batch);
+      latency_stats_record_components (appCtx->latency_stats,
+          gst_buffer_get_nvds_batch_meta (buf));
+    } else {
+      g_print("\n************BATCH-NUM = %lu**************\n",batch_num);
+      for (i = 0; i < num_sources_in_batch; i++) {
+        g_print ("Source id = %d Frame_num = %d Frame latency = %lf (ms) \n",
+            latency_info[i].source_id,
+            latency_info[i].frame_num, latency_info[i].latency);
+      }
     }
     g_mutex_unlock (&appCtx->latency_lock);
     g_object_set_data(G_OBJECT(pad),"latency-batch-num",GSIZE_TO_POINTER(batch_num+1));
@@ -630,14 +1056,26 @@ demux_latency_measurement_buf_prob (GstPad * pad, GstPadProbeInfo * info,
     NvDsFrameLatencyInfo *latency_info = NULL;
     g_mutex_lock (&appCtx->latency_lock);
     latency_info = appCtx->latency_info;
-    g_print ("\n************DEMUX BATCH-NUM = %d**************\n",
-        demux_batch_num);
     num_sources_in_batch = nvds_measure_buffer_latency (buf, latency_info);
+    if (appCtx->interval_control) {
+      for (i = 0; i < num_sources_in_batch; i++)
+        prototype_interval_control_record_latency (appCtx->interval_control,
+            latency_info[i].latency);
+    }
 
-    for (i = 0; i < num_sources_in_batch; i++) {
-      g_print ("Source id = %d Frame_num = %d Frame latency = %lf (ms) \n",
-          latency_info[i].source_id,
-          latency_info[i].frame_num, latency_info[i].latency);
+    if (appCtx->latency_stats) {
+      latency_stats_record_frames (appCtx->latency_stats, latency_info,
+          num_sources_in_batch);
+      latency_stats_record_components (appCtx->latency_stats,
+          gst_buffer_get_nvds_batch_meta (buf));
+    } else {
+      g_print ("\n************DEMUX BATCH-NUM = %d**************\n",
+          demux_batch_num);
+      for (i = 0; i < num_sources_in_batch; i++) {
+        g_print ("Source id = %d Frame_num = %d Frame latency = %lf (ms) \n",
+            latency_info[i].source_id,
+            latency_info[i].frame_num, latency_info[i].latency);
+      }
     }
     g_mutex_unlock (&appCtx->latency_lock);
     demux_batch_num++;
@@ -693,10 +1131,16 @@ create_demux_pipeline (AppCtx * appCtx, guint index)
   printf(">>> [create_demux_pipeline]\n");
   gboolean ret = FALSE;
   PrototypeConfig *config = &appCtx->config;
-  PrototypeDemuxInstanceBin *demux_instance_bin = &appCtx->pipeline.demux_instance_bins[index];
+  PrototypeDemuxInstanceBin *demux_instance_bin = NULL;
   GstElement *last_elem;
   gchar elem_name[32];
 
+  if (index >= appCtx->pipeline.num_demux_instance_bins) {
+    NVGSTDS_ERR_MSG_V ("No demux instance bin for index %u", index);
+    goto done;
+  }
+  demux_instance_bin = &appCtx->pipeline.demux_instance_bins[index];
+
   g_snprintf (elem_name, 32, "processing_demux_bin_%d", index);
   demux_instance_bin->bin = gst_bin_new (elem_name);
 
@@ -865,8 +1309,8 @@ create_common_elements (PrototypeConfig * config, PrototypePipeline * pipeline,
   if (*src_elem) {
     NVGSTDS_ELEM_ADD_PROBE (pipeline->
         common_elements.primary_bbox_buffer_probe_id, *src_elem, "src",
-        analytics_done_buf_prob, GST_PAD_PROBE_TYPE_BUFFER,
-        &pipeline->common_elements);
+        analytics_done_buf_prob, (GstPadProbeType) (GST_PAD_PROBE_TYPE_BUFFER |
+            GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM), &pipeline->common_elements);
 
     pipeline->common_elements.tee =
         gst_element_factory_make (NVDS_ELEM_TEE, "common_analytics_tee");
@@ -934,8 +1378,19 @@ create_pipeline (AppCtx * appCtx,
     goto done;
   }
 
+  pipeline->num_instance_bins = MAX (config->num_source_sub_bins, 1);
+  pipeline->instance_bins =
+      g_new0 (PrototypeInstanceBin, pipeline->num_instance_bins);
+
   bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline->pipeline));
   guint bus_id = gst_bus_add_watch (bus, bus_callback, appCtx);
+  if (config->source_startup_config.workers > 0) {
+    /* 메인 루프가 돌기 전(PAUSED~PLAYING 사이)에도 rtspsrc의 open 완료를
+     * 받아야 하므로 sync-message로 받습니다. */
+    gst_bus_enable_sync_message_emission (bus);
+    g_signal_connect (bus, "sync-message::progress",
+        G_CALLBACK (source_startup_sync_message_cb), &pipeline->multi_src_bin);
+  }
   gst_object_unref (bus);
 
   for (guint i = 0; i < config->num_sink_sub_bins; i++) {
@@ -960,6 +1415,8 @@ create_pipeline (AppCtx * appCtx,
   /*
    * 설정 파일에 있는 설정에 기반하여 멀티플렉서 및 < N > 소스 구성 요소를 파이프라인에 추가합니다.
    */
+  pipeline->multi_src_bin.startup_config = config->source_startup_config;
+  pipeline->multi_src_bin.max_bins = config->max_source_bins;
   if (!create_multi_source_bin (config->num_source_sub_bins,
           config->multi_source_config, &pipeline->multi_src_bin))
   {
@@ -975,6 +1432,48 @@ create_pipeline (AppCtx * appCtx,
     }
   }
 
+  if (config->motion_gate_config.enable && appCtx->motion_gate == NULL) {
+    appCtx->motion_gate = prototype_motion_gate_new
+        (&config->motion_gate_config, config->streammux_config.gpu_id);
+  }
+
+  if (config->frame_scheduler_config.enable &&
+      appCtx->frame_scheduler == NULL) {
+    appCtx->frame_scheduler =
+        prototype_frame_scheduler_new (&config->frame_scheduler_config);
+    for (i = 0; appCtx->frame_scheduler && i < config->num_source_sub_bins;
+        i++) {
+      if (!prototype_frame_scheduler_set_source_class (appCtx->frame_scheduler,
+              i, config->source_shard_info[i].priority)) {
+        NVGSTDS_WARN_MSG_V ("Unknown priority %s for source %u, "
+            "using default-class", config->source_shard_info[i].priority, i);
+      }
+    }
+  }
+
+  if (config->streammux_config.is_parsed && appCtx->batch_timeout == NULL) {
+    appCtx->batch_timeout =
+        create_streammux_batch_timeout (&config->streammux_config);
+    if (appCtx->batch_timeout) {
+      GstPad *src_pad = gst_element_get_static_pad
+          (pipeline->multi_src_bin.streammux, "src");
+
+      gst_pad_add_probe (src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+          batch_timeout_batch_prob, appCtx, NULL);
+      gst_object_unref (src_pad);
+      appCtx->batch_timeout_timer =
+          g_timeout_add (MAX (config->streammux_config.adaptive_window / 2, 50),
+          batch_timeout_update_cb, appCtx);
+    }
+  }
+
+  if (appCtx->motion_gate || appCtx->frame_scheduler || appCtx->batch_timeout) {
+    gst_element_foreach_sink_pad (pipeline->multi_src_bin.streammux,
+        add_streammux_sink_probes, appCtx);
+    g_signal_connect (pipeline->multi_src_bin.streammux, "pad-added",
+        G_CALLBACK (streammux_pad_added_cb), appCtx);
+  }
+
 
   if (appCtx->latency_info == NULL) {
     appCtx->latency_info = (NvDsFrameLatencyInfo *)
@@ -982,6 +1481,41 @@ create_pipeline (AppCtx * appCtx,
         sizeof (NvDsFrameLatencyInfo));
   }
 
+  if (config->latency_stats_config.enable && appCtx->latency_stats == NULL) {
+    appCtx->latency_stats = latency_stats_new (&config->latency_stats_config);
+    if (!appCtx->latency_stats) {
+      NVGSTDS_WARN_MSG_V ("Failed to start latency stats, continuing without it");
+    }
+  }
+
+  if (config->track_lifecycle_config.enable && appCtx->track_lifecycle == NULL) {
+    appCtx->track_lifecycle =
+        prototype_track_lifecycle_new (&config->track_lifecycle_config);
+  }
+
+  if (config->zones_config.enable && appCtx->zones == NULL) {
+    appCtx->zones = prototype_zones_new (&config->zones_config);
+  }
+
+  if (config->heatmap_config.enable && appCtx->heatmap == NULL) {
+    appCtx->heatmap = prototype_heatmap_new (&config->heatmap_config);
+    if (!appCtx->heatmap) {
+      NVGSTDS_WARN_MSG_V ("Failed to start heatmap, continuing without it");
+    }
+  }
+
+  if (config->reid_gallery_config.enable && appCtx->reid_gallery == NULL) {
+    appCtx->reid_gallery =
+        prototype_reid_gallery_new (&config->reid_gallery_config);
+  }
+
+  if (config->interval_control_config.enable && config->primary_gie_config.enable
+      && appCtx->interval_control == NULL) {
+    appCtx->interval_control =
+        prototype_interval_control_new (&config->interval_control_config,
+        config->primary_gie_config.interval);
+  }
+
   /** a tee after the tiler which shall be connected to sink(s) */
   pipeline->tiler_tee = gst_element_factory_make (NVDS_ELEM_TEE, "tiler_tee");
   if (!pipeline->tiler_tee) {
@@ -1011,6 +1545,10 @@ create_pipeline (AppCtx * appCtx,
       gchar pad_name[16];
       GstPad *demux_src_pad;
 
+      pipeline->num_demux_instance_bins = MAX (config->num_source_sub_bins, 1);
+      pipeline->demux_instance_bins =
+          g_new0 (PrototypeDemuxInstanceBin, pipeline->num_demux_instance_bins);
+
       i = 0;
       if (!create_demux_pipeline (appCtx, i)) {
         goto done;
@@ -1056,9 +1594,25 @@ create_pipeline (AppCtx * appCtx,
   if (config->tiled_display_config.enable) {
     /* 타일러는 모든 소스에 대해 단일 합성된 버퍼를 생성합니다. 따라서
      * 하나의 처리 인스턴스만 생성하면 됩니다. */
+    if (config->display_gate_config.enable && appCtx->display_gate == NULL) {
+      if (has_display_file_sink (config)) {
+        NVGSTDS_WARN_MSG_V ("display-gate ignored: file sinks would miss "
+            "frames while the display branch is closed");
+      } else {
+        appCtx->display_gate =
+            prototype_display_gate_new (&config->display_gate_config);
+        set_rtsp_client_func (display_gate_rtsp_client_cb,
+            appCtx->display_gate);
+      }
+    }
     if (!create_processing_instance (appCtx, 0)) {
+      set_rtsp_client_func (NULL, NULL);
       goto done;
     }
+    set_rtsp_client_func (NULL, NULL);
+    if (appCtx->display_gate) {
+      set_display_sinks_async (&pipeline->instance_bins[0].sink_bin, FALSE);
+    }
     // create and add tiling component to pipeline.
     // 타일링 구성 요소를 파이프라인에 생성하고 추가합니다.
     if (config->tiled_display_config.columns *
@@ -1091,11 +1645,33 @@ create_pipeline (AppCtx * appCtx,
         pipeline->tiled_display_bin.bin);
     last_elem = pipeline->tiler_tee;
 
-    NVGSTDS_ELEM_ADD_PROBE (latency_probe_id,
-        pipeline->instance_bins->sink_bin.sub_bins[0].sink, "sink",
-        latency_measurement_buf_prob, GST_PAD_PROBE_TYPE_BUFFER, appCtx);
+    if (appCtx->display_gate) {
+      GstPad *sink_pad = gst_element_get_static_pad
+          (pipeline->tiled_display_bin.bin, "sink");
+      GstPad *tee_pad = gst_pad_get_peer (sink_pad);
+
+      prototype_display_gate_add_probe (appCtx->display_gate, tee_pad);
+      gst_object_unref (tee_pad);
+      gst_object_unref (sink_pad);
+      appCtx->display_gate_timer =
+          g_timeout_add_seconds (1, display_gate_update_cb, appCtx);
+    }
+
+    /* 게이트가 닫혀 있어도 지연(과 interval 제어)이 멈추지 않도록 게이트
+     * 앞의 tiler_tee 입력에서 잽니다. */
+    if (appCtx->display_gate) {
+      NVGSTDS_ELEM_ADD_PROBE (latency_probe_id, pipeline->tiler_tee, "sink",
+          latency_measurement_buf_prob, GST_PAD_PROBE_TYPE_BUFFER, appCtx);
+    } else {
+      NVGSTDS_ELEM_ADD_PROBE (latency_probe_id,
+          pipeline->instance_bins->sink_bin.sub_bins[0].sink, "sink",
+          latency_measurement_buf_prob, GST_PAD_PROBE_TYPE_BUFFER, appCtx);
+    }
     latency_probe_id = latency_probe_id;
   } else {
+    if (config->display_gate_config.enable) {
+      NVGSTDS_WARN_MSG_V ("display-gate needs tiled-display, ignored");
+    }
     /*
      * Create demuxer only if tiled display is disabled.
      */
@@ -1174,10 +1750,12 @@ create_pipeline (AppCtx * appCtx,
   // performance data.
   if (config->enable_perf_measurement) {
     appCtx->perf_struct.context = appCtx;
+    appCtx->perf_struct.max_instances = pipeline->multi_src_bin.max_bins;
     enable_perf_measurement (&appCtx->perf_struct, fps_pad,
         pipeline->multi_src_bin.num_bins,
         config->perf_measurement_interval_sec,
-        config->multi_source_config[0].dewarper_config.num_surfaces_per_frame,
+        config->multi_source_config ?
+        config->multi_source_config[0].dewarper_config.num_surfaces_per_frame : 0,
         perf_cb);
   }
 
@@ -1240,7 +1818,8 @@ destroy_pipeline (AppCtx * appCtx)
         gst_object_unref (gstpad);
       }
     }
-  } else if (appCtx->pipeline.instance_bins[0].sink_bin.bin) {
+  } else if (appCtx->pipeline.instance_bins &&
+      appCtx->pipeline.instance_bins[0].sink_bin.bin) {
     GstPad *gstpad =
         gst_element_get_static_pad (appCtx->pipeline.instance_bins[0].sink_bin.
         bin, "sink");
@@ -1252,6 +1831,7 @@ destroy_pipeline (AppCtx * appCtx)
 
   g_mutex_lock (&appCtx->app_lock);
   if (appCtx->pipeline.pipeline) {
+    stop_source_startup (&appCtx->pipeline.multi_src_bin);
     destroy_smart_record_bin (&appCtx->pipeline.multi_src_bin);
     bus = gst_pipeline_get_bus (GST_PIPELINE (appCtx->pipeline.pipeline));
 
@@ -1270,7 +1850,7 @@ destroy_pipeline (AppCtx * appCtx)
   g_cond_wait_until (&appCtx->app_cond, &appCtx->app_lock, end_time);
   g_mutex_unlock (&appCtx->app_lock);
 
-  for (i = 0; i < appCtx->config.num_source_sub_bins; i++) {
+  for (i = 0; i < appCtx->pipeline.num_instance_bins; i++) {
     PrototypeInstanceBin *instance_bin = &appCtx->pipeline.instance_bins[i];
     if (config->osd_config.enable) {
       NVGSTDS_ELEM_REMOVE_PROBE (instance_bin->instance_bin_probe_id,
@@ -1278,13 +1858,19 @@ destroy_pipeline (AppCtx * appCtx)
     }
   }
 
-  for (i = 0; i < appCtx->config.num_source_sub_bins; i++) {
+  for (i = 0; i < appCtx->pipeline.num_demux_instance_bins; i++) {
     PrototypeDemuxInstanceBin *demux_instance_bin = &appCtx->pipeline.demux_instance_bins[i];
     if (config->osd_config.enable) {
       NVGSTDS_ELEM_REMOVE_PROBE (demux_instance_bin->demux_instance_bin_probe_id,
           demux_instance_bin->osd_bin.nvosd, "sink");
     }
   }
+  g_free (appCtx->pipeline.demux_instance_bins);
+  appCtx->pipeline.demux_instance_bins = NULL;
+  appCtx->pipeline.num_demux_instance_bins = 0;
+  g_free (appCtx->pipeline.instance_bins);
+  appCtx->pipeline.instance_bins = NULL;
+  appCtx->pipeline.num_instance_bins = 0;
 
   if (config->primary_gie_config.enable) {
     PrototypeCommonElements *common_elements = &appCtx->pipeline.common_elements;
@@ -1296,7 +1882,66 @@ destroy_pipeline (AppCtx * appCtx)
     appCtx->latency_info = NULL;
   }
 
+  if (appCtx->latency_stats) {
+    latency_stats_destroy (appCtx->latency_stats);
+    appCtx->latency_stats = NULL;
+  }
+
+  if (appCtx->track_lifecycle) {
+    prototype_track_lifecycle_free (appCtx->track_lifecycle);
+    appCtx->track_lifecycle = NULL;
+  }
+
+  if (appCtx->zones) {
+    prototype_zones_free (appCtx->zones);
+    appCtx->zones = NULL;
+  }
+
+  if (appCtx->heatmap) {
+    prototype_heatmap_free (appCtx->heatmap);
+    appCtx->heatmap = NULL;
+  }
+
+  if (appCtx->reid_gallery) {
+    prototype_reid_gallery_free (appCtx->reid_gallery);
+    appCtx->reid_gallery = NULL;
+  }
+
+  if (appCtx->interval_control) {
+    prototype_interval_control_free (appCtx->interval_control);
+    appCtx->interval_control = NULL;
+  }
+
+  if (appCtx->motion_gate) {
+    prototype_motion_gate_free (appCtx->motion_gate);
+    appCtx->motion_gate = NULL;
+  }
+
+  if (appCtx->frame_scheduler) {
+    prototype_frame_scheduler_free (appCtx->frame_scheduler);
+    appCtx->frame_scheduler = NULL;
+  }
+
+  if (appCtx->batch_timeout_timer) {
+    g_source_remove (appCtx->batch_timeout_timer);
+    appCtx->batch_timeout_timer = 0;
+  }
+  if (appCtx->batch_timeout) {
+    nvds_batch_timeout_free (appCtx->batch_timeout);
+    appCtx->batch_timeout = NULL;
+  }
+
+  if (appCtx->display_gate_timer) {
+    g_source_remove (appCtx->display_gate_timer);
+    appCtx->display_gate_timer = 0;
+  }
+
   destroy_sink_bin ();
+
+  if (appCtx->display_gate) {
+    prototype_display_gate_free (appCtx->display_gate);
+    appCtx->display_gate = NULL;
+  }
   g_mutex_clear (&appCtx->latency_lock);
 
   if (appCtx->pipeline.pipeline) {
@@ -1305,20 +1950,11 @@ destroy_pipeline (AppCtx * appCtx)
     gst_object_unref (bus);
     gst_object_unref (appCtx->pipeline.pipeline);
     appCtx->pipeline.pipeline = NULL;
-    pause_perf_measurement (&appCtx->perf_struct);
+    destroy_perf_measurement (&appCtx->perf_struct);
 
-    //for pipeline-recreate, reset rtsp srouce's depay, such as rtph264depay.
-    NvDsSrcParentBin *pbin = &appCtx->pipeline.multi_src_bin;
-    if(pbin){
-        NvDsSrcBin *src_bin;
-        for (i = 0; i < MAX_SOURCE_BINS; i++) {
-          src_bin = &pbin->sub_bins[i];
-          if (src_bin && src_bin->config
-              && src_bin->config->type == NV_DS_SOURCE_RTSP){
-              src_bin->depay = NULL;
-          }
-        }
-    }
+    /* 파이프라인을 다시 만들면 create_multi_source_bin()이 새 슬롯을
+     * 할당하므로 rtph264depay 같은 이전 depay 포인터가 남지 않습니다. */
+    destroy_multi_source_bin (&appCtx->pipeline.multi_src_bin);
   }
 }
 
@@ -39,6 +39,19 @@
 #include "deepstream_tracker.h"
 #include "deepstream_c2d_msg.h"
 #include "gst-nvdscustommessage.h"
+#include "prototype_display_gate.h"
+#include "prototype_frame_scheduler.h"
+#include "prototype_heatmap.h"
+#include "prototype_interval_control.h"
+#include "prototype_latency_stats.h"
+#include "prototype_metrics.h"
+#include "prototype_motion_gate.h"
+#include "prototype_reid_gallery.h"
+#include "prototype_shard_planner.h"
+#include "prototype_source_reload.h"
+#include "prototype_source_table.h"
+#include "prototype_track_lifecycle.h"
+#include "prototype_zones.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -51,6 +64,8 @@ typedef void (*bbox_generated_post_analytics_callback) (AppCtx *appCtx, GstBuffe
     NvDsBatchMeta *batch_meta);
 typedef gboolean (*overlay_graphics_callback) (AppCtx *appCtx, GstBuffer *buf,
     NvDsBatchMeta *batch_meta, guint index);
+typedef void (*stream_eos_post_analytics_callback) (AppCtx *appCtx,
+    guint source_id);
 
 typedef struct
 {
@@ -84,8 +99,12 @@ typedef struct
   GstElement *pipeline;
   NvDsSrcParentBin multi_src_bin;
   PrototypeCommonElements common_elements;
-  PrototypeInstanceBin instance_bins[MAX_SOURCE_BINS];
-  PrototypeDemuxInstanceBin demux_instance_bins[MAX_SOURCE_BINS];
+  /** create_pipeline()에서 소스 수만큼 할당됩니다. 타일 모드는 [0]만 씁니다. */
+  PrototypeInstanceBin *instance_bins;
+  guint num_instance_bins;
+  /** create_pipeline()에서 소스 수만큼 할당됩니다. */
+  PrototypeDemuxInstanceBin *demux_instance_bins;
+  guint num_demux_instance_bins;
   GstElement *tiler_tee;
   NvDsTiledDisplayBin tiled_display_bin;
   GstElement *demuxer;
@@ -103,8 +122,18 @@ typedef struct
   NvDsTiledDisplayConfig tiled_display_config;
 
   // source:
-  NvDsSourceConfig multi_source_config[MAX_SOURCE_BINS];
+  /** CSV 항목 수에 맞춰 늘어나는 배열. get_source_config()로 접근합니다. */
+  NvDsSourceConfig *multi_source_config;
+  /** multi_source_config와 같은 인덱스의 CSV 선택 컬럼 (샤딩 비용 계산용) */
+  PrototypeSourceShardInfo *source_shard_info;
   guint num_source_sub_bins;
+  guint multi_source_config_size;
+  /** 소스 빈 슬롯 수. source-reload가 켜져 있으면 max-sources 이상입니다. */
+  guint max_source_bins;
+  /** csv-file-path의 절대 경로 */
+  gchar *source_csv_path;
+  /** startup-* 키. RTSP 소스를 여는 동시 수와 PLAYING 전 쿼럼 */
+  NvDsSourceStartupConfig source_startup_config;
 
   // sinkXX:
   NvDsSinkSubBinConfig sink_bin_sub_bin_config[MAX_SINK_BINS];
@@ -125,6 +154,42 @@ typedef struct
 
   // tracker:
   NvDsTrackerConfig tracker_config;
+
+  // latency-stats:
+  LatencyStatsConfig latency_stats_config;
+
+  // metrics:
+  PrototypeMetricsConfig metrics_config;
+
+  // sharding:
+  PrototypeShardConfig shard_config;
+
+  // source-reload:
+  PrototypeSourceReloadConfig source_reload_config;
+
+  // track-lifecycle:
+  PrototypeTrackLifecycleConfig track_lifecycle_config;
+
+  // zones:
+  PrototypeZonesConfig zones_config;
+
+  // heatmap:
+  PrototypeHeatmapConfig heatmap_config;
+
+  // reid-gallery:
+  PrototypeReidGalleryConfig reid_gallery_config;
+
+  // interval-control:
+  PrototypeIntervalControlConfig interval_control_config;
+
+  // motion-gate:
+  PrototypeMotionGateConfig motion_gate_config;
+
+  // frame-scheduler:
+  PrototypeFrameSchedulerConfig frame_scheduler_config;
+
+  // display-gate:
+  PrototypeDisplayGateConfig display_gate_config;
 } PrototypeConfig;
 
 struct _AppCtx
@@ -148,8 +213,37 @@ struct _AppCtx
   NvDsC2DContext *c2d_ctx[MAX_MESSAGE_CONSUMERS];
   NvDsAppPerfStructInt perf_struct;
   bbox_generated_post_analytics_callback bbox_generated_post_analytics_cb;
+  /** 소스의 stream EOS가 analytics 프로브를 지난 뒤 호출됩니다.
+   * 이후 그 source_id의 버퍼는 bbox_generated_post_analytics_cb에 오지 않습니다. */
+  stream_eos_post_analytics_callback stream_eos_post_analytics_cb;
   NvDsFrameLatencyInfo *latency_info;
   GMutex latency_lock;
+  /** latency-stats 그룹이 활성화된 경우 지연 히스토그램 수집기 */
+  LatencyStats *latency_stats;
+  /** track-lifecycle 그룹이 활성화된 경우 트랙 enter/dwell/exit 생성기 */
+  PrototypeTrackLifecycle *track_lifecycle;
+  /** zones 그룹이 활성화된 경우 카메라별 zone 테이블 */
+  PrototypeZones *zones;
+  /** heatmap 그룹이 활성화된 경우 소스별 점유 heatmap 누적기 */
+  PrototypeHeatmap *heatmap;
+  /** reid-gallery 그룹이 활성화된 경우 카메라 간 트랙 ReID 갤러리 */
+  PrototypeReidGallery *reid_gallery;
+  /** interval-control 그룹이 활성화된 경우 PGIE interval 제어기 */
+  PrototypeIntervalControl *interval_control;
+  /** motion-gate 그룹이 활성화된 경우 streammux 입력의 움직임 게이트 */
+  PrototypeMotionGate *motion_gate;
+  /** frame-scheduler 그룹이 활성화된 경우 streammux 입력의 추론 프레임 스케줄러 */
+  PrototypeFrameScheduler *frame_scheduler;
+  /** streammux adaptive-batched-push-timeout가 설정된 경우 timeout 제어기 */
+  NvDsBatchTimeout *batch_timeout;
+  guint batch_timeout_timer;
+  /** display-gate 그룹이 활성화된 경우 tiler 앞 표시 분기의 게이트 */
+  PrototypeDisplayGate *display_gate;
+  guint display_gate_timer;
+
+  /** source_id로 인덱싱되는 StreamSourceInfo 슬롯.
+   * shard 인스턴스마다 source_id를 0부터 다시 매기므로 인스턴스별로 둡니다. */
+  PrototypeSourceTable *streams;
 
   /** REST API stream/add, remove 작업으로 얻은 NvDsSensorInfo를
    * 저장하는 해시 테이블입니다.
@@ -173,6 +267,20 @@ gboolean create_pipeline (AppCtx * appCtx,
     perf_callback perf_cb);
 
 gboolean pause_pipeline (AppCtx * appCtx);
+
+/**
+ * @brief  source_id에 해당하는 [source] 설정을 반환합니다.
+ * @return 설정 포인터; 범위를 벗어나면 NULL
+ *         (nvmultiurisrcbin으로 동적으로 추가된 소스 등)
+ */
+NvDsSourceConfig *get_source_config (PrototypeConfig * config, guint source_id);
+
+/**
+ * @brief  config의 소스 중 plan에서 shard에 배정된 것만 남기고 앞으로 모읍니다.
+ *         plan은 같은 설정 파일을 파싱한 소스 순서로 만들어져야 합니다.
+ */
+gboolean apply_shard_plan (PrototypeConfig * config,
+    const PrototypeShardPlan * plan, guint shard);
 gboolean resume_pipeline (AppCtx * appCtx);
 gboolean seek_pipeline (AppCtx * appCtx, glong milliseconds, gboolean seek_is_relative);
 
@@ -192,6 +300,28 @@ void restart_pipeline (AppCtx * appCtx);
 gboolean
 parse_config_file_yaml (PrototypeConfig * config, gchar * cfg_file_path);
 
+/**
+ * 소스 CSV 파일만 읽어 config의 source 항목 뒤에 추가합니다.
+ * URI_MULTIPLE 항목은 펼쳐집니다. source-reload에서 새 목록을 만들 때 사용합니다.
+ *
+ * @param[in] csv_file_path CSV 파일의 절대 경로입니다.
+ * @param[in] cfg_file_path 상대 경로 URI의 기준이 되는 구성 파일 경로입니다.
+ */
+gboolean
+parse_source_csv_file (PrototypeConfig * config, gchar * csv_file_path,
+    gchar * cfg_file_path);
+
+/**
+ * @brief  source 항목이 소유한 문자열을 모두 해제하고 0으로 초기화합니다.
+ */
+void clear_source_config (NvDsSourceConfig * config);
+
+/**
+ * @brief  src를 dst로 복사하고 문자열은 새로 할당합니다.
+ *         항목끼리 문자열을 공유하지 않으므로 각각 clear_source_config()로 해제합니다.
+ */
+void copy_source_config (NvDsSourceConfig * dst, const NvDsSourceConfig * src);
+
 /**
  * nvmultiurisrcbin REST API를 사용하여 추가된 source_id에 대한
  * NvDsSensorInfo를 획득하는 함수입니다.
@@ -206,6 +336,12 @@ parse_config_file_yaml (PrototypeConfig * config, gchar * cfg_file_path);
  */
 NvDsSensorInfo* get_sensor_info(AppCtx* appCtx, guint source_id);
 
+/**
+ * source_id의 NvDsSensorInfo가 있으면 sensorInfoHash에서 제거하고 해제합니다.
+ * 호출자는 perf_struct.struct_lock을 잡고 있어야 합니다.
+ */
+void remove_sensor_info (AppCtx * appCtx, guint source_id);
+
 #ifdef __cplusplus
 }
 #endif
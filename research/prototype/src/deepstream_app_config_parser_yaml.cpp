@@ -24,6 +24,7 @@
 #include <cstring>
 #include "deepstream_app.h"
 #include "deepstream_config_yaml.h"
+#include "prototype_source_table.h"
 #include <iostream>
 
 #include <stdlib.h>
@@ -63,6 +64,806 @@ parse_app_yaml (PrototypeConfig *config, gchar *cfg_file_path)
   return ret;
 }
 
+static gboolean
+parse_latency_stats_yaml (LatencyStatsConfig *config, gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  for(YAML::const_iterator itr = configyml["latency-stats"].begin();
+     itr != configyml["latency-stats"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "interval-sec") {
+      config->interval_sec = itr->second.as<guint>();
+    } else if (paramKey == "print-stdout") {
+      config->print_stdout = itr->second.as<gboolean>();
+    } else if (paramKey == "csv-file") {
+      std::string temp = itr->second.as<std::string>();
+      char* str = (char*) malloc(sizeof(char) * 1024);
+      std::strncpy (str, temp.c_str(), 1023);
+      config->csv_file_path = (char*) malloc(sizeof(char) * 1024);
+      if (!get_absolute_file_path_yaml (cfg_file_path, str,
+            config->csv_file_path)) {
+        g_printerr ("Error: Could not parse csv-file in latency-stats.\n");
+        g_free (str);
+        goto done;
+      }
+      g_free (str);
+    } else if (paramKey == "http-port") {
+      config->http_port = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group latency-stats" << endl;
+    }
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_metrics_yaml (PrototypeMetricsConfig *config, gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  for(YAML::const_iterator itr = configyml["metrics"].begin();
+     itr != configyml["metrics"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "bind-address") {
+      std::string temp = itr->second.as<std::string>();
+      config->bind_address = g_strdup (temp.c_str());
+    } else if (paramKey == "http-port") {
+      config->http_port = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group metrics" << endl;
+    }
+  }
+
+  if (config->enable && config->http_port == 0) {
+    cout << "http-port must be set when metrics is enabled" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_track_lifecycle_yaml (PrototypeTrackLifecycleConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->dwell_interval_sec = 10;
+  config->exit_timeout_ms = 2000;
+  config->min_observations = 3;
+  config->max_tracks_per_source = 1024;
+  config->tick_ms = 100;
+  config->trajectory_tolerance_px = 0;
+  config->trajectory_max_points = 32;
+  for(YAML::const_iterator itr = configyml["track-lifecycle"].begin();
+     itr != configyml["track-lifecycle"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "dwell-interval-sec") {
+      config->dwell_interval_sec = itr->second.as<guint>();
+    } else if (paramKey == "exit-timeout-ms") {
+      config->exit_timeout_ms = itr->second.as<guint>();
+    } else if (paramKey == "min-observations") {
+      config->min_observations = itr->second.as<guint>();
+    } else if (paramKey == "max-tracks-per-source") {
+      config->max_tracks_per_source = itr->second.as<guint>();
+    } else if (paramKey == "tick-ms") {
+      config->tick_ms = itr->second.as<guint>();
+    } else if (paramKey == "trajectory-tolerance-px") {
+      config->trajectory_tolerance_px = itr->second.as<gfloat>();
+    } else if (paramKey == "trajectory-max-points") {
+      config->trajectory_max_points = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group track-lifecycle" << endl;
+    }
+  }
+
+  if (config->enable && (config->tick_ms == 0 ||
+          config->max_tracks_per_source == 0)) {
+    cout << "tick-ms and max-tracks-per-source must be greater than 0" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_zones_yaml (PrototypeZonesConfig *config, gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->grid_width = 128;
+  config->grid_height = 72;
+  for(YAML::const_iterator itr = configyml["zones"].begin();
+     itr != configyml["zones"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "grid-width") {
+      config->grid_width = itr->second.as<guint>();
+    } else if (paramKey == "grid-height") {
+      config->grid_height = itr->second.as<guint>();
+    } else if (paramKey == "drop-outside") {
+      config->drop_outside = itr->second.as<gboolean>();
+    } else if (paramKey.compare(0, 5, "zone-") == 0) {
+      /* zone-<source-id>-<name>: x0;y0;x1;y1;... */
+      PrototypeZoneConfig *zone = NULL;
+      std::vector<std::string> vec =
+          split_string (itr->second.as<std::string>());
+      guint source_id = 0;
+      int name_pos = 0;
+      guint i, count = 0;
+
+      if (sscanf (paramKey.c_str(), "zone-%u-%n", &source_id, &name_pos) != 1
+          || name_pos == 0 || paramKey[name_pos] == '\0') {
+        g_printerr ("Error: zone key must be zone-<source-id>-<name>: %s\n",
+            paramKey.c_str());
+        goto done;
+      }
+      if (vec.size() < 6 || vec.size() % 2) {
+        g_printerr ("Error: %s needs at least 3 x;y points\n",
+            paramKey.c_str());
+        goto done;
+      }
+      for (i = 0; i < config->num_zones; i++) {
+        if (config->zones[i].source_id == source_id)
+          count++;
+      }
+      if (count >= PROTOTYPE_ZONES_MAX_PER_SOURCE) {
+        g_printerr ("Error: more than %d zones for source %u\n",
+            PROTOTYPE_ZONES_MAX_PER_SOURCE, source_id);
+        goto done;
+      }
+
+      config->zones = g_renew (PrototypeZoneConfig, config->zones,
+          config->num_zones + 1);
+      zone = &config->zones[config->num_zones++];
+      zone->source_id = source_id;
+      zone->name = g_strdup (paramKey.c_str() + name_pos);
+      zone->num_points = vec.size() / 2;
+      zone->points = g_new (gfloat, vec.size());
+      for (i = 0; i < vec.size(); i++)
+        zone->points[i] = std::stof (vec[i]);
+    } else {
+      cout << "Unknown key " << paramKey << " for group zones" << endl;
+    }
+  }
+
+  if (config->enable && (config->grid_width == 0 ||
+          config->grid_height == 0)) {
+    cout << "grid-width and grid-height must be greater than 0" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_heatmap_yaml (PrototypeHeatmapConfig *config, gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->grid_width = 160;
+  config->grid_height = 90;
+  config->footprint = PROTOTYPE_HEATMAP_FOOTPRINT_POINT;
+  config->half_life_sec = 600;
+  config->snapshot_interval_sec = 60;
+  for(YAML::const_iterator itr = configyml["heatmap"].begin();
+     itr != configyml["heatmap"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "grid-width") {
+      config->grid_width = itr->second.as<guint>();
+    } else if (paramKey == "grid-height") {
+      config->grid_height = itr->second.as<guint>();
+    } else if (paramKey == "footprint") {
+      std::string temp = itr->second.as<std::string>();
+      if (temp == "point") {
+        config->footprint = PROTOTYPE_HEATMAP_FOOTPRINT_POINT;
+      } else if (temp == "bbox") {
+        config->footprint = PROTOTYPE_HEATMAP_FOOTPRINT_BOX;
+      } else {
+        g_printerr ("Error: Unknown heatmap footprint '%s'.\n", temp.c_str ());
+        goto done;
+      }
+    } else if (paramKey == "half-life-sec") {
+      config->half_life_sec = itr->second.as<guint>();
+    } else if (paramKey == "snapshot-interval-sec") {
+      config->snapshot_interval_sec = itr->second.as<guint>();
+    } else if (paramKey == "output-dir") {
+      std::string temp = itr->second.as<std::string>();
+      char* str = (char*) malloc(sizeof(char) * 1024);
+      std::strncpy (str, temp.c_str(), 1023);
+      config->output_dir = (char*) malloc(sizeof(char) * 1024);
+      if (!get_absolute_file_path_yaml (cfg_file_path, str,
+            config->output_dir)) {
+        g_printerr ("Error: Could not parse output-dir in heatmap.\n");
+        g_free (str);
+        goto done;
+      }
+      g_free (str);
+    } else {
+      cout << "Unknown key " << paramKey << " for group heatmap" << endl;
+    }
+  }
+
+  if (config->enable && (config->grid_width == 0 ||
+          config->grid_height == 0)) {
+    cout << "grid-width and grid-height must be greater than 0" << endl;
+    goto done;
+  }
+  if (config->enable && config->snapshot_interval_sec && !config->output_dir) {
+    cout << "output-dir must be set when snapshot-interval-sec is not 0"
+        << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_reid_gallery_yaml (PrototypeReidGalleryConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->quantization = PROTOTYPE_REID_QUANT_FP16;
+  config->num_shards = 4;
+  config->max_entries_per_shard = 4096;
+  config->ttl_sec = 300;
+  config->top_k = 5;
+  config->match_threshold = 0.75;
+  config->query_after = 5;
+  config->ema_alpha = 0.1;
+  config->ivf_lists = 32;
+  config->ivf_min_entries = 2048;
+  config->ivf_probes = 4;
+  for(YAML::const_iterator itr = configyml["reid-gallery"].begin();
+     itr != configyml["reid-gallery"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "quantization") {
+      std::string temp = itr->second.as<std::string>();
+      if (temp == "fp32") {
+        config->quantization = PROTOTYPE_REID_QUANT_FP32;
+      } else if (temp == "fp16") {
+        config->quantization = PROTOTYPE_REID_QUANT_FP16;
+      } else if (temp == "int8") {
+        config->quantization = PROTOTYPE_REID_QUANT_INT8;
+      } else {
+        g_printerr ("Error: Unknown reid-gallery quantization '%s'.\n",
+            temp.c_str ());
+        goto done;
+      }
+    } else if (paramKey == "num-shards") {
+      config->num_shards = itr->second.as<guint>();
+    } else if (paramKey == "max-entries-per-shard") {
+      config->max_entries_per_shard = itr->second.as<guint>();
+    } else if (paramKey == "ttl-sec") {
+      config->ttl_sec = itr->second.as<guint>();
+    } else if (paramKey == "top-k") {
+      config->top_k = itr->second.as<guint>();
+    } else if (paramKey == "match-threshold") {
+      config->match_threshold = itr->second.as<gfloat>();
+    } else if (paramKey == "query-after") {
+      config->query_after = itr->second.as<guint>();
+    } else if (paramKey == "ema-alpha") {
+      config->ema_alpha = itr->second.as<gfloat>();
+    } else if (paramKey == "ivf-lists") {
+      config->ivf_lists = itr->second.as<guint>();
+    } else if (paramKey == "ivf-min-entries") {
+      config->ivf_min_entries = itr->second.as<guint>();
+    } else if (paramKey == "ivf-probes") {
+      config->ivf_probes = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group reid-gallery" << endl;
+    }
+  }
+
+  if (config->num_shards == 0 || config->max_entries_per_shard == 0) {
+    cout << "num-shards and max-entries-per-shard must be greater than 0"
+        << endl;
+    goto done;
+  }
+  if (config->top_k == 0 || config->top_k > PROTOTYPE_REID_GALLERY_MAX_TOP_K) {
+    cout << "top-k must be between 1 and " << PROTOTYPE_REID_GALLERY_MAX_TOP_K
+        << endl;
+    goto done;
+  }
+  if (config->ema_alpha < 0 || config->ema_alpha > 1) {
+    cout << "ema-alpha must be between 0 and 1" << endl;
+    goto done;
+  }
+  if (config->ivf_lists > 1024) {
+    cout << "ivf-lists must be at most 1024" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_interval_control_yaml (PrototypeIntervalControlConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->min_interval = 0;
+  config->max_interval = 4;
+  config->fps_low_ratio = 0.9;
+  config->fps_high_ratio = 0.97;
+  config->latency_budget_ms = 0;
+  config->raise_after = 2;
+  config->lower_after = 6;
+  for(YAML::const_iterator itr = configyml["interval-control"].begin();
+     itr != configyml["interval-control"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "min-interval") {
+      config->min_interval = itr->second.as<guint>();
+    } else if (paramKey == "max-interval") {
+      config->max_interval = itr->second.as<guint>();
+    } else if (paramKey == "target-fps") {
+      config->target_fps = itr->second.as<gdouble>();
+    } else if (paramKey == "fps-low-ratio") {
+      config->fps_low_ratio = itr->second.as<gdouble>();
+    } else if (paramKey == "fps-high-ratio") {
+      config->fps_high_ratio = itr->second.as<gdouble>();
+    } else if (paramKey == "latency-budget-ms") {
+      config->latency_budget_ms = itr->second.as<guint>();
+    } else if (paramKey == "raise-after") {
+      config->raise_after = itr->second.as<guint>();
+    } else if (paramKey == "lower-after") {
+      config->lower_after = itr->second.as<guint>();
+    } else if (paramKey == "source-weights") {
+      /* source-id:weight;... */
+      std::vector<std::string> vec =
+          split_string (itr->second.as<std::string>());
+      guint i;
+
+      g_free (config->weight_source_ids);
+      g_free (config->weights);
+      config->num_weights = vec.size();
+      config->weight_source_ids = g_new (guint, vec.size());
+      config->weights = g_new (gdouble, vec.size());
+      for (i = 0; i < vec.size(); i++) {
+        if (sscanf (vec[i].c_str(), "%u:%lf", &config->weight_source_ids[i],
+                &config->weights[i]) != 2 || config->weights[i] < 0) {
+          g_printerr ("Error: source-weights entry must be "
+              "<source-id>:<weight>: %s\n", vec[i].c_str());
+          goto done;
+        }
+      }
+    } else {
+      cout << "Unknown key " << paramKey << " for group interval-control"
+          << endl;
+    }
+  }
+
+  if (config->min_interval > config->max_interval) {
+    cout << "min-interval must not be greater than max-interval" << endl;
+    goto done;
+  }
+  if (config->fps_low_ratio <= 0 ||
+      config->fps_low_ratio > config->fps_high_ratio) {
+    cout << "fps-low-ratio must be in (0, fps-high-ratio]" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_motion_gate_yaml (PrototypeMotionGateConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->analysis_width = 64;
+  config->analysis_height = 36;
+  config->pixel_threshold = 20;
+  config->motion_threshold = 0.002;
+  config->learn_shift = 5;
+  config->hold_ms = 2000;
+  config->keepalive_ms = 1000;
+  for(YAML::const_iterator itr = configyml["motion-gate"].begin();
+     itr != configyml["motion-gate"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "analysis-width") {
+      config->analysis_width = itr->second.as<guint>();
+    } else if (paramKey == "analysis-height") {
+      config->analysis_height = itr->second.as<guint>();
+    } else if (paramKey == "pixel-threshold") {
+      config->pixel_threshold = itr->second.as<guint>();
+    } else if (paramKey == "motion-threshold") {
+      config->motion_threshold = itr->second.as<gfloat>();
+    } else if (paramKey == "learn-shift") {
+      config->learn_shift = itr->second.as<guint>();
+    } else if (paramKey == "hold-ms") {
+      config->hold_ms = itr->second.as<guint>();
+    } else if (paramKey == "keepalive-ms") {
+      config->keepalive_ms = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group motion-gate" << endl;
+    }
+  }
+
+  if (config->enable && (config->analysis_width == 0 ||
+          config->analysis_height == 0)) {
+    cout << "analysis-width and analysis-height must be greater than 0"
+        << endl;
+    goto done;
+  }
+  if (config->pixel_threshold > 255) {
+    cout << "pixel-threshold must be at most 255" << endl;
+    goto done;
+  }
+  if (config->learn_shift < 1 || config->learn_shift > 8) {
+    cout << "learn-shift must be between 1 and 8" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+/* source 그룹의 startup-* 키. csv-file-path는 parse_config_file_yaml에서
+ * 직접 읽습니다. */
+static gboolean
+parse_source_startup_yaml (NvDsSourceStartupConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->workers = 0;
+  config->quorum = 1.0;
+  config->quorum_timeout_ms = 10000;
+  config->open_timeout_ms = 10000;
+
+  for(YAML::const_iterator itr = configyml["source"].begin();
+     itr != configyml["source"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "startup-workers") {
+      config->workers = itr->second.as<guint>();
+    } else if (paramKey == "startup-quorum") {
+      config->quorum = itr->second.as<gdouble>();
+    } else if (paramKey == "startup-quorum-timeout-ms") {
+      config->quorum_timeout_ms = itr->second.as<guint>();
+    } else if (paramKey == "startup-open-timeout-ms") {
+      config->open_timeout_ms = itr->second.as<guint>();
+    } else if (paramKey != "csv-file-path") {
+      cout << "Unknown key " << paramKey << " for group source" << endl;
+    }
+  }
+
+  if (config->quorum < 0 || config->quorum > 1) {
+    cout << "startup-quorum must be in [0, 1]" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_frame_scheduler_yaml (PrototypeFrameSchedulerConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+  guint i;
+
+  for(YAML::const_iterator itr = configyml["frame-scheduler"].begin();
+     itr != configyml["frame-scheduler"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "inference-fps") {
+      config->inference_fps = itr->second.as<gdouble>();
+    } else if (paramKey == "default-class") {
+      std::string temp = itr->second.as<std::string>();
+      g_free (config->default_class);
+      config->default_class = g_strdup (temp.c_str());
+    } else if (paramKey == "classes") {
+      /* name:weight:max-fps:min-fps;... */
+      std::vector<std::string> vec =
+          split_string (itr->second.as<std::string>());
+
+      for (i = 0; i < config->num_classes; i++)
+        g_free (config->classes[i].name);
+      g_free (config->classes);
+      config->num_classes = vec.size();
+      config->classes = g_new0 (PrototypeSchedulerClass, vec.size());
+      for (i = 0; i < vec.size(); i++) {
+        PrototypeSchedulerClass *cls = &config->classes[i];
+        gchar **fields = g_strsplit (vec[i].c_str(), ":", -1);
+
+        if (g_strv_length (fields) != 4 || fields[0][0] == '\0') {
+          g_printerr ("Error: classes entry must be "
+              "<name>:<weight>:<max-fps>:<min-fps>: %s\n", vec[i].c_str());
+          g_strfreev (fields);
+          goto done;
+        }
+        cls->name = g_strdup (fields[0]);
+        cls->weight = g_ascii_strtod (fields[1], NULL);
+        cls->max_fps = g_ascii_strtod (fields[2], NULL);
+        cls->min_fps = g_ascii_strtod (fields[3], NULL);
+        g_strfreev (fields);
+        if (cls->weight <= 0 || cls->max_fps < 0 || cls->min_fps < 0 ||
+            (cls->max_fps > 0 && cls->min_fps > cls->max_fps)) {
+          g_printerr ("Error: class %s needs weight > 0 and "
+              "0 <= min-fps <= max-fps\n", cls->name);
+          goto done;
+        }
+      }
+    } else {
+      cout << "Unknown key " << paramKey << " for group frame-scheduler"
+          << endl;
+    }
+  }
+
+  if (config->inference_fps < 0) {
+    cout << "inference-fps must not be negative" << endl;
+    goto done;
+  }
+  if (config->default_class) {
+    for (i = 0; i < config->num_classes; i++) {
+      if (g_strcmp0 (config->classes[i].name, config->default_class) == 0)
+        break;
+    }
+    if (i == config->num_classes) {
+      cout << "default-class " << config->default_class
+          << " is not in classes" << endl;
+      goto done;
+    }
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+static gboolean
+parse_display_gate_yaml (PrototypeDisplayGateConfig *config,
+    gchar *cfg_file_path)
+{
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->idle_timeout_sec = 30;
+  for(YAML::const_iterator itr = configyml["display-gate"].begin();
+     itr != configyml["display-gate"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "idle-timeout-sec") {
+      config->idle_timeout_sec = itr->second.as<guint>();
+    } else if (paramKey == "start-active") {
+      config->start_active = itr->second.as<gboolean>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group display-gate" << endl;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+parse_source_reload_yaml (PrototypeSourceReloadConfig *config,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  config->min_interval_ms = 2000;
+  config->max_sources = MAX_SOURCE_BINS;
+  for(YAML::const_iterator itr = configyml["source-reload"].begin();
+     itr != configyml["source-reload"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "min-interval-ms") {
+      config->min_interval_ms = itr->second.as<guint>();
+    } else if (paramKey == "max-sources") {
+      config->max_sources = itr->second.as<guint>();
+    } else {
+      cout << "Unknown key " << paramKey << " for group source-reload" << endl;
+    }
+  }
+
+  ret = TRUE;
+
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+/* multi_source_config가 최소 count개의 항목을 갖도록 2배씩 늘립니다.
+ * 새로 늘어난 항목은 0으로 초기화됩니다. */
+static void
+reserve_source_config (PrototypeConfig *config, guint count)
+{
+  guint size = config->multi_source_config_size;
+
+  if (count <= size)
+    return;
+
+  size = MAX (size * 2, 16u);
+  while (size < count)
+    size *= 2;
+
+  config->multi_source_config = g_renew (NvDsSourceConfig,
+      config->multi_source_config, size);
+  memset (&config->multi_source_config[config->multi_source_config_size], 0,
+      (size - config->multi_source_config_size) * sizeof (NvDsSourceConfig));
+  config->source_shard_info = g_renew (PrototypeSourceShardInfo,
+      config->source_shard_info, size);
+  memset (&config->source_shard_info[config->multi_source_config_size], 0,
+      (size - config->multi_source_config_size) *
+      sizeof (PrototypeSourceShardInfo));
+  config->multi_source_config_size = size;
+}
+
+static gboolean
+parse_sharding_yaml (PrototypeShardConfig *config, gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  YAML::Node configyml = YAML::LoadFile(cfg_file_path);
+
+  for(YAML::const_iterator itr = configyml["sharding"].begin();
+     itr != configyml["sharding"].end(); ++itr)
+  {
+    std::string paramKey = itr->first.as<std::string>();
+    if (paramKey == "enable") {
+      config->enable = itr->second.as<gboolean>();
+    } else if (paramKey == "num-shards") {
+      config->num_shards = itr->second.as<guint>();
+    } else if (paramKey == "balance-tolerance") {
+      config->balance_tolerance = itr->second.as<gdouble>();
+    } else if (paramKey == "codec-weights") {
+      std::string temp = itr->second.as<std::string>();
+      config->codec_weights = g_strdup (temp.c_str());
+    } else if (paramKey == "state-file") {
+      std::string temp = itr->second.as<std::string>();
+      char* str = (char*) malloc(sizeof(char) * 1024);
+      std::strncpy (str, temp.c_str(), 1023);
+      config->state_file = (char*) malloc(sizeof(char) * 1024);
+      if (!get_absolute_file_path_yaml (cfg_file_path, str,
+            config->state_file)) {
+        g_printerr ("Error: Could not parse state-file in sharding.\n");
+        g_free (str);
+        goto done;
+      }
+      g_free (str);
+    } else {
+      cout << "Unknown key " << paramKey << " for group sharding" << endl;
+    }
+  }
+
+  if (config->enable && config->num_shards == 0) {
+    cout << "num-shards must be set when sharding is enabled" << endl;
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+/* 샤딩 비용 계산과 frame-scheduler에만 쓰이는 CSV 컬럼을 분리합니다.
+ * 나머지 컬럼은 parse_source_yaml()로 전달됩니다. */
+static void
+split_shard_columns (std::vector<std::string> &headers,
+    std::vector<std::string> &values, PrototypeSourceShardInfo *info)
+{
+  std::vector<std::string> src_headers, src_values;
+
+  memset (info, 0, sizeof (PrototypeSourceShardInfo));
+  for (unsigned int i = 0; i < headers.size(); i++) {
+    std::string value = i < values.size() ? values[i] : "";
+    if (headers[i] == "width") {
+      info->width = (guint) strtoul (value.c_str(), NULL, 10);
+    } else if (headers[i] == "height") {
+      info->height = (guint) strtoul (value.c_str(), NULL, 10);
+    } else if (headers[i] == "fps") {
+      info->fps = g_ascii_strtod (value.c_str(), NULL);
+    } else if (headers[i] == "codec") {
+      info->codec = value.empty() ? NULL : g_strdup (value.c_str());
+    } else if (headers[i] == "group") {
+      info->group = value.empty() ? NULL : g_strdup (value.c_str());
+    } else if (headers[i] == "priority") {
+      info->priority = value.empty() ? NULL : g_strdup (value.c_str());
+    } else {
+      src_headers.push_back (headers[i]);
+      src_values.push_back (value);
+    }
+  }
+  headers = src_headers;
+  values = src_values;
+}
+
 static std::vector<std::string>
 split_csv_entries (std::string input) {
   std::vector<int> positions;
@@ -81,6 +882,111 @@ split_csv_entries (std::string input) {
   return ret;
 }
 
+/* type이 URI_MULTIPLE인 항목을 num-sources개의 URI 항목으로 펼칩니다. */
+static gboolean
+expand_multiple_uri_sources (PrototypeConfig *config)
+{
+  gboolean ret = FALSE;
+  unsigned int i, j;
+
+  printf(">>> [parse_config_file_yaml] num-source-sub-bins(2): %d\n", config->num_source_sub_bins);
+  for (i = 0; i < config->num_source_sub_bins; i++) {
+    printf(">>> [parse_config_file_yaml] type: %d\n", config->multi_source_config[i].type);
+    if (config->multi_source_config[i].type == NV_DS_SOURCE_URI_MULTIPLE) {
+      if (config->multi_source_config[i].num_sources < 1) {
+        config->multi_source_config[i].num_sources = 1;
+      }
+      for (j = 1; j < config->multi_source_config[i].num_sources; j++) {
+        if (config->num_source_sub_bins == PROTOTYPE_SOURCE_TABLE_MAX_ID) {
+          NVGSTDS_ERR_MSG_V ("App supports max %u sources",
+              PROTOTYPE_SOURCE_TABLE_MAX_ID);
+          goto done;
+        }
+        reserve_source_config (config, config->num_source_sub_bins + 1);
+        /* 펼친 항목은 문자열을 공유하지 않도록 깊은 복사합니다. */
+        copy_source_config (&config->multi_source_config[config->
+                num_source_sub_bins], &config->multi_source_config[i]);
+        prototype_source_shard_info_copy (&config->source_shard_info[config->
+                num_source_sub_bins], &config->source_shard_info[i]);
+        config->multi_source_config[config->num_source_sub_bins].type =
+            NV_DS_SOURCE_URI;
+        g_free (config->multi_source_config[config->num_source_sub_bins].uri);
+        config->multi_source_config[config->num_source_sub_bins].uri =
+            g_strdup_printf (config->multi_source_config[i].uri, j);
+        config->num_source_sub_bins++;
+        printf(">>> [parse_config_file_yaml] num-source-sub-bins(3): %d\n", config->num_source_sub_bins);
+      }
+      {
+        gchar *uri_template = config->multi_source_config[i].uri;
+        config->multi_source_config[i].type = NV_DS_SOURCE_URI;
+        config->multi_source_config[i].uri =
+            g_strdup_printf (uri_template, 0);
+        g_free (uri_template);
+      }
+    }
+  }
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
+gboolean
+parse_source_csv_file (PrototypeConfig *config, gchar *csv_file_path,
+    gchar *cfg_file_path)
+{
+  gboolean ret = FALSE;
+  std::ifstream inputFile (csv_file_path);
+  if (!inputFile.is_open()) {
+    cout << "Couldn't open CSV file " << csv_file_path << endl;
+    goto done;
+  }
+  {
+    std::string line, temp;
+    /* Separating header field and inserting as strings into the vector.
+    */
+    /* 헤더 필드를 분리하여 문자열로 벡터에 삽입합니다.
+    */
+    getline(inputFile, line);
+    std::vector<std::string> headers = split_csv_entries(line);
+    /*Parsing each csv entry as an input source */
+    /* 각 CSV 항목을 입력 소스로 구문 분석합니다. */
+    while(getline(inputFile, line)) {
+      std::vector<std::string> source_values = split_csv_entries(line);
+      std::vector<std::string> source_headers = headers;
+      /* source_id는 소스 테이블의 키이므로 그 상한까지 받습니다. */
+      if (config->num_source_sub_bins == PROTOTYPE_SOURCE_TABLE_MAX_ID) {
+        NVGSTDS_ERR_MSG_V ("App supports max %u sources",
+            PROTOTYPE_SOURCE_TABLE_MAX_ID);
+        goto done;
+      }
+      guint source_id = 0;
+      source_id = config->num_source_sub_bins;
+      reserve_source_config (config, source_id + 1);
+      split_shard_columns (source_headers, source_values,
+          &config->source_shard_info[source_id]);
+      if (!parse_source_yaml (&config->multi_source_config[source_id], source_headers, source_values, cfg_file_path))
+        goto done;
+      if (config->multi_source_config[source_id].enable)
+        config->num_source_sub_bins++;
+      printf(">>> [parse_config_file_yaml] num-source-sub-bins(1): %d\n", config->num_source_sub_bins);
+    }
+  }
+
+  if (!expand_multiple_uri_sources (config))
+    goto done;
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    cout <<  __func__ << " failed" << endl;
+  }
+  return ret;
+}
+
 gboolean
 parse_config_file_yaml (PrototypeConfig *config, gchar *cfg_file_path)
 {
@@ -112,33 +1018,12 @@ parse_config_file_yaml (PrototypeConfig *config, gchar *cfg_file_path)
         get_absolute_file_path_yaml (cfg_file_path, str, abs_csv_path);
         g_free(str);
 
-        std::ifstream inputFile (abs_csv_path);
-        if (!inputFile.is_open()) {
-          cout << "Couldn't open CSV file " << abs_csv_path << endl;
-        }
-        std::string line, temp;
-        /* Separating header field and inserting as strings into the vector.
-        */
-        /* 헤더 필드를 분리하여 문자열로 벡터에 삽입합니다.
-        */
-        getline(inputFile, line);
-        std::vector<std::string> headers = split_csv_entries(line);
-        /*Parsing each csv entry as an input source */
-        /* 각 CSV 항목을 입력 소스로 구문 분석합니다. */
-        while(getline(inputFile, line)) {
-          std::vector<std::string> source_values = split_csv_entries(line);
-          if (config->num_source_sub_bins == MAX_SOURCE_BINS) {
-            NVGSTDS_ERR_MSG_V ("App supports max %d sources", MAX_SOURCE_BINS);
-            ret = FALSE;
-            goto done;
-          }
-          guint source_id = 0;
-          source_id = config->num_source_sub_bins;
-          parse_err = !parse_source_yaml (&config->multi_source_config[source_id], headers, source_values, cfg_file_path);
-          if (config->multi_source_config[source_id].enable)
-            config->num_source_sub_bins++;
-            printf(">>> [parse_config_file_yaml] num-source-sub-bins(1): %d\n", config->num_source_sub_bins);
-        }
+        /* source-reload가 같은 파일을 다시 읽을 수 있도록 경로를 보관합니다. */
+        config->source_csv_path = abs_csv_path;
+        parse_err = !parse_source_csv_file (config, abs_csv_path, cfg_file_path);
+        if (!parse_err)
+          parse_err = !parse_source_startup_yaml (
+              &config->source_startup_config, cfg_file_path);
       } else {
         NVGSTDS_ERR_MSG_V ("CSV file not specified\n");
         ret = FALSE;
@@ -193,6 +1078,59 @@ parse_config_file_yaml (PrototypeConfig *config, gchar *cfg_file_path)
       printf(">>> [parse_config_file_yaml] tracker:\n");
       parse_err = !parse_tracker_yaml(&config->tracker_config, cfg_file_path);
     }
+    else if (paramKey == "latency-stats") {
+      printf(">>> [parse_config_file_yaml] latency-stats:\n");
+      parse_err = !parse_latency_stats_yaml(&config->latency_stats_config, cfg_file_path);
+    }
+    else if (paramKey == "sharding") {
+      printf(">>> [parse_config_file_yaml] sharding:\n");
+      parse_err = !parse_sharding_yaml(&config->shard_config, cfg_file_path);
+    }
+    else if (paramKey == "metrics") {
+      printf(">>> [parse_config_file_yaml] metrics:\n");
+      parse_err = !parse_metrics_yaml(&config->metrics_config, cfg_file_path);
+    }
+    else if (paramKey == "source-reload") {
+      printf(">>> [parse_config_file_yaml] source-reload:\n");
+      parse_err = !parse_source_reload_yaml(&config->source_reload_config, cfg_file_path);
+    }
+    else if (paramKey == "track-lifecycle") {
+      printf(">>> [parse_config_file_yaml] track-lifecycle:\n");
+      parse_err = !parse_track_lifecycle_yaml(&config->track_lifecycle_config, cfg_file_path);
+    }
+    else if (paramKey == "zones") {
+      printf(">>> [parse_config_file_yaml] zones:\n");
+      parse_err = !parse_zones_yaml(&config->zones_config, cfg_file_path);
+    }
+    else if (paramKey == "heatmap") {
+      printf(">>> [parse_config_file_yaml] heatmap:\n");
+      parse_err = !parse_heatmap_yaml(&config->heatmap_config, cfg_file_path);
+    }
+    else if (paramKey == "reid-gallery") {
+      printf(">>> [parse_config_file_yaml] reid-gallery:\n");
+      parse_err = !parse_reid_gallery_yaml(&config->reid_gallery_config,
+          cfg_file_path);
+    }
+    else if (paramKey == "interval-control") {
+      printf(">>> [parse_config_file_yaml] interval-control:\n");
+      parse_err = !parse_interval_control_yaml(
+          &config->interval_control_config, cfg_file_path);
+    }
+    else if (paramKey == "motion-gate") {
+      printf(">>> [parse_config_file_yaml] motion-gate:\n");
+      parse_err = !parse_motion_gate_yaml(&config->motion_gate_config,
+          cfg_file_path);
+    }
+    else if (paramKey == "frame-scheduler") {
+      printf(">>> [parse_config_file_yaml] frame-scheduler:\n");
+      parse_err = !parse_frame_scheduler_yaml(&config->frame_scheduler_config,
+          cfg_file_path);
+    }
+    else if (paramKey == "display-gate") {
+      printf(">>> [parse_config_file_yaml] display-gate:\n");
+      parse_err = !parse_display_gate_yaml(&config->display_gate_config,
+          cfg_file_path);
+    }
     if (parse_err) {
       cout << "failed parsing" << endl;
       goto done;
@@ -220,34 +1158,20 @@ parse_config_file_yaml (PrototypeConfig *config, gchar *cfg_file_path)
     }
   }
 
-  printf(">>> [parse_config_file_yaml] num-source-sub-bins(2): %d\n", config->num_source_sub_bins);
-  for (i = 0; i < config->num_source_sub_bins; i++) {
-    printf(">>> [parse_config_file_yaml] type: %d\n", config->multi_source_config[i].type);
-    if (config->multi_source_config[i].type == NV_DS_SOURCE_URI_MULTIPLE) {
-      if (config->multi_source_config[i].num_sources < 1) {
-        config->multi_source_config[i].num_sources = 1;
-      }
-      for (j = 1; j < config->multi_source_config[i].num_sources; j++) {
-        if (config->num_source_sub_bins == MAX_SOURCE_BINS) {
-          NVGSTDS_ERR_MSG_V ("App supports max %d sources", MAX_SOURCE_BINS);
-          ret = FALSE;
-          goto done;
-        }
-        memcpy (&config->multi_source_config[config->num_source_sub_bins],
-            &config->multi_source_config[i],
-            sizeof (config->multi_source_config[i]));
-        config->multi_source_config[config->num_source_sub_bins].type =
-            NV_DS_SOURCE_URI;
-        config->multi_source_config[config->num_source_sub_bins].uri =
-            g_strdup_printf (config->multi_source_config[config->
-                num_source_sub_bins].uri, j);
-        config->num_source_sub_bins++;
-        printf(">>> [parse_config_file_yaml] num-source-sub-bins(3): %d\n", config->num_source_sub_bins);
-      }
-      config->multi_source_config[i].type = NV_DS_SOURCE_URI;
-      config->multi_source_config[i].uri =
-          g_strdup_printf (config->multi_source_config[i].uri, 0);
+  config->max_source_bins = config->num_source_sub_bins;
+  if (config->source_reload_config.enable) {
+    if (config->source_reload_config.max_sources >
+        PROTOTYPE_SOURCE_TABLE_MAX_ID) {
+      NVGSTDS_ERR_MSG_V ("source-reload max-sources must be at most %u",
+          PROTOTYPE_SOURCE_TABLE_MAX_ID);
+      ret = FALSE;
+      goto done;
     }
+    config->max_source_bins = MAX (config->max_source_bins,
+        config->source_reload_config.max_sources);
+    /* 실행 중 추가되는 소스의 NvDsSrcBin이 설정 포인터를 보관하므로
+     * 이후 배열이 재할당되지 않도록 미리 최대 크기로 잡아 둡니다. */
+    reserve_source_config (config, config->max_source_bins);
   }
 
   ret = TRUE;
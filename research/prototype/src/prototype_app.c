@@ -7,17 +7,68 @@
 
 ////////////////////////////////////////////////////////////////
 extern AppCtx *appCtx[];
-extern TestAppCtx *testAppCtx;
 extern gboolean playback_utc;
 extern AppConfigAnalyticsModel model_used;
 
 ////////////////////////////////////////////////////////////////
 struct timespec extract_utc_from_uri (gchar * uri);
 
+////////////////////////////////////////////////////////////////
+static void
+stream_source_info_init (guint source_id, gpointer slot)
+{
+  StreamSourceInfo *stream = (StreamSourceInfo *) slot;
+  g_mutex_init (&stream->lock_stream_rtcp_sr);
+  stream->id = source_id;
+}
+
+static void
+stream_source_info_clear (guint source_id, gpointer slot)
+{
+  StreamSourceInfo *stream = (StreamSourceInfo *) slot;
+  g_mutex_clear (&stream->lock_stream_rtcp_sr);
+}
+
+PrototypeSourceTable *
+stream_source_table_new (void)
+{
+  return prototype_source_table_new (sizeof (StreamSourceInfo),
+      stream_source_info_init, stream_source_info_clear);
+}
+
+StreamSourceInfo *
+get_stream_source_info (AppCtx * app_ctx, guint source_id)
+{
+  return (StreamSourceInfo *) prototype_source_table_lookup (app_ctx->streams,
+      source_id);
+}
+
+StreamSourceInfo *
+activate_stream_source_info (AppCtx * app_ctx, guint source_id)
+{
+  /* 이전 소스의 stream EOS가 오지 않았어도 그 빈은 이미 없어졌습니다. */
+  prototype_source_table_remove (app_ctx->streams, source_id);
+  return (StreamSourceInfo *) prototype_source_table_get (app_ctx->streams,
+      source_id);
+}
+
+void
+retire_stream_source_info (AppCtx * app_ctx, guint source_id, gint reason)
+{
+  StreamSourceInfo *stream = get_stream_source_info (app_ctx, source_id);
+  guint other = reason == STREAM_RETIRE_REMOVED ?
+      STREAM_RETIRE_EOS : STREAM_RETIRE_REMOVED;
+
+  if (!stream)
+    return;
+  if (g_atomic_int_or ((guint *) & stream->retire, reason) & other)
+    prototype_source_table_remove (app_ctx->streams, source_id);
+}
+
 ////////////////////////////////////////////////////////////////
 static GstClockTime
-generate_ts_rfc3339_from_ts (char *buf, int buf_size, GstClockTime ts,
-    gchar * src_uri, gint stream_id)
+generate_ts_rfc3339_from_ts (AppCtx * app_ctx, char *buf, int buf_size,
+    GstClockTime ts, gchar * src_uri, gint stream_id)
 {
   time_t tloc;
   struct tm tm_log;
@@ -25,37 +76,37 @@ generate_ts_rfc3339_from_ts (char *buf, int buf_size, GstClockTime ts,
   int ms;
 
   GstClockTime ts_generated;
+  StreamSourceInfo *stream = get_stream_source_info (app_ctx, stream_id);
+  NvDsSourceConfig *src_config =
+      get_source_config (&app_ctx->config, stream_id);
 
-  if (playback_utc
-      || (appCtx[0]->config.multi_source_config[stream_id].type !=
-          NV_DS_SOURCE_RTSP)) {
-    if (testAppCtx->streams[stream_id].meta_number == 0) {
-      testAppCtx->streams[stream_id].timespec_first_frame =
-          extract_utc_from_uri (src_uri);
+  if (!stream) {
+    /* 제거 중인 소스: 첫 프레임 기준 시각이 없으므로 시스템 시각을 씁니다. */
+    struct timespec timespec_current;
+    clock_gettime (CLOCK_REALTIME, &timespec_current);
+    memcpy (&tloc, (void *) (&timespec_current.tv_sec), sizeof (time_t));
+    ms = timespec_current.tv_nsec / 1000000;
+    ts_generated = GST_TIMESPEC_TO_TIME (timespec_current);
+  } else if (playback_utc
+      || (!src_config || src_config->type != NV_DS_SOURCE_RTSP)) {
+    if (stream->meta_number == 0) {
+      stream->timespec_first_frame = extract_utc_from_uri (src_uri);
       memcpy (&tloc,
-          (void *) (&testAppCtx->streams[stream_id].timespec_first_frame.
-              tv_sec), sizeof (time_t));
-      ms = testAppCtx->streams[stream_id].timespec_first_frame.tv_nsec /
-          1000000;
-      testAppCtx->streams[stream_id].gst_ts_first_frame = ts;
-      ts_generated =
-          GST_TIMESPEC_TO_TIME (testAppCtx->streams[stream_id].
-          timespec_first_frame);
+          (void *) (&stream->timespec_first_frame.tv_sec), sizeof (time_t));
+      ms = stream->timespec_first_frame.tv_nsec / 1000000;
+      stream->gst_ts_first_frame = ts;
+      ts_generated = GST_TIMESPEC_TO_TIME (stream->timespec_first_frame);
       if (ts_generated == 0) {
         g_print
             ("WARNING; playback mode used with URI [%s] not conforming to timestamp format;"
             " check README; using system-time\n", src_uri);
-        clock_gettime (CLOCK_REALTIME,
-            &testAppCtx->streams[stream_id].timespec_first_frame);
-        ts_generated =
-            GST_TIMESPEC_TO_TIME (testAppCtx->streams[stream_id].
-            timespec_first_frame);
+        clock_gettime (CLOCK_REALTIME, &stream->timespec_first_frame);
+        ts_generated = GST_TIMESPEC_TO_TIME (stream->timespec_first_frame);
       }
     } else {
       GstClockTime ts_current =
-          GST_TIMESPEC_TO_TIME (testAppCtx->
-          streams[stream_id].timespec_first_frame) + (ts -
-          testAppCtx->streams[stream_id].gst_ts_first_frame);
+          GST_TIMESPEC_TO_TIME (stream->timespec_first_frame) + (ts -
+          stream->gst_ts_first_frame);
       struct timespec timespec_current;
       GST_TIME_TO_TIMESPEC (ts_current, timespec_current);
       memcpy (&tloc, (void *) (&timespec_current.tv_sec), sizeof (time_t));
@@ -98,17 +149,12 @@ generate_ts_rfc3339 (char *buf, int buf_size)
 }
 
 ////////////////////////////////////////////////////////////////
+/* 라벨 테이블의 문자열을 그대로 돌려주므로 해제하면 안 됩니다. */
 static gchar *
 get_first_result_label (NvDsClassifierMeta * classifierMeta)
 {
-  GList *n;
-  for (n = classifierMeta->label_info_list; n != NULL; n = n->next) {
-    NvDsLabelInfo *labelInfo = (NvDsLabelInfo *) (n->data);
-    if (labelInfo->result_label[0] != '\0') {
-      return g_strdup (labelInfo->result_label);
-    }
-  }
-  return NULL;
+  return (gchar *)
+      nvds_label_table_name (nvds_label_table_first_result (classifierMeta));
 }
 
 ////////////////////////////////////////////////////////////////
@@ -185,12 +231,19 @@ generate_vehicle_meta (gpointer data)
 {
   NvDsVehicleObject *obj = (NvDsVehicleObject *) data;
 
-  obj->type = g_strdup ("sedan-dummy");
-  obj->color = g_strdup ("blue");
-  obj->make = g_strdup ("Bugatti");
-  obj->model = g_strdup ("M");
-  obj->license = g_strdup ("XX1234");
-  obj->region = g_strdup ("CA");
+  /* meta_free_func는 라벨을 해제하지 않으므로 테이블 문자열을 사용합니다. */
+  obj->type = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("sedan-dummy"));
+  obj->color = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("blue"));
+  obj->make = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("Bugatti"));
+  obj->model = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("M"));
+  obj->license = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("XX1234"));
+  obj->region = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("CA"));
 }
 
 ////////////////////////////////////////////////////////////////
@@ -199,13 +252,33 @@ generate_person_meta (gpointer data)
 {
   NvDsPersonObject *obj = (NvDsPersonObject *) data;
   obj->age = 45;
-  obj->cap = g_strdup ("none-dummy-person-info");
-  obj->hair = g_strdup ("black");
-  obj->gender = g_strdup ("male");
-  obj->apparel = g_strdup ("formal");
+  obj->cap = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("none-dummy-person-info"));
+  obj->hair = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("black"));
+  obj->gender = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("male"));
+  obj->apparel = (gchar *) nvds_label_table_name (nvds_label_table_intern
+      ("formal"));
 }
 #endif /*GENERATE_DUMMY_META_EXT*/
 
+////////////////////////////////////////////////////////////////
+static void
+fill_sensor_str (AppCtx * app_ctx, NvDsEventMsgMeta * meta, gint stream_id)
+{
+  /* sensorInfoHash는 메인 스레드에서 struct_lock을 잡고 갱신됩니다. */
+  g_mutex_lock (&app_ctx->perf_struct.struct_lock);
+  NvDsSensorInfo* sensorInfo = get_sensor_info(app_ctx, stream_id);
+  if(sensorInfo) {
+    /** this stream was added using REST API; we have Sensor Info! */
+    LOGD("this stream [%d:%s] was added using REST API; we have Sensor Info\n",
+        sensorInfo->source_id, sensorInfo->sensor_id);
+    meta->sensorStr = g_strdup (sensorInfo->sensor_id);
+  }
+  g_mutex_unlock (&app_ctx->perf_struct.struct_lock);
+}
+
 ////////////////////////////////////////////////////////////////
 void
 generate_event_msg_meta (AppCtx * app_ctx, gpointer data, gint class_id, gboolean useTs,
@@ -231,8 +304,8 @@ generate_event_msg_meta (AppCtx * app_ctx, gpointer data, gint class_id, gboolea
   /** INFO: This API is called once for every 30 frames (now) */
   if (useTs && src_uri) {
     ts_generated =
-        generate_ts_rfc3339_from_ts (meta->ts, MAX_TIME_STAMP_LEN, ts, src_uri,
-        stream_id);
+        generate_ts_rfc3339_from_ts (app_ctx, meta->ts, MAX_TIME_STAMP_LEN,
+        ts, src_uri, stream_id);
   } else {
     generate_ts_rfc3339 (meta->ts, MAX_TIME_STAMP_LEN);
   }
@@ -258,13 +331,7 @@ generate_event_msg_meta (AppCtx * app_ctx, gpointer data, gint class_id, gboolea
   meta->trackingId = obj_params->object_id;
 
   /** sensor ID when streams are added using nvmultiurisrcbin REST API */
-  NvDsSensorInfo* sensorInfo = get_sensor_info(app_ctx, stream_id);
-  if(sensorInfo) {
-    /** this stream was added using REST API; we have Sensor Info! */
-    LOGD("this stream [%d:%s] was added using REST API; we have Sensor Info\n",
-        sensorInfo->source_id, sensorInfo->sensor_id);
-    meta->sensorStr = g_strdup (sensorInfo->sensor_id);
-  }
+  fill_sensor_str (app_ctx, meta, stream_id);
 
   (void) ts_generated;
 
@@ -302,4 +369,174 @@ generate_event_msg_meta (AppCtx * app_ctx, gpointer data, gint class_id, gboolea
     }
 #endif /**GENERATE_DUMMY_META_EXT*/
   }
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////
+static void
+format_utc_rfc3339 (char *buf, int buf_size, GstClockTime utc)
+{
+  struct timespec ts;
+  time_t tloc;
+  struct tm tm_log;
+  char strmsec[6];              //.nnnZ\0
+
+  GST_TIME_TO_TIMESPEC (utc, ts);
+  memcpy (&tloc, (void *) (&ts.tv_sec), sizeof (time_t));
+  gmtime_r (&tloc, &tm_log);
+  strftime (buf, buf_size, "%Y-%m-%dT%H:%M:%S", &tm_log);
+  g_snprintf (strmsec, sizeof (strmsec), ".%.3dZ", (int) (ts.tv_nsec / 1000000));
+  strncat (buf, strmsec, buf_size);
+}
+
+////////////////////////////////////////////////////////////////
+static const gchar *
+track_exit_reason_str (PrototypeTrackExitReason reason)
+{
+  switch (reason) {
+    case PROTOTYPE_TRACK_EXIT_TIMEOUT:
+      return "timeout";
+    case PROTOTYPE_TRACK_EXIT_EVICTED:
+      return "evicted";
+    case PROTOTYPE_TRACK_EXIT_SOURCE_RESET:
+      return "source-reset";
+    default:
+      return NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+void
+generate_track_event_msg_meta (AppCtx * app_ctx, gpointer data,
+    const PrototypeTrackEvent * event, gchar * src_uri, gint stream_id,
+    guint sensor_id, NvDsFrameMeta * frame_meta)
+{
+  NvDsEventMsgMeta *meta = (NvDsEventMsgMeta *) data;
+  const PrototypeTrajectorySummary *trajectory = &event->trajectory;
+  const gchar *exit_reason = track_exit_reason_str (event->exit_reason);
+  GString *attrs = g_string_new (NULL);
+  GstClockTime ts_generated = 0;
+
+  switch (event->type) {
+    case PROTOTYPE_TRACK_EVENT_ENTER:
+      meta->type = NVDS_EVENT_ENTRY;
+      break;
+    case PROTOTYPE_TRACK_EVENT_EXIT:
+      meta->type = NVDS_EVENT_EXIT;
+      break;
+    default:
+      /* 검출마다 보내던 이벤트와 같이 "있음"은 moving으로 보냅니다. */
+      meta->type = NVDS_EVENT_MOVING;
+      break;
+  }
+  meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+  if (model_used == APP_CONFIG_ANALYTICS_RESNET_PGIE_3SGIE_TYPE_COLOR_MAKE) {
+    if (event->class_id == RESNET10_PGIE_3SGIE_TYPE_COLOR_MAKECLASS_ID_CAR)
+      meta->objType = NVDS_OBJECT_TYPE_VEHICLE;
+#ifdef GENERATE_DUMMY_META_EXT
+    else if (event->class_id ==
+        RESNET10_PGIE_3SGIE_TYPE_COLOR_MAKECLASS_ID_PERSON)
+      meta->objType = NVDS_OBJECT_TYPE_PERSON;
+#endif /**GENERATE_DUMMY_META_EXT*/
+  }
+  meta->objClassId = event->class_id;
+  meta->sensorId = sensor_id;
+  meta->placeId = sensor_id;
+  meta->moduleId = sensor_id;
+  meta->frameId = frame_meta->frame_num;
+  meta->trackingId = event->object_id;
+  meta->confidence = event->best_confidence;
+  meta->bbox.left = event->best_box.left;
+  meta->bbox.top = event->best_box.top;
+  meta->bbox.width = event->best_box.width;
+  meta->bbox.height = event->best_box.height;
+  meta->objectId = g_strdup (event->label ? event->label : "");
+  fill_sensor_str (app_ctx, meta, stream_id);
+
+  meta->ts = (gchar *) g_malloc0 (MAX_TIME_STAMP_LEN + 1);
+  if (src_uri) {
+    ts_generated =
+        generate_ts_rfc3339_from_ts (app_ctx, meta->ts, MAX_TIME_STAMP_LEN,
+        event->event_ts, src_uri, stream_id);
+  } else {
+    generate_ts_rfc3339 (meta->ts, MAX_TIME_STAMP_LEN);
+  }
+
+  /* 처음/마지막 관측 시각은 이벤트 시각과의 차이로 UTC를 계산합니다. */
+  if (ts_generated) {
+    char buf[MAX_TIME_STAMP_LEN + 1];
+
+    format_utc_rfc3339 (buf, MAX_TIME_STAMP_LEN,
+        ts_generated - event->event_ts + event->first_ts);
+    g_string_append_printf (attrs, "first-seen=%s;", buf);
+    format_utc_rfc3339 (buf, MAX_TIME_STAMP_LEN,
+        ts_generated - event->event_ts + event->last_ts);
+    g_string_append_printf (attrs, "last-seen=%s;", buf);
+    format_utc_rfc3339 (buf, MAX_TIME_STAMP_LEN,
+        ts_generated - event->event_ts + event->best_ts);
+    g_string_append_printf (attrs, "best-seen=%s;", buf);
+  }
+  g_string_append_printf (attrs, "duration-ms=%" G_GUINT64_FORMAT ";"
+      "observations=%" G_GUINT64_FORMAT ";start=%.0f,%.0f;end=%.0f,%.0f;"
+      "extent=%.0f,%.0f,%.0f,%.0f;path-length=%.0f",
+      (event->last_ts - event->first_ts) / GST_MSECOND,
+      event->num_observations, trajectory->start_x, trajectory->start_y,
+      trajectory->end_x, trajectory->end_y, trajectory->min_x,
+      trajectory->min_y, trajectory->max_x, trajectory->max_y,
+      trajectory->path_length);
+  if (exit_reason)
+    g_string_append_printf (attrs, ";exit-reason=%s", exit_reason);
+  /* 압축 궤적: "x,y,t_ms/x,y,t_ms/..." (t_ms는 first-seen 기준) */
+  if (event->polyline_len) {
+    guint i;
+
+    g_string_append_printf (attrs, ";polyline-error=%.1f;polyline=",
+        event->polyline_error);
+    for (i = 0; i < event->polyline_len; i++)
+      g_string_append_printf (attrs, "%s%.0f,%.0f,%u", i ? "/" : "",
+          event->polyline[i].x, event->polyline[i].y,
+          event->polyline[i].t_ms);
+  }
+  meta->otherAttrs = g_string_free (attrs, FALSE);
+}
+
+void
+generate_reid_link_msg_meta (AppCtx * app_ctx, gpointer data,
+    const PrototypeReidLinkEvent * event, NvDsObjectMeta * obj_params,
+    float scaleW, float scaleH, gchar * src_uri, gint stream_id,
+    guint sensor_id, NvDsFrameMeta * frame_meta)
+{
+  NvDsEventMsgMeta *meta = (NvDsEventMsgMeta *) data;
+  GString *attrs = g_string_new ("reid-link=");
+  guint i;
+
+  meta->type = NVDS_EVENT_CUSTOM;
+  meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+  meta->objClassId = obj_params->class_id;
+  meta->sensorId = sensor_id;
+  meta->placeId = sensor_id;
+  meta->moduleId = sensor_id;
+  meta->frameId = frame_meta->frame_num;
+  meta->trackingId = event->object_id;
+  meta->confidence = event->matches[0].score;
+  meta->bbox.left = obj_params->rect_params.left * scaleW;
+  meta->bbox.top = obj_params->rect_params.top * scaleH;
+  meta->bbox.width = obj_params->rect_params.width * scaleW;
+  meta->bbox.height = obj_params->rect_params.height * scaleH;
+  meta->objectId = g_strdup (obj_params->obj_label);
+  fill_sensor_str (app_ctx, meta, stream_id);
+
+  meta->ts = (gchar *) g_malloc0 (MAX_TIME_STAMP_LEN + 1);
+  if (src_uri) {
+    generate_ts_rfc3339_from_ts (app_ctx, meta->ts, MAX_TIME_STAMP_LEN,
+        event->ts, src_uri, stream_id);
+  } else {
+    generate_ts_rfc3339 (meta->ts, MAX_TIME_STAMP_LEN);
+  }
+
+  /* 후보: "source-id:tracking-id:score,..." (score 내림차순) */
+  for (i = 0; i < event->num_matches; i++)
+    g_string_append_printf (attrs, "%s%u:%" G_GUINT64_FORMAT ":%.3f",
+        i ? "," : "", event->matches[i].source_id,
+        event->matches[i].object_id, event->matches[i].score);
+  meta->otherAttrs = g_string_free (attrs, FALSE);
+}
@@ -35,6 +35,8 @@
 //#include "deepstream_config.h"
 //#include "deepstream_config_file_parser.h"
 #include "deepstream_app.h"
+#include "deepstream_label_table.h"
+#include "prototype_source_table.h"
 
 #ifndef __PROTOTYPE_APP_H__
 #define __PROTOTYPE_APP_H__
@@ -154,12 +156,41 @@ typedef struct
   guint32 id;
   gint frameCount;
   GstClockTime last_ntp_time;
+  /** STREAM_RETIRE_* 비트. 둘 다 설정되면 슬롯을 정리합니다. */
+  gint retire;
 } StreamSourceInfo;
 
-typedef struct
-{
-  StreamSourceInfo streams[MAX_SOURCE_BINS];
-} TestAppCtx;
+/** 소스가 파이프라인에서 제거되었습니다. */
+#define STREAM_RETIRE_REMOVED (1 << 0)
+/** 소스의 stream EOS가 analytics 프로브를 지났습니다. */
+#define STREAM_RETIRE_EOS     (1 << 1)
+
+/**
+ * @brief  AppCtx::streams로 쓰는 StreamSourceInfo 테이블을 만듭니다.
+ *         스트림마다 별도 캐시 라인에 할당되므로 스트리밍 스레드 간 false sharing이 없습니다.
+ */
+PrototypeSourceTable *stream_source_table_new (void);
+
+/**
+ * @brief  인스턴스의 source_id에 해당하는 StreamSourceInfo를 반환합니다.
+ *         스트리밍 스레드에서 쓰므로 슬롯을 만들지 않으며, 없거나 정리된 슬롯은 NULL입니다.
+ */
+StreamSourceInfo *get_stream_source_info (AppCtx * app_ctx, guint source_id);
+
+/**
+ * @brief  source_id의 StreamSourceInfo를 새로 시작합니다. 남아 있던 슬롯은 정리합니다.
+ *         소스 빈이 연결되기 전에 호출해야 합니다.
+ */
+StreamSourceInfo *activate_stream_source_info (AppCtx * app_ctx,
+    guint source_id);
+
+/**
+ * @brief  제거(STREAM_RETIRE_REMOVED)와 analytics 이후 stream EOS(STREAM_RETIRE_EOS)를
+ *         기록합니다. 두 번째로 호출한 쪽이 슬롯을 정리하므로, 큐에 남은 프레임을
+ *         처리하는 스트리밍 스레드가 정리된 뮤텍스를 잡지 않습니다.
+ */
+void retire_stream_source_info (AppCtx * app_ctx, guint source_id,
+    gint reason);
 
 void
 generate_event_msg_meta (AppCtx * appCtx, gpointer data, gint class_id, gboolean useTs,
@@ -167,4 +198,26 @@ generate_event_msg_meta (AppCtx * appCtx, gpointer data, gint class_id, gboolean
     NvDsObjectMeta * obj_params, float scaleW, float scaleH,
     NvDsFrameMeta * frame_meta);
 
+/**
+ * @brief  트랙 enter/dwell/exit 이벤트로 NvDsEventMsgMeta를 채웁니다.
+ *         bbox와 confidence는 confidence가 가장 높았던 관측이며,
+ *         처음/마지막 관측 시각과 이동 요약은 otherAttrs에
+ *         "key=value;..." 형식으로 넣습니다.
+ */
+void
+generate_track_event_msg_meta (AppCtx * app_ctx, gpointer data,
+    const PrototypeTrackEvent * event, gchar * src_uri, gint stream_id,
+    guint sensor_id, NvDsFrameMeta * frame_meta);
+
+/**
+ * @brief  다른 카메라의 트랙과 같은 객체로 보이는 트랙을 NVDS_EVENT_CUSTOM
+ *         이벤트로 채웁니다. bbox는 현재 관측이며, 후보는 otherAttrs에
+ *         "reid-link=source-id:tracking-id:score,..." 형식으로 넣습니다.
+ */
+void
+generate_reid_link_msg_meta (AppCtx * app_ctx, gpointer data,
+    const PrototypeReidLinkEvent * event, NvDsObjectMeta * obj_params,
+    float scaleW, float scaleH, gchar * src_uri, gint stream_id,
+    guint sensor_id, NvDsFrameMeta * frame_meta);
+
 #endif /**__PROTOTYPE_APP_H__*/
@@ -53,14 +53,19 @@ static gboolean force_tcp = TRUE;           /**/
 static gint return_value = 0;
 static guint num_instances;
 static GMutex fps_lock;
-static gdouble fps[MAX_SOURCE_BINS];
-static gdouble fps_avg[MAX_SOURCE_BINS];
+
+static PrototypeSourceWatch *source_watch[MAX_INSTANCES] = { NULL };
 
 static Display *display = NULL;
 static Window windows[MAX_INSTANCES] = { 0 };
 
 static GThread *x_event_thread = NULL;
 static GMutex disp_lock;
+/**
+ * source-reload의 sub bin 추가/제거와 /metrics 수집을 직렬화합니다.
+ * 제거는 슬롯을 memset하므로 수집 중에 바뀌면 반쯤 지워진 슬롯을 읽게 됩니다.
+ */
+static GMutex source_bins_lock;
 
 static guint rrow, rcol, rcfg;
 static gboolean rrowsel = FALSE, selecting = FALSE;
@@ -68,7 +73,6 @@ static gboolean rrowsel = FALSE, selecting = FALSE;
 
 ////////////////////////////////////////////////////////////////
 AppCtx *appCtx[MAX_INSTANCES];
-TestAppCtx *testAppCtx;
 gboolean playback_utc = FALSE;
 AppConfigAnalyticsModel model_used = APP_CONFIG_ANALYTICS_MODELS_UNKNOWN;
 
@@ -136,43 +140,19 @@ meta_copy_func (gpointer data, gpointer user_data)
     dstMeta->sensorStr = g_strdup (srcMeta->sensorStr);
   }
 
+  if (srcMeta->otherAttrs) {
+    dstMeta->otherAttrs = g_strdup (srcMeta->otherAttrs);
+  }
+
   if (srcMeta->extMsgSize > 0) {
+    /* 차량/사람 속성 문자열은 라벨 테이블 소유이므로 포인터만 복사합니다. */
     if (srcMeta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-      NvDsVehicleObject *srcObj = (NvDsVehicleObject *) srcMeta->extMsg;
-      NvDsVehicleObject *obj =
-          (NvDsVehicleObject *) g_malloc0 (sizeof (NvDsVehicleObject));
-      if (srcObj->type)
-        obj->type = g_strdup (srcObj->type);
-      if (srcObj->make)
-        obj->make = g_strdup (srcObj->make);
-      if (srcObj->model)
-        obj->model = g_strdup (srcObj->model);
-      if (srcObj->color)
-        obj->color = g_strdup (srcObj->color);
-      if (srcObj->license)
-        obj->license = g_strdup (srcObj->license);
-      if (srcObj->region)
-        obj->region = g_strdup (srcObj->region);
-
-      dstMeta->extMsg = obj;
+      dstMeta->extMsg = g_memdup2 (srcMeta->extMsg,
+          sizeof (NvDsVehicleObject));
       dstMeta->extMsgSize = sizeof (NvDsVehicleObject);
     } else if (srcMeta->objType == NVDS_OBJECT_TYPE_PERSON) {
-      NvDsPersonObject *srcObj = (NvDsPersonObject *) srcMeta->extMsg;
-      NvDsPersonObject *obj =
-          (NvDsPersonObject *) g_malloc0 (sizeof (NvDsPersonObject));
-
-      obj->age = srcObj->age;
-
-      if (srcObj->gender)
-        obj->gender = g_strdup (srcObj->gender);
-      if (srcObj->cap)
-        obj->cap = g_strdup (srcObj->cap);
-      if (srcObj->hair)
-        obj->hair = g_strdup (srcObj->hair);
-      if (srcObj->apparel)
-        obj->apparel = g_strdup (srcObj->apparel);
-
-      dstMeta->extMsg = obj;
+      dstMeta->extMsg = g_memdup2 (srcMeta->extMsg,
+          sizeof (NvDsPersonObject));
       dstMeta->extMsgSize = sizeof (NvDsPersonObject);
     }
   }
@@ -205,33 +185,12 @@ meta_free_func (gpointer data, gpointer user_data)
     g_free (srcMeta->sensorStr);
   }
 
+  if (srcMeta->otherAttrs) {
+    g_free (srcMeta->otherAttrs);
+  }
+
   if (srcMeta->extMsgSize > 0) {
-    if (srcMeta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-      NvDsVehicleObject *obj = (NvDsVehicleObject *) srcMeta->extMsg;
-      if (obj->type)
-        g_free (obj->type);
-      if (obj->color)
-        g_free (obj->color);
-      if (obj->make)
-        g_free (obj->make);
-      if (obj->model)
-        g_free (obj->model);
-      if (obj->license)
-        g_free (obj->license);
-      if (obj->region)
-        g_free (obj->region);
-    } else if (srcMeta->objType == NVDS_OBJECT_TYPE_PERSON) {
-      NvDsPersonObject *obj = (NvDsPersonObject *) srcMeta->extMsg;
-
-      if (obj->gender)
-        g_free (obj->gender);
-      if (obj->cap)
-        g_free (obj->cap);
-      if (obj->hair)
-        g_free (obj->hair);
-      if (obj->apparel)
-        g_free (obj->apparel);
-    }
+    /* 차량/사람 속성 문자열은 라벨 테이블 소유이므로 해제하지 않습니다. */
     g_free (srcMeta->extMsg);
     srcMeta->extMsg = NULL;
     srcMeta->extMsgSize = 0;
@@ -239,6 +198,164 @@ meta_free_func (gpointer data, gpointer user_data)
   g_free (srcMeta);
 }
 
+////////////////////////////////////////////////////////////////
+static void
+attach_event_msg_meta (AppCtx * app_ctx, NvDsBatchMeta * batch_meta,
+    NvDsFrameMeta * frame_meta, NvDsEventMsgMeta * msg_meta, guint stream_id)
+{
+  NvDsUserMeta *user_event_meta =
+      nvds_acquire_user_meta_from_pool (batch_meta);
+  if (user_event_meta) {
+    /*
+     * 생성된 이벤트 메타데이터에는 동적으로 할당된 차량/사람과 같은
+     * 사용자 지정 객체가 있으므로, 두 구성 요소 간에 메타데이터 복사가
+     * 발생할 때 해당 필드를 처리하는 복사 및 해제 함수를 설정합니다.
+     */
+    user_event_meta->user_meta_data = (void *) msg_meta;
+    user_event_meta->base_meta.batch_meta = batch_meta;
+    user_event_meta->base_meta.meta_type = NVDS_EVENT_MSG_META;
+    user_event_meta->base_meta.copy_func =
+        (NvDsMetaCopyFunc) meta_copy_func;
+    user_event_meta->base_meta.release_func =
+        (NvDsMetaReleaseFunc) meta_free_func;
+    nvds_add_user_meta_to_frame (frame_meta, user_event_meta);
+    prototype_metrics_source_add (app_ctx->index, stream_id,
+        PROTOTYPE_METRIC_SOURCE_EVENT_METAS, 1);
+  } else {
+    g_print ("Error in attaching event meta to buffer\n");
+  }
+}
+
+/** zone 이름을 이벤트의 otherAttrs에 "zones=a,b"로 덧붙입니다. */
+static void
+append_zone_attrs (NvDsEventMsgMeta * msg_meta, PrototypeZoneMap * zone_map,
+    guint64 mask)
+{
+  GString *attrs = NULL;
+  gboolean first = TRUE;
+
+  if (!mask)
+    return;
+
+  attrs = g_string_new (msg_meta->otherAttrs);
+  g_string_append (attrs, attrs->len ? ";zones=" : "zones=");
+  for (; mask; mask &= mask - 1) {
+    g_string_append (attrs, first ? "" : ",");
+    g_string_append (attrs, prototype_zone_map_name (zone_map,
+            __builtin_ctzll (mask)));
+    first = FALSE;
+  }
+  g_free (msg_meta->otherAttrs);
+  msg_meta->otherAttrs = g_string_free (attrs, FALSE);
+}
+
+/** track_event_cb()에 넘기는 현재 프레임 정보 */
+typedef struct
+{
+  AppCtx *app_ctx;
+  NvDsBatchMeta *batch_meta;
+  NvDsFrameMeta *frame_meta;
+  NvDsSourceConfig *src_config;
+  StreamSourceInfo *src_stream;
+  guint stream_id;
+  /** 현재 소스의 zone 테이블 (NULL 가능) */
+  PrototypeZoneMap *zone_map;
+} TrackEventCtx;
+
+////////////////////////////////////////////////////////////////
+/**
+ * 트랙 enter/dwell/exit 이벤트를 현재 프레임의 이벤트 메타로 붙입니다.
+ * exit 이벤트의 객체는 현재 프레임에 없으며 bbox는 가장 좋았던 관측입니다.
+ */
+static void
+track_event_cb (const PrototypeTrackEvent * event, gpointer user_data)
+{
+  TrackEventCtx *ctx = (TrackEventCtx *) user_data;
+  NvDsEventMsgMeta *msg_meta =
+      (NvDsEventMsgMeta *) g_malloc0 (sizeof (NvDsEventMsgMeta));
+
+  generate_track_event_msg_meta (ctx->app_ctx, msg_meta, event,
+      ctx->src_config ? ctx->src_config->uri : NULL, ctx->stream_id,
+      ctx->src_config ? ctx->src_config->camera_id : ctx->stream_id,
+      ctx->frame_meta);
+  /* 트랙의 zone은 마지막 관측 위치(소스 해상도 좌표) 기준입니다. */
+  if (ctx->zone_map && ctx->frame_meta->source_frame_width &&
+      ctx->frame_meta->source_frame_height) {
+    gfloat point[2] = {
+      event->trajectory.end_x / ctx->frame_meta->source_frame_width,
+      event->trajectory.end_y / ctx->frame_meta->source_frame_height
+    };
+    guint64 mask = 0;
+
+    prototype_zone_map_lookup_points (ctx->zone_map, point, 1, &mask);
+    append_zone_attrs (msg_meta, ctx->zone_map, mask);
+  }
+  ctx->src_stream->meta_number++;
+  attach_event_msg_meta (ctx->app_ctx, ctx->batch_meta, ctx->frame_meta,
+      msg_meta, ctx->stream_id);
+}
+
+/** reid_link_cb()에 넘기는 현재 객체 정보 */
+typedef struct
+{
+  AppCtx *app_ctx;
+  NvDsBatchMeta *batch_meta;
+  NvDsFrameMeta *frame_meta;
+  NvDsObjectMeta *obj_meta;
+  NvDsSourceConfig *src_config;
+  StreamSourceInfo *src_stream;
+  guint stream_id;
+  float scaleW;
+  float scaleH;
+} ReidLinkCtx;
+
+/** 다른 카메라의 트랙과 같은 객체로 보이는 트랙을 이벤트 메타로 붙입니다. */
+static void
+reid_link_cb (const PrototypeReidLinkEvent * event, gpointer user_data)
+{
+  ReidLinkCtx *ctx = (ReidLinkCtx *) user_data;
+  NvDsEventMsgMeta *msg_meta =
+      (NvDsEventMsgMeta *) g_malloc0 (sizeof (NvDsEventMsgMeta));
+
+  generate_reid_link_msg_meta (ctx->app_ctx, msg_meta, event, ctx->obj_meta,
+      ctx->scaleW, ctx->scaleH, ctx->src_config ? ctx->src_config->uri : NULL,
+      ctx->stream_id,
+      ctx->src_config ? ctx->src_config->camera_id : ctx->stream_id,
+      ctx->frame_meta);
+  ctx->src_stream->meta_number++;
+  attach_event_msg_meta (ctx->app_ctx, ctx->batch_meta, ctx->frame_meta,
+      msg_meta, ctx->stream_id);
+}
+
+/**
+ * 트래커가 객체에 붙인 ReID 행 번호로 배치 텐서에서 임베딩을 찾아
+ * 갤러리에 더합니다.
+ */
+static void
+observe_object_reid (AppCtx * app_ctx, NvDsReidTensorBatch * reid_tensor,
+    GstClockTime ts, ReidLinkCtx * ctx)
+{
+  NvDsObjectMeta *obj_meta = ctx->obj_meta;
+
+  for (NvDsMetaList * l_user = obj_meta->obj_user_meta_list; l_user != NULL;
+      l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+    gint32 reid_index;
+
+    if (user_meta->base_meta.meta_type != NVDS_TRACKER_OBJ_REID_META ||
+        !user_meta->user_meta_data)
+      continue;
+    reid_index = *(gint32 *) user_meta->user_meta_data;
+    if (reid_index < 0 || (guint32) reid_index >= reid_tensor->numFilled)
+      break;
+    prototype_reid_gallery_observe (app_ctx->reid_gallery, ctx->stream_id,
+        obj_meta->object_id,
+        reid_tensor->ptr_host + (gsize) reid_index * reid_tensor->featureSize,
+        reid_tensor->featureSize, ts, reid_link_cb, ctx);
+    break;
+  }
+}
+
 ////////////////////////////////////////////////////////////////
 /**
  * Callback function to be called once all inferences (Primary + Secondary)
@@ -260,19 +377,44 @@ bbox_generated_probe_after_analytics (AppCtx * app_ctx, GstBuffer * buf,
   NvDsObjectMeta *obj_meta = NULL;
   GstClockTime buffer_pts = 0;
   guint32 stream_id = 0;
+  NvDsReidTensorBatch *reid_tensor = NULL;
+
+  /* 트래커의 배치 ReID 텐서. 객체별 ReID 메타는 이 텐서의 행 번호입니다. */
+  if (app_ctx->reid_gallery) {
+    for (NvDsMetaList * l_user = batch_meta->batch_user_meta_list;
+        l_user != NULL; l_user = l_user->next) {
+      NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+
+      if (user_meta->base_meta.meta_type == NVDS_TRACKER_BATCH_REID_META) {
+        reid_tensor = (NvDsReidTensorBatch *) user_meta->user_meta_data;
+        break;
+      }
+    }
+    if (reid_tensor && (!reid_tensor->ptr_host || !reid_tensor->featureSize))
+      reid_tensor = NULL;
+  }
 
   for (NvDsMetaList * l_frame = batch_meta->frame_meta_list; l_frame != NULL;
       l_frame = l_frame->next) {
     NvDsFrameMeta *frame_meta = (NvDsFrameMeta *) l_frame->data;
     stream_id = frame_meta->source_id;
     GstClockTime buf_ntp_time = 0;
+    StreamSourceInfo *src_stream =
+        get_stream_source_info (app_ctx, stream_id);
+    NvDsSourceConfig *src_config =
+        get_source_config (&app_ctx->config, stream_id);
+    if (!src_stream) {
+      continue;
+    }
+    /* stream EOS 뒤에 소스가 다시 프레임을 보내면 EOS 표시를 되돌립니다. */
+    if (G_UNLIKELY (g_atomic_int_get (&src_stream->retire) & STREAM_RETIRE_EOS))
+      g_atomic_int_and ((guint *) & src_stream->retire, ~STREAM_RETIRE_EOS);
     if (playback_utc == FALSE) {
       /** Calculate the buffer-NTP-time
        * derived from this stream's RTCP Sender Report here:
        */
       /** 이 스트림의 RTCP 송신 보고서에서 파생된 버퍼-NTP 시간을 계산합니다:
        */
-      StreamSourceInfo *src_stream = &testAppCtx->streams[stream_id];
       buf_ntp_time = frame_meta->ntp_timestamp;
 
       if (buf_ntp_time < src_stream->last_ntp_time) {
@@ -283,8 +425,37 @@ bbox_generated_probe_after_analytics (AppCtx * app_ctx, GstBuffer * buf,
       src_stream->last_ntp_time = buf_ntp_time;
     }
 
+    /* 프레임의 모든 객체 위치(bbox 하단 중앙)를 한 번에 zone 테이블에서 조회합니다. */
+    PrototypeZoneMap *zone_map = app_ctx->zones ?
+        prototype_zones_get (app_ctx->zones, stream_id) : NULL;
+    guint64 *zone_masks = NULL;
+    guint obj_index;
+    if (zone_map && app_ctx->config.streammux_config.pipeline_width &&
+        app_ctx->config.streammux_config.pipeline_height) {
+      guint num_obj = g_list_length (frame_meta->obj_meta_list);
+      gfloat *points = NULL;
+      GList *l_obj;
+
+      /* 마스크 뒤에 점 좌표를 두어 한 번만 할당합니다. */
+      zone_masks = (guint64 *) g_malloc ((num_obj + 1) *
+          (sizeof (guint64) + 2 * sizeof (gfloat)));
+      points = (gfloat *) (zone_masks + num_obj + 1);
+      obj_index = 0;
+      for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+          l_obj = l_obj->next, obj_index++) {
+        NvOSD_RectParams *rect = &((NvDsObjectMeta *) l_obj->data)->rect_params;
+
+        points[2 * obj_index] = (rect->left + rect->width / 2) /
+            app_ctx->config.streammux_config.pipeline_width;
+        points[2 * obj_index + 1] = (rect->top + rect->height) /
+            app_ctx->config.streammux_config.pipeline_height;
+      }
+      prototype_zone_map_lookup_points (zone_map, points, num_obj, zone_masks);
+    }
+
     GList *l;
-    for (l = frame_meta->obj_meta_list; l != NULL; l = l->next) {
+    for (l = frame_meta->obj_meta_list, obj_index = 0; l != NULL;
+        l = l->next, obj_index++) {
       /* Now using above information we need to form a text that should
        * be displayed on top of the bounding box, so lets form it here. */
       /* 이제 위의 정보를 사용하여 바운딩 박스 위에 표시될 텍스트를 형성해야 합니다.
@@ -317,6 +488,8 @@ bbox_generated_probe_after_analytics (AppCtx * app_ctx, GstBuffer * buf,
         if (!app_ctx->config.streammux_config.pipeline_width
             || !app_ctx->config.streammux_config.pipeline_height) {
           g_print ("invalid pipeline params\n");
+          prototype_zone_map_unref (zone_map);
+          g_free (zone_masks);
           return;
         }
         // LOGD ("stream %d==%d [%d X %d]\n", frame_meta->source_id,
@@ -335,38 +508,94 @@ bbox_generated_probe_after_analytics (AppCtx * app_ctx, GstBuffer * buf,
            */
           buffer_pts = buf_ntp_time;
         }
+
+        if (zone_masks && !zone_masks[obj_index] &&
+            prototype_zones_drop_outside (app_ctx->zones))
+          continue;
+
+        if (reid_tensor && obj_meta->object_id != UNTRACKED_OBJECT_ID) {
+          ReidLinkCtx reid_ctx = { app_ctx, batch_meta, frame_meta, obj_meta,
+            src_config, src_stream, stream_id, scaleW, scaleH
+          };
+
+          observe_object_reid (app_ctx, reid_tensor, buffer_pts, &reid_ctx);
+        }
+
+        /* track-lifecycle이 켜져 있으면 검출마다 보내지 않고 트랙 관측만 기록합니다. */
+        if (app_ctx->track_lifecycle) {
+          PrototypeTrackBox box;
+          gfloat confidence = obj_meta->confidence >= 0 ?
+              obj_meta->confidence : obj_meta->tracker_confidence;
+
+          if (obj_meta->object_id == UNTRACKED_OBJECT_ID)
+            continue;
+          box.left = obj_meta->rect_params.left * scaleW;
+          box.top = obj_meta->rect_params.top * scaleH;
+          box.width = obj_meta->rect_params.width * scaleW;
+          box.height = obj_meta->rect_params.height * scaleH;
+          prototype_track_lifecycle_observe (app_ctx->track_lifecycle,
+              stream_id, obj_meta->object_id, obj_meta->class_id,
+              nvds_label_table_intern (obj_meta->obj_label), confidence, &box,
+              buffer_pts);
+          continue;
+        }
+
         /** Generate NvDsEventMsgMeta for every object */
         NvDsEventMsgMeta *msg_meta =
             (NvDsEventMsgMeta *) g_malloc0 (sizeof (NvDsEventMsgMeta));
         generate_event_msg_meta (app_ctx, msg_meta, obj_meta->class_id, TRUE,
                   /**< useTs NOTE: Pass FALSE for files without base-timestamp in URI */
             buffer_pts,
-            app_ctx->config.multi_source_config[stream_id].uri, stream_id,
-            app_ctx->config.multi_source_config[stream_id].camera_id,
+            src_config ? src_config->uri : NULL, stream_id,
+            src_config ? src_config->camera_id : stream_id,
             obj_meta, scaleW, scaleH, frame_meta);
-        testAppCtx->streams[stream_id].meta_number++;
-        NvDsUserMeta *user_event_meta =
-            nvds_acquire_user_meta_from_pool (batch_meta);
-        if (user_event_meta) {
-          /*
-           * 생성된 이벤트 메타데이터에는 동적으로 할당된 차량/사람과 같은
-           * 사용자 지정 객체가 있으므로, 두 구성 요소 간에 메타데이터 복사가
-           * 발생할 때 해당 필드를 처리하는 복사 및 해제 함수를 설정합니다.
-           */
-          user_event_meta->user_meta_data = (void *) msg_meta;
-          user_event_meta->base_meta.batch_meta = batch_meta;
-          user_event_meta->base_meta.meta_type = NVDS_EVENT_MSG_META;
-          user_event_meta->base_meta.copy_func =
-              (NvDsMetaCopyFunc) meta_copy_func;
-          user_event_meta->base_meta.release_func =
-              (NvDsMetaReleaseFunc) meta_free_func;
-          nvds_add_user_meta_to_frame (frame_meta, user_event_meta);
-        } else {
-          g_print ("Error in attaching event meta to buffer\n");
-        }
+        if (zone_masks)
+          append_zone_attrs (msg_meta, zone_map, zone_masks[obj_index]);
+        src_stream->meta_number++;
+        attach_event_msg_meta (app_ctx, batch_meta, frame_meta, msg_meta,
+            stream_id);
+      }
+    }
+
+    if (app_ctx->track_lifecycle) {
+      TrackEventCtx ctx = { app_ctx, batch_meta, frame_meta, src_config,
+        src_stream, stream_id, zone_map
+      };
+
+      buffer_pts = playback_utc ? frame_meta->buf_pts : buf_ntp_time;
+      prototype_track_lifecycle_advance (app_ctx->track_lifecycle, stream_id,
+          buffer_pts, track_event_cb, &ctx);
+    }
+
+    /* heatmap은 zone과 관계없이 프레임의 모든 객체를 누적합니다. */
+    if (app_ctx->heatmap && app_ctx->config.streammux_config.pipeline_width &&
+        app_ctx->config.streammux_config.pipeline_height) {
+      guint num_obj = g_list_length (frame_meta->obj_meta_list);
+      PrototypeHeatmapBox *boxes = g_new (PrototypeHeatmapBox, num_obj + 1);
+      gfloat inv_width =
+          1.0f / app_ctx->config.streammux_config.pipeline_width;
+      gfloat inv_height =
+          1.0f / app_ctx->config.streammux_config.pipeline_height;
+
+      obj_index = 0;
+      for (l = frame_meta->obj_meta_list; l != NULL;
+          l = l->next, obj_index++) {
+        NvOSD_RectParams *rect = &((NvDsObjectMeta *) l->data)->rect_params;
+
+        boxes[obj_index].left = rect->left * inv_width;
+        boxes[obj_index].top = rect->top * inv_height;
+        boxes[obj_index].width = rect->width * inv_width;
+        boxes[obj_index].height = rect->height * inv_height;
       }
+      prototype_heatmap_add (app_ctx->heatmap, stream_id, boxes, num_obj,
+          playback_utc ? frame_meta->buf_pts : buf_ntp_time);
+      g_free (boxes);
     }
-    testAppCtx->streams[stream_id].frameCount++;
+    prototype_zone_map_unref (zone_map);
+    g_free (zone_masks);
+    src_stream->frameCount++;
+    prototype_metrics_observe_frame (app_ctx->index, stream_id,
+        frame_meta->frame_num);
   }
 }
 
@@ -409,11 +638,11 @@ perf_cb (gpointer context, NvDsAppPerfStruct * str)
   guint active_src_count = 0;
 
   for (i = 0; i < numf; i++) {
-    fps[i] = str->fps[i];
-    if (fps[i]){
+    prototype_metrics_source_set_gauge (app_ctx->index, i,
+        PROTOTYPE_METRIC_SOURCE_FPS, str->fps[i]);
+    if (str->fps[i]){
       active_src_count++;
     }
-    fps_avg[i] = str->fps_avg[i];
   }
   g_print("Active sources : %u\n", active_src_count);
   if (header_print_cnt % 20 == 0) {
@@ -435,11 +664,271 @@ perf_cb (gpointer context, NvDsAppPerfStruct * str)
     g_print ("**PERF:  ");
 
   for (i = 0; i < numf; i++) {
-    g_print ("%.2f (%.2f)\t", fps[i], fps_avg[i]);
+    g_print ("%.2f (%.2f)\t", str->fps[i], str->fps_avg[i]);
   }
 
   g_print ("\n");
   g_mutex_unlock (&fps_lock);
+
+  /* perf 주기마다 FPS와 지연으로 PGIE interval을 조정합니다. */
+  if (app_ctx->interval_control &&
+      app_ctx->pipeline.common_elements.primary_gie_bin.primary_gie) {
+    gdouble *control_fps = g_new (gdouble, MAX (numf, 1));
+    guint interval = 0;
+    PrototypeIntervalDecision decision;
+
+    /* motion-gate나 frame-scheduler가 프레임을 버리는 소스는 느려진 것이
+     * 아니므로 뺍니다. */
+    for (i = 0; i < numf; i++)
+      control_fps[i] = (app_ctx->motion_gate &&
+          prototype_motion_gate_is_static (app_ctx->motion_gate, i)) ||
+          (app_ctx->frame_scheduler &&
+          prototype_frame_scheduler_is_limited (app_ctx->frame_scheduler, i)) ?
+          0 : str->fps[i];
+    decision = prototype_interval_control_update (app_ctx->interval_control,
+        control_fps, numf, &interval);
+    g_free (control_fps);
+
+    if (decision != PROTOTYPE_INTERVAL_HOLD) {
+      g_object_set (app_ctx->pipeline.common_elements.primary_gie_bin.
+          primary_gie, "interval", interval, NULL);
+      g_print ("PGIE interval %s to %u (mean frame latency %.1f ms)\n",
+          decision == PROTOTYPE_INTERVAL_RAISE ? "raised" : "lowered",
+          interval,
+          prototype_interval_control_last_latency (app_ctx->interval_control));
+    }
+    prototype_metrics_instance_set (app_ctx->index,
+        PROTOTYPE_METRIC_PGIE_INTERVAL, interval);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+/**
+ * /metrics 스크레이프 시점에 소스 빈의 누적 재연결 횟수를 메트릭으로 옮깁니다.
+ * civetweb 스레드에서 호출되며, source-reload와 source_bins_lock으로 직렬화합니다.
+ */
+static void
+collect_metrics_cb (gpointer user_data)
+{
+  guint i, j;
+
+  g_mutex_lock (&source_bins_lock);
+  for (i = 0; i < num_instances; i++) {
+    if (appCtx[i] == NULL)
+      continue;
+
+    NvDsSrcParentBin *bin = &appCtx[i]->pipeline.multi_src_bin;
+    for (j = 0; j < bin->num_bins; j++) {
+      if (!bin->sub_bins[j].bin)
+        continue;
+      prototype_metrics_source_set (i, bin->sub_bins[j].source_id,
+          PROTOTYPE_METRIC_SOURCE_RTSP_RECONNECTS,
+          g_atomic_int_get (&bin->sub_bins[j].num_source_resets));
+    }
+  }
+  g_mutex_unlock (&source_bins_lock);
+}
+
+////////////////////////////////////////////////////////////////
+/**
+ * 소스의 stream EOS가 analytics 프로브를 지났습니다. 이 소스의 프레임은 더 이상
+ * bbox_generated_probe_after_analytics()에 오지 않으므로, 제거된 소스라면
+ * StreamSourceInfo를 정리합니다.
+ */
+static void
+stream_eos_probe_after_analytics (AppCtx * app_ctx, guint source_id)
+{
+  retire_stream_source_info (app_ctx, source_id, STREAM_RETIRE_EOS);
+}
+
+/**
+ * 소스별 상태를 만들거나 정리합니다.
+ * sensorInfoHash, StreamSourceInfo, 성능 측정 슬롯이 한 번에 바뀌도록
+ * bus_callback()과 같은 perf_struct.struct_lock 안에서 갱신합니다.
+ */
+static void
+update_source_state (AppCtx * ctx, guint source_id, gboolean active)
+{
+  NvDsAppPerfStructInt *perf = &ctx->perf_struct;
+
+  g_mutex_lock (&perf->struct_lock);
+  remove_sensor_info (ctx, source_id);
+  /* perf 측정이 꺼져 있으면 instance_str이 없습니다. */
+  if (source_id < perf->max_instances)
+    memset (&perf->instance_str[source_id], 0, sizeof (perf->instance_str[0]));
+  if (active) {
+    activate_stream_source_info (ctx, source_id);
+    perf->num_instances = MAX (perf->num_instances, source_id + 1);
+  } else {
+    /* 큐에 남은 프레임이 analytics 프로브를 지날 때까지 슬롯을 유지합니다.
+     * stream EOS가 이미 지났으면 여기서 정리됩니다. */
+    retire_stream_source_info (ctx, source_id, STREAM_RETIRE_REMOVED);
+    prototype_metrics_source_remove (ctx->index, source_id);
+  }
+  g_mutex_unlock (&perf->struct_lock);
+
+  /* 이벤트를 붙일 프레임이 없으므로 남은 트랙은 exit 없이 지웁니다.
+   * track_event_cb()가 struct_lock을 잡으므로 잠금 밖에서 호출합니다. */
+  if (!active && ctx->track_lifecycle)
+    prototype_track_lifecycle_remove_source (ctx->track_lifecycle, source_id,
+        NULL, NULL);
+  if (!active && ctx->heatmap)
+    prototype_heatmap_remove_source (ctx->heatmap, source_id);
+  if (!active && ctx->motion_gate)
+    prototype_motion_gate_remove_source (ctx->motion_gate, source_id);
+  if (!active && ctx->batch_timeout)
+    nvds_batch_timeout_remove_source (ctx->batch_timeout, source_id);
+  if (ctx->frame_scheduler) {
+    prototype_frame_scheduler_remove_source (ctx->frame_scheduler, source_id);
+    if (active && !prototype_frame_scheduler_set_source_class
+        (ctx->frame_scheduler, source_id,
+            ctx->config.source_shard_info[source_id].priority)) {
+      NVGSTDS_WARN_MSG_V ("Unknown priority %s for source %u, "
+          "using default-class",
+          ctx->config.source_shard_info[source_id].priority, source_id);
+    }
+  }
+}
+
+/**
+ * 소스 CSV를 다시 읽어 현재 소스와 비교하고, 바뀐 소스만 streammux 요청 패드로
+ * 추가/제거합니다. 변경되지 않은 소스의 빈과 패드는 건드리지 않습니다.
+ * 제거된 슬롯의 설정은 처리 중인 배치가 참조할 수 있으므로 같은 재적용에서는
+ * 재사용하지 않고, 이후 재적용에서 슬롯을 다시 쓸 때 해제합니다.
+ */
+static gboolean
+reload_sources_cb (gpointer data)
+{
+  gboolean ret = FALSE;
+  AppCtx *ctx = (AppCtx *) data;
+  PrototypeConfig *config = &ctx->config;
+  NvDsSrcParentBin *src_bin = &ctx->pipeline.multi_src_bin;
+  PrototypeConfig next;
+  gchar **current_keys = NULL;
+  gchar **next_keys = NULL;
+  GArray *removed = NULL;
+  GArray *added = NULL;
+  gboolean *released = g_new0 (gboolean, MAX (src_bin->max_bins, 1));
+  guint num_current = src_bin->num_bins;
+  guint num_added = 0, num_removed = 0, num_active = 0;
+  guint i, slot = 0;
+
+  memset (&next, 0, sizeof (next));
+  if (!parse_source_csv_file (&next, config->source_csv_path,
+          cfg_files[ctx->index])) {
+    NVGSTDS_WARN_MSG_V ("Keeping current sources, failed to parse '%s'",
+        config->source_csv_path);
+    goto done;
+  }
+
+  current_keys = g_new0 (gchar *, num_current + 1);
+  for (i = 0; i < num_current; i++) {
+    if (src_bin->sub_bins[i].bin)
+      current_keys[i] =
+          prototype_source_key (config->multi_source_config[i].camera_id,
+          config->multi_source_config[i].uri);
+  }
+  next_keys = g_new0 (gchar *, next.num_source_sub_bins + 1);
+  for (i = 0; i < next.num_source_sub_bins; i++)
+    next_keys[i] = prototype_source_key (next.multi_source_config[i].camera_id,
+        next.multi_source_config[i].uri);
+
+  removed = g_array_new (FALSE, FALSE, sizeof (guint));
+  added = g_array_new (FALSE, FALSE, sizeof (guint));
+  prototype_source_diff (current_keys, num_current, next_keys,
+      next.num_source_sub_bins, removed, added);
+
+  for (i = 0; i < removed->len; i++) {
+    guint source_id = g_array_index (removed, guint, i);
+
+    g_print ("Removing source %u: %s\n", source_id,
+        config->multi_source_config[source_id].uri);
+    g_mutex_lock (&source_bins_lock);
+    if (!remove_source_sub_bin (src_bin, source_id)) {
+      g_mutex_unlock (&source_bins_lock);
+      continue;
+    }
+    g_mutex_unlock (&source_bins_lock);
+    config->multi_source_config[source_id].enable = FALSE;
+    released[source_id] = TRUE;
+    update_source_state (ctx, source_id, FALSE);
+    num_removed++;
+  }
+
+  for (i = 0; i < added->len; i++) {
+    guint index = g_array_index (added, guint, i);
+    NvDsSourceConfig *source_config = NULL;
+
+    while (slot < src_bin->max_bins &&
+        (src_bin->sub_bins[slot].bin || released[slot]))
+      slot++;
+    if (slot == src_bin->max_bins) {
+      NVGSTDS_WARN_MSG_V ("No free source slot, %u sources not added",
+          added->len - i);
+      break;
+    }
+
+    source_config = &config->multi_source_config[slot];
+    clear_source_config (source_config);
+    *source_config = next.multi_source_config[index];
+    memset (&next.multi_source_config[index], 0, sizeof (NvDsSourceConfig));
+    prototype_source_shard_info_clear (&config->source_shard_info[slot]);
+    config->source_shard_info[slot] = next.source_shard_info[index];
+    memset (&next.source_shard_info[index], 0,
+        sizeof (PrototypeSourceShardInfo));
+    /* 시작 시와 같이 RTSP는 TCP를 사용합니다. */
+    if (force_tcp)
+      source_config->select_rtp_protocol = 0x04;
+    config->num_source_sub_bins = MAX (config->num_source_sub_bins, slot + 1);
+
+    g_print ("Adding source %u: %s\n", slot, source_config->uri);
+    update_source_state (ctx, slot, TRUE);
+    g_mutex_lock (&source_bins_lock);
+    if (!add_source_sub_bin (src_bin, source_config, slot)) {
+      g_mutex_unlock (&source_bins_lock);
+      source_config->enable = FALSE;
+      update_source_state (ctx, slot, FALSE);
+      released[slot] = TRUE;
+      continue;
+    }
+    g_mutex_unlock (&source_bins_lock);
+    num_added++;
+  }
+
+  for (i = 0; i < src_bin->num_bins; i++) {
+    if (src_bin->sub_bins[i].bin)
+      num_active++;
+  }
+  g_print ("Sources reloaded: %u added, %u removed, %u active\n", num_added,
+      num_removed, num_active);
+  if (num_active > config->streammux_config.batch_size) {
+    NVGSTDS_WARN_MSG_V ("%u active sources exceed streammux batch-size %d",
+        num_active, config->streammux_config.batch_size);
+  }
+
+  ret = TRUE;
+done:
+  for (i = 0; i < next.num_source_sub_bins; i++) {
+    clear_source_config (&next.multi_source_config[i]);
+    prototype_source_shard_info_clear (&next.source_shard_info[i]);
+  }
+  g_free (next.multi_source_config);
+  g_free (next.source_shard_info);
+  g_strfreev (next_keys);
+  g_free (released);
+  if (current_keys) {
+    for (i = 0; i < num_current; i++)
+      g_free (current_keys[i]);
+    g_free (current_keys);
+  }
+  if (removed)
+    g_array_free (removed, TRUE);
+  if (added)
+    g_array_free (added, TRUE);
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -526,6 +1015,10 @@ print_runtime_commands (void)
       "\th: Print this help\n"
       "\tq: Quit\n\n" "\tp: Pause\n" "\tr: Resume\n\n");
 
+  if (appCtx[0]->display_gate) {
+    g_print ("\tv: Open/close the display branch\n\n");
+  }
+
   if (appCtx[0]->config.tiled_display_config.enable) {
     g_print
         ("NOTE: To expand a source in the 2D tiled display and view object details,"
@@ -608,6 +1101,14 @@ event_thread_func (gpointer arg)
       for (i = 0; i < num_instances; i++)
         resume_pipeline (appCtx[i]);
       break;
+    case 'v':
+      /* 관리자 열기 상태를 뒤집습니다. 시청자가 없으면 닫을 때 바로 닫힙니다. */
+      for (i = 0; i < num_instances; i++) {
+        if (appCtx[i]->display_gate)
+          prototype_display_gate_set_admin (appCtx[i]->display_gate,
+              !prototype_display_gate_get_admin (appCtx[i]->display_gate));
+      }
+      break;
     case 'q':
       quit = TRUE;
       g_main_loop_quit (main_loop);
@@ -766,6 +1267,123 @@ nvds_x_event_thread (gpointer data)
   return NULL;
 }
 
+////////////////////////////////////////////////////////////////
+/**
+ * appCtx[index]를 할당하고 설정 파일을 파싱합니다.
+ */
+static gboolean
+init_app_ctx (guint index, gchar * cfg_file)
+{
+  appCtx[index] = (AppCtx *) g_malloc0 (sizeof (AppCtx));
+  appCtx[index]->person_class_id = -1;
+  appCtx[index]->car_class_id = -1;
+  appCtx[index]->index = index;
+  appCtx[index]->active_source_index = -1;
+  appCtx[index]->streams = stream_source_table_new ();
+  if (show_bbox_text) {
+    appCtx[index]->show_bbox_text = TRUE;
+  }
+
+  if (!IS_YAML(cfg_file) ||
+      !parse_config_file_yaml (&appCtx[index]->config, cfg_file)) {
+    NVGSTDS_ERR_MSG_V ("Failed to parse config file '%s'", cfg_file);
+    appCtx[index]->return_value = -1;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * appCtx[0]의 전체 소스 목록으로 shard 배치를 계산하고,
+ * 같은 설정 파일로 num-shards개의 인스턴스를 만들어 각자 배정된 소스만 남깁니다.
+ * state-file이 있으면 이전 배치를 최대한 유지하고 결과를 다시 기록합니다.
+ */
+static gboolean
+create_shard_instances (gchar * cfg_file)
+{
+  gboolean ret = FALSE;
+  PrototypeConfig *config = &appCtx[0]->config;
+  PrototypeShardConfig *shard_config = &config->shard_config;
+  guint num_shards = shard_config->num_shards;
+  guint num_sources = config->num_source_sub_bins;
+  PrototypeShardItem *items = NULL;
+  PrototypeShardPlan *plan = NULL;
+  GHashTable *codec_weights = NULL;
+  GHashTable *previous = NULL;
+  guint i;
+
+  if (num_shards > MAX_INSTANCES || num_shards > num_sources) {
+    NVGSTDS_ERR_MSG_V ("num-shards %u must be <= %d and <= number of sources %u",
+        num_shards, MAX_INSTANCES, num_sources);
+    goto done;
+  }
+
+  codec_weights =
+      prototype_shard_parse_codec_weights (shard_config->codec_weights);
+  items = g_new0 (PrototypeShardItem, num_sources);
+  for (i = 0; i < num_sources; i++) {
+    PrototypeSourceShardInfo *info = &config->source_shard_info[i];
+    items[i].key = config->multi_source_config[i].uri;
+    items[i].group = info->group;
+    items[i].weight = prototype_shard_source_weight (info->width,
+        info->height, info->fps,
+        prototype_shard_codec_weight (codec_weights, info->codec));
+  }
+
+  previous = prototype_shard_state_load (shard_config->state_file);
+  plan = prototype_shard_plan (items, num_sources, num_shards,
+      shard_config->balance_tolerance, previous);
+  if (!plan) {
+    goto done;
+  }
+
+  /* group으로 묶인 소스가 많으면 빈 shard가 생길 수 있습니다.
+   * 소스 없는 인스턴스는 파이프라인을 만들 수 없으므로 만들기 전에 뺍니다. */
+  if (prototype_shard_plan_drop_empty (plan) > 0) {
+    NVGSTDS_WARN_MSG_V ("num-shards %u reduced to %u: some shards got no "
+        "sources", num_shards, plan->num_shards);
+    num_shards = plan->num_shards;
+  }
+
+  g_print ("Shard plan: %u sources -> %u instances, %u moved\n", num_sources,
+      num_shards, plan->num_moved);
+  for (i = 0; i < num_shards; i++) {
+    g_print ("  shard %u load %.2f\n", i, plan->loads[i]);
+  }
+
+  if (shard_config->state_file &&
+      !prototype_shard_state_save (shard_config->state_file, items, plan)) {
+    NVGSTDS_WARN_MSG_V ("Failed to save shard state");
+  }
+
+  for (i = 1; i < num_shards; i++) {
+    num_instances = i + 1;
+    if (!init_app_ctx (i, cfg_file)) {
+      goto done;
+    }
+  }
+
+  /* items[].key는 appCtx[0]의 URI를 가리키므로 appCtx[0]을 마지막에 정리합니다. */
+  for (i = num_shards; i > 0; i--) {
+    if (!apply_shard_plan (&appCtx[i - 1]->config, plan, i - 1)) {
+      goto done;
+    }
+  }
+
+  ret = TRUE;
+done:
+  prototype_shard_plan_free (plan);
+  g_free (items);
+  if (codec_weights)
+    g_hash_table_destroy (codec_weights);
+  if (previous)
+    g_hash_table_destroy (previous);
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
 ////////////////////////////////////////////////////////////////
 /**
  * @} deepstream-app에서 그대로 가져옴
@@ -773,7 +1391,6 @@ nvds_x_event_thread (gpointer data)
 int
 main (int argc, char *argv[])
 {
-  testAppCtx = (TestAppCtx *) g_malloc0 (sizeof (TestAppCtx));
   GOptionContext *ctx = NULL;
   GOptionGroup *group = NULL;
   GError *error = NULL;
@@ -784,7 +1401,8 @@ main (int argc, char *argv[])
   g_option_group_add_entries (group, entries);
 
   g_option_context_set_main_group (ctx, group);
-  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  /* GStreamer 옵션은 설정 파일을 읽은 뒤 gst_init에서 처리합니다. */
+  g_option_context_set_ignore_unknown_options (ctx, TRUE);
 
   GST_DEBUG_CATEGORY_INIT (NVDS_APP, "NVDS_APP", 0, NULL);
 
@@ -818,24 +1436,27 @@ main (int argc, char *argv[])
   }
 
   for (i = 0; i < num_instances; i++) {
-    appCtx[i] = (AppCtx *) g_malloc0 (sizeof (AppCtx));
-    appCtx[i]->person_class_id = -1;
-    appCtx[i]->car_class_id = -1;
-    appCtx[i]->index = i;
-    appCtx[i]->active_source_index = -1;
-    if (show_bbox_text) {
-      appCtx[i]->show_bbox_text = TRUE;
-    }
+    if (!init_app_ctx (i, cfg_files[i]))
+      break;
+  }
 
-    if(IS_YAML(cfg_files[i])) {
-      if (!parse_config_file_yaml (&appCtx[i]->config, cfg_files[i])) {
-        NVGSTDS_ERR_MSG_V ("Failed to parse config file '%s'", cfg_files[i]);
-        appCtx[i]->return_value = -1;
-        goto done;
-      }
-    } else {
-      NVGSTDS_ERR_MSG_V ("Failed to parse config file '%s'", cfg_files[i]);
-      appCtx[i]->return_value = -1;
+  /* 프레임 지연 메타는 NVDS_ENABLE_LATENCY_MEASUREMENT가 설정된 경우에만
+   * 채워집니다. 스레드가 생기기 전, gst_init 전에 설정합니다. */
+  for (guint j = 0; j < i; j++) {
+    if (appCtx[j]->config.latency_stats_config.enable &&
+        !g_getenv ("NVDS_ENABLE_LATENCY_MEASUREMENT"))
+      g_setenv ("NVDS_ENABLE_LATENCY_MEASUREMENT", "1", TRUE);
+  }
+  gst_init (&argc, &argv);
+
+  if (i < num_instances) {
+    goto done;
+  }
+
+  /** 설정 파일이 하나이고 sharding이 활성화된 경우 소스를 여러 인스턴스로 나눕니다. */
+  if (num_instances == 1 && appCtx[0]->config.shard_config.enable) {
+    if (!create_shard_instances (cfg_files[0])) {
+      return_value = -1;
       goto done;
     }
   }
@@ -851,6 +1472,7 @@ main (int argc, char *argv[])
       if (force_tcp)
         appCtx[i]->config.multi_source_config[j].select_rtp_protocol = 0x04;
     }
+    appCtx[i]->stream_eos_post_analytics_cb = stream_eos_probe_after_analytics;
     if (!create_pipeline (appCtx[i], bbox_generated_probe_after_analytics,
             perf_cb)) {
       NVGSTDS_ERR_MSG_V ("Failed to create pipeline");
@@ -859,7 +1481,7 @@ main (int argc, char *argv[])
     }
     /** RTPSession 플러그인의 소스 패드에 프로브를 추가합니다. */
     for (guint j = 0; j < appCtx[i]->pipeline.multi_src_bin.num_bins; j++) {
-      testAppCtx->streams[j].id = j;
+      activate_stream_source_info (appCtx[i], j);
     }
     /** test5 앱에서 전형적인 IoT 사용 사례에 대해 여러 소스가 연결될 수 있으므로,
      * nvstreammux의 버퍼 풀 크기를 16으로 높입니다. */
@@ -867,6 +1489,29 @@ main (int argc, char *argv[])
         "buffer-pool-size", STREAMMUX_BUFFER_POOL_SIZE, NULL);
   }
 
+  if (!prototype_metrics_start (&appCtx[0]->config.metrics_config,
+          collect_metrics_cb, NULL)) {
+    NVGSTDS_WARN_MSG_V ("Failed to start metrics endpoint");
+  }
+
+  for (i = 0; i < num_instances; i++) {
+    PrototypeConfig *config = &appCtx[i]->config;
+
+    if (!config->source_reload_config.enable)
+      continue;
+    /* shard별로 나눈 소스 목록은 CSV와 1:1이 아니므로 재적용하지 않습니다. */
+    if (config->shard_config.enable) {
+      NVGSTDS_WARN_MSG_V ("source-reload is not supported with sharding");
+      continue;
+    }
+    source_watch[i] = prototype_source_watch_new (config->source_csv_path,
+        config->source_reload_config.min_interval_ms, reload_sources_cb,
+        appCtx[i]);
+    if (!source_watch[i]) {
+      NVGSTDS_WARN_MSG_V ("Failed to watch '%s'", config->source_csv_path);
+    }
+  }
+
   main_loop = g_main_loop_new (NULL, FALSE);
 
   _intr_setup ();
@@ -974,6 +1619,10 @@ main (int argc, char *argv[])
   /* 에러가 발생한 경우 재생 상태를 설정하지 마십시오. */
   if (return_value != -1) {
     for (i = 0; i < num_instances; i++) {
+      /* 쿼럼에 못 미쳐도 시작합니다. 남은 소스는 열리는 대로 합류합니다. */
+      if (!wait_for_source_quorum (&appCtx[i]->pipeline.multi_src_bin)) {
+        NVGSTDS_WARN_MSG_V ("Starting before source quorum was reached");
+      }
       if (gst_element_set_state (appCtx[i]->pipeline.pipeline,
               GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
 
@@ -996,6 +1645,11 @@ main (int argc, char *argv[])
 done:
 
   g_print ("Quitting\n");
+  prototype_metrics_stop ();
+  for (i = 0; i < MAX_INSTANCES; i++) {
+    prototype_source_watch_free (source_watch[i]);
+    source_watch[i] = NULL;
+  }
   for (i = 0; i < num_instances; i++) {
     if (appCtx[i] == NULL)
       continue;
@@ -1011,6 +1665,7 @@ done:
     windows[i] = 0;
     g_mutex_unlock (&disp_lock);
 
+    prototype_source_table_free (appCtx[i]->streams);
     g_free (appCtx[i]);
   }
 
@@ -1038,10 +1693,6 @@ done:
   gst_deinit ();
 
   return return_value;
-
-  g_free (testAppCtx);
-
-  return 0;
 }
 
 
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gst/video/video.h>
+
+#include "prototype_display_gate.h"
+
+struct _PrototypeDisplayGate
+{
+  PrototypeDisplayGateConfig config;
+  GMutex lock;
+  /** 연결된 RTSP 클라이언트 수 */
+  guint viewers;
+  gboolean admin;
+  /** 시청자와 관리자 열기가 모두 없어진 시각. 0이면 idle 아님 */
+  gint64 idle_since_us;
+  /** 스트리밍 스레드가 잠금 없이 읽습니다. */
+  gint active;
+  gint need_keyframe;
+  guint64 dropped;
+};
+
+static void
+open_gate (PrototypeDisplayGate * gate)
+{
+  gate->idle_since_us = 0;
+  if (g_atomic_int_get (&gate->active))
+    return;
+  g_atomic_int_set (&gate->need_keyframe, 1);
+  g_atomic_int_set (&gate->active, 1);
+  g_print ("Display branch opened (viewers %u, admin %d)\n", gate->viewers,
+      gate->admin);
+}
+
+static void
+close_gate (PrototypeDisplayGate * gate)
+{
+  gate->idle_since_us = 0;
+  if (!g_atomic_int_get (&gate->active))
+    return;
+  g_atomic_int_set (&gate->active, 0);
+  g_print ("Display branch closed\n");
+}
+
+/* 잠금을 잡은 상태에서 호출합니다. */
+static void
+start_idle (PrototypeDisplayGate * gate)
+{
+  if (gate->viewers || gate->admin || !g_atomic_int_get (&gate->active))
+    return;
+  if (!gate->config.idle_timeout_sec) {
+    close_gate (gate);
+    return;
+  }
+  if (!gate->idle_since_us)
+    gate->idle_since_us = g_get_monotonic_time ();
+}
+
+PrototypeDisplayGate *
+prototype_display_gate_new (PrototypeDisplayGateConfig * config)
+{
+  PrototypeDisplayGate *gate = NULL;
+
+  if (!config->enable)
+    return NULL;
+
+  gate = g_new0 (PrototypeDisplayGate, 1);
+  gate->config = *config;
+  g_mutex_init (&gate->lock);
+  if (config->start_active) {
+    gate->admin = TRUE;
+    open_gate (gate);
+  }
+
+  return gate;
+}
+
+void
+prototype_display_gate_free (PrototypeDisplayGate * gate)
+{
+  if (!gate)
+    return;
+
+  g_mutex_clear (&gate->lock);
+  g_free (gate);
+}
+
+void
+prototype_display_gate_viewer_added (PrototypeDisplayGate * gate)
+{
+  g_mutex_lock (&gate->lock);
+  gate->viewers++;
+  open_gate (gate);
+  g_mutex_unlock (&gate->lock);
+}
+
+void
+prototype_display_gate_viewer_removed (PrototypeDisplayGate * gate)
+{
+  g_mutex_lock (&gate->lock);
+  if (gate->viewers)
+    gate->viewers--;
+  start_idle (gate);
+  g_mutex_unlock (&gate->lock);
+}
+
+void
+prototype_display_gate_set_admin (PrototypeDisplayGate * gate,
+    gboolean active)
+{
+  g_mutex_lock (&gate->lock);
+  gate->admin = active;
+  if (active)
+    open_gate (gate);
+  else if (!gate->viewers)
+    close_gate (gate);
+  g_mutex_unlock (&gate->lock);
+}
+
+gboolean
+prototype_display_gate_get_admin (PrototypeDisplayGate * gate)
+{
+  gboolean admin;
+
+  g_mutex_lock (&gate->lock);
+  admin = gate->admin;
+  g_mutex_unlock (&gate->lock);
+  return admin;
+}
+
+gboolean
+prototype_display_gate_update (PrototypeDisplayGate * gate, gint64 now_us)
+{
+  gboolean closed = FALSE;
+
+  g_mutex_lock (&gate->lock);
+  if (gate->idle_since_us &&
+      now_us - gate->idle_since_us >=
+      (gint64) gate->config.idle_timeout_sec * G_USEC_PER_SEC) {
+    close_gate (gate);
+    closed = TRUE;
+  }
+  g_mutex_unlock (&gate->lock);
+  return closed;
+}
+
+gboolean
+prototype_display_gate_is_active (PrototypeDisplayGate * gate)
+{
+  return g_atomic_int_get (&gate->active);
+}
+
+/*
+ * 닫혀 있는 동안에는 tiler/OSD/렌더 분기가 프레임을 받지 않습니다. 다시 열린
+ * 뒤 첫 버퍼 앞에 키 프레임 요청을 보내 인코딩 sink가 바로 키 프레임부터
+ * 내보내게 합니다.
+ */
+static GstPadProbeReturn
+display_gate_buf_prob (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  PrototypeDisplayGate *gate = (PrototypeDisplayGate *) u_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  if (!g_atomic_int_get (&gate->active)) {
+    __atomic_fetch_add (&gate->dropped, 1, __ATOMIC_RELAXED);
+    return GST_PAD_PROBE_DROP;
+  }
+  if (g_atomic_int_compare_and_exchange (&gate->need_keyframe, 1, 0)) {
+    gst_pad_push_event (pad,
+        gst_video_event_new_downstream_force_key_unit (GST_BUFFER_PTS (buf),
+            GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0));
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+gulong
+prototype_display_gate_add_probe (PrototypeDisplayGate * gate, GstPad * pad)
+{
+  return gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      display_gate_buf_prob, gate, NULL);
+}
+
+guint64
+prototype_display_gate_get_dropped (PrototypeDisplayGate * gate)
+{
+  return __atomic_load_n (&gate->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_DISPLAY_GATE_H__
+#define __PROTOTYPE_DISPLAY_GATE_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+  // display-gate:
+  // enable: 1
+  // idle-timeout-sec: 30
+  // start-active: 0
+  gboolean enable;
+  /** 시청자가 모두 떠난 뒤 이 시간이 지나면 표시 분기를 다시 닫습니다. */
+  guint idle_timeout_sec;
+  /** 시작할 때 관리자 열기 상태로 둘지 여부 */
+  gboolean start_active;
+} PrototypeDisplayGateConfig;
+
+/**
+ * 필요할 때만 여는 표시(tiler/OSD/렌더) 분기의 게이트.
+ * 시청자(RTSP 클라이언트)가 있거나 관리자가 열어 두었을 때만 프레임을 통과시키고,
+ * 둘 다 없으면 idle-timeout-sec 뒤에 닫습니다. 닫혀 있는 동안 프레임은 tee
+ * 출력 패드에서 버려지므로 다른 분기는 막히지 않습니다.
+ * 상태 변경 함수는 어느 스레드에서나 호출할 수 있습니다.
+ */
+typedef struct _PrototypeDisplayGate PrototypeDisplayGate;
+
+/**
+ * @return 비활성 시 NULL
+ */
+PrototypeDisplayGate *prototype_display_gate_new
+    (PrototypeDisplayGateConfig * config);
+
+void prototype_display_gate_free (PrototypeDisplayGate * gate);
+
+/** RTSP 클라이언트가 연결되면 호출합니다. 닫혀 있으면 바로 엽니다. */
+void prototype_display_gate_viewer_added (PrototypeDisplayGate * gate);
+
+/** RTSP 클라이언트 연결이 끊기면 호출합니다. */
+void prototype_display_gate_viewer_removed (PrototypeDisplayGate * gate);
+
+/**
+ * @brief  관리자 열기 상태를 바꿉니다. 열기는 끌 때까지 유지되며,
+ *         끌 때 시청자가 없으면 바로 닫습니다.
+ */
+void prototype_display_gate_set_admin (PrototypeDisplayGate * gate,
+    gboolean active);
+
+gboolean prototype_display_gate_get_admin (PrototypeDisplayGate * gate);
+
+/**
+ * @brief  idle 시간이 지났는지 확인해 닫습니다. 주기적으로 호출합니다.
+ * @return 이번 호출에서 닫았으면 TRUE
+ */
+gboolean prototype_display_gate_update (PrototypeDisplayGate * gate,
+    gint64 now_us);
+
+gboolean prototype_display_gate_is_active (PrototypeDisplayGate * gate);
+
+/**
+ * @brief  표시 분기로 가는 tee 출력 패드에 게이트 버퍼 프로브를 답니다.
+ *         닫혀 있는 동안 버퍼를 버리고, 다시 연 뒤 첫 버퍼 앞에 downstream
+ *         force-key-unit 이벤트를 보냅니다. gate는 패드보다 오래 살아야 합니다.
+ * @return 프로브 id
+ */
+gulong prototype_display_gate_add_probe (PrototypeDisplayGate * gate,
+    GstPad * pad);
+
+/** 닫혀 있는 동안 버린 버퍼 수 */
+guint64 prototype_display_gate_get_dropped (PrototypeDisplayGate * gate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "prototype_frame_scheduler.h"
+#include "prototype_source_table.h"
+
+/** 입력 fps 측정과 용량 재분배 주기 */
+#define ALLOCATE_PERIOD_US (500 * G_TIME_SPAN_MILLISECOND)
+/** 이 주기 수 동안 프레임이 없으면 분배 대상에서 뺍니다. */
+#define IDLE_PERIODS (2)
+/** 입력 fps 이동 평균의 새 측정값 가중치 */
+#define ARRIVAL_ALPHA (0.5)
+/**
+ * 분배 수준에 묶이지 않은 소스는 할당(= 요구량)이 입력의 이 비율 이상이면
+ * 제한하지 않습니다 (클래스 상한 근처에서 측정 흔들림 흡수).
+ */
+#define UNLIMITED_RATIO (0.95)
+/** 통과 크레딧 상한. 1보다 커야 도착 간격이 흔들려도 할당 비율을 지킵니다. */
+#define MAX_CREDIT (2.0)
+#define BISECT_ITERATIONS (40)
+
+typedef struct
+{
+  /** classes 인덱스. 0은 default-class */
+  guint class_index;
+  gboolean active;
+  guint idle_periods;
+  /** 마지막 분배 이후 도착한 프레임 수 */
+  guint arrivals;
+  gdouble arrival_fps;
+  /** 할당된 추론 fps. 음수면 제한 없음 */
+  gdouble rate;
+  gdouble credit;
+  gint64 last_credit_us;
+  /** 마지막으로 통과시킨 시각. 0이면 아직 없음 */
+  gint64 last_admit_us;
+} SchedSlot;
+
+struct _PrototypeFrameScheduler
+{
+  gdouble inference_fps;
+  /** [0]은 default-class, [1..]은 설정의 클래스 */
+  PrototypeSchedulerClass *classes;
+  guint num_classes;
+  GMutex lock;
+  gint64 last_allocate_us;
+  PrototypeSourceTable *slots;
+  /** 분배 중 활성 소스를 모으는 작업 배열 */
+  GPtrArray *active;
+};
+
+static void
+sched_slot_init (guint source_id, gpointer data)
+{
+  SchedSlot *slot = (SchedSlot *) data;
+
+  slot->rate = -1;
+}
+
+PrototypeFrameScheduler *
+prototype_frame_scheduler_new (PrototypeFrameSchedulerConfig * config)
+{
+  PrototypeFrameScheduler *scheduler = NULL;
+  guint i;
+
+  if (!config->enable)
+    return NULL;
+
+  scheduler = g_new0 (PrototypeFrameScheduler, 1);
+  scheduler->inference_fps = MAX (config->inference_fps, 0);
+  scheduler->num_classes = config->num_classes + 1;
+  scheduler->classes = g_new0 (PrototypeSchedulerClass,
+      scheduler->num_classes);
+  scheduler->classes[0].weight = 1;
+  for (i = 0; i < config->num_classes; i++) {
+    scheduler->classes[i + 1] = config->classes[i];
+    if (g_strcmp0 (config->classes[i].name, config->default_class) == 0)
+      scheduler->classes[0] = config->classes[i];
+  }
+  for (i = 0; i < scheduler->num_classes; i++) {
+    if (scheduler->classes[i].weight <= 0)
+      scheduler->classes[i].weight = 1;
+  }
+  g_mutex_init (&scheduler->lock);
+  scheduler->slots = prototype_source_table_new (sizeof (SchedSlot),
+      sched_slot_init, NULL);
+  scheduler->active = g_ptr_array_new ();
+
+  return scheduler;
+}
+
+void
+prototype_frame_scheduler_free (PrototypeFrameScheduler * scheduler)
+{
+  if (!scheduler)
+    return;
+
+  prototype_source_table_free (scheduler->slots);
+  g_ptr_array_free (scheduler->active, TRUE);
+  g_mutex_clear (&scheduler->lock);
+  g_free (scheduler->classes);
+  g_free (scheduler);
+}
+
+/* 프레임마다 호출되므로 잠금 없는 조회를 먼저 시도합니다. */
+static SchedSlot *
+get_slot (PrototypeFrameScheduler * scheduler, guint source_id)
+{
+  SchedSlot *slot = (SchedSlot *) prototype_source_table_lookup
+      (scheduler->slots, source_id);
+
+  if (!slot)
+    slot = (SchedSlot *) prototype_source_table_get (scheduler->slots,
+        source_id);
+  return slot;
+}
+
+gboolean
+prototype_frame_scheduler_set_source_class (PrototypeFrameScheduler *
+    scheduler, guint source_id, const gchar * class_name)
+{
+  gboolean ret = TRUE;
+  SchedSlot *slot = NULL;
+  guint index = 0;
+  guint i;
+
+  if (class_name) {
+    ret = FALSE;
+    for (i = 1; i < scheduler->num_classes; i++) {
+      if (g_strcmp0 (scheduler->classes[i].name, class_name) == 0) {
+        index = i;
+        ret = TRUE;
+        break;
+      }
+    }
+  }
+
+  g_mutex_lock (&scheduler->lock);
+  slot = get_slot (scheduler, source_id);
+  if (slot) {
+    slot->class_index = index;
+    /* 새 클래스의 분배는 다음 주기부터 적용합니다. */
+    slot->rate = -1;
+  }
+  g_mutex_unlock (&scheduler->lock);
+
+  return ret;
+}
+
+static void
+collect_slot (guint source_id, gpointer data, gpointer user_data)
+{
+  PrototypeFrameScheduler *scheduler = (PrototypeFrameScheduler *) user_data;
+  SchedSlot *slot = (SchedSlot *) data;
+
+  if (slot->active)
+    g_ptr_array_add (scheduler->active, slot);
+}
+
+/* 소스의 추론 요구량: 입력 fps를 클래스 상한으로 자른 값 */
+static gdouble
+slot_demand (PrototypeFrameScheduler * scheduler, SchedSlot * slot)
+{
+  PrototypeSchedulerClass *cls = &scheduler->classes[slot->class_index];
+
+  if (cls->max_fps > 0)
+    return MIN (slot->arrival_fps, cls->max_fps);
+  return slot->arrival_fps;
+}
+
+static gdouble
+slot_share (PrototypeFrameScheduler * scheduler, SchedSlot * slot,
+    gdouble level)
+{
+  PrototypeSchedulerClass *cls = &scheduler->classes[slot->class_index];
+  gdouble demand = slot_demand (scheduler, slot);
+
+  return CLAMP (cls->weight * level, MIN (cls->min_fps, demand), demand);
+}
+
+/*
+ * 입력 fps를 갱신하고 inference-fps를 가중 max-min 공정 분배로 나눕니다.
+ * 소스 i의 할당은 clamp (w_i * level, min(min-fps, 요구량), 요구량)이고,
+ * 할당 합이 용량과 같아지는 level을 이분 탐색으로 찾습니다.
+ * min-fps 합이 용량을 넘으면 min-fps만 보장합니다.
+ */
+static void
+allocate (PrototypeFrameScheduler * scheduler, gint64 now_us)
+{
+  gdouble elapsed = (now_us - scheduler->last_allocate_us) / 1e6;
+  gdouble total_demand = 0, total_floor = 0, max_level = 0;
+  gdouble low = 0, high = 0, level = 0;
+  guint i, n;
+
+  g_ptr_array_set_size (scheduler->active, 0);
+  prototype_source_table_foreach (scheduler->slots, collect_slot, scheduler);
+  n = scheduler->active->len;
+
+  for (i = 0; i < n; i++) {
+    SchedSlot *slot = (SchedSlot *) g_ptr_array_index (scheduler->active, i);
+    PrototypeSchedulerClass *cls = &scheduler->classes[slot->class_index];
+    gdouble fps = slot->arrivals / elapsed;
+    gdouble demand;
+
+    slot->arrival_fps = slot->arrival_fps > 0 ?
+        slot->arrival_fps + ARRIVAL_ALPHA * (fps - slot->arrival_fps) : fps;
+    slot->idle_periods = slot->arrivals ? 0 : slot->idle_periods + 1;
+    slot->arrivals = 0;
+    if (slot->idle_periods >= IDLE_PERIODS) {
+      slot->active = FALSE;
+      slot->arrival_fps = 0;
+      slot->rate = -1;
+      continue;
+    }
+    demand = slot_demand (scheduler, slot);
+    total_demand += demand;
+    total_floor += MIN (cls->min_fps, demand);
+    max_level = MAX (max_level, demand / cls->weight);
+  }
+
+  if (scheduler->inference_fps > 0 && total_demand > scheduler->inference_fps) {
+    if (total_floor >= scheduler->inference_fps) {
+      level = 0;
+    } else {
+      high = max_level;
+      for (i = 0; i < BISECT_ITERATIONS; i++) {
+        gdouble mid = (low + high) / 2, sum = 0;
+        guint j;
+
+        for (j = 0; j < n; j++) {
+          SchedSlot *slot =
+              (SchedSlot *) g_ptr_array_index (scheduler->active, j);
+          if (slot->active)
+            sum += slot_share (scheduler, slot, mid);
+        }
+        if (sum > scheduler->inference_fps)
+          high = mid;
+        else
+          low = mid;
+      }
+      level = low;
+    }
+  } else {
+    level = max_level;
+  }
+
+  for (i = 0; i < n; i++) {
+    SchedSlot *slot = (SchedSlot *) g_ptr_array_index (scheduler->active, i);
+    gdouble share;
+
+    if (!slot->active)
+      continue;
+    share = slot_share (scheduler, slot, level);
+    /*
+     * 분배 수준에 묶인 소스는 입력과 가까워도 제한합니다. 흔들린 측정값으로
+     * 풀어 주면 할당 합이 inference-fps를 넘어 PGIE 큐가 계속 쌓입니다.
+     */
+    if (share >= slot_demand (scheduler, slot) &&
+        share >= slot->arrival_fps * UNLIMITED_RATIO) {
+      slot->rate = -1;
+    } else {
+      if (slot->rate < 0) {
+        slot->credit = 1;
+        slot->last_credit_us = now_us;
+      }
+      slot->rate = share;
+    }
+  }
+
+  scheduler->last_allocate_us = now_us;
+}
+
+gboolean
+prototype_frame_scheduler_admit (PrototypeFrameScheduler * scheduler,
+    guint source_id, gint64 now_us)
+{
+  gboolean admit = TRUE;
+  SchedSlot *slot = NULL;
+  PrototypeSchedulerClass *cls = NULL;
+
+  g_mutex_lock (&scheduler->lock);
+  slot = get_slot (scheduler, source_id);
+  if (!slot)
+    goto done;
+
+  if (!slot->active) {
+    /* 첫 분배 전까지는 모두 통과시킵니다. */
+    slot->active = TRUE;
+    slot->idle_periods = 0;
+    slot->rate = -1;
+  }
+  slot->arrivals++;
+  if (scheduler->last_allocate_us == 0)
+    scheduler->last_allocate_us = now_us;
+  else if (now_us - scheduler->last_allocate_us >= ALLOCATE_PERIOD_US)
+    allocate (scheduler, now_us);
+
+  if (slot->rate < 0)
+    goto done;
+
+  cls = &scheduler->classes[slot->class_index];
+  slot->credit = MIN (slot->credit +
+      slot->rate * (now_us - slot->last_credit_us) / 1e6, MAX_CREDIT);
+  slot->last_credit_us = now_us;
+
+  if (slot->credit >= 1) {
+    slot->credit -= 1;
+  } else if (cls->min_fps > 0 && slot->last_admit_us &&
+      now_us - slot->last_admit_us >= 1e6 / cls->min_fps) {
+    /* 마감: 도착 간격이 흔들려 크레딧이 모자라도 min-fps를 지킵니다. */
+    slot->credit = MAX (slot->credit - 1, -1.0);
+  } else {
+    admit = FALSE;
+  }
+
+done:
+  if (admit && slot)
+    slot->last_admit_us = now_us;
+  g_mutex_unlock (&scheduler->lock);
+  return admit;
+}
+
+gdouble
+prototype_frame_scheduler_allocated_fps (PrototypeFrameScheduler * scheduler,
+    guint source_id)
+{
+  SchedSlot *slot = (SchedSlot *) prototype_source_table_lookup
+      (scheduler->slots, source_id);
+
+  return slot ? slot->rate : -1;
+}
+
+gboolean
+prototype_frame_scheduler_is_limited (PrototypeFrameScheduler * scheduler,
+    guint source_id)
+{
+  return prototype_frame_scheduler_allocated_fps (scheduler, source_id) >= 0;
+}
+
+void
+prototype_frame_scheduler_remove_source (PrototypeFrameScheduler * scheduler,
+    guint source_id)
+{
+  g_mutex_lock (&scheduler->lock);
+  prototype_source_table_remove (scheduler->slots, source_id);
+  g_mutex_unlock (&scheduler->lock);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_FRAME_SCHEDULER_H__
+#define __PROTOTYPE_FRAME_SCHEDULER_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 소스 CSV의 priority 컬럼이 가리키는 우선순위 클래스 */
+typedef struct
+{
+  gchar *name;
+  /** 추론 용량을 나눌 때의 가중치 */
+  gdouble weight;
+  /** 이 클래스 소스의 추론 fps 상한. 0이면 제한 없음 */
+  gdouble max_fps;
+  /** 용량이 부족해도 보장하는 추론 fps. 0이면 보장 없음 */
+  gdouble min_fps;
+} PrototypeSchedulerClass;
+
+typedef struct
+{
+  // frame-scheduler:
+  // enable: 1
+  // inference-fps: 240
+  // default-class: normal
+  // classes: entrance:4:0:15;normal:1:15:2;low:1:5:1
+  gboolean enable;
+  /** PGIE가 처리할 수 있는 전체 프레임 수/초. 0이면 클래스 상한만 적용합니다. */
+  gdouble inference_fps;
+  /** priority 컬럼이 비어 있는 소스의 클래스. NULL이면 가중치 1, 제한 없음 */
+  gchar *default_class;
+  /** name:weight:max-fps:min-fps;... */
+  PrototypeSchedulerClass *classes;
+  guint num_classes;
+} PrototypeFrameSchedulerConfig;
+
+/**
+ * 추론 프레임 스케줄러.
+ * 소스별 입력 fps를 측정해 주기마다 inference-fps를 가중 max-min 공정 분배
+ * (WFQ가 근사하는 유체 GPS 비율)로 나누고, 각 소스는 할당된 비율로 프레임을
+ * 고르게 통과시킵니다. 클래스의 min-fps는 분배의 하한이자 마감으로,
+ * 마지막으로 통과한 프레임에서 1/min-fps가 지나면 분배와 관계없이 통과시킵니다.
+ * 용량이 충분하면 모든 프레임을 통과시킵니다.
+ */
+typedef struct _PrototypeFrameScheduler PrototypeFrameScheduler;
+
+/**
+ * @return 비활성 시 NULL
+ */
+PrototypeFrameScheduler *prototype_frame_scheduler_new
+    (PrototypeFrameSchedulerConfig * config);
+
+void prototype_frame_scheduler_free (PrototypeFrameScheduler * scheduler);
+
+/**
+ * @brief  소스의 우선순위 클래스를 지정합니다. class_name이 NULL이거나
+ *         정의되지 않은 이름이면 default-class를 씁니다.
+ * @return class_name이 정의되지 않은 이름이면 FALSE
+ */
+gboolean prototype_frame_scheduler_set_source_class
+    (PrototypeFrameScheduler * scheduler, guint source_id,
+    const gchar * class_name);
+
+/**
+ * @brief  소스의 프레임 하나를 추론에 보낼지 정합니다.
+ * @param  now_us [IN] 단조 시계 (마이크로초)
+ * @return 프레임을 통과시키면 TRUE
+ */
+gboolean prototype_frame_scheduler_admit (PrototypeFrameScheduler * scheduler,
+    guint source_id, gint64 now_us);
+
+/**
+ * @brief  소스에 할당된 추론 fps를 반환합니다.
+ * @return 제한 없이 모두 통과 중이면 음수
+ */
+gdouble prototype_frame_scheduler_allocated_fps
+    (PrototypeFrameScheduler * scheduler, guint source_id);
+
+/**
+ * @brief  소스의 프레임 일부를 용량 분배나 클래스 상한 때문에 버리는
+ *         중인지 반환합니다.
+ */
+gboolean prototype_frame_scheduler_is_limited
+    (PrototypeFrameScheduler * scheduler, guint source_id);
+
+/** 소스의 측정값과 클래스를 버립니다. */
+void prototype_frame_scheduler_remove_source
+    (PrototypeFrameScheduler * scheduler, guint source_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
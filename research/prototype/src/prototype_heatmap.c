@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "prototype_heatmap.h"
+#include "prototype_source_table.h"
+
+/** 배율 1에서 관측 하나가 더하는 값 */
+#define HEATMAP_UNIT (256)
+/** 배율이 2^RENORM_BITS 이상이 되면 격자를 시프트해 줄입니다. */
+#define HEATMAP_RENORM_BITS (4)
+/** 쓰기 스레드에 쌓일 수 있는 스냅샷 수. 넘으면 새 스냅샷을 버립니다. */
+#define HEATMAP_MAX_PENDING_SNAPSHOTS (32)
+
+typedef struct
+{
+  guint32 *cells;
+  /** 배율이 1인 시각 */
+  GstClockTime epoch;
+  GstClockTime last_ts;
+  GstClockTime next_snapshot;
+  gboolean started;
+  /** remove_source()가 세우고 add()가 비웁니다. */
+  gint reset;
+} HeatmapSource;
+
+typedef struct
+{
+  guint source_id;
+  GstClockTime ts;
+  /** 셀 값을 관측 수로 바꾸는 나눗수 */
+  gdouble scale;
+  /** NULL이면 쓰기 스레드 종료 */
+  guint32 *cells;
+} HeatmapSnapshot;
+
+struct _PrototypeHeatmap
+{
+  PrototypeHeatmapConfig config;
+  guint num_cells;
+  GstClockTime half_life_ns;
+  GstClockTime snapshot_interval_ns;
+  /** source_id -> HeatmapSource */
+  PrototypeSourceTable *sources;
+  GAsyncQueue *snapshots;
+  GThread *writer;
+};
+
+static void
+heatmap_source_clear (guint source_id, gpointer slot)
+{
+  HeatmapSource *src = (HeatmapSource *) slot;
+
+  g_free (src->cells);
+}
+
+/* 스냅샷 시각 ts의 배율 (셀 값 / 관측 수) */
+static gdouble
+heatmap_scale (PrototypeHeatmap * heatmap, HeatmapSource * src,
+    GstClockTime ts)
+{
+  if (!heatmap->half_life_ns || ts <= src->epoch)
+    return HEATMAP_UNIT;
+  return HEATMAP_UNIT * exp2 ((gdouble) (ts - src->epoch) /
+      heatmap->half_life_ns);
+}
+
+static void
+write_snapshot (PrototypeHeatmap * heatmap, HeatmapSnapshot * snapshot)
+{
+  guint16 *pixels = g_new (guint16, heatmap->num_cells);
+  guint32 max = 0;
+  gchar *path = NULL;
+  gchar *comment = NULL;
+  GError *error = NULL;
+  guint i;
+
+  for (i = 0; i < heatmap->num_cells; i++)
+    max = MAX (max, snapshot->cells[i]);
+  /* 스냅샷마다 최댓값을 65535로 맞추고, 실제 값은 주석으로 남깁니다. */
+  for (i = 0; i < heatmap->num_cells; i++)
+    pixels[i] = max ? (guint16) ((guint64) snapshot->cells[i] * 65535 / max)
+        : 0;
+
+  path = g_strdup_printf ("%s/heatmap-%u-%" G_GUINT64_FORMAT ".png",
+      heatmap->config.output_dir, snapshot->source_id,
+      snapshot->ts / GST_MSECOND);
+  comment = g_strdup_printf ("source-id=%u;ts-ms=%" G_GUINT64_FORMAT ";"
+      "max-observations=%.3f;half-life-sec=%u;footprint=%s",
+      snapshot->source_id, snapshot->ts / GST_MSECOND, max / snapshot->scale,
+      heatmap->config.half_life_sec,
+      heatmap->config.footprint == PROTOTYPE_HEATMAP_FOOTPRINT_BOX ?
+      "bbox" : "point");
+  if (!prototype_heatmap_write_png (path, pixels, heatmap->config.grid_width,
+          heatmap->config.grid_height, comment, &error)) {
+    g_printerr ("heatmap: failed to write %s: %s\n", path, error->message);
+    g_error_free (error);
+  }
+
+  g_free (comment);
+  g_free (path);
+  g_free (pixels);
+}
+
+static gpointer
+heatmap_writer_thread (gpointer data)
+{
+  PrototypeHeatmap *heatmap = (PrototypeHeatmap *) data;
+
+  while (TRUE) {
+    HeatmapSnapshot *snapshot =
+        (HeatmapSnapshot *) g_async_queue_pop (heatmap->snapshots);
+
+    if (!snapshot->cells) {
+      g_free (snapshot);
+      break;
+    }
+    write_snapshot (heatmap, snapshot);
+    g_free (snapshot->cells);
+    g_free (snapshot);
+  }
+  return NULL;
+}
+
+PrototypeHeatmap *
+prototype_heatmap_new (PrototypeHeatmapConfig * config)
+{
+  PrototypeHeatmap *heatmap = NULL;
+
+  if (!config->enable || config->grid_width == 0 || config->grid_height == 0)
+    return NULL;
+  if (config->snapshot_interval_sec && (!config->output_dir ||
+          g_mkdir_with_parents (config->output_dir, 0755) != 0)) {
+    g_printerr ("heatmap: cannot create output-dir %s\n",
+        config->output_dir ? config->output_dir : "(null)");
+    return NULL;
+  }
+
+  heatmap = g_new0 (PrototypeHeatmap, 1);
+  heatmap->config = *config;
+  heatmap->config.output_dir = g_strdup (config->output_dir);
+  heatmap->num_cells = config->grid_width * config->grid_height;
+  heatmap->half_life_ns = (GstClockTime) config->half_life_sec * GST_SECOND;
+  heatmap->snapshot_interval_ns =
+      (GstClockTime) config->snapshot_interval_sec * GST_SECOND;
+  heatmap->sources = prototype_source_table_new (sizeof (HeatmapSource), NULL,
+      heatmap_source_clear);
+  heatmap->snapshots = g_async_queue_new ();
+  heatmap->writer = g_thread_new ("heatmap-writer", heatmap_writer_thread,
+      heatmap);
+
+  return heatmap;
+}
+
+void
+prototype_heatmap_free (PrototypeHeatmap * heatmap)
+{
+  if (!heatmap)
+    return;
+
+  g_async_queue_push (heatmap->snapshots, g_new0 (HeatmapSnapshot, 1));
+  g_thread_join (heatmap->writer);
+  g_async_queue_unref (heatmap->snapshots);
+  prototype_source_table_free (heatmap->sources);
+  g_free (heatmap->config.output_dir);
+  g_free (heatmap);
+}
+
+/* 포화 덧셈. 분기 없는 형태라 컴파일러가 벡터화합니다. */
+static inline void
+row_add (guint32 * row, guint count, guint32 inc)
+{
+  guint i;
+
+  for (i = 0; i < count; i++) {
+    guint32 v = row[i] + inc;
+
+    row[i] = v < inc ? G_MAXUINT32 : v;
+  }
+}
+
+static inline guint
+cell_index (gfloat v, guint size)
+{
+  gint i = (gint) (v * size);
+
+  return (guint) CLAMP (i, 0, (gint) size - 1);
+}
+
+static void
+heatmap_reset (PrototypeHeatmap * heatmap, HeatmapSource * src,
+    GstClockTime ts)
+{
+  memset (src->cells, 0, heatmap->num_cells * sizeof (guint32));
+  src->epoch = ts;
+  src->next_snapshot = ts + heatmap->snapshot_interval_ns;
+  src->started = TRUE;
+}
+
+/* 배율이 2^RENORM_BITS를 넘으면 격자를 지난 반감기 수만큼 시프트합니다. */
+static void
+heatmap_renormalize (PrototypeHeatmap * heatmap, HeatmapSource * src,
+    GstClockTime ts)
+{
+  guint64 shift;
+  guint i;
+
+  if (!heatmap->half_life_ns || ts < src->epoch)
+    return;
+  shift = (ts - src->epoch) / heatmap->half_life_ns;
+  if (shift < HEATMAP_RENORM_BITS)
+    return;
+
+  if (shift >= 32) {
+    memset (src->cells, 0, heatmap->num_cells * sizeof (guint32));
+  } else {
+    for (i = 0; i < heatmap->num_cells; i++)
+      src->cells[i] >>= shift;
+  }
+  src->epoch += shift * heatmap->half_life_ns;
+}
+
+static void
+heatmap_schedule_snapshot (PrototypeHeatmap * heatmap, HeatmapSource * src,
+    guint source_id, GstClockTime ts)
+{
+  HeatmapSnapshot *snapshot = NULL;
+
+  src->next_snapshot += heatmap->snapshot_interval_ns;
+  if (src->next_snapshot <= ts)
+    src->next_snapshot = ts + heatmap->snapshot_interval_ns;
+
+  if (g_async_queue_length (heatmap->snapshots) >=
+      HEATMAP_MAX_PENDING_SNAPSHOTS) {
+    g_printerr ("heatmap: writer is behind, dropping snapshot of source %u\n",
+        source_id);
+    return;
+  }
+
+  snapshot = g_new (HeatmapSnapshot, 1);
+  snapshot->source_id = source_id;
+  snapshot->ts = ts;
+  snapshot->scale = heatmap_scale (heatmap, src, ts);
+  snapshot->cells = (guint32 *) g_memdup2 (src->cells,
+      heatmap->num_cells * sizeof (guint32));
+  g_async_queue_push (heatmap->snapshots, snapshot);
+}
+
+void
+prototype_heatmap_add (PrototypeHeatmap * heatmap, guint source_id,
+    const PrototypeHeatmapBox * boxes, guint num_boxes, GstClockTime ts)
+{
+  HeatmapSource *src = (HeatmapSource *)
+      prototype_source_table_lookup (heatmap->sources, source_id);
+  guint grid_width = heatmap->config.grid_width;
+  guint grid_height = heatmap->config.grid_height;
+  guint32 inc;
+  guint i, cy;
+
+  if (!src) {
+    src = (HeatmapSource *) prototype_source_table_get (heatmap->sources,
+        source_id);
+    if (!src)
+      return;
+  }
+  if (!src->cells)
+    src->cells = g_new0 (guint32, heatmap->num_cells);
+
+  /* 소스 교체 또는 타임스탬프가 되돌아간 경우 (파일 반복 재생 등) */
+  if (g_atomic_int_compare_and_exchange (&src->reset, 1, 0) ||
+      !src->started || ts + GST_SECOND < src->last_ts)
+    heatmap_reset (heatmap, src, ts);
+  ts = MAX (ts, src->epoch);
+  src->last_ts = ts;
+
+  heatmap_renormalize (heatmap, src, ts);
+  inc = (guint32) (heatmap_scale (heatmap, src, ts) + 0.5);
+
+  for (i = 0; i < num_boxes; i++) {
+    const PrototypeHeatmapBox *box = &boxes[i];
+
+    if (heatmap->config.footprint == PROTOTYPE_HEATMAP_FOOTPRINT_POINT) {
+      gfloat x = box->left + box->width / 2;
+      gfloat y = box->top + box->height;
+
+      if (x < 0 || x > 1 || y < 0 || y > 1)
+        continue;
+      row_add (&src->cells[cell_index (y, grid_height) * grid_width +
+              cell_index (x, grid_width)], 1, inc);
+    } else {
+      guint cx0, cx1, cy0, cy1;
+
+      if (box->left > 1 || box->top > 1 || box->left + box->width < 0 ||
+          box->top + box->height < 0)
+        continue;
+      cx0 = cell_index (box->left, grid_width);
+      cx1 = cell_index (box->left + box->width, grid_width);
+      cy0 = cell_index (box->top, grid_height);
+      cy1 = cell_index (box->top + box->height, grid_height);
+      for (cy = cy0; cy <= cy1; cy++)
+        row_add (&src->cells[cy * grid_width + cx0], cx1 - cx0 + 1, inc);
+    }
+  }
+
+  if (heatmap->snapshot_interval_ns && ts >= src->next_snapshot)
+    heatmap_schedule_snapshot (heatmap, src, source_id, ts);
+}
+
+void
+prototype_heatmap_remove_source (PrototypeHeatmap * heatmap, guint source_id)
+{
+  HeatmapSource *src = (HeatmapSource *)
+      prototype_source_table_lookup (heatmap->sources, source_id);
+
+  if (src)
+    g_atomic_int_set (&src->reset, 1);
+}
+
+gboolean
+prototype_heatmap_read (PrototypeHeatmap * heatmap, guint source_id,
+    GstClockTime ts, gfloat * values)
+{
+  HeatmapSource *src = (HeatmapSource *)
+      prototype_source_table_lookup (heatmap->sources, source_id);
+  gdouble scale;
+  guint i;
+
+  if (!src || !src->cells || !src->started)
+    return FALSE;
+
+  scale = heatmap_scale (heatmap, src, ts);
+  for (i = 0; i < heatmap->num_cells; i++)
+    values[i] = src->cells[i] / scale;
+  return TRUE;
+}
+
+static void
+png_put_u32 (GByteArray * out, guint32 v)
+{
+  guint8 b[4] = { v >> 24, v >> 16, v >> 8, v };
+
+  g_byte_array_append (out, b, 4);
+}
+
+static void
+png_put_chunk (GByteArray * out, const gchar * type, const guint8 * data,
+    gsize len)
+{
+  uLong crc = crc32 (0, (const Bytef *) type, 4);
+
+  if (len)
+    crc = crc32 (crc, data, len);
+  png_put_u32 (out, len);
+  g_byte_array_append (out, (const guint8 *) type, 4);
+  if (len)
+    g_byte_array_append (out, data, len);
+  png_put_u32 (out, crc);
+}
+
+gboolean
+prototype_heatmap_write_png (const gchar * path, const guint16 * pixels,
+    guint width, guint height, const gchar * comment, GError ** error)
+{
+  static const guint8 signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26,
+    '\n'
+  };
+  gboolean ret = FALSE;
+  gsize stride = 1 + (gsize) width * 2;
+  guint8 *raw = g_new (guint8, stride * height);
+  uLongf compressed_len = compressBound (stride * height);
+  guint8 *compressed = g_new (guint8, compressed_len);
+  GByteArray *out = g_byte_array_new ();
+  guint8 header[13];
+  guint x, y;
+
+  /* 스캔라인마다 Sub 필터 (왼쪽 픽셀과의 차이). 매끄러운 heatmap이 잘 압축됩니다. */
+  for (y = 0; y < height; y++) {
+    guint8 *line = raw + y * stride;
+    guint16 prev = 0;
+
+    line[0] = 1;
+    for (x = 0; x < width; x++) {
+      guint16 v = pixels[(gsize) y * width + x];
+
+      line[1 + 2 * x] = (guint8) ((v >> 8) - (prev >> 8));
+      line[2 + 2 * x] = (guint8) ((v & 0xff) - (prev & 0xff));
+      prev = v;
+    }
+  }
+  if (compress2 (compressed, &compressed_len, raw, stride * height, 6) !=
+      Z_OK) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+        "zlib compression failed");
+    goto done;
+  }
+
+  g_byte_array_append (out, signature, sizeof (signature));
+  header[0] = width >> 24;
+  header[1] = width >> 16;
+  header[2] = width >> 8;
+  header[3] = width;
+  header[4] = height >> 24;
+  header[5] = height >> 16;
+  header[6] = height >> 8;
+  header[7] = height;
+  header[8] = 16;               /* bit depth */
+  header[9] = 0;                /* grayscale */
+  header[10] = header[11] = header[12] = 0;
+  png_put_chunk (out, "IHDR", header, sizeof (header));
+  if (comment) {
+    GByteArray *text = g_byte_array_new ();
+
+    g_byte_array_append (text, (const guint8 *) "Comment", 8);
+    g_byte_array_append (text, (const guint8 *) comment, strlen (comment));
+    png_put_chunk (out, "tEXt", text->data, text->len);
+    g_byte_array_unref (text);
+  }
+  png_put_chunk (out, "IDAT", compressed, compressed_len);
+  png_put_chunk (out, "IEND", NULL, 0);
+
+  /* 임시 파일에 쓴 뒤 rename하므로 읽는 쪽이 쓰다 만 파일을 보지 않습니다. */
+  ret = g_file_set_contents (path, (const gchar *) out->data, out->len,
+      error);
+
+done:
+  g_byte_array_unref (out);
+  g_free (compressed);
+  g_free (raw);
+  return ret;
+}
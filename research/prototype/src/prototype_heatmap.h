@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_HEATMAP_H__
+#define __PROTOTYPE_HEATMAP_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum
+{
+  /** bbox 하단 중앙이 속한 셀 하나 */
+  PROTOTYPE_HEATMAP_FOOTPRINT_POINT,
+  /** bbox가 덮는 모든 셀 */
+  PROTOTYPE_HEATMAP_FOOTPRINT_BOX,
+} PrototypeHeatmapFootprint;
+
+typedef struct
+{
+  // heatmap:
+  // enable: 1
+  // grid-width: 160
+  // grid-height: 90
+  // footprint: point
+  // half-life-sec: 600
+  // snapshot-interval-sec: 60
+  // output-dir: heatmaps
+  gboolean enable;
+  guint grid_width;
+  guint grid_height;
+  PrototypeHeatmapFootprint footprint;
+  /** 이 시간이 지나면 관측의 가중치가 절반이 됩니다. 0이면 감쇠 없음 */
+  guint half_life_sec;
+  /** 소스 시간 기준 스냅샷 주기. 0이면 스냅샷을 쓰지 않습니다. */
+  guint snapshot_interval_sec;
+  /** 스냅샷 PNG를 쓸 디렉터리 */
+  gchar *output_dir;
+} PrototypeHeatmapConfig;
+
+/** 프레임 크기로 정규화한 bbox (0~1) */
+typedef struct
+{
+  gfloat left;
+  gfloat top;
+  gfloat width;
+  gfloat height;
+} PrototypeHeatmapBox;
+
+/**
+ * 소스별 고정 해상도 정수 격자에 객체 위치를 누적합니다.
+ *
+ * 감쇠는 셀을 매번 줄이지 않고, 더하는 값을 시간에 따라 2^(t/half-life)로
+ * 키웁니다. 이 배율이 커지면 격자 전체를 비트 시프트로 한 번에 줄이므로
+ * 프레임당 비용은 객체가 덮는 셀 수에 비례합니다.
+ *
+ * 한 소스의 add()는 한 스레드에서만 호출하며 (분석 probe), 잠금 없이 격자를
+ * 갱신합니다. 스냅샷은 그 스레드에서 격자를 복사한 뒤 별도 스레드에서
+ * 16비트 PNG로 압축해 <output-dir>/heatmap-<source-id>-<ts_ms>.png 에 씁니다.
+ */
+typedef struct _PrototypeHeatmap PrototypeHeatmap;
+
+/**
+ * @return 비활성이거나 output-dir을 만들 수 없으면 NULL
+ */
+PrototypeHeatmap *prototype_heatmap_new (PrototypeHeatmapConfig * config);
+
+/** 대기 중인 스냅샷을 모두 쓴 뒤 해제합니다. */
+void prototype_heatmap_free (PrototypeHeatmap * heatmap);
+
+/**
+ * @brief  소스의 한 프레임 객체들을 누적합니다. ts는 프레임 타임스탬프(ns)이며
+ *         스냅샷 주기가 지났으면 스냅샷을 예약합니다.
+ */
+void prototype_heatmap_add (PrototypeHeatmap * heatmap, guint source_id,
+    const PrototypeHeatmapBox * boxes, guint num_boxes, GstClockTime ts);
+
+/**
+ * @brief  소스의 격자를 다음 add()에서 비우도록 표시합니다.
+ *         다른 스레드에서 호출해도 됩니다.
+ */
+void prototype_heatmap_remove_source (PrototypeHeatmap * heatmap,
+    guint source_id);
+
+/**
+ * @brief  ts 시점으로 감쇠한 셀 값(관측 수 단위)을 values에 씁니다.
+ *         add()와 같은 스레드에서 호출합니다.
+ * @param  values [OUT] grid-width * grid-height 개
+ * @return 소스가 없으면 FALSE
+ */
+gboolean prototype_heatmap_read (PrototypeHeatmap * heatmap, guint source_id,
+    GstClockTime ts, gfloat * values);
+
+/**
+ * @brief  16비트 그레이스케일 PNG를 씁니다. comment는 tEXt 청크로 넣습니다.
+ */
+gboolean prototype_heatmap_write_png (const gchar * path,
+    const guint16 * pixels, guint width, guint height, const gchar * comment,
+    GError ** error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "prototype_interval_control.h"
+
+/** target-fps가 0일 때 학습한 목표 FPS가 주기마다 줄어드는 비율 */
+#define INTERVAL_CONTROL_NOMINAL_DECAY (0.995)
+/** 지연이 예산의 이 비율 미만이어야 interval을 내립니다. */
+#define INTERVAL_CONTROL_LOWER_LATENCY_RATIO (0.6)
+/** 내림이 실패할 때마다 두 배가 되는 lower-after 배수의 상한 */
+#define INTERVAL_CONTROL_MAX_HOLD_FACTOR (8)
+
+struct _PrototypeIntervalControl
+{
+  PrototypeIntervalControlConfig config;
+  guint interval;
+
+  /** source_id로 인덱싱한 가중치. 범위 밖 소스는 1입니다. */
+  gdouble *weights;
+  guint num_weights;
+  /** source_id로 인덱싱한 목표 FPS */
+  GArray *nominal_fps;
+
+  GMutex latency_lock;
+  gdouble latency_sum;
+  guint64 latency_count;
+  gdouble last_latency;
+  gdouble prev_latency;
+
+  guint overload_count;
+  guint healthy_count;
+  /**
+   * interval 값별 내림 대기 배수 (max-interval + 1개). 그 값으로 내린 뒤
+   * 여유가 확인되기 전에 과부하로 다시 올리면 두 배가 되고, 확인되면 1로
+   * 돌아갑니다.
+   */
+  guint *level_hold;
+  /**
+   * 마지막 내림 이후 여유였던 주기 수. lower-after를 넘으면 내림이 확인된
+   * 것이며, 확인할 내림이 없으면 G_MAXUINT입니다. 두 문턱 사이의 주기는
+   * 세지 않으므로, 지연이 천천히 쌓여 늦게 과부하가 되어도 실패로 셉니다.
+   */
+  guint probe_healthy;
+};
+
+PrototypeIntervalControl *
+prototype_interval_control_new (PrototypeIntervalControlConfig * config,
+    guint initial_interval)
+{
+  PrototypeIntervalControl *control = NULL;
+  guint i;
+
+  if (!config->enable)
+    return NULL;
+
+  control = g_new0 (PrototypeIntervalControl, 1);
+  control->config = *config;
+  control->config.max_interval = MAX (config->max_interval,
+      config->min_interval);
+  control->config.raise_after = MAX (config->raise_after, 1);
+  control->config.lower_after = MAX (config->lower_after, 1);
+  control->interval = CLAMP (initial_interval, control->config.min_interval,
+      control->config.max_interval);
+
+  for (i = 0; i < config->num_weights; i++)
+    control->num_weights = MAX (control->num_weights,
+        config->weight_source_ids[i] + 1);
+  control->weights = g_new (gdouble, control->num_weights + 1);
+  for (i = 0; i < control->num_weights; i++)
+    control->weights[i] = 1;
+  for (i = 0; i < config->num_weights; i++)
+    control->weights[config->weight_source_ids[i]] = config->weights[i];
+  /* config의 배열은 파서가 소유하므로 복사본만 씁니다. */
+  control->config.weight_source_ids = NULL;
+  control->config.weights = NULL;
+
+  control->nominal_fps = g_array_new (FALSE, TRUE, sizeof (gdouble));
+  g_mutex_init (&control->latency_lock);
+  control->level_hold = g_new (guint, control->config.max_interval + 1);
+  for (i = 0; i <= control->config.max_interval; i++)
+    control->level_hold[i] = 1;
+  control->probe_healthy = G_MAXUINT;
+
+  return control;
+}
+
+void
+prototype_interval_control_free (PrototypeIntervalControl * control)
+{
+  if (!control)
+    return;
+
+  g_array_free (control->nominal_fps, TRUE);
+  g_mutex_clear (&control->latency_lock);
+  g_free (control->level_hold);
+  g_free (control->weights);
+  g_free (control);
+}
+
+void
+prototype_interval_control_record_latency (PrototypeIntervalControl *
+    control, gdouble latency_ms)
+{
+  g_mutex_lock (&control->latency_lock);
+  control->latency_sum += latency_ms;
+  control->latency_count++;
+  g_mutex_unlock (&control->latency_lock);
+}
+
+static inline gdouble
+source_weight (PrototypeIntervalControl * control, guint source_id)
+{
+  return source_id < control->num_weights ? control->weights[source_id] : 1;
+}
+
+PrototypeIntervalDecision
+prototype_interval_control_update (PrototypeIntervalControl * control,
+    const gdouble * fps, guint num_sources, guint * interval)
+{
+  PrototypeIntervalControlConfig *config = &control->config;
+  PrototypeIntervalDecision decision = PROTOTYPE_INTERVAL_HOLD;
+  gdouble latency = 0, behind_weight = 0;
+  gboolean all_healthy = TRUE;
+  gboolean latency_over, overloaded, healthy;
+  guint i;
+
+  g_mutex_lock (&control->latency_lock);
+  if (control->latency_count)
+    latency = control->latency_sum / control->latency_count;
+  control->latency_sum = 0;
+  control->latency_count = 0;
+  g_mutex_unlock (&control->latency_lock);
+  control->prev_latency = control->last_latency;
+  control->last_latency = latency;
+
+  if (control->nominal_fps->len < num_sources)
+    g_array_set_size (control->nominal_fps, num_sources);
+
+  for (i = 0; i < num_sources; i++) {
+    gdouble *nominal = &g_array_index (control->nominal_fps, gdouble, i);
+    gdouble weight = source_weight (control, i);
+
+    if (fps[i] <= 0)
+      continue;
+    if (config->target_fps > 0)
+      *nominal = config->target_fps;
+    else
+      *nominal = MAX (*nominal * INTERVAL_CONTROL_NOMINAL_DECAY, fps[i]);
+
+    /* 가중치 0인 소스는 먼저 느려지도록 판단에서 뺍니다. */
+    if (weight <= 0)
+      continue;
+    if (fps[i] < config->fps_low_ratio * *nominal)
+      behind_weight += weight;
+    if (fps[i] < config->fps_high_ratio * *nominal)
+      all_healthy = FALSE;
+  }
+
+  /*
+   * 지연은 쌓인 큐가 빠지는 동안 한동안 예산 위에 머무르므로, 예산을
+   * 넘고 줄어들지 않을 때만 과부하로 봅니다 (올린 뒤의 과잉 올림 방지).
+   */
+  latency_over = config->latency_budget_ms &&
+      latency > config->latency_budget_ms &&
+      latency >= control->prev_latency;
+  overloaded = behind_weight > 0 || latency_over;
+  healthy = !overloaded && all_healthy && (!config->latency_budget_ms ||
+      latency < INTERVAL_CONTROL_LOWER_LATENCY_RATIO *
+      config->latency_budget_ms);
+
+  if (overloaded) {
+    control->healthy_count = 0;
+    if (++control->overload_count >= config->raise_after &&
+        control->interval < config->max_interval) {
+      /* 확인되지 않은 내림이면 그 값으로는 더 오래 기다립니다. */
+      if (control->probe_healthy != G_MAXUINT)
+        control->level_hold[control->interval] =
+            MIN (control->level_hold[control->interval] * 2,
+            INTERVAL_CONTROL_MAX_HOLD_FACTOR);
+      control->probe_healthy = G_MAXUINT;
+      control->interval++;
+      control->overload_count = 0;
+      decision = PROTOTYPE_INTERVAL_RAISE;
+    }
+  } else if (healthy) {
+    control->overload_count = 0;
+    if (control->probe_healthy != G_MAXUINT &&
+        ++control->probe_healthy > config->lower_after) {
+      control->level_hold[control->interval] = 1;
+      control->probe_healthy = G_MAXUINT;
+    }
+    if (control->interval > config->min_interval &&
+        ++control->healthy_count >= config->lower_after *
+        control->level_hold[control->interval - 1]) {
+      control->interval--;
+      control->healthy_count = 0;
+      control->probe_healthy = 0;
+      decision = PROTOTYPE_INTERVAL_LOWER;
+    }
+  } else {
+    /* 두 문턱 사이에서는 유지합니다. */
+    control->overload_count = 0;
+    control->healthy_count = 0;
+  }
+
+  *interval = control->interval;
+  return decision;
+}
+
+gdouble
+prototype_interval_control_last_latency (PrototypeIntervalControl * control)
+{
+  return control->last_latency;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_INTERVAL_CONTROL_H__
+#define __PROTOTYPE_INTERVAL_CONTROL_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+  // interval-control:
+  // enable: 1
+  // min-interval: 0
+  // max-interval: 4
+  // target-fps: 0
+  // fps-low-ratio: 0.9
+  // fps-high-ratio: 0.97
+  // latency-budget-ms: 500
+  // raise-after: 2
+  // lower-after: 6
+  // source-weights: 0:4;1:0
+  gboolean enable;
+  guint min_interval;
+  guint max_interval;
+  /** 소스의 목표 FPS. 0이면 소스별로 관측한 최대 FPS를 목표로 학습합니다. */
+  gdouble target_fps;
+  /** FPS가 목표의 이 비율 미만이면 그 소스는 실시간을 놓친 것입니다. */
+  gdouble fps_low_ratio;
+  /** 모든 소스가 목표의 이 비율 이상이어야 interval을 낮춥니다. */
+  gdouble fps_high_ratio;
+  /** 주기 평균 프레임 지연이 이 값을 넘으면 과부하입니다. 0이면 FPS만 봅니다. */
+  guint latency_budget_ms;
+  /** 과부하가 연속 이 횟수만큼 관측되면 interval을 1 올립니다. */
+  guint raise_after;
+  /** 여유가 연속 이 횟수만큼 관측되면 interval을 1 내립니다. */
+  guint lower_after;
+  /** 소스별 가중치 (기본 1). 0인 소스는 늦어져도 interval을 올리지 않습니다. */
+  guint num_weights;
+  guint *weight_source_ids;
+  gdouble *weights;
+} PrototypeIntervalControlConfig;
+
+typedef enum
+{
+  PROTOTYPE_INTERVAL_HOLD,
+  PROTOTYPE_INTERVAL_RAISE,
+  PROTOTYPE_INTERVAL_LOWER,
+} PrototypeIntervalDecision;
+
+/**
+ * PGIE interval 폐루프 제어기.
+ * perf 주기마다 소스별 FPS와 그 주기의 평균 프레임 지연을 받아,
+ * 가중치가 있는 소스가 실시간을 놓치거나 지연이 예산을 넘으면 interval을
+ * 올리고, 충분히 여유가 있으면 내립니다. 올림과 내림은 각각 연속 관측
+ * 횟수를 요구하며, 내린 뒤 여유가 확인되기 전에 다시 과부하가 되면 다음
+ * 내림까지의 대기를 두 배로 늘려 진동을 막습니다. GStreamer 요소와는
+ * 독립적입니다.
+ */
+typedef struct _PrototypeIntervalControl PrototypeIntervalControl;
+
+/**
+ * @param  initial_interval [IN] 현재 PGIE interval (min/max로 제한됩니다)
+ * @return 비활성 시 NULL
+ */
+PrototypeIntervalControl *prototype_interval_control_new
+    (PrototypeIntervalControlConfig * config, guint initial_interval);
+
+void prototype_interval_control_free (PrototypeIntervalControl * control);
+
+/**
+ * @brief  프레임 하나의 end-to-end 지연을 현재 주기에 더합니다.
+ *         스트리밍 스레드에서 호출해도 됩니다.
+ */
+void prototype_interval_control_record_latency (PrototypeIntervalControl *
+    control, gdouble latency_ms);
+
+/**
+ * @brief  한 주기의 관측으로 interval을 결정합니다.
+ * @param  fps [IN] source_id로 인덱싱한 FPS. 0인 소스는 비활성으로 봅니다.
+ * @param  num_sources [IN] fps 배열 길이
+ * @param  interval [OUT] 적용할 interval
+ * @return 이번 주기의 결정. HOLD가 아니면 interval이 바뀐 것입니다.
+ */
+PrototypeIntervalDecision prototype_interval_control_update
+    (PrototypeIntervalControl * control, const gdouble * fps,
+    guint num_sources, guint * interval);
+
+/**
+ * @brief  마지막 update()에서 쓴 주기 평균 지연 (ms). 측정값이 없으면 0
+ */
+gdouble prototype_interval_control_last_latency (PrototypeIntervalControl *
+    control);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
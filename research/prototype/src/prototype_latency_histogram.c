@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "prototype_latency_histogram.h"
+
+struct _LatencyHistogram
+{
+  guint64 highest_trackable_value;
+  gint sub_bucket_half_count_magnitude;
+  gint sub_bucket_half_count;
+  gint sub_bucket_count;
+  guint64 sub_bucket_mask;
+  gint bucket_count;
+  gint counts_len;
+  guint64 total_count;
+  guint64 max_value;
+  guint32 *counts;
+};
+
+LatencyHistogram *
+latency_histogram_new (guint64 highest_trackable_value,
+    guint significant_figures)
+{
+  LatencyHistogram *hist = NULL;
+  guint64 largest_single_unit_value = 0;
+  guint64 smallest_untrackable_value = 0;
+  gint sub_bucket_count_magnitude = 0;
+  gint buckets_needed = 1;
+
+  if (significant_figures < 1 || significant_figures > 5 ||
+      highest_trackable_value < 2) {
+    g_printerr ("latency-histogram: invalid range %" G_GUINT64_FORMAT
+        " / %u\n", highest_trackable_value, significant_figures);
+    return NULL;
+  }
+
+  /* 1 단위 해상도로 표현해야 하는 최대 값 (2 * 10^유효숫자) 만큼의
+   * 서브 버킷을 두고, 이후 버킷은 해상도를 2배씩 낮춰가며 범위를 넓힙니다. */
+  largest_single_unit_value = 2 * (guint64) pow (10, significant_figures);
+  sub_bucket_count_magnitude =
+      (gint) ceil (log2 ((gdouble) largest_single_unit_value));
+
+  hist = g_new0 (LatencyHistogram, 1);
+  hist->highest_trackable_value = highest_trackable_value;
+  hist->sub_bucket_half_count_magnitude =
+      MAX (sub_bucket_count_magnitude, 1) - 1;
+  hist->sub_bucket_count = 1 << (hist->sub_bucket_half_count_magnitude + 1);
+  hist->sub_bucket_half_count = hist->sub_bucket_count / 2;
+  hist->sub_bucket_mask = (guint64) hist->sub_bucket_count - 1;
+
+  smallest_untrackable_value = (guint64) hist->sub_bucket_count;
+  while (smallest_untrackable_value <= highest_trackable_value) {
+    if (smallest_untrackable_value > G_MAXUINT64 / 2) {
+      buckets_needed++;
+      break;
+    }
+    smallest_untrackable_value <<= 1;
+    buckets_needed++;
+  }
+  hist->bucket_count = buckets_needed;
+  hist->counts_len = (buckets_needed + 1) * hist->sub_bucket_half_count;
+  hist->counts = g_new0 (guint32, hist->counts_len);
+
+  return hist;
+}
+
+void
+latency_histogram_free (LatencyHistogram * hist)
+{
+  if (!hist)
+    return;
+  g_free (hist->counts);
+  g_free (hist);
+}
+
+static inline gint
+get_bucket_index (LatencyHistogram * hist, guint64 value)
+{
+  gint pow2ceiling = g_bit_storage (value | hist->sub_bucket_mask);
+  return pow2ceiling - (hist->sub_bucket_half_count_magnitude + 1);
+}
+
+static inline gint
+get_counts_index (LatencyHistogram * hist, gint bucket_index,
+    gint sub_bucket_index)
+{
+  return ((bucket_index + 1) << hist->sub_bucket_half_count_magnitude) +
+      (sub_bucket_index - hist->sub_bucket_half_count);
+}
+
+static guint64
+value_at_counts_index (LatencyHistogram * hist, gint index)
+{
+  gint bucket_index = (index >> hist->sub_bucket_half_count_magnitude) - 1;
+  gint sub_bucket_index =
+      (index & (hist->sub_bucket_half_count - 1)) + hist->sub_bucket_half_count;
+
+  if (bucket_index < 0) {
+    sub_bucket_index -= hist->sub_bucket_half_count;
+    bucket_index = 0;
+  }
+  return (guint64) sub_bucket_index << bucket_index;
+}
+
+static guint64
+highest_equivalent_value (LatencyHistogram * hist, guint64 value)
+{
+  gint bucket_index = get_bucket_index (hist, value);
+  gint sub_bucket_index = (gint) (value >> bucket_index);
+  gint adjusted_bucket = (sub_bucket_index >= hist->sub_bucket_count) ?
+      bucket_index + 1 : bucket_index;
+  guint64 lowest = (guint64) sub_bucket_index << bucket_index;
+
+  return lowest + ((guint64) 1 << adjusted_bucket) - 1;
+}
+
+void
+latency_histogram_record (LatencyHistogram * hist, guint64 value)
+{
+  gint bucket_index, sub_bucket_index, index;
+
+  if (value > hist->highest_trackable_value)
+    value = hist->highest_trackable_value;
+
+  bucket_index = get_bucket_index (hist, value);
+  sub_bucket_index = (gint) (value >> bucket_index);
+  index = get_counts_index (hist, bucket_index, sub_bucket_index);
+  if (index < 0 || index >= hist->counts_len)
+    return;
+
+  if (hist->counts[index] < G_MAXUINT32)
+    hist->counts[index]++;
+  hist->total_count++;
+  if (value > hist->max_value)
+    hist->max_value = value;
+}
+
+void
+latency_histogram_reset (LatencyHistogram * hist)
+{
+  memset (hist->counts, 0, hist->counts_len * sizeof (guint32));
+  hist->total_count = 0;
+  hist->max_value = 0;
+}
+
+guint64
+latency_histogram_count (LatencyHistogram * hist)
+{
+  return hist->total_count;
+}
+
+guint64
+latency_histogram_max (LatencyHistogram * hist)
+{
+  return hist->max_value;
+}
+
+guint64
+latency_histogram_value_at_percentile (LatencyHistogram * hist,
+    gdouble percentile)
+{
+  guint64 count_at_percentile = 0;
+  guint64 total = 0;
+  gint i;
+
+  if (hist->total_count == 0)
+    return 0;
+
+  percentile = CLAMP (percentile, 0.0, 100.0);
+  count_at_percentile =
+      (guint64) ceil (percentile / 100.0 * (gdouble) hist->total_count);
+  if (count_at_percentile < 1)
+    count_at_percentile = 1;
+
+  for (i = 0; i < hist->counts_len; i++) {
+    total += hist->counts[i];
+    if (total >= count_at_percentile) {
+      guint64 value =
+          highest_equivalent_value (hist, value_at_counts_index (hist, i));
+      return MIN (value, hist->max_value);
+    }
+  }
+  return hist->max_value;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_LATENCY_HISTOGRAM_H__
+#define __PROTOTYPE_LATENCY_HISTOGRAM_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * HDR(High Dynamic Range) 방식의 로그-선형 지연 히스토그램입니다.
+ * 기록은 O(1)이며 샘플을 저장하지 않으므로 메모리 사용량이 고정됩니다.
+ * 값의 단위는 마이크로초입니다.
+ */
+typedef struct _LatencyHistogram LatencyHistogram;
+
+LatencyHistogram *latency_histogram_new (guint64 highest_trackable_value,
+    guint significant_figures);
+void latency_histogram_free (LatencyHistogram * hist);
+void latency_histogram_record (LatencyHistogram * hist, guint64 value);
+void latency_histogram_reset (LatencyHistogram * hist);
+guint64 latency_histogram_count (LatencyHistogram * hist);
+guint64 latency_histogram_max (LatencyHistogram * hist);
+guint64 latency_histogram_value_at_percentile (LatencyHistogram * hist,
+    gdouble percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "civetweb.h"
+#include "deepstream_common.h"
+#include "prototype_latency_stats.h"
+
+#define LATENCY_STATS_HTTP_URI "/latency"
+#define LATENCY_STATS_CSV_HEADER \
+    "timestamp,scope,key,count,p50_ms,p90_ms,p99_ms,max_ms\n"
+
+////////////////////////////////////////////////////////////////
+// LatencyStats
+
+typedef struct
+{
+  /** "source" 또는 "component" */
+  const gchar *scope;
+  gchar *key;
+  /** 프로브가 기록하는 히스토그램 */
+  LatencyHistogram *active;
+  /** 내보내기 시 active와 교체되는 히스토그램 */
+  LatencyHistogram *spare;
+} LatencyStatsEntry;
+
+struct _LatencyStats
+{
+  LatencyStatsConfig config;
+
+  /** active 히스토그램과 엔트리 테이블을 보호합니다. */
+  GMutex lock;
+  /** source_id로 인덱싱되는 LatencyStatsEntry 배열 (프레임 지연) */
+  GPtrArray *source_entries;
+  /** "source_id/component_name" -> LatencyStatsEntry (소스별 컴포넌트 지연) */
+  GHashTable *component_entries;
+
+  guint timeout_id;
+  FILE *csv_file;
+
+  /** HTTP 응답용으로 보관하는 마지막 구간의 CSV 스냅샷 */
+  GMutex report_lock;
+  gchar *last_report;
+  struct mg_context *http_ctx;
+};
+
+static LatencyStatsEntry *
+latency_stats_entry_new (const gchar * scope, const gchar * key)
+{
+  LatencyStatsEntry *entry = g_new0 (LatencyStatsEntry, 1);
+  entry->scope = scope;
+  entry->key = g_strdup (key);
+  entry->active = latency_histogram_new (LATENCY_STATS_MAX_TRACKABLE_US,
+      LATENCY_STATS_SIGNIFICANT_FIGURES);
+  entry->spare = latency_histogram_new (LATENCY_STATS_MAX_TRACKABLE_US,
+      LATENCY_STATS_SIGNIFICANT_FIGURES);
+  return entry;
+}
+
+static void
+latency_stats_entry_free (gpointer data)
+{
+  LatencyStatsEntry *entry = (LatencyStatsEntry *) data;
+  if (!entry)
+    return;
+  latency_histogram_free (entry->active);
+  latency_histogram_free (entry->spare);
+  g_free (entry->key);
+  g_free (entry);
+}
+
+static inline guint64
+latency_ms_to_us (gdouble latency_ms)
+{
+  if (latency_ms <= 0 || isnan (latency_ms))
+    return 0;
+  return (guint64) (latency_ms * 1000.0 + 0.5);
+}
+
+void
+latency_stats_record_frames (LatencyStats * stats,
+    NvDsFrameLatencyInfo * latency_info, guint num_sources_in_batch)
+{
+  guint i;
+
+  if (!stats || !latency_info)
+    return;
+
+  g_mutex_lock (&stats->lock);
+  for (i = 0; i < num_sources_in_batch; i++) {
+    guint source_id = latency_info[i].source_id;
+    LatencyStatsEntry *entry = NULL;
+
+    if (source_id >= stats->source_entries->len)
+      g_ptr_array_set_size (stats->source_entries, source_id + 1);
+
+    entry = (LatencyStatsEntry *)
+        g_ptr_array_index (stats->source_entries, source_id);
+    if (!entry) {
+      gchar key[16];
+      g_snprintf (key, sizeof (key), "%u", source_id);
+      entry = latency_stats_entry_new ("source", key);
+      g_ptr_array_index (stats->source_entries, source_id) = entry;
+    }
+    latency_histogram_record (entry->active,
+        latency_ms_to_us (latency_info[i].latency));
+  }
+  g_mutex_unlock (&stats->lock);
+}
+
+void
+latency_stats_record_components (LatencyStats * stats,
+    NvDsBatchMeta * batch_meta)
+{
+  NvDsMetaList *l_user = NULL;
+
+  if (!stats || !batch_meta)
+    return;
+
+  g_mutex_lock (&stats->lock);
+  for (l_user = batch_meta->batch_user_meta_list; l_user != NULL;
+      l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+    NvDsMetaCompLatency *comp = NULL;
+    LatencyStatsEntry *entry = NULL;
+    gchar key[16 + MAX_COMPONENT_LEN];
+
+    if (user_meta->base_meta.meta_type != NVDS_LATENCY_MEASUREMENT_META)
+      continue;
+
+    comp = (NvDsMetaCompLatency *) user_meta->user_meta_data;
+    if (!comp || comp->component_name[0] == '\0')
+      continue;
+
+    /* 같은 컴포넌트라도 소스마다 지연이 다르므로 (source_id, 이름)으로 나눕니다. */
+    g_snprintf (key, sizeof (key), "%u/%.*s", comp->source_id,
+        MAX_COMPONENT_LEN, comp->component_name);
+    entry = (LatencyStatsEntry *)
+        g_hash_table_lookup (stats->component_entries, key);
+    if (!entry) {
+      entry = latency_stats_entry_new ("component", key);
+      g_hash_table_insert (stats->component_entries, entry->key, entry);
+    }
+    latency_histogram_record (entry->active,
+        latency_ms_to_us (comp->out_system_timestamp -
+            comp->in_system_timestamp));
+  }
+  g_mutex_unlock (&stats->lock);
+}
+
+/* active/spare를 교체하여 기록 경로가 백분위 계산을 기다리지 않도록 합니다. */
+static void
+swap_entry (LatencyStatsEntry * entry)
+{
+  LatencyHistogram *tmp = entry->active;
+  entry->active = entry->spare;
+  entry->spare = tmp;
+}
+
+static void
+append_entry_report (LatencyStatsEntry * entry, const gchar * timestamp,
+    GString * csv, GString * text)
+{
+  LatencyHistogram *hist = entry->spare;
+  guint64 count = latency_histogram_count (hist);
+
+  if (count > 0) {
+    gdouble p50 = latency_histogram_value_at_percentile (hist, 50.0) / 1000.0;
+    gdouble p90 = latency_histogram_value_at_percentile (hist, 90.0) / 1000.0;
+    gdouble p99 = latency_histogram_value_at_percentile (hist, 99.0) / 1000.0;
+    gdouble max = latency_histogram_max (hist) / 1000.0;
+
+    g_string_append_printf (csv, "%s,%s,%s,%" G_GUINT64_FORMAT ",%.3f,%.3f,%.3f,%.3f\n",
+        timestamp, entry->scope, entry->key, count, p50, p90, p99, max);
+    g_string_append_printf (text,
+        "%-9s %-24s %8" G_GUINT64_FORMAT " %10.3f %10.3f %10.3f %10.3f\n",
+        entry->scope, entry->key, count, p50, p90, p99, max);
+  }
+  latency_histogram_reset (hist);
+}
+
+void
+latency_stats_flush (LatencyStats * stats)
+{
+  GPtrArray *snapshot = NULL;
+  GHashTableIter iter;
+  gpointer value = NULL;
+  GString *csv = NULL;
+  GString *text = NULL;
+  gchar timestamp[32];
+  time_t now = time (NULL);
+  struct tm tm_now;
+  guint i;
+
+  if (!stats)
+    return;
+
+  gmtime_r (&now, &tm_now);
+  strftime (timestamp, sizeof (timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm_now);
+
+  /* 잠금 구간에서는 포인터 교체만 수행합니다. */
+  snapshot = g_ptr_array_new ();
+  g_mutex_lock (&stats->lock);
+  for (i = 0; i < stats->source_entries->len; i++) {
+    LatencyStatsEntry *entry = (LatencyStatsEntry *)
+        g_ptr_array_index (stats->source_entries, i);
+    if (entry) {
+      swap_entry (entry);
+      g_ptr_array_add (snapshot, entry);
+    }
+  }
+  g_hash_table_iter_init (&iter, stats->component_entries);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    swap_entry ((LatencyStatsEntry *) value);
+    g_ptr_array_add (snapshot, value);
+  }
+  g_mutex_unlock (&stats->lock);
+
+  csv = g_string_new (NULL);
+  text = g_string_new (NULL);
+  for (i = 0; i < snapshot->len; i++) {
+    append_entry_report ((LatencyStatsEntry *)
+        g_ptr_array_index (snapshot, i), timestamp, csv, text);
+  }
+  g_ptr_array_free (snapshot, TRUE);
+
+  if (stats->config.print_stdout && text->len > 0) {
+    g_print ("\n**LATENCY(ms) %s (interval %us)\n", timestamp,
+        stats->config.interval_sec);
+    g_print ("%-9s %-24s %8s %10s %10s %10s %10s\n", "scope", "key",
+        "count", "p50", "p90", "p99", "max");
+    g_print ("%s", text->str);
+  }
+
+  if (stats->csv_file && csv->len > 0) {
+    fputs (csv->str, stats->csv_file);
+    fflush (stats->csv_file);
+  }
+
+  g_mutex_lock (&stats->report_lock);
+  g_free (stats->last_report);
+  stats->last_report = g_strconcat (LATENCY_STATS_CSV_HEADER, csv->str, NULL);
+  g_mutex_unlock (&stats->report_lock);
+
+  g_string_free (csv, TRUE);
+  g_string_free (text, TRUE);
+}
+
+static gboolean
+latency_stats_timeout_cb (gpointer user_data)
+{
+  latency_stats_flush ((LatencyStats *) user_data);
+  return G_SOURCE_CONTINUE;
+}
+
+static int
+latency_stats_http_handler (struct mg_connection *conn, void *cbdata)
+{
+  LatencyStats *stats = (LatencyStats *) cbdata;
+  gchar *report = NULL;
+  size_t len = 0;
+
+  g_mutex_lock (&stats->report_lock);
+  report = g_strdup (stats->last_report ? stats->last_report :
+      LATENCY_STATS_CSV_HEADER);
+  g_mutex_unlock (&stats->report_lock);
+
+  len = strlen (report);
+  mg_send_http_ok (conn, "text/csv", (long long) len);
+  mg_write (conn, report, len);
+  g_free (report);
+
+  return 200;
+}
+
+static gboolean
+start_http_server (LatencyStats * stats)
+{
+  gboolean ret = FALSE;
+  gchar port[16];
+  const char *options[] = {
+    "listening_ports", port,
+    "num_threads", "1",
+    NULL
+  };
+  struct mg_callbacks callbacks;
+
+  g_snprintf (port, sizeof (port), "%u", stats->config.http_port);
+  memset (&callbacks, 0, sizeof (callbacks));
+
+  mg_init_library (0);
+  stats->http_ctx = mg_start (&callbacks, NULL, options);
+  if (!stats->http_ctx) {
+    NVGSTDS_ERR_MSG_V ("Failed to start latency http server on port %s", port);
+    goto done;
+  }
+  mg_set_request_handler (stats->http_ctx, LATENCY_STATS_HTTP_URI,
+      latency_stats_http_handler, stats);
+  g_print ("Latency stats available at http://0.0.0.0:%s%s\n", port,
+      LATENCY_STATS_HTTP_URI);
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    mg_exit_library ();
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
+LatencyStats *
+latency_stats_new (LatencyStatsConfig * config)
+{
+  gboolean ret = FALSE;
+  LatencyStats *stats = NULL;
+
+  if (!config || !config->enable)
+    return NULL;
+
+  stats = g_new0 (LatencyStats, 1);
+  stats->config = *config;
+  stats->config.csv_file_path = g_strdup (config->csv_file_path);
+  if (stats->config.interval_sec == 0)
+    stats->config.interval_sec = 10;
+
+  g_mutex_init (&stats->lock);
+  g_mutex_init (&stats->report_lock);
+  stats->source_entries =
+      g_ptr_array_new_with_free_func (latency_stats_entry_free);
+  stats->component_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, latency_stats_entry_free);
+
+  if (stats->config.csv_file_path) {
+    stats->csv_file = fopen (stats->config.csv_file_path, "a");
+    if (!stats->csv_file) {
+      NVGSTDS_ERR_MSG_V ("Failed to open latency csv file '%s'",
+          stats->config.csv_file_path);
+      goto done;
+    }
+    if (ftell (stats->csv_file) == 0) {
+      fputs (LATENCY_STATS_CSV_HEADER, stats->csv_file);
+    }
+  }
+
+  if (stats->config.http_port > 0 && !start_http_server (stats)) {
+    goto done;
+  }
+
+  stats->timeout_id = g_timeout_add_seconds (stats->config.interval_sec,
+      latency_stats_timeout_cb, stats);
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+    latency_stats_destroy (stats);
+    stats = NULL;
+  }
+  return stats;
+}
+
+void
+latency_stats_destroy (LatencyStats * stats)
+{
+  if (!stats)
+    return;
+
+  if (stats->timeout_id) {
+    g_source_remove (stats->timeout_id);
+    stats->timeout_id = 0;
+    latency_stats_flush (stats);
+  }
+
+  if (stats->http_ctx) {
+    mg_stop (stats->http_ctx);
+    stats->http_ctx = NULL;
+    mg_exit_library ();
+  }
+
+  if (stats->csv_file) {
+    fclose (stats->csv_file);
+    stats->csv_file = NULL;
+  }
+
+  g_ptr_array_free (stats->source_entries, TRUE);
+  g_hash_table_destroy (stats->component_entries);
+  g_mutex_clear (&stats->lock);
+  g_mutex_clear (&stats->report_lock);
+  g_free (stats->last_report);
+  g_free (stats->config.csv_file_path);
+  g_free (stats);
+}
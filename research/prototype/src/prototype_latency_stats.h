@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_LATENCY_STATS_H__
+#define __PROTOTYPE_LATENCY_STATS_H__
+
+#include <gst/gst.h>
+
+#include "nvdsmeta.h"
+#include "nvds_latency_meta.h"
+#include "prototype_latency_histogram.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 프레임(end-to-end) 지연 히스토그램에 사용하는 컴포넌트 이름 */
+#define LATENCY_STATS_FRAME_COMPONENT "frame"
+
+/** 히스토그램이 추적하는 최대 지연 값 (us). 초과 값은 이 값으로 기록됩니다. */
+#define LATENCY_STATS_MAX_TRACKABLE_US (60 * G_USEC_PER_SEC)
+
+/** 유효 숫자 자릿수. 2이면 기록된 값의 상대 오차가 1% 이내입니다. */
+#define LATENCY_STATS_SIGNIFICANT_FIGURES (2)
+
+typedef struct
+{
+  // latency-stats:
+  // enable: 1
+  // interval-sec: 10
+  // print-stdout: 1
+  // csv-file: latency_stats.csv
+  // http-port: 9100
+  gboolean enable;
+  guint interval_sec;
+  gboolean print_stdout;
+  gchar *csv_file_path;
+  guint http_port;
+} LatencyStatsConfig;
+
+/**
+ * 소스별 프레임 지연과 컴포넌트별 지연 히스토그램을 모아
+ * interval-sec 마다 p50/p90/p99/max를 stdout, CSV 파일, HTTP로 내보냅니다.
+ * 기록 함수는 스트리밍 스레드(프로브)에서 호출됩니다.
+ */
+typedef struct _LatencyStats LatencyStats;
+
+/**
+ * @brief  지연 통계 수집기를 생성하고 주기적 내보내기를 시작합니다.
+ *         프레임 지연 메타는 NVDS_ENABLE_LATENCY_MEASUREMENT가 설정된 경우에만
+ *         채워지므로, 호출하는 쪽이 gst_init 전에 설정해야 합니다.
+ * @param  config [IN] latency-stats 그룹 설정
+ * @return 성공 시 LatencyStats 포인터; 실패 또는 비활성 시 NULL
+ */
+LatencyStats *latency_stats_new (LatencyStatsConfig * config);
+
+/**
+ * @brief  nvds_measure_buffer_latency()의 결과를 소스별 히스토그램에 기록합니다.
+ */
+void latency_stats_record_frames (LatencyStats * stats,
+    NvDsFrameLatencyInfo * latency_info, guint num_sources_in_batch);
+
+/**
+ * @brief  배치 메타에 부착된 NVDS_LATENCY_MEASUREMENT_META(컴포넌트 지연)를
+ *         (source_id, 컴포넌트) 히스토그램에 기록합니다. 키는 "source_id/이름"입니다.
+ *         컴포넌트 지연 측정(NVDS_ENABLE_COMPONENT_LATENCY_MEASUREMENT)이
+ *         켜져 있을 때만 메타가 존재합니다.
+ */
+void latency_stats_record_components (LatencyStats * stats,
+    NvDsBatchMeta * batch_meta);
+
+/**
+ * @brief  현재 구간의 통계를 즉시 내보내고 히스토그램을 초기화합니다.
+ */
+void latency_stats_flush (LatencyStats * stats);
+
+/**
+ * @brief  내보내기를 중단하고 마지막 구간을 flush한 뒤 자원을 해제합니다.
+ */
+void latency_stats_destroy (LatencyStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
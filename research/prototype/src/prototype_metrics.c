@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "civetweb.h"
+#include "deepstream_common.h"
+#include "deepstream_publish_queue.h"
+#include "prototype_metrics.h"
+#include "prototype_source_table.h"
+
+#define PROTOTYPE_METRICS_HTTP_URI "/metrics"
+#define PROTOTYPE_METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *type;
+  const gchar *help;
+} PrototypeMetricDesc;
+
+static const PrototypeMetricDesc source_metric_desc[PROTOTYPE_METRIC_SOURCE_NUM] = {
+  {"prototype_source_fps", "gauge",
+      "Frames per second of the source over the last perf interval."},
+  {"prototype_source_frames_total", "counter",
+      "Frames of the source that reached the analytics probe."},
+  {"prototype_source_frames_dropped_total", "counter",
+      "Frames missing from the per-source frame number sequence."},
+  {"prototype_source_rtsp_reconnects_total", "counter",
+      "RTSP source pipeline resets."},
+  {"prototype_source_event_metas_total", "counter",
+      "NvDsEventMsgMeta attached for the source."},
+  {"prototype_source_frames_gated_total", "counter",
+      "Frames dropped before streammux by motion-gate."},
+  {"prototype_source_frames_unscheduled_total", "counter",
+      "Frames dropped before streammux by frame-scheduler."},
+};
+
+static const PrototypeMetricDesc instance_metric_desc[PROTOTYPE_METRIC_INSTANCE_NUM] = {
+  {"prototype_pgie_interval", "gauge",
+      "Primary GIE interval set by interval-control."},
+  {"prototype_streammux_batched_push_timeout_us", "gauge",
+      "batched-push-timeout of streammux in microseconds."},
+  {"prototype_streammux_batches_total", "counter",
+      "Batches pushed by streammux."},
+  {"prototype_streammux_batch_frames_total", "counter",
+      "Frames in the batches pushed by streammux."},
+  {"prototype_streammux_batch_fill", "gauge",
+      "Mean batch fill over the last adaptive batched-push-timeout update."},
+  {"prototype_display_active", "gauge",
+      "1 while the display-gate lets frames into the tiler/OSD branch."},
+  {"prototype_display_frames_dropped_total", "counter",
+      "Frames dropped before the tiler while the display-gate was closed."},
+};
+
+static const PrototypeMetricDesc global_metric_desc[PROTOTYPE_METRIC_GLOBAL_NUM] = {
+  {"prototype_msgbroker_publish_failures_total", "counter",
+      "Errors and warnings posted by nvmsgbroker."},
+};
+
+/**
+ * 소스 하나의 값들. 슬롯은 PrototypeSourceTable이 캐시 라인 단위로 할당하므로
+ * 소스 간 false sharing이 없습니다.
+ */
+typedef struct
+{
+  guint64 values[PROTOTYPE_METRIC_SOURCE_NUM];
+  /** 마지막으로 관측한 frame_num + 1 (0이면 아직 관측 전) */
+  guint64 next_frame_num;
+} PrototypeSourceMetricSlot;
+
+/**
+ * 인스턴스 하나의 값들. 인스턴스마다 스트리밍 스레드가 다르므로 캐시 라인에
+ * 정렬해 false sharing을 피합니다.
+ */
+typedef struct
+{
+  guint64 values[PROTOTYPE_METRIC_INSTANCE_NUM];
+  /** 한 번이라도 기록되면 1. 기록된 인스턴스만 노출합니다. */
+  gint used;
+} __attribute__ ((aligned (PROTOTYPE_SOURCE_TABLE_CACHE_LINE)))
+    PrototypeInstanceMetricSlot;
+
+/** 인스턴스별 소스 테이블. 첫 기록에서 만들어지며 프로세스 종료까지 유지됩니다. */
+static PrototypeSourceTable *source_tables[PROTOTYPE_METRICS_MAX_INSTANCES];
+static GMutex source_tables_lock;
+static PrototypeInstanceMetricSlot
+    instance_slots[PROTOTYPE_METRICS_MAX_INSTANCES];
+static guint64 global_values[PROTOTYPE_METRIC_GLOBAL_NUM];
+
+static struct mg_context *metrics_http_ctx = NULL;
+static PrototypeMetricsCollectFunc metrics_collect_func = NULL;
+static gpointer metrics_collect_data = NULL;
+
+static PrototypeSourceTable *
+get_source_table (guint instance)
+{
+  PrototypeSourceTable *table = NULL;
+
+  if (instance >= PROTOTYPE_METRICS_MAX_INSTANCES)
+    return NULL;
+
+  table = (PrototypeSourceTable *) g_atomic_pointer_get (
+      &source_tables[instance]);
+  if (table)
+    return table;
+
+  g_mutex_lock (&source_tables_lock);
+  table = source_tables[instance];
+  if (!table) {
+    table = prototype_source_table_new (sizeof (PrototypeSourceMetricSlot),
+        NULL, NULL);
+    g_atomic_pointer_set (&source_tables[instance], table);
+  }
+  g_mutex_unlock (&source_tables_lock);
+  return table;
+}
+
+static inline PrototypeSourceMetricSlot *
+get_source_slot (guint instance, guint source_id)
+{
+  PrototypeSourceTable *table = get_source_table (instance);
+
+  /* 이미 있는 슬롯은 잠금 없이 찾고, 처음 기록될 때만 잠그고 만듭니다. */
+  if (!table)
+    return NULL;
+  return (PrototypeSourceMetricSlot *) prototype_source_table_get (table,
+      source_id);
+}
+
+void
+prototype_metrics_source_add (guint instance, guint source_id,
+    PrototypeSourceMetric metric, guint64 value)
+{
+  PrototypeSourceMetricSlot *slot = NULL;
+
+  if (metric >= PROTOTYPE_METRIC_SOURCE_NUM)
+    return;
+
+  slot = get_source_slot (instance, source_id);
+  if (slot)
+    __atomic_fetch_add (&slot->values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_source_set (guint instance, guint source_id,
+    PrototypeSourceMetric metric, guint64 value)
+{
+  PrototypeSourceMetricSlot *slot = NULL;
+
+  if (metric >= PROTOTYPE_METRIC_SOURCE_NUM)
+    return;
+
+  slot = get_source_slot (instance, source_id);
+  if (slot)
+    __atomic_store_n (&slot->values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_source_set_gauge (guint instance, guint source_id,
+    PrototypeSourceMetric metric, gdouble value)
+{
+  guint64 bits = 0;
+
+  G_STATIC_ASSERT (sizeof (bits) == sizeof (value));
+  memcpy (&bits, &value, sizeof (bits));
+  prototype_metrics_source_set (instance, source_id, metric, bits);
+}
+
+static inline PrototypeInstanceMetricSlot *
+get_instance_slot (guint instance, PrototypeInstanceMetric metric)
+{
+  PrototypeInstanceMetricSlot *slot = NULL;
+
+  if (instance >= PROTOTYPE_METRICS_MAX_INSTANCES ||
+      metric >= PROTOTYPE_METRIC_INSTANCE_NUM)
+    return NULL;
+
+  slot = &instance_slots[instance];
+  if (!g_atomic_int_get (&slot->used))
+    g_atomic_int_set (&slot->used, 1);
+  return slot;
+}
+
+void
+prototype_metrics_instance_add (guint instance,
+    PrototypeInstanceMetric metric, guint64 value)
+{
+  PrototypeInstanceMetricSlot *slot = get_instance_slot (instance, metric);
+
+  if (slot)
+    __atomic_fetch_add (&slot->values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_instance_set (guint instance,
+    PrototypeInstanceMetric metric, guint64 value)
+{
+  PrototypeInstanceMetricSlot *slot = get_instance_slot (instance, metric);
+
+  if (slot)
+    __atomic_store_n (&slot->values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_instance_set_gauge (guint instance,
+    PrototypeInstanceMetric metric, gdouble value)
+{
+  guint64 bits = 0;
+
+  memcpy (&bits, &value, sizeof (bits));
+  prototype_metrics_instance_set (instance, metric, bits);
+}
+
+void
+prototype_metrics_add (PrototypeGlobalMetric metric, guint64 value)
+{
+  if (metric < PROTOTYPE_METRIC_GLOBAL_NUM)
+    __atomic_fetch_add (&global_values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_set (PrototypeGlobalMetric metric, guint64 value)
+{
+  if (metric < PROTOTYPE_METRIC_GLOBAL_NUM)
+    __atomic_store_n (&global_values[metric], value, __ATOMIC_RELAXED);
+}
+
+void
+prototype_metrics_observe_frame (guint instance, guint source_id,
+    guint frame_num)
+{
+  PrototypeSourceMetricSlot *slot = get_source_slot (instance, source_id);
+  guint64 expected = 0;
+
+  if (!slot)
+    return;
+
+  __atomic_fetch_add (&slot->values[PROTOTYPE_METRIC_SOURCE_FRAMES], 1,
+      __ATOMIC_RELAXED);
+
+  expected = __atomic_exchange_n (&slot->next_frame_num,
+      (guint64) frame_num + 1, __ATOMIC_RELAXED);
+  /* frame_num이 되돌아간 경우(소스 재시작 등)는 드롭으로 보지 않습니다. */
+  if (expected > 0 && (guint64) frame_num > expected) {
+    __atomic_fetch_add (&slot->values[PROTOTYPE_METRIC_SOURCE_FRAMES_DROPPED],
+        (guint64) frame_num - expected, __ATOMIC_RELAXED);
+  }
+}
+
+void
+prototype_metrics_source_remove (guint instance, guint source_id)
+{
+  PrototypeSourceTable *table = NULL;
+
+  if (instance >= PROTOTYPE_METRICS_MAX_INSTANCES)
+    return;
+
+  /* 슬롯은 다시 추가될 때 0으로 초기화되므로 여기서는 비활성화만 합니다. */
+  table = (PrototypeSourceTable *) g_atomic_pointer_get (
+      &source_tables[instance]);
+  if (table)
+    prototype_source_table_remove (table, source_id);
+}
+
+typedef struct
+{
+  GString *out;
+  const PrototypeMetricDesc *desc;
+  guint metric;
+  guint instance;
+} PrototypeMetricsRenderCtx;
+
+static void
+render_source_slot (guint source_id, gpointer data, gpointer user_data)
+{
+  PrototypeMetricsRenderCtx *rctx = (PrototypeMetricsRenderCtx *) user_data;
+  PrototypeSourceMetricSlot *slot = (PrototypeSourceMetricSlot *) data;
+  guint64 value = __atomic_load_n (&slot->values[rctx->metric],
+      __ATOMIC_RELAXED);
+
+  if (rctx->metric == PROTOTYPE_METRIC_SOURCE_FPS) {
+    gdouble gauge = 0;
+    memcpy (&gauge, &value, sizeof (gauge));
+    g_string_append_printf (rctx->out,
+        "%s{instance=\"%u\",source_id=\"%u\"} %.3f\n", rctx->desc->name,
+        rctx->instance, source_id, gauge);
+  } else {
+    g_string_append_printf (rctx->out,
+        "%s{instance=\"%u\",source_id=\"%u\"} %lu\n", rctx->desc->name,
+        rctx->instance, source_id, value);
+  }
+}
+
+static void
+render_publish_queue_events (const NvDsPublishQueueTopicStats * stats,
+    gpointer user_data)
+{
+  GString *out = (GString *) user_data;
+  const struct
+  {
+    const gchar *result;
+    guint64 value;
+  } events[] = {
+    {"enqueued", stats->enqueued},
+    {"sent", stats->sent},
+    {"failed", stats->failed},
+    {"dropped", stats->dropped},
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (events); i++) {
+    g_string_append_printf (out,
+        "prototype_publish_queue_events_total{topic=\"%s\",result=\"%s\"} %lu\n",
+        stats->topic, events[i].result, events[i].value);
+  }
+}
+
+static void
+render_publish_queue_depth (const NvDsPublishQueueTopicStats * stats,
+    gpointer user_data)
+{
+  g_string_append_printf ((GString *) user_data,
+      "prototype_publish_queue_depth{topic=\"%s\"} %lu\n", stats->topic,
+      stats->depth);
+}
+
+gchar *
+prototype_metrics_render (void)
+{
+  GString *out = g_string_sized_new (4096);
+  guint m, i;
+
+  for (m = 0; m < PROTOTYPE_METRIC_SOURCE_NUM; m++) {
+    const PrototypeMetricDesc *desc = &source_metric_desc[m];
+
+    g_string_append_printf (out, "# HELP %s %s\n# TYPE %s %s\n",
+        desc->name, desc->help, desc->name, desc->type);
+    for (i = 0; i < PROTOTYPE_METRICS_MAX_INSTANCES; i++) {
+      PrototypeSourceTable *table = (PrototypeSourceTable *)
+          g_atomic_pointer_get (&source_tables[i]);
+      PrototypeMetricsRenderCtx rctx = { out, desc, m, i };
+
+      if (table)
+        prototype_source_table_foreach (table, render_source_slot, &rctx);
+    }
+  }
+
+  for (m = 0; m < PROTOTYPE_METRIC_INSTANCE_NUM; m++) {
+    const PrototypeMetricDesc *desc = &instance_metric_desc[m];
+
+    g_string_append_printf (out, "# HELP %s %s\n# TYPE %s %s\n",
+        desc->name, desc->help, desc->name, desc->type);
+    for (i = 0; i < PROTOTYPE_METRICS_MAX_INSTANCES; i++) {
+      PrototypeInstanceMetricSlot *slot = &instance_slots[i];
+      guint64 value;
+
+      if (!g_atomic_int_get (&slot->used))
+        continue;
+      value = __atomic_load_n (&slot->values[m], __ATOMIC_RELAXED);
+      if (m == PROTOTYPE_METRIC_STREAMMUX_BATCH_FILL ||
+          m == PROTOTYPE_METRIC_DISPLAY_ACTIVE) {
+        gdouble gauge = 0;
+        memcpy (&gauge, &value, sizeof (gauge));
+        g_string_append_printf (out, "%s{instance=\"%u\"} %.3f\n",
+            desc->name, i, gauge);
+      } else {
+        g_string_append_printf (out, "%s{instance=\"%u\"} %lu\n",
+            desc->name, i, value);
+      }
+    }
+  }
+
+  for (m = 0; m < PROTOTYPE_METRIC_GLOBAL_NUM; m++) {
+    const PrototypeMetricDesc *desc = &global_metric_desc[m];
+
+    g_string_append_printf (out, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n",
+        desc->name, desc->help, desc->name, desc->type, desc->name,
+        __atomic_load_n (&global_values[m], __ATOMIC_RELAXED));
+  }
+
+  /* sink의 publish-queue-size가 설정된 경우에만 값이 있습니다. */
+  g_string_append (out,
+      "# HELP prototype_publish_queue_events_total Events handled by the "
+      "sink publish queue.\n"
+      "# TYPE prototype_publish_queue_events_total counter\n");
+  nvds_publish_queue_foreach_stats (render_publish_queue_events, out);
+  g_string_append (out,
+      "# HELP prototype_publish_queue_depth Events queued or in flight in the "
+      "sink publish queue.\n"
+      "# TYPE prototype_publish_queue_depth gauge\n");
+  nvds_publish_queue_foreach_stats (render_publish_queue_depth, out);
+
+  return g_string_free (out, FALSE);
+}
+
+static int
+metrics_http_handler (struct mg_connection *conn, void *cbdata)
+{
+  gchar *body = NULL;
+  size_t len = 0;
+
+  if (metrics_collect_func)
+    metrics_collect_func (metrics_collect_data);
+
+  body = prototype_metrics_render ();
+  len = strlen (body);
+  mg_send_http_ok (conn, PROTOTYPE_METRICS_CONTENT_TYPE, (long long) len);
+  mg_write (conn, body, len);
+  g_free (body);
+
+  return 200;
+}
+
+gboolean
+prototype_metrics_start (PrototypeMetricsConfig * config,
+    PrototypeMetricsCollectFunc collect_func, gpointer user_data)
+{
+  gboolean ret = FALSE;
+  gchar listen[64];
+  const char *options[] = {
+    "listening_ports", listen,
+    "num_threads", "2",
+    NULL
+  };
+  struct mg_callbacks callbacks;
+
+  if (!config || !config->enable)
+    return TRUE;
+
+  if (metrics_http_ctx) {
+    NVGSTDS_WARN_MSG_V ("Metrics endpoint already started");
+    return TRUE;
+  }
+
+  /* bind-address를 지정하지 않으면 루프백에서만 수신합니다. */
+  g_snprintf (listen, sizeof (listen), "%s:%u",
+      config->bind_address ? config->bind_address : "127.0.0.1",
+      config->http_port);
+  memset (&callbacks, 0, sizeof (callbacks));
+
+  metrics_collect_func = collect_func;
+  metrics_collect_data = user_data;
+
+  mg_init_library (0);
+  metrics_http_ctx = mg_start (&callbacks, NULL, options);
+  if (!metrics_http_ctx) {
+    NVGSTDS_ERR_MSG_V ("Failed to start metrics http server on %s", listen);
+    mg_exit_library ();
+    goto done;
+  }
+  mg_set_request_handler (metrics_http_ctx, PROTOTYPE_METRICS_HTTP_URI,
+      metrics_http_handler, NULL);
+  g_print ("Metrics available at http://%s%s\n", listen,
+      PROTOTYPE_METRICS_HTTP_URI);
+
+  ret = TRUE;
+done:
+  if (!ret) {
+    metrics_collect_func = NULL;
+    metrics_collect_data = NULL;
+    NVGSTDS_ERR_MSG_V ("%s failed", __func__);
+  }
+  return ret;
+}
+
+void
+prototype_metrics_stop (void)
+{
+  if (!metrics_http_ctx)
+    return;
+
+  mg_stop (metrics_http_ctx);
+  metrics_http_ctx = NULL;
+  mg_exit_library ();
+  metrics_collect_func = NULL;
+  metrics_collect_data = NULL;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_METRICS_H__
+#define __PROTOTYPE_METRICS_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * 소스별 메트릭을 구분하는 최대 앱 인스턴스 수. 초과 instance는 무시됩니다.
+ * source_id의 상한은 PROTOTYPE_SOURCE_TABLE_MAX_ID입니다.
+ */
+#define PROTOTYPE_METRICS_MAX_INSTANCES (128)
+
+typedef struct
+{
+  // metrics:
+  // enable: 1
+  // bind-address: 127.0.0.1
+  // http-port: 9101
+  gboolean enable;
+  gchar *bind_address;
+  guint http_port;
+} PrototypeMetricsConfig;
+
+/** 소스별 메트릭. 이름/타입은 prototype_metrics.c의 테이블을 참조하세요. */
+typedef enum
+{
+  PROTOTYPE_METRIC_SOURCE_FPS,              /**< gauge */
+  PROTOTYPE_METRIC_SOURCE_FRAMES,           /**< counter */
+  PROTOTYPE_METRIC_SOURCE_FRAMES_DROPPED,   /**< counter */
+  PROTOTYPE_METRIC_SOURCE_RTSP_RECONNECTS,  /**< counter */
+  PROTOTYPE_METRIC_SOURCE_EVENT_METAS,      /**< counter */
+  PROTOTYPE_METRIC_SOURCE_FRAMES_GATED,     /**< counter */
+  PROTOTYPE_METRIC_SOURCE_FRAMES_UNSCHEDULED, /**< counter */
+  PROTOTYPE_METRIC_SOURCE_NUM
+} PrototypeSourceMetric;
+
+/** 앱 인스턴스별 메트릭. instance 레이블로 노출됩니다. */
+typedef enum
+{
+  PROTOTYPE_METRIC_PGIE_INTERVAL,               /**< gauge */
+  PROTOTYPE_METRIC_STREAMMUX_BATCHED_PUSH_TIMEOUT, /**< gauge */
+  PROTOTYPE_METRIC_STREAMMUX_BATCHES,           /**< counter */
+  PROTOTYPE_METRIC_STREAMMUX_BATCH_FRAMES,      /**< counter */
+  PROTOTYPE_METRIC_STREAMMUX_BATCH_FILL,        /**< gauge */
+  PROTOTYPE_METRIC_DISPLAY_ACTIVE,              /**< gauge */
+  PROTOTYPE_METRIC_DISPLAY_FRAMES_DROPPED,      /**< counter */
+  PROTOTYPE_METRIC_INSTANCE_NUM
+} PrototypeInstanceMetric;
+
+/** 프로세스 전역 메트릭 */
+typedef enum
+{
+  PROTOTYPE_METRIC_MSGBROKER_PUBLISH_FAILURES,  /**< counter */
+  PROTOTYPE_METRIC_GLOBAL_NUM
+} PrototypeGlobalMetric;
+
+/**
+ * 스크레이프 직전에 HTTP 스레드에서 호출되는 콜백입니다.
+ * 다른 모듈이 보관하는 값을 prototype_metrics_source_set()으로 옮길 때 사용합니다.
+ */
+typedef void (*PrototypeMetricsCollectFunc) (gpointer user_data);
+
+/**
+ * 아래 기록 함수들은 잠금 없는 슬롯 조회 뒤 원자적 연산 하나로 값을 갱신하므로
+ * 스트리밍 스레드의 프로브에서 호출해도 됩니다. (instance, source_id)의 첫
+ * 기록에서만 슬롯을 만들며 잠급니다. 소스별 메트릭은 instance와 source_id
+ * 레이블로 노출되므로 여러 인스턴스가 같은 source_id를 써도 섞이지 않습니다.
+ * HTTP 서버가 시작되지 않았어도 기록은 유효합니다.
+ */
+void prototype_metrics_source_add (guint instance, guint source_id,
+    PrototypeSourceMetric metric, guint64 value);
+void prototype_metrics_source_set (guint instance, guint source_id,
+    PrototypeSourceMetric metric, guint64 value);
+void prototype_metrics_source_set_gauge (guint instance, guint source_id,
+    PrototypeSourceMetric metric, gdouble value);
+void prototype_metrics_instance_add (guint instance,
+    PrototypeInstanceMetric metric, guint64 value);
+void prototype_metrics_instance_set (guint instance,
+    PrototypeInstanceMetric metric, guint64 value);
+void prototype_metrics_instance_set_gauge (guint instance,
+    PrototypeInstanceMetric metric, gdouble value);
+void prototype_metrics_add (PrototypeGlobalMetric metric, guint64 value);
+void prototype_metrics_set (PrototypeGlobalMetric metric, guint64 value);
+
+/**
+ * @brief  프레임 카운터를 증가시키고, frame_num이 직전 값보다 2 이상 건너뛴 경우
+ *         그 차이를 frames_dropped에 더합니다.
+ */
+void prototype_metrics_observe_frame (guint instance, guint source_id,
+    guint frame_num);
+
+/**
+ * @brief  소스가 제거되었을 때 값을 초기화하고 노출 대상에서 뺍니다.
+ *         같은 source_id로 다시 기록되면 0부터 다시 집계됩니다.
+ */
+void prototype_metrics_source_remove (guint instance, guint source_id);
+
+/**
+ * @brief  현재 값을 Prometheus 텍스트 노출 형식(0.0.4)으로 만듭니다.
+ * @return g_free()로 해제해야 하는 문자열
+ */
+gchar *prototype_metrics_render (void);
+
+/**
+ * @brief  /metrics HTTP 엔드포인트를 시작합니다.
+ * @param  config [IN] metrics 그룹 설정
+ * @param  collect_func [IN] 스크레이프마다 호출할 콜백 (NULL 가능)
+ * @param  user_data [IN] collect_func에 전달할 데이터
+ * @return 성공 또는 비활성 시 TRUE; 서버 시작 실패 시 FALSE
+ */
+gboolean prototype_metrics_start (PrototypeMetricsConfig * config,
+    PrototypeMetricsCollectFunc collect_func, gpointer user_data);
+
+void prototype_metrics_stop (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
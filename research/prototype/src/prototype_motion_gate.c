@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "nvbufsurftransform.h"
+#include "prototype_motion_gate.h"
+#include "prototype_source_table.h"
+
+typedef struct
+{
+  /** 배경 luma (8.8 고정소수점) */
+  guint16 *background;
+  /** GPU 축소 복사 대상 (GRAY8, CPU에 매핑된 상태로 유지) */
+  NvBufSurface *scaled;
+  GstClockTime last_motion_ts;
+  GstClockTime last_pass_ts;
+  gfloat score;
+  /** 정적으로 판단되어 프레임을 버리는 중이면 1 */
+  gint is_static;
+} MotionSlot;
+
+struct _PrototypeMotionGate
+{
+  PrototypeMotionGateConfig config;
+  guint gpu_id;
+  guint num_pixels;
+  GstClockTime hold_ns;
+  GstClockTime keepalive_ns;
+  PrototypeSourceTable *slots;
+};
+
+static void
+motion_slot_clear (guint source_id, gpointer data)
+{
+  MotionSlot *slot = (MotionSlot *) data;
+
+  if (slot->scaled) {
+    NvBufSurfaceUnMap (slot->scaled, 0, 0);
+    NvBufSurfaceDestroy (slot->scaled);
+  }
+  g_free (slot->background);
+  memset (slot, 0, sizeof (MotionSlot));
+}
+
+PrototypeMotionGate *
+prototype_motion_gate_new (PrototypeMotionGateConfig * config, guint gpu_id)
+{
+  PrototypeMotionGate *gate = NULL;
+
+  if (!config->enable || !config->analysis_width || !config->analysis_height)
+    return NULL;
+
+  gate = g_new0 (PrototypeMotionGate, 1);
+  gate->config = *config;
+  gate->config.learn_shift = CLAMP (config->learn_shift, 1, 8);
+  gate->gpu_id = gpu_id;
+  gate->num_pixels = config->analysis_width * config->analysis_height;
+  gate->hold_ns = (GstClockTime) config->hold_ms * GST_MSECOND;
+  gate->keepalive_ns = (GstClockTime) config->keepalive_ms * GST_MSECOND;
+  gate->slots = prototype_source_table_new (sizeof (MotionSlot), NULL,
+      motion_slot_clear);
+
+  return gate;
+}
+
+void
+prototype_motion_gate_free (PrototypeMotionGate * gate)
+{
+  if (!gate)
+    return;
+
+  prototype_source_table_free (gate->slots);
+  g_free (gate);
+}
+
+/*
+ * 변화 픽셀 비율을 구하고 배경을 갱신합니다.
+ * 조명/노출 변화로 프레임 전체가 밝아지거나 어두워지는 것은 평균 차이를
+ * 빼서 무시합니다.
+ */
+static gfloat
+update_background (PrototypeMotionGate * gate, guint16 * background,
+    const guint8 * luma, guint pitch)
+{
+  guint width = gate->config.analysis_width;
+  guint height = gate->config.analysis_height;
+  gint threshold = gate->config.pixel_threshold << 8;
+  guint shift = gate->config.learn_shift;
+  gint64 sum = 0;
+  gint mean;
+  guint changed = 0;
+  guint x, y;
+
+  for (y = 0; y < height; y++) {
+    const guint8 *row = luma + (gsize) y * pitch;
+    const guint16 *bg = background + (gsize) y * width;
+
+    for (x = 0; x < width; x++)
+      sum += ((gint) row[x] << 8) - bg[x];
+  }
+  mean = (gint) (sum / gate->num_pixels);
+
+  for (y = 0; y < height; y++) {
+    const guint8 *row = luma + (gsize) y * pitch;
+    guint16 *bg = background + (gsize) y * width;
+
+    for (x = 0; x < width; x++) {
+      gint diff = ((gint) row[x] << 8) - bg[x];
+      gint dev = diff - mean;
+
+      changed += (dev > threshold) | (dev < -threshold);
+      bg[x] = (guint16) (bg[x] + (diff >> shift));
+    }
+  }
+
+  return (gfloat) changed / gate->num_pixels;
+}
+
+/* 프레임마다 호출되므로 잠금 없는 조회를 먼저 시도합니다. */
+static MotionSlot *
+get_slot (PrototypeMotionGate * gate, guint source_id)
+{
+  MotionSlot *slot = (MotionSlot *) prototype_source_table_lookup (gate->slots,
+      source_id);
+
+  if (!slot)
+    slot = (MotionSlot *) prototype_source_table_get (gate->slots, source_id);
+  return slot;
+}
+
+static gboolean
+process_luma (PrototypeMotionGate * gate, MotionSlot * slot,
+    const guint8 * luma, guint pitch, GstClockTime ts)
+{
+  guint width = gate->config.analysis_width;
+  gboolean pass;
+  guint i, y;
+
+  if (!slot->background) {
+    /* 첫 프레임이 배경이 됩니다. */
+    slot->background = g_new (guint16, gate->num_pixels);
+    for (y = 0; y < gate->config.analysis_height; y++) {
+      for (i = 0; i < width; i++)
+        slot->background[(gsize) y * width + i] =
+            (guint16) (luma[(gsize) y * pitch + i] << 8);
+    }
+    slot->score = 0;
+    slot->last_motion_ts = ts;
+    slot->last_pass_ts = ts;
+    g_atomic_int_set (&slot->is_static, 0);
+    return TRUE;
+  }
+
+  slot->score = update_background (gate, slot->background, luma, pitch);
+  if (slot->score >= gate->config.motion_threshold)
+    slot->last_motion_ts = ts;
+
+  /* 움직임 후 hold 동안, 그리고 정적이어도 keepalive마다 통과시킵니다. */
+  pass = ts < slot->last_motion_ts + gate->hold_ns ||
+      (gate->keepalive_ns && ts >= slot->last_pass_ts + gate->keepalive_ns);
+  if (pass)
+    slot->last_pass_ts = ts;
+  g_atomic_int_set (&slot->is_static,
+      ts >= slot->last_motion_ts + gate->hold_ns);
+
+  return pass;
+}
+
+gboolean
+prototype_motion_gate_process_luma (PrototypeMotionGate * gate,
+    guint source_id, const guint8 * luma, guint pitch, GstClockTime ts)
+{
+  MotionSlot *slot = get_slot (gate, source_id);
+
+  return slot ? process_luma (gate, slot, luma, pitch, ts) : TRUE;
+}
+
+static const guint8 *
+scale_surface (PrototypeMotionGate * gate, MotionSlot * slot,
+    NvBufSurface * surface, guint * pitch)
+{
+  NvBufSurfTransformConfigParams session = {
+    NvBufSurfTransformCompute_Default, (gint32) gate->gpu_id, NULL
+  };
+  NvBufSurfTransformParams params;
+
+  if (!slot->scaled) {
+    NvBufSurfaceCreateParams create_params;
+
+    memset (&create_params, 0, sizeof (create_params));
+    create_params.gpuId = gate->gpu_id;
+    create_params.width = gate->config.analysis_width;
+    create_params.height = gate->config.analysis_height;
+    create_params.colorFormat = NVBUF_COLOR_FORMAT_GRAY8;
+    create_params.layout = NVBUF_LAYOUT_PITCH;
+#ifdef __aarch64__
+    create_params.memType = NVBUF_MEM_SURFACE_ARRAY;
+#else
+    create_params.memType = NVBUF_MEM_CUDA_UNIFIED;
+#endif
+    if (NvBufSurfaceCreate (&slot->scaled, 1, &create_params) != 0) {
+      slot->scaled = NULL;
+      return NULL;
+    }
+    slot->scaled->numFilled = 1;
+    if (NvBufSurfaceMap (slot->scaled, 0, 0, NVBUF_MAP_READ) != 0) {
+      NvBufSurfaceDestroy (slot->scaled);
+      slot->scaled = NULL;
+      return NULL;
+    }
+  }
+
+  /* 세션 설정은 스레드별이므로 소스 스트리밍 스레드에서 매번 지정합니다. */
+  if (NvBufSurfTransformSetSessionParams (&session) !=
+      NvBufSurfTransformError_Success)
+    return NULL;
+
+  memset (&params, 0, sizeof (params));
+  params.transform_flag = NVBUFSURF_TRANSFORM_FILTER;
+  /* 큰 비율 축소에서 앨리어싱 노이즈가 적은 supersampling */
+  params.transform_filter = NvBufSurfTransformInter_Algo2;
+  if (NvBufSurfTransform (surface, slot->scaled, &params) !=
+      NvBufSurfTransformError_Success)
+    return NULL;
+  NvBufSurfaceSyncForCpu (slot->scaled, 0, 0);
+
+  *pitch = slot->scaled->surfaceList[0].planeParams.pitch[0];
+  return (const guint8 *) slot->scaled->surfaceList[0].mappedAddr.addr[0];
+}
+
+gboolean
+prototype_motion_gate_process_surface (PrototypeMotionGate * gate,
+    guint source_id, NvBufSurface * surface, GstClockTime ts)
+{
+  MotionSlot *slot = get_slot (gate, source_id);
+  const guint8 *luma = NULL;
+  guint pitch = 0;
+
+  if (!slot || !surface || surface->numFilled == 0)
+    return TRUE;
+
+  luma = scale_surface (gate, slot, surface, &pitch);
+  if (!luma)
+    return TRUE;
+
+  return process_luma (gate, slot, luma, pitch, ts);
+}
+
+gboolean
+prototype_motion_gate_is_static (PrototypeMotionGate * gate, guint source_id)
+{
+  MotionSlot *slot = (MotionSlot *) prototype_source_table_lookup (gate->slots,
+      source_id);
+
+  return slot && g_atomic_int_get (&slot->is_static);
+}
+
+gfloat
+prototype_motion_gate_last_score (PrototypeMotionGate * gate, guint source_id)
+{
+  MotionSlot *slot = (MotionSlot *) prototype_source_table_lookup (gate->slots,
+      source_id);
+
+  return slot ? slot->score : 0;
+}
+
+void
+prototype_motion_gate_remove_source (PrototypeMotionGate * gate,
+    guint source_id)
+{
+  prototype_source_table_remove (gate->slots, source_id);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_MOTION_GATE_H__
+#define __PROTOTYPE_MOTION_GATE_H__
+
+#include <gst/gst.h>
+
+#include "nvbufsurface.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+  // motion-gate:
+  // enable: 1
+  // analysis-width: 64
+  // analysis-height: 36
+  // pixel-threshold: 20
+  // motion-threshold: 0.002
+  // learn-shift: 5
+  // hold-ms: 2000
+  // keepalive-ms: 1000
+  gboolean enable;
+  /** 판단에 쓰는 축소 luma 크기 */
+  guint analysis_width;
+  guint analysis_height;
+  /** 배경과의 밝기 차가 이 값을 넘는 픽셀을 변화로 셉니다 (0~255). */
+  guint pixel_threshold;
+  /** 변화 픽셀 비율이 이 값 이상이면 움직임입니다. */
+  gfloat motion_threshold;
+  /** 배경 갱신률 1/2^learn-shift (프레임마다) */
+  guint learn_shift;
+  /** 마지막 움직임 후 이 시간 동안은 계속 통과시킵니다. */
+  guint hold_ms;
+  /** 정적인 소스도 이 간격마다 한 프레임은 통과시킵니다. 0이면 모두 버립니다. */
+  guint keepalive_ms;
+} PrototypeMotionGateConfig;
+
+/**
+ * 추론 전 CPU 움직임 게이트.
+ * 소스별로 축소 luma의 배경(고정소수점 이동 평균)을 두고, 프레임 전체의
+ * 밝기 변화를 뺀 뒤 문턱을 넘는 픽셀 비율로 움직임을 판단합니다.
+ * 움직임이 없는 소스의 프레임은 streammux 전에 버려 PGIE에 가지 않게 하고,
+ * keepalive 간격마다 한 프레임만 통과시킵니다.
+ * 소스 하나의 프레임은 그 소스의 스트리밍 스레드에서만 처리해야 합니다.
+ */
+typedef struct _PrototypeMotionGate PrototypeMotionGate;
+
+/**
+ * @param  gpu_id [IN] 축소 복사에 쓸 GPU
+ * @return 비활성 시 NULL
+ */
+PrototypeMotionGate *prototype_motion_gate_new (PrototypeMotionGateConfig *
+    config, guint gpu_id);
+
+void prototype_motion_gate_free (PrototypeMotionGate * gate);
+
+/**
+ * @brief  analysis-width x analysis-height 크기의 luma 프레임 하나를 판단합니다.
+ * @param  pitch [IN] 행 간격 (바이트)
+ * @return 프레임을 통과시키면 TRUE
+ */
+gboolean prototype_motion_gate_process_luma (PrototypeMotionGate * gate,
+    guint source_id, const guint8 * luma, guint pitch, GstClockTime ts);
+
+/**
+ * @brief  NVMM 프레임을 GPU에서 analysis 크기의 GRAY8로 축소 복사한 뒤
+ *         process_luma()로 판단합니다. 축소 복사에 실패하면 통과시킵니다.
+ */
+gboolean prototype_motion_gate_process_surface (PrototypeMotionGate * gate,
+    guint source_id, NvBufSurface * surface, GstClockTime ts);
+
+/**
+ * @brief  소스가 지금 정적(움직임 없음)으로 판단되어 프레임을 버리는 중인지
+ *         반환합니다. 다른 스레드에서 호출해도 됩니다.
+ */
+gboolean prototype_motion_gate_is_static (PrototypeMotionGate * gate,
+    guint source_id);
+
+/** 마지막 프레임의 변화 픽셀 비율 */
+gfloat prototype_motion_gate_last_score (PrototypeMotionGate * gate,
+    guint source_id);
+
+/**
+ * @brief  소스의 배경과 축소 버퍼를 버립니다. 같은 source_id가 다시 추가되면
+ *         처음부터 배경을 학습합니다.
+ */
+void prototype_motion_gate_remove_source (PrototypeMotionGate * gate,
+    guint source_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
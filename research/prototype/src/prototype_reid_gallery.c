@@ -0,0 +1,846 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REID_HAVE_X86 1
+#endif
+
+#include "prototype_reid_gallery.h"
+
+/** 벡터 행 정렬 (AVX 레지스터 크기) */
+#define REID_ROW_ALIGN (32)
+#define REID_MAX_IVF_LISTS (1024)
+/** IVF 학습에 쓰는 최대 표본 수와 k-means 반복 수 */
+#define REID_IVF_TRAIN_SAMPLE (2048)
+#define REID_IVF_TRAIN_ITERATIONS (4)
+
+typedef struct
+{
+  guint source_id;
+  guint64 object_id;
+} ReidKey;
+
+typedef struct
+{
+  GstClockTime last_ts;
+  /** int8 행의 값 = q * scale. 그 밖에는 1 */
+  gfloat scale;
+  guint32 num_observations;
+  /** IVF 리스트 (학습 전에는 0) */
+  guint16 list;
+} ReidEntry;
+
+typedef struct
+{
+  GMutex lock;
+  guint num_entries;
+  /** 슬롯별 키. 해시 테이블 키로 쓰므로 주소가 바뀌지 않습니다. */
+  ReidKey *keys;
+  ReidEntry *entries;
+  /** 슬롯별 양자화 벡터 (row_bytes 간격) */
+  guint8 *vectors;
+  /** ReidKey * -> 슬롯 + 1 */
+  GHashTable *index;
+  /** ivf_lists x dim 정규화 중심 */
+  gfloat *centroids;
+  gboolean ivf_trained;
+  /** 마지막 학습 시 항목 수. 두 배가 되면 다시 학습합니다. */
+  guint ivf_trained_size;
+} ReidShard;
+
+/** 질의(fp32)와 양자화된 행의 내적 (int8은 scale을 곱하기 전) */
+typedef gfloat (*ReidDotFunc) (const gfloat * query, const guint8 * row,
+    guint dim);
+
+struct _PrototypeReidGallery
+{
+  PrototypeReidGalleryConfig config;
+  GstClockTime ttl_ns;
+  /** 첫 관측에서 정해지며 이후 바뀌지 않습니다. */
+  guint dim;
+  gsize row_bytes;
+  ReidDotFunc dot;
+  ReidDotFunc dot_f32;
+  ReidShard *shards;
+  /** dim 초기화와 샤드 배열 할당 */
+  GMutex lock;
+};
+
+/* ---- fp16 변환 ---- */
+
+static guint16
+float_to_half (gfloat f)
+{
+  union
+  {
+    gfloat f;
+    guint32 u;
+  } v = { f };
+  guint32 sign = (v.u >> 16) & 0x8000;
+  gint32 exp = (gint32) ((v.u >> 23) & 0xff) - 127 + 15;
+  guint32 mant = v.u & 0x7fffff;
+  guint32 half, rem;
+
+  if (((v.u >> 23) & 0xff) == 0xff)
+    return sign | 0x7c00 | (mant ? 0x200 : 0);
+  if (exp >= 31)
+    return sign | 0x7c00;
+  if (exp <= 0) {
+    guint shift;
+
+    if (exp < -10)
+      return sign;
+    mant |= 0x800000;
+    shift = 14 - exp;
+    half = mant >> shift;
+    rem = mant & ((1u << shift) - 1);
+    if (rem > (1u << (shift - 1)) || (rem == (1u << (shift - 1)) && (half & 1)))
+      half++;
+    return sign | half;
+  }
+
+  half = sign | ((guint32) exp << 10) | (mant >> 13);
+  rem = mant & 0x1fff;
+  /* 가장 가까운 짝수로 반올림. 올림이 지수로 넘어가도 올바른 값입니다. */
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+    half++;
+  return half;
+}
+
+static gfloat
+half_to_float (guint16 h)
+{
+  union
+  {
+    guint32 u;
+    gfloat f;
+  } v;
+  guint32 sign = (guint32) (h & 0x8000) << 16;
+  guint32 exp = (h >> 10) & 0x1f;
+  guint32 mant = h & 0x3ff;
+
+  if (exp == 0) {
+    if (mant == 0) {
+      v.u = sign;
+    } else {
+      exp = 127 - 15 + 1;
+      while (!(mant & 0x400)) {
+        mant <<= 1;
+        exp--;
+      }
+      v.u = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {
+    v.u = sign | 0x7f800000 | (mant << 13);
+  } else {
+    v.u = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  return v.f;
+}
+
+/* ---- 내적 커널 ---- */
+
+static gfloat
+dot_f32_scalar (const gfloat * query, const guint8 * row, guint dim)
+{
+  const gfloat *r = (const gfloat *) row;
+  gfloat sum = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    sum += query[i] * r[i];
+  return sum;
+}
+
+static gfloat
+dot_f16_scalar (const gfloat * query, const guint8 * row, guint dim)
+{
+  const guint16 *r = (const guint16 *) row;
+  gfloat sum = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    sum += query[i] * half_to_float (r[i]);
+  return sum;
+}
+
+static gfloat
+dot_i8_scalar (const gfloat * query, const guint8 * row, guint dim)
+{
+  const gint8 *r = (const gint8 *) row;
+  gfloat sum = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    sum += query[i] * r[i];
+  return sum;
+}
+
+#ifdef REID_HAVE_X86
+__attribute__ ((target ("avx2,fma")))
+static inline gfloat
+hsum256 (__m256 v)
+{
+  __m128 s = _mm_add_ps (_mm256_castps256_ps128 (v),
+      _mm256_extractf128_ps (v, 1));
+
+  s = _mm_add_ps (s, _mm_movehl_ps (s, s));
+  s = _mm_add_ss (s, _mm_movehdup_ps (s));
+  return _mm_cvtss_f32 (s);
+}
+
+__attribute__ ((target ("avx2,fma")))
+static gfloat
+dot_f32_avx2 (const gfloat * query, const guint8 * row, guint dim)
+{
+  const gfloat *r = (const gfloat *) row;
+  __m256 acc0 = _mm256_setzero_ps ();
+  __m256 acc1 = _mm256_setzero_ps ();
+  gfloat sum;
+  guint i = 0;
+
+  for (; i + 16 <= dim; i += 16) {
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_loadu_ps (r + i), acc0);
+    acc1 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i + 8),
+        _mm256_loadu_ps (r + i + 8), acc1);
+  }
+  for (; i + 8 <= dim; i += 8)
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_loadu_ps (r + i), acc0);
+  sum = hsum256 (_mm256_add_ps (acc0, acc1));
+  for (; i < dim; i++)
+    sum += query[i] * r[i];
+  return sum;
+}
+
+/* AVX2를 지원하는 CPU는 모두 F16C를 지원합니다. */
+__attribute__ ((target ("avx2,fma,f16c")))
+static gfloat
+dot_f16_avx2 (const gfloat * query, const guint8 * row, guint dim)
+{
+  const guint16 *r = (const guint16 *) row;
+  __m256 acc0 = _mm256_setzero_ps ();
+  __m256 acc1 = _mm256_setzero_ps ();
+  gfloat sum;
+  guint i = 0;
+
+  for (; i + 16 <= dim; i += 16) {
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) (r + i))), acc0);
+    acc1 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i + 8),
+        _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) (r + i + 8))),
+        acc1);
+  }
+  for (; i + 8 <= dim; i += 8)
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) (r + i))), acc0);
+  sum = hsum256 (_mm256_add_ps (acc0, acc1));
+  for (; i < dim; i++)
+    sum += query[i] * half_to_float (r[i]);
+  return sum;
+}
+
+__attribute__ ((target ("avx2,fma")))
+static gfloat
+dot_i8_avx2 (const gfloat * query, const guint8 * row, guint dim)
+{
+  const gint8 *r = (const gint8 *) row;
+  __m256 acc0 = _mm256_setzero_ps ();
+  __m256 acc1 = _mm256_setzero_ps ();
+  gfloat sum;
+  guint i = 0;
+
+  for (; i + 16 <= dim; i += 16) {
+    __m128i q = _mm_loadu_si128 ((const __m128i *) (r + i));
+
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_cvtepi32_ps (_mm256_cvtepi8_epi32 (q)), acc0);
+    acc1 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i + 8),
+        _mm256_cvtepi32_ps (_mm256_cvtepi8_epi32 (_mm_srli_si128 (q, 8))),
+        acc1);
+  }
+  for (; i + 8 <= dim; i += 8)
+    acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (query + i),
+        _mm256_cvtepi32_ps (_mm256_cvtepi8_epi32 (_mm_loadl_epi64
+                ((const __m128i *) (r + i)))), acc0);
+  sum = hsum256 (_mm256_add_ps (acc0, acc1));
+  for (; i < dim; i++)
+    sum += query[i] * r[i];
+  return sum;
+}
+#endif
+
+static void
+select_kernels (PrototypeReidGallery * gallery)
+{
+  static const ReidDotFunc scalar[] = { dot_f32_scalar, dot_f16_scalar,
+    dot_i8_scalar
+  };
+
+  gallery->dot = scalar[gallery->config.quantization];
+  gallery->dot_f32 = dot_f32_scalar;
+#ifdef REID_HAVE_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    static const ReidDotFunc avx2[] = { dot_f32_avx2, dot_f16_avx2,
+      dot_i8_avx2
+    };
+
+    gallery->dot = avx2[gallery->config.quantization];
+    gallery->dot_f32 = dot_f32_avx2;
+  }
+#endif
+}
+
+/* ---- 행 인코딩 ---- */
+
+static void
+normalize (gfloat * v, guint dim)
+{
+  gfloat norm = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    norm += v[i] * v[i];
+  if (norm <= 0)
+    return;
+  norm = 1.0f / sqrtf (norm);
+  for (i = 0; i < dim; i++)
+    v[i] *= norm;
+}
+
+static gfloat
+encode_row (PrototypeReidGallery * gallery, const gfloat * v, guint8 * row)
+{
+  guint dim = gallery->dim;
+  gfloat scale = 1;
+  guint i;
+
+  switch (gallery->config.quantization) {
+    case PROTOTYPE_REID_QUANT_FP16:
+      for (i = 0; i < dim; i++)
+        ((guint16 *) row)[i] = float_to_half (v[i]);
+      break;
+    case PROTOTYPE_REID_QUANT_INT8:{
+      gfloat max = 0;
+
+      for (i = 0; i < dim; i++)
+        max = MAX (max, fabsf (v[i]));
+      scale = max > 0 ? max / 127 : 1;
+      for (i = 0; i < dim; i++)
+        ((gint8 *) row)[i] = (gint8) lrintf (v[i] / scale);
+      break;
+    }
+    default:
+      memcpy (row, v, dim * sizeof (gfloat));
+      break;
+  }
+  return scale;
+}
+
+static void
+decode_row (PrototypeReidGallery * gallery, const guint8 * row, gfloat scale,
+    gfloat * v)
+{
+  guint dim = gallery->dim;
+  guint i;
+
+  switch (gallery->config.quantization) {
+    case PROTOTYPE_REID_QUANT_FP16:
+      for (i = 0; i < dim; i++)
+        v[i] = half_to_float (((const guint16 *) row)[i]);
+      break;
+    case PROTOTYPE_REID_QUANT_INT8:
+      for (i = 0; i < dim; i++)
+        v[i] = ((const gint8 *) row)[i] * scale;
+      break;
+    default:
+      memcpy (v, row, dim * sizeof (gfloat));
+      break;
+  }
+}
+
+/* ---- 샤드 ---- */
+
+static guint
+reid_key_hash (gconstpointer key)
+{
+  const ReidKey *k = (const ReidKey *) key;
+  guint64 h = (k->object_id ^ ((guint64) k->source_id << 40)) *
+      G_GUINT64_CONSTANT (0x9E3779B97F4A7C15);
+
+  return (guint) (h >> 32);
+}
+
+static gboolean
+reid_key_equal (gconstpointer a, gconstpointer b)
+{
+  const ReidKey *ka = (const ReidKey *) a;
+  const ReidKey *kb = (const ReidKey *) b;
+
+  return ka->source_id == kb->source_id && ka->object_id == kb->object_id;
+}
+
+static inline guint8 *
+shard_row (PrototypeReidGallery * gallery, ReidShard * shard, guint slot)
+{
+  return shard->vectors + (gsize) slot * gallery->row_bytes;
+}
+
+/* 슬롯을 지우고 마지막 항목을 그 자리로 옮깁니다. */
+static void
+shard_remove (PrototypeReidGallery * gallery, ReidShard * shard, guint slot)
+{
+  guint last = shard->num_entries - 1;
+
+  g_hash_table_remove (shard->index, &shard->keys[slot]);
+  if (slot != last) {
+    g_hash_table_remove (shard->index, &shard->keys[last]);
+    shard->keys[slot] = shard->keys[last];
+    shard->entries[slot] = shard->entries[last];
+    memcpy (shard_row (gallery, shard, slot), shard_row (gallery, shard, last),
+        gallery->row_bytes);
+    g_hash_table_insert (shard->index, &shard->keys[slot],
+        GUINT_TO_POINTER (slot + 1));
+  }
+  shard->num_entries--;
+}
+
+static gboolean
+entry_expired (PrototypeReidGallery * gallery, const ReidEntry * entry,
+    GstClockTime ts)
+{
+  return gallery->ttl_ns && entry->last_ts + gallery->ttl_ns < ts;
+}
+
+/* TTL이 지난 항목을 지우고, 그래도 가득 차 있으면 가장 오래된 항목을 지웁니다. */
+static void
+shard_make_room (PrototypeReidGallery * gallery, ReidShard * shard,
+    GstClockTime ts)
+{
+  guint slot, oldest = 0;
+
+  for (slot = shard->num_entries; slot > 0; slot--) {
+    if (entry_expired (gallery, &shard->entries[slot - 1], ts))
+      shard_remove (gallery, shard, slot - 1);
+  }
+  if (shard->num_entries < gallery->config.max_entries_per_shard)
+    return;
+
+  for (slot = 1; slot < shard->num_entries; slot++) {
+    if (shard->entries[slot].last_ts < shard->entries[oldest].last_ts)
+      oldest = slot;
+  }
+  shard_remove (gallery, shard, oldest);
+}
+
+static guint16
+nearest_list (PrototypeReidGallery * gallery, ReidShard * shard,
+    const gfloat * v)
+{
+  gfloat best_score = -G_MAXFLOAT;
+  guint16 best = 0;
+  guint i;
+
+  for (i = 0; i < gallery->config.ivf_lists; i++) {
+    gfloat score = gallery->dot_f32 (v,
+        (const guint8 *) &shard->centroids[(gsize) i * gallery->dim],
+        gallery->dim);
+
+    if (score > best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/*
+ * 표본으로 구면 k-means 중심을 학습하고 모든 항목을 가장 가까운 리스트에
+ * 배정합니다. 항목 수가 두 배가 될 때마다 다시 학습합니다.
+ */
+static void
+shard_train_ivf (PrototypeReidGallery * gallery, ReidShard * shard)
+{
+  guint dim = gallery->dim;
+  guint lists = gallery->config.ivf_lists;
+  guint num_sample = MIN (shard->num_entries, REID_IVF_TRAIN_SAMPLE);
+  guint stride = shard->num_entries / num_sample;
+  gfloat *sample = g_new (gfloat, (gsize) num_sample * dim);
+  gfloat *sums = g_new (gfloat, (gsize) lists * dim);
+  guint *counts = g_new (guint, lists);
+  guint i, j, it;
+
+  for (i = 0; i < num_sample; i++) {
+    guint slot = i * stride;
+
+    decode_row (gallery, shard_row (gallery, shard, slot),
+        shard->entries[slot].scale, &sample[(gsize) i * dim]);
+  }
+  for (i = 0; i < lists; i++)
+    memcpy (&shard->centroids[(gsize) i * dim],
+        &sample[(gsize) (i * num_sample / lists) * dim], dim * sizeof (gfloat));
+
+  for (it = 0; it < REID_IVF_TRAIN_ITERATIONS; it++) {
+    memset (sums, 0, (gsize) lists * dim * sizeof (gfloat));
+    memset (counts, 0, lists * sizeof (guint));
+    for (i = 0; i < num_sample; i++) {
+      const gfloat *v = &sample[(gsize) i * dim];
+      guint16 list = nearest_list (gallery, shard, v);
+
+      for (j = 0; j < dim; j++)
+        sums[(gsize) list * dim + j] += v[j];
+      counts[list]++;
+    }
+    for (i = 0; i < lists; i++) {
+      if (!counts[i])
+        continue;
+      normalize (&sums[(gsize) i * dim], dim);
+      memcpy (&shard->centroids[(gsize) i * dim], &sums[(gsize) i * dim],
+          dim * sizeof (gfloat));
+    }
+  }
+
+  for (i = 0; i < shard->num_entries; i++) {
+    decode_row (gallery, shard_row (gallery, shard, i),
+        shard->entries[i].scale, sample);
+    shard->entries[i].list = nearest_list (gallery, shard, sample);
+  }
+  shard->ivf_trained = TRUE;
+  shard->ivf_trained_size = shard->num_entries;
+
+  g_free (counts);
+  g_free (sums);
+  g_free (sample);
+}
+
+static void
+topk_insert (PrototypeReidMatch * top, guint * num, guint k,
+    const ReidKey * key, gfloat score)
+{
+  guint i;
+
+  if (*num == k && score <= top[k - 1].score)
+    return;
+  i = *num < k ? (*num)++ : k - 1;
+  while (i > 0 && top[i - 1].score < score) {
+    top[i] = top[i - 1];
+    i--;
+  }
+  top[i].source_id = key->source_id;
+  top[i].object_id = key->object_id;
+  top[i].score = score;
+}
+
+static void
+shard_search (PrototypeReidGallery * gallery, ReidShard * shard,
+    const gfloat * query, GstClockTime ts, gint exclude_source,
+    PrototypeReidMatch * top, guint * num, guint k)
+{
+  gboolean use_ivf = shard->ivf_trained &&
+      shard->num_entries >= gallery->config.ivf_min_entries;
+  guint8 probe[REID_MAX_IVF_LISTS];
+  guint slot;
+
+  if (use_ivf) {
+    PrototypeReidMatch lists[PROTOTYPE_REID_GALLERY_MAX_TOP_K];
+    guint num_lists = 0, i;
+    guint probes = MIN (gallery->config.ivf_probes,
+        PROTOTYPE_REID_GALLERY_MAX_TOP_K);
+
+    /* 질의와 가까운 중심 ivf-probes개의 리스트만 비교합니다. */
+    for (i = 0; i < gallery->config.ivf_lists; i++) {
+      ReidKey list_key = { i, 0 };
+
+      topk_insert (lists, &num_lists, probes, &list_key,
+          gallery->dot_f32 (query,
+              (const guint8 *) &shard->centroids[(gsize) i * gallery->dim],
+              gallery->dim));
+    }
+    memset (probe, 0, gallery->config.ivf_lists);
+    for (i = 0; i < num_lists; i++)
+      probe[lists[i].source_id] = 1;
+  }
+
+  for (slot = 0; slot < shard->num_entries; slot++) {
+    const ReidEntry *entry = &shard->entries[slot];
+
+    if (use_ivf && !probe[entry->list])
+      continue;
+    if (entry_expired (gallery, entry, ts))
+      continue;
+    if (exclude_source >= 0 &&
+        shard->keys[slot].source_id == (guint) exclude_source)
+      continue;
+    topk_insert (top, num, k, &shard->keys[slot],
+        gallery->dot (query, shard_row (gallery, shard, slot),
+            gallery->dim) * entry->scale);
+  }
+}
+
+/* ---- 공개 API ---- */
+
+PrototypeReidGallery *
+prototype_reid_gallery_new (PrototypeReidGalleryConfig * config)
+{
+  PrototypeReidGallery *gallery = NULL;
+  guint i;
+
+  if (!config->enable)
+    return NULL;
+
+  gallery = g_new0 (PrototypeReidGallery, 1);
+  gallery->config = *config;
+  if (gallery->config.num_shards == 0)
+    gallery->config.num_shards = 1;
+  if (gallery->config.max_entries_per_shard == 0)
+    gallery->config.max_entries_per_shard = 4096;
+  gallery->config.top_k = CLAMP (gallery->config.top_k, 1,
+      PROTOTYPE_REID_GALLERY_MAX_TOP_K);
+  gallery->config.query_after = MAX (gallery->config.query_after, 1);
+  gallery->config.ema_alpha = CLAMP (gallery->config.ema_alpha, 0, 1);
+  gallery->config.ivf_lists = MIN (gallery->config.ivf_lists,
+      REID_MAX_IVF_LISTS);
+  gallery->config.ivf_probes = MAX (gallery->config.ivf_probes, 1);
+  /* 리스트마다 한 개 이상의 표본이 있어야 학습할 수 있습니다. */
+  gallery->config.ivf_min_entries = MAX (gallery->config.ivf_min_entries,
+      gallery->config.ivf_lists);
+  gallery->ttl_ns = (GstClockTime) gallery->config.ttl_sec * GST_SECOND;
+  select_kernels (gallery);
+
+  gallery->shards = g_new0 (ReidShard, gallery->config.num_shards);
+  for (i = 0; i < gallery->config.num_shards; i++) {
+    g_mutex_init (&gallery->shards[i].lock);
+    gallery->shards[i].index = g_hash_table_new (reid_key_hash,
+        reid_key_equal);
+  }
+  g_mutex_init (&gallery->lock);
+
+  return gallery;
+}
+
+void
+prototype_reid_gallery_free (PrototypeReidGallery * gallery)
+{
+  guint i;
+
+  if (!gallery)
+    return;
+
+  for (i = 0; i < gallery->config.num_shards; i++) {
+    ReidShard *shard = &gallery->shards[i];
+
+    g_hash_table_destroy (shard->index);
+    g_free (shard->keys);
+    g_free (shard->entries);
+    g_free (shard->vectors);
+    g_free (shard->centroids);
+    g_mutex_clear (&shard->lock);
+  }
+  g_free (gallery->shards);
+  g_mutex_clear (&gallery->lock);
+  g_free (gallery);
+}
+
+/* 첫 임베딩의 차원으로 샤드 배열을 할당합니다. */
+static gboolean
+gallery_init_dim (PrototypeReidGallery * gallery, guint dim)
+{
+  static const gsize elem_size[] = { sizeof (gfloat), sizeof (guint16),
+    sizeof (gint8)
+  };
+  gboolean ret = FALSE;
+  guint i;
+
+  if (dim == 0)
+    return FALSE;
+  if (g_atomic_int_get (&gallery->dim))
+    return g_atomic_int_get (&gallery->dim) == dim;
+
+  g_mutex_lock (&gallery->lock);
+  if (gallery->dim) {
+    ret = gallery->dim == dim;
+    goto done;
+  }
+  gallery->row_bytes = (dim * elem_size[gallery->config.quantization] +
+      REID_ROW_ALIGN - 1) / REID_ROW_ALIGN * REID_ROW_ALIGN;
+  for (i = 0; i < gallery->config.num_shards; i++) {
+    ReidShard *shard = &gallery->shards[i];
+    guint capacity = gallery->config.max_entries_per_shard;
+
+    shard->keys = g_new0 (ReidKey, capacity);
+    shard->entries = g_new0 (ReidEntry, capacity);
+    shard->vectors = (guint8 *) g_malloc0 ((gsize) capacity *
+        gallery->row_bytes);
+    if (gallery->config.ivf_lists)
+      shard->centroids = g_new0 (gfloat,
+          (gsize) gallery->config.ivf_lists * dim);
+  }
+  g_atomic_int_set (&gallery->dim, dim);
+  ret = TRUE;
+
+done:
+  g_mutex_unlock (&gallery->lock);
+  return ret;
+}
+
+static ReidShard *
+gallery_shard (PrototypeReidGallery * gallery, const ReidKey * key)
+{
+  return &gallery->shards[reid_key_hash (key) % gallery->config.num_shards];
+}
+
+void
+prototype_reid_gallery_observe (PrototypeReidGallery * gallery,
+    guint source_id, guint64 object_id, const gfloat * embedding, guint dim,
+    GstClockTime ts, PrototypeReidLinkFunc func, gpointer user_data)
+{
+  ReidKey key = { source_id, object_id };
+  ReidShard *shard = NULL;
+  gfloat *v = NULL;
+  gboolean query = FALSE;
+  guint slot, i;
+
+  if (!gallery_init_dim (gallery, dim))
+    return;
+
+  v = g_newa (gfloat, dim);
+  memcpy (v, embedding, dim * sizeof (gfloat));
+  normalize (v, dim);
+
+  shard = gallery_shard (gallery, &key);
+  g_mutex_lock (&shard->lock);
+  slot = GPOINTER_TO_UINT (g_hash_table_lookup (shard->index, &key));
+  if (slot) {
+    ReidEntry *entry = &shard->entries[--slot];
+    gfloat *old = g_newa (gfloat, dim);
+    gfloat alpha = gallery->config.ema_alpha;
+
+    decode_row (gallery, shard_row (gallery, shard, slot), entry->scale, old);
+    for (i = 0; i < dim; i++)
+      v[i] = (1 - alpha) * old[i] + alpha * v[i];
+    normalize (v, dim);
+    entry->scale = encode_row (gallery, v, shard_row (gallery, shard, slot));
+    entry->last_ts = MAX (entry->last_ts, ts);
+    entry->num_observations++;
+    query = entry->num_observations == gallery->config.query_after;
+  } else {
+    ReidEntry *entry = NULL;
+
+    if (shard->num_entries >= gallery->config.max_entries_per_shard)
+      shard_make_room (gallery, shard, ts);
+    slot = shard->num_entries++;
+    shard->keys[slot] = key;
+    entry = &shard->entries[slot];
+    entry->last_ts = ts;
+    entry->num_observations = 1;
+    entry->scale = encode_row (gallery, v, shard_row (gallery, shard, slot));
+    entry->list = shard->ivf_trained ? nearest_list (gallery, shard, v) : 0;
+    g_hash_table_insert (shard->index, &shard->keys[slot],
+        GUINT_TO_POINTER (slot + 1));
+    query = gallery->config.query_after == 1;
+
+    if (gallery->config.ivf_lists &&
+        shard->num_entries >= gallery->config.ivf_min_entries &&
+        (!shard->ivf_trained ||
+            shard->num_entries >= 2 * shard->ivf_trained_size))
+      shard_train_ivf (gallery, shard);
+  }
+  g_mutex_unlock (&shard->lock);
+
+  if (query && func) {
+    PrototypeReidMatch matches[PROTOTYPE_REID_GALLERY_MAX_TOP_K];
+    guint num = prototype_reid_gallery_search (gallery, v, dim, ts,
+        (gint) source_id, matches, gallery->config.top_k);
+
+    while (num && matches[num - 1].score < gallery->config.match_threshold)
+      num--;
+    if (num) {
+      PrototypeReidLinkEvent event = { source_id, object_id, ts, matches,
+        num
+      };
+
+      func (&event, user_data);
+    }
+  }
+}
+
+guint
+prototype_reid_gallery_search (PrototypeReidGallery * gallery,
+    const gfloat * query, guint dim, GstClockTime ts, gint exclude_source,
+    PrototypeReidMatch * matches, guint k)
+{
+  guint num = 0, i;
+
+  if (!dim || g_atomic_int_get (&gallery->dim) != dim || k == 0)
+    return 0;
+
+  k = MIN (k, PROTOTYPE_REID_GALLERY_MAX_TOP_K);
+  for (i = 0; i < gallery->config.num_shards; i++) {
+    ReidShard *shard = &gallery->shards[i];
+
+    g_mutex_lock (&shard->lock);
+    shard_search (gallery, shard, query, ts, exclude_source, matches, &num, k);
+    g_mutex_unlock (&shard->lock);
+  }
+  return num;
+}
+
+guint
+prototype_reid_gallery_size (PrototypeReidGallery * gallery)
+{
+  guint size = 0, i;
+
+  for (i = 0; i < gallery->config.num_shards; i++) {
+    g_mutex_lock (&gallery->shards[i].lock);
+    size += gallery->shards[i].num_entries;
+    g_mutex_unlock (&gallery->shards[i].lock);
+  }
+  return size;
+}
+
+gboolean
+prototype_reid_gallery_lookup (PrototypeReidGallery * gallery,
+    guint source_id, guint64 object_id, gfloat * embedding, guint dim)
+{
+  ReidKey key = { source_id, object_id };
+  ReidShard *shard = NULL;
+  guint slot;
+
+  if (!dim || g_atomic_int_get (&gallery->dim) != dim)
+    return FALSE;
+
+  shard = gallery_shard (gallery, &key);
+  g_mutex_lock (&shard->lock);
+  slot = GPOINTER_TO_UINT (g_hash_table_lookup (shard->index, &key));
+  if (slot)
+    decode_row (gallery, shard_row (gallery, shard, slot - 1),
+        shard->entries[slot - 1].scale, embedding);
+  g_mutex_unlock (&shard->lock);
+
+  return slot != 0;
+}
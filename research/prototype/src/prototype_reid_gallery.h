@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_REID_GALLERY_H__
+#define __PROTOTYPE_REID_GALLERY_H__
+
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 질의 한 번에 돌려주는 최대 후보 수 */
+#define PROTOTYPE_REID_GALLERY_MAX_TOP_K (32)
+
+typedef enum
+{
+  PROTOTYPE_REID_QUANT_FP32,
+  /** IEEE half. 항목당 2바이트/차원 */
+  PROTOTYPE_REID_QUANT_FP16,
+  /** 항목별 대칭 스케일의 int8. 질의는 fp32 그대로 비교합니다. */
+  PROTOTYPE_REID_QUANT_INT8,
+} PrototypeReidQuantization;
+
+typedef struct
+{
+  // reid-gallery:
+  // enable: 1
+  // quantization: fp16
+  // num-shards: 4
+  // max-entries-per-shard: 4096
+  // ttl-sec: 300
+  // top-k: 5
+  // match-threshold: 0.75
+  // query-after: 5
+  // ema-alpha: 0.1
+  // ivf-lists: 32
+  // ivf-min-entries: 2048
+  // ivf-probes: 4
+  gboolean enable;
+  PrototypeReidQuantization quantization;
+  /** 트랙 키 해시로 나눈 샤드 수. 샤드마다 잠금이 따로 있습니다. */
+  guint num_shards;
+  guint max_entries_per_shard;
+  /** 이 시간 동안 갱신되지 않은 트랙은 갤러리에서 빠집니다. */
+  guint ttl_sec;
+  guint top_k;
+  /** 코사인 유사도가 이 값 이상인 다른 카메라 트랙을 같은 객체로 봅니다. */
+  gfloat match_threshold;
+  /** 트랙의 임베딩이 이 횟수만큼 모였을 때 한 번 질의합니다. */
+  guint query_after;
+  /** 트랙 임베딩의 지수 이동 평균 가중치 (새 관측 쪽) */
+  gfloat ema_alpha;
+  /** IVF 리스트 수. 0이면 항상 전체를 비교합니다. */
+  guint ivf_lists;
+  /** 샤드 항목 수가 이 이상이면 IVF를 학습해 씁니다. */
+  guint ivf_min_entries;
+  /** 질의마다 비교할 IVF 리스트 수 */
+  guint ivf_probes;
+} PrototypeReidGalleryConfig;
+
+typedef struct
+{
+  guint source_id;
+  guint64 object_id;
+  /** 코사인 유사도 */
+  gfloat score;
+} PrototypeReidMatch;
+
+/** 새 트랙과 같은 객체로 보이는 다른 카메라 트랙들 */
+typedef struct
+{
+  guint source_id;
+  guint64 object_id;
+  GstClockTime ts;
+  /** score 내림차순. matches[0]은 match-threshold 이상입니다. */
+  const PrototypeReidMatch *matches;
+  guint num_matches;
+} PrototypeReidLinkEvent;
+
+typedef void (*PrototypeReidLinkFunc) (const PrototypeReidLinkEvent * event,
+    gpointer user_data);
+
+/**
+ * 트랙별 ReID 임베딩 갤러리.
+ * 트랙마다 정규화된 임베딩의 이동 평균을 (선택적으로 양자화해) 한 항목으로
+ * 두고, 코사인 top-k 질의는 샤드마다 연속 배열을 SIMD 커널로 훑습니다.
+ * x86에서는 실행 시 AVX2/FMA/F16C를 확인해 쓰고, 그 밖에는 스칼라 커널입니다.
+ * 샤드가 커지면 IVF (구면 k-means 중심)로 일부 리스트만 비교합니다.
+ */
+typedef struct _PrototypeReidGallery PrototypeReidGallery;
+
+/**
+ * @return 비활성 시 NULL
+ */
+PrototypeReidGallery *prototype_reid_gallery_new
+    (PrototypeReidGalleryConfig * config);
+
+void prototype_reid_gallery_free (PrototypeReidGallery * gallery);
+
+/**
+ * @brief  트랙의 임베딩 관측을 더합니다. 관측 수가 query-after가 되면 다른
+ *         카메라의 트랙을 질의하고, 일치하면 func로 link 이벤트를 전달합니다.
+ *         func는 잠금 밖에서 호출됩니다. 차원은 첫 관측으로 정해지며 다른
+ *         차원의 임베딩은 무시합니다.
+ */
+void prototype_reid_gallery_observe (PrototypeReidGallery * gallery,
+    guint source_id, guint64 object_id, const gfloat * embedding, guint dim,
+    GstClockTime ts, PrototypeReidLinkFunc func, gpointer user_data);
+
+/**
+ * @brief  ts 기준 TTL 안의 항목에서 query와 코사인 유사도가 높은 순으로
+ *         최대 k개를 matches에 씁니다. exclude_source의 항목은 제외합니다
+ *         (-1이면 제외 없음).
+ * @return matches에 쓴 수
+ */
+guint prototype_reid_gallery_search (PrototypeReidGallery * gallery,
+    const gfloat * query, guint dim, GstClockTime ts, gint exclude_source,
+    PrototypeReidMatch * matches, guint k);
+
+/** 저장된 항목 수 (TTL이 지났지만 아직 정리되지 않은 항목 포함) */
+guint prototype_reid_gallery_size (PrototypeReidGallery * gallery);
+
+/** 양자화 후 다시 읽은 임베딩. 양자화 오차 확인용입니다. */
+gboolean prototype_reid_gallery_lookup (PrototypeReidGallery * gallery,
+    guint source_id, guint64 object_id, gfloat * embedding, guint dim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
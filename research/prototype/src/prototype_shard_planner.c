@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prototype_shard_planner.h"
+
+/** 함께 배치되는 item 묶음 (group 또는 단독 item) */
+typedef struct
+{
+  GArray *members;
+  gdouble weight;
+  gint previous_shard;
+} ShardUnit;
+
+gdouble
+prototype_shard_source_weight (guint width, guint height, gdouble fps,
+    gdouble codec_weight)
+{
+  gdouble pixels = (width && height) ?
+      (gdouble) width * (gdouble) height : PROTOTYPE_SHARD_REF_PIXELS;
+
+  if (fps <= 0)
+    fps = PROTOTYPE_SHARD_REF_FPS;
+  if (codec_weight <= 0)
+    codec_weight = 1.0;
+
+  return (pixels / PROTOTYPE_SHARD_REF_PIXELS) *
+      (fps / PROTOTYPE_SHARD_REF_FPS) * codec_weight;
+}
+
+GHashTable *
+prototype_shard_parse_codec_weights (const gchar * spec)
+{
+  GHashTable *weights = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, g_free);
+  gchar **entries = NULL;
+  guint i;
+
+  if (!spec)
+    return weights;
+
+  entries = g_strsplit (spec, ";", -1);
+  for (i = 0; entries[i]; i++) {
+    gchar **kv = g_strsplit (entries[i], ":", 2);
+    if (kv[0] && kv[1]) {
+      gdouble *value = g_new (gdouble, 1);
+      *value = g_ascii_strtod (kv[1], NULL);
+      g_hash_table_insert (weights,
+          g_ascii_strdown (g_strstrip (kv[0]), -1), value);
+    }
+    g_strfreev (kv);
+  }
+  g_strfreev (entries);
+
+  return weights;
+}
+
+gdouble
+prototype_shard_codec_weight (GHashTable * codec_weights, const gchar * codec)
+{
+  gdouble *value = NULL;
+  gchar *lower = NULL;
+
+  if (!codec_weights || !codec || !*codec)
+    return 1.0;
+
+  lower = g_ascii_strdown (codec, -1);
+  value = (gdouble *) g_hash_table_lookup (codec_weights, lower);
+  g_free (lower);
+
+  return value ? *value : 1.0;
+}
+
+static gint
+compare_unit_weight_desc (gconstpointer a, gconstpointer b)
+{
+  const ShardUnit *ua = *(const ShardUnit **) a;
+  const ShardUnit *ub = *(const ShardUnit **) b;
+
+  if (ua->weight > ub->weight)
+    return -1;
+  if (ua->weight < ub->weight)
+    return 1;
+  return 0;
+}
+
+/* 구성원 가중치 다수결로 단위의 이전 shard를 정합니다. */
+static gint
+unit_previous_shard (const ShardUnit * unit, const PrototypeShardItem * items,
+    guint num_shards, GHashTable * previous, gdouble * votes)
+{
+  gint best = -1;
+  guint i;
+
+  for (i = 0; i < unit->members->len; i++) {
+    const PrototypeShardItem *item =
+        &items[g_array_index (unit->members, guint, i)];
+    guint prev = GPOINTER_TO_UINT (g_hash_table_lookup (previous, item->key));
+
+    if (prev == 0 || prev > num_shards)
+      continue;
+    votes[prev - 1] += item->weight > 0 ? item->weight : 1e-9;
+    if (best < 0 || votes[prev - 1] > votes[best])
+      best = prev - 1;
+  }
+
+  for (i = 0; i < unit->members->len; i++) {
+    const PrototypeShardItem *item =
+        &items[g_array_index (unit->members, guint, i)];
+    guint prev = GPOINTER_TO_UINT (g_hash_table_lookup (previous, item->key));
+    if (prev > 0 && prev <= num_shards)
+      votes[prev - 1] = 0;
+  }
+
+  return best;
+}
+
+static void
+assign_unit (PrototypeShardPlan * plan, const ShardUnit * unit, guint shard)
+{
+  guint i;
+
+  for (i = 0; i < unit->members->len; i++)
+    plan->assignment[g_array_index (unit->members, guint, i)] = shard;
+  plan->loads[shard] += unit->weight;
+}
+
+static guint
+least_loaded_shard (const PrototypeShardPlan * plan)
+{
+  guint best = 0, i;
+
+  for (i = 1; i < plan->num_shards; i++) {
+    if (plan->loads[i] < plan->loads[best])
+      best = i;
+  }
+  return best;
+}
+
+PrototypeShardPlan *
+prototype_shard_plan (const PrototypeShardItem * items, guint num_items,
+    guint num_shards, gdouble tolerance, GHashTable * previous)
+{
+  PrototypeShardPlan *plan = NULL;
+  GHashTable *group_units = NULL;
+  GPtrArray *units = NULL;
+  GPtrArray *pending = NULL;
+  gdouble *votes = NULL;
+  gdouble total = 0, limit = 0;
+  guint i;
+
+  if (num_shards == 0)
+    return NULL;
+
+  plan = g_new0 (PrototypeShardPlan, 1);
+  plan->num_items = num_items;
+  plan->num_shards = num_shards;
+  plan->assignment = g_new0 (guint, MAX (num_items, 1));
+  plan->loads = g_new0 (gdouble, num_shards);
+
+  /* 1. group 단위로 묶기 */
+  group_units = g_hash_table_new (g_str_hash, g_str_equal);
+  units = g_ptr_array_new ();
+  for (i = 0; i < num_items; i++) {
+    ShardUnit *unit = NULL;
+
+    if (items[i].group && *items[i].group)
+      unit = (ShardUnit *) g_hash_table_lookup (group_units, items[i].group);
+    if (!unit) {
+      unit = g_new0 (ShardUnit, 1);
+      unit->members = g_array_new (FALSE, FALSE, sizeof (guint));
+      unit->previous_shard = -1;
+      g_ptr_array_add (units, unit);
+      if (items[i].group && *items[i].group)
+        g_hash_table_insert (group_units, (gpointer) items[i].group, unit);
+    }
+    g_array_append_val (unit->members, i);
+    unit->weight += items[i].weight;
+    total += items[i].weight;
+  }
+  g_hash_table_destroy (group_units);
+
+  g_ptr_array_sort (units, compare_unit_weight_desc);
+  limit = (total / num_shards) * (1.0 + MAX (tolerance, 0.0));
+
+  /* 2. 이전 배치 유지 */
+  pending = g_ptr_array_new ();
+  if (previous && g_hash_table_size (previous) > 0) {
+    votes = g_new0 (gdouble, num_shards);
+    for (i = 0; i < units->len; i++) {
+      ShardUnit *unit = (ShardUnit *) g_ptr_array_index (units, i);
+      unit->previous_shard =
+          unit_previous_shard (unit, items, num_shards, previous, votes);
+    }
+    g_free (votes);
+  }
+
+  for (i = 0; i < units->len; i++) {
+    ShardUnit *unit = (ShardUnit *) g_ptr_array_index (units, i);
+    if (unit->previous_shard >= 0 &&
+        plan->loads[unit->previous_shard] + unit->weight <= limit) {
+      assign_unit (plan, unit, unit->previous_shard);
+    } else {
+      g_ptr_array_add (pending, unit);
+    }
+  }
+
+  /* 3. 나머지는 LPT(가중치 내림차순, 최소 부하 shard) */
+  for (i = 0; i < pending->len; i++) {
+    ShardUnit *unit = (ShardUnit *) g_ptr_array_index (pending, i);
+    assign_unit (plan, unit, least_loaded_shard (plan));
+  }
+  g_ptr_array_free (pending, TRUE);
+
+  if (previous) {
+    for (i = 0; i < num_items; i++) {
+      guint prev =
+          GPOINTER_TO_UINT (g_hash_table_lookup (previous, items[i].key));
+      if (prev > 0 && prev - 1 != plan->assignment[i])
+        plan->num_moved++;
+    }
+  }
+
+  for (i = 0; i < units->len; i++) {
+    ShardUnit *unit = (ShardUnit *) g_ptr_array_index (units, i);
+    g_array_free (unit->members, TRUE);
+    g_free (unit);
+  }
+  g_ptr_array_free (units, TRUE);
+
+  return plan;
+}
+
+void
+prototype_shard_plan_free (PrototypeShardPlan * plan)
+{
+  if (!plan)
+    return;
+  g_free (plan->assignment);
+  g_free (plan->loads);
+  g_free (plan);
+}
+
+void
+prototype_source_shard_info_copy (PrototypeSourceShardInfo * dst,
+    const PrototypeSourceShardInfo * src)
+{
+  *dst = *src;
+  dst->codec = g_strdup (src->codec);
+  dst->group = g_strdup (src->group);
+  dst->priority = g_strdup (src->priority);
+}
+
+void
+prototype_source_shard_info_clear (PrototypeSourceShardInfo * info)
+{
+  g_free (info->codec);
+  g_free (info->group);
+  g_free (info->priority);
+  memset (info, 0, sizeof (PrototypeSourceShardInfo));
+}
+
+guint
+prototype_shard_plan_drop_empty (PrototypeShardPlan * plan)
+{
+  guint *counts = g_new0 (guint, plan->num_shards);
+  guint *remap = g_new0 (guint, plan->num_shards);
+  guint i, n = 0, dropped = 0;
+
+  for (i = 0; i < plan->num_items; i++)
+    counts[plan->assignment[i]]++;
+
+  for (i = 0; i < plan->num_shards; i++) {
+    if (counts[i] == 0) {
+      dropped++;
+      continue;
+    }
+    remap[i] = n;
+    plan->loads[n] = plan->loads[i];
+    n++;
+  }
+  for (i = 0; i < plan->num_items; i++)
+    plan->assignment[i] = remap[plan->assignment[i]];
+  plan->num_shards = n;
+
+  g_free (remap);
+  g_free (counts);
+  return dropped;
+}
+
+GHashTable *
+prototype_shard_state_load (const gchar * path)
+{
+  GHashTable *state = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+  gchar *contents = NULL;
+  gchar **lines = NULL;
+  guint i;
+
+  if (!path || !g_file_get_contents (path, &contents, NULL, NULL))
+    return state;
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++) {
+    gchar *comma = strchr (lines[i], ',');
+    gchar *end = NULL;
+    guint64 shard = 0;
+
+    if (!comma)
+      continue;
+    *comma = '\0';
+    shard = g_ascii_strtoull (lines[i], &end, 10);
+    if (end == lines[i] || *(comma + 1) == '\0')
+      continue;
+    g_hash_table_replace (state, g_strdup (g_strchomp (comma + 1)),
+        GUINT_TO_POINTER ((guint) shard + 1));
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  return state;
+}
+
+gboolean
+prototype_shard_state_save (const gchar * path,
+    const PrototypeShardItem * items, const PrototypeShardPlan * plan)
+{
+  gboolean ret = FALSE;
+  GString *out = NULL;
+  GError *error = NULL;
+  guint i;
+
+  if (!path || !plan)
+    return FALSE;
+
+  out = g_string_new (NULL);
+  for (i = 0; i < plan->num_items; i++) {
+    g_string_append_printf (out, "%u,%s\n", plan->assignment[i],
+        items[i].key);
+  }
+
+  /* g_file_set_contents는 임시 파일에 쓴 뒤 rename하므로 원자적으로 교체됩니다. */
+  if (!g_file_set_contents (path, out->str, out->len, &error)) {
+    g_printerr ("Failed to write shard state '%s': %s\n", path,
+        error->message);
+    g_error_free (error);
+    goto done;
+  }
+
+  ret = TRUE;
+done:
+  g_string_free (out, TRUE);
+  return ret;
+}
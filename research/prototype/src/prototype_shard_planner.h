@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_SHARD_PLANNER_H__
+#define __PROTOTYPE_SHARD_PLANNER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 비용 1.0의 기준: 1920x1080, 30fps, H.264 */
+#define PROTOTYPE_SHARD_REF_PIXELS (1920.0 * 1080.0)
+#define PROTOTYPE_SHARD_REF_FPS (30.0)
+
+typedef struct
+{
+  // sharding:
+  // enable: 1
+  // num-shards: 4
+  // balance-tolerance: 0.05
+  // codec-weights: h264:1.0;h265:1.3
+  // state-file: shard_state.csv
+  gboolean enable;
+  guint num_shards;
+  gdouble balance_tolerance;
+  gchar *codec_weights;
+  gchar *state_file;
+} PrototypeShardConfig;
+
+/** 소스 CSV의 선택 컬럼 (width,height,fps,codec,group,priority) */
+typedef struct
+{
+  guint width;
+  guint height;
+  gdouble fps;
+  gchar *codec;
+  gchar *group;
+  /** frame-scheduler의 우선순위 클래스 이름 */
+  gchar *priority;
+} PrototypeSourceShardInfo;
+
+typedef struct
+{
+  /** 재배치 사이에서 소스를 식별하는 키 (URI) */
+  const gchar *key;
+  /** 같은 그룹의 소스는 같은 shard에 배치됩니다. NULL이면 단독 */
+  const gchar *group;
+  gdouble weight;
+} PrototypeShardItem;
+
+typedef struct
+{
+  /** item 인덱스 -> shard */
+  guint *assignment;
+  /** shard -> 가중치 합 */
+  gdouble *loads;
+  guint num_items;
+  guint num_shards;
+  /** 이전 배치 대비 shard가 바뀐 item 수 */
+  guint num_moved;
+} PrototypeShardPlan;
+
+/**
+ * @brief  해상도, fps, 코덱 가중치로 소스 비용을 계산합니다.
+ *         0인 값은 기준값으로 간주합니다.
+ */
+gdouble prototype_shard_source_weight (guint width, guint height, gdouble fps,
+    gdouble codec_weight);
+
+/**
+ * @brief  "h264:1.0;h265:1.3" 형식을 소문자 코덱 이름 -> gdouble* 테이블로 변환합니다.
+ */
+GHashTable *prototype_shard_parse_codec_weights (const gchar * spec);
+
+/**
+ * @brief  코덱 가중치를 조회합니다. 테이블에 없으면 1.0입니다.
+ */
+gdouble prototype_shard_codec_weight (GHashTable * codec_weights,
+    const gchar * codec);
+
+/**
+ * @brief  item을 num_shards개로 나눕니다.
+ *
+ *  1. 같은 group의 item을 하나의 단위로 묶습니다.
+ *  2. previous가 있으면 각 단위를 이전 shard(구성원 가중치 다수결)에
+ *     (평균 부하 * (1 + tolerance))를 넘지 않는 범위에서 먼저 유지합니다.
+ *  3. 남은 단위는 가중치 내림차순으로 가장 부하가 적은 shard에 배치합니다(LPT).
+ *
+ * @param  previous [IN] key -> GUINT_TO_POINTER(shard + 1), NULL 가능
+ * @return g_free가 아닌 prototype_shard_plan_free()로 해제합니다.
+ */
+PrototypeShardPlan *prototype_shard_plan (const PrototypeShardItem * items,
+    guint num_items, guint num_shards, gdouble tolerance,
+    GHashTable * previous);
+
+void prototype_shard_plan_free (PrototypeShardPlan * plan);
+
+/**
+ * @brief  src를 dst로 복사하고 문자열은 새로 할당합니다.
+ */
+void prototype_source_shard_info_copy (PrototypeSourceShardInfo * dst,
+    const PrototypeSourceShardInfo * src);
+
+/**
+ * @brief  info가 소유한 문자열을 해제하고 0으로 초기화합니다.
+ */
+void prototype_source_shard_info_clear (PrototypeSourceShardInfo * info);
+
+/**
+ * @brief  item이 하나도 없는 shard를 빼고 남은 shard 번호를 0부터 다시 매깁니다.
+ *         group 수가 num_shards보다 적으면 빈 shard가 생깁니다.
+ * @return 뺀 shard 수. plan->num_shards는 남은 shard 수로 바뀝니다.
+ */
+guint prototype_shard_plan_drop_empty (PrototypeShardPlan * plan);
+
+/**
+ * @brief  state-file을 읽어 key -> GUINT_TO_POINTER(shard + 1) 테이블을 만듭니다.
+ * @return 파일이 없으면 빈 테이블
+ */
+GHashTable *prototype_shard_state_load (const gchar * path);
+
+/**
+ * @brief  배치 결과를 "shard,key" 행으로 state-file에 기록합니다.
+ */
+gboolean prototype_shard_state_save (const gchar * path,
+    const PrototypeShardItem * items, const PrototypeShardPlan * plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <glib-unix.h>
+
+#include "prototype_source_reload.h"
+
+struct _PrototypeSourceWatch
+{
+  gint fd;
+  gchar *file_name;
+  guint min_interval_ms;
+  PrototypeSourceReloadFunc func;
+  gpointer user_data;
+
+  guint fd_source_id;
+  guint timeout_id;
+  /** 마지막으로 func를 호출한 시각 (g_get_monotonic_time, 0이면 없음) */
+  gint64 last_reload_us;
+};
+
+static gboolean
+reload_timeout_cb (gpointer data)
+{
+  PrototypeSourceWatch *watch = (PrototypeSourceWatch *) data;
+
+  watch->timeout_id = 0;
+  watch->last_reload_us = g_get_monotonic_time ();
+  watch->func (watch->user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_reload (PrototypeSourceWatch * watch)
+{
+  gint64 delay_ms = PROTOTYPE_SOURCE_WATCH_SETTLE_MS;
+
+  /* 이미 예약된 재적용이 있으면 그 때 최신 파일을 읽으므로 합칩니다. */
+  if (watch->timeout_id)
+    return;
+
+  if (watch->last_reload_us) {
+    gint64 next_allowed_us =
+        watch->last_reload_us + (gint64) watch->min_interval_ms * 1000;
+    delay_ms = MAX (delay_ms,
+        (next_allowed_us - g_get_monotonic_time ()) / 1000);
+  }
+
+  watch->timeout_id = g_timeout_add ((guint) delay_ms, reload_timeout_cb,
+      watch);
+}
+
+static gboolean
+inotify_cb (gint fd, GIOCondition condition, gpointer data)
+{
+  PrototypeSourceWatch *watch = (PrototypeSourceWatch *) data;
+  gchar buf[4096]
+      __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  gboolean changed = FALSE;
+  ssize_t len;
+
+  while ((len = read (fd, buf, sizeof (buf))) > 0) {
+    gchar *ptr = buf;
+
+    while (ptr < buf + len) {
+      const struct inotify_event *event = (const struct inotify_event *) ptr;
+
+      if (event->mask & IN_Q_OVERFLOW)
+        changed = TRUE;
+      else if (event->len > 0 && !g_strcmp0 (event->name, watch->file_name))
+        changed = TRUE;
+      ptr += sizeof (struct inotify_event) + event->len;
+    }
+  }
+
+  if (len < 0 && errno != EAGAIN && errno != EINTR) {
+    g_printerr ("Source watch read failed: %s\n", g_strerror (errno));
+    watch->fd_source_id = 0;
+    return G_SOURCE_REMOVE;
+  }
+
+  if (changed)
+    schedule_reload (watch);
+
+  return G_SOURCE_CONTINUE;
+}
+
+PrototypeSourceWatch *
+prototype_source_watch_new (const gchar * path, guint min_interval_ms,
+    PrototypeSourceReloadFunc func, gpointer user_data)
+{
+  PrototypeSourceWatch *watch = NULL;
+  gchar *dir = NULL;
+
+  if (!path || !func)
+    return NULL;
+
+  watch = g_new0 (PrototypeSourceWatch, 1);
+  watch->fd = -1;
+  watch->file_name = g_path_get_basename (path);
+  watch->min_interval_ms = min_interval_ms;
+  watch->func = func;
+  watch->user_data = user_data;
+
+  watch->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (watch->fd < 0) {
+    g_printerr ("inotify_init1 failed: %s\n", g_strerror (errno));
+    goto error;
+  }
+
+  dir = g_path_get_dirname (path);
+  if (inotify_add_watch (watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    g_printerr ("Failed to watch '%s': %s\n", dir, g_strerror (errno));
+    goto error;
+  }
+  g_free (dir);
+
+  watch->fd_source_id = g_unix_fd_add (watch->fd, G_IO_IN, inotify_cb, watch);
+  return watch;
+
+error:
+  g_free (dir);
+  prototype_source_watch_free (watch);
+  return NULL;
+}
+
+void
+prototype_source_watch_free (PrototypeSourceWatch * watch)
+{
+  if (!watch)
+    return;
+
+  if (watch->timeout_id)
+    g_source_remove (watch->timeout_id);
+  if (watch->fd_source_id)
+    g_source_remove (watch->fd_source_id);
+  if (watch->fd >= 0)
+    close (watch->fd);
+  g_free (watch->file_name);
+  g_free (watch);
+}
+
+gchar *
+prototype_source_key (guint sensor_id, const gchar * uri)
+{
+  return g_strdup_printf ("%u|%s", sensor_id, uri ? uri : "");
+}
+
+void
+prototype_source_diff (gchar ** current, guint num_current,
+    gchar ** next, guint num_next, GArray * removed, GArray * added)
+{
+  /* 키 -> 아직 짝이 없는 source_id 목록 */
+  GHashTable *unmatched = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, (GDestroyNotify) g_queue_free);
+  gboolean *kept = g_new0 (gboolean, MAX (num_current, 1));
+  guint i;
+
+  for (i = 0; i < num_current; i++) {
+    GQueue *ids = NULL;
+
+    if (!current[i])
+      continue;
+    ids = (GQueue *) g_hash_table_lookup (unmatched, current[i]);
+    if (!ids) {
+      ids = g_queue_new ();
+      g_hash_table_insert (unmatched, current[i], ids);
+    }
+    g_queue_push_tail (ids, GUINT_TO_POINTER (i));
+  }
+
+  for (i = 0; i < num_next; i++) {
+    GQueue *ids = (GQueue *) g_hash_table_lookup (unmatched, next[i]);
+
+    if (ids && !g_queue_is_empty (ids))
+      kept[GPOINTER_TO_UINT (g_queue_pop_head (ids))] = TRUE;
+    else
+      g_array_append_val (added, i);
+  }
+
+  for (i = 0; i < num_current; i++) {
+    if (current[i] && !kept[i])
+      g_array_append_val (removed, i);
+  }
+
+  g_free (kept);
+  g_hash_table_destroy (unmatched);
+}
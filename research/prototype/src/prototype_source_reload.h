@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_SOURCE_RELOAD_H__
+#define __PROTOTYPE_SOURCE_RELOAD_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 파일 변경 이벤트 후 편집기가 쓰기를 마칠 때까지 기다리는 시간 */
+#define PROTOTYPE_SOURCE_WATCH_SETTLE_MS (250)
+
+typedef struct
+{
+  // source-reload:
+  // enable: 1
+  // min-interval-ms: 2000
+  // max-sources: 1024
+  gboolean enable;
+  /** 연속된 두 재적용 사이의 최소 간격 */
+  guint min_interval_ms;
+  /** 실행 중 추가될 소스까지 포함한 소스 슬롯 수 (기본 MAX_SOURCE_BINS) */
+  guint max_sources;
+} PrototypeSourceReloadConfig;
+
+typedef struct _PrototypeSourceWatch PrototypeSourceWatch;
+
+/**
+ * CSV가 바뀌었을 때 메인 루프에서 호출됩니다.
+ * FALSE를 반환해도 감시는 계속됩니다.
+ */
+typedef gboolean (*PrototypeSourceReloadFunc) (gpointer user_data);
+
+/**
+ * @brief  path를 inotify로 감시합니다.
+ *         편집기가 임시 파일을 rename하는 경우도 잡도록 상위 디렉터리를 감시하며,
+ *         변경이 몰리면 하나로 합쳐 min_interval_ms에 최대 한 번 func를 호출합니다.
+ * @return 실패하면 NULL
+ */
+PrototypeSourceWatch *prototype_source_watch_new (const gchar * path,
+    guint min_interval_ms, PrototypeSourceReloadFunc func,
+    gpointer user_data);
+
+void prototype_source_watch_free (PrototypeSourceWatch * watch);
+
+/**
+ * @brief  prototype_source_diff()에 넘길 소스 키를 만듭니다.
+ *         센서 ID(camera-id)와 URI가 모두 같아야 같은 소스로 봅니다.
+ * @return g_free()로 해제할 키
+ */
+gchar *prototype_source_key (guint sensor_id, const gchar * uri);
+
+/**
+ * @brief  현재 소스 목록과 새 목록을 키로 비교합니다.
+ *         같은 키가 여러 번 나오면 개수만큼 짝을 짓습니다.
+ * @param  current [IN] source_id -> 키. NULL은 빈 슬롯입니다.
+ * @param  next [IN] 새 CSV 순서의 키
+ * @param  removed [OUT] 제거할 source_id (guint)
+ * @param  added [OUT] 추가할 next 인덱스 (guint)
+ */
+void prototype_source_diff (gchar ** current, guint num_current,
+    gchar ** next, guint num_next, GArray * removed, GArray * added);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prototype_source_table.h"
+
+#define PAGE_SIZE_SLOTS (1u << PROTOTYPE_SOURCE_TABLE_PAGE_BITS)
+#define PAGE_MASK_SLOTS (PAGE_SIZE_SLOTS - 1)
+
+/** 한 번에 할당하는 슬롯 수 */
+#define CHUNK_SLOTS (64)
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) / (a) * (a))
+
+/** 각 슬롯 앞에 놓이는 헤더. 사용자 데이터는 바로 뒤에 이어집니다. */
+typedef struct
+{
+  guint source_id;
+  gint active;
+} SlotHeader;
+
+#define SLOT_DATA(hdr) ((gpointer) ((guint8 *) (hdr) + sizeof (SlotHeader)))
+
+struct _PrototypeSourceTable
+{
+  gsize slot_size;
+  gsize slot_stride;
+  PrototypeSourceSlotFunc init_func;
+  PrototypeSourceSlotFunc clear_func;
+
+  /** 추가/제거를 직렬화합니다. 조회는 잠그지 않습니다. */
+  GMutex lock;
+  /** pages[source_id >> PAGE_BITS][source_id & PAGE_MASK] -> SlotHeader* */
+  SlotHeader **pages[PROTOTYPE_SOURCE_TABLE_MAX_PAGES];
+  /** posix_memalign으로 할당한 슬롯 묶음 */
+  GPtrArray *chunks;
+  guint8 *next_slot;
+  guint chunk_remaining;
+  guint num_active;
+};
+
+PrototypeSourceTable *
+prototype_source_table_new (gsize slot_size,
+    PrototypeSourceSlotFunc init_func, PrototypeSourceSlotFunc clear_func)
+{
+  PrototypeSourceTable *table = g_new0 (PrototypeSourceTable, 1);
+
+  table->slot_size = slot_size;
+  table->slot_stride = ALIGN_UP (sizeof (SlotHeader) + slot_size,
+      PROTOTYPE_SOURCE_TABLE_CACHE_LINE);
+  table->init_func = init_func;
+  table->clear_func = clear_func;
+  table->chunks = g_ptr_array_new_with_free_func (free);
+  g_mutex_init (&table->lock);
+
+  return table;
+}
+
+static SlotHeader *
+alloc_slot (PrototypeSourceTable * table)
+{
+  SlotHeader *hdr = NULL;
+
+  if (table->chunk_remaining == 0) {
+    void *chunk = NULL;
+    gsize chunk_size = table->slot_stride * CHUNK_SLOTS;
+
+    if (posix_memalign (&chunk, PROTOTYPE_SOURCE_TABLE_CACHE_LINE,
+            chunk_size) != 0)
+      return NULL;
+    memset (chunk, 0, chunk_size);
+    g_ptr_array_add (table->chunks, chunk);
+    table->next_slot = (guint8 *) chunk;
+    table->chunk_remaining = CHUNK_SLOTS;
+  }
+
+  hdr = (SlotHeader *) table->next_slot;
+  table->next_slot += table->slot_stride;
+  table->chunk_remaining--;
+  return hdr;
+}
+
+static inline SlotHeader *
+lookup_header (PrototypeSourceTable * table, guint source_id)
+{
+  SlotHeader **page = NULL;
+
+  if (source_id >= PROTOTYPE_SOURCE_TABLE_MAX_ID)
+    return NULL;
+
+  page = (SlotHeader **) g_atomic_pointer_get (
+      &table->pages[source_id >> PROTOTYPE_SOURCE_TABLE_PAGE_BITS]);
+  if (!page)
+    return NULL;
+
+  return (SlotHeader *) g_atomic_pointer_get (
+      &page[source_id & PAGE_MASK_SLOTS]);
+}
+
+gpointer
+prototype_source_table_lookup (PrototypeSourceTable * table, guint source_id)
+{
+  SlotHeader *hdr = lookup_header (table, source_id);
+
+  if (!hdr || !g_atomic_int_get (&hdr->active))
+    return NULL;
+  return SLOT_DATA (hdr);
+}
+
+gpointer
+prototype_source_table_get (PrototypeSourceTable * table, guint source_id)
+{
+  SlotHeader **page = NULL;
+  SlotHeader *hdr = NULL;
+  gpointer slot = prototype_source_table_lookup (table, source_id);
+
+  if (slot || source_id >= PROTOTYPE_SOURCE_TABLE_MAX_ID)
+    return slot;
+
+  g_mutex_lock (&table->lock);
+  page = table->pages[source_id >> PROTOTYPE_SOURCE_TABLE_PAGE_BITS];
+  if (!page) {
+    page = g_new0 (SlotHeader *, PAGE_SIZE_SLOTS);
+    g_atomic_pointer_set (
+        &table->pages[source_id >> PROTOTYPE_SOURCE_TABLE_PAGE_BITS], page);
+  }
+
+  hdr = page[source_id & PAGE_MASK_SLOTS];
+  if (!hdr) {
+    hdr = alloc_slot (table);
+    if (!hdr)
+      goto done;
+    hdr->source_id = source_id;
+    g_atomic_pointer_set (&page[source_id & PAGE_MASK_SLOTS], hdr);
+  }
+
+  if (!g_atomic_int_get (&hdr->active)) {
+    memset (SLOT_DATA (hdr), 0, table->slot_size);
+    if (table->init_func)
+      table->init_func (source_id, SLOT_DATA (hdr));
+    table->num_active++;
+    g_atomic_int_set (&hdr->active, 1);
+  }
+  slot = SLOT_DATA (hdr);
+
+done:
+  g_mutex_unlock (&table->lock);
+  return slot;
+}
+
+void
+prototype_source_table_remove (PrototypeSourceTable * table, guint source_id)
+{
+  SlotHeader *hdr = NULL;
+
+  g_mutex_lock (&table->lock);
+  hdr = lookup_header (table, source_id);
+  if (hdr && g_atomic_int_get (&hdr->active)) {
+    g_atomic_int_set (&hdr->active, 0);
+    if (table->clear_func)
+      table->clear_func (source_id, SLOT_DATA (hdr));
+    table->num_active--;
+  }
+  g_mutex_unlock (&table->lock);
+}
+
+guint
+prototype_source_table_size (PrototypeSourceTable * table)
+{
+  guint size;
+
+  g_mutex_lock (&table->lock);
+  size = table->num_active;
+  g_mutex_unlock (&table->lock);
+  return size;
+}
+
+void
+prototype_source_table_foreach (PrototypeSourceTable * table,
+    PrototypeSourceSlotForeachFunc func, gpointer user_data)
+{
+  guint p, i;
+
+  g_mutex_lock (&table->lock);
+  for (p = 0; p < PROTOTYPE_SOURCE_TABLE_MAX_PAGES; p++) {
+    SlotHeader **page = table->pages[p];
+    if (!page)
+      continue;
+    for (i = 0; i < PAGE_SIZE_SLOTS; i++) {
+      SlotHeader *hdr = page[i];
+      if (hdr && hdr->active)
+        func (hdr->source_id, SLOT_DATA (hdr), user_data);
+    }
+  }
+  g_mutex_unlock (&table->lock);
+}
+
+static void
+clear_slot_cb (guint source_id, gpointer slot, gpointer user_data)
+{
+  PrototypeSourceTable *table = (PrototypeSourceTable *) user_data;
+  table->clear_func (source_id, slot);
+}
+
+void
+prototype_source_table_free (PrototypeSourceTable * table)
+{
+  guint p;
+
+  if (!table)
+    return;
+
+  if (table->clear_func)
+    prototype_source_table_foreach (table, clear_slot_cb, table);
+
+  for (p = 0; p < PROTOTYPE_SOURCE_TABLE_MAX_PAGES; p++)
+    g_free (table->pages[p]);
+
+  g_ptr_array_free (table->chunks, TRUE);
+  g_mutex_clear (&table->lock);
+  g_free (table);
+}
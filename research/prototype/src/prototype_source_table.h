@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_SOURCE_TABLE_H__
+#define __PROTOTYPE_SOURCE_TABLE_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 슬롯 정렬 단위. 서로 다른 소스의 슬롯은 캐시 라인을 공유하지 않습니다. */
+#define PROTOTYPE_SOURCE_TABLE_CACHE_LINE (64)
+
+/** source_id 인덱스의 페이지 크기(2^PAGE_BITS)와 최대 페이지 수 */
+#define PROTOTYPE_SOURCE_TABLE_PAGE_BITS (8)
+#define PROTOTYPE_SOURCE_TABLE_MAX_PAGES (4096)
+
+/** 지원하는 source_id의 상한 (미포함) */
+#define PROTOTYPE_SOURCE_TABLE_MAX_ID \
+    ((1u << PROTOTYPE_SOURCE_TABLE_PAGE_BITS) * PROTOTYPE_SOURCE_TABLE_MAX_PAGES)
+
+/**
+ * source_id로 인덱싱되는 소스별 슬롯 테이블입니다.
+ * 슬롯은 필요할 때 캐시 라인 정렬로 할당되며 테이블이 해제될 때까지 주소가
+ * 바뀌지 않습니다. 조회는 잠금 없이 수행되고 추가/제거만 내부 뮤텍스로
+ * 직렬화됩니다.
+ */
+typedef struct _PrototypeSourceTable PrototypeSourceTable;
+
+/** 슬롯 초기화/정리 콜백. slot은 0으로 채워진 상태로 init에 전달됩니다. */
+typedef void (*PrototypeSourceSlotFunc) (guint source_id, gpointer slot);
+
+typedef void (*PrototypeSourceSlotForeachFunc) (guint source_id,
+    gpointer slot, gpointer user_data);
+
+PrototypeSourceTable *prototype_source_table_new (gsize slot_size,
+    PrototypeSourceSlotFunc init_func, PrototypeSourceSlotFunc clear_func);
+
+void prototype_source_table_free (PrototypeSourceTable * table);
+
+/**
+ * @brief  source_id의 슬롯을 반환합니다. 없으면 NULL입니다. (잠금 없음)
+ */
+gpointer prototype_source_table_lookup (PrototypeSourceTable * table,
+    guint source_id);
+
+/**
+ * @brief  source_id의 슬롯을 반환하며, 없으면 새로 만들어 초기화합니다.
+ * @return 슬롯 포인터; source_id가 상한을 넘으면 NULL
+ */
+gpointer prototype_source_table_get (PrototypeSourceTable * table,
+    guint source_id);
+
+/**
+ * @brief  슬롯을 정리하고 비활성화합니다. 메모리는 같은 source_id가 다시
+ *         추가될 때 재사용되며, 동시에 조회 중인 스레드를 위해 해제하지 않습니다.
+ */
+void prototype_source_table_remove (PrototypeSourceTable * table,
+    guint source_id);
+
+guint prototype_source_table_size (PrototypeSourceTable * table);
+
+void prototype_source_table_foreach (PrototypeSourceTable * table,
+    PrototypeSourceSlotForeachFunc func, gpointer user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
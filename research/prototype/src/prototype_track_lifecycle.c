@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "deepstream_common.h"
+#include "deepstream_label_table.h"
+#include "prototype_source_table.h"
+#include "prototype_track_lifecycle.h"
+
+#define WHEEL_MASK (TRACK_LIFECYCLE_WHEEL_SLOTS - 1)
+
+G_STATIC_ASSERT ((TRACK_LIFECYCLE_WHEEL_SLOTS & WHEEL_MASK) == 0);
+
+typedef struct _PrototypeTrack PrototypeTrack;
+
+struct _PrototypeTrack
+{
+  /** tracks 해시 테이블의 키 */
+  guint64 object_id;
+  gint class_id;
+  guint label_id;
+  GstClockTime first_ts;
+  GstClockTime last_ts;
+  GstClockTime next_dwell_ts;
+  guint64 num_observations;
+  PrototypeTrajectorySummary trajectory;
+  gfloat best_confidence;
+  PrototypeTrackBox best_box;
+  GstClockTime best_ts;
+  /** 관측 위치의 압축 폴리라인. 트랙을 재사용해도 유지합니다. (NULL 가능) */
+  PrototypeTrajectoryBuffer *polyline;
+  gboolean entered;
+  /** evicted 목록에 있을 때의 exit 이유 */
+  PrototypeTrackExitReason exit_reason;
+
+  /* 타이밍 휠 슬롯의 이중 연결 리스트 */
+  gboolean in_wheel;
+  guint wheel_slot;
+  PrototypeTrack *wheel_prev;
+  PrototypeTrack *wheel_next;
+
+  /* 관측 순서 리스트. head가 가장 오래 관측되지 않은 트랙입니다. */
+  PrototypeTrack *lru_prev;
+  PrototypeTrack *lru_next;
+};
+
+typedef struct
+{
+  /** &object_id -> PrototypeTrack */
+  GHashTable *tracks;
+  PrototypeTrack *wheel[TRACK_LIFECYCLE_WHEEL_SLOTS];
+  /** 마지막으로 처리한 휠 tick */
+  guint64 wheel_tick;
+  GstClockTime now;
+  gboolean started;
+  PrototypeTrack *lru_head;
+  PrototypeTrack *lru_tail;
+  /** 아직 enter 하지 않은 트랙 */
+  GPtrArray *pending;
+  /** 테이블에서 빠졌고 다음 advance()에서 exit를 낸 뒤 해제할 트랙 */
+  GPtrArray *evicted;
+  /** 재사용할 트랙 (wheel_next로 연결) */
+  PrototypeTrack *free_list;
+} TrackSource;
+
+struct _PrototypeTrackLifecycle
+{
+  PrototypeTrackLifecycleConfig config;
+  GstClockTime tick_ns;
+  GstClockTime exit_timeout_ns;
+  GstClockTime dwell_interval_ns;
+  /** source_id -> TrackSource */
+  PrototypeSourceTable *sources;
+  /** 이벤트에 넣을 폴리라인 (trajectory_max_points + 1) */
+  PrototypeTrajectoryPoint *polyline_out;
+  GMutex lock;
+};
+
+static void
+track_free (PrototypeTrack * track)
+{
+  if (track->polyline) {
+    prototype_trajectory_clear (track->polyline);
+    g_free (track->polyline);
+  }
+  g_free (track);
+}
+
+static void
+track_source_init (guint source_id, gpointer slot)
+{
+  TrackSource *src = (TrackSource *) slot;
+
+  src->tracks = g_hash_table_new (g_int64_hash, g_int64_equal);
+  src->pending = g_ptr_array_new ();
+  src->evicted = g_ptr_array_new ();
+}
+
+static void
+track_source_clear (guint source_id, gpointer slot)
+{
+  TrackSource *src = (TrackSource *) slot;
+  GHashTableIter iter;
+  gpointer value;
+  guint i;
+
+  g_hash_table_iter_init (&iter, src->tracks);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    track_free ((PrototypeTrack *) value);
+  g_hash_table_destroy (src->tracks);
+  for (i = 0; i < src->evicted->len; i++)
+    track_free ((PrototypeTrack *) g_ptr_array_index (src->evicted, i));
+  g_ptr_array_free (src->evicted, TRUE);
+  g_ptr_array_free (src->pending, TRUE);
+  while (src->free_list) {
+    PrototypeTrack *track = src->free_list;
+    src->free_list = track->wheel_next;
+    track_free (track);
+  }
+}
+
+PrototypeTrackLifecycle *
+prototype_track_lifecycle_new (PrototypeTrackLifecycleConfig * config)
+{
+  PrototypeTrackLifecycle *lifecycle = NULL;
+
+  if (!config->enable)
+    return NULL;
+
+  lifecycle = g_new0 (PrototypeTrackLifecycle, 1);
+  lifecycle->config = *config;
+  if (lifecycle->config.tick_ms == 0)
+    lifecycle->config.tick_ms = 100;
+  if (lifecycle->config.min_observations == 0)
+    lifecycle->config.min_observations = 1;
+  if (lifecycle->config.max_tracks_per_source == 0)
+    lifecycle->config.max_tracks_per_source = 1024;
+  if (lifecycle->config.trajectory_max_points < 3)
+    lifecycle->config.trajectory_max_points = 3;
+  lifecycle->tick_ns = (GstClockTime) lifecycle->config.tick_ms * GST_MSECOND;
+  lifecycle->exit_timeout_ns =
+      (GstClockTime) lifecycle->config.exit_timeout_ms * GST_MSECOND;
+  lifecycle->dwell_interval_ns =
+      (GstClockTime) lifecycle->config.dwell_interval_sec * GST_SECOND;
+  lifecycle->sources = prototype_source_table_new (sizeof (TrackSource),
+      track_source_init, track_source_clear);
+  if (lifecycle->config.trajectory_tolerance_px > 0)
+    lifecycle->polyline_out = g_new (PrototypeTrajectoryPoint,
+        lifecycle->config.trajectory_max_points + 1);
+  g_mutex_init (&lifecycle->lock);
+
+  return lifecycle;
+}
+
+void
+prototype_track_lifecycle_free (PrototypeTrackLifecycle * lifecycle)
+{
+  if (!lifecycle)
+    return;
+
+  prototype_source_table_free (lifecycle->sources);
+  g_free (lifecycle->polyline_out);
+  g_mutex_clear (&lifecycle->lock);
+  g_free (lifecycle);
+}
+
+static void
+wheel_unlink (TrackSource * src, PrototypeTrack * track)
+{
+  if (!track->in_wheel)
+    return;
+
+  if (track->wheel_prev)
+    track->wheel_prev->wheel_next = track->wheel_next;
+  else
+    src->wheel[track->wheel_slot] = track->wheel_next;
+  if (track->wheel_next)
+    track->wheel_next->wheel_prev = track->wheel_prev;
+  track->wheel_prev = track->wheel_next = NULL;
+  track->in_wheel = FALSE;
+}
+
+/*
+ * 트랙의 다음 마감 시각(exit 또는 dwell)이 속한 슬롯에 넣습니다.
+ * base는 처리가 끝난 tick이며, 휠 한 바퀴보다 먼 마감은 마지막 슬롯에 넣어
+ * 그때 다시 확인합니다.
+ */
+static void
+wheel_schedule (PrototypeTrackLifecycle * lifecycle, TrackSource * src,
+    PrototypeTrack * track, guint64 base)
+{
+  GstClockTime deadline = track->last_ts + lifecycle->exit_timeout_ns;
+  guint64 tick;
+  guint slot;
+
+  if (track->entered && lifecycle->dwell_interval_ns &&
+      track->next_dwell_ts < deadline)
+    deadline = track->next_dwell_ts;
+
+  tick = deadline / lifecycle->tick_ns;
+  if (tick <= base)
+    tick = base + 1;
+  else if (tick > base + TRACK_LIFECYCLE_WHEEL_SLOTS - 1)
+    tick = base + TRACK_LIFECYCLE_WHEEL_SLOTS - 1;
+
+  slot = tick & WHEEL_MASK;
+  track->wheel_slot = slot;
+  track->wheel_prev = NULL;
+  track->wheel_next = src->wheel[slot];
+  if (track->wheel_next)
+    track->wheel_next->wheel_prev = track;
+  src->wheel[slot] = track;
+  track->in_wheel = TRUE;
+}
+
+static void
+lru_unlink (TrackSource * src, PrototypeTrack * track)
+{
+  if (track->lru_prev)
+    track->lru_prev->lru_next = track->lru_next;
+  else
+    src->lru_head = track->lru_next;
+  if (track->lru_next)
+    track->lru_next->lru_prev = track->lru_prev;
+  else
+    src->lru_tail = track->lru_prev;
+  track->lru_prev = track->lru_next = NULL;
+}
+
+static void
+lru_append (TrackSource * src, PrototypeTrack * track)
+{
+  track->lru_prev = src->lru_tail;
+  track->lru_next = NULL;
+  if (src->lru_tail)
+    src->lru_tail->lru_next = track;
+  else
+    src->lru_head = track;
+  src->lru_tail = track;
+}
+
+/* 트랙을 테이블, 휠, 관측 순서, 대기 목록에서 뺍니다. */
+static void
+track_detach (TrackSource * src, PrototypeTrack * track)
+{
+  g_hash_table_remove (src->tracks, &track->object_id);
+  wheel_unlink (src, track);
+  lru_unlink (src, track);
+  if (!track->entered)
+    g_ptr_array_remove_fast (src->pending, track);
+}
+
+static void
+track_release (TrackSource * src, PrototypeTrack * track)
+{
+  track->wheel_next = src->free_list;
+  src->free_list = track;
+}
+
+static void
+track_evict (TrackSource * src, PrototypeTrack * track,
+    PrototypeTrackExitReason reason)
+{
+  track_detach (src, track);
+  track->exit_reason = reason;
+  g_ptr_array_add (src->evicted, track);
+}
+
+static void
+emit (PrototypeTrackLifecycle * lifecycle, PrototypeTrackEventFunc func,
+    gpointer user_data, guint source_id, PrototypeTrack * track, PrototypeTrackEventType type,
+    PrototypeTrackExitReason reason, GstClockTime event_ts)
+{
+  PrototypeTrackEvent event;
+
+  if (!func)
+    return;
+
+  event.type = type;
+  event.exit_reason = reason;
+  event.source_id = source_id;
+  event.object_id = track->object_id;
+  event.class_id = track->class_id;
+  event.label = nvds_label_table_name (track->label_id);
+  event.event_ts = event_ts;
+  event.first_ts = track->first_ts;
+  event.last_ts = track->last_ts;
+  event.num_observations = track->num_observations;
+  event.trajectory = track->trajectory;
+  event.best_confidence = track->best_confidence;
+  event.best_box = track->best_box;
+  event.best_ts = track->best_ts;
+  event.polyline = NULL;
+  event.polyline_len = 0;
+  event.polyline_error = 0;
+  if (track->polyline) {
+    event.polyline = lifecycle->polyline_out;
+    event.polyline_len = prototype_trajectory_flush (track->polyline,
+        lifecycle->polyline_out, &event.polyline_error);
+  }
+  func (&event, user_data);
+}
+
+static void
+flush_evicted (PrototypeTrackLifecycle * lifecycle, TrackSource * src,
+    guint source_id, PrototypeTrackEventFunc func, gpointer user_data)
+{
+  guint i;
+
+  for (i = 0; i < src->evicted->len; i++) {
+    PrototypeTrack *track =
+        (PrototypeTrack *) g_ptr_array_index (src->evicted, i);
+
+    if (track->entered)
+      emit (lifecycle, func, user_data, source_id, track,
+          PROTOTYPE_TRACK_EVENT_EXIT, track->exit_reason, track->last_ts);
+    track_release (src, track);
+  }
+  g_ptr_array_set_size (src->evicted, 0);
+}
+
+/*
+ * 타임스탬프가 exit-timeout 이상 되돌아가면 (파일 반복 재생, 재연결 등)
+ * 기존 트랙을 모두 내보내고 휠을 새 시각에서 다시 시작합니다.
+ */
+static void
+sync_time (PrototypeTrackLifecycle * lifecycle, TrackSource * src,
+    GstClockTime ts)
+{
+  if (src->started && ts + lifecycle->exit_timeout_ns >= src->now)
+    return;
+
+  if (src->started) {
+    while (src->lru_head)
+      track_evict (src, src->lru_head, PROTOTYPE_TRACK_EXIT_SOURCE_RESET);
+  }
+  src->started = TRUE;
+  src->now = ts;
+  src->wheel_tick = ts / lifecycle->tick_ns;
+}
+
+static void
+trajectory_add (PrototypeTrack * track, const PrototypeTrackBox * box,
+    GstClockTime ts)
+{
+  PrototypeTrajectorySummary *trajectory = &track->trajectory;
+  gfloat x = box->left + box->width / 2;
+  gfloat y = box->top + box->height;
+
+  if (track->num_observations == 0) {
+    trajectory->start_x = trajectory->min_x = trajectory->max_x = x;
+    trajectory->start_y = trajectory->min_y = trajectory->max_y = y;
+  } else {
+    trajectory->path_length +=
+        hypotf (x - trajectory->end_x, y - trajectory->end_y);
+    trajectory->min_x = MIN (trajectory->min_x, x);
+    trajectory->min_y = MIN (trajectory->min_y, y);
+    trajectory->max_x = MAX (trajectory->max_x, x);
+    trajectory->max_y = MAX (trajectory->max_y, y);
+  }
+  trajectory->end_x = x;
+  trajectory->end_y = y;
+
+  if (track->polyline)
+    prototype_trajectory_add (track->polyline, x, y,
+        (guint32) (ts > track->first_ts ?
+            (ts - track->first_ts) / GST_MSECOND : 0));
+}
+
+void
+prototype_track_lifecycle_observe (PrototypeTrackLifecycle * lifecycle,
+    guint source_id, guint64 object_id, gint class_id, guint label_id,
+    gfloat confidence, const PrototypeTrackBox * box, GstClockTime ts)
+{
+  TrackSource *src = NULL;
+  PrototypeTrack *track = NULL;
+  PrototypeTrajectoryBuffer *polyline = NULL;
+
+  g_mutex_lock (&lifecycle->lock);
+  src = (TrackSource *) prototype_source_table_get (lifecycle->sources,
+      source_id);
+  if (!src)
+    goto done;
+  sync_time (lifecycle, src, ts);
+
+  track = (PrototypeTrack *) g_hash_table_lookup (src->tracks, &object_id);
+  if (!track) {
+    if (g_hash_table_size (src->tracks) >=
+        lifecycle->config.max_tracks_per_source)
+      track_evict (src, src->lru_head, PROTOTYPE_TRACK_EXIT_EVICTED);
+
+    track = src->free_list;
+    if (track) {
+      src->free_list = track->wheel_next;
+      polyline = track->polyline;
+    } else {
+      track = g_new (PrototypeTrack, 1);
+      if (lifecycle->config.trajectory_tolerance_px > 0) {
+        polyline = g_new (PrototypeTrajectoryBuffer, 1);
+        prototype_trajectory_init (polyline,
+            lifecycle->config.trajectory_tolerance_px,
+            lifecycle->config.trajectory_max_points);
+      }
+    }
+    memset (track, 0, sizeof (PrototypeTrack));
+    track->polyline = polyline;
+    if (polyline)
+      prototype_trajectory_reset (polyline);
+    track->object_id = object_id;
+    track->first_ts = track->last_ts = ts;
+    track->best_confidence = -1;
+    g_hash_table_insert (src->tracks, &track->object_id, track);
+    lru_append (src, track);
+    g_ptr_array_add (src->pending, track);
+    wheel_schedule (lifecycle, src, track, src->wheel_tick);
+  } else {
+    lru_unlink (src, track);
+    lru_append (src, track);
+  }
+
+  /* 마감 시각은 늘어나기만 하므로 휠은 슬롯이 돌아올 때 다시 확인합니다. */
+  track->last_ts = MAX (track->last_ts, ts);
+  track->class_id = class_id;
+  if (label_id)
+    track->label_id = label_id;
+  trajectory_add (track, box, ts);
+  track->num_observations++;
+  if (confidence >= 0 && confidence > track->best_confidence) {
+    track->best_confidence = confidence;
+    track->best_box = *box;
+    track->best_ts = ts;
+  }
+
+done:
+  g_mutex_unlock (&lifecycle->lock);
+}
+
+static void
+process_slot (PrototypeTrackLifecycle * lifecycle, TrackSource * src,
+    guint source_id, guint64 tick, PrototypeTrackEventFunc func,
+    gpointer user_data)
+{
+  PrototypeTrack *track = src->wheel[tick & WHEEL_MASK];
+
+  src->wheel[tick & WHEEL_MASK] = NULL;
+  while (track) {
+    PrototypeTrack *next = track->wheel_next;
+
+    track->in_wheel = FALSE;
+    track->wheel_prev = track->wheel_next = NULL;
+
+    if (src->now >= track->last_ts + lifecycle->exit_timeout_ns) {
+      track_detach (src, track);
+      if (track->entered)
+        emit (lifecycle, func, user_data, source_id, track,
+            PROTOTYPE_TRACK_EVENT_EXIT, PROTOTYPE_TRACK_EXIT_TIMEOUT,
+            track->last_ts);
+      track_release (src, track);
+    } else {
+      if (track->entered && lifecycle->dwell_interval_ns &&
+          src->now >= track->next_dwell_ts) {
+        emit (lifecycle, func, user_data, source_id, track,
+            PROTOTYPE_TRACK_EVENT_DWELL, PROTOTYPE_TRACK_EXIT_NONE,
+            track->next_dwell_ts);
+        track->next_dwell_ts += lifecycle->dwell_interval_ns;
+        /* 오래 멈춰 있었다면 밀린 dwell은 건너뜁니다. */
+        if (track->next_dwell_ts <= src->now)
+          track->next_dwell_ts = src->now + lifecycle->dwell_interval_ns;
+      }
+      wheel_schedule (lifecycle, src, track, tick);
+    }
+    track = next;
+  }
+}
+
+void
+prototype_track_lifecycle_advance (PrototypeTrackLifecycle * lifecycle,
+    guint source_id, GstClockTime ts, PrototypeTrackEventFunc func,
+    gpointer user_data)
+{
+  TrackSource *src = NULL;
+  guint64 now_tick, tick;
+  guint i;
+
+  g_mutex_lock (&lifecycle->lock);
+  src = (TrackSource *) prototype_source_table_get (lifecycle->sources,
+      source_id);
+  if (!src)
+    goto done;
+  sync_time (lifecycle, src, ts);
+  src->now = MAX (src->now, ts);
+
+  /* 같은 object_id가 다시 enter 하기 전에 밀려난 트랙의 exit를 먼저 냅니다. */
+  flush_evicted (lifecycle, src, source_id, func, user_data);
+
+  for (i = 0; i < src->pending->len;) {
+    PrototypeTrack *track =
+        (PrototypeTrack *) g_ptr_array_index (src->pending, i);
+
+    if (track->num_observations < lifecycle->config.min_observations) {
+      i++;
+      continue;
+    }
+    g_ptr_array_remove_index_fast (src->pending, i);
+    track->entered = TRUE;
+    track->next_dwell_ts = track->first_ts + lifecycle->dwell_interval_ns;
+    if (track->next_dwell_ts <= src->now)
+      track->next_dwell_ts = src->now + lifecycle->dwell_interval_ns;
+    emit (lifecycle, func, user_data, source_id, track,
+        PROTOTYPE_TRACK_EVENT_ENTER, PROTOTYPE_TRACK_EXIT_NONE,
+        track->first_ts);
+    /* dwell 시각이 exit 마감보다 빠를 수 있으므로 다시 넣습니다. */
+    wheel_unlink (src, track);
+    wheel_schedule (lifecycle, src, track, src->wheel_tick);
+  }
+
+  now_tick = src->now / lifecycle->tick_ns;
+  if (now_tick > src->wheel_tick) {
+    tick = src->wheel_tick + 1;
+    if (now_tick - src->wheel_tick > TRACK_LIFECYCLE_WHEEL_SLOTS)
+      tick = now_tick - TRACK_LIFECYCLE_WHEEL_SLOTS + 1;
+    for (; tick <= now_tick; tick++)
+      process_slot (lifecycle, src, source_id, tick, func, user_data);
+    src->wheel_tick = now_tick;
+  }
+
+done:
+  g_mutex_unlock (&lifecycle->lock);
+}
+
+void
+prototype_track_lifecycle_remove_source (PrototypeTrackLifecycle *
+    lifecycle, guint source_id, PrototypeTrackEventFunc func,
+    gpointer user_data)
+{
+  TrackSource *src = NULL;
+
+  g_mutex_lock (&lifecycle->lock);
+  src = (TrackSource *) prototype_source_table_lookup (lifecycle->sources,
+      source_id);
+  if (!src)
+    goto done;
+
+  while (src->lru_head)
+    track_evict (src, src->lru_head, PROTOTYPE_TRACK_EXIT_SOURCE_RESET);
+  flush_evicted (lifecycle, src, source_id, func, user_data);
+  prototype_source_table_remove (lifecycle->sources, source_id);
+
+done:
+  g_mutex_unlock (&lifecycle->lock);
+}
+
+guint
+prototype_track_lifecycle_num_tracks (PrototypeTrackLifecycle * lifecycle,
+    guint source_id)
+{
+  TrackSource *src = NULL;
+  guint num = 0;
+
+  g_mutex_lock (&lifecycle->lock);
+  src = (TrackSource *) prototype_source_table_lookup (lifecycle->sources,
+      source_id);
+  if (src)
+    num = g_hash_table_size (src->tracks);
+  g_mutex_unlock (&lifecycle->lock);
+  return num;
+}
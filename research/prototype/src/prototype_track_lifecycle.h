@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_TRACK_LIFECYCLE_H__
+#define __PROTOTYPE_TRACK_LIFECYCLE_H__
+
+#include <gst/gst.h>
+
+#include "prototype_trajectory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 타이밍 휠 슬롯 수 (2의 거듭제곱). 더 먼 만료 시각은 도중에 다시 확인됩니다. */
+#define TRACK_LIFECYCLE_WHEEL_SLOTS (256)
+
+typedef struct
+{
+  // track-lifecycle:
+  // enable: 1
+  // dwell-interval-sec: 10
+  // exit-timeout-ms: 2000
+  // min-observations: 3
+  // max-tracks-per-source: 1024
+  // tick-ms: 100
+  // trajectory-tolerance-px: 4
+  // trajectory-max-points: 32
+  gboolean enable;
+  /** enter 이후 이 주기마다 dwell 이벤트를 냅니다. 0이면 dwell 없음 */
+  guint dwell_interval_sec;
+  /** 마지막 관측 후 이 시간 동안 보이지 않으면 exit 합니다. (가림 허용 시간) */
+  guint exit_timeout_ms;
+  /** 이 횟수만큼 관측된 뒤에 enter 합니다. 짧게 생겼다 사라지는 트랙을 거릅니다. */
+  guint min_observations;
+  /** 소스별 최대 트랙 수. 넘으면 가장 오래 관측되지 않은 트랙을 exit 합니다. */
+  guint max_tracks_per_source;
+  /** 타이밍 휠의 시간 단위. exit/dwell 시각의 해상도입니다. */
+  guint tick_ms;
+  /**
+   * 압축 궤적의 허용 오차 (픽셀). 모든 관측 위치는 폴리라인에서 이 거리 이내입니다.
+   * 0이면 폴리라인을 만들지 않습니다.
+   */
+  gfloat trajectory_tolerance_px;
+  /** 이벤트 사이 트랙별 최대 꼭짓점 수. 넘으면 오차가 커지는 대신 꼭짓점을 합칩니다. */
+  guint trajectory_max_points;
+} PrototypeTrackLifecycleConfig;
+
+typedef enum
+{
+  PROTOTYPE_TRACK_EVENT_ENTER,
+  PROTOTYPE_TRACK_EVENT_DWELL,
+  PROTOTYPE_TRACK_EVENT_EXIT,
+} PrototypeTrackEventType;
+
+typedef enum
+{
+  PROTOTYPE_TRACK_EXIT_NONE,
+  /** exit-timeout-ms 동안 관측되지 않음 */
+  PROTOTYPE_TRACK_EXIT_TIMEOUT,
+  /** max-tracks-per-source를 넘어 밀려남 */
+  PROTOTYPE_TRACK_EXIT_EVICTED,
+  /** 소스가 제거되었거나 타임스탬프가 exit-timeout-ms 이상 되돌아감 */
+  PROTOTYPE_TRACK_EXIT_SOURCE_RESET,
+} PrototypeTrackExitReason;
+
+typedef struct
+{
+  gfloat left;
+  gfloat top;
+  gfloat width;
+  gfloat height;
+} PrototypeTrackBox;
+
+/** 관측 위치(bbox 하단 중앙)의 요약. 좌표는 observe()에 준 bbox 좌표계입니다. */
+typedef struct
+{
+  gfloat start_x;
+  gfloat start_y;
+  gfloat end_x;
+  gfloat end_y;
+  /** 지나간 영역 */
+  gfloat min_x;
+  gfloat min_y;
+  gfloat max_x;
+  gfloat max_y;
+  /** 연속한 관측 위치 사이 거리의 합 */
+  gfloat path_length;
+} PrototypeTrajectorySummary;
+
+typedef struct
+{
+  PrototypeTrackEventType type;
+  PrototypeTrackExitReason exit_reason;
+  guint source_id;
+  guint64 object_id;
+  gint class_id;
+  /** 라벨 테이블의 문자열 (해제하지 않음). 없으면 NULL */
+  const gchar *label;
+  /**
+   * 이벤트 시각. enter는 first_ts, dwell은 예정된 dwell 시각,
+   * exit는 last_ts 입니다.
+   */
+  GstClockTime event_ts;
+  GstClockTime first_ts;
+  GstClockTime last_ts;
+  guint64 num_observations;
+  PrototypeTrajectorySummary trajectory;
+  /** confidence가 가장 높았던 관측 */
+  gfloat best_confidence;
+  PrototypeTrackBox best_box;
+  GstClockTime best_ts;
+  /**
+   * 직전 이벤트 이후 관측 위치의 압축 폴리라인 (t_ms는 first_ts 기준).
+   * 첫 점은 직전 이벤트 폴리라인의 끝점입니다. 콜백 안에서만 유효합니다.
+   * trajectory-tolerance-px가 0이면 NULL 입니다.
+   */
+  const PrototypeTrajectoryPoint *polyline;
+  guint polyline_len;
+  /** 관측 위치와 polyline 사이 거리의 상한 */
+  gfloat polyline_error;
+} PrototypeTrackEvent;
+
+typedef void (*PrototypeTrackEventFunc) (const PrototypeTrackEvent * event,
+    gpointer user_data);
+
+/**
+ * 트래커 object_id 별로 관측을 모아 enter/dwell/exit 이벤트를 만듭니다.
+ * exit/dwell 시각은 소스별 타이밍 휠로 관리하며, 관측 시에는 휠을 건드리지 않고
+ * 슬롯이 돌아왔을 때 실제 마감 시각을 다시 확인합니다 (관측 O(1)).
+ * 시간은 observe()/advance()에 주는 소스의 프레임 타임스탬프(ns) 기준입니다.
+ * 이벤트는 advance()/remove_source() 안에서만 콜백으로 전달됩니다.
+ */
+typedef struct _PrototypeTrackLifecycle PrototypeTrackLifecycle;
+
+/**
+ * @return 비활성 시 NULL
+ */
+PrototypeTrackLifecycle *prototype_track_lifecycle_new
+    (PrototypeTrackLifecycleConfig * config);
+
+/** 이벤트를 내지 않고 모든 트랙을 버립니다. */
+void prototype_track_lifecycle_free (PrototypeTrackLifecycle * lifecycle);
+
+/**
+ * @brief  한 프레임의 객체 관측을 기록합니다.
+ * @param  label_id 라벨 테이블 id (0이면 없음)
+ * @param  confidence 0 미만이면 best 스냅샷 비교에서 제외합니다.
+ */
+void prototype_track_lifecycle_observe (PrototypeTrackLifecycle * lifecycle,
+    guint source_id, guint64 object_id, gint class_id, guint label_id,
+    gfloat confidence, const PrototypeTrackBox * box, GstClockTime ts);
+
+/**
+ * @brief  소스의 시간을 ts로 진행하고 그동안 생긴 이벤트를 func로 전달합니다.
+ *         프레임의 observe()를 모두 호출한 뒤 프레임마다 한 번 호출합니다.
+ *         func는 내부 잠금을 잡은 채 호출되므로 lifecycle 함수를 부르면 안 됩니다.
+ */
+void prototype_track_lifecycle_advance (PrototypeTrackLifecycle * lifecycle,
+    guint source_id, GstClockTime ts, PrototypeTrackEventFunc func,
+    gpointer user_data);
+
+/**
+ * @brief  소스의 enter한 트랙을 모두 exit(SOURCE_RESET)로 내보내고 상태를 지웁니다.
+ *         func가 NULL이면 이벤트 없이 지웁니다.
+ */
+void prototype_track_lifecycle_remove_source (PrototypeTrackLifecycle *
+    lifecycle, guint source_id, PrototypeTrackEventFunc func,
+    gpointer user_data);
+
+/** 소스의 현재 트랙 수 (enter 전 트랙 포함) */
+guint prototype_track_lifecycle_num_tracks (PrototypeTrackLifecycle *
+    lifecycle, guint source_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "prototype_trajectory.h"
+
+static gfloat
+segment_distance2 (const PrototypeTrajectoryPoint * p,
+    const PrototypeTrajectoryPoint * a, const PrototypeTrajectoryPoint * b)
+{
+  gfloat dx = b->x - a->x;
+  gfloat dy = b->y - a->y;
+  gfloat len2 = dx * dx + dy * dy;
+  gfloat t = 0;
+  gfloat ex, ey;
+
+  if (len2 > 0) {
+    t = ((p->x - a->x) * dx + (p->y - a->y) * dy) / len2;
+    t = CLAMP (t, 0, 1);
+  }
+  ex = p->x - (a->x + t * dx);
+  ey = p->y - (a->y + t * dy);
+  return ex * ex + ey * ey;
+}
+
+gfloat
+prototype_trajectory_segment_distance (const PrototypeTrajectoryPoint * p,
+    const PrototypeTrajectoryPoint * a, const PrototypeTrajectoryPoint * b)
+{
+  return sqrtf (segment_distance2 (p, a, b));
+}
+
+/* window[0..count-1]과 선분 a-b 사이 거리의 최댓값 (제곱) */
+static gfloat
+window_max_distance2 (PrototypeTrajectoryBuffer * buffer, guint count,
+    const PrototypeTrajectoryPoint * a, const PrototypeTrajectoryPoint * b)
+{
+  gfloat max = 0;
+  guint i;
+
+  for (i = 0; i < count; i++)
+    max = MAX (max, segment_distance2 (&buffer->window[i], a, b));
+  return max;
+}
+
+static gboolean
+window_fits (PrototypeTrajectoryBuffer * buffer,
+    const PrototypeTrajectoryPoint * p)
+{
+  const PrototypeTrajectoryPoint *anchor =
+      &buffer->points[buffer->num_points - 1];
+  gfloat tolerance2 = buffer->tolerance * buffer->tolerance;
+  guint i;
+
+  for (i = 0; i < buffer->num_window; i++) {
+    if (segment_distance2 (&buffer->window[i], anchor, p) > tolerance2)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * 내부 꼭짓점 v (이웃 a, b)를 지우면 a-v, v-b 위의 점은 a-b에서
+ * dist(v, a-b) 이내입니다 (선분까지의 거리는 볼록 함수라 끝점에서 최대).
+ * 따라서 새 선분의 오차 상한은 max(err(a-v), err(v-b)) + dist(v, a-b)이며,
+ * 이 값이 가장 작은 꼭짓점을 지웁니다. 마지막 꼭짓점(anchor)은 남깁니다.
+ */
+static void
+drop_vertex (PrototypeTrajectoryBuffer * buffer)
+{
+  gfloat best_error = G_MAXFLOAT;
+  guint best = 1;
+  guint i;
+
+  for (i = 1; i + 1 < buffer->num_points; i++) {
+    gfloat error = MAX (buffer->errors[i - 1], buffer->errors[i]) +
+        prototype_trajectory_segment_distance (&buffer->points[i],
+        &buffer->points[i - 1], &buffer->points[i + 1]);
+
+    if (error < best_error) {
+      best_error = error;
+      best = i;
+    }
+  }
+
+  buffer->errors[best - 1] = best_error;
+  memmove (&buffer->points[best], &buffer->points[best + 1],
+      (buffer->num_points - best - 1) * sizeof (PrototypeTrajectoryPoint));
+  memmove (&buffer->errors[best], &buffer->errors[best + 1],
+      (buffer->num_points - best - 2) * sizeof (gfloat));
+  buffer->num_points--;
+}
+
+/* 창의 마지막 점을 꼭짓점으로 확정합니다. */
+static void
+commit_vertex (PrototypeTrajectoryBuffer * buffer)
+{
+  PrototypeTrajectoryPoint vertex = buffer->window[buffer->num_window - 1];
+  gfloat error = sqrtf (window_max_distance2 (buffer, buffer->num_window - 1,
+          &buffer->points[buffer->num_points - 1], &vertex));
+
+  if (buffer->num_points == buffer->max_points)
+    drop_vertex (buffer);
+  buffer->errors[buffer->num_points - 1] = error;
+  buffer->points[buffer->num_points++] = vertex;
+  buffer->num_window = 0;
+}
+
+void
+prototype_trajectory_init (PrototypeTrajectoryBuffer * buffer,
+    gfloat tolerance, guint max_points)
+{
+  memset (buffer, 0, sizeof (PrototypeTrajectoryBuffer));
+  buffer->tolerance = MAX (tolerance, 0);
+  buffer->max_points = MAX (max_points, 3);
+  buffer->points = g_new (PrototypeTrajectoryPoint, buffer->max_points);
+  buffer->errors = g_new (gfloat, buffer->max_points);
+}
+
+void
+prototype_trajectory_clear (PrototypeTrajectoryBuffer * buffer)
+{
+  g_free (buffer->points);
+  g_free (buffer->errors);
+  buffer->points = NULL;
+  buffer->errors = NULL;
+  buffer->num_points = buffer->num_window = 0;
+}
+
+void
+prototype_trajectory_reset (PrototypeTrajectoryBuffer * buffer)
+{
+  buffer->num_points = buffer->num_window = 0;
+}
+
+void
+prototype_trajectory_add (PrototypeTrajectoryBuffer * buffer,
+    gfloat x, gfloat y, guint32 t_ms)
+{
+  PrototypeTrajectoryPoint point = { x, y, t_ms };
+
+  if (buffer->num_points == 0) {
+    buffer->points[buffer->num_points++] = point;
+    return;
+  }
+
+  if (buffer->num_window == PROTOTYPE_TRAJECTORY_WINDOW ||
+      !window_fits (buffer, &point))
+    commit_vertex (buffer);
+  buffer->window[buffer->num_window++] = point;
+}
+
+guint
+prototype_trajectory_flush (PrototypeTrajectoryBuffer * buffer,
+    PrototypeTrajectoryPoint * out, gfloat * max_error)
+{
+  gfloat error = 0;
+  guint num = buffer->num_points;
+  guint i;
+
+  if (num == 0)
+    goto done;
+
+  memcpy (out, buffer->points, num * sizeof (PrototypeTrajectoryPoint));
+  for (i = 0; i + 1 < num; i++)
+    error = MAX (error, buffer->errors[i]);
+  if (buffer->num_window) {
+    out[num] = buffer->window[buffer->num_window - 1];
+    error = MAX (error, sqrtf (window_max_distance2 (buffer,
+                buffer->num_window - 1, &out[num - 1], &out[num])));
+    num++;
+  }
+
+  /* 다음 구간은 이번 끝점에서 시작합니다. */
+  buffer->points[0] = out[num - 1];
+  buffer->num_points = 1;
+  buffer->num_window = 0;
+
+done:
+  if (max_error)
+    *max_error = error;
+  return num;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_TRAJECTORY_H__
+#define __PROTOTYPE_TRAJECTORY_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 마지막 꼭짓점 이후 보관하는 최대 점 수. 넘으면 꼭짓점을 확정합니다. */
+#define PROTOTYPE_TRAJECTORY_WINDOW (32)
+
+typedef struct
+{
+  gfloat x;
+  gfloat y;
+  /** 트랙 첫 관측으로부터의 시간 (ms) */
+  guint32 t_ms;
+} PrototypeTrajectoryPoint;
+
+/**
+ * 온라인 궤적 압축 버퍼 (opening-window Douglas-Peucker).
+ *
+ * 마지막 꼭짓점(anchor)부터 새 점까지의 선분에서 그 사이의 모든 점이
+ * tolerance 이내이면 새 점을 창에 넣고, 아니면 직전 점을 꼭짓점으로 확정합니다.
+ * 따라서 모든 입력 점은 압축된 폴리라인의 해당 선분에서 tolerance 이내입니다.
+ *
+ * 꼭짓점이 max_points에 도달하면 제거했을 때 오차 상한이 가장 작게 늘어나는
+ * 내부 꼭짓점을 하나 지웁니다. 선분마다 오차 상한을 유지하므로 이 경우에도
+ * 보고하는 max_error는 실제 오차의 상한입니다.
+ */
+typedef struct
+{
+  gfloat tolerance;
+  guint max_points;
+  /** 확정된 꼭짓점. 마지막 꼭짓점이 anchor 입니다. */
+  PrototypeTrajectoryPoint *points;
+  /** errors[i]는 points[i]~points[i+1] 선분의 오차 상한 */
+  gfloat *errors;
+  guint num_points;
+  /** anchor 이후 아직 꼭짓점이 아닌 점 */
+  PrototypeTrajectoryPoint window[PROTOTYPE_TRAJECTORY_WINDOW];
+  guint num_window;
+} PrototypeTrajectoryBuffer;
+
+/**
+ * @param  max_points 꼭짓점 최대 수 (3 이상)
+ */
+void prototype_trajectory_init (PrototypeTrajectoryBuffer * buffer,
+    gfloat tolerance, guint max_points);
+
+void prototype_trajectory_clear (PrototypeTrajectoryBuffer * buffer);
+
+/** 꼭짓점을 모두 지웁니다. 할당된 메모리는 유지합니다. */
+void prototype_trajectory_reset (PrototypeTrajectoryBuffer * buffer);
+
+void prototype_trajectory_add (PrototypeTrajectoryBuffer * buffer,
+    gfloat x, gfloat y, guint32 t_ms);
+
+/**
+ * @brief  지금까지의 폴리라인을 out에 씁니다. 창의 마지막 점이 끝점이 됩니다.
+ *         이후 버퍼는 그 끝점 하나에서 다시 시작하므로, 연속한 flush 결과를
+ *         이어 붙이면 (겹치는 끝점 제외) 전체 궤적이 됩니다.
+ * @param  out [OUT] max_points + 1개 이상의 공간
+ * @param  max_error [OUT] 입력 점과 폴리라인 사이 거리의 상한 (NULL 가능)
+ * @return out에 쓴 점 수
+ */
+guint prototype_trajectory_flush (PrototypeTrajectoryBuffer * buffer,
+    PrototypeTrajectoryPoint * out, gfloat * max_error);
+
+/** 점 p와 선분 a-b 사이의 거리 */
+gfloat prototype_trajectory_segment_distance (const PrototypeTrajectoryPoint *
+    p, const PrototypeTrajectoryPoint * a, const PrototypeTrajectoryPoint * b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "prototype_source_table.h"
+#include "prototype_zones.h"
+
+/* 셀 경계 판정 여유 (셀 크기 비율). float 반올림으로 셀 밖에 떨어지는 점을 덮습니다. */
+#define ZONE_CELL_EPSILON (1e-3f)
+
+typedef struct
+{
+  /** 셀 전체가 안에 있는 zone */
+  guint64 inside;
+  /** 경계가 셀을 지나는 zone. 이 셀에서는 폴리곤과 정확히 비교합니다. */
+  guint64 edge;
+} ZoneCell;
+
+struct _PrototypeZoneMap
+{
+  gint ref_count;
+  guint num_zones;
+  gchar **names;
+  gfloat **polygons;
+  guint *num_points;
+  guint grid_width;
+  guint grid_height;
+  ZoneCell *cells;
+};
+
+typedef struct
+{
+  PrototypeZoneMap *map;
+} ZoneSource;
+
+struct _PrototypeZones
+{
+  gboolean drop_outside;
+  /** source_id -> ZoneSource */
+  PrototypeSourceTable *sources;
+  GMutex lock;
+};
+
+gboolean
+prototype_zone_contains (const gfloat * polygon, guint num_points,
+    gfloat x, gfloat y)
+{
+  gboolean inside = FALSE;
+  guint i, j;
+
+  for (i = 0, j = num_points - 1; i < num_points; j = i++) {
+    gfloat xi = polygon[2 * i], yi = polygon[2 * i + 1];
+    gfloat xj = polygon[2 * j], yj = polygon[2 * j + 1];
+
+    if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi)
+      inside = !inside;
+  }
+  return inside;
+}
+
+/* 선분이 닫힌 사각형과 만나는지 (Liang-Barsky) */
+static gboolean
+segment_hits_rect (gfloat x0, gfloat y0, gfloat x1, gfloat y1,
+    gfloat left, gfloat top, gfloat right, gfloat bottom)
+{
+  gfloat p[4] = { x0 - x1, x1 - x0, y0 - y1, y1 - y0 };
+  gfloat q[4] = { x0 - left, right - x0, y0 - top, bottom - y0 };
+  gfloat t0 = 0, t1 = 1;
+  guint k;
+
+  for (k = 0; k < 4; k++) {
+    gfloat u;
+
+    if (p[k] == 0) {
+      if (q[k] < 0)
+        return FALSE;
+      continue;
+    }
+    u = q[k] / p[k];
+    if (p[k] < 0) {
+      if (u > t1)
+        return FALSE;
+      t0 = MAX (t0, u);
+    } else {
+      if (u < t0)
+        return FALSE;
+      t1 = MIN (t1, u);
+    }
+  }
+  return TRUE;
+}
+
+static gboolean
+polygon_hits_rect (const gfloat * polygon, guint num_points,
+    gfloat left, gfloat top, gfloat right, gfloat bottom)
+{
+  guint i, j;
+
+  for (i = 0, j = num_points - 1; i < num_points; j = i++) {
+    if (segment_hits_rect (polygon[2 * j], polygon[2 * j + 1],
+            polygon[2 * i], polygon[2 * i + 1], left, top, right, bottom))
+      return TRUE;
+  }
+  /* 경계가 사각형을 지나지 않으면 사각형 전체가 안이거나 밖입니다. */
+  return prototype_zone_contains (polygon, num_points, left, top);
+}
+
+static guint
+cell_index (gfloat v, guint size)
+{
+  gint i = (gint) floorf (v * size);
+
+  return (guint) CLAMP (i, 0, (gint) size - 1);
+}
+
+static void
+rasterize_zone (PrototypeZoneMap * map, guint zone)
+{
+  const gfloat *polygon = map->polygons[zone];
+  guint num_points = map->num_points[zone];
+  guint64 bit = G_GUINT64_CONSTANT (1) << zone;
+  gfloat cell_w = 1.0f / map->grid_width;
+  gfloat cell_h = 1.0f / map->grid_height;
+  gfloat eps_w = cell_w * ZONE_CELL_EPSILON;
+  gfloat eps_h = cell_h * ZONE_CELL_EPSILON;
+  gfloat min_x = G_MAXFLOAT, min_y = G_MAXFLOAT;
+  gfloat max_x = -G_MAXFLOAT, max_y = -G_MAXFLOAT;
+  guint i, j, cx, cy;
+
+  /* 경계 셀: 변의 bbox 안 셀 중 변이 지나는 셀 */
+  for (i = 0, j = num_points - 1; i < num_points; j = i++) {
+    gfloat x0 = polygon[2 * j], y0 = polygon[2 * j + 1];
+    gfloat x1 = polygon[2 * i], y1 = polygon[2 * i + 1];
+    guint cx0 = cell_index (MIN (x0, x1) - eps_w, map->grid_width);
+    guint cx1 = cell_index (MAX (x0, x1) + eps_w, map->grid_width);
+    guint cy0 = cell_index (MIN (y0, y1) - eps_h, map->grid_height);
+    guint cy1 = cell_index (MAX (y0, y1) + eps_h, map->grid_height);
+
+    min_x = MIN (min_x, x1);
+    min_y = MIN (min_y, y1);
+    max_x = MAX (max_x, x1);
+    max_y = MAX (max_y, y1);
+    for (cy = cy0; cy <= cy1; cy++) {
+      for (cx = cx0; cx <= cx1; cx++) {
+        ZoneCell *cell = &map->cells[cy * map->grid_width + cx];
+
+        if (cell->edge & bit)
+          continue;
+        if (segment_hits_rect (x0, y0, x1, y1, cx * cell_w - eps_w,
+                cy * cell_h - eps_h, (cx + 1) * cell_w + eps_w,
+                (cy + 1) * cell_h + eps_h))
+          cell->edge |= bit;
+      }
+    }
+  }
+
+  /* 경계가 지나지 않는 셀은 전체가 안이거나 밖이므로 중심점으로 정합니다. */
+  for (cy = cell_index (min_y, map->grid_height);
+      cy <= cell_index (max_y, map->grid_height); cy++) {
+    for (cx = cell_index (min_x, map->grid_width);
+        cx <= cell_index (max_x, map->grid_width); cx++) {
+      ZoneCell *cell = &map->cells[cy * map->grid_width + cx];
+
+      if (!(cell->edge & bit) && prototype_zone_contains (polygon,
+              num_points, (cx + 0.5f) * cell_w, (cy + 0.5f) * cell_h))
+        cell->inside |= bit;
+    }
+  }
+}
+
+PrototypeZoneMap *
+prototype_zone_map_new (const PrototypeZoneConfig * zones, guint num_zones,
+    guint grid_width, guint grid_height)
+{
+  PrototypeZoneMap *map = NULL;
+  guint i;
+
+  if (num_zones > PROTOTYPE_ZONES_MAX_PER_SOURCE || grid_width == 0 ||
+      grid_height == 0)
+    return NULL;
+  for (i = 0; i < num_zones; i++) {
+    if (zones[i].num_points < 3)
+      return NULL;
+  }
+
+  map = g_new0 (PrototypeZoneMap, 1);
+  map->ref_count = 1;
+  map->num_zones = num_zones;
+  map->names = g_new0 (gchar *, num_zones);
+  map->polygons = g_new0 (gfloat *, num_zones);
+  map->num_points = g_new0 (guint, num_zones);
+  map->grid_width = grid_width;
+  map->grid_height = grid_height;
+  map->cells = g_new0 (ZoneCell, (gsize) grid_width * grid_height);
+  for (i = 0; i < num_zones; i++) {
+    map->names[i] = g_strdup (zones[i].name);
+    map->polygons[i] = (gfloat *) g_memdup2 (zones[i].points,
+        zones[i].num_points * 2 * sizeof (gfloat));
+    map->num_points[i] = zones[i].num_points;
+    rasterize_zone (map, i);
+  }
+
+  return map;
+}
+
+PrototypeZoneMap *
+prototype_zone_map_ref (PrototypeZoneMap * map)
+{
+  g_atomic_int_inc (&map->ref_count);
+  return map;
+}
+
+void
+prototype_zone_map_unref (PrototypeZoneMap * map)
+{
+  guint i;
+
+  if (!map || !g_atomic_int_dec_and_test (&map->ref_count))
+    return;
+
+  for (i = 0; i < map->num_zones; i++) {
+    g_free (map->names[i]);
+    g_free (map->polygons[i]);
+  }
+  g_free (map->names);
+  g_free (map->polygons);
+  g_free (map->num_points);
+  g_free (map->cells);
+  g_free (map);
+}
+
+guint
+prototype_zone_map_num_zones (PrototypeZoneMap * map)
+{
+  return map->num_zones;
+}
+
+const gchar *
+prototype_zone_map_name (PrototypeZoneMap * map, guint index)
+{
+  return index < map->num_zones ? map->names[index] : NULL;
+}
+
+void
+prototype_zone_map_lookup_points (PrototypeZoneMap * map,
+    const gfloat * points, guint num_points, guint64 * masks)
+{
+  guint i;
+
+  for (i = 0; i < num_points; i++) {
+    gfloat x = points[2 * i], y = points[2 * i + 1];
+    guint64 mask = 0, edge;
+
+    if (x < 0 || x > 1 || y < 0 || y > 1) {
+      /* 프레임 밖의 점은 격자가 없으므로 모든 zone과 비교합니다. */
+      edge = map->num_zones == 64 ? G_MAXUINT64 :
+          (G_GUINT64_CONSTANT (1) << map->num_zones) - 1;
+    } else {
+      const ZoneCell *cell =
+          &map->cells[cell_index (y, map->grid_height) * map->grid_width +
+          cell_index (x, map->grid_width)];
+
+      mask = cell->inside;
+      edge = cell->edge;
+    }
+
+    while (edge) {
+      guint zone = __builtin_ctzll (edge);
+
+      if (prototype_zone_contains (map->polygons[zone],
+              map->num_points[zone], x, y))
+        mask |= G_GUINT64_CONSTANT (1) << zone;
+      edge &= edge - 1;
+    }
+    masks[i] = mask;
+  }
+}
+
+void
+prototype_zone_map_lookup_boxes (PrototypeZoneMap * map,
+    const PrototypeZoneBox * boxes, guint num_boxes, guint64 * masks)
+{
+  guint i, cx, cy;
+
+  for (i = 0; i < num_boxes; i++) {
+    const PrototypeZoneBox *box = &boxes[i];
+    gfloat right = box->left + box->width;
+    gfloat bottom = box->top + box->height;
+    guint64 mask = 0, edge = 0;
+
+    if (box->left < 0 || box->top < 0 || right > 1 || bottom > 1) {
+      edge = map->num_zones == 64 ? G_MAXUINT64 :
+          (G_GUINT64_CONSTANT (1) << map->num_zones) - 1;
+    } else {
+      guint cx0 = cell_index (box->left, map->grid_width);
+      guint cx1 = cell_index (right, map->grid_width);
+      guint cy0 = cell_index (box->top, map->grid_height);
+      guint cy1 = cell_index (bottom, map->grid_height);
+
+      for (cy = cy0; cy <= cy1; cy++) {
+        const ZoneCell *row = &map->cells[cy * map->grid_width];
+
+        for (cx = cx0; cx <= cx1; cx++) {
+          mask |= row[cx].inside;
+          edge |= row[cx].edge;
+        }
+      }
+      edge &= ~mask;
+    }
+
+    while (edge) {
+      guint zone = __builtin_ctzll (edge);
+
+      if (polygon_hits_rect (map->polygons[zone], map->num_points[zone],
+              box->left, box->top, right, bottom))
+        mask |= G_GUINT64_CONSTANT (1) << zone;
+      edge &= edge - 1;
+    }
+    masks[i] = mask;
+  }
+}
+
+static void
+zone_source_clear (guint source_id, gpointer slot)
+{
+  ZoneSource *src = (ZoneSource *) slot;
+
+  prototype_zone_map_unref (src->map);
+}
+
+PrototypeZones *
+prototype_zones_new (PrototypeZonesConfig * config)
+{
+  PrototypeZones *zones = NULL;
+  GArray *source_zones = NULL;
+  guint i, j;
+
+  if (!config->enable)
+    return NULL;
+
+  zones = g_new0 (PrototypeZones, 1);
+  zones->drop_outside = config->drop_outside;
+  zones->sources = prototype_source_table_new (sizeof (ZoneSource), NULL,
+      zone_source_clear);
+  g_mutex_init (&zones->lock);
+
+  /* 설정의 zone을 소스별로 모아 테이블을 만듭니다. */
+  source_zones = g_array_new (FALSE, FALSE, sizeof (PrototypeZoneConfig));
+  for (i = 0; i < config->num_zones; i++) {
+    guint source_id = config->zones[i].source_id;
+    PrototypeZoneMap *map = NULL;
+
+    for (j = 0; j < i; j++) {
+      if (config->zones[j].source_id == source_id)
+        break;
+    }
+    if (j < i)
+      continue;
+
+    g_array_set_size (source_zones, 0);
+    for (j = i; j < config->num_zones; j++) {
+      if (config->zones[j].source_id == source_id)
+        g_array_append_val (source_zones, config->zones[j]);
+    }
+    map = prototype_zone_map_new ((PrototypeZoneConfig *) source_zones->data,
+        source_zones->len, config->grid_width, config->grid_height);
+    if (!map) {
+      g_printerr ("zones: invalid zones for source %u\n", source_id);
+      continue;
+    }
+    prototype_zones_set (zones, source_id, map);
+  }
+  g_array_free (source_zones, TRUE);
+
+  return zones;
+}
+
+void
+prototype_zones_free (PrototypeZones * zones)
+{
+  if (!zones)
+    return;
+
+  prototype_source_table_free (zones->sources);
+  g_mutex_clear (&zones->lock);
+  g_free (zones);
+}
+
+void
+prototype_zones_set (PrototypeZones * zones, guint source_id,
+    PrototypeZoneMap * map)
+{
+  ZoneSource *src = NULL;
+  PrototypeZoneMap *old = NULL;
+
+  g_mutex_lock (&zones->lock);
+  src = (ZoneSource *) prototype_source_table_get (zones->sources, source_id);
+  if (src) {
+    old = src->map;
+    src->map = map;
+  } else {
+    old = map;
+  }
+  g_mutex_unlock (&zones->lock);
+
+  /* 이전 테이블은 마지막 참조가 풀릴 때 해제됩니다. */
+  prototype_zone_map_unref (old);
+}
+
+PrototypeZoneMap *
+prototype_zones_get (PrototypeZones * zones, guint source_id)
+{
+  ZoneSource *src = NULL;
+  PrototypeZoneMap *map = NULL;
+
+  g_mutex_lock (&zones->lock);
+  src = (ZoneSource *) prototype_source_table_lookup (zones->sources,
+      source_id);
+  if (src && src->map)
+    map = prototype_zone_map_ref (src->map);
+  g_mutex_unlock (&zones->lock);
+
+  return map;
+}
+
+gboolean
+prototype_zones_drop_outside (PrototypeZones * zones)
+{
+  return zones->drop_outside;
+}
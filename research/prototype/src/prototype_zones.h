@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROTOTYPE_ZONES_H__
+#define __PROTOTYPE_ZONES_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** 카메라별 최대 zone 수 (zone 마스크 비트 수) */
+#define PROTOTYPE_ZONES_MAX_PER_SOURCE (64)
+
+typedef struct
+{
+  guint source_id;
+  gchar *name;
+  /** x0, y0, x1, y1, ... 프레임 크기로 정규화한 좌표 (0~1) */
+  gfloat *points;
+  /** 꼭짓점 수 (3 이상) */
+  guint num_points;
+} PrototypeZoneConfig;
+
+typedef struct
+{
+  // zones:
+  // enable: 1
+  // grid-width: 128
+  // grid-height: 72
+  // drop-outside: 0
+  // zone-<source-id>-<name>: x0;y0;x1;y1;...
+  gboolean enable;
+  /** 래스터 격자 크기. 셀이 작을수록 정확한 판정이 필요한 경계 셀이 줄어듭니다. */
+  guint grid_width;
+  guint grid_height;
+  /** 어느 zone에도 속하지 않은 객체는 이벤트를 보내지 않습니다. */
+  gboolean drop_outside;
+  PrototypeZoneConfig *zones;
+  guint num_zones;
+} PrototypeZonesConfig;
+
+typedef struct
+{
+  gfloat left;
+  gfloat top;
+  gfloat width;
+  gfloat height;
+} PrototypeZoneBox;
+
+/**
+ * 한 카메라의 zone 폴리곤을 격자로 래스터화한 불변 테이블.
+ * 셀마다 "셀 전체가 안에 있는 zone"과 "경계가 지나는 zone" 마스크를 두어,
+ * 질의는 셀 조회로 끝나고 경계 셀의 zone만 폴리곤과 정확히 비교합니다.
+ * 결과는 짝홀(ray casting) 규칙의 정확한 판정과 같습니다.
+ */
+typedef struct _PrototypeZoneMap PrototypeZoneMap;
+
+/**
+ * @brief  zone 폴리곤을 래스터화합니다. 비트 i는 zones[i] 입니다.
+ * @return num_zones가 PROTOTYPE_ZONES_MAX_PER_SOURCE를 넘거나
+ *         꼭짓점이 3개 미만인 zone이 있으면 NULL
+ */
+PrototypeZoneMap *prototype_zone_map_new (const PrototypeZoneConfig * zones,
+    guint num_zones, guint grid_width, guint grid_height);
+
+PrototypeZoneMap *prototype_zone_map_ref (PrototypeZoneMap * map);
+void prototype_zone_map_unref (PrototypeZoneMap * map);
+
+guint prototype_zone_map_num_zones (PrototypeZoneMap * map);
+const gchar *prototype_zone_map_name (PrototypeZoneMap * map, guint index);
+
+/**
+ * @brief  정규화 좌표 점들 (x0, y0, x1, y1, ...)이 속한 zone 마스크를 masks에 씁니다.
+ */
+void prototype_zone_map_lookup_points (PrototypeZoneMap * map,
+    const gfloat * points, guint num_points, guint64 * masks);
+
+/**
+ * @brief  정규화 좌표 bbox들과 겹치는 (경계 접촉 포함) zone 마스크를 masks에 씁니다.
+ */
+void prototype_zone_map_lookup_boxes (PrototypeZoneMap * map,
+    const PrototypeZoneBox * boxes, guint num_boxes, guint64 * masks);
+
+/** 격자를 쓰지 않는 정확한 판정 (짝홀 규칙) */
+gboolean prototype_zone_contains (const gfloat * polygon, guint num_points,
+    gfloat x, gfloat y);
+
+/** 소스별 현재 PrototypeZoneMap. 교체는 원자적이며 읽는 쪽은 참조를 잡습니다. */
+typedef struct _PrototypeZones PrototypeZones;
+
+/**
+ * @return 비활성 시 NULL
+ */
+PrototypeZones *prototype_zones_new (PrototypeZonesConfig * config);
+void prototype_zones_free (PrototypeZones * zones);
+
+/**
+ * @brief  source_id의 zone 테이블을 map으로 바꿉니다 (map의 참조를 가져갑니다).
+ *         이미 map을 잡고 있는 쪽은 unref 할 때까지 이전 테이블을 씁니다.
+ *         map이 NULL이면 zone을 지웁니다.
+ */
+void prototype_zones_set (PrototypeZones * zones, guint source_id,
+    PrototypeZoneMap * map);
+
+/**
+ * @return source_id의 zone 테이블 참조 (prototype_zone_map_unref로 해제). 없으면 NULL
+ */
+PrototypeZoneMap *prototype_zones_get (PrototypeZones * zones,
+    guint source_id);
+
+gboolean prototype_zones_drop_outside (PrototypeZones * zones);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * test_publish_queue용 느린 프로토콜 어댑터 (libslow_adaptor.so)
+ *
+ * send_async로 받은 payload를 기록하고 latency-ms가 지난 뒤 do_work에서 완료합니다.
+ * stuck=1이면 slow_adaptor_release()가 불릴 때까지 완료하지 않습니다.
+ * disconnect는 완료되지 않은 이벤트의 콜백을 부르지 않고 버립니다(가장 나쁜 경우).
+ * 테스트는 같은 .so를 dlopen해 slow_adaptor_* 함수로 상태를 읽습니다.
+ *
+ * 설정 파일 (broker_config)
+ *   [message-broker]
+ *   latency-ms=200
+ *   stuck=1
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "nvds_msgapi.h"
+
+#define CONFIG_GROUP_MSG_BROKER "message-broker"
+
+typedef struct
+{
+  nvds_msgapi_send_cb_t cb;
+  void *user_ptr;
+  gint64 done_us;
+} SlowAdaptorPending;
+
+/* 어댑터 상태는 프로세스 전역입니다. connect에서 초기화합니다. */
+static GMutex lock;
+static GQueue pending = G_QUEUE_INIT;
+static GPtrArray *sent = NULL;
+static gint64 latency_us;
+static gboolean stuck;
+static guint completed;
+static guint abandoned;
+static gint handle_token;
+
+NvDsMsgApiHandle
+nvds_msgapi_connect (char *connection_str, nvds_msgapi_connect_cb_t connect_cb,
+    char *config_path)
+{
+  GKeyFile *key_file = g_key_file_new ();
+
+  g_mutex_lock (&lock);
+  latency_us = 0;
+  stuck = FALSE;
+  if (config_path && g_key_file_load_from_file (key_file, config_path,
+          G_KEY_FILE_NONE, NULL)) {
+    latency_us = (gint64) g_key_file_get_integer (key_file,
+        CONFIG_GROUP_MSG_BROKER, "latency-ms", NULL) * 1000;
+    stuck = g_key_file_get_boolean (key_file, CONFIG_GROUP_MSG_BROKER,
+        "stuck", NULL);
+  }
+  if (sent)
+    g_ptr_array_unref (sent);
+  sent = g_ptr_array_new_with_free_func (g_free);
+  completed = 0;
+  abandoned = 0;
+  g_mutex_unlock (&lock);
+
+  g_key_file_free (key_file);
+  return &handle_token;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_send (NvDsMsgApiHandle h_ptr, char *topic, const uint8_t * payload,
+    size_t nbuf)
+{
+  return NVDS_MSGAPI_ERR;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_send_async (NvDsMsgApiHandle h_ptr, char *topic,
+    const uint8_t * payload, size_t nbuf, nvds_msgapi_send_cb_t send_callback,
+    void *user_ptr)
+{
+  SlowAdaptorPending *p = g_new (SlowAdaptorPending, 1);
+
+  p->cb = send_callback;
+  p->user_ptr = user_ptr;
+  p->done_us = g_get_monotonic_time () + latency_us;
+
+  g_mutex_lock (&lock);
+  g_ptr_array_add (sent, g_strndup ((const gchar *) payload, nbuf));
+  g_queue_push_tail (&pending, p);
+  g_mutex_unlock (&lock);
+  return NVDS_MSGAPI_OK;
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_subscribe (NvDsMsgApiHandle h_ptr, char **topics, int num_topics,
+    nvds_msgapi_subscribe_request_cb_t cb, void *user_ctx)
+{
+  return NVDS_MSGAPI_ERR;
+}
+
+void
+nvds_msgapi_do_work (NvDsMsgApiHandle h_ptr)
+{
+  gint64 now_us = g_get_monotonic_time ();
+
+  while (TRUE) {
+    SlowAdaptorPending *p = NULL;
+
+    g_mutex_lock (&lock);
+    p = (SlowAdaptorPending *) g_queue_peek_head (&pending);
+    if (p && !stuck && p->done_us <= now_us) {
+      g_queue_pop_head (&pending);
+      completed++;
+    } else {
+      p = NULL;
+    }
+    g_mutex_unlock (&lock);
+
+    if (!p)
+      break;
+    /* 콜백은 lock 밖에서 부릅니다. */
+    p->cb (p->user_ptr, NVDS_MSGAPI_OK);
+    g_free (p);
+  }
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_disconnect (NvDsMsgApiHandle h_ptr)
+{
+  g_mutex_lock (&lock);
+  abandoned += g_queue_get_length (&pending);
+  g_queue_clear_full (&pending, g_free);
+  g_mutex_unlock (&lock);
+  return NVDS_MSGAPI_OK;
+}
+
+char *
+nvds_msgapi_getversion (void)
+{
+  return (char *) "1.0";
+}
+
+char *
+nvds_msgapi_get_protocol_name (void)
+{
+  return (char *) "SLOW";
+}
+
+NvDsMsgApiErrorType
+nvds_msgapi_connection_signature (char *broker_str, char *cfg,
+    char *output_str, int max_len)
+{
+  if (output_str && max_len > 0)
+    output_str[0] = '\0';
+  return NVDS_MSGAPI_OK;
+}
+
+/* 아래는 테스트에서 dlsym으로 부르는 함수입니다. */
+
+/** stuck을 풀어 남은 이벤트와 이후 이벤트를 latency 뒤에 완료합니다. */
+void
+slow_adaptor_release (void)
+{
+  g_mutex_lock (&lock);
+  stuck = FALSE;
+  g_mutex_unlock (&lock);
+}
+
+/** send_async로 받은 payload 수 */
+guint
+slow_adaptor_num_sent (void)
+{
+  guint n;
+
+  g_mutex_lock (&lock);
+  n = sent ? sent->len : 0;
+  g_mutex_unlock (&lock);
+  return n;
+}
+
+/** @p index 번째로 받은 payload. g_free로 해제합니다. */
+gchar *
+slow_adaptor_dup_sent (guint index)
+{
+  gchar *payload = NULL;
+
+  g_mutex_lock (&lock);
+  if (sent && index < sent->len)
+    payload = g_strdup ((const gchar *) g_ptr_array_index (sent, index));
+  g_mutex_unlock (&lock);
+  return payload;
+}
+
+/** 완료 콜백을 부른 이벤트 수 */
+guint
+slow_adaptor_num_completed (void)
+{
+  guint n;
+
+  g_mutex_lock (&lock);
+  n = completed;
+  g_mutex_unlock (&lock);
+  return n;
+}
+
+/** disconnect 시점에 완료되지 않아 버린 이벤트 수 */
+guint
+slow_adaptor_num_abandoned (void)
+{
+  guint n;
+
+  g_mutex_lock (&lock);
+  n = abandoned;
+  g_mutex_unlock (&lock);
+  return n;
+}
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "deepstream_batch_timeout.h"
+
+#define MAX_SOURCES 64
+#define MS 1000
+
+typedef struct
+{
+  guint num_sources;
+  gdouble fps[MAX_SOURCES];
+  /** 첫 프레임 시각 (us) */
+  gint64 phase_us[MAX_SOURCES];
+  /** 도착 시각 흔들림의 최대값 (프레임 간격 비율, 0.5 미만). 누적되지 않습니다. */
+  gdouble jitter;
+} TraceSpec;
+
+static gint
+compare_arrival (gconstpointer a, gconstpointer b)
+{
+  gint64 ta = ((const NvDsBatchArrival *) a)->ts_us;
+  gint64 tb = ((const NvDsBatchArrival *) b)->ts_us;
+
+  return ta < tb ? -1 : ta > tb;
+}
+
+/* spec대로 duration_us 동안의 도착을 만들고 시각 순으로 정렬합니다. */
+static GArray *
+make_trace (const TraceSpec * spec, gint64 duration_us, GRand * rand)
+{
+  GArray *trace = g_array_new (FALSE, FALSE, sizeof (NvDsBatchArrival));
+  guint s;
+
+  for (s = 0; s < spec->num_sources; s++) {
+    gdouble period = G_USEC_PER_SEC / spec->fps[s];
+    guint k;
+
+    for (k = 0; spec->phase_us[s] + k * period < duration_us; k++) {
+      gdouble t = spec->phase_us[s] + k * period;
+      NvDsBatchArrival arrival = { 0, s };
+
+      if (rand && spec->jitter > 0)
+        t += g_rand_double_range (rand, -spec->jitter, spec->jitter) * period;
+      arrival.ts_us = (gint64) MAX (t, 0);
+      g_array_append_val (trace, arrival);
+    }
+  }
+  g_array_sort (trace, compare_arrival);
+  return trace;
+}
+
+static NvDsBatchReplay
+replay (GArray * trace, guint batch_size, gint timeout_us)
+{
+  NvDsBatchReplay result;
+
+  nvds_batch_timeout_replay ((NvDsBatchArrival *) trace->data, trace->len,
+      batch_size, timeout_us, &result);
+  return result;
+}
+
+/*
+ * 손으로 계산한 재생 결과. 소스 A(0), B(1), batch-size 2, timeout 5 ms:
+ *   [A@0, B@3] 가득 차서 3 ms에 push          대기 3, 0
+ *   [A@10]     B@25가 마감 15를 넘어 15에 push 대기 5
+ *   [B@25, A@30] 30에 push                    대기 5, 0
+ *   A@100은 마감이 마지막 도착 뒤라 세지 않음
+ */
+static void
+test_replay_hand_computed (void)
+{
+  const NvDsBatchArrival arrivals[] = {
+    {0, 0}, {3 * MS, 1}, {10 * MS, 0}, {25 * MS, 1}, {30 * MS, 0},
+    {100 * MS, 0},
+  };
+  NvDsBatchReplay result;
+
+  nvds_batch_timeout_replay (arrivals, G_N_ELEMENTS (arrivals), 2, 5 * MS,
+      &result);
+  g_assert_cmpuint (result.num_batches, ==, 3);
+  g_assert_cmpuint (result.num_frames, ==, 5);
+  g_assert_cmpfloat_with_epsilon (result.fill, 5.0 / 6, 1e-9);
+  g_assert_cmpfloat (result.p99_wait_us, ==, 5 * MS);
+
+  /*
+   * timeout 0이면 기다리지 않으므로 동시 도착이 없는 프레임은 모두 혼자 push되고,
+   * A@100도 마감이 마지막 도착과 같아 셉니다.
+   */
+  nvds_batch_timeout_replay (arrivals, G_N_ELEMENTS (arrivals), 2, 0, &result);
+  g_assert_cmpuint (result.num_batches, ==, 6);
+  g_assert_cmpuint (result.num_frames, ==, 6);
+  g_assert_cmpfloat (result.fill, ==, 0.5);
+  g_assert_cmpfloat (result.p99_wait_us, ==, 0);
+}
+
+/*
+ * 한 배치에는 소스당 한 프레임만 들어갑니다. A가 몰아서 보낸 프레임은
+ * 다음 배치로 밀리고, 밀린 시간만큼 대기에 잡힙니다.
+ */
+static void
+test_replay_one_frame_per_source (void)
+{
+  const NvDsBatchArrival arrivals[] = {
+    {0, 0}, {1 * MS, 0}, {2 * MS, 0}, {4 * MS, 1}, {50 * MS, 0},
+  };
+  NvDsBatchReplay result;
+
+  /* [A@0, B@4] push 4; [A@1] 마감 14; [A@2] 마감 24 */
+  nvds_batch_timeout_replay (arrivals, G_N_ELEMENTS (arrivals), 4, 10 * MS,
+      &result);
+  g_assert_cmpuint (result.num_batches, ==, 3);
+  g_assert_cmpuint (result.num_frames, ==, 4);
+  /* 용량은 min(batch-size 4, 소스 2) */
+  g_assert_cmpfloat_with_epsilon (result.fill, 4.0 / 6, 1e-9);
+  g_assert_cmpfloat (result.p99_wait_us, ==, 22 * MS);
+}
+
+/* 같은 주기의 소스는 위상 차보다 긴 timeout에서 배치가 가득 찹니다. */
+static void
+test_replay_phase_spread (void)
+{
+  TraceSpec spec = { 4, {30, 30, 30, 30}, {0, 3 * MS, 6 * MS, 9 * MS} };
+  GArray *trace = make_trace (&spec, 2 * G_USEC_PER_SEC, NULL);
+  NvDsBatchReplay result;
+
+  result = replay (trace, 4, 10 * MS);
+  g_assert_cmpfloat (result.fill, ==, 1);
+  g_assert_cmpfloat (result.p99_wait_us, ==, 9 * MS);
+
+  /* 위상 차보다 짧으면 배치가 쪼개지고 fill이 떨어집니다. */
+  result = replay (trace, 4, 4 * MS);
+  g_assert_cmpfloat (result.fill, <, 0.75);
+  g_assert_cmpfloat (result.p99_wait_us, <=, 4 * MS);
+
+  /* batch-size가 소스보다 작으면 먼저 도착한 둘로 바로 push합니다. */
+  result = replay (trace, 2, 10 * MS);
+  g_assert_cmpfloat (result.fill, ==, 1);
+  g_assert_cmpfloat (result.p99_wait_us, ==, 3 * MS);
+
+  g_array_free (trace, TRUE);
+}
+
+static void
+check_selection (NvDsBatchTimeoutConfig * config, GArray * trace,
+    gint timeout, NvDsBatchReplay * result)
+{
+  NvDsBatchReplay again = replay (trace, config->batch_size, timeout);
+
+  /* 결과는 고른 timeout의 재생과 같습니다. */
+  g_assert_cmpuint (result->num_batches, ==, again.num_batches);
+  g_assert_cmpfloat (result->fill, ==, again.fill);
+  g_assert_cmpfloat (result->p99_wait_us, ==, again.p99_wait_us);
+
+  g_assert_cmpint (timeout, <=, config->max_latency_us);
+  if (timeout > (gint) config->min_timeout_us)
+    g_assert_cmpfloat (result->p99_wait_us, <=, config->max_latency_us);
+}
+
+/*
+ * 4 x 30fps, 위상 차 9 ms: target-fill 0.95를 채우는 가장 작은 timeout을
+ * 이분 탐색 해상도(0.5 ms) 안에서 고릅니다. 1 ms 간격 전수 조사와 비교합니다.
+ */
+static void
+test_select_smallest_timeout (void)
+{
+  NvDsBatchTimeoutConfig config = { 4, 0.95, 40 * MS, 1 * MS, 2000 };
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  TraceSpec spec = { 4, {30, 30, 30, 30}, {0, 3 * MS, 6 * MS, 9 * MS}, 0.05 };
+  GArray *trace = make_trace (&spec, 2 * G_USEC_PER_SEC, rand);
+  NvDsBatchReplay result;
+  gint timeout, t;
+
+  timeout = nvds_batch_timeout_select (&config, (NvDsBatchArrival *)
+      trace->data, trace->len, &result);
+  g_test_message ("chosen %.1f ms: fill %.3f, p99 wait %.1f ms",
+      timeout / 1000.0, result.fill, result.p99_wait_us / 1000);
+  check_selection (&config, trace, timeout, &result);
+  g_assert_cmpfloat (result.fill, >=, config.target_fill);
+
+  for (t = config.min_timeout_us; t < timeout - 500; t += 1 * MS)
+    g_assert_cmpfloat (replay (trace, 4, t).fill, <, config.target_fill);
+  /* 위상 차 9 ms보다 짧게 기다려서는 0.95를 채울 수 없습니다. */
+  g_assert_cmpint (timeout, >=, 8 * MS);
+  g_assert_cmpint (timeout, <=, 14 * MS);
+
+  g_array_free (trace, TRUE);
+  g_rand_free (rand);
+}
+
+/*
+ * 30/25/15/5fps 혼합: 느린 소스를 기다리면 30fps 소스가 밀려 p99 대기가
+ * max-latency를 넘으므로, fill 대신 지연 상한을 지키는 가장 큰 timeout을 고릅니다.
+ */
+static void
+test_select_latency_bound (void)
+{
+  NvDsBatchTimeoutConfig config = { 4, 0.95, 40 * MS, 1 * MS, 2000 };
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  TraceSpec spec = { 4, {30, 25, 15, 5}, {0, 7 * MS, 13 * MS, 21 * MS}, 0.1 };
+  GArray *trace = make_trace (&spec, 2 * G_USEC_PER_SEC, rand);
+  NvDsBatchReplay result;
+  gint timeout;
+
+  g_assert_cmpfloat (replay (trace, 4, config.max_latency_us).fill, <,
+      config.target_fill);
+
+  timeout = nvds_batch_timeout_select (&config, (NvDsBatchArrival *)
+      trace->data, trace->len, &result);
+  g_test_message ("chosen %.1f ms: fill %.3f, p99 wait %.1f ms",
+      timeout / 1000.0, result.fill, result.p99_wait_us / 1000);
+  check_selection (&config, trace, timeout, &result);
+  g_assert_cmpint (timeout, <, config.max_latency_us);
+  /* 0.5 ms 더 기다리면 지연 상한을 넘습니다. */
+  g_assert_cmpfloat (replay (trace, 4, timeout + 500).p99_wait_us, >,
+      config.max_latency_us);
+
+  g_array_free (trace, TRUE);
+  g_rand_free (rand);
+}
+
+/* 무작위 소스 수/fps/위상/흔들림에서 선택 결과의 불변식을 확인합니다. */
+static void
+test_select_random_traces (void)
+{
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  guint round;
+
+  for (round = 0; round < 200; round++) {
+    NvDsBatchTimeoutConfig config = { 0, 0, 0, 1 * MS, 2000 };
+    TraceSpec spec = { 0 };
+    NvDsBatchReplay result;
+    GArray *trace = NULL;
+    gint timeout;
+    guint s;
+
+    spec.num_sources = g_rand_int_range (rand, 2, 17);
+    spec.jitter = g_rand_double_range (rand, 0, 0.3);
+    for (s = 0; s < spec.num_sources; s++) {
+      spec.fps[s] = g_rand_double_range (rand, 5, 30);
+      spec.phase_us[s] = g_rand_int_range (rand, 0, 200 * MS);
+    }
+    config.batch_size = g_rand_int_range (rand, 1, spec.num_sources + 4);
+    config.target_fill = g_rand_double_range (rand, 0.5, 1);
+    config.max_latency_us = g_rand_int_range (rand, 5 * MS, 100 * MS);
+    trace = make_trace (&spec, 2 * G_USEC_PER_SEC, rand);
+
+    timeout = nvds_batch_timeout_select (&config, (NvDsBatchArrival *)
+        trace->data, trace->len, &result);
+    g_assert_cmpint (timeout, >=, 0);
+    check_selection (&config, trace, timeout, &result);
+    g_assert_cmpfloat (result.fill, >, 0);
+    g_assert_cmpfloat (result.fill, <=, 1);
+    g_array_free (trace, TRUE);
+  }
+  g_rand_free (rand);
+}
+
+static void
+test_select_single_source (void)
+{
+  NvDsBatchTimeoutConfig config = { 4, 0.95, 40 * MS, 1 * MS, 2000 };
+  TraceSpec spec = { 1, {30} };
+  GArray *trace = make_trace (&spec, 2 * G_USEC_PER_SEC, NULL);
+  NvDsBatchReplay result;
+
+  g_assert_cmpint (nvds_batch_timeout_select (&config, (NvDsBatchArrival *)
+          trace->data, trace->len, &result), ==, -1);
+  g_assert_cmpint (nvds_batch_timeout_select (&config, NULL, 0, &result), ==,
+      -1);
+  g_array_free (trace, TRUE);
+}
+
+/*
+ * 컨트롤러: 기록한 도착으로 고르고, 10% 미만의 변화는 무시하며,
+ * 제거된 소스의 도착은 재생에서 빠집니다.
+ */
+static void
+test_controller (void)
+{
+  NvDsBatchTimeoutConfig config = { 4, 0.95, 40 * MS, 1 * MS, 1000 };
+  NvDsBatchTimeout *ctl = nvds_batch_timeout_new (&config, 40 * MS);
+  TraceSpec spec = { 4, {30, 30, 30, 30}, {0, 3 * MS, 6 * MS, 9 * MS} };
+  GArray *trace = make_trace (&spec, 3 * G_USEC_PER_SEC, NULL);
+  NvDsBatchTimeoutStats stats;
+  const gint64 start = 10 * G_USEC_PER_SEC;
+  gint timeout = 0;
+  guint i;
+
+  for (i = 0; i < trace->len; i++) {
+    NvDsBatchArrival *arrival = &g_array_index (trace, NvDsBatchArrival, i);
+
+    nvds_batch_timeout_record_arrival (ctl, arrival->source_id,
+        start + arrival->ts_us);
+  }
+  for (i = 0; i < 10; i++)
+    nvds_batch_timeout_record_batch (ctl, i < 5 ? 4 : 2);
+
+  g_assert_true (nvds_batch_timeout_update (ctl,
+          start + 3 * G_USEC_PER_SEC, &timeout));
+  g_assert_cmpint (timeout, >=, 9 * MS);
+  g_assert_cmpint (timeout, <=, 10 * MS);
+  nvds_batch_timeout_get_stats (ctl, &stats);
+  g_assert_cmpint (stats.timeout_us, ==, timeout);
+  g_assert_cmpfloat (stats.predicted.fill, >=, config.target_fill);
+  g_assert_cmpuint (stats.num_batches, ==, 10);
+  g_assert_cmpfloat_with_epsilon (stats.achieved_fill, 30.0 / 40, 1e-9);
+
+  /* 같은 창으로 다시 고르면 바뀌지 않습니다. */
+  g_assert_false (nvds_batch_timeout_update (ctl,
+          start + 3 * G_USEC_PER_SEC, &timeout));
+  nvds_batch_timeout_get_stats (ctl, &stats);
+  g_assert_cmpuint (stats.num_batches, ==, 0);
+
+  /* 마지막 소스(위상 9 ms)를 빼면 위상 차가 6 ms로 줄어듭니다. */
+  nvds_batch_timeout_remove_source (ctl, 3);
+  g_assert_true (nvds_batch_timeout_update (ctl,
+          start + 3 * G_USEC_PER_SEC, &timeout));
+  g_assert_cmpint (timeout, >=, 6 * MS);
+  g_assert_cmpint (timeout, <=, 7 * MS);
+
+  /* 창 밖의 도착은 쓰지 않습니다: 남은 소스가 없으면 timeout을 유지합니다. */
+  g_assert_false (nvds_batch_timeout_update (ctl,
+          start + 10 * G_USEC_PER_SEC, &timeout));
+  g_assert_cmpint (timeout, >=, 6 * MS);
+
+  g_array_free (trace, TRUE);
+  nvds_batch_timeout_free (ctl);
+}
+
+/* 소스 64개 x 30fps, 창 2초(도착 3840개)에서 update() 한 번의 재생/선택 비용 */
+static void
+bench_select (void)
+{
+  NvDsBatchTimeoutConfig config = { 64, 0.9, 40 * MS, 1 * MS, 2000 };
+  GRand *rand = NULL;
+  TraceSpec spec = { 64 };
+  NvDsBatchReplay result;
+  GArray *trace = NULL;
+  gdouble elapsed;
+  gint timeout = 0;
+  guint s, i, rounds = 20;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (1);
+  spec.jitter = 0.1;
+  for (s = 0; s < spec.num_sources; s++) {
+    spec.fps[s] = 30;
+    spec.phase_us[s] = g_rand_int_range (rand, 0, 33 * MS);
+  }
+  trace = make_trace (&spec, 2 * G_USEC_PER_SEC, rand);
+
+  g_test_timer_start ();
+  for (i = 0; i < rounds; i++)
+    timeout = nvds_batch_timeout_select (&config, (NvDsBatchArrival *)
+        trace->data, trace->len, &result);
+  elapsed = g_test_timer_elapsed () / rounds;
+  g_test_minimized_result (elapsed * 1e3,
+      "select: %.2f ms/update (%u arrivals, chosen %.1f ms, fill %.2f)",
+      elapsed * 1e3, trace->len, timeout / 1000.0, result.fill);
+
+  g_array_free (trace, TRUE);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/batch-timeout/replay/hand-computed",
+      test_replay_hand_computed);
+  g_test_add_func ("/batch-timeout/replay/one-frame-per-source",
+      test_replay_one_frame_per_source);
+  g_test_add_func ("/batch-timeout/replay/phase-spread",
+      test_replay_phase_spread);
+  g_test_add_func ("/batch-timeout/select/smallest-timeout",
+      test_select_smallest_timeout);
+  g_test_add_func ("/batch-timeout/select/latency-bound",
+      test_select_latency_bound);
+  g_test_add_func ("/batch-timeout/select/random-traces",
+      test_select_random_traces);
+  g_test_add_func ("/batch-timeout/select/single-source",
+      test_select_single_source);
+  g_test_add_func ("/batch-timeout/controller", test_controller);
+  g_test_add_func ("/batch-timeout/bench/select", bench_select);
+
+  return g_test_run ();
+}
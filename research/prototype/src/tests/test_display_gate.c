@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "prototype_display_gate.h"
+
+/* 표시 분기 대신 identity(tiler 자리)와 fakesink를 둡니다. */
+#define LAUNCH "videotestsrc is-live=true ! video/x-raw,width=64,height=48," \
+    "framerate=100/1 ! tee name=t " \
+    "t. ! queue ! fakesink name=always sync=false " \
+    "t. ! queue name=display_queue ! identity name=tiler ! " \
+    "fakesink name=display sync=false async=false"
+
+typedef struct
+{
+  GstElement *pipeline;
+  PrototypeDisplayGate *gate;
+  gint always;
+  gint tiler;
+  gint display;
+  gint keyframe_requests;
+} TestPipeline;
+
+static GstPadProbeReturn
+count_buffer_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  g_atomic_int_inc ((gint *) data);
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+keyframe_event_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  if (gst_video_event_is_force_key_unit (GST_PAD_PROBE_INFO_EVENT (info)))
+    g_atomic_int_inc ((gint *) data);
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+count_buffers (GstElement * pipeline, const gchar * name, gint * counter)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (pipeline), name);
+  GstPad *pad = gst_element_get_static_pad (element, "sink");
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_buffer_probe,
+      counter, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (element);
+}
+
+static void
+pipeline_init (TestPipeline * tp, PrototypeDisplayGateConfig * config)
+{
+  GError *error = NULL;
+  GstElement *element = NULL;
+  GstPad *pad = NULL, *tee_pad = NULL;
+  GstStateChangeReturn ret;
+
+  memset (tp, 0, sizeof (TestPipeline));
+  tp->pipeline = gst_parse_launch (LAUNCH, &error);
+  g_assert_no_error (error);
+  tp->gate = prototype_display_gate_new (config);
+  g_assert_nonnull (tp->gate);
+
+  /* 앱과 같이 표시 분기로 가는 tee 출력 패드에 게이트를 답니다. */
+  element = gst_bin_get_by_name (GST_BIN (tp->pipeline), "display_queue");
+  pad = gst_element_get_static_pad (element, "sink");
+  tee_pad = gst_pad_get_peer (pad);
+  prototype_display_gate_add_probe (tp->gate, tee_pad);
+  gst_object_unref (tee_pad);
+  gst_object_unref (pad);
+  gst_object_unref (element);
+
+  count_buffers (tp->pipeline, "always", &tp->always);
+  count_buffers (tp->pipeline, "tiler", &tp->tiler);
+  count_buffers (tp->pipeline, "display", &tp->display);
+  element = gst_bin_get_by_name (GST_BIN (tp->pipeline), "display");
+  pad = gst_element_get_static_pad (element, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      keyframe_event_probe, &tp->keyframe_requests, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (element);
+
+  /* 닫힌 게이트 뒤의 async=false sink는 preroll을 막지 않습니다. */
+  g_assert_cmpint (gst_element_set_state (tp->pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+  ret = gst_element_get_state (tp->pipeline, NULL, NULL, 5 * GST_SECOND);
+  g_assert_cmpint (ret, !=, GST_STATE_CHANGE_FAILURE);
+  g_assert_cmpint (ret, !=, GST_STATE_CHANGE_ASYNC);
+}
+
+static void
+pipeline_clear (TestPipeline * tp)
+{
+  gst_element_set_state (tp->pipeline, GST_STATE_NULL);
+  gst_object_unref (tp->pipeline);
+  prototype_display_gate_free (tp->gate);
+}
+
+/* counter가 target 이상이 될 때까지 최대 5초 기다립니다. */
+static void
+wait_count (gint * counter, gint target)
+{
+  gint64 deadline = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+
+  while (g_atomic_int_get (counter) < target &&
+      g_get_monotonic_time () < deadline)
+    g_usleep (5 * 1000);
+  g_assert_cmpint (g_atomic_int_get (counter), >=, target);
+}
+
+/*
+ * 닫힌 동안 다른 분기가 num_frames 흐르는 사이 표시 분기는 하나도 받지
+ * 않아야 합니다. 닫기 전에 게이트를 지난 프레임이 큐에서 빠지도록 잠시
+ * 기다린 뒤 셉니다.
+ */
+static void
+assert_display_idle (TestPipeline * tp, gint num_frames)
+{
+  gint tiler, display;
+
+  g_usleep (100 * 1000);
+  tiler = g_atomic_int_get (&tp->tiler);
+  display = g_atomic_int_get (&tp->display);
+  wait_count (&tp->always, g_atomic_int_get (&tp->always) + num_frames);
+  g_assert_cmpint (g_atomic_int_get (&tp->tiler), ==, tiler);
+  g_assert_cmpint (g_atomic_int_get (&tp->display), ==, display);
+}
+
+/* 시청자, 관리자 열기, idle 시간으로 열고 닫히는 상태만 확인합니다. */
+static void
+test_state (void)
+{
+  PrototypeDisplayGateConfig config = { TRUE, 30, FALSE };
+  PrototypeDisplayGateConfig disabled = { FALSE, 30, FALSE };
+  PrototypeDisplayGate *gate = NULL;
+  gint64 now;
+
+  g_assert_null (prototype_display_gate_new (&disabled));
+
+  gate = prototype_display_gate_new (&config);
+  g_assert_false (prototype_display_gate_is_active (gate));
+
+  /* 두 시청자 중 하나만 떠나면 idle이 아닙니다. */
+  prototype_display_gate_viewer_added (gate);
+  prototype_display_gate_viewer_added (gate);
+  g_assert_true (prototype_display_gate_is_active (gate));
+  prototype_display_gate_viewer_removed (gate);
+  now = g_get_monotonic_time ();
+  g_assert_false (prototype_display_gate_update (gate,
+          now + 60 * G_USEC_PER_SEC));
+  g_assert_true (prototype_display_gate_is_active (gate));
+
+  /* 마지막 시청자가 떠나면 idle-timeout-sec 뒤에 닫힙니다. */
+  prototype_display_gate_viewer_removed (gate);
+  now = g_get_monotonic_time ();
+  g_assert_false (prototype_display_gate_update (gate,
+          now + 29 * G_USEC_PER_SEC));
+  g_assert_true (prototype_display_gate_is_active (gate));
+  g_assert_true (prototype_display_gate_update (gate,
+          now + 31 * G_USEC_PER_SEC));
+  g_assert_false (prototype_display_gate_is_active (gate));
+
+  /* idle 중에 다시 붙으면 시계가 초기화됩니다. */
+  prototype_display_gate_viewer_added (gate);
+  prototype_display_gate_viewer_removed (gate);
+  prototype_display_gate_viewer_added (gate);
+  now = g_get_monotonic_time ();
+  g_assert_false (prototype_display_gate_update (gate,
+          now + 60 * G_USEC_PER_SEC));
+  g_assert_true (prototype_display_gate_is_active (gate));
+  prototype_display_gate_viewer_removed (gate);
+
+  /* 관리자 열기는 시청자와 무관하게 유지되고, 끄면 바로 닫힙니다. */
+  prototype_display_gate_set_admin (gate, TRUE);
+  g_assert_true (prototype_display_gate_get_admin (gate));
+  g_assert_false (prototype_display_gate_update (gate,
+          now + 60 * G_USEC_PER_SEC));
+  g_assert_true (prototype_display_gate_is_active (gate));
+  prototype_display_gate_set_admin (gate, FALSE);
+  g_assert_false (prototype_display_gate_is_active (gate));
+
+  prototype_display_gate_free (gate);
+}
+
+/*
+ * fakesink 파이프라인에서 연결/종료를 스크립트로 돌립니다. 닫힌 동안 tiler
+ * 자리와 표시 sink는 버퍼를 하나도 받지 않고, 다른 분기는 멈추지 않으며,
+ * 열 때마다 키 프레임 요청이 한 번 갑니다.
+ */
+static void
+test_viewers (void)
+{
+  PrototypeDisplayGateConfig config = { TRUE, 1, FALSE };
+  TestPipeline tp;
+
+  pipeline_init (&tp, &config);
+
+  /* 시청자 없음 */
+  wait_count (&tp.always, 50);
+  g_assert_cmpint (g_atomic_int_get (&tp.tiler), ==, 0);
+  g_assert_cmpint (g_atomic_int_get (&tp.display), ==, 0);
+  assert_display_idle (&tp, 30);
+  g_assert_cmpint (g_atomic_int_get (&tp.keyframe_requests), ==, 0);
+  g_assert_cmpuint (prototype_display_gate_get_dropped (tp.gate), >=, 50);
+
+  /* RTSP 클라이언트 연결 */
+  prototype_display_gate_viewer_added (tp.gate);
+  wait_count (&tp.display, 20);
+  g_assert_cmpint (g_atomic_int_get (&tp.keyframe_requests), ==, 1);
+
+  /* 연결 종료: idle-timeout-sec 동안은 열려 있다가 닫힙니다. */
+  prototype_display_gate_viewer_removed (tp.gate);
+  g_assert_false (prototype_display_gate_update (tp.gate,
+          g_get_monotonic_time ()));
+  wait_count (&tp.display, g_atomic_int_get (&tp.display) + 10);
+  g_assert_true (prototype_display_gate_update (tp.gate,
+          g_get_monotonic_time () + 2 * G_USEC_PER_SEC));
+  assert_display_idle (&tp, 50);
+
+  /* 관리자 열기와 닫기 */
+  prototype_display_gate_set_admin (tp.gate, TRUE);
+  wait_count (&tp.display, g_atomic_int_get (&tp.display) + 20);
+  g_assert_cmpint (g_atomic_int_get (&tp.keyframe_requests), ==, 2);
+  prototype_display_gate_set_admin (tp.gate, FALSE);
+  assert_display_idle (&tp, 50);
+
+  pipeline_clear (&tp);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+
+  g_test_add_func ("/display-gate/state", test_state);
+  g_test_add_func ("/display-gate/viewers", test_viewers);
+
+  return g_test_run ();
+}
@@ -0,0 +1,637 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "prototype_frame_scheduler.h"
+
+#define MAX_SOURCES 64
+/* 0은 "아직 분배 안 함"이므로 시계는 1초에서 시작합니다. */
+#define START_US G_USEC_PER_SEC
+
+static PrototypeSchedulerClass classes[] = {
+  {(gchar *) "entrance", 4, 0, 0},
+  {(gchar *) "normal", 1, 15, 2},
+  {(gchar *) "low", 1, 5, 1},
+  {(gchar *) "guaranteed", 1, 0, 5},
+};
+
+static PrototypeFrameScheduler *
+new_scheduler (gdouble inference_fps)
+{
+  PrototypeFrameSchedulerConfig config = {
+    .enable = TRUE,
+    .inference_fps = inference_fps,
+    .default_class = NULL,
+    .classes = classes,
+    .num_classes = G_N_ELEMENTS (classes),
+  };
+
+  return prototype_frame_scheduler_new (&config);
+}
+
+/*
+ * 소스 도착과 GPU 큐의 이산 사건 모의.
+ * 소스는 fps 간격에 ±jitter 비율의 흔들림을 두고 도착하며, 통과한 프레임은
+ * inference-fps 속도의 FIFO 서버(PGIE)에 들어가 대기 시간을 잽니다.
+ */
+typedef struct
+{
+  guint num_sources;
+  gdouble fps[MAX_SOURCES];
+  gdouble jitter;
+  /** 이 시각(초, 시작 기준) 이후 도착이 멈춥니다. 0이면 계속 */
+  gdouble stop_at[MAX_SOURCES];
+
+  /* 측정 구간 [window_start, window_end) 의 결과 */
+  gdouble window_start;
+  gdouble window_end;
+  guint admitted[MAX_SOURCES];
+  gdouble max_gap[MAX_SOURCES];
+  gdouble last_admit[MAX_SOURCES];
+  GArray *waits;
+} Sim;
+
+static void
+sim_run (Sim * sim, PrototypeFrameScheduler * scheduler, gdouble capacity,
+    gdouble duration, GRand * rand)
+{
+  gdouble next[MAX_SOURCES];
+  gdouble server_free = 0;
+  gboolean reset = FALSE;
+  guint i;
+
+  sim->waits = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  for (i = 0; i < sim->num_sources; i++) {
+    next[i] = g_rand_double_range (rand, 0, 1 / sim->fps[i]);
+    sim->admitted[i] = 0;
+    sim->max_gap[i] = 0;
+    sim->last_admit[i] = -1;
+  }
+
+  while (TRUE) {
+    gdouble t = G_MAXDOUBLE;
+    guint s = 0;
+
+    for (i = 0; i < sim->num_sources; i++) {
+      if (next[i] < t) {
+        t = next[i];
+        s = i;
+      }
+    }
+    if (t >= duration)
+      break;
+    next[s] += (1 + g_rand_double_range (rand, -sim->jitter, sim->jitter)) /
+        sim->fps[s];
+    if (sim->stop_at[s] > 0 && next[s] >= sim->stop_at[s])
+      next[s] = G_MAXDOUBLE;
+
+    if (!prototype_frame_scheduler_admit (scheduler, s,
+            START_US + (gint64) (t * G_USEC_PER_SEC)))
+      continue;
+
+    /*
+     * PGIE: 통과한 프레임을 순서대로 1/capacity초씩 처리.
+     * 첫 분배 전에는 모두 통과하므로 측정 구간 시작에서 큐를 비웁니다.
+     */
+    if (!reset && t >= sim->window_start) {
+      server_free = t;
+      reset = TRUE;
+    }
+    if (capacity > 0) {
+      gdouble start = MAX (t, server_free);
+
+      server_free = start + 1 / capacity;
+      if (t >= sim->window_start && t < sim->window_end) {
+        gdouble wait = start - t;
+
+        g_array_append_val (sim->waits, wait);
+      }
+    }
+    if (t >= sim->window_start && t < sim->window_end) {
+      sim->admitted[s]++;
+      if (sim->last_admit[s] >= sim->window_start)
+        sim->max_gap[s] = MAX (sim->max_gap[s], t - sim->last_admit[s]);
+    }
+    sim->last_admit[s] = t;
+  }
+}
+
+static gdouble
+sim_fps (Sim * sim, guint s)
+{
+  return sim->admitted[s] / (sim->window_end - sim->window_start);
+}
+
+static gint
+compare_double (gconstpointer a, gconstpointer b)
+{
+  gdouble x = *(const gdouble *) a, y = *(const gdouble *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static gdouble
+sim_wait_quantile (Sim * sim, gdouble q)
+{
+  if (!sim->waits->len)
+    return 0;
+  qsort (sim->waits->data, sim->waits->len, sizeof (gdouble), compare_double);
+  return g_array_index (sim->waits, gdouble,
+      (guint) (q * (sim->waits->len - 1)));
+}
+
+static void
+sim_clear (Sim * sim)
+{
+  g_array_free (sim->waits, TRUE);
+}
+
+/* 가중치 4/1/1, 상한 0/15/5, 용량 40: 4L + min(L,15) + min(L,5) = 40 -> 28/7/5 */
+static void
+test_weighted_shares (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (40);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 3, {30, 30, 30}, 0.2 };
+  const gdouble expected[] = { 28, 7, 5 };
+  guint i;
+
+  g_assert_true (prototype_frame_scheduler_set_source_class (scheduler, 0,
+          "entrance"));
+  g_assert_true (prototype_frame_scheduler_set_source_class (scheduler, 1,
+          "normal"));
+  g_assert_true (prototype_frame_scheduler_set_source_class (scheduler, 2,
+          "low"));
+
+  /*
+   * 할당 합이 용량과 같으면(이용률 1) 큐가 무작위 행보로 계속 자라므로,
+   * inference-fps를 실제 PGIE 처리량의 95%로 설정한 경우를 모의합니다.
+   */
+  sim.window_start = 5;
+  sim.window_end = 35;
+  sim_run (&sim, scheduler, 40 / 0.95, 35, rand);
+  g_assert_cmpuint (sim.admitted[0] + sim.admitted[1] + sim.admitted[2], <=,
+      40 * 30 * 1.005);
+  for (i = 0; i < 3; i++) {
+    g_test_message ("source %u: %.2f fps (allocated %.2f)", i,
+        sim_fps (&sim, i), prototype_frame_scheduler_allocated_fps (scheduler,
+            i));
+    g_assert_cmpfloat_with_epsilon (sim_fps (&sim, i), expected[i], 0.5);
+    g_assert_cmpfloat_with_epsilon (prototype_frame_scheduler_allocated_fps
+        (scheduler, i), expected[i], 0.5);
+    g_assert_true (prototype_frame_scheduler_is_limited (scheduler, i));
+  }
+
+  /* 고르게 통과시키므로 PGIE 큐가 쌓이지 않습니다. */
+  g_test_message ("queue wait p50 %.1f ms, p99 %.1f ms, max %.1f ms",
+      sim_wait_quantile (&sim, 0.5) * 1e3, sim_wait_quantile (&sim, 0.99) * 1e3,
+      sim_wait_quantile (&sim, 1) * 1e3);
+  g_assert_cmpfloat (sim_wait_quantile (&sim, 0.99), <, 3.0 / 40);
+
+  sim_clear (&sim);
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/* 같은 가중치 8개 소스: 용량을 똑같이 나눕니다 (Jain 지수 ~1). */
+static void
+test_equal_shares (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (100);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 8, {25, 25, 25, 25, 25, 25, 25, 25}, 0.3 };
+  gdouble sum = 0, sum_sq = 0;
+  guint i;
+
+  sim.window_start = 5;
+  sim.window_end = 35;
+  sim_run (&sim, scheduler, 100, 35, rand);
+  for (i = 0; i < 8; i++) {
+    gdouble fps = sim_fps (&sim, i);
+
+    g_assert_cmpfloat_with_epsilon (fps, 12.5, 0.3);
+    /* 고르게 통과: 간격이 두 할당 간격을 넘지 않습니다. */
+    g_assert_cmpfloat (sim.max_gap[i], <=, 2 / 12.5 + 1 / 25.0 * 1.3);
+    sum += fps;
+    sum_sq += fps * fps;
+  }
+  g_test_message ("Jain index %.5f", sum * sum / (8 * sum_sq));
+  g_assert_cmpfloat (sum * sum / (8 * sum_sq), >, 0.999);
+
+  sim_clear (&sim);
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/* 입력이 몫보다 작은 소스는 제한하지 않고 남는 용량을 나눕니다: 10/15/15 */
+static void
+test_mixed_demand (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (40);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 3, {10, 30, 30}, 0.2 };
+
+  sim.window_start = 5;
+  sim.window_end = 25;
+  sim_run (&sim, scheduler, 40, 25, rand);
+  g_assert_false (prototype_frame_scheduler_is_limited (scheduler, 0));
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 0), 10, 0.3);
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 1), 15, 0.5);
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 2), 15, 0.5);
+
+  sim_clear (&sim);
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/*
+ * min-fps 합이 용량을 넘으면 min-fps만 보장하고, 도착이 흔들려도
+ * 통과 간격은 1/min-fps + 한 프레임을 넘지 않습니다.
+ */
+static void
+test_min_fps_deadline (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (20);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 10, {0}, 0.3 };
+  guint i;
+
+  for (i = 0; i < sim.num_sources; i++) {
+    sim.fps[i] = 30;
+    prototype_frame_scheduler_set_source_class (scheduler, i, "guaranteed");
+  }
+  sim.window_start = 5;
+  sim.window_end = 25;
+  sim_run (&sim, scheduler, 0, 25, rand);
+  for (i = 0; i < sim.num_sources; i++) {
+    g_assert_cmpfloat (sim_fps (&sim, i), >=, 5 * 0.97);
+    g_assert_cmpfloat (sim_fps (&sim, i), <=, 5 * 1.1);
+    g_assert_cmpfloat (sim.max_gap[i], <=, 1 / 5.0 + 1.3 / 30);
+  }
+
+  sim_clear (&sim);
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/*
+ * 소스 둘이 멈추면 남은 소스가 다음 분배 몇 번 안에 용량을 돌려받습니다.
+ * 남은 요구량(60)이 용량과 딱 맞으면 측정 흔들림으로 제한될 수 있어 여유를 둡니다.
+ */
+static void
+test_capacity_handback (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (70);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 4, {30, 30, 30, 30}, 0.2, {0, 0, 10, 10} };
+  guint i;
+
+  sim.window_start = 12;
+  sim.window_end = 20;
+  sim_run (&sim, scheduler, 70, 20, rand);
+  for (i = 0; i < 2; i++) {
+    g_assert_false (prototype_frame_scheduler_is_limited (scheduler, i));
+    g_assert_cmpfloat_with_epsilon (sim_fps (&sim, i), 30, 1.0);
+  }
+  g_assert_cmpuint (sim.admitted[2] + sim.admitted[3], ==, 0);
+
+  sim_clear (&sim);
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/* 용량이 충분하면 모두 통과, inference-fps 0이면 클래스 상한만 적용 */
+static void
+test_unlimited (void)
+{
+  PrototypeFrameScheduler *scheduler = new_scheduler (200);
+  PrototypeFrameScheduler *caps_only = new_scheduler (0);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 4, {30, 30, 30, 30}, 0.2 };
+  guint i;
+
+  sim.window_start = 0;
+  sim.window_end = 10;
+  sim_run (&sim, scheduler, 0, 10, rand);
+  for (i = 0; i < 4; i++) {
+    g_assert_false (prototype_frame_scheduler_is_limited (scheduler, i));
+    g_assert_cmpfloat (prototype_frame_scheduler_allocated_fps (scheduler, i),
+        <, 0);
+    g_assert_cmpfloat_with_epsilon (sim_fps (&sim, i), 30, 1.0);
+  }
+  sim_clear (&sim);
+
+  prototype_frame_scheduler_set_source_class (caps_only, 0, "low");
+  sim.window_start = 5;
+  sim.window_end = 15;
+  sim_run (&sim, caps_only, 0, 15, rand);
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 0), 5, 0.5);
+  for (i = 1; i < 4; i++)
+    g_assert_cmpfloat_with_epsilon (sim_fps (&sim, i), 30, 1.0);
+  sim_clear (&sim);
+
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (caps_only);
+  prototype_frame_scheduler_free (scheduler);
+}
+
+static void
+test_classes (void)
+{
+  PrototypeFrameSchedulerConfig config = {
+    .enable = TRUE,
+    .inference_fps = 40,
+    .default_class = (gchar *) "low",
+    .classes = classes,
+    .num_classes = G_N_ELEMENTS (classes),
+  };
+  PrototypeFrameScheduler *scheduler = prototype_frame_scheduler_new (&config);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  Sim sim = { 2, {30, 30}, 0.2 };
+
+  /* 정의되지 않은 이름은 default-class (low, 상한 5) */
+  g_assert_false (prototype_frame_scheduler_set_source_class (scheduler, 0,
+          "no-such-class"));
+  sim.window_start = 5;
+  sim.window_end = 15;
+  sim_run (&sim, scheduler, 0, 15, rand);
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 0), 5, 0.5);
+  g_assert_cmpfloat_with_epsilon (sim_fps (&sim, 1), 5, 0.5);
+  sim_clear (&sim);
+
+  g_rand_free (rand);
+  prototype_frame_scheduler_free (scheduler);
+
+  config.enable = FALSE;
+  g_assert_null (prototype_frame_scheduler_new (&config));
+}
+
+/* 소스 64개가 30fps로 들어올 때 admit() 한 번의 비용 (분배 포함) */
+static void
+bench_admit (void)
+{
+  const guint num_sources = 64, seconds = 60;
+  PrototypeFrameScheduler *scheduler = NULL;
+  guint64 admitted = 0, calls = 0;
+  gdouble elapsed;
+  guint frame, s;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  scheduler = new_scheduler (num_sources * 30 / 2);
+  for (s = 0; s < num_sources; s++)
+    prototype_frame_scheduler_set_source_class (scheduler, s,
+        classes[s % G_N_ELEMENTS (classes)].name);
+
+  g_test_timer_start ();
+  for (frame = 0; frame < seconds * 30; frame++) {
+    for (s = 0; s < num_sources; s++) {
+      gint64 now = START_US + frame * (G_USEC_PER_SEC / 30) + s * 100;
+
+      admitted += prototype_frame_scheduler_admit (scheduler, s, now);
+      calls++;
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e9 / calls,
+      "admit: %.1f ns/frame (%u sources, %.0f%% admitted)",
+      elapsed * 1e9 / calls, num_sources, 100.0 * admitted / calls);
+
+  prototype_frame_scheduler_free (scheduler);
+}
+
+/*
+ * 실제 버퍼로 돌리는 파이프라인. videotestsrc is-live=true 소스들을 funnel의
+ * sink_%u 패드(streammux처럼 소스마다 하나)로 모으고, 앱의
+ * frame_scheduler_buf_prob처럼 각 sink 패드 프로브에서 admit()으로 거릅니다.
+ */
+#define PIPELINE_FPS 30
+
+typedef struct
+{
+  PrototypeFrameScheduler *scheduler;
+  guint num_sources;
+  GMutex lock;
+  /* 측정 구간 [window_start_us, window_end_us) 의 결과 */
+  gint64 window_start_us;
+  gint64 window_end_us;
+  guint admitted[MAX_SOURCES];
+  gint64 last_admit_us[MAX_SOURCES];
+  gint64 max_gap_us[MAX_SOURCES];
+  /* 구간과 관계없는 전체 통과 수와 fakesink가 받은 버퍼 수 */
+  guint total_admitted;
+  guint sink_buffers;
+} PipelineRun;
+
+static GstPadProbeReturn
+scheduler_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  PipelineRun *run = (PipelineRun *) u_data;
+  guint source_id =
+      GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "source-id"));
+  gint64 now_us = g_get_monotonic_time ();
+
+  if (!prototype_frame_scheduler_admit (run->scheduler, source_id, now_us))
+    return GST_PAD_PROBE_DROP;
+
+  g_mutex_lock (&run->lock);
+  run->total_admitted++;
+  if (now_us >= run->window_start_us && now_us < run->window_end_us) {
+    run->admitted[source_id]++;
+    if (run->last_admit_us[source_id] >= run->window_start_us)
+      run->max_gap_us[source_id] = MAX (run->max_gap_us[source_id],
+          now_us - run->last_admit_us[source_id]);
+  }
+  run->last_admit_us[source_id] = now_us;
+  g_mutex_unlock (&run->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+sink_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  PipelineRun *run = (PipelineRun *) u_data;
+
+  g_mutex_lock (&run->lock);
+  run->sink_buffers++;
+  g_mutex_unlock (&run->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pipeline_run (PipelineRun * run, gdouble warmup, gdouble duration)
+{
+  GString *launch = g_string_new ("funnel name=mux "
+      "! fakesink name=sink sync=false async=false");
+  GstElement *pipeline = NULL;
+  GstElement *mux = NULL;
+  GstElement *sink = NULL;
+  GstIterator *it = NULL;
+  GValue item = G_VALUE_INIT;
+  GstPad *pad = NULL;
+  GError *error = NULL;
+  guint i;
+
+  for (i = 0; i < run->num_sources; i++)
+    g_string_append_printf (launch, " videotestsrc is-live=true "
+        "! video/x-raw,width=64,height=64,framerate=%d/1 ! mux.sink_%u",
+        PIPELINE_FPS, i);
+  pipeline = gst_parse_launch (launch->str, &error);
+  g_assert_no_error (error);
+  g_string_free (launch, TRUE);
+
+  /* 앱과 같이 streammux 스타일 패드 이름에서 source-id를 얻습니다. */
+  mux = gst_bin_get_by_name (GST_BIN (pipeline), "mux");
+  it = gst_element_iterate_sink_pads (mux);
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    gchar *name = NULL;
+    guint source_id = 0;
+
+    pad = GST_PAD (g_value_get_object (&item));
+    name = gst_pad_get_name (pad);
+    g_assert_true (sscanf (name, "sink_%u", &source_id) == 1);
+    g_object_set_data (G_OBJECT (pad), "source-id",
+        GUINT_TO_POINTER (source_id));
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, scheduler_probe, run,
+        NULL);
+    g_free (name);
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, sink_probe, run, NULL);
+  gst_object_unref (pad);
+
+  g_mutex_init (&run->lock);
+  run->window_start_us = g_get_monotonic_time () +
+      (gint64) (warmup * G_USEC_PER_SEC);
+  run->window_end_us = run->window_start_us +
+      (gint64) (duration * G_USEC_PER_SEC);
+  for (i = 0; i < run->num_sources; i++)
+    run->last_admit_us[i] = -1;
+
+  g_assert_cmpint (gst_element_set_state (pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+  g_usleep (run->window_end_us - g_get_monotonic_time ());
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* 버려진 프레임은 내려가지 않고, 통과한 프레임은 모두 sink에 닿습니다. */
+  g_assert_cmpuint (run->sink_buffers, <=, run->total_admitted);
+  g_assert_cmpuint (run->sink_buffers + run->num_sources, >=,
+      run->total_admitted);
+
+  gst_object_unref (sink);
+  gst_object_unref (mux);
+  gst_object_unref (pipeline);
+  g_mutex_clear (&run->lock);
+}
+
+static gdouble
+pipeline_fps (PipelineRun * run, guint s)
+{
+  return run->admitted[s] * (gdouble) G_USEC_PER_SEC /
+      (run->window_end_us - run->window_start_us);
+}
+
+/* sim/weighted-shares와 같은 분배(28/7/5)를 실시간 30fps 버퍼로 확인합니다. */
+static void
+test_pipeline_weighted_shares (void)
+{
+  PipelineRun run = { 0 };
+  const gchar *names[] = { "entrance", "normal", "low" };
+  const gdouble expected[] = { 28, 7, 5 };
+  guint i;
+
+  run.scheduler = new_scheduler (40);
+  run.num_sources = 3;
+  for (i = 0; i < run.num_sources; i++)
+    g_assert_true (prototype_frame_scheduler_set_source_class (run.scheduler,
+            i, names[i]));
+
+  pipeline_run (&run, 3, 5);
+  for (i = 0; i < run.num_sources; i++) {
+    g_test_message ("source %u (%s): %.2f fps (allocated %.2f)", i, names[i],
+        pipeline_fps (&run, i),
+        prototype_frame_scheduler_allocated_fps (run.scheduler, i));
+    g_assert_cmpfloat_with_epsilon (pipeline_fps (&run, i), expected[i], 1.0);
+  }
+  prototype_frame_scheduler_free (run.scheduler);
+}
+
+/* 용량이 min-fps 합보다 작아도 소스마다 5fps, 1/min-fps 마감을 지킵니다. */
+static void
+test_pipeline_min_fps_deadline (void)
+{
+  PipelineRun run = { 0 };
+  guint i;
+
+  run.scheduler = new_scheduler (20);
+  run.num_sources = 10;
+  for (i = 0; i < run.num_sources; i++)
+    g_assert_true (prototype_frame_scheduler_set_source_class (run.scheduler,
+            i, "guaranteed"));
+
+  pipeline_run (&run, 3, 5);
+  for (i = 0; i < run.num_sources; i++) {
+    g_test_message ("source %u: %.2f fps, max gap %.1f ms", i,
+        pipeline_fps (&run, i), run.max_gap_us[i] / 1e3);
+    g_assert_cmpfloat (pipeline_fps (&run, i), >=, 5 * 0.95);
+    g_assert_cmpfloat (pipeline_fps (&run, i), <=, 5 * 1.15);
+    g_assert_cmpint (run.max_gap_us[i], <=,
+        G_USEC_PER_SEC / 5 + G_USEC_PER_SEC * 3 / (2 * PIPELINE_FPS));
+  }
+  prototype_frame_scheduler_free (run.scheduler);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+
+  g_test_add_func ("/frame-scheduler/sim/weighted-shares",
+      test_weighted_shares);
+  g_test_add_func ("/frame-scheduler/sim/equal-shares", test_equal_shares);
+  g_test_add_func ("/frame-scheduler/sim/mixed-demand", test_mixed_demand);
+  g_test_add_func ("/frame-scheduler/sim/min-fps-deadline",
+      test_min_fps_deadline);
+  g_test_add_func ("/frame-scheduler/sim/capacity-handback",
+      test_capacity_handback);
+  g_test_add_func ("/frame-scheduler/sim/unlimited", test_unlimited);
+  g_test_add_func ("/frame-scheduler/classes", test_classes);
+  g_test_add_func ("/frame-scheduler/pipeline/weighted-shares",
+      test_pipeline_weighted_shares);
+  g_test_add_func ("/frame-scheduler/pipeline/min-fps-deadline",
+      test_pipeline_min_fps_deadline);
+  g_test_add_func ("/frame-scheduler/bench/admit", bench_admit);
+
+  return g_test_run ();
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+
+#include "prototype_heatmap.h"
+
+#define FPS 30
+#define FRAME_TS(k) ((GstClockTime) (k) * GST_SECOND / FPS)
+
+static PrototypeHeatmap *
+new_heatmap (guint width, guint height, PrototypeHeatmapFootprint footprint,
+    guint half_life_sec)
+{
+  PrototypeHeatmapConfig config = {
+    .enable = TRUE,
+    .grid_width = width,
+    .grid_height = height,
+    .footprint = footprint,
+    .half_life_sec = half_life_sec,
+  };
+
+  return prototype_heatmap_new (&config);
+}
+
+static gfloat
+read_cell (PrototypeHeatmap * heatmap, guint width, guint height, guint x,
+    guint y, GstClockTime ts)
+{
+  gfloat *values = g_new (gfloat, width * height);
+  gfloat v;
+
+  g_assert_true (prototype_heatmap_read (heatmap, 0, ts, values));
+  v = values[y * width + x];
+  g_free (values);
+  return v;
+}
+
+/* 제자리에 선 객체: 감쇠한 관측 수가 해석해와 같아야 합니다. */
+static void
+test_stationary_decay (void)
+{
+  const guint half_life = 10, frames = 60 * FPS;
+  PrototypeHeatmap *heatmap = new_heatmap (10, 10,
+      PROTOTYPE_HEATMAP_FOOTPRINT_POINT, half_life);
+  /* 하단 중앙 (0.25, 0.75) -> 셀 (2, 7) */
+  PrototypeHeatmapBox box = { 0.15f, 0.3f, 0.2f, 0.45f };
+  GstClockTime end = FRAME_TS (frames - 1);
+  gdouble expected = 0;
+  guint k;
+
+  for (k = 0; k < frames; k++) {
+    prototype_heatmap_add (heatmap, 0, &box, 1, FRAME_TS (k));
+    expected += exp2 (-(gdouble) (end - FRAME_TS (k)) /
+        (half_life * GST_SECOND));
+  }
+  g_assert_cmpfloat_with_epsilon (read_cell (heatmap, 10, 10, 2, 7, end),
+      expected, expected * 5e-3);
+  g_assert_cmpfloat (read_cell (heatmap, 10, 10, 3, 7, end), ==, 0);
+
+  /* 관측 없이 세 반감기가 지나면 1/8 */
+  g_assert_cmpfloat_with_epsilon (read_cell (heatmap, 10, 10, 2, 7,
+          end + 3 * half_life * GST_SECOND), expected / 8, expected * 5e-3);
+
+  prototype_heatmap_free (heatmap);
+}
+
+static void
+test_exact_eighth (void)
+{
+  PrototypeHeatmap *heatmap = new_heatmap (4, 4,
+      PROTOTYPE_HEATMAP_FOOTPRINT_POINT, 5);
+  PrototypeHeatmapBox box = { 0.3f, 0.1f, 0.1f, 0.3f };
+
+  prototype_heatmap_add (heatmap, 0, &box, 1, 0);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 1, 1, 0), ==, 1);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 1, 1, 15 * GST_SECOND), ==,
+      0.125);
+
+  prototype_heatmap_free (heatmap);
+}
+
+/* 반감기마다 한 번씩 100번: 시프트 재정규화를 여러 번 거쳐도 2에 수렴 */
+static void
+test_renormalize (void)
+{
+  PrototypeHeatmap *heatmap = new_heatmap (4, 4,
+      PROTOTYPE_HEATMAP_FOOTPRINT_POINT, 1);
+  PrototypeHeatmapBox box = { 0.3f, 0.1f, 0.1f, 0.3f };
+  guint k;
+
+  for (k = 0; k < 100; k++)
+    prototype_heatmap_add (heatmap, 0, &box, 1, k * GST_SECOND);
+  g_assert_cmpfloat_with_epsilon (read_cell (heatmap, 4, 4, 1, 1,
+          99 * GST_SECOND), 2.0, 0.02);
+
+  /* 32 반감기 이상 건너뛰면 격자가 비워집니다. */
+  prototype_heatmap_add (heatmap, 0, &box, 1, 200 * GST_SECOND);
+  g_assert_cmpfloat_with_epsilon (read_cell (heatmap, 4, 4, 1, 1,
+          200 * GST_SECOND), 1.0, 1e-3);
+
+  prototype_heatmap_free (heatmap);
+}
+
+/* 오른쪽으로 한 셀씩 움직이는 bbox (감쇠 없음) */
+static void
+test_moving_box (void)
+{
+  PrototypeHeatmap *heatmap = new_heatmap (10, 10,
+      PROTOTYPE_HEATMAP_FOOTPRINT_BOX, 0);
+  gfloat values[100];
+  guint expected[100] = { 0 };
+  guint k, x, y;
+
+  for (k = 0; k < 4; k++) {
+    /* 열 1+k..3+k, 행 2..3 */
+    PrototypeHeatmapBox box = { 0.15f + 0.1f * k, 0.25f, 0.2f, 0.1f };
+
+    prototype_heatmap_add (heatmap, 0, &box, 1, FRAME_TS (k));
+    for (y = 2; y <= 3; y++)
+      for (x = 1 + k; x <= 3 + k; x++)
+        expected[y * 10 + x]++;
+  }
+
+  g_assert_true (prototype_heatmap_read (heatmap, 0, FRAME_TS (3), values));
+  for (k = 0; k < 100; k++)
+    g_assert_cmpfloat (values[k], ==, expected[k]);
+
+  prototype_heatmap_free (heatmap);
+}
+
+static void
+test_outside_frame (void)
+{
+  PrototypeHeatmap *point = new_heatmap (10, 10,
+      PROTOTYPE_HEATMAP_FOOTPRINT_POINT, 0);
+  PrototypeHeatmap *bbox = new_heatmap (10, 10,
+      PROTOTYPE_HEATMAP_FOOTPRINT_BOX, 0);
+  PrototypeHeatmapBox boxes[] = {
+    /* 하단 중앙이 프레임 밖 */
+    {1.1f, 0.2f, 0.2f, 0.2f},
+    /* 오른쪽 아래로 걸친 bbox: 가장자리 셀로 잘리고, 하단 중앙은 밖 */
+    {0.85f, 0.85f, 0.5f, 0.5f},
+    /* 하단 중앙이 정확히 (1, 1): 마지막 셀 */
+    {0.9f, 0.8f, 0.2f, 0.2f},
+  };
+  gfloat values[100];
+  gfloat total = 0;
+  guint i;
+
+  prototype_heatmap_add (point, 0, boxes, 3, 0);
+  g_assert_true (prototype_heatmap_read (point, 0, 0, values));
+  for (i = 0; i < 100; i++)
+    total += values[i];
+  g_assert_cmpfloat (total, ==, 1);
+  g_assert_cmpfloat (values[9 * 10 + 9], ==, 1);
+
+  prototype_heatmap_add (bbox, 0, boxes, 3, 0);
+  g_assert_true (prototype_heatmap_read (bbox, 0, 0, values));
+  total = 0;
+  for (i = 0; i < 100; i++)
+    total += values[i];
+  g_assert_cmpfloat (total, ==, 6);
+  g_assert_cmpfloat (values[8 * 10 + 8], ==, 1);
+  g_assert_cmpfloat (values[8 * 10 + 9], ==, 2);
+  g_assert_cmpfloat (values[9 * 10 + 9], ==, 2);
+
+  prototype_heatmap_free (bbox);
+  prototype_heatmap_free (point);
+}
+
+static void
+test_reset (void)
+{
+  PrototypeHeatmap *heatmap = new_heatmap (4, 4,
+      PROTOTYPE_HEATMAP_FOOTPRINT_POINT, 0);
+  PrototypeHeatmapBox a = { 0.05f, 0.05f, 0.1f, 0.1f };
+  PrototypeHeatmapBox b = { 0.55f, 0.55f, 0.1f, 0.1f };
+  gfloat values[16];
+
+  g_assert_false (prototype_heatmap_read (heatmap, 0, 0, values));
+
+  prototype_heatmap_add (heatmap, 0, &a, 1, 100 * GST_SECOND);
+  prototype_heatmap_add (heatmap, 0, &a, 1, 101 * GST_SECOND);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 0, 0, 101 * GST_SECOND), ==,
+      2);
+
+  /* 파일 반복 재생으로 타임스탬프가 되돌아가면 새로 시작합니다. */
+  prototype_heatmap_add (heatmap, 0, &b, 1, 0);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 0, 0, 0), ==, 0);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 2, 2, 0), ==, 1);
+
+  /* 소스 교체: 다음 add()에서 비워집니다. */
+  prototype_heatmap_remove_source (heatmap, 0);
+  prototype_heatmap_add (heatmap, 0, &a, 1, GST_SECOND);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 2, 2, GST_SECOND), ==, 0);
+  g_assert_cmpfloat (read_cell (heatmap, 4, 4, 0, 0, GST_SECOND), ==, 1);
+
+  prototype_heatmap_free (heatmap);
+}
+
+static guint32
+get_u32 (const guint8 * p)
+{
+  return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* PNG를 풀어 16비트 픽셀을 돌려줍니다. 청크 CRC와 헤더를 검사합니다. */
+static guint16 *
+decode_png (const gchar * path, guint * width, guint * height,
+    gchar ** comment)
+{
+  gchar *data = NULL;
+  gsize len = 0, pos = 8;
+  GByteArray *idat = g_byte_array_new ();
+  guint16 *pixels = NULL;
+  guint8 *raw = NULL;
+  uLongf raw_len;
+  gsize stride;
+  guint x, y;
+
+  g_assert_true (g_file_get_contents (path, &data, &len, NULL));
+  g_assert_cmpmem (data, 8, "\211PNG\r\n\032\n", 8);
+  *comment = NULL;
+
+  while (pos + 12 <= len) {
+    const guint8 *chunk = (const guint8 *) data + pos;
+    guint32 size = get_u32 (chunk);
+
+    g_assert_cmpuint (pos + 12 + size, <=, len);
+    g_assert_cmpuint (crc32 (0, chunk + 4, size + 4), ==,
+        get_u32 (chunk + 8 + size));
+    if (!memcmp (chunk + 4, "IHDR", 4)) {
+      *width = get_u32 (chunk + 8);
+      *height = get_u32 (chunk + 12);
+      g_assert_cmpuint (chunk[16], ==, 16);
+      g_assert_cmpuint (chunk[17], ==, 0);
+    } else if (!memcmp (chunk + 4, "tEXt", 4)) {
+      g_assert_cmpmem (chunk + 8, 8, "Comment", 8);
+      *comment = g_strndup ((const gchar *) chunk + 16, size - 8);
+    } else if (!memcmp (chunk + 4, "IDAT", 4)) {
+      g_byte_array_append (idat, chunk + 8, size);
+    }
+    pos += 12 + size;
+  }
+  g_assert_cmpuint (pos, ==, len);
+
+  stride = 1 + *width * 2;
+  raw_len = stride * *height;
+  raw = g_new (guint8, raw_len);
+  g_assert_cmpint (uncompress (raw, &raw_len, idat->data, idat->len), ==,
+      Z_OK);
+  g_assert_cmpuint (raw_len, ==, stride * *height);
+
+  pixels = g_new (guint16, *width * *height);
+  for (y = 0; y < *height; y++) {
+    guint8 *line = raw + y * stride;
+
+    g_assert_cmpuint (line[0], ==, 1);
+    /* Sub 필터: 2바이트 앞의 값을 더해 되돌립니다. */
+    for (x = 2; x < *width * 2; x++)
+      line[1 + x] += line[1 + x - 2];
+    for (x = 0; x < *width; x++)
+      pixels[y * *width + x] = (line[1 + 2 * x] << 8) | line[2 + 2 * x];
+  }
+
+  g_free (raw);
+  g_byte_array_unref (idat);
+  g_free (data);
+  return pixels;
+}
+
+static void
+test_png_round_trip (void)
+{
+  const guint width = 37, height = 11;
+  gchar *dir = g_dir_make_tmp ("heatmap-XXXXXX", NULL);
+  gchar *path = g_build_filename (dir, "round-trip.png", NULL);
+  guint16 *pixels = g_new (guint16, width * height);
+  guint16 *decoded = NULL;
+  gchar *comment = NULL;
+  guint w = 0, h = 0, i;
+
+  for (i = 0; i < width * height; i++)
+    pixels[i] = (guint16) (i * 7919u);
+  g_assert_true (prototype_heatmap_write_png (path, pixels, width, height,
+          "hello", NULL));
+
+  decoded = decode_png (path, &w, &h, &comment);
+  g_assert_cmpuint (w, ==, width);
+  g_assert_cmpuint (h, ==, height);
+  g_assert_cmpstr (comment, ==, "hello");
+  g_assert_cmpmem (decoded, width * height * 2, pixels, width * height * 2);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (comment);
+  g_free (decoded);
+  g_free (pixels);
+  g_free (path);
+  g_free (dir);
+}
+
+/* 1초 주기로 3.5초 재생: 1, 2, 3초에 스냅샷이 하나씩 */
+static void
+test_snapshots (void)
+{
+  gchar *dir = g_dir_make_tmp ("heatmap-XXXXXX", NULL);
+  PrototypeHeatmapConfig config = {
+    .enable = TRUE,
+    .grid_width = 8,
+    .grid_height = 6,
+    .footprint = PROTOTYPE_HEATMAP_FOOTPRINT_POINT,
+    .half_life_sec = 60,
+    .snapshot_interval_sec = 1,
+    .output_dir = dir,
+  };
+  PrototypeHeatmap *heatmap = prototype_heatmap_new (&config);
+  /* 하단 중앙 (0.3125, 0.5833) -> 셀 (2, 3) */
+  PrototypeHeatmapBox box = { 0.25f, 0.4f, 0.125f, 0.1833f };
+  const gchar *names[] = { "heatmap-0-1000.png", "heatmap-0-2000.png",
+    "heatmap-0-3000.png"
+  };
+  guint k;
+
+  g_assert_nonnull (heatmap);
+  for (k = 0; k < 3.5 * FPS; k++)
+    prototype_heatmap_add (heatmap, 0, &box, 1, FRAME_TS (k));
+  /* 쓰기 스레드가 밀린 스냅샷을 다 쓴 뒤 반환합니다. */
+  prototype_heatmap_free (heatmap);
+
+  for (k = 0; k < G_N_ELEMENTS (names); k++) {
+    gchar *path = g_build_filename (dir, names[k], NULL);
+    gchar *comment = NULL;
+    guint16 *pixels = NULL;
+    guint w = 0, h = 0, i;
+
+    pixels = decode_png (path, &w, &h, &comment);
+    g_assert_cmpuint (w, ==, 8);
+    g_assert_cmpuint (h, ==, 6);
+    for (i = 0; i < w * h; i++)
+      g_assert_cmpuint (pixels[i], ==, i == 3 * 8 + 2 ? 65535 : 0);
+    g_assert_nonnull (comment);
+    g_assert_true (g_str_has_prefix (comment, "source-id=0;"));
+    g_assert_nonnull (strstr (comment, "footprint=point"));
+
+    g_unlink (path);
+    g_free (pixels);
+    g_free (comment);
+    g_free (path);
+  }
+  g_assert_cmpint (g_rmdir (dir), ==, 0);
+  g_free (dir);
+}
+
+static void
+bench_splat (PrototypeHeatmapFootprint footprint)
+{
+  const guint num_sources = 64, num_objects = 100, seconds = 10;
+  PrototypeHeatmap *heatmap = new_heatmap (160, 90, footprint, 600);
+  GRand *rand = g_rand_new_with_seed (7);
+  PrototypeHeatmapBox *boxes = g_new (PrototypeHeatmapBox,
+      num_sources * num_objects);
+  gdouble elapsed;
+  guint k, s, i;
+
+  for (i = 0; i < num_sources * num_objects; i++) {
+    boxes[i].width = g_rand_double_range (rand, 0.02, 0.06);
+    boxes[i].height = g_rand_double_range (rand, 0.08, 0.25);
+    boxes[i].left = g_rand_double_range (rand, 0, 1 - boxes[i].width);
+    boxes[i].top = g_rand_double_range (rand, 0, 1 - boxes[i].height);
+  }
+
+  g_test_timer_start ();
+  for (k = 0; k < seconds * FPS; k++) {
+    for (s = 0; s < num_sources; s++) {
+      PrototypeHeatmapBox *frame = &boxes[s * num_objects];
+
+      prototype_heatmap_add (heatmap, s, frame, num_objects, FRAME_TS (k));
+      /* 걷는 사람 정도로 조금씩 이동 */
+      for (i = 0; i < num_objects; i++)
+        frame[i].left = fmodf (frame[i].left + 0.001f, 0.9f);
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 100 / seconds,
+      "%s: %.2f%% of a core (%u sources x %u objects x %u fps)",
+      footprint == PROTOTYPE_HEATMAP_FOOTPRINT_BOX ? "bbox" : "point",
+      elapsed * 100 / seconds, num_sources, num_objects, FPS);
+
+  g_free (boxes);
+  g_rand_free (rand);
+  prototype_heatmap_free (heatmap);
+}
+
+static void
+bench_splat_point (void)
+{
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+  bench_splat (PROTOTYPE_HEATMAP_FOOTPRINT_POINT);
+}
+
+static void
+bench_splat_box (void)
+{
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+  bench_splat (PROTOTYPE_HEATMAP_FOOTPRINT_BOX);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/heatmap/stationary-decay", test_stationary_decay);
+  g_test_add_func ("/heatmap/exact-eighth", test_exact_eighth);
+  g_test_add_func ("/heatmap/renormalize", test_renormalize);
+  g_test_add_func ("/heatmap/moving-box", test_moving_box);
+  g_test_add_func ("/heatmap/outside-frame", test_outside_frame);
+  g_test_add_func ("/heatmap/reset", test_reset);
+  g_test_add_func ("/heatmap/png-round-trip", test_png_round_trip);
+  g_test_add_func ("/heatmap/snapshots", test_snapshots);
+  g_test_add_func ("/heatmap/bench/point", bench_splat_point);
+  g_test_add_func ("/heatmap/bench/bbox", bench_splat_box);
+
+  return g_test_run ();
+}
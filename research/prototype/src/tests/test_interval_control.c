@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "prototype_interval_control.h"
+
+#define MAX_SOURCES 64
+#define SOURCE_FPS 30.0
+#define MAX_INTERVAL 4
+#define LOWER_AFTER 6
+
+/*
+ * 모의 파이프라인 (perf 주기 1초).
+ * 프레임마다 고정 비용과, interval + 1 프레임에 한 번 추론 비용이 들고
+ * 주기마다 쓸 수 있는 GPU 시간은 capacity_ms입니다. 처리하지 못한 프레임은
+ * 큐에 쌓여 지연이 되고, 큐가 1초 분량을 넘으면 라이브 소스처럼 버립니다.
+ */
+typedef struct
+{
+  guint num_sources;
+  gdouble fixed_ms;
+  gdouble infer_ms;
+  gdouble capacity_ms;
+  gdouble base_latency_ms;
+  gdouble backlog;
+} Plant;
+
+static gdouble
+plant_frame_cost (const Plant * plant, guint interval)
+{
+  return plant->fixed_ms + plant->infer_ms / (interval + 1);
+}
+
+/* 실시간을 유지할 수 있는 가장 작은 interval */
+static guint
+plant_feasible_interval (const Plant * plant)
+{
+  guint interval;
+
+  for (interval = 0; interval < MAX_INTERVAL; interval++) {
+    if (plant->num_sources * SOURCE_FPS * plant_frame_cost (plant, interval)
+        <= plant->capacity_ms)
+      break;
+  }
+  return interval;
+}
+
+/* 한 주기를 진행하고 소스별 FPS와 프레임 지연을 제어기에 넘깁니다. */
+static PrototypeIntervalDecision
+plant_step (Plant * plant, PrototypeIntervalControl * control,
+    guint * interval)
+{
+  gdouble fps[MAX_SOURCES];
+  gdouble arrivals = plant->num_sources * SOURCE_FPS;
+  gdouble capacity = plant->capacity_ms / plant_frame_cost (plant, *interval);
+  gdouble processed = MIN (plant->backlog + arrivals, capacity);
+  gdouble latency;
+  guint i;
+
+  plant->backlog = MIN (plant->backlog + arrivals - processed, arrivals);
+  latency = plant->base_latency_ms + plant->backlog / capacity * 1000;
+  for (i = 0; i < 10; i++)
+    prototype_interval_control_record_latency (control, latency);
+  for (i = 0; i < plant->num_sources; i++)
+    fps[i] = processed / plant->num_sources;
+
+  return prototype_interval_control_update (control, fps, plant->num_sources,
+      interval);
+}
+
+static PrototypeIntervalControl *
+new_control (guint initial_interval, guint num_weights, guint * ids,
+    gdouble * weights)
+{
+  PrototypeIntervalControlConfig config = {
+    .enable = TRUE,
+    .min_interval = 0,
+    .max_interval = MAX_INTERVAL,
+    .target_fps = SOURCE_FPS,
+    .fps_low_ratio = 0.9,
+    .fps_high_ratio = 0.97,
+    .latency_budget_ms = 500,
+    .raise_after = 2,
+    .lower_after = LOWER_AFTER,
+    .num_weights = num_weights,
+    .weight_source_ids = ids,
+    .weights = weights,
+  };
+
+  return prototype_interval_control_new (&config, initial_interval);
+}
+
+/*
+ * 정착 구간에서 interval이 실시간 가능한 최솟값에 머무는지.
+ * 한 단계 아래를 가끔 시험하는 것은 허용합니다.
+ */
+static void
+run_and_check_settled (Plant * plant, PrototypeIntervalControl * control,
+    guint * interval, guint periods, guint settle)
+{
+  guint feasible = plant_feasible_interval (plant);
+  guint at_feasible = 0, real_time = 0, k;
+
+  for (k = 0; k < periods; k++) {
+    plant_step (plant, control, interval);
+    if (k < settle)
+      continue;
+    g_assert_cmpuint (*interval, <=, feasible);
+    g_assert_cmpuint (*interval + 1, >=, feasible);
+    if (*interval == feasible)
+      at_feasible++;
+    if (plant->backlog == 0)
+      real_time++;
+  }
+  g_test_message ("%u sources: interval %u in %u of %u periods",
+      plant->num_sources, feasible, at_feasible, periods - settle);
+  g_assert_cmpuint (at_feasible, >=, (periods - settle) * 8 / 10);
+  g_assert_cmpuint (real_time, >=, (periods - settle) * 8 / 10);
+}
+
+static void
+test_settle (void)
+{
+  Plant plant = { 16, 0.5, 6.0, 1000, 40, 0 };
+  PrototypeIntervalControl *control = new_control (0, 0, NULL, NULL);
+  guint interval = 0;
+
+  g_assert_cmpuint (plant_feasible_interval (&plant), ==, 3);
+  run_and_check_settled (&plant, control, &interval, 400, 60);
+
+  prototype_interval_control_free (control);
+}
+
+/* 부하 계단: 16 -> 40 (불가능, max-interval) -> 10 소스 */
+static void
+test_load_steps (void)
+{
+  Plant plant = { 16, 0.5, 6.0, 1000, 40, 0 };
+  PrototypeIntervalControl *control = new_control (0, 0, NULL, NULL);
+  guint interval = 0, k;
+
+  run_and_check_settled (&plant, control, &interval, 200, 60);
+
+  plant.num_sources = 40;
+  for (k = 0; k < 30; k++)
+    plant_step (&plant, control, &interval);
+  g_assert_cmpuint (interval, ==, MAX_INTERVAL);
+  for (k = 0; k < 100; k++) {
+    plant_step (&plant, control, &interval);
+    g_assert_cmpuint (interval, ==, MAX_INTERVAL);
+  }
+
+  plant.num_sources = 10;
+  g_assert_cmpuint (plant_feasible_interval (&plant), ==, 2);
+  run_and_check_settled (&plant, control, &interval, 400, 100);
+
+  prototype_interval_control_free (control);
+}
+
+typedef struct
+{
+  guint num_sources;
+  guint feasible;
+} ProbeCase;
+
+/*
+ * 실패한 내림 시험 사이의 간격은 lower-after의 2, 4, 8배로 늘어납니다.
+ * 10 소스는 한 단계 아래가 5%만 넘쳐 지연이 lower-after보다 늦게 예산을
+ * 넘는 경우입니다.
+ */
+static void
+test_probe_backoff (gconstpointer data)
+{
+  const ProbeCase *probe = (const ProbeCase *) data;
+  Plant plant = { probe->num_sources, 0.5, 6.0, 1000, 40, 0 };
+  PrototypeIntervalControl *control = new_control (probe->feasible, 0, NULL,
+      NULL);
+  guint interval = probe->feasible, last_lower = 0, num_lowers = 0, k;
+  guint gaps[8];
+
+  g_assert_cmpuint (plant_feasible_interval (&plant), ==, probe->feasible);
+  for (k = 1; k <= 600 && num_lowers < G_N_ELEMENTS (gaps); k++) {
+    if (plant_step (&plant, control, &interval) != PROTOTYPE_INTERVAL_LOWER)
+      continue;
+    g_assert_cmpuint (interval, ==, probe->feasible - 1);
+    if (num_lowers)
+      gaps[num_lowers - 1] = k - last_lower;
+    last_lower = k;
+    num_lowers++;
+  }
+  g_assert_cmpuint (num_lowers, >=, 5);
+  for (k = 0; k + 1 < num_lowers - 1; k++) {
+    g_test_message ("gap %u: %u periods", k, gaps[k]);
+    g_assert_cmpuint (gaps[k + 1], >=, gaps[k]);
+  }
+  /* 상한 8배에 도달한 뒤에는 간격이 더 늘지 않습니다. */
+  g_assert_cmpuint (gaps[num_lowers - 2], >=, 8 * LOWER_AFTER);
+  g_assert_cmpuint (gaps[num_lowers - 2], <=, 8 * LOWER_AFTER + 15);
+
+  prototype_interval_control_free (control);
+}
+
+/* 가중치 0인 소스가 늦어도 interval은 그대로, 가중치 있는 소스는 올립니다. */
+static void
+test_weights (void)
+{
+  guint ids[] = { 1 };
+  gdouble weights[] = { 0 };
+  PrototypeIntervalControl *control = new_control (1, 1, ids, weights);
+  gdouble fps[2] = { SOURCE_FPS, 10 };
+  guint interval = 1, k;
+
+  for (k = 0; k < 50; k++) {
+    g_assert_cmpint (prototype_interval_control_update (control, fps, 2,
+            &interval), !=, PROTOTYPE_INTERVAL_RAISE);
+  }
+  /* 가중치 1인 소스 0은 정상이라 내려갑니다. */
+  g_assert_cmpuint (interval, ==, 0);
+
+  fps[0] = 20;
+  fps[1] = SOURCE_FPS;
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 2,
+          &interval), ==, PROTOTYPE_INTERVAL_HOLD);
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 2,
+          &interval), ==, PROTOTYPE_INTERVAL_RAISE);
+  g_assert_cmpuint (interval, ==, 1);
+
+  prototype_interval_control_free (control);
+}
+
+/* FPS는 정상이어도 지연이 예산을 넘고 늘어나면 올리고, 줄어드는 중이면 유지 */
+static void
+test_latency_budget (void)
+{
+  PrototypeIntervalControl *control = new_control (1, 0, NULL, NULL);
+  gdouble fps[1] = { SOURCE_FPS };
+  guint interval = 1;
+
+  prototype_interval_control_record_latency (control, 600);
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 1,
+          &interval), ==, PROTOTYPE_INTERVAL_HOLD);
+  prototype_interval_control_record_latency (control, 700);
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 1,
+          &interval), ==, PROTOTYPE_INTERVAL_RAISE);
+  g_assert_cmpuint (interval, ==, 2);
+  g_assert_cmpfloat (prototype_interval_control_last_latency (control), ==,
+      700);
+
+  /* 큐가 빠지는 중: 예산 위지만 줄어들고 있으면 과부하가 아닙니다. */
+  prototype_interval_control_record_latency (control, 650);
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 1,
+          &interval), ==, PROTOTYPE_INTERVAL_HOLD);
+  prototype_interval_control_record_latency (control, 550);
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 1,
+          &interval), ==, PROTOTYPE_INTERVAL_HOLD);
+  g_assert_cmpuint (interval, ==, 2);
+
+  /* 측정값이 없는 주기의 지연은 0 */
+  prototype_interval_control_update (control, fps, 1, &interval);
+  g_assert_cmpfloat (prototype_interval_control_last_latency (control), ==,
+      0);
+
+  prototype_interval_control_free (control);
+}
+
+/* target-fps가 0이면 관측한 최대 FPS를 목표로 학습합니다. */
+static void
+test_learned_target (void)
+{
+  PrototypeIntervalControlConfig config = {
+    .enable = TRUE,
+    .max_interval = MAX_INTERVAL,
+    .fps_low_ratio = 0.9,
+    .fps_high_ratio = 0.97,
+    .raise_after = 1,
+    .lower_after = LOWER_AFTER,
+  };
+  PrototypeIntervalControl *control = prototype_interval_control_new (&config,
+      0);
+  /* 소스 0은 15fps 카메라, 소스 1은 30fps 카메라 */
+  gdouble fps[2] = { 15, SOURCE_FPS };
+  guint interval = 0, k;
+
+  for (k = 0; k < 20; k++)
+    g_assert_cmpint (prototype_interval_control_update (control, fps, 2,
+            &interval), ==, PROTOTYPE_INTERVAL_HOLD);
+
+  fps[1] = 20;
+  g_assert_cmpint (prototype_interval_control_update (control, fps, 2,
+          &interval), ==, PROTOTYPE_INTERVAL_RAISE);
+
+  prototype_interval_control_free (control);
+}
+
+static void
+test_disabled (void)
+{
+  PrototypeIntervalControlConfig config = { 0 };
+
+  g_assert_null (prototype_interval_control_new (&config, 0));
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const ProbeCase fast_probe = { 16, 3 };
+  static const ProbeCase slow_probe = { 10, 2 };
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/interval-control/plant/settle", test_settle);
+  g_test_add_func ("/interval-control/plant/load-steps", test_load_steps);
+  g_test_add_data_func ("/interval-control/plant/probe-backoff/fast",
+      &fast_probe, test_probe_backoff);
+  g_test_add_data_func ("/interval-control/plant/probe-backoff/slow",
+      &slow_probe, test_probe_backoff);
+  g_test_add_func ("/interval-control/weights", test_weights);
+  g_test_add_func ("/interval-control/latency-budget", test_latency_budget);
+  g_test_add_func ("/interval-control/learned-target", test_learned_target);
+  g_test_add_func ("/interval-control/disabled", test_disabled);
+
+  return g_test_run ();
+}
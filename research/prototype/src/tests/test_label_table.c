@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "deepstream_label_table.h"
+
+/* 라벨 테이블은 프로세스 전역이므로 테스트마다 다른 GIE id와 라벨을 씁니다. */
+#define NUM_OBJECTS 1000
+
+/*
+ * malloc/calloc/realloc을 가로채 counting 구간의 할당 수를 셉니다.
+ * g_malloc과 g_strdup도 결국 여기를 거칩니다(glibc 전용).
+ */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static gint counting;
+static gint allocations;
+
+void *
+malloc (size_t size)
+{
+  if (g_atomic_int_get (&counting))
+    g_atomic_int_inc (&allocations);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  if (g_atomic_int_get (&counting))
+    g_atomic_int_inc (&allocations);
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  if (g_atomic_int_get (&counting))
+    g_atomic_int_inc (&allocations);
+  return __libc_realloc (ptr, size);
+}
+
+static void
+count_allocations (gboolean on)
+{
+  if (on)
+    g_atomic_int_set (&allocations, 0);
+  g_atomic_int_set (&counting, on);
+}
+
+/* parse_labels_file이 만드는 것과 같은 모양의 라벨 배열 (출력 1개) */
+typedef struct
+{
+  guint n_label_outputs[1];
+  gchar **outputs[1];
+} LabelFile;
+
+static void
+label_file_init (LabelFile * file, const gchar * prefix, guint n)
+{
+  guint i;
+
+  file->n_label_outputs[0] = n;
+  file->outputs[0] = g_new0 (gchar *, n + 1);
+  for (i = 0; i < n; i++)
+    file->outputs[0][i] = g_strdup_printf ("%s-%u", prefix, i);
+}
+
+static void
+label_file_clear (LabelFile * file)
+{
+  g_strfreev (file->outputs[0]);
+}
+
+/* nvinfer가 분류기 출력마다 붙이는 것과 같은 classifier 메타 */
+typedef struct
+{
+  NvDsClassifierMeta classifier;
+  NvDsLabelInfo info;
+  GList node;
+} SyntheticResult;
+
+static void
+synthetic_result_init (SyntheticResult * result, gint gie_id,
+    guint class_id, const gchar * label)
+{
+  memset (result, 0, sizeof (*result));
+  result->info.label_id = 0;
+  result->info.result_class_id = class_id;
+  g_strlcpy (result->info.result_label, label, MAX_LABEL_SIZE);
+  result->node.data = &result->info;
+  result->classifier.unique_component_id = gie_id;
+  result->classifier.num_labels = 1;
+  result->classifier.label_info_list = &result->node;
+}
+
+/* make/type/color 세 SGIE의 결과를 가진 객체 */
+typedef struct
+{
+  SyntheticResult results[3];
+} SyntheticObject;
+
+static const gchar *attr_prefix[3] = { "make", "type", "color" };
+static const guint attr_count[3] = { 40, 8, 12 };
+
+static SyntheticObject *
+make_objects (guint first_gie_id, LabelFile * files)
+{
+  SyntheticObject *objects = g_new (SyntheticObject, NUM_OBJECTS);
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, a;
+
+  for (i = 0; i < NUM_OBJECTS; i++) {
+    for (a = 0; a < 3; a++) {
+      guint class_id = g_rand_int_range (rand, 0, attr_count[a]);
+
+      synthetic_result_init (&objects[i].results[a], first_gie_id + a,
+          class_id, files[a].outputs[0][class_id]);
+    }
+  }
+  g_rand_free (rand);
+  return objects;
+}
+
+static void
+register_files (guint first_gie_id, const gchar * tag, LabelFile * files)
+{
+  guint a;
+
+  for (a = 0; a < 3; a++) {
+    gchar *prefix = g_strdup_printf ("%s-%s", tag, attr_prefix[a]);
+
+    label_file_init (&files[a], prefix, attr_count[a]);
+    nvds_label_table_add_gie (first_gie_id + a, 1, files[a].n_label_outputs,
+        files[a].outputs);
+    g_free (prefix);
+  }
+}
+
+static void
+test_intern (void)
+{
+  guint id = nvds_label_table_intern ("intern-sedan");
+  const gchar *name = nvds_label_table_name (id);
+
+  g_assert_cmpuint (id, !=, 0);
+  g_assert_cmpstr (name, ==, "intern-sedan");
+  g_assert_cmpuint (nvds_label_table_intern ("intern-sedan"), ==, id);
+  g_assert_cmpuint (nvds_label_table_find ("intern-sedan"), ==, id);
+  g_assert_true (nvds_label_table_name (id) == name);
+
+  g_assert_cmpuint (nvds_label_table_intern (NULL), ==, 0);
+  g_assert_cmpuint (nvds_label_table_intern (""), ==, 0);
+  g_assert_cmpuint (nvds_label_table_find ("intern-unknown"), ==, 0);
+  g_assert_null (nvds_label_table_name (0));
+  g_assert_null (nvds_label_table_name (G_MAXUINT));
+}
+
+static void
+test_zero_allocation (void)
+{
+  LabelFile files[3];
+  SyntheticObject *objects = NULL;
+  guint64 inserts;
+  guint size, round, i, a;
+
+  /* 할당 계수가 실제로 동작하는지 먼저 확인합니다. */
+  count_allocations (TRUE);
+  g_free (g_strdup ("zero-check"));
+  count_allocations (FALSE);
+  g_assert_cmpint (allocations, ==, 1);
+
+  register_files (10, "zero", files);
+  objects = make_objects (10, files);
+  size = nvds_label_table_size ();
+  inserts = nvds_label_table_runtime_inserts ();
+
+  /* schema_fill_sample_sgie_vehicle_metadata가 하는 것처럼 객체마다 세 라벨을 풉니다. */
+  count_allocations (TRUE);
+  for (round = 0; round < 100; round++) {
+    for (i = 0; i < NUM_OBJECTS; i++) {
+      for (a = 0; a < 3; a++) {
+        SyntheticResult *result = &objects[i].results[a];
+        const gchar *name = nvds_label_table_name
+            (nvds_label_table_first_result (&result->classifier));
+
+        if (g_strcmp0 (name, result->info.result_label) != 0)
+          g_assert_not_reached ();
+      }
+    }
+  }
+  count_allocations (FALSE);
+
+  g_assert_cmpint (allocations, ==, 0);
+  g_assert_cmpuint (nvds_label_table_size (), ==, size);
+  g_assert_cmpuint (nvds_label_table_runtime_inserts (), ==, inserts);
+
+  /* 같은 라벨은 언제나 같은 포인터로 풀립니다. */
+  g_assert_true (nvds_label_table_name (nvds_label_table_first_result
+          (&objects[0].results[0].classifier)) ==
+      nvds_label_table_name (nvds_label_table_find
+          (objects[0].results[0].info.result_label)));
+
+  g_free (objects);
+  for (a = 0; a < 3; a++)
+    label_file_clear (&files[a]);
+}
+
+static void
+test_label_mismatch (void)
+{
+  LabelFile files[3];
+  SyntheticResult result;
+  guint id, a;
+
+  register_files (20, "mismatch", files);
+
+  /* nvinfer가 다른 라벨 파일을 쓰면 (label_id, class_id) 대신 문자열로 풉니다. */
+  synthetic_result_init (&result, 20, 3, "mismatch-type-1");
+  id = nvds_label_table_first_result (&result.classifier);
+  g_assert_cmpstr (nvds_label_table_name (id), ==, "mismatch-type-1");
+
+  /* 어느 라벨 파일에도 없는 라벨은 처음 한 번만 추가됩니다. */
+  synthetic_result_init (&result, 20, 3, "mismatch-unlisted");
+  id = nvds_label_table_first_result (&result.classifier);
+  g_assert_cmpstr (nvds_label_table_name (id), ==, "mismatch-unlisted");
+  g_assert_cmpuint (nvds_label_table_runtime_inserts (), ==, 1);
+
+  count_allocations (TRUE);
+  g_assert_cmpuint (nvds_label_table_first_result (&result.classifier), ==,
+      id);
+  count_allocations (FALSE);
+  g_assert_cmpint (allocations, ==, 0);
+  g_assert_cmpuint (nvds_label_table_runtime_inserts (), ==, 1);
+
+  for (a = 0; a < 3; a++)
+    label_file_clear (&files[a]);
+}
+
+static void
+test_unregistered_gie (void)
+{
+  SyntheticResult result;
+  guint id = nvds_label_table_intern ("unregistered-truck");
+
+  /* 라벨 파일을 모르는 GIE의 결과도 이미 있는 라벨이면 같은 id로 풉니다. */
+  synthetic_result_init (&result, 99, 0, "unregistered-truck");
+  g_assert_cmpuint (nvds_label_table_first_result (&result.classifier), ==,
+      id);
+
+  /* 빈 라벨과 class id 범위 밖은 0입니다. */
+  synthetic_result_init (&result, 99, 1000, "");
+  g_assert_cmpuint (nvds_label_table_first_result (&result.classifier), ==, 0);
+}
+
+static void
+test_pointer_label (void)
+{
+  LabelFile files[3];
+  SyntheticResult result;
+  guint a;
+
+  register_files (30, "pointer", files);
+
+  /* result_label보다 긴 라벨은 pResult_label로 옵니다. */
+  synthetic_result_init (&result, 30, 2, "");
+  result.info.pResult_label = files[0].outputs[0][2];
+  g_assert_cmpstr (nvds_label_table_name (nvds_label_table_first_result
+          (&result.classifier)), ==, "pointer-make-2");
+
+  for (a = 0; a < 3; a++)
+    label_file_clear (&files[a]);
+}
+
+static void
+bench_resolve (void)
+{
+  LabelFile files[3];
+  SyntheticObject *objects = NULL;
+  guint rounds = 1000, round, i, a;
+  gdouble elapsed;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  register_files (40, "bench", files);
+  objects = make_objects (40, files);
+
+  g_test_timer_start ();
+  for (round = 0; round < rounds; round++) {
+    for (i = 0; i < NUM_OBJECTS; i++) {
+      for (a = 0; a < 3; a++)
+        nvds_label_table_first_result (&objects[i].results[a].classifier);
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e9 / (rounds * NUM_OBJECTS),
+      "interned: %.1f ns/object (3 labels)",
+      elapsed * 1e9 / (rounds * NUM_OBJECTS));
+
+  /*
+   * 이전 방식: 채울 때 g_strdup, 메타 복사에서 g_strdup, 해제에서 두 번 g_free.
+   */
+  g_test_timer_start ();
+  for (round = 0; round < rounds; round++) {
+    for (i = 0; i < NUM_OBJECTS; i++) {
+      for (a = 0; a < 3; a++) {
+        gchar *label = g_strdup (objects[i].results[a].info.result_label);
+        gchar *copy = g_strdup (label);
+
+        g_free (label);
+        g_free (copy);
+      }
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e9 / (rounds * NUM_OBJECTS),
+      "strdup copies: %.1f ns/object (3 labels)",
+      elapsed * 1e9 / (rounds * NUM_OBJECTS));
+
+  g_free (objects);
+  for (a = 0; a < 3; a++)
+    label_file_clear (&files[a]);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/label-table/intern", test_intern);
+  g_test_add_func ("/label-table/classifier/zero-allocation",
+      test_zero_allocation);
+  g_test_add_func ("/label-table/classifier/label-mismatch",
+      test_label_mismatch);
+  g_test_add_func ("/label-table/classifier/unregistered-gie",
+      test_unregistered_gie);
+  g_test_add_func ("/label-table/classifier/pointer-label", test_pointer_label);
+  g_test_add_func ("/label-table/bench/resolve", bench_resolve);
+
+  return g_test_run ();
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "prototype_latency_histogram.h"
+
+#define MAX_US (60 * G_USEC_PER_SEC)
+
+static gint
+compare_guint64 (gconstpointer a, gconstpointer b)
+{
+  guint64 x = *(const guint64 *) a;
+  guint64 y = *(const guint64 *) b;
+
+  return (x > y) - (x < y);
+}
+
+/* 정렬된 샘플에서 히스토그램과 같은 정의(ceil(p * n) 번째 값)의 백분위수 */
+static guint64
+exact_percentile (const guint64 * sorted, guint n, gdouble percentile)
+{
+  guint64 rank = (guint64) ceil (percentile / 100.0 * n);
+
+  return sorted[MAX (rank, 1) - 1];
+}
+
+/* 기록한 값과 백분위수의 상대 오차가 유효 숫자 2자리(1%) 안인지 확인합니다. */
+static void
+check_percentiles (LatencyHistogram * hist, guint64 * samples, guint n)
+{
+  static const gdouble percentiles[] = { 1, 10, 50, 90, 99, 99.9, 100 };
+  guint i;
+
+  qsort (samples, n, sizeof (guint64), compare_guint64);
+  g_assert_cmpuint (latency_histogram_count (hist), ==, n);
+  g_assert_cmpuint (latency_histogram_max (hist), ==, samples[n - 1]);
+  for (i = 0; i < G_N_ELEMENTS (percentiles); i++) {
+    guint64 exact = exact_percentile (samples, n, percentiles[i]);
+    guint64 value =
+        latency_histogram_value_at_percentile (hist, percentiles[i]);
+
+    g_assert_cmpuint (value, >=, exact);
+    g_assert_cmpfloat ((gdouble) (value - exact), <=, exact * 0.01);
+  }
+}
+
+static void
+test_exact_small_values (void)
+{
+  LatencyHistogram *hist = latency_histogram_new (MAX_US, 2);
+  guint64 v;
+
+  /* 2 * 10^2 미만은 1 단위 해상도로 정확히 기록됩니다. */
+  for (v = 1; v <= 100; v++)
+    latency_histogram_record (hist, v);
+  g_assert_cmpuint (latency_histogram_value_at_percentile (hist, 0), ==, 1);
+  g_assert_cmpuint (latency_histogram_value_at_percentile (hist, 50), ==, 50);
+  g_assert_cmpuint (latency_histogram_value_at_percentile (hist, 99), ==, 99);
+  g_assert_cmpuint (latency_histogram_value_at_percentile (hist, 100), ==,
+      100);
+  latency_histogram_free (hist);
+}
+
+static void
+test_uniform (void)
+{
+  LatencyHistogram *hist = latency_histogram_new (MAX_US, 2);
+  GRand *rand = g_rand_new_with_seed (26);
+  guint n = 200000;
+  guint64 *samples = g_new (guint64, n);
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    samples[i] = g_rand_int_range (rand, 1, 2 * G_USEC_PER_SEC);
+    latency_histogram_record (hist, samples[i]);
+  }
+  check_percentiles (hist, samples, n);
+
+  g_free (samples);
+  g_rand_free (rand);
+  latency_histogram_free (hist);
+}
+
+static void
+test_lognormal (void)
+{
+  LatencyHistogram *hist = latency_histogram_new (MAX_US, 2);
+  GRand *rand = g_rand_new_with_seed (27);
+  guint n = 200000;
+  guint64 *samples = g_new (guint64, n);
+  guint i;
+
+  /* 중앙값 30ms, 꼬리가 긴 지연 분포 (Box-Muller) */
+  for (i = 0; i < n; i++) {
+    gdouble u1 = g_rand_double_range (rand, 1e-12, 1.0);
+    gdouble u2 = g_rand_double (rand);
+    gdouble z = sqrt (-2.0 * log (u1)) * cos (2.0 * G_PI * u2);
+
+    samples[i] = (guint64) (30000.0 * exp (0.8 * z)) + 1;
+    samples[i] = MIN (samples[i], MAX_US);
+    latency_histogram_record (hist, samples[i]);
+  }
+  check_percentiles (hist, samples, n);
+
+  g_free (samples);
+  g_rand_free (rand);
+  latency_histogram_free (hist);
+}
+
+static void
+test_clamp_and_reset (void)
+{
+  LatencyHistogram *hist = latency_histogram_new (MAX_US, 2);
+  guint64 p100;
+
+  latency_histogram_record (hist, 10 * (guint64) MAX_US);
+  g_assert_cmpuint (latency_histogram_count (hist), ==, 1);
+  g_assert_cmpuint (latency_histogram_max (hist), ==, MAX_US);
+  p100 = latency_histogram_value_at_percentile (hist, 100);
+  g_assert_cmpuint (p100, ==, MAX_US);
+
+  latency_histogram_reset (hist);
+  g_assert_cmpuint (latency_histogram_count (hist), ==, 0);
+  g_assert_cmpuint (latency_histogram_max (hist), ==, 0);
+  g_assert_cmpuint (latency_histogram_value_at_percentile (hist, 50), ==, 0);
+  latency_histogram_free (hist);
+}
+
+static void
+test_invalid_range (void)
+{
+  g_assert_null (latency_histogram_new (1, 2));
+  g_assert_null (latency_histogram_new (MAX_US, 0));
+  g_assert_null (latency_histogram_new (MAX_US, 6));
+}
+
+static void
+bench_record (void)
+{
+  LatencyHistogram *hist = latency_histogram_new (MAX_US, 2);
+  guint n = 20000000;
+  guint64 v = 12345;
+  gdouble elapsed;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    latency_histogram_free (hist);
+    return;
+  }
+  g_test_timer_start ();
+  for (i = 0; i < n; i++) {
+    /* 1us ~ 1s 범위를 도는 xorshift */
+    v ^= v << 13;
+    v ^= v >> 7;
+    v ^= v << 17;
+    latency_histogram_record (hist, (v % G_USEC_PER_SEC) + 1);
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e9 / n, "record: %.2f ns/value",
+      elapsed * 1e9 / n);
+
+  g_test_timer_start ();
+  for (i = 0; i < 10000; i++)
+    latency_histogram_value_at_percentile (hist, 99.0);
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e6 / 10000, "p99 query: %.2f us",
+      elapsed * 1e6 / 10000);
+  latency_histogram_free (hist);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/latency-histogram/exact-small-values",
+      test_exact_small_values);
+  g_test_add_func ("/latency-histogram/uniform", test_uniform);
+  g_test_add_func ("/latency-histogram/lognormal", test_lognormal);
+  g_test_add_func ("/latency-histogram/clamp-and-reset", test_clamp_and_reset);
+  g_test_add_func ("/latency-histogram/invalid-range", test_invalid_range);
+  g_test_add_func ("/latency-histogram/bench/record", bench_record);
+
+  return g_test_run ();
+}
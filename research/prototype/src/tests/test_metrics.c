@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "prototype_metrics.h"
+#include "prototype_source_table.h"
+
+/* 렌더링 결과는 프로세스 전역이므로 테스트마다 다른 instance를 씁니다. */
+static gboolean
+has_line (const gchar * text, const gchar * line)
+{
+  gchar *needle = g_strdup_printf ("\n%s\n", line);
+  gboolean found = strstr (text, needle) != NULL;
+
+  g_free (needle);
+  return found;
+}
+
+static void
+test_instance_label (void)
+{
+  gchar *text = NULL;
+
+  /* 두 인스턴스가 같은 source_id를 써도 서로 덮어쓰지 않습니다. */
+  prototype_metrics_source_add (1, 3, PROTOTYPE_METRIC_SOURCE_EVENT_METAS, 5);
+  prototype_metrics_source_add (2, 3, PROTOTYPE_METRIC_SOURCE_EVENT_METAS, 7);
+  prototype_metrics_source_set_gauge (1, 3, PROTOTYPE_METRIC_SOURCE_FPS, 12.5);
+  prototype_metrics_source_set_gauge (2, 3, PROTOTYPE_METRIC_SOURCE_FPS, 30);
+
+  text = prototype_metrics_render ();
+  g_assert_true (has_line (text, "prototype_source_event_metas_total"
+          "{instance=\"1\",source_id=\"3\"} 5"));
+  g_assert_true (has_line (text, "prototype_source_event_metas_total"
+          "{instance=\"2\",source_id=\"3\"} 7"));
+  g_assert_true (has_line (text,
+          "prototype_source_fps{instance=\"1\",source_id=\"3\"} 12.500"));
+  g_assert_true (has_line (text,
+          "prototype_source_fps{instance=\"2\",source_id=\"3\"} 30.000"));
+  g_free (text);
+
+  /* 범위를 벗어난 instance는 무시됩니다. */
+  prototype_metrics_source_add (PROTOTYPE_METRICS_MAX_INSTANCES, 3,
+      PROTOTYPE_METRIC_SOURCE_EVENT_METAS, 1);
+  text = prototype_metrics_render ();
+  g_assert_null (strstr (text, "instance=\"128\""));
+  g_free (text);
+}
+
+static void
+test_instance_metrics (void)
+{
+  gchar *text = NULL;
+
+  /* 인스턴스마다 streammux/PGIE/표시 분기가 따로 있으므로 값도 따로 둡니다. */
+  prototype_metrics_instance_set (10, PROTOTYPE_METRIC_PGIE_INTERVAL, 2);
+  prototype_metrics_instance_set (11, PROTOTYPE_METRIC_PGIE_INTERVAL, 5);
+  prototype_metrics_instance_add (10, PROTOTYPE_METRIC_STREAMMUX_BATCHES, 3);
+  prototype_metrics_instance_add (10, PROTOTYPE_METRIC_STREAMMUX_BATCHES, 4);
+  prototype_metrics_instance_set_gauge (11,
+      PROTOTYPE_METRIC_STREAMMUX_BATCH_FILL, 0.875);
+  prototype_metrics_instance_set_gauge (11, PROTOTYPE_METRIC_DISPLAY_ACTIVE,
+      TRUE);
+  prototype_metrics_instance_set (PROTOTYPE_METRICS_MAX_INSTANCES,
+      PROTOTYPE_METRIC_PGIE_INTERVAL, 1);
+
+  text = prototype_metrics_render ();
+  g_assert_true (has_line (text, "# TYPE prototype_pgie_interval gauge"));
+  g_assert_true (has_line (text, "prototype_pgie_interval{instance=\"10\"} 2"));
+  g_assert_true (has_line (text, "prototype_pgie_interval{instance=\"11\"} 5"));
+  g_assert_true (has_line (text,
+          "prototype_streammux_batches_total{instance=\"10\"} 7"));
+  g_assert_true (has_line (text,
+          "prototype_streammux_batches_total{instance=\"11\"} 0"));
+  g_assert_true (has_line (text,
+          "prototype_streammux_batch_fill{instance=\"11\"} 0.875"));
+  g_assert_true (has_line (text,
+          "prototype_display_active{instance=\"11\"} 1.000"));
+  /* 기록하지 않은 인스턴스와 범위 밖 instance는 노출하지 않습니다. */
+  g_assert_null (strstr (text, "prototype_pgie_interval{instance=\"12\"}"));
+  g_assert_null (strstr (text, "instance=\"128\""));
+  g_free (text);
+}
+
+static void
+test_high_source_id (void)
+{
+  gchar *line = NULL;
+  gchar *text = NULL;
+
+  /* source-table이 받는 source_id는 모두 노출됩니다. */
+  prototype_metrics_source_add (3, 4095, PROTOTYPE_METRIC_SOURCE_FRAMES, 1);
+  prototype_metrics_source_add (3, PROTOTYPE_SOURCE_TABLE_MAX_ID - 1,
+      PROTOTYPE_METRIC_SOURCE_FRAMES, 2);
+  prototype_metrics_source_add (3, PROTOTYPE_SOURCE_TABLE_MAX_ID,
+      PROTOTYPE_METRIC_SOURCE_FRAMES, 3);
+
+  text = prototype_metrics_render ();
+  g_assert_true (has_line (text,
+          "prototype_source_frames_total{instance=\"3\",source_id=\"4095\"} 1"));
+  line = g_strdup_printf ("prototype_source_frames_total"
+      "{instance=\"3\",source_id=\"%u\"} 2", PROTOTYPE_SOURCE_TABLE_MAX_ID - 1);
+  g_assert_true (has_line (text, line));
+  g_free (line);
+  line = g_strdup_printf ("source_id=\"%u\"", PROTOTYPE_SOURCE_TABLE_MAX_ID);
+  g_assert_null (strstr (text, line));
+  g_free (line);
+  g_free (text);
+}
+
+static void
+test_remove (void)
+{
+  gchar *text = NULL;
+
+  prototype_metrics_source_add (4, 9, PROTOTYPE_METRIC_SOURCE_FRAMES_GATED, 4);
+  prototype_metrics_source_remove (4, 9);
+  text = prototype_metrics_render ();
+  g_assert_null (strstr (text, "instance=\"4\""));
+  g_free (text);
+
+  /* 다시 기록되면 0부터 집계합니다. */
+  prototype_metrics_source_add (4, 9, PROTOTYPE_METRIC_SOURCE_FRAMES_GATED, 1);
+  text = prototype_metrics_render ();
+  g_assert_true (has_line (text, "prototype_source_frames_gated_total"
+          "{instance=\"4\",source_id=\"9\"} 1"));
+  g_free (text);
+}
+
+static void
+test_frame_drops (void)
+{
+  gchar *text = NULL;
+
+  prototype_metrics_observe_frame (5, 0, 0);
+  prototype_metrics_observe_frame (5, 0, 1);
+  prototype_metrics_observe_frame (5, 0, 5);
+  /* 되감긴 frame_num은 드롭이 아닙니다. */
+  prototype_metrics_observe_frame (5, 0, 0);
+  prototype_metrics_observe_frame (5, 0, 1);
+
+  text = prototype_metrics_render ();
+  g_assert_true (has_line (text,
+          "prototype_source_frames_total{instance=\"5\",source_id=\"0\"} 5"));
+  g_assert_true (has_line (text, "prototype_source_frames_dropped_total"
+          "{instance=\"5\",source_id=\"0\"} 3"));
+  g_free (text);
+}
+
+#define RECORD_THREADS (8)
+#define RECORDS_PER_THREAD (200000)
+
+static gpointer
+record_thread (gpointer data)
+{
+  guint i;
+
+  /* 짝수 스레드는 같은 소스, 홀수 스레드는 각자 다른 소스에 기록합니다. */
+  for (i = 0; i < RECORDS_PER_THREAD; i++)
+    prototype_metrics_source_add (6, GPOINTER_TO_UINT (data) % 2 ?
+        GPOINTER_TO_UINT (data) : 0, PROTOTYPE_METRIC_SOURCE_FRAMES, 1);
+  return NULL;
+}
+
+static void
+test_concurrent_add (void)
+{
+  GThread *threads[RECORD_THREADS];
+  gchar *line = NULL;
+  gchar *text = NULL;
+  guint i;
+
+  for (i = 0; i < RECORD_THREADS; i++)
+    threads[i] = g_thread_new ("record", record_thread, GUINT_TO_POINTER (i));
+  for (i = 0; i < RECORD_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  /* 증가가 하나도 유실되지 않아야 합니다. */
+  text = prototype_metrics_render ();
+  line = g_strdup_printf ("prototype_source_frames_total"
+      "{instance=\"6\",source_id=\"0\"} %u",
+      RECORD_THREADS / 2 * RECORDS_PER_THREAD);
+  g_assert_true (has_line (text, line));
+  g_free (line);
+  for (i = 1; i < RECORD_THREADS; i += 2) {
+    line = g_strdup_printf ("prototype_source_frames_total"
+        "{instance=\"6\",source_id=\"%u\"} %u", i, RECORDS_PER_THREAD);
+    g_assert_true (has_line (text, line));
+    g_free (line);
+  }
+  g_free (text);
+}
+
+static void
+collect_cb (gpointer user_data)
+{
+  g_atomic_int_inc ((gint *) user_data);
+  prototype_metrics_source_set (7, 2, PROTOTYPE_METRIC_SOURCE_RTSP_RECONNECTS,
+      11);
+}
+
+/* 커널이 고른 빈 루프백 포트 */
+static guint
+pick_free_port (void)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  int fd = socket (AF_INET, SOCK_STREAM, 0);
+  guint port = 0;
+
+  g_assert_cmpint (fd, >=, 0);
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  g_assert_cmpint (bind (fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+  g_assert_cmpint (getsockname (fd, (struct sockaddr *) &addr, &len), ==, 0);
+  port = ntohs (addr.sin_port);
+  close (fd);
+  return port;
+}
+
+/* HTTP/1.0 GET 응답 전체(헤더 포함)를 반환합니다. */
+static gchar *
+http_get (guint port, const gchar * path)
+{
+  struct sockaddr_in addr;
+  GString *response = g_string_new (NULL);
+  gchar *request = NULL;
+  gchar buf[4096];
+  ssize_t n;
+  int fd = socket (AF_INET, SOCK_STREAM, 0);
+
+  g_assert_cmpint (fd, >=, 0);
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons (port);
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  g_assert_cmpint (connect (fd, (struct sockaddr *) &addr, sizeof (addr)), ==,
+      0);
+
+  request = g_strdup_printf ("GET %s HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n",
+      path);
+  g_assert_cmpint (write (fd, request, strlen (request)), ==, strlen (request));
+  g_free (request);
+  while ((n = read (fd, buf, sizeof (buf))) > 0)
+    g_string_append_len (response, buf, n);
+  close (fd);
+
+  return g_string_free (response, FALSE);
+}
+
+static void
+test_scrape (void)
+{
+  PrototypeMetricsConfig config = { TRUE, (gchar *) "127.0.0.1", 0 };
+  gint collects = 0;
+  gchar *response = NULL;
+
+  config.http_port = pick_free_port ();
+  prototype_metrics_source_add (7, 2, PROTOTYPE_METRIC_SOURCE_EVENT_METAS, 3);
+  prototype_metrics_add (PROTOTYPE_METRIC_MSGBROKER_PUBLISH_FAILURES, 1);
+  g_assert_true (prototype_metrics_start (&config, collect_cb, &collects));
+
+  response = http_get (config.http_port, "/metrics");
+  g_assert_true (g_str_has_prefix (response, "HTTP/1.1 200"));
+  g_assert_nonnull (strstr (response,
+          "Content-Type: text/plain; version=0.0.4"));
+  g_assert_true (has_line (response, "# TYPE prototype_source_fps gauge"));
+  g_assert_true (has_line (response, "prototype_source_event_metas_total"
+          "{instance=\"7\",source_id=\"2\"} 3"));
+  /* collect_func는 렌더링 전에 불립니다. */
+  g_assert_cmpint (g_atomic_int_get (&collects), ==, 1);
+  g_assert_true (has_line (response, "prototype_source_rtsp_reconnects_total"
+          "{instance=\"7\",source_id=\"2\"} 11"));
+  g_assert_true (has_line (response,
+          "prototype_msgbroker_publish_failures_total 1"));
+  g_free (response);
+
+  prototype_metrics_stop ();
+}
+
+static void
+bench_record (void)
+{
+  guint n = 20000000;
+  gdouble elapsed;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+  prototype_metrics_source_add (8, 0, PROTOTYPE_METRIC_SOURCE_FRAMES, 0);
+  g_test_timer_start ();
+  for (i = 0; i < n; i++)
+    prototype_metrics_source_add (8, i & 1023,
+        PROTOTYPE_METRIC_SOURCE_FRAMES, 1);
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e9 / n, "source_add: %.2f ns/call",
+      elapsed * 1e9 / n);
+
+  g_test_timer_start ();
+  for (i = 0; i < 100; i++)
+    g_free (prototype_metrics_render ());
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e3 / 100,
+      "render 1024 sources: %.3f ms", elapsed * 1e3 / 100);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/metrics/instance-label", test_instance_label);
+  g_test_add_func ("/metrics/instance-metrics", test_instance_metrics);
+  g_test_add_func ("/metrics/high-source-id", test_high_source_id);
+  g_test_add_func ("/metrics/remove", test_remove);
+  g_test_add_func ("/metrics/frame-drops", test_frame_drops);
+  g_test_add_func ("/metrics/concurrent-add", test_concurrent_add);
+  g_test_add_func ("/metrics/scrape", test_scrape);
+  g_test_add_func ("/metrics/bench/record", bench_record);
+
+  return g_test_run ();
+}
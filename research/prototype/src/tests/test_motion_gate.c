@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "prototype_motion_gate.h"
+
+#define WIDTH 64
+#define HEIGHT 36
+#define FPS 30
+#define FRAME_TS(k) ((GstClockTime) (k) * GST_SECOND / FPS)
+#define HOLD_MS 2000
+#define KEEPALIVE_MS 1000
+#define MOTION_THRESHOLD 0.002f
+#define OBJECT_SIZE 8
+
+/*
+ * 합성 장면: 고정 질감 배경에 프레임마다 잡음, 전체 밝기 offset,
+ * 그리고 선택적으로 밝은 사각형 객체 하나.
+ */
+typedef struct
+{
+  GRand *rand;
+  guint8 base[WIDTH * HEIGHT];
+  gdouble noise;
+  gdouble offset;
+  gboolean object;
+  gint object_x;
+  gint object_y;
+} Scene;
+
+static void
+scene_init (Scene * scene, gdouble noise)
+{
+  guint i;
+
+  memset (scene, 0, sizeof (Scene));
+  scene->rand = g_rand_new_with_seed (g_test_rand_int ());
+  scene->noise = noise;
+  /* 밝기를 60 올려도 포화되지 않는 범위 */
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    scene->base[i] = g_rand_int_range (scene->rand, 40, 180);
+}
+
+static void
+scene_clear (Scene * scene)
+{
+  g_rand_free (scene->rand);
+}
+
+static gdouble
+gaussian (GRand * rand)
+{
+  gdouble u = g_rand_double_range (rand, 1e-12, 1);
+
+  return sqrt (-2 * log (u)) * cos (2 * G_PI * g_rand_double (rand));
+}
+
+static void
+scene_render (Scene * scene, guint8 * luma, guint pitch)
+{
+  guint x, y;
+
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      gdouble v = scene->base[y * WIDTH + x] + scene->offset +
+          scene->noise * gaussian (scene->rand);
+
+      if (scene->object && (gint) x >= scene->object_x &&
+          (gint) x < scene->object_x + OBJECT_SIZE &&
+          (gint) y >= scene->object_y && (gint) y < scene->object_y +
+          OBJECT_SIZE)
+        v = 245;
+      luma[y * pitch + x] = (guint8) CLAMP (lrint (v), 0, 255);
+    }
+  }
+}
+
+static PrototypeMotionGate *
+new_gate (guint keepalive_ms)
+{
+  PrototypeMotionGateConfig config = {
+    .enable = TRUE,
+    .analysis_width = WIDTH,
+    .analysis_height = HEIGHT,
+    .pixel_threshold = 20,
+    .motion_threshold = MOTION_THRESHOLD,
+    .learn_shift = 5,
+    .hold_ms = HOLD_MS,
+    .keepalive_ms = keepalive_ms,
+  };
+
+  return prototype_motion_gate_new (&config, 0);
+}
+
+static gboolean
+step (PrototypeMotionGate * gate, Scene * scene, guint k)
+{
+  guint8 luma[WIDTH * HEIGHT];
+
+  scene_render (scene, luma, WIDTH);
+  return prototype_motion_gate_process_luma (gate, 0, luma, WIDTH,
+      FRAME_TS (k));
+}
+
+/* 처음 hold 동안과 이후 keepalive마다 한 프레임 */
+static guint
+expected_static_passes (guint frames)
+{
+  guint hold_frames = HOLD_MS * FPS / 1000;
+  guint keepalive_frames = KEEPALIVE_MS * FPS / 1000;
+
+  return hold_frames + (frames - hold_frames) / keepalive_frames;
+}
+
+/* 잡음이 있는 정적 장면에 20초 동안 밝기가 60 오르는 경우 */
+static void
+test_static_ramp (void)
+{
+  PrototypeMotionGate *gate = new_gate (KEEPALIVE_MS);
+  Scene scene;
+  const guint frames = 20 * FPS;
+  guint k, passed = 0;
+
+  scene_init (&scene, 4);
+  for (k = 0; k < frames; k++) {
+    scene.offset = 60.0 * k / frames;
+    if (step (gate, &scene, k))
+      passed++;
+    g_assert_cmpfloat (prototype_motion_gate_last_score (gate, 0), <,
+        MOTION_THRESHOLD);
+  }
+  g_assert_cmpuint (passed, ==, expected_static_passes (frames));
+  g_assert_true (prototype_motion_gate_is_static (gate, 0));
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+/* 노출이 한 번에 40 바뀌어도 움직임이 아닙니다. */
+static void
+test_exposure_jump (void)
+{
+  PrototypeMotionGate *gate = new_gate (KEEPALIVE_MS);
+  Scene scene;
+  const guint frames = 10 * FPS;
+  guint k, passed = 0;
+
+  scene_init (&scene, 4);
+  for (k = 0; k < frames; k++) {
+    scene.offset = k < 5 * FPS ? 0 : 40;
+    if (step (gate, &scene, k))
+      passed++;
+    g_assert_cmpfloat (prototype_motion_gate_last_score (gate, 0), <,
+        MOTION_THRESHOLD);
+  }
+  g_assert_cmpuint (passed, ==, expected_static_passes (frames));
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+/* 정적 장면에 객체가 들어와 움직이는 동안은 모든 프레임이 통과합니다. */
+static void
+test_moving_object (void)
+{
+  PrototypeMotionGate *gate = new_gate (KEEPALIVE_MS);
+  Scene scene;
+  guint k;
+
+  scene_init (&scene, 4);
+  for (k = 0; k < 5 * FPS; k++)
+    step (gate, &scene, k);
+  g_assert_true (prototype_motion_gate_is_static (gate, 0));
+
+  scene.object = TRUE;
+  scene.object_y = 14;
+  for (scene.object_x = -OBJECT_SIZE + 1; scene.object_x < WIDTH; k++) {
+    g_assert_true (step (gate, &scene, k));
+    g_assert_false (prototype_motion_gate_is_static (gate, 0));
+    scene.object_x++;
+  }
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+/*
+ * 객체가 멈추면 hold 동안은 계속 통과하고, 배경이 객체를 흡수한 뒤
+ * hold가 지나면 다시 버립니다.
+ */
+static void
+test_stopped_object (void)
+{
+  PrototypeMotionGate *gate = new_gate (KEEPALIVE_MS);
+  Scene scene;
+  guint k = 0, stop, gated_at = 0;
+
+  scene_init (&scene, 4);
+  scene.object = TRUE;
+  scene.object_y = 10;
+  for (scene.object_x = 0; scene.object_x < 40; scene.object_x++, k++)
+    step (gate, &scene, k);
+  scene.object_x--;
+  stop = k;
+
+  for (; k < stop + 10 * FPS; k++) {
+    gboolean pass = step (gate, &scene, k);
+
+    if (k < stop + HOLD_MS * FPS / 1000)
+      g_assert_true (pass);
+    if (!gated_at && prototype_motion_gate_is_static (gate, 0))
+      gated_at = k;
+  }
+  g_assert_cmpuint (gated_at, >, 0);
+  g_test_message ("gated %.2f s after the object stopped",
+      (gdouble) (gated_at - stop) / FPS);
+  /* 흡수(1/32씩, 약 2.4초) + hold 2초 */
+  g_assert_cmpuint (gated_at - stop, >=, HOLD_MS * FPS / 1000);
+  g_assert_cmpuint (gated_at - stop, <=, 6 * FPS);
+  g_assert_true (prototype_motion_gate_is_static (gate, 0));
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+static void
+test_no_keepalive (void)
+{
+  PrototypeMotionGate *gate = new_gate (0);
+  Scene scene;
+  guint k, passed = 0;
+
+  scene_init (&scene, 4);
+  for (k = 0; k < 10 * FPS; k++) {
+    if (step (gate, &scene, k))
+      passed++;
+  }
+  g_assert_cmpuint (passed, ==, HOLD_MS * FPS / 1000);
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+/* 행 간격에 패딩이 있어도 같은 판단 (패딩은 쓰레기 값) */
+static void
+test_pitch (void)
+{
+  const guint pitch = WIDTH + 32;
+  PrototypeMotionGate *tight = new_gate (KEEPALIVE_MS);
+  PrototypeMotionGate *padded = new_gate (KEEPALIVE_MS);
+  guint8 luma[WIDTH * HEIGHT];
+  guint8 *wide = g_new (guint8, pitch * HEIGHT);
+  Scene scene;
+  guint k, y;
+
+  scene_init (&scene, 4);
+  scene.object_y = 20;
+  for (k = 0; k < 12 * FPS; k++) {
+    scene.object = k >= 4 * FPS && k < 6 * FPS;
+    scene.object_x = (k / 2) % (WIDTH - OBJECT_SIZE);
+    scene_render (&scene, luma, WIDTH);
+    for (y = 0; y < HEIGHT; y++) {
+      memcpy (wide + y * pitch, luma + y * WIDTH, WIDTH);
+      memset (wide + y * pitch + WIDTH, k * 37 + y, pitch - WIDTH);
+    }
+    g_assert_cmpint (prototype_motion_gate_process_luma (tight, 0, luma,
+            WIDTH, FRAME_TS (k)), ==,
+        prototype_motion_gate_process_luma (padded, 0, wide, pitch,
+            FRAME_TS (k)));
+    g_assert_cmpfloat (prototype_motion_gate_last_score (tight, 0), ==,
+        prototype_motion_gate_last_score (padded, 0));
+  }
+
+  scene_clear (&scene);
+  g_free (wide);
+  prototype_motion_gate_free (padded);
+  prototype_motion_gate_free (tight);
+}
+
+/* 소스는 서로 독립이고, 제거 후 다시 추가되면 배경을 새로 학습합니다. */
+static void
+test_remove_source (void)
+{
+  PrototypeMotionGate *gate = new_gate (KEEPALIVE_MS);
+  guint8 luma[WIDTH * HEIGHT];
+  Scene scene;
+  guint k;
+
+  scene_init (&scene, 4);
+  for (k = 0; k < 5 * FPS; k++) {
+    scene_render (&scene, luma, WIDTH);
+    prototype_motion_gate_process_luma (gate, 0, luma, WIDTH, FRAME_TS (k));
+    prototype_motion_gate_process_luma (gate, 3, luma, WIDTH, FRAME_TS (k));
+  }
+  g_assert_true (prototype_motion_gate_is_static (gate, 0));
+  g_assert_true (prototype_motion_gate_is_static (gate, 3));
+  g_assert_false (prototype_motion_gate_is_static (gate, 1));
+
+  prototype_motion_gate_remove_source (gate, 3);
+  g_assert_false (prototype_motion_gate_is_static (gate, 3));
+  /* 완전히 다른 장면이어도 첫 프레임은 배경이 되고 통과합니다. */
+  memset (luma, 200, sizeof (luma));
+  g_assert_true (prototype_motion_gate_process_luma (gate, 3, luma, WIDTH,
+          FRAME_TS (k)));
+  g_assert_cmpfloat (prototype_motion_gate_last_score (gate, 3), ==, 0);
+  g_assert_false (prototype_motion_gate_is_static (gate, 3));
+  g_assert_true (prototype_motion_gate_is_static (gate, 0));
+
+  scene_clear (&scene);
+  prototype_motion_gate_free (gate);
+}
+
+/* analysis 크기별 프레임당 CPU 비용 */
+static void
+bench_process_luma (void)
+{
+  static const guint sizes[][2] = { {64, 36}, {128, 72}, {256, 144} };
+  GRand *rand = NULL;
+  guint s;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (42);
+  for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+    PrototypeMotionGateConfig config = {
+      .enable = TRUE,
+      .analysis_width = sizes[s][0],
+      .analysis_height = sizes[s][1],
+      .pixel_threshold = 20,
+      .motion_threshold = MOTION_THRESHOLD,
+      .learn_shift = 5,
+      .hold_ms = HOLD_MS,
+      .keepalive_ms = KEEPALIVE_MS,
+    };
+    PrototypeMotionGate *gate = prototype_motion_gate_new (&config, 0);
+    guint num_pixels = sizes[s][0] * sizes[s][1];
+    const guint num_frames = 16, iterations = 20000;
+    guint8 *frames = g_new (guint8, num_pixels * num_frames);
+    gdouble elapsed;
+    guint i;
+
+    for (i = 0; i < num_pixels * num_frames; i++)
+      frames[i] = g_rand_int_range (rand, 0, 256);
+
+    g_test_timer_start ();
+    for (i = 0; i < iterations; i++)
+      prototype_motion_gate_process_luma (gate, 0,
+          &frames[(i % num_frames) * num_pixels], sizes[s][0], FRAME_TS (i));
+    elapsed = g_test_timer_elapsed ();
+    g_test_minimized_result (elapsed * 1e6 / iterations,
+        "%ux%u: %.2f us/frame", sizes[s][0], sizes[s][1],
+        elapsed * 1e6 / iterations);
+
+    g_free (frames);
+    prototype_motion_gate_free (gate);
+  }
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/motion-gate/static-ramp", test_static_ramp);
+  g_test_add_func ("/motion-gate/exposure-jump", test_exposure_jump);
+  g_test_add_func ("/motion-gate/moving-object", test_moving_object);
+  g_test_add_func ("/motion-gate/stopped-object", test_stopped_object);
+  g_test_add_func ("/motion-gate/no-keepalive", test_no_keepalive);
+  g_test_add_func ("/motion-gate/pitch", test_pitch);
+  g_test_add_func ("/motion-gate/remove-source", test_remove_source);
+  g_test_add_func ("/motion-gate/bench/process-luma", bench_process_luma);
+
+  return g_test_run ();
+}
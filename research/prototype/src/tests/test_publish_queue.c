@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <dlfcn.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <string.h>
+
+#include "deepstream_common.h"
+#include "deepstream_publish_queue.h"
+#include "deepstream_sinks.h"
+#include "gstnvdsmeta.h"
+#include "nvdsmeta_schema.h"
+
+/* libslow_adaptor.so(slow_adaptor.c)를 프로토콜 어댑터로 씁니다. */
+#define ADAPTOR_LIB "libslow_adaptor.so"
+#define TOPIC "test"
+/* 발행 스레드가 따라잡기를 기다리는 최대 시간 */
+#define WAIT_TIMEOUT_US (5 * G_USEC_PER_SEC)
+
+/* 실시간 소스의 프레임률. 프레임마다 이벤트 하나를 붙입니다. */
+#define LIVE_FPS 100
+#define LIVE_RUN_US (3 * G_USEC_PER_SEC)
+
+GST_DEBUG_CATEGORY (NVDS_APP);
+
+static void *adaptor;
+static void (*adaptor_release) (void);
+static guint (*adaptor_num_sent) (void);
+static gchar *(*adaptor_dup_sent) (guint index);
+static guint (*adaptor_num_completed) (void);
+static guint (*adaptor_num_abandoned) (void);
+
+typedef struct
+{
+  gchar *dir;
+  gchar *cfg;
+  gchar *lib;
+} Fixture;
+
+static void
+fixture_set_up (Fixture * fixture, gconstpointer data)
+{
+  const gchar *cfg_text = (const gchar *) data;
+
+  fixture->dir = g_dir_make_tmp ("publish-queue-XXXXXX", NULL);
+  g_assert_nonnull (fixture->dir);
+  fixture->cfg = g_build_filename (fixture->dir, "cfg.txt", NULL);
+  g_assert_true (g_file_set_contents (fixture->cfg, cfg_text, -1, NULL));
+  fixture->lib = g_test_build_filename (G_TEST_BUILT, ADAPTOR_LIB, NULL);
+}
+
+static void
+fixture_tear_down (Fixture * fixture, gconstpointer data)
+{
+  g_unlink (fixture->cfg);
+  g_rmdir (fixture->dir);
+  g_free (fixture->cfg);
+  g_free (fixture->dir);
+  g_free (fixture->lib);
+}
+
+static NvDsPublishQueue *
+new_queue (Fixture * fixture, NvDsPublishQueuePolicy policy, guint size,
+    guint max_in_flight)
+{
+  static gint class_priorities[] = { 0, 5 };
+  NvDsPublishQueueConfig config = {
+    .size = size,
+    .policy = policy,
+    .class_priorities = class_priorities,
+    .num_class_priorities = G_N_ELEMENTS (class_priorities),
+    .max_in_flight = max_in_flight,
+  };
+  NvDsPublishQueue *queue = nvds_publish_queue_new (&config, fixture->lib,
+      "localhost;0", fixture->cfg, TOPIC);
+
+  g_assert_nonnull (queue);
+  return queue;
+}
+
+static void
+wait_sent (guint n)
+{
+  gint64 deadline_us = g_get_monotonic_time () + WAIT_TIMEOUT_US;
+
+  while (adaptor_num_sent () < n && g_get_monotonic_time () < deadline_us)
+    g_usleep (1000);
+  g_assert_cmpuint (adaptor_num_sent (), ==, n);
+}
+
+static void
+release_event_meta (gpointer data, gpointer user_data)
+{
+  NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
+
+  g_free (user_meta->user_meta_data);
+  user_meta->user_meta_data = NULL;
+}
+
+static void
+release_payload_meta (gpointer data, gpointer user_data)
+{
+  NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
+  NvDsPayload *payload = (NvDsPayload *) user_meta->user_meta_data;
+
+  g_free (payload->payload);
+  g_free (payload);
+  user_meta->user_meta_data = NULL;
+}
+
+static void
+add_user_meta (NvDsBatchMeta * batch_meta, NvDsFrameMeta * frame_meta,
+    NvDsMetaType type, gpointer data, NvDsMetaReleaseFunc release_func)
+{
+  NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool (batch_meta);
+
+  user_meta->user_meta_data = data;
+  user_meta->base_meta.batch_meta = batch_meta;
+  user_meta->base_meta.meta_type = type;
+  user_meta->base_meta.release_func = release_func;
+  nvds_add_user_meta_to_frame (frame_meta, user_meta);
+}
+
+/*
+ * @buf에 프레임 하나짜리 배치 메타를 붙입니다. 이벤트 메타는 @classes의 클래스로,
+ * payload 메타는 @payloads 문자열로 nvmsgconv처럼 같은 순서로 붙입니다.
+ */
+static void
+add_batch_meta (GstBuffer * buf, const gint * classes, guint num_events,
+    const gchar ** payloads, guint num_payloads)
+{
+  NvDsBatchMeta *batch_meta = nvds_create_batch_meta (1);
+  NvDsMeta *meta = gst_buffer_add_nvds_meta (buf, batch_meta, NULL,
+      nvds_batch_meta_copy_func, nvds_batch_meta_release_func);
+  NvDsFrameMeta *frame_meta = nvds_acquire_frame_meta_from_pool (batch_meta);
+  guint i;
+
+  meta->meta_type = NVDS_BATCH_GST_META;
+  nvds_add_frame_meta_to_batch (batch_meta, frame_meta);
+
+  for (i = 0; i < num_events; i++) {
+    NvDsEventMsgMeta *msg_meta = g_new0 (NvDsEventMsgMeta, 1);
+
+    msg_meta->objClassId = classes[i];
+    add_user_meta (batch_meta, frame_meta, NVDS_EVENT_MSG_META, msg_meta,
+        release_event_meta);
+  }
+  for (i = 0; i < num_payloads; i++) {
+    NvDsPayload *payload = g_new0 (NvDsPayload, 1);
+
+    payload->payload = g_strdup (payloads[i]);
+    payload->payloadSize = strlen (payloads[i]);
+    add_user_meta (batch_meta, frame_meta, NVDS_PAYLOAD_META, payload,
+        release_payload_meta);
+  }
+}
+
+static GstBuffer *
+new_buffer (const gint * classes, guint num_events, const gchar ** payloads,
+    guint num_payloads)
+{
+  GstBuffer *buf = gst_buffer_new ();
+
+  add_batch_meta (buf, classes, num_events, payloads, num_payloads);
+  return buf;
+}
+
+static void
+push_one (NvDsPublishQueue * queue, gint class_id, const gchar * payload)
+{
+  GstBuffer *buf = new_buffer (&class_id, 1, &payload, 1);
+
+  nvds_publish_queue_push_buffer (queue, buf, 0);
+  gst_buffer_unref (buf);
+}
+
+static void
+assert_sent (guint index, const gchar * expected)
+{
+  gchar *payload = adaptor_dup_sent (index);
+
+  g_assert_cmpstr (payload, ==, expected);
+  g_free (payload);
+}
+
+static void
+test_priority_per_payload (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueue *queue = new_queue (fixture,
+      NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY, 2, 1);
+  const gint classes[] = { 1, 0 };
+  const gchar *payloads[] = { "high-1", "low" };
+  GstBuffer *buf = NULL;
+
+  /* 첫 이벤트가 멈춘 어댑터에 걸려 있는 동안 나머지는 큐에 쌓입니다. */
+  push_one (queue, 0, "first");
+  wait_sent (1);
+
+  /*
+   * 한 프레임에 클래스 1(우선순위 5)과 0(우선순위 0) 이벤트가 함께 있어도
+   * 각 payload는 자기 이벤트의 우선순위를 받아 "low"만 버려져야 합니다.
+   */
+  buf = new_buffer (classes, 2, payloads, 2);
+  nvds_publish_queue_push_buffer (queue, buf, 0);
+  gst_buffer_unref (buf);
+  push_one (queue, 1, "high-2");
+
+  adaptor_release ();
+  wait_sent (3);
+  assert_sent (0, "first");
+  assert_sent (1, "high-1");
+  assert_sent (2, "high-2");
+
+  nvds_publish_queue_free (queue);
+}
+
+static void
+test_priority_unpaired (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueue *queue = new_queue (fixture,
+      NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY, 1, 1);
+  const gint classes[] = { 0, 1 };
+  const gchar *payloads[] = { "frame" };
+  GstBuffer *buf = NULL;
+
+  push_one (queue, 0, "first");
+  wait_sent (1);
+
+  /* payload와 이벤트 수가 맞지 않으면 프레임에서 가장 높은 우선순위를 씁니다. */
+  buf = new_buffer (classes, 2, payloads, 1);
+  nvds_publish_queue_push_buffer (queue, buf, 0);
+  gst_buffer_unref (buf);
+  push_one (queue, 0, "low");
+
+  adaptor_release ();
+  wait_sent (2);
+  assert_sent (1, "frame");
+
+  nvds_publish_queue_free (queue);
+}
+
+static void
+test_drain_on_free (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueue *queue = new_queue (fixture, NVDS_PUBLISH_QUEUE_BLOCK,
+      16, 8);
+  guint i;
+
+  for (i = 0; i < 5; i++)
+    push_one (queue, 0, "event");
+  wait_sent (5);
+
+  /* 어댑터는 disconnect에서 콜백 없이 버리므로 free가 완료를 기다려야 합니다. */
+  nvds_publish_queue_free (queue);
+  g_assert_cmpuint (adaptor_num_completed (), ==, 5);
+  g_assert_cmpuint (adaptor_num_abandoned (), ==, 0);
+}
+
+static void
+test_drain_timeout (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueue *queue = new_queue (fixture, NVDS_PUBLISH_QUEUE_BLOCK,
+      16, 1);
+  gint64 start_us;
+
+  push_one (queue, 0, "event");
+  wait_sent (1);
+
+  /* 완료되지 않는 이벤트가 있어도 free는 제한 시간 안에 돌아옵니다. */
+  start_us = g_get_monotonic_time ();
+  nvds_publish_queue_free (queue);
+  g_assert_cmpint (g_get_monotonic_time () - start_us, <, 3 * G_USEC_PER_SEC);
+  g_assert_cmpuint (adaptor_num_completed (), ==, 0);
+  g_assert_cmpuint (adaptor_num_abandoned (), ==, 1);
+}
+
+static GstPadProbeReturn
+publish_queue_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  NvDsPublishQueue *queue = (NvDsPublishQueue *) u_data;
+
+  nvds_publish_queue_push_buffer (queue, GST_PAD_PROBE_INFO_BUFFER (info), 0);
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * deepstream_sink_bin.c의 create_publish_queue_sink처럼 fakesink 싱크 패드의
+ * probe에서 발행 큐에 넣습니다. @num_buffers를 밀어 넣고 EOS까지 걸린 시간을 돌려주며
+ * @timeout_ns 안에 EOS가 오지 않으면 -1을 돌려줍니다.
+ */
+static gint64
+run_pipeline (NvDsPublishQueue * queue, guint num_buffers, GstClockTime
+    timeout_ns, GstElement ** pipeline_out)
+{
+  GstElement *pipeline = gst_parse_launch ("appsrc name=src format=time "
+      "! fakesink name=sink sync=false async=false", NULL);
+  GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  GstPad *pad = gst_element_get_static_pad (sink, "sink");
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg = NULL;
+  GstFlowReturn flow;
+  gint64 start_us = g_get_monotonic_time ();
+  guint i;
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, publish_queue_probe,
+      queue, NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  for (i = 0; i < num_buffers; i++) {
+    gint class_id = i % 2;
+    const gchar *payload = "event";
+    GstBuffer *buf = new_buffer (&class_id, 1, &payload, 1);
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &flow);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &flow);
+
+  msg = gst_bus_timed_pop_filtered (bus, timeout_ns,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  g_assert_true (!msg || GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+  gst_object_unref (src);
+  gst_object_unref (bus);
+  *pipeline_out = pipeline;
+  if (!msg)
+    return -1;
+  gst_message_unref (msg);
+  return g_get_monotonic_time () - start_us;
+}
+
+static void
+stop_pipeline (GstElement * pipeline)
+{
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/* 실시간 소스에서 붙인 이벤트와 sink bin 출력에서 센 버퍼 */
+typedef struct
+{
+  GMutex lock;
+  guint in_buffers;
+  guint in_high;
+  guint in_low;
+  guint out_buffers;
+} LiveCounts;
+
+/* 네 프레임마다 한 번 우선순위 높은 클래스 1, 나머지는 클래스 0 이벤트를 붙입니다. */
+static GstPadProbeReturn
+live_source_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  LiveCounts *counts = (LiveCounts *) u_data;
+  GstBuffer *buf = gst_buffer_make_writable (GST_PAD_PROBE_INFO_BUFFER (info));
+  gint class_id;
+  const gchar *payload;
+
+  g_mutex_lock (&counts->lock);
+  class_id = counts->in_buffers++ % 4 == 0;
+  if (class_id)
+    counts->in_high++;
+  else
+    counts->in_low++;
+  g_mutex_unlock (&counts->lock);
+
+  payload = class_id ? "high" : "low";
+  add_batch_meta (buf, &class_id, 1, &payload, 1);
+  GST_PAD_PROBE_INFO_DATA (info) = buf;
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+live_sink_probe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
+{
+  LiveCounts *counts = (LiveCounts *) u_data;
+
+  g_mutex_lock (&counts->lock);
+  counts->out_buffers++;
+  g_mutex_unlock (&counts->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+topic_stats_cb (const NvDsPublishQueueTopicStats * stats, gpointer user_data)
+{
+  if (!g_strcmp0 (stats->topic, TOPIC))
+    *(NvDsPublishQueueTopicStats *) user_data = *stats;
+}
+
+/*
+ * is-live 소스(LIVE_FPS)를 앱과 같이 tee 뒤의 msgconv/broker sink bin
+ * (create_sink_bin()의 publish queue sink)에 물리고 LIVE_RUN_US 동안 돌립니다.
+ * 어댑터는 latency-ms마다 하나만 완료하므로 발행 속도는 입력보다 낮습니다.
+ */
+static void
+run_live_pipeline (Fixture * fixture, NvDsPublishQueuePolicy policy,
+    LiveCounts * counts, NvDsPublishQueueTopicStats * stats, guint * sent_high)
+{
+  static gint class_priorities[] = { 0, 5 };
+  NvDsSinkSubBinConfig config;
+  NvDsSinkMsgConvBrokerConfig *broker = &config.msg_conv_broker_config;
+  NvDsSinkBin sink_bin;
+  NvDsSinkBinSubBin *sub_bin = &sink_bin.sub_bins[0];
+  GstElement *pipeline = NULL;
+  GstElement *src = NULL;
+  GstElement *tee = NULL;
+  GstPad *pad = NULL;
+  guint i;
+
+  memset (&config, 0, sizeof (config));
+  memset (&sink_bin, 0, sizeof (sink_bin));
+  config.enable = TRUE;
+  config.type = NV_DS_SINK_MSG_CONV_BROKER;
+  broker->enable = TRUE;
+  /* 이벤트와 payload 메타는 소스 probe가 nvmsgconv 대신 붙입니다. */
+  broker->disable_msgconv = TRUE;
+  broker->proto_lib = fixture->lib;
+  broker->conn_str = (gchar *) "localhost;0";
+  broker->topic = (gchar *) TOPIC;
+  broker->broker_config_file_path = fixture->cfg;
+  broker->publish_queue.size = 8;
+  broker->publish_queue.policy = policy;
+  broker->publish_queue.class_priorities = class_priorities;
+  broker->publish_queue.num_class_priorities =
+      G_N_ELEMENTS (class_priorities);
+  broker->publish_queue.max_in_flight = 1;
+  g_assert_true (create_sink_bin (1, &config, &sink_bin, 0));
+
+  pipeline = gst_parse_launch ("videotestsrc name=src is-live=true "
+      "! video/x-raw,width=16,height=16,framerate=100/1 ! tee name=tee",
+      NULL);
+  g_assert_nonnull (pipeline);
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  tee = gst_bin_get_by_name (GST_BIN (pipeline), "tee");
+  gst_bin_add (GST_BIN (pipeline), sub_bin->bin);
+  g_assert_true (gst_element_link (tee, sub_bin->bin));
+
+  memset (counts, 0, sizeof (LiveCounts));
+  g_mutex_init (&counts->lock);
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, live_source_probe,
+      counts, NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (sub_bin->sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, live_sink_probe, counts,
+      NULL);
+  gst_object_unref (pad);
+
+  g_assert_cmpint (gst_element_set_state (pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+  g_usleep (LIVE_RUN_US);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* 발행 큐는 sink와 함께 해제되므로 파이프라인을 놓기 전에 셉니다. */
+  memset (stats, 0, sizeof (NvDsPublishQueueTopicStats));
+  nvds_publish_queue_foreach_stats (topic_stats_cb, stats);
+  *sent_high = 0;
+  for (i = 0; i < adaptor_num_sent (); i++) {
+    gchar *payload = adaptor_dup_sent (i);
+
+    *sent_high += !g_strcmp0 (payload, "high");
+    g_free (payload);
+  }
+
+  gst_object_unref (tee);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+  gst_object_unref (gst_object_ref_sink (sink_bin.bin));
+  g_mutex_clear (&counts->lock);
+}
+
+static void
+test_pipeline_drop (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueuePolicy policy;
+  const gdouble elapsed = LIVE_RUN_US / (gdouble) G_USEC_PER_SEC;
+  const guint capacity = 8 + 1;
+
+  for (policy = NVDS_PUBLISH_QUEUE_DROP_OLDEST;
+      policy <= NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY; policy++) {
+    NvDsPublishQueueTopicStats stats;
+    LiveCounts counts;
+    guint sent_high;
+
+    run_live_pipeline (fixture, policy, &counts, &stats, &sent_high);
+    g_test_message ("policy %d: in %u (high %u), out %u, enqueued %"
+        G_GUINT64_FORMAT ", sent %" G_GUINT64_FORMAT ", dropped %"
+        G_GUINT64_FORMAT ", depth %" G_GUINT64_FORMAT ", high handed %u",
+        policy, counts.in_buffers, counts.in_high, counts.out_buffers,
+        stats.enqueued, stats.sent, stats.dropped, stats.depth, sent_high);
+
+    /* 어댑터가 느려도 파이프라인은 입력 속도로 흐릅니다. */
+    g_assert_cmpfloat (counts.in_buffers / elapsed, >=, LIVE_FPS * 0.9);
+    g_assert_cmpfloat (counts.in_buffers / elapsed, <=, LIVE_FPS * 1.1);
+    g_assert_cmpuint (counts.out_buffers + counts.in_buffers / 20, >=,
+        counts.in_buffers);
+
+    /* 들어온 이벤트는 발행, 실패, 버림, 대기 중 하나로 모두 셉니다. */
+    g_assert_cmpuint (stats.sent + stats.failed + stats.dropped + stats.depth,
+        ==, counts.out_buffers);
+    g_assert_cmpuint (stats.failed, ==, 0);
+    g_assert_cmpuint (stats.dropped, >, 0);
+    g_assert_cmpuint (stats.depth, <=, capacity);
+
+    if (policy == NVDS_PUBLISH_QUEUE_DROP_LOWEST_PRIORITY) {
+      /* 낮은 우선순위가 먼저 버려지므로 높은 우선순위는 대기 중인 것만 남습니다. */
+      g_assert_cmpuint (stats.dropped, <=, counts.in_low);
+      g_assert_cmpuint (sent_high + capacity + counts.in_buffers -
+          counts.out_buffers, >=, counts.in_high);
+    } else {
+      /* drop-oldest는 클래스와 무관하게 버리므로 높은 우선순위도 잃습니다. */
+      g_assert_cmpuint (sent_high, <, counts.in_high * 3 / 4);
+    }
+  }
+}
+
+static void
+test_pipeline_block (Fixture * fixture, gconstpointer data)
+{
+  NvDsPublishQueue *queue = new_queue (fixture, NVDS_PUBLISH_QUEUE_BLOCK, 4, 1);
+  GstElement *pipeline = NULL;
+  GstBus *bus = NULL;
+  GstMessage *msg = NULL;
+
+  /* block 정책은 어댑터가 멈추면 스트리밍 스레드를 세워 배압을 겁니다. */
+  g_assert_cmpint (run_pipeline (queue, 20, 500 * GST_MSECOND, &pipeline), ==,
+      -1);
+  g_assert_cmpuint (adaptor_num_sent (), ==, 1);
+
+  /* 어댑터가 풀리면 남은 버퍼가 모두 발행되고 EOS에 닿습니다. */
+  adaptor_release ();
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND, GST_MESSAGE_EOS);
+  g_assert_nonnull (msg);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  wait_sent (20);
+
+  stop_pipeline (pipeline);
+  nvds_publish_queue_free (queue);
+}
+
+static const gchar *CFG_STUCK = "[message-broker]\nstuck=1\n";
+static const gchar *CFG_SLOW = "[message-broker]\nlatency-ms=200\n";
+static const gchar *CFG_RATE = "[message-broker]\nlatency-ms=20\n";
+
+#define ADD_TEST(path, cfg, func) \
+  g_test_add (path, Fixture, cfg, fixture_set_up, func, fixture_tear_down)
+
+int
+main (int argc, char **argv)
+{
+  gchar *lib = NULL;
+
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (NVDS_APP, "NVDS_APP", 0, NULL);
+
+  /* 발행 큐가 free에서 dlclose해도 어댑터 상태가 남도록 테스트가 핸들을 잡아둡니다. */
+  lib = g_test_build_filename (G_TEST_BUILT, ADAPTOR_LIB, NULL);
+  adaptor = dlopen (lib, RTLD_NOW);
+  g_free (lib);
+  g_assert_nonnull (adaptor);
+  adaptor_release = dlsym (adaptor, "slow_adaptor_release");
+  adaptor_num_sent = dlsym (adaptor, "slow_adaptor_num_sent");
+  adaptor_dup_sent = dlsym (adaptor, "slow_adaptor_dup_sent");
+  adaptor_num_completed = dlsym (adaptor, "slow_adaptor_num_completed");
+  adaptor_num_abandoned = dlsym (adaptor, "slow_adaptor_num_abandoned");
+
+  ADD_TEST ("/publish-queue/priority/per-payload", CFG_STUCK,
+      test_priority_per_payload);
+  ADD_TEST ("/publish-queue/priority/unpaired", CFG_STUCK,
+      test_priority_unpaired);
+  ADD_TEST ("/publish-queue/free/drain", CFG_SLOW, test_drain_on_free);
+  ADD_TEST ("/publish-queue/free/timeout", CFG_STUCK, test_drain_timeout);
+  ADD_TEST ("/publish-queue/pipeline/drop", CFG_RATE, test_pipeline_drop);
+  ADD_TEST ("/publish-queue/pipeline/block", CFG_STUCK, test_pipeline_block);
+
+  return g_test_run ();
+}
@@ -0,0 +1,519 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "prototype_reid_gallery.h"
+
+#define DIM 128
+
+static const gchar *quant_names[] = { "fp32", "fp16", "int8" };
+
+static PrototypeReidGallery *
+new_gallery (PrototypeReidQuantization quantization, guint num_shards,
+    guint max_entries, guint ttl_sec)
+{
+  PrototypeReidGalleryConfig config = {
+    .enable = TRUE,
+    .quantization = quantization,
+    .num_shards = num_shards,
+    .max_entries_per_shard = max_entries,
+    .ttl_sec = ttl_sec,
+    .top_k = 5,
+    .match_threshold = 0.75f,
+    .query_after = 1000,
+    .ema_alpha = 0.1f,
+  };
+
+  return prototype_reid_gallery_new (&config);
+}
+
+static gdouble
+gaussian (GRand * rand)
+{
+  gdouble u = g_rand_double_range (rand, 1e-12, 1);
+  gdouble v = g_rand_double (rand);
+
+  return sqrt (-2 * log (u)) * cos (2 * G_PI * v);
+}
+
+static void
+normalize (gfloat * v, guint dim)
+{
+  gdouble norm = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    norm += (gdouble) v[i] * v[i];
+  norm = sqrt (norm);
+  for (i = 0; i < dim; i++)
+    v[i] /= norm;
+}
+
+static void
+random_unit (GRand * rand, gfloat * v, guint dim)
+{
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    v[i] = gaussian (rand);
+  normalize (v, dim);
+}
+
+/* 정체성 벡터에 노름이 noise인 잡음을 더한 관측 */
+static void
+noisy (GRand * rand, const gfloat * identity, gfloat noise, gfloat * v,
+    guint dim)
+{
+  guint i;
+
+  random_unit (rand, v, dim);
+  for (i = 0; i < dim; i++)
+    v[i] = identity[i] + noise * v[i];
+  normalize (v, dim);
+}
+
+static gdouble
+dot (const gfloat * a, const gfloat * b, guint dim)
+{
+  gdouble sum = 0;
+  guint i;
+
+  for (i = 0; i < dim; i++)
+    sum += (gdouble) a[i] * b[i];
+  return sum;
+}
+
+/* 양자화 후 다시 읽은 값의 원소별 오차 */
+static void
+test_quantization_error (gconstpointer data)
+{
+  PrototypeReidQuantization quantization = GPOINTER_TO_UINT (data);
+  PrototypeReidGallery *gallery = new_gallery (quantization, 2, 256, 0);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat v[DIM], decoded[DIM];
+  guint n, i;
+
+  for (n = 0; n < 200; n++) {
+    gfloat max = 0;
+
+    random_unit (rand, v, DIM);
+    /* 일부 원소는 fp16 비정규 범위로 */
+    if (n % 4 == 0) {
+      for (i = 0; i < DIM; i += 3)
+        v[i] *= 1e-4f;
+      normalize (v, DIM);
+    }
+    prototype_reid_gallery_observe (gallery, n % 3, n, v, DIM, 0, NULL, NULL);
+    g_assert_true (prototype_reid_gallery_lookup (gallery, n % 3, n, decoded,
+            DIM));
+
+    for (i = 0; i < DIM; i++)
+      max = MAX (max, fabsf (v[i]));
+    for (i = 0; i < DIM; i++) {
+      gfloat err = fabsf (decoded[i] - v[i]);
+
+      switch (quantization) {
+        case PROTOTYPE_REID_QUANT_FP32:
+          /* 라이브러리가 float로 다시 정규화한 차이만 */
+          g_assert_cmpfloat (err, <=, 1e-6f);
+          break;
+        case PROTOTYPE_REID_QUANT_FP16:
+          /* 반올림 오차 2^-11 상대, 비정규 범위는 2^-25 절대 */
+          g_assert_cmpfloat (err, <=, MAX (fabsf (v[i]) / 2048, 3e-8f) +
+              1e-6f);
+          break;
+        case PROTOTYPE_REID_QUANT_INT8:
+          /* 대칭 스케일 max/127의 절반 */
+          g_assert_cmpfloat (err, <=, max / 254 + 1e-6f);
+          break;
+      }
+    }
+    g_assert_cmpfloat (dot (v, decoded, DIM) / sqrt (dot (decoded, decoded,
+                DIM)), >=, quantization == PROTOTYPE_REID_QUANT_INT8 ? 0.999 :
+        0.99999);
+  }
+
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+/* 전체 비교: 잡음 섞인 질의의 top-1이 정답이고, 점수가 참조 내적과 맞는지 */
+static void
+test_exhaustive_recall (gconstpointer data)
+{
+  PrototypeReidQuantization quantization = GPOINTER_TO_UINT (data);
+  const guint num_ids = 2000, num_queries = 200;
+  PrototypeReidGallery *gallery = new_gallery (quantization, 4, 1024, 0);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat *ids = g_new (gfloat, num_ids * DIM);
+  gfloat query[DIM];
+  PrototypeReidMatch matches[5];
+  gfloat tolerance = quantization == PROTOTYPE_REID_QUANT_INT8 ? 0.02f :
+      quantization == PROTOTYPE_REID_QUANT_FP16 ? 1e-3f : 1e-5f;
+  guint n, i, hits = 0;
+
+  for (n = 0; n < num_ids; n++) {
+    random_unit (rand, &ids[n * DIM], DIM);
+    prototype_reid_gallery_observe (gallery, n % 4, n, &ids[n * DIM], DIM, 0,
+        NULL, NULL);
+  }
+  g_assert_cmpuint (prototype_reid_gallery_size (gallery), ==, num_ids);
+
+  for (n = 0; n < num_queries; n++) {
+    guint target = g_rand_int_range (rand, 0, num_ids);
+    guint num;
+
+    noisy (rand, &ids[target * DIM], 0.5f, query, DIM);
+    num = prototype_reid_gallery_search (gallery, query, DIM, 0, -1, matches,
+        5);
+    g_assert_cmpuint (num, ==, 5);
+    if (matches[0].object_id == target)
+      hits++;
+    for (i = 0; i < num; i++) {
+      g_assert_cmpuint (matches[i].source_id, ==, matches[i].object_id % 4);
+      g_assert_cmpfloat_with_epsilon (matches[i].score, dot (query,
+              &ids[matches[i].object_id * DIM], DIM), tolerance);
+      if (i)
+        g_assert_cmpfloat (matches[i - 1].score, >=, matches[i].score);
+    }
+
+    /* 정답의 소스를 빼면 정답은 나오지 않습니다. */
+    num = prototype_reid_gallery_search (gallery, query, DIM, 0, target % 4,
+        matches, 5);
+    for (i = 0; i < num; i++)
+      g_assert_cmpuint (matches[i].source_id, !=, target % 4);
+  }
+  g_assert_cmpuint (hits, ==, num_queries);
+
+  g_free (ids);
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+static void
+test_ivf_recall (void)
+{
+  const guint num_ids = 4096, num_queries = 200;
+  PrototypeReidGalleryConfig config = {
+    .enable = TRUE,
+    .quantization = PROTOTYPE_REID_QUANT_FP16,
+    .num_shards = 1,
+    .max_entries_per_shard = num_ids,
+    .top_k = 5,
+    .query_after = 1000,
+    .ivf_lists = 32,
+    .ivf_min_entries = 1024,
+    .ivf_probes = 8,
+  };
+  PrototypeReidGallery *gallery = prototype_reid_gallery_new (&config);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat *ids = g_new (gfloat, num_ids * DIM);
+  gfloat query[DIM];
+  PrototypeReidMatch matches[5];
+  guint n, hits = 0;
+
+  for (n = 0; n < num_ids; n++) {
+    random_unit (rand, &ids[n * DIM], DIM);
+    prototype_reid_gallery_observe (gallery, 0, n, &ids[n * DIM], DIM, 0,
+        NULL, NULL);
+  }
+  for (n = 0; n < num_queries; n++) {
+    guint target = g_rand_int_range (rand, 0, num_ids);
+
+    noisy (rand, &ids[target * DIM], 0.5f, query, DIM);
+    g_assert_cmpuint (prototype_reid_gallery_search (gallery, query, DIM, 0,
+            -1, matches, 5), >=, 1);
+    if (matches[0].object_id == target)
+      hits++;
+  }
+  /* 군집 없는 무작위 벡터라 IVF에 불리한 분포입니다. */
+  g_test_message ("IVF recall@1 %.3f", (gdouble) hits / num_queries);
+  g_assert_cmpuint (hits, >=, num_queries * 3 / 4);
+
+  g_free (ids);
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+/* 가득 찬 샤드는 가장 오래 갱신되지 않은 항목을 내보냅니다. */
+static void
+test_eviction (void)
+{
+  PrototypeReidGallery *gallery = new_gallery (PROTOTYPE_REID_QUANT_FP32, 1,
+      8, 0);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat ids[12][DIM], v[DIM];
+  guint n;
+
+  for (n = 0; n < 12; n++)
+    random_unit (rand, ids[n], DIM);
+
+  for (n = 0; n < 10; n++)
+    prototype_reid_gallery_observe (gallery, 0, n, ids[n], DIM,
+        n * GST_SECOND, NULL, NULL);
+  g_assert_cmpuint (prototype_reid_gallery_size (gallery), ==, 8);
+  g_assert_false (prototype_reid_gallery_lookup (gallery, 0, 0, v, DIM));
+  g_assert_false (prototype_reid_gallery_lookup (gallery, 0, 1, v, DIM));
+
+  /* 트랙 2를 갱신하면 다음으로 오래된 3이 빠집니다. */
+  prototype_reid_gallery_observe (gallery, 0, 2, ids[2], DIM,
+      10 * GST_SECOND, NULL, NULL);
+  prototype_reid_gallery_observe (gallery, 0, 10, ids[10], DIM,
+      11 * GST_SECOND, NULL, NULL);
+  g_assert_true (prototype_reid_gallery_lookup (gallery, 0, 2, v, DIM));
+  g_assert_false (prototype_reid_gallery_lookup (gallery, 0, 3, v, DIM));
+
+  /* swap-remove 뒤에도 남은 항목은 자기 벡터를 가리킵니다. */
+  for (n = 2; n <= 10; n++) {
+    if (n == 3)
+      continue;
+    g_assert_true (prototype_reid_gallery_lookup (gallery, 0, n, v, DIM));
+    g_assert_cmpfloat (dot (v, ids[n], DIM), >, 0.9999);
+  }
+
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+static void
+test_ttl (void)
+{
+  PrototypeReidGallery *gallery = new_gallery (PROTOTYPE_REID_QUANT_INT8, 1,
+      4, 10);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat ids[5][DIM];
+  PrototypeReidMatch matches[5];
+  guint n;
+
+  for (n = 0; n < 5; n++)
+    random_unit (rand, ids[n], DIM);
+  for (n = 0; n < 4; n++)
+    prototype_reid_gallery_observe (gallery, 0, n, ids[n], DIM, 0, NULL,
+        NULL);
+
+  g_assert_cmpuint (prototype_reid_gallery_search (gallery, ids[0], DIM,
+          10 * GST_SECOND, -1, matches, 5), ==, 4);
+  /* TTL이 지난 항목은 질의에서 빠지지만 정리는 샤드가 찼을 때 합니다. */
+  g_assert_cmpuint (prototype_reid_gallery_search (gallery, ids[0], DIM,
+          11 * GST_SECOND, -1, matches, 5), ==, 0);
+  g_assert_cmpuint (prototype_reid_gallery_size (gallery), ==, 4);
+
+  prototype_reid_gallery_observe (gallery, 0, 4, ids[4], DIM,
+      11 * GST_SECOND, NULL, NULL);
+  g_assert_cmpuint (prototype_reid_gallery_size (gallery), ==, 1);
+  g_assert_cmpuint (prototype_reid_gallery_search (gallery, ids[4], DIM,
+          11 * GST_SECOND, -1, matches, 5), ==, 1);
+  g_assert_cmpuint (matches[0].object_id, ==, 4);
+
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+typedef struct
+{
+  guint num_events;
+  PrototypeReidLinkEvent last;
+  PrototypeReidMatch first_match;
+} LinkLog;
+
+static void
+on_link (const PrototypeReidLinkEvent * event, gpointer user_data)
+{
+  LinkLog *log = (LinkLog *) user_data;
+
+  log->num_events++;
+  log->last = *event;
+  log->first_match = event->matches[0];
+}
+
+/* query-after번째 관측에서 한 번만, 다른 카메라의 같은 객체로 link */
+static void
+test_link (void)
+{
+  PrototypeReidGalleryConfig config = {
+    .enable = TRUE,
+    .quantization = PROTOTYPE_REID_QUANT_FP16,
+    .num_shards = 2,
+    .max_entries_per_shard = 64,
+    .top_k = 3,
+    .match_threshold = 0.75f,
+    .query_after = 3,
+    .ema_alpha = 0.3f,
+  };
+  PrototypeReidGallery *gallery = prototype_reid_gallery_new (&config);
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  gfloat ids[20][DIM], v[DIM];
+  LinkLog log = { 0 };
+  guint n;
+
+  for (n = 0; n < 20; n++) {
+    random_unit (rand, ids[n], DIM);
+    prototype_reid_gallery_observe (gallery, 0, n, ids[n], DIM, 0, on_link,
+        &log);
+  }
+  g_assert_cmpuint (log.num_events, ==, 0);
+
+  /* 카메라 1의 트랙 100은 카메라 0의 트랙 7 */
+  for (n = 0; n < 6; n++) {
+    noisy (rand, ids[7], 0.3f, v, DIM);
+    prototype_reid_gallery_observe (gallery, 1, 100, v, DIM,
+        (n + 1) * GST_SECOND, on_link, &log);
+    g_assert_cmpuint (log.num_events, ==, n >= 2 ? 1 : 0);
+  }
+  g_assert_cmpuint (log.last.source_id, ==, 1);
+  g_assert_cmpuint (log.last.object_id, ==, 100);
+  g_assert_cmpuint (log.last.ts, ==, 3 * GST_SECOND);
+  g_assert_cmpuint (log.first_match.source_id, ==, 0);
+  g_assert_cmpuint (log.first_match.object_id, ==, 7);
+  g_assert_cmpfloat (log.first_match.score, >=, 0.75f);
+
+  /* 닮은 객체가 없으면 이벤트가 없습니다. */
+  random_unit (rand, v, DIM);
+  for (n = 0; n < 3; n++)
+    prototype_reid_gallery_observe (gallery, 1, 101, v, DIM, 0, on_link,
+        &log);
+  g_assert_cmpuint (log.num_events, ==, 1);
+
+  g_rand_free (rand);
+  prototype_reid_gallery_free (gallery);
+}
+
+static void
+test_dim_mismatch (void)
+{
+  PrototypeReidGallery *gallery = new_gallery (PROTOTYPE_REID_QUANT_FP32, 1,
+      16, 0);
+  gfloat v[DIM] = { 1 };
+  PrototypeReidMatch matches[1];
+
+  prototype_reid_gallery_observe (gallery, 0, 1, v, DIM, 0, NULL, NULL);
+  prototype_reid_gallery_observe (gallery, 0, 2, v, DIM / 2, 0, NULL, NULL);
+  g_assert_cmpuint (prototype_reid_gallery_size (gallery), ==, 1);
+  g_assert_cmpuint (prototype_reid_gallery_search (gallery, v, DIM / 2, 0, -1,
+          matches, 1), ==, 0);
+  g_assert_false (prototype_reid_gallery_lookup (gallery, 0, 1, v, DIM / 2));
+
+  prototype_reid_gallery_free (gallery);
+}
+
+/* 차원 256, 2만 개 정체성, 샤드 4개에서 recall@1과 질의 지연 */
+static void
+bench_search (void)
+{
+  const guint dim = 256, num_ids = 20000, num_queries = 200;
+  GRand *rand = NULL;
+  gfloat *ids = NULL, *queries = NULL;
+  guint *targets = NULL;
+  guint quantization, ivf, n;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (42);
+  ids = g_new (gfloat, (gsize) num_ids * dim);
+  queries = g_new (gfloat, (gsize) num_queries * dim);
+  targets = g_new (guint, num_queries);
+  for (n = 0; n < num_ids; n++)
+    random_unit (rand, &ids[(gsize) n * dim], dim);
+  for (n = 0; n < num_queries; n++) {
+    targets[n] = g_rand_int_range (rand, 0, num_ids);
+    noisy (rand, &ids[(gsize) targets[n] * dim], 0.5f,
+        &queries[(gsize) n * dim], dim);
+  }
+
+  for (quantization = 0; quantization < 3; quantization++) {
+    for (ivf = 0; ivf < 2; ivf++) {
+      PrototypeReidGalleryConfig config = {
+        .enable = TRUE,
+        .quantization = quantization,
+        .num_shards = 4,
+        .max_entries_per_shard = 8192,
+        .top_k = 5,
+        .query_after = 1000,
+        .ivf_lists = ivf ? 64 : 0,
+        .ivf_min_entries = 2048,
+        .ivf_probes = 8,
+      };
+      PrototypeReidGallery *gallery = prototype_reid_gallery_new (&config);
+      PrototypeReidMatch matches[5];
+      guint hits = 0;
+      gdouble elapsed;
+
+      for (n = 0; n < num_ids; n++)
+        prototype_reid_gallery_observe (gallery, n % 8, n,
+            &ids[(gsize) n * dim], dim, 0, NULL, NULL);
+
+      g_test_timer_start ();
+      for (n = 0; n < num_queries; n++) {
+        prototype_reid_gallery_search (gallery, &queries[(gsize) n * dim],
+            dim, 0, -1, matches, 5);
+        if (matches[0].object_id == targets[n])
+          hits++;
+      }
+      elapsed = g_test_timer_elapsed ();
+      g_test_minimized_result (elapsed * 1e3 / num_queries,
+          "%s %s: %.3f ms/query, recall@1 %.3f", quant_names[quantization],
+          ivf ? "ivf 64/8" : "exhaustive", elapsed * 1e3 / num_queries,
+          (gdouble) hits / num_queries);
+
+      prototype_reid_gallery_free (gallery);
+    }
+  }
+
+  g_free (targets);
+  g_free (queries);
+  g_free (ids);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (quant_names); i++) {
+    gchar *path = g_strdup_printf ("/reid-gallery/%s/quantization-error",
+        quant_names[i]);
+
+    g_test_add_data_func (path, GUINT_TO_POINTER (i),
+        test_quantization_error);
+    g_free (path);
+    path = g_strdup_printf ("/reid-gallery/%s/exhaustive-recall",
+        quant_names[i]);
+    g_test_add_data_func (path, GUINT_TO_POINTER (i), test_exhaustive_recall);
+    g_free (path);
+  }
+  g_test_add_func ("/reid-gallery/ivf-recall", test_ivf_recall);
+  g_test_add_func ("/reid-gallery/eviction", test_eviction);
+  g_test_add_func ("/reid-gallery/ttl", test_ttl);
+  g_test_add_func ("/reid-gallery/link", test_link);
+  g_test_add_func ("/reid-gallery/dim-mismatch", test_dim_mismatch);
+  g_test_add_func ("/reid-gallery/bench/search", bench_search);
+
+  return g_test_run ();
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "prototype_shard_planner.h"
+
+static void
+check_plan_shards (const PrototypeShardPlan * plan)
+{
+  guint *counts = g_new0 (guint, plan->num_shards);
+  guint i;
+
+  for (i = 0; i < plan->num_items; i++) {
+    g_assert_cmpuint (plan->assignment[i], <, plan->num_shards);
+    counts[plan->assignment[i]]++;
+  }
+  for (i = 0; i < plan->num_shards; i++)
+    g_assert_cmpuint (counts[i], >, 0);
+  g_free (counts);
+}
+
+/* group이 2개뿐인데 shard가 3개면 하나는 비게 됩니다. */
+static void
+test_drop_empty (void)
+{
+  PrototypeShardItem items[] = {
+    {"rtsp://cam0", "lobby", 1.0},
+    {"rtsp://cam1", "lobby", 1.0},
+    {"rtsp://cam2", "gate", 1.0},
+    {"rtsp://cam3", "gate", 1.0},
+  };
+  PrototypeShardPlan *plan = prototype_shard_plan (items, G_N_ELEMENTS (items),
+      3, 0.05, NULL);
+
+  g_assert_nonnull (plan);
+  g_assert_cmpuint (prototype_shard_plan_drop_empty (plan), ==, 1);
+  g_assert_cmpuint (plan->num_shards, ==, 2);
+  check_plan_shards (plan);
+  g_assert_cmpuint (plan->assignment[0], ==, plan->assignment[1]);
+  g_assert_cmpuint (plan->assignment[2], ==, plan->assignment[3]);
+  g_assert_cmpuint (plan->assignment[0], !=, plan->assignment[2]);
+  g_assert_cmpfloat (plan->loads[0], ==, 2.0);
+  g_assert_cmpfloat (plan->loads[1], ==, 2.0);
+  prototype_shard_plan_free (plan);
+}
+
+static void
+test_drop_none (void)
+{
+  PrototypeShardItem items[] = {
+    {"rtsp://cam0", NULL, 1.0},
+    {"rtsp://cam1", NULL, 2.0},
+    {"rtsp://cam2", NULL, 3.0},
+  };
+  PrototypeShardPlan *plan = prototype_shard_plan (items, G_N_ELEMENTS (items),
+      3, 0.05, NULL);
+
+  g_assert_cmpuint (prototype_shard_plan_drop_empty (plan), ==, 0);
+  g_assert_cmpuint (plan->num_shards, ==, 3);
+  check_plan_shards (plan);
+  prototype_shard_plan_free (plan);
+}
+
+/* 복사본은 원본과 문자열을 공유하지 않아야 각각 해제할 수 있습니다. */
+static void
+test_shard_info_copy (void)
+{
+  PrototypeSourceShardInfo src = { 1920, 1080, 30.0, NULL, NULL, NULL };
+  PrototypeSourceShardInfo dst;
+
+  src.codec = g_strdup ("h265");
+  src.group = g_strdup ("lobby");
+  prototype_source_shard_info_copy (&dst, &src);
+  g_assert_true (dst.codec != src.codec);
+  g_assert_true (dst.group != src.group);
+  g_assert_null (dst.priority);
+
+  prototype_source_shard_info_clear (&src);
+  g_assert_null (src.codec);
+  g_assert_cmpstr (dst.codec, ==, "h265");
+  g_assert_cmpstr (dst.group, ==, "lobby");
+  g_assert_cmpuint (dst.width, ==, 1920);
+  prototype_source_shard_info_clear (&dst);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/shard-planner/drop-empty", test_drop_empty);
+  g_test_add_func ("/shard-planner/drop-none", test_drop_none);
+  g_test_add_func ("/shard-planner/shard-info-copy", test_shard_info_copy);
+
+  return g_test_run ();
+}
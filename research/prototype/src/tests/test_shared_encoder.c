@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "deepstream_common.h"
+#include "deepstream_sinks.h"
+
+GST_DEBUG_CATEGORY (NVDS_APP);
+
+#define NUM_FRAMES 120
+#define IFRAME_INTERVAL 10
+
+/* live 소스라 출력 가지가 인코더보다 늦어질 일이 없습니다. */
+#define SOURCE_LAUNCH "videotestsrc is-live=true num-buffers=%u ! " \
+    "video/x-raw,width=320,height=240,framerate=60/1 ! nvvideoconvert ! " \
+    "video/x-raw(memory:NVMM),format=NV12"
+
+/* 가지별로 큐를 빠져나간 인코딩 프레임의 PTS */
+typedef struct
+{
+  GMutex lock;
+  GArray *pts;
+} BranchRecord;
+
+typedef struct
+{
+  GstElement *pipeline;
+  NvDsSinkBin sink_bin;
+  NvDsSinkSubBinConfig configs[3];
+  gchar *dir;
+  gchar *files[2];
+
+  GstElement *encoder;
+  /* 인코더 출력 전부: PTS와 keyframe 여부 */
+  GMutex encoded_lock;
+  GArray *encoded_pts;
+  GArray *encoded_key;
+
+  /* tee 뒤 출력 가지의 큐, [2]가 UDP 가지 */
+  GstElement *queues[3];
+  BranchRecord branches[3];
+} TestPipeline;
+
+static GstPadProbeReturn
+encoded_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  TestPipeline *tp = (TestPipeline *) data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+  gboolean key = !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  g_mutex_lock (&tp->encoded_lock);
+  g_array_append_val (tp->encoded_pts, pts);
+  g_array_append_val (tp->encoded_key, key);
+  g_mutex_unlock (&tp->encoded_lock);
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+branch_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  BranchRecord *record = (BranchRecord *) data;
+  GstClockTime pts = GST_BUFFER_PTS (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  g_mutex_lock (&record->lock);
+  g_array_append_val (record->pts, pts);
+  g_mutex_unlock (&record->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+/* element의 pad_name pad에 연결된 요소. ghost pad 너머면 NULL입니다. */
+static GstElement *
+peer_element (GstElement * element, const gchar * pad_name)
+{
+  GstPad *pad = gst_element_get_static_pad (element, pad_name);
+  GstPad *peer = pad ? gst_pad_get_peer (pad) : NULL;
+  GstElement *parent = peer ? gst_pad_get_parent_element (peer) : NULL;
+
+  /* 요소는 파이프라인이 붙잡고 있으므로 참조 없이 돌려줍니다. */
+  if (parent)
+    gst_object_unref (parent);
+  if (peer)
+    gst_object_unref (peer);
+  if (pad)
+    gst_object_unref (pad);
+  return parent;
+}
+
+static const gchar *
+factory_name (GstElement * element)
+{
+  return GST_OBJECT_NAME (gst_element_get_factory (element));
+}
+
+/* sink bin 안에서 factory가 name인 요소 수. first에 첫 요소를 돌려줍니다. */
+static guint
+count_elements (GstBin * bin, const gchar * name, GstElement ** first)
+{
+  GstIterator *it = gst_bin_iterate_recurse (bin);
+  GValue item = G_VALUE_INIT;
+  guint n = 0;
+
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = g_value_get_object (&item);
+
+    if (!g_strcmp0 (factory_name (element), name)) {
+      if (first && !n)
+        *first = element;
+      n++;
+    }
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+  return n;
+}
+
+/* 인코더 tee에 붙은 큐를 찾아 file, file, UDP 순으로 둡니다. */
+static void
+find_branch_queues (TestPipeline * tp)
+{
+  GstIterator *it = gst_bin_iterate_recurse (GST_BIN (tp->sink_bin.bin));
+  GValue item = G_VALUE_INIT;
+  guint num_files = 0;
+
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *queue = g_value_get_object (&item);
+    GstElement *tee, *consumer;
+
+    g_value_reset (&item);
+    if (g_strcmp0 (factory_name (queue), "queue"))
+      continue;
+    tee = peer_element (queue, "sink");
+    if (!tee || !g_str_has_prefix (GST_ELEMENT_NAME (tee),
+            "sink_sub_bin_enc_tee"))
+      continue;
+    /* queue -> parser -> rtppay | mux */
+    consumer = peer_element (peer_element (queue, "src"), "src");
+    if (g_str_has_prefix (factory_name (consumer), "rtph26")) {
+      tp->queues[2] = queue;
+    } else {
+      g_assert_cmpuint (num_files, <, 2);
+      tp->queues[num_files++] = queue;
+    }
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+  g_assert_cmpuint (num_files, ==, 2);
+  g_assert_nonnull (tp->queues[2]);
+}
+
+/* 설정이 같은 x264 sink 셋: mkv 파일, mp4 파일, UDP/RTSP */
+static void
+pipeline_init (TestPipeline * tp, guint rtsp_port, guint udp_port)
+{
+  GError *error = NULL;
+  GstElement *source = NULL;
+  gchar *launch = NULL;
+  GstPad *pad = NULL;
+  guint i;
+
+  memset (tp, 0, sizeof (TestPipeline));
+  tp->dir = g_dir_make_tmp ("test_shared_encoder_XXXXXX", &error);
+  g_assert_no_error (error);
+  tp->files[0] = g_build_filename (tp->dir, "out.mkv", NULL);
+  tp->files[1] = g_build_filename (tp->dir, "out.mp4", NULL);
+
+  for (i = 0; i < 3; i++) {
+    NvDsSinkSubBinConfig *config = &tp->configs[i];
+    NvDsSinkEncoderConfig *enc = &config->encoder_config;
+
+    config->enable = TRUE;
+    config->type = i < 2 ? NV_DS_SINK_ENCODE_FILE : NV_DS_SINK_UDPSINK;
+    config->sync = 0;
+    enc->type = config->type;
+    enc->codec = NV_DS_ENCODER_H264;
+    enc->enc_type = NV_DS_ENCODER_TYPE_SW;
+    enc->bitrate = 1000000;
+    enc->iframeinterval = IFRAME_INTERVAL;
+    enc->sw_preset = 1;
+    if (i < 2) {
+      enc->container = i == 0 ? NV_DS_CONTAINER_MKV : NV_DS_CONTAINER_MP4;
+      enc->output_file_path = tp->files[i];
+    } else {
+      enc->rtsp_port = rtsp_port;
+      enc->udp_port = udp_port;
+    }
+  }
+  g_assert_true (create_sink_bin (3, tp->configs, &tp->sink_bin, 0));
+
+  launch = g_strdup_printf (SOURCE_LAUNCH, NUM_FRAMES);
+  source = gst_parse_bin_from_description (launch, TRUE, &error);
+  g_assert_no_error (error);
+  g_free (launch);
+
+  tp->pipeline = gst_pipeline_new ("test-pipeline");
+  gst_bin_add_many (GST_BIN (tp->pipeline), source, tp->sink_bin.bin, NULL);
+  g_assert_true (gst_element_link (source, tp->sink_bin.bin));
+
+  g_mutex_init (&tp->encoded_lock);
+  tp->encoded_pts = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  tp->encoded_key = g_array_new (FALSE, FALSE, sizeof (gboolean));
+  g_assert_cmpuint (count_elements (GST_BIN (tp->sink_bin.bin), "x264enc",
+          &tp->encoder), ==, 1);
+  pad = gst_element_get_static_pad (tp->encoder, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, encoded_probe, tp, NULL);
+  gst_object_unref (pad);
+
+  find_branch_queues (tp);
+  for (i = 0; i < 3; i++) {
+    g_mutex_init (&tp->branches[i].lock);
+    tp->branches[i].pts = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+    pad = gst_element_get_static_pad (tp->queues[i], "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, branch_probe,
+        &tp->branches[i], NULL);
+    gst_object_unref (pad);
+  }
+}
+
+static guint
+branch_count (TestPipeline * tp, guint i)
+{
+  guint n;
+
+  g_mutex_lock (&tp->branches[i].lock);
+  n = tp->branches[i].pts->len;
+  g_mutex_unlock (&tp->branches[i].lock);
+  return n;
+}
+
+static void
+pipeline_run_to_eos (TestPipeline * tp)
+{
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (tp->pipeline));
+  GstMessage *msg = gst_bus_timed_pop_filtered (bus, 30 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  g_assert_nonnull (msg);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *error = NULL;
+
+    gst_message_parse_error (msg, &error, NULL);
+    g_assert_no_error (error);
+  }
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+}
+
+static void
+pipeline_clear (TestPipeline * tp)
+{
+  guint i;
+
+  gst_element_set_state (tp->pipeline, GST_STATE_NULL);
+  gst_object_unref (tp->pipeline);
+  destroy_sink_bin ();
+  for (i = 0; i < 3; i++) {
+    g_array_unref (tp->branches[i].pts);
+    g_mutex_clear (&tp->branches[i].lock);
+  }
+  g_array_unref (tp->encoded_pts);
+  g_array_unref (tp->encoded_key);
+  g_mutex_clear (&tp->encoded_lock);
+  for (i = 0; i < 2; i++) {
+    g_unlink (tp->files[i]);
+    g_free (tp->files[i]);
+  }
+  g_rmdir (tp->dir);
+  g_free (tp->dir);
+}
+
+/* x264 인코더 하나가 프레임마다 한 번 인코딩하고, 세 출력이 모두 받습니다. */
+static void
+test_one_encode (void)
+{
+  TestPipeline tp;
+  GStatBuf st;
+  guint i;
+
+  pipeline_init (&tp, 18554, 15400);
+  g_assert_cmpint (gst_element_set_state (tp.pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+  pipeline_run_to_eos (&tp);
+
+  g_assert_cmpuint (tp.encoded_pts->len, ==, NUM_FRAMES);
+  for (i = 0; i < 3; i++)
+    g_assert_cmpuint (branch_count (&tp, i), ==, NUM_FRAMES);
+  for (i = 0; i < 2; i++) {
+    g_assert_cmpint (g_stat (tp.files[i], &st), ==, 0);
+    g_assert_cmpint (st.st_size, >, 0);
+  }
+
+  pipeline_clear (&tp);
+}
+
+static GstPadProbeReturn
+block_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * UDP 가지를 막아 두면 file 가지와 인코더는 멈추지 않습니다. 풀린 뒤 UDP
+ * 가지는 keyframe부터 다시 받고, 빠진 구간 뒤의 첫 프레임은 늘 keyframe입니다.
+ */
+static void
+test_stalled_consumer (void)
+{
+  TestPipeline tp;
+  GstPad *pad = NULL;
+  gulong block_id;
+  gint64 deadline;
+  guint i, j, n, gaps = 0;
+
+  pipeline_init (&tp, 18555, 15401);
+  /* queue -> parser 다음에서 막으면 큐가 차고 게이트가 버리기 시작합니다. */
+  pad = gst_element_get_static_pad (peer_element (tp.queues[2], "src"), "src");
+  block_id = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BLOCK |
+      GST_PAD_PROBE_TYPE_BUFFER, block_probe, NULL, NULL);
+  g_assert_cmpint (gst_element_set_state (tp.pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+
+  deadline = g_get_monotonic_time () + 20 * G_USEC_PER_SEC;
+  while (branch_count (&tp, 0) < NUM_FRAMES / 2 &&
+      g_get_monotonic_time () < deadline)
+    g_usleep (10 * 1000);
+  g_assert_cmpuint (branch_count (&tp, 0), >=, NUM_FRAMES / 2);
+  g_assert_cmpuint (branch_count (&tp, 2), <, NUM_FRAMES / 2);
+  gst_pad_remove_probe (pad, block_id);
+  gst_object_unref (pad);
+  pipeline_run_to_eos (&tp);
+
+  g_assert_cmpuint (tp.encoded_pts->len, ==, NUM_FRAMES);
+  for (i = 0; i < 2; i++)
+    g_assert_cmpuint (branch_count (&tp, i), ==, NUM_FRAMES);
+
+  /* UDP 가지의 PTS는 인코더 출력의 부분열이고, 건너뛴 뒤엔 keyframe입니다. */
+  n = branch_count (&tp, 2);
+  g_assert_cmpuint (n, <, NUM_FRAMES);
+  g_assert_cmpuint (n, >, NUM_FRAMES / 2);
+  for (i = 0, j = 0; i < n; i++, j++) {
+    GstClockTime pts = g_array_index (tp.branches[2].pts, GstClockTime, i);
+    guint skipped = j;
+
+    while (j < tp.encoded_pts->len &&
+        g_array_index (tp.encoded_pts, GstClockTime, j) != pts)
+      j++;
+    g_assert_cmpuint (j, <, tp.encoded_pts->len);
+    if (j != skipped) {
+      gaps++;
+      g_assert_true (g_array_index (tp.encoded_key, gboolean, j));
+    }
+  }
+  g_test_message ("UDP branch: %u of %u frames, %u gaps", n, NUM_FRAMES,
+      gaps);
+  g_assert_cmpuint (gaps, >=, 1);
+
+  pipeline_clear (&tp);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (NVDS_APP, "NVDS_APP", 0, NULL);
+
+  g_test_add_func ("/shared-encoder/one-encode", test_one_encode);
+  g_test_add_func ("/shared-encoder/stalled-consumer", test_stalled_consumer);
+
+  return g_test_run ();
+}
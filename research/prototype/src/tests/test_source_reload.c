@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <gst/rtsp/gstrtsptransport.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include "deepstream_sources.h"
+#include "prototype_source_reload.h"
+
+GST_DEBUG_CATEGORY (NVDS_APP);
+GST_DEBUG_CATEGORY (APP_CFG_PARSER_CAT);
+
+#define MAX_SOURCES 8
+#define WIDTH 320
+#define HEIGHT 240
+#define FPS 30
+
+/* 앞의 둘은 그대로 두고 뒤의 둘을 번갈아 지웠다 다시 붙입니다. */
+#define NUM_KEPT 2
+#define NUM_CHURNED 2
+#define NUM_CYCLES 10
+#define FIRST_BUFFER_TIMEOUT_MS 5000
+
+#define LIVE_LAUNCH "( videotestsrc is-live=true ! video/x-raw,width=320," \
+    "height=240,framerate=30/1 ! x264enc tune=zerolatency " \
+    "speed-preset=ultrafast key-int-max=15 ! rtph264pay name=pay0 pt=96 )"
+
+static void
+assert_ids (GArray * ids, const guint * expected, guint num_expected)
+{
+  guint i;
+
+  g_assert_cmpuint (ids->len, ==, num_expected);
+  for (i = 0; i < num_expected; i++)
+    g_assert_cmpuint (g_array_index (ids, guint, i), ==, expected[i]);
+}
+
+/*
+ * current/next는 (센서 ID, URI) 쌍입니다. current의 URI가 NULL이면 빈
+ * 슬롯입니다.
+ */
+typedef struct
+{
+  guint sensor_id;
+  const gchar *uri;
+} SourceEntry;
+
+static void
+check_diff (const SourceEntry * current, guint num_current,
+    const SourceEntry * next, guint num_next, const guint * removed,
+    guint num_removed, const guint * added, guint num_added)
+{
+  gchar **current_keys = g_new0 (gchar *, num_current + 1);
+  gchar **next_keys = g_new0 (gchar *, num_next + 1);
+  GArray *removed_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+  GArray *added_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+  guint i;
+
+  for (i = 0; i < num_current; i++) {
+    if (current[i].uri)
+      current_keys[i] = prototype_source_key (current[i].sensor_id,
+          current[i].uri);
+  }
+  for (i = 0; i < num_next; i++)
+    next_keys[i] = prototype_source_key (next[i].sensor_id, next[i].uri);
+
+  prototype_source_diff (current_keys, num_current, next_keys, num_next,
+      removed_ids, added_ids);
+  assert_ids (removed_ids, removed, num_removed);
+  assert_ids (added_ids, added, num_added);
+
+  for (i = 0; i < num_current; i++)
+    g_free (current_keys[i]);
+  g_free (current_keys);
+  g_strfreev (next_keys);
+  g_array_free (removed_ids, TRUE);
+  g_array_free (added_ids, TRUE);
+}
+
+/* 순서만 바뀐 목록은 아무것도 건드리지 않습니다. */
+static void
+test_diff_unchanged (void)
+{
+  const SourceEntry current[] = {
+    {0, "rtsp://a"}, {1, "rtsp://b"}, {2, "rtsp://c"}
+  };
+  const SourceEntry next[] = {
+    {2, "rtsp://c"}, {0, "rtsp://a"}, {1, "rtsp://b"}
+  };
+
+  check_diff (current, 3, next, 3, NULL, 0, NULL, 0);
+}
+
+static void
+test_diff_add (void)
+{
+  const SourceEntry current[] = { {0, "rtsp://a"}, {1, "rtsp://b"} };
+  const SourceEntry next[] = {
+    {0, "rtsp://a"}, {5, "rtsp://e"}, {1, "rtsp://b"}, {6, "rtsp://f"}
+  };
+  const guint added[] = { 1, 3 };
+
+  check_diff (current, 2, next, 4, NULL, 0, added, 2);
+}
+
+/* 제거된 소스 자리가 빈 슬롯으로 남아 있어도 source_id가 그대로입니다. */
+static void
+test_diff_remove (void)
+{
+  const SourceEntry current[] = {
+    {0, "rtsp://a"}, {1, NULL}, {2, "rtsp://c"}, {3, "rtsp://d"}
+  };
+  const SourceEntry next[] = { {3, "rtsp://d"} };
+  const guint removed[] = { 0, 2 };
+
+  check_diff (current, 4, next, 1, removed, 2, NULL, 0);
+}
+
+/* 센서 ID가 같아도 URI가 바뀌면 지우고 다시 붙입니다. */
+static void
+test_diff_uri_change (void)
+{
+  const SourceEntry current[] = { {0, "rtsp://a"}, {1, "rtsp://b"} };
+  const SourceEntry next[] = { {0, "rtsp://a"}, {1, "rtsp://b2"} };
+  const guint removed[] = { 1 };
+  const guint added[] = { 1 };
+
+  check_diff (current, 2, next, 2, removed, 1, added, 1);
+}
+
+/* URI가 같아도 센서 ID가 바뀌면 다른 소스입니다. */
+static void
+test_diff_sensor_id_change (void)
+{
+  const SourceEntry current[] = { {0, "rtsp://a"}, {1, "rtsp://b"} };
+  const SourceEntry next[] = { {7, "rtsp://a"}, {1, "rtsp://b"} };
+  const guint removed[] = { 0 };
+  const guint added[] = { 0 };
+
+  check_diff (current, 2, next, 2, removed, 1, added, 1);
+}
+
+/* 같은 키는 개수만큼 짝을 짓고 남는 쪽만 추가/제거합니다. */
+static void
+test_diff_duplicates (void)
+{
+  const SourceEntry current[] = {
+    {0, "rtsp://a"}, {0, "rtsp://a"}, {0, "rtsp://a"}, {1, "rtsp://b"}
+  };
+  const SourceEntry next[] = {
+    {1, "rtsp://b"}, {0, "rtsp://a"}, {1, "rtsp://b"}
+  };
+  const guint removed[] = { 1, 2 };
+  const guint added[] = { 2 };
+
+  check_diff (current, 4, next, 3, removed, 2, added, 1);
+}
+
+/* 루프백 RTSP 서버. 모든 소스가 같은 videotestsrc 미디어를 공유합니다. */
+typedef struct
+{
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GstRTSPServer *server;
+  guint port;
+} TestServer;
+
+static gpointer
+server_thread_func (gpointer data)
+{
+  TestServer *server = (TestServer *) data;
+
+  g_main_context_push_thread_default (server->context);
+  g_main_loop_run (server->loop);
+  g_main_context_pop_thread_default (server->context);
+  return NULL;
+}
+
+static void
+server_start (TestServer * server)
+{
+  GstRTSPMountPoints *mounts = NULL;
+  GstRTSPMediaFactory *factory = NULL;
+
+  memset (server, 0, sizeof (TestServer));
+  server->context = g_main_context_new ();
+  server->loop = g_main_loop_new (server->context, FALSE);
+
+  server->server = gst_rtsp_server_new ();
+  g_object_set (server->server, "address", "127.0.0.1", "service", "0", NULL);
+  mounts = gst_rtsp_server_get_mount_points (server->server);
+  factory = gst_rtsp_media_factory_new ();
+  gst_rtsp_media_factory_set_launch (factory, LIVE_LAUNCH);
+  gst_rtsp_media_factory_set_shared (factory, TRUE);
+  gst_rtsp_mount_points_add_factory (mounts, "/live", factory);
+  g_object_unref (mounts);
+  g_assert_cmpuint (gst_rtsp_server_attach (server->server, server->context),
+      >, 0);
+  server->port = gst_rtsp_server_get_bound_port (server->server);
+
+  server->thread = g_thread_new ("test-rtsp-server", server_thread_func,
+      server);
+}
+
+static void
+server_stop (TestServer * server)
+{
+  g_main_loop_quit (server->loop);
+  g_thread_join (server->thread);
+  g_object_unref (server->server);
+  g_main_loop_unref (server->loop);
+  g_main_context_unref (server->context);
+}
+
+/* streammux sink_<i> 패드에서 센 버퍼 */
+typedef struct
+{
+  guint64 count;
+  GstClockTime last_pts;
+  /* 연속한 두 버퍼의 PTS 간격 최대값 */
+  GstClockTime max_gap;
+  gulong probe_id;
+  GstPad *pad;
+  GMutex *lock;
+} PadCount;
+
+typedef struct
+{
+  NvDsSrcParentBin bin;
+  NvDsSourceConfig configs[MAX_SOURCES];
+  GstElement *pipeline;
+  GMutex lock;
+  PadCount counts[MAX_SOURCES];
+} TestPipeline;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  PadCount *count = (PadCount *) data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+
+  g_mutex_lock (count->lock);
+  if (GST_CLOCK_TIME_IS_VALID (pts) &&
+      GST_CLOCK_TIME_IS_VALID (count->last_pts) && pts > count->last_pts)
+    count->max_gap = MAX (count->max_gap, pts - count->last_pts);
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    count->last_pts = pts;
+  count->count++;
+  g_mutex_unlock (count->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+/* streammux sink_<index>에 카운터를 새로 붙입니다. 제거 때 패드가 해제됩니다. */
+static void
+attach_count (TestPipeline * tp, guint index)
+{
+  PadCount *count = &tp->counts[index];
+  gchar name[16];
+
+  g_snprintf (name, sizeof (name), "sink_%u", index);
+  g_mutex_lock (&tp->lock);
+  count->lock = &tp->lock;
+  count->count = 0;
+  count->last_pts = GST_CLOCK_TIME_NONE;
+  count->max_gap = 0;
+  g_mutex_unlock (&tp->lock);
+
+  count->pad = gst_element_get_static_pad (tp->bin.streammux, name);
+  g_assert_nonnull (count->pad);
+  count->probe_id = gst_pad_add_probe (count->pad, GST_PAD_PROBE_TYPE_BUFFER,
+      count_probe, count, NULL);
+}
+
+static void
+detach_count (TestPipeline * tp, guint index)
+{
+  PadCount *count = &tp->counts[index];
+
+  if (!count->pad)
+    return;
+  gst_pad_remove_probe (count->pad, count->probe_id);
+  gst_object_unref (count->pad);
+  count->pad = NULL;
+}
+
+static void
+get_count (TestPipeline * tp, guint index, PadCount * out)
+{
+  g_mutex_lock (&tp->lock);
+  *out = tp->counts[index];
+  g_mutex_unlock (&tp->lock);
+}
+
+static void
+source_config_init (NvDsSourceConfig * config, TestServer * server,
+    guint index, guint sensor_id)
+{
+  memset (config, 0, sizeof (NvDsSourceConfig));
+  config->enable = TRUE;
+  config->type = NV_DS_SOURCE_RTSP;
+  config->uri = g_strdup_printf ("rtsp://127.0.0.1:%u/live", server->port);
+  config->latency = 100;
+  config->select_rtp_protocol = GST_RTSP_LOWER_TRANS_TCP;
+  config->source_id = index;
+  config->camera_id = sensor_id;
+}
+
+static gboolean
+wait_first_buffer (TestPipeline * tp, guint index, guint timeout_ms)
+{
+  gint64 deadline = g_get_monotonic_time () + timeout_ms * 1000;
+  PadCount count;
+
+  do {
+    get_count (tp, index, &count);
+    if (count.count > 0)
+      return TRUE;
+    g_usleep (10 * 1000);
+  } while (g_get_monotonic_time () < deadline);
+  return FALSE;
+}
+
+/*
+ * 소스 넷 중 뒤의 둘을 NUM_CYCLES번 지웠다 다시 붙입니다. 앱의 재적용과 같은
+ * add_source_sub_bin()/remove_source_sub_bin()을 쓰고, 그동안 남아 있는
+ * 소스의 streammux 패드는 프레임을 하나도 빠뜨리지 않아야 합니다.
+ */
+static void
+test_add_remove_loop (void)
+{
+  const GstClockTime frame = GST_SECOND / FPS;
+  TestServer server;
+  TestPipeline tp;
+  PadCount before[NUM_KEPT];
+  GstElement *sink = NULL;
+  gint64 begin;
+  gdouble elapsed;
+  guint i, cycle;
+
+  server_start (&server);
+
+  memset (&tp, 0, sizeof (TestPipeline));
+  g_mutex_init (&tp.lock);
+  for (i = 0; i < NUM_KEPT + NUM_CHURNED; i++)
+    source_config_init (&tp.configs[i], &server, i, i);
+  tp.bin.max_bins = MAX_SOURCES;
+  g_assert_true (create_multi_source_bin (NUM_KEPT + NUM_CHURNED, tp.configs,
+          &tp.bin));
+  g_object_set (tp.bin.streammux, "batch-size", NUM_KEPT + NUM_CHURNED,
+      "width", WIDTH, "height", HEIGHT, "live-source", TRUE,
+      "batched-push-timeout", 40000, NULL);
+
+  tp.pipeline = gst_pipeline_new ("test-pipeline");
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (tp.pipeline), tp.bin.bin, sink, NULL);
+  g_assert_true (gst_element_link (tp.bin.bin, sink));
+  for (i = 0; i < NUM_KEPT + NUM_CHURNED; i++)
+    attach_count (&tp, i);
+
+  g_assert_cmpint (gst_element_set_state (tp.pipeline, GST_STATE_PLAYING), !=,
+      GST_STATE_CHANGE_FAILURE);
+  for (i = 0; i < NUM_KEPT + NUM_CHURNED; i++)
+    g_assert_true (wait_first_buffer (&tp, i, FIRST_BUFFER_TIMEOUT_MS));
+
+  /* 시작 직후의 keyframe 대기는 빼고 루프 동안만 봅니다. */
+  g_usleep (G_USEC_PER_SEC);
+  for (i = 0; i < NUM_KEPT; i++) {
+    g_mutex_lock (&tp.lock);
+    tp.counts[i].max_gap = 0;
+    g_mutex_unlock (&tp.lock);
+    get_count (&tp, i, &before[i]);
+  }
+  begin = g_get_monotonic_time ();
+
+  for (cycle = 0; cycle < NUM_CYCLES; cycle++) {
+    guint index = NUM_KEPT + cycle % NUM_CHURNED;
+
+    detach_count (&tp, index);
+    g_assert_true (remove_source_sub_bin (&tp.bin, index));
+    g_free (tp.configs[index].uri);
+    g_usleep (200 * 1000);
+
+    /* 다시 붙는 소스는 센서 ID가 바뀐 새 소스입니다. */
+    source_config_init (&tp.configs[index], &server, index,
+        MAX_SOURCES + cycle);
+    g_assert_true (add_source_sub_bin (&tp.bin, &tp.configs[index], index));
+    attach_count (&tp, index);
+    g_assert_true (wait_first_buffer (&tp, index, FIRST_BUFFER_TIMEOUT_MS));
+  }
+
+  elapsed = (g_get_monotonic_time () - begin) / (gdouble) G_USEC_PER_SEC;
+  for (i = 0; i < NUM_KEPT; i++) {
+    PadCount after;
+    guint64 expected = (guint64) (elapsed * FPS);
+
+    get_count (&tp, i, &after);
+    g_test_message ("source %u: %" G_GUINT64_FORMAT " buffers in %.2f s "
+        "(expected %" G_GUINT64_FORMAT "), max pts gap %.1f ms", i,
+        after.count - before[i].count, elapsed, expected,
+        after.max_gap / 1e6);
+    /* 빠진 프레임이 있으면 간격이 두 프레임 이상으로 벌어집니다. */
+    g_assert_cmpuint (after.max_gap, <, 2 * frame);
+    g_assert_cmpuint (after.count - before[i].count, >=, expected * 9 / 10);
+  }
+
+  for (i = 0; i < NUM_KEPT + NUM_CHURNED; i++)
+    detach_count (&tp, i);
+  gst_element_set_state (tp.pipeline, GST_STATE_NULL);
+  gst_object_unref (tp.pipeline);
+  destroy_multi_source_bin (&tp.bin);
+  for (i = 0; i < NUM_KEPT + NUM_CHURNED; i++)
+    g_free (tp.configs[i].uri);
+  g_mutex_clear (&tp.lock);
+  server_stop (&server);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (NVDS_APP, "NVDS_APP", 0, NULL);
+  GST_DEBUG_CATEGORY_INIT (APP_CFG_PARSER_CAT, "NVDS_CFG_PARSER", 0, NULL);
+
+  g_test_add_func ("/source-reload/diff/unchanged", test_diff_unchanged);
+  g_test_add_func ("/source-reload/diff/add", test_diff_add);
+  g_test_add_func ("/source-reload/diff/remove", test_diff_remove);
+  g_test_add_func ("/source-reload/diff/uri-change", test_diff_uri_change);
+  g_test_add_func ("/source-reload/diff/sensor-id-change",
+      test_diff_sensor_id_change);
+  g_test_add_func ("/source-reload/diff/duplicates", test_diff_duplicates);
+  g_test_add_func ("/source-reload/add-remove-loop", test_add_remove_loop);
+
+  return g_test_run ();
+}
@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <gio/gio.h>
+#include <gst/rtsp/gstrtsptransport.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include "deepstream_sources.h"
+
+GST_DEBUG_CATEGORY (NVDS_APP);
+GST_DEBUG_CATEGORY (APP_CFG_PARSER_CAT);
+
+#define MAX_SOURCES 32
+#define WIDTH 320
+#define HEIGHT 240
+
+/* 소스가 모두 같은 미디어를 공유하므로 인코더는 하나만 돕니다. */
+#define LIVE_LAUNCH "( videotestsrc is-live=true ! video/x-raw,width=320," \
+    "height=240,framerate=30/1 ! x264enc tune=zerolatency " \
+    "speed-preset=ultrafast key-int-max=15 ! rtph264pay name=pay0 pt=96 )"
+
+/*
+ * 루프백 RTSP 서버와, 연결은 받지만 응답하지 않는 TCP 서버.
+ * 둘 다 자체 GMainContext 스레드에서 돕니다.
+ */
+typedef struct
+{
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GstRTSPServer *server;
+  guint port;
+  GSocketService *hang_service;
+  guint hang_port;
+  gint hang_connections;
+  gint hang_max_connections;
+  gint hang_total_connections;
+} TestServer;
+
+static gboolean
+hang_run_cb (GThreadedSocketService * service, GSocketConnection * connection,
+    GObject * source_object, gpointer user_data)
+{
+  TestServer *server = (TestServer *) user_data;
+  GInputStream *in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  gint now = g_atomic_int_add (&server->hang_connections, 1) + 1;
+  gint max = g_atomic_int_get (&server->hang_max_connections);
+  gchar buf[512];
+
+  g_atomic_int_inc (&server->hang_total_connections);
+  while (now > max && !g_atomic_int_compare_and_exchange (
+          &server->hang_max_connections, max, now))
+    max = g_atomic_int_get (&server->hang_max_connections);
+
+  /* 요청은 읽기만 하고 답하지 않습니다. 클라이언트가 끊으면 끝납니다. */
+  while (g_input_stream_read (in, buf, sizeof (buf), NULL, NULL) > 0);
+
+  g_atomic_int_add (&server->hang_connections, -1);
+  return TRUE;
+}
+
+static gpointer
+server_thread_func (gpointer data)
+{
+  TestServer *server = (TestServer *) data;
+
+  g_main_context_push_thread_default (server->context);
+  g_main_loop_run (server->loop);
+  g_main_context_pop_thread_default (server->context);
+  return NULL;
+}
+
+static void
+server_start (TestServer * server)
+{
+  GstRTSPMountPoints *mounts = NULL;
+  GstRTSPMediaFactory *factory = NULL;
+  GInetAddress *loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *address = g_inet_socket_address_new (loopback, 0);
+  GSocketAddress *effective = NULL;
+  GError *error = NULL;
+
+  memset (server, 0, sizeof (TestServer));
+  server->context = g_main_context_new ();
+  server->loop = g_main_loop_new (server->context, FALSE);
+
+  server->server = gst_rtsp_server_new ();
+  g_object_set (server->server, "address", "127.0.0.1", "service", "0", NULL);
+  mounts = gst_rtsp_server_get_mount_points (server->server);
+  factory = gst_rtsp_media_factory_new ();
+  gst_rtsp_media_factory_set_launch (factory, LIVE_LAUNCH);
+  gst_rtsp_media_factory_set_shared (factory, TRUE);
+  gst_rtsp_mount_points_add_factory (mounts, "/live", factory);
+  g_object_unref (mounts);
+  g_assert_cmpuint (gst_rtsp_server_attach (server->server, server->context),
+      >, 0);
+  server->port = gst_rtsp_server_get_bound_port (server->server);
+
+  /* 소켓 서비스는 만들 때의 thread-default 컨텍스트에서 accept합니다. */
+  g_main_context_push_thread_default (server->context);
+  server->hang_service = g_threaded_socket_service_new (-1);
+  g_socket_listener_add_address (G_SOCKET_LISTENER (server->hang_service),
+      address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, &effective,
+      &error);
+  g_assert_no_error (error);
+  server->hang_port =
+      g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective));
+  g_signal_connect (server->hang_service, "run", G_CALLBACK (hang_run_cb),
+      server);
+  g_socket_service_start (server->hang_service);
+  g_main_context_pop_thread_default (server->context);
+
+  server->thread = g_thread_new ("test-rtsp-server", server_thread_func,
+      server);
+
+  g_object_unref (effective);
+  g_object_unref (address);
+  g_object_unref (loopback);
+}
+
+static void
+server_stop (TestServer * server)
+{
+  g_socket_service_stop (server->hang_service);
+  g_socket_listener_close (G_SOCKET_LISTENER (server->hang_service));
+  g_main_loop_quit (server->loop);
+  g_thread_join (server->thread);
+  g_object_unref (server->hang_service);
+  g_object_unref (server->server);
+  g_main_loop_unref (server->loop);
+  g_main_context_unref (server->context);
+}
+
+typedef struct
+{
+  NvDsSrcParentBin bin;
+  NvDsSourceConfig configs[MAX_SOURCES];
+  guint num_sources;
+  GstElement *pipeline;
+
+  /* 표본 스레드가 1 ms마다 잰 OPENING 소스 수의 최대값 */
+  GThread *sampler;
+  gint sampler_stop;
+  guint max_opening;
+} TestPipeline;
+
+static void
+startup_sync_message_cb (GstBus * bus, GstMessage * message, gpointer data)
+{
+  handle_source_startup_message ((NvDsSrcParentBin *) data, message);
+}
+
+/* 앞의 num_hung개 소스는 응답하지 않는 서버, 나머지는 RTSP 서버로 향합니다. */
+static void
+pipeline_init (TestPipeline * tp, TestServer * server, guint num_sources,
+    guint num_hung, const NvDsSourceStartupConfig * startup)
+{
+  GstElement *sink = NULL;
+  GstBus *bus = NULL;
+  guint i;
+
+  memset (tp, 0, sizeof (TestPipeline));
+  tp->num_sources = num_sources;
+  for (i = 0; i < num_sources; i++) {
+    NvDsSourceConfig *config = &tp->configs[i];
+
+    config->enable = TRUE;
+    config->type = NV_DS_SOURCE_RTSP;
+    config->uri = g_strdup_printf ("rtsp://127.0.0.1:%u/live",
+        i < num_hung ? server->hang_port : server->port);
+    config->latency = 100;
+    config->select_rtp_protocol = GST_RTSP_LOWER_TRANS_TCP;
+    config->camera_id = config->source_id = i;
+  }
+  tp->bin.startup_config = *startup;
+  g_assert_true (create_multi_source_bin (num_sources, tp->configs, &tp->bin));
+  g_object_set (tp->bin.streammux, "batch-size", num_sources, "width", WIDTH,
+      "height", HEIGHT, "live-source", TRUE, "batched-push-timeout", 40000,
+      NULL);
+
+  tp->pipeline = gst_pipeline_new ("test-pipeline");
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (tp->pipeline), tp->bin.bin, sink, NULL);
+  g_assert_true (gst_element_link (tp->bin.bin, sink));
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (tp->pipeline));
+  gst_bus_enable_sync_message_emission (bus);
+  g_signal_connect (bus, "sync-message::progress",
+      G_CALLBACK (startup_sync_message_cb), &tp->bin);
+  gst_object_unref (bus);
+}
+
+static guint
+count_state (TestPipeline * tp, NvDsSourceStartupState state)
+{
+  guint i, n = 0;
+
+  g_mutex_lock (&tp->bin.startup_lock);
+  for (i = 0; i < tp->bin.num_bins; i++)
+    n += tp->bin.sub_bins[i].startup_state == (gint) state;
+  g_mutex_unlock (&tp->bin.startup_lock);
+  return n;
+}
+
+static gpointer
+sampler_func (gpointer data)
+{
+  TestPipeline *tp = (TestPipeline *) data;
+
+  while (!g_atomic_int_get (&tp->sampler_stop)) {
+    tp->max_opening = MAX (tp->max_opening,
+        count_state (tp, NV_DS_SOURCE_STARTUP_OPENING));
+    g_usleep (1000);
+  }
+  return NULL;
+}
+
+/* PAUSED, 쿼럼 대기, PLAYING 순으로 앱과 같게 시작합니다. */
+static gboolean
+pipeline_start (TestPipeline * tp)
+{
+  gboolean quorum;
+
+  tp->sampler = g_thread_new ("test-sampler", sampler_func, tp);
+  g_assert_cmpint (gst_element_set_state (tp->pipeline, GST_STATE_PAUSED), !=,
+      GST_STATE_CHANGE_FAILURE);
+  quorum = wait_for_source_quorum (&tp->bin);
+  g_assert_cmpint (gst_element_set_state (tp->pipeline, GST_STATE_PLAYING),
+      !=, GST_STATE_CHANGE_FAILURE);
+  return quorum;
+}
+
+/* 모든 소스의 상태가 state가 될 때까지 최대 timeout_ms 기다립니다. */
+static gboolean
+pipeline_wait_all (TestPipeline * tp, guint first, guint count,
+    NvDsSourceStartupState state, guint timeout_ms)
+{
+  gint64 deadline = g_get_monotonic_time () + timeout_ms * 1000;
+
+  while (g_get_monotonic_time () < deadline) {
+    guint i, n = 0;
+
+    g_mutex_lock (&tp->bin.startup_lock);
+    for (i = first; i < first + count; i++)
+      n += tp->bin.sub_bins[i].startup_state == (gint) state;
+    g_mutex_unlock (&tp->bin.startup_lock);
+    if (n == count)
+      return TRUE;
+    g_usleep (10 * 1000);
+  }
+  return FALSE;
+}
+
+static void
+pipeline_clear (TestPipeline * tp)
+{
+  guint i;
+
+  g_atomic_int_set (&tp->sampler_stop, 1);
+  g_thread_join (tp->sampler);
+  stop_source_startup (&tp->bin);
+  gst_element_set_state (tp->pipeline, GST_STATE_NULL);
+  gst_object_unref (tp->pipeline);
+  destroy_multi_source_bin (&tp->bin);
+  for (i = 0; i < tp->num_sources; i++)
+    g_free (tp->configs[i].uri);
+}
+
+/* workers 2, 소스 8개: 동시에 여는 소스는 둘을 넘지 않고 모두 열립니다. */
+static void
+test_window (void)
+{
+  NvDsSourceStartupConfig startup = { 2, 1.0, 20000, 10000 };
+  TestServer server;
+  TestPipeline tp;
+
+  server_start (&server);
+  pipeline_init (&tp, &server, 8, 0, &startup);
+
+  g_assert_true (pipeline_start (&tp));
+  g_assert_cmpuint (count_state (&tp, NV_DS_SOURCE_STARTUP_OPENED), ==, 8);
+  g_assert_cmpuint (tp.max_opening, <=, 2);
+  g_assert_cmpuint (tp.max_opening, >=, 1);
+
+  pipeline_clear (&tp);
+  server_stop (&server);
+}
+
+/*
+ * 응답하지 않는 소스 넷과 정상 소스 둘, workers 2, open-timeout 300 ms.
+ * 시간 초과된 소스는 잠긴 채 NULL로 내려가 연결을 끊고, 정상 소스가 모두
+ * 시작된 뒤 슬롯 안에서 다시 시도됩니다.
+ */
+static void
+test_open_timeout (void)
+{
+  NvDsSourceStartupConfig startup = { 2, 0.3, 20000, 300 };
+  const guint num_hung = 4;
+  TestServer server;
+  TestPipeline tp;
+  gint64 deadline;
+  guint i;
+
+  server_start (&server);
+  pipeline_init (&tp, &server, 6, num_hung, &startup);
+
+  g_assert_true (pipeline_start (&tp));
+  g_assert_true (pipeline_wait_all (&tp, num_hung, 2,
+          NV_DS_SOURCE_STARTUP_OPENED, 10000));
+
+  for (i = 0; i < num_hung; i++) {
+    GstElement *sub = tp.bin.sub_bins[i].bin;
+    GstState state = GST_STATE_VOID_PENDING;
+    gboolean stopped = FALSE;
+
+    deadline = g_get_monotonic_time () + 2 * G_USEC_PER_SEC;
+    while (!stopped && g_get_monotonic_time () < deadline) {
+      gint startup_state;
+
+      g_mutex_lock (&tp.bin.startup_lock);
+      startup_state = tp.bin.sub_bins[i].startup_state;
+      g_mutex_unlock (&tp.bin.startup_lock);
+      gst_element_get_state (sub, &state, NULL, 0);
+      stopped = startup_state == NV_DS_SOURCE_STARTUP_FAILED &&
+          gst_element_is_locked_state (sub) && state == GST_STATE_NULL;
+      if (!stopped)
+        g_usleep (1000);
+    }
+    g_assert_true (stopped);
+  }
+
+  deadline = g_get_monotonic_time () + 3 * G_USEC_PER_SEC;
+  while (g_atomic_int_get (&server.hang_total_connections) < num_hung + 2 &&
+      g_get_monotonic_time () < deadline)
+    g_usleep (10 * 1000);
+  g_test_message ("hung server: %d connections, at most %d at once",
+      g_atomic_int_get (&server.hang_total_connections),
+      g_atomic_int_get (&server.hang_max_connections));
+  g_assert_cmpint (g_atomic_int_get (&server.hang_total_connections), >=,
+      num_hung + 2);
+  /*
+   * 시간 초과된 소스가 연결을 유지하면 넷이 동시에 붙습니다. 서버 스레드가
+   * 끊김을 알아채기 전에 재시도가 붙는 순간이 있어 하나의 여유를 둡니다.
+   */
+  g_assert_cmpint (g_atomic_int_get (&server.hang_max_connections), <=,
+      startup.workers + 1);
+  g_assert_cmpuint (tp.max_opening, <=, startup.workers);
+  g_assert_cmpuint (count_state (&tp, NV_DS_SOURCE_STARTUP_OPENED), ==, 2);
+
+  pipeline_clear (&tp);
+  server_stop (&server);
+}
+
+/* 정상 소스 절반이면 쿼럼 0.5는 응답 없는 소스를 기다리지 않고 채워집니다. */
+static void
+test_quorum (void)
+{
+  NvDsSourceStartupConfig startup = { 4, 0.5, 20000, 20000 };
+  TestServer server;
+  TestPipeline tp;
+  gint64 begin;
+
+  server_start (&server);
+  pipeline_init (&tp, &server, 4, 2, &startup);
+
+  begin = g_get_monotonic_time ();
+  g_assert_true (pipeline_start (&tp));
+  g_assert_cmpint (g_get_monotonic_time () - begin, <, 10 * G_USEC_PER_SEC);
+  g_assert_cmpuint (count_state (&tp, NV_DS_SOURCE_STARTUP_OPENED), ==, 2);
+  g_assert_cmpuint (count_state (&tp, NV_DS_SOURCE_STARTUP_OPENING), ==, 2);
+
+  pipeline_clear (&tp);
+  server_stop (&server);
+}
+
+/* 소스 32개가 모두 열릴 때까지의 시간을 workers별로 잽니다. */
+static void
+bench_open (void)
+{
+  const guint workers[] = { 1, 4, 8, 32 };
+  TestServer server;
+  guint w;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  server_start (&server);
+  for (w = 0; w < G_N_ELEMENTS (workers); w++) {
+    NvDsSourceStartupConfig startup = { workers[w], 1.0, 60000, 10000 };
+    TestPipeline tp;
+    gdouble elapsed;
+
+    pipeline_init (&tp, &server, MAX_SOURCES, 0, &startup);
+    g_test_timer_start ();
+    g_assert_true (pipeline_start (&tp));
+    elapsed = g_test_timer_elapsed ();
+    g_test_minimized_result (elapsed * 1e3,
+        "open: workers %u: %.0f ms until %u sources opened", workers[w],
+        elapsed * 1e3, MAX_SOURCES);
+    pipeline_clear (&tp);
+  }
+  server_stop (&server);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (NVDS_APP, "NVDS_APP", 0, NULL);
+  GST_DEBUG_CATEGORY_INIT (APP_CFG_PARSER_CAT, "NVDS_CFG_PARSER", 0, NULL);
+
+  g_test_add_func ("/source-startup/window", test_window);
+  g_test_add_func ("/source-startup/open-timeout", test_open_timeout);
+  g_test_add_func ("/source-startup/quorum", test_quorum);
+  g_test_add_func ("/source-startup/bench/open", bench_open);
+
+  return g_test_run ();
+}
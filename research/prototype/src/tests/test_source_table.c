@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "prototype_source_table.h"
+
+#define NUM_SOURCES (4096)
+
+/* StreamSourceInfo처럼 뮤텍스와 스트리밍 스레드가 갱신하는 카운터를 가진 슬롯 */
+typedef struct
+{
+  GMutex lock;
+  guint source_id;
+  gint frame_count;
+  gint meta_number;
+} SyntheticSource;
+
+static guint num_cleared;
+
+static void
+synthetic_source_init (guint source_id, gpointer slot)
+{
+  SyntheticSource *source = (SyntheticSource *) slot;
+
+  g_mutex_init (&source->lock);
+  source->source_id = source_id;
+}
+
+static void
+synthetic_source_clear (guint source_id, gpointer slot)
+{
+  SyntheticSource *source = (SyntheticSource *) slot;
+
+  g_assert_cmpuint (source->source_id, ==, source_id);
+  g_mutex_clear (&source->lock);
+  num_cleared++;
+}
+
+static PrototypeSourceTable *
+synthetic_table_new (void)
+{
+  return prototype_source_table_new (sizeof (SyntheticSource),
+      synthetic_source_init, synthetic_source_clear);
+}
+
+/* 두 슬롯의 데이터가 같은 캐시 라인에 걸치지 않는지 확인합니다. */
+static void
+assert_no_shared_line (gconstpointer a, gconstpointer b, gsize size)
+{
+  guintptr a_first = (guintptr) a / PROTOTYPE_SOURCE_TABLE_CACHE_LINE;
+  guintptr a_last = ((guintptr) a + size - 1) / PROTOTYPE_SOURCE_TABLE_CACHE_LINE;
+  guintptr b_first = (guintptr) b / PROTOTYPE_SOURCE_TABLE_CACHE_LINE;
+  guintptr b_last = ((guintptr) b + size - 1) / PROTOTYPE_SOURCE_TABLE_CACHE_LINE;
+
+  g_assert_true (a_last < b_first || b_last < a_first);
+}
+
+static void
+test_many_sources (void)
+{
+  PrototypeSourceTable *table = synthetic_table_new ();
+  SyntheticSource **slots = g_new0 (SyntheticSource *, NUM_SOURCES);
+  guint i;
+
+  num_cleared = 0;
+  for (i = 0; i < NUM_SOURCES; i++) {
+    g_assert_null (prototype_source_table_lookup (table, i));
+    slots[i] = prototype_source_table_get (table, i);
+    g_assert_nonnull (slots[i]);
+    g_assert_cmpuint (slots[i]->source_id, ==, i);
+    slots[i]->frame_count = i;
+  }
+  g_assert_cmpuint (prototype_source_table_size (table), ==, NUM_SOURCES);
+
+  /* 다른 슬롯을 추가해도 주소와 값이 그대로입니다. */
+  for (i = 0; i < NUM_SOURCES; i++) {
+    g_assert_true (prototype_source_table_lookup (table, i) == slots[i]);
+    g_assert_true (prototype_source_table_get (table, i) == slots[i]);
+    g_assert_cmpint (slots[i]->frame_count, ==, i);
+    if (i > 0)
+      assert_no_shared_line (slots[i - 1], slots[i], sizeof (SyntheticSource));
+  }
+
+  /* 홀수 소스를 지우고 다시 추가하면 같은 메모리를 0부터 씁니다. */
+  for (i = 1; i < NUM_SOURCES; i += 2)
+    prototype_source_table_remove (table, i);
+  g_assert_cmpuint (num_cleared, ==, NUM_SOURCES / 2);
+  g_assert_cmpuint (prototype_source_table_size (table), ==, NUM_SOURCES / 2);
+  for (i = 0; i < NUM_SOURCES; i++) {
+    if (i % 2)
+      g_assert_null (prototype_source_table_lookup (table, i));
+    else
+      g_assert_true (prototype_source_table_lookup (table, i) == slots[i]);
+  }
+  for (i = 1; i < NUM_SOURCES; i += 2) {
+    SyntheticSource *slot = prototype_source_table_get (table, i);
+
+    g_assert_true (slot == slots[i]);
+    g_assert_cmpint (slot->frame_count, ==, 0);
+  }
+
+  prototype_source_table_free (table);
+  g_assert_cmpuint (num_cleared, ==, NUM_SOURCES / 2 + NUM_SOURCES);
+  g_free (slots);
+}
+
+static void
+test_sparse_ids (void)
+{
+  PrototypeSourceTable *table = synthetic_table_new ();
+  static const guint ids[] = { 0, 255, 256, 65535, 300000,
+    PROTOTYPE_SOURCE_TABLE_MAX_ID - 1
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    g_assert_nonnull (prototype_source_table_get (table, ids[i]));
+  g_assert_null (prototype_source_table_get (table,
+          PROTOTYPE_SOURCE_TABLE_MAX_ID));
+  g_assert_null (prototype_source_table_lookup (table, 1));
+  g_assert_null (prototype_source_table_lookup (table, 299999));
+  g_assert_cmpuint (prototype_source_table_size (table), ==,
+      G_N_ELEMENTS (ids));
+  prototype_source_table_free (table);
+}
+
+static void
+count_cb (guint source_id, gpointer slot, gpointer user_data)
+{
+  g_assert_cmpuint (((SyntheticSource *) slot)->source_id, ==, source_id);
+  (*(guint *) user_data)++;
+}
+
+#define STREAM_THREADS (8)
+
+typedef struct
+{
+  PrototypeSourceTable *table;
+  guint first;
+  gint running;
+} StreamThreadData;
+
+/* 스트리밍 스레드처럼 잠금 없이 조회하고 슬롯 뮤텍스 안에서 카운터를 올립니다. */
+static gpointer
+stream_thread (gpointer data)
+{
+  StreamThreadData *td = (StreamThreadData *) data;
+  guint i = td->first;
+
+  while (g_atomic_int_get (&td->running)) {
+    SyntheticSource *slot = prototype_source_table_lookup (td->table, i);
+
+    if (slot) {
+      g_mutex_lock (&slot->lock);
+      slot->frame_count++;
+      g_mutex_unlock (&slot->lock);
+    }
+    i = (i + STREAM_THREADS) % NUM_SOURCES;
+  }
+  return NULL;
+}
+
+static void
+test_concurrent_lookup (void)
+{
+  PrototypeSourceTable *table = synthetic_table_new ();
+  StreamThreadData td[STREAM_THREADS];
+  GThread *threads[STREAM_THREADS];
+  guint count = 0;
+  guint i;
+
+  /* 조회 스레드가 도는 동안 메인 스레드가 4096개 소스를 추가합니다. */
+  for (i = 0; i < STREAM_THREADS; i++) {
+    td[i].table = table;
+    td[i].first = i;
+    td[i].running = 1;
+    threads[i] = g_thread_new ("stream", stream_thread, &td[i]);
+  }
+  for (i = 0; i < NUM_SOURCES; i++)
+    g_assert_nonnull (prototype_source_table_get (table, i));
+  for (i = 0; i < STREAM_THREADS; i++) {
+    g_atomic_int_set (&td[i].running, 0);
+    g_thread_join (threads[i]);
+  }
+
+  prototype_source_table_foreach (table, count_cb, &count);
+  g_assert_cmpuint (count, ==, NUM_SOURCES);
+  prototype_source_table_free (table);
+}
+
+#define BENCH_THREADS (8)
+#define BENCH_UPDATES (5000000)
+
+typedef struct
+{
+  SyntheticSource *source;
+} BenchThreadData;
+
+static gpointer
+bench_thread (gpointer data)
+{
+  SyntheticSource *source = ((BenchThreadData *) data)->source;
+  guint i;
+
+  for (i = 0; i < BENCH_UPDATES; i++) {
+    g_mutex_lock (&source->lock);
+    source->frame_count++;
+    g_mutex_unlock (&source->lock);
+  }
+  return NULL;
+}
+
+/* 스레드마다 자기 소스 하나를 갱신하는 데 걸린 호출당 시간(ns) */
+static gdouble
+run_update_bench (SyntheticSource ** sources)
+{
+  BenchThreadData td[BENCH_THREADS];
+  GThread *threads[BENCH_THREADS];
+  gdouble elapsed;
+  guint i;
+
+  g_test_timer_start ();
+  for (i = 0; i < BENCH_THREADS; i++) {
+    td[i].source = sources[i];
+    threads[i] = g_thread_new ("bench", bench_thread, &td[i]);
+  }
+  for (i = 0; i < BENCH_THREADS; i++)
+    g_thread_join (threads[i]);
+  elapsed = g_test_timer_elapsed ();
+
+  for (i = 0; i < BENCH_THREADS; i++)
+    g_assert_cmpint (sources[i]->frame_count, ==, BENCH_UPDATES);
+  return elapsed * 1e9 / BENCH_UPDATES;
+}
+
+static void
+bench_false_sharing (void)
+{
+  PrototypeSourceTable *table = NULL;
+  SyntheticSource *packed = NULL;
+  SyntheticSource *sources[BENCH_THREADS];
+  gdouble packed_ns, table_ns;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  /* 이전 배열 방식: 이웃한 소스가 같은 캐시 라인을 공유합니다. */
+  packed = g_new0 (SyntheticSource, BENCH_THREADS);
+  for (i = 0; i < BENCH_THREADS; i++) {
+    synthetic_source_init (i, &packed[i]);
+    sources[i] = &packed[i];
+  }
+  packed_ns = run_update_bench (sources);
+  for (i = 0; i < BENCH_THREADS; i++)
+    g_mutex_clear (&packed[i].lock);
+  g_free (packed);
+
+  table = synthetic_table_new ();
+  for (i = 0; i < BENCH_THREADS; i++)
+    sources[i] = prototype_source_table_get (table, i);
+  table_ns = run_update_bench (sources);
+  prototype_source_table_free (table);
+
+  g_test_message ("%u threads, %zu-byte source struct", BENCH_THREADS,
+      sizeof (SyntheticSource));
+  g_test_minimized_result (packed_ns, "packed array: %.1f ns/update",
+      packed_ns);
+  g_test_minimized_result (table_ns, "source table: %.1f ns/update",
+      table_ns);
+}
+
+static void
+bench_lookup (void)
+{
+  PrototypeSourceTable *table = NULL;
+  guint n = 50000000;
+  guint64 sum = 0;
+  gdouble elapsed;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+  table = synthetic_table_new ();
+  for (i = 0; i < NUM_SOURCES; i++)
+    prototype_source_table_get (table, i);
+
+  g_test_timer_start ();
+  for (i = 0; i < n; i++) {
+    SyntheticSource *slot =
+        prototype_source_table_lookup (table, (i * 2654435761u) % NUM_SOURCES);
+    sum += slot->source_id;
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_assert_cmpuint (sum, >, 0);
+  g_test_minimized_result (elapsed * 1e9 / n,
+      "lookup over %u sources: %.2f ns", NUM_SOURCES, elapsed * 1e9 / n);
+  prototype_source_table_free (table);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/source-table/many-sources", test_many_sources);
+  g_test_add_func ("/source-table/sparse-ids", test_sparse_ids);
+  g_test_add_func ("/source-table/concurrent-lookup", test_concurrent_lookup);
+  g_test_add_func ("/source-table/bench/false-sharing", bench_false_sharing);
+  g_test_add_func ("/source-table/bench/lookup", bench_lookup);
+
+  return g_test_run ();
+}
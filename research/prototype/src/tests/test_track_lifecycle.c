@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "prototype_track_lifecycle.h"
+
+/* 스크립트는 10 fps(100 ms) 프레임으로 진행합니다. */
+#define FRAME_MS 100
+#define SOURCE_ID 0
+
+typedef struct
+{
+  PrototypeTrackEventType type;
+  PrototypeTrackExitReason exit_reason;
+  guint64 object_id;
+  GstClockTime event_ts;
+  /** advance()를 부른 프레임 시각 */
+  GstClockTime emitted_ts;
+  guint64 num_observations;
+} RecordedEvent;
+
+typedef struct
+{
+  PrototypeTrackLifecycleConfig config;
+  PrototypeTrackLifecycle *lifecycle;
+  GArray *events;
+  GstClockTime now;
+} Script;
+
+static void
+record_event (const PrototypeTrackEvent * event, gpointer user_data)
+{
+  Script *script = (Script *) user_data;
+  RecordedEvent recorded = {
+    .type = event->type,
+    .exit_reason = event->exit_reason,
+    .object_id = event->object_id,
+    .event_ts = event->event_ts,
+    .emitted_ts = script->now,
+    .num_observations = event->num_observations,
+  };
+
+  g_array_append_val (script->events, recorded);
+}
+
+static void
+script_init (Script * script)
+{
+  memset (script, 0, sizeof (*script));
+  script->config.enable = TRUE;
+  script->config.dwell_interval_sec = 0;
+  script->config.exit_timeout_ms = 2000;
+  script->config.min_observations = 3;
+  script->config.max_tracks_per_source = 1024;
+  script->config.tick_ms = 100;
+  script->events = g_array_new (FALSE, FALSE, sizeof (RecordedEvent));
+}
+
+static void
+script_start (Script * script)
+{
+  script->lifecycle = prototype_track_lifecycle_new (&script->config);
+  g_assert_nonnull (script->lifecycle);
+}
+
+static void
+script_clear (Script * script)
+{
+  prototype_track_lifecycle_free (script->lifecycle);
+  g_array_free (script->events, TRUE);
+}
+
+/* 시각 t_ms의 프레임에서 ids의 객체를 관측하고 advance 합니다. */
+static void
+script_frame (Script * script, guint64 t_ms, const guint64 * ids, guint n)
+{
+  PrototypeTrackBox box = { 100, 100, 20, 40 };
+  guint i;
+
+  script->now = t_ms * GST_MSECOND;
+  for (i = 0; i < n; i++) {
+    box.left = 100 + t_ms / 10.0f;
+    prototype_track_lifecycle_observe (script->lifecycle, SOURCE_ID, ids[i],
+        2, 0, 0.5f, &box, script->now);
+  }
+  prototype_track_lifecycle_advance (script->lifecycle, SOURCE_ID,
+      script->now, record_event, script);
+}
+
+/* [from_ms, to_ms) 동안 매 프레임 ids를 관측합니다. n이 0이면 빈 프레임입니다. */
+static void
+script_run (Script * script, guint64 from_ms, guint64 to_ms,
+    const guint64 * ids, guint n)
+{
+  guint64 t;
+
+  for (t = from_ms; t < to_ms; t += FRAME_MS)
+    script_frame (script, t, ids, n);
+}
+
+static const RecordedEvent *
+event_at (Script * script, guint index)
+{
+  g_assert_cmpuint (index, <, script->events->len);
+  return &g_array_index (script->events, RecordedEvent, index);
+}
+
+static void
+assert_event (Script * script, guint index, PrototypeTrackEventType type,
+    guint64 object_id, guint64 event_ms)
+{
+  const RecordedEvent *event = event_at (script, index);
+
+  g_assert_cmpint (event->type, ==, type);
+  g_assert_cmpuint (event->object_id, ==, object_id);
+  g_assert_cmpuint (event->event_ts, ==, event_ms * GST_MSECOND);
+}
+
+/* exit는 마지막 관측 + exit-timeout 이후 한 tick 안에 나와야 합니다. */
+static void
+assert_exit (Script * script, guint index, guint64 object_id,
+    guint64 last_ms, PrototypeTrackExitReason reason)
+{
+  const RecordedEvent *event = event_at (script, index);
+
+  assert_event (script, index, PROTOTYPE_TRACK_EVENT_EXIT, object_id, last_ms);
+  g_assert_cmpint (event->exit_reason, ==, reason);
+  if (reason == PROTOTYPE_TRACK_EXIT_TIMEOUT) {
+    g_assert_cmpuint (event->emitted_ts, >=,
+        (last_ms + script->config.exit_timeout_ms) * GST_MSECOND);
+    g_assert_cmpuint (event->emitted_ts, <=,
+        (last_ms + script->config.exit_timeout_ms +
+            script->config.tick_ms) * GST_MSECOND);
+  }
+}
+
+static void
+test_enter_exit (void)
+{
+  Script script;
+  const guint64 ids[] = { 1 };
+
+  script_init (&script);
+  script_start (&script);
+
+  script_run (&script, 0, 1000, ids, 1);
+  script_run (&script, 1000, 4000, NULL, 0);
+
+  /* enter는 min-observations 번째 관측에서, event_ts는 처음 본 시각입니다. */
+  g_assert_cmpuint (script.events->len, ==, 2);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+  g_assert_cmpuint (event_at (&script, 0)->emitted_ts, ==, 200 * GST_MSECOND);
+  assert_exit (&script, 1, 1, 900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+  g_assert_cmpuint (event_at (&script, 1)->num_observations, ==, 10);
+  g_assert_cmpuint (prototype_track_lifecycle_num_tracks (script.lifecycle,
+          SOURCE_ID), ==, 0);
+
+  script_clear (&script);
+}
+
+static void
+test_short_occlusion (void)
+{
+  Script script;
+  const guint64 ids[] = { 1 };
+
+  script_init (&script);
+  script_start (&script);
+
+  /* exit-timeout(2 s)보다 짧은 1.5 s 가림은 같은 트랙으로 이어집니다. */
+  script_run (&script, 0, 1000, ids, 1);
+  script_run (&script, 1000, 2500, NULL, 0);
+  script_run (&script, 2500, 3000, ids, 1);
+  script_run (&script, 3000, 6000, NULL, 0);
+
+  g_assert_cmpuint (script.events->len, ==, 2);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+  assert_exit (&script, 1, 1, 2900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+  g_assert_cmpuint (event_at (&script, 1)->num_observations, ==, 15);
+
+  script_clear (&script);
+}
+
+static void
+test_long_occlusion (void)
+{
+  Script script;
+  const guint64 ids[] = { 1 };
+
+  script_init (&script);
+  script_start (&script);
+
+  /* exit-timeout보다 긴 가림은 exit 후 같은 object_id로 새로 enter 합니다. */
+  script_run (&script, 0, 1000, ids, 1);
+  script_run (&script, 1000, 3500, NULL, 0);
+  script_run (&script, 3500, 4000, ids, 1);
+  script_run (&script, 4000, 7000, NULL, 0);
+
+  g_assert_cmpuint (script.events->len, ==, 4);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+  assert_exit (&script, 1, 1, 900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+  assert_event (&script, 2, PROTOTYPE_TRACK_EVENT_ENTER, 1, 3500);
+  assert_exit (&script, 3, 1, 3900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+  g_assert_cmpuint (event_at (&script, 3)->num_observations, ==, 5);
+
+  script_clear (&script);
+}
+
+static void
+test_id_switch (void)
+{
+  Script script;
+  const guint64 before[] = { 1 };
+  const guint64 after[] = { 2 };
+
+  script_init (&script);
+  script_start (&script);
+
+  /* 트래커가 같은 객체에 새 id를 주면 이전 트랙은 timeout으로 exit 합니다. */
+  script_run (&script, 0, 1000, before, 1);
+  script_run (&script, 1000, 2000, after, 1);
+  script_run (&script, 2000, 5000, NULL, 0);
+
+  g_assert_cmpuint (script.events->len, ==, 4);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+  assert_event (&script, 1, PROTOTYPE_TRACK_EVENT_ENTER, 2, 1000);
+  assert_exit (&script, 2, 1, 900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+  assert_exit (&script, 3, 2, 1900, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+
+  script_clear (&script);
+}
+
+static void
+test_flicker (void)
+{
+  Script script;
+  const guint64 ids[] = { 7 };
+
+  script_init (&script);
+  script_start (&script);
+
+  /* min-observations 미만으로 잠깐 보인 트랙은 이벤트 없이 사라집니다. */
+  script_run (&script, 0, 200, ids, 1);
+  g_assert_cmpuint (prototype_track_lifecycle_num_tracks (script.lifecycle,
+          SOURCE_ID), ==, 1);
+  script_run (&script, 200, 3000, NULL, 0);
+  script_run (&script, 3000, 3200, ids, 1);
+  script_run (&script, 3200, 6000, NULL, 0);
+
+  g_assert_cmpuint (script.events->len, ==, 0);
+  g_assert_cmpuint (prototype_track_lifecycle_num_tracks (script.lifecycle,
+          SOURCE_ID), ==, 0);
+
+  script_clear (&script);
+}
+
+static void
+test_dwell (void)
+{
+  Script script;
+  const guint64 ids[] = { 1 };
+  guint i;
+
+  script_init (&script);
+  script.config.dwell_interval_sec = 1;
+  script_start (&script);
+
+  script_run (&script, 0, 3500, ids, 1);
+  script_run (&script, 3500, 6000, NULL, 0);
+
+  /*
+   * dwell은 first_ts부터 dwell-interval 간격으로 exit 전까지 나옵니다.
+   * 마지막 관측(3.4 s) 뒤 exit(5.4 s)까지는 가림으로 보고 dwell을 계속 냅니다.
+   */
+  g_assert_cmpuint (script.events->len, ==, 7);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+  for (i = 1; i <= 5; i++) {
+    assert_event (&script, i, PROTOTYPE_TRACK_EVENT_DWELL, 1, i * 1000);
+    g_assert_cmpuint (event_at (&script, i)->emitted_ts, <=,
+        (i * 1000 + script.config.tick_ms) * GST_MSECOND);
+  }
+  assert_exit (&script, 6, 1, 3400, PROTOTYPE_TRACK_EXIT_TIMEOUT);
+
+  script_clear (&script);
+}
+
+static void
+test_eviction (void)
+{
+  Script script;
+  const guint64 ids[] = { 1, 2, 3, 4 };
+  const guint64 newcomer[] = { 2, 3, 4, 5 };
+
+  script_init (&script);
+  script.config.max_tracks_per_source = 4;
+  script_start (&script);
+
+  script_run (&script, 0, 500, ids, 4);
+  /* 다섯 번째 트랙이 오면 가장 오래 관측되지 않은 트랙 1이 밀려납니다. */
+  script_run (&script, 500, 1000, newcomer, 4);
+
+  g_assert_cmpuint (script.events->len, ==, 6);
+  assert_exit (&script, 4, 1, 400, PROTOTYPE_TRACK_EXIT_EVICTED);
+  g_assert_cmpuint (event_at (&script, 4)->emitted_ts, ==, 500 * GST_MSECOND);
+  assert_event (&script, 5, PROTOTYPE_TRACK_EVENT_ENTER, 5, 500);
+  g_assert_cmpuint (prototype_track_lifecycle_num_tracks (script.lifecycle,
+          SOURCE_ID), ==, 4);
+
+  script_clear (&script);
+}
+
+static void
+test_timestamp_reset (void)
+{
+  Script script;
+  const guint64 ids[] = { 1 };
+
+  script_init (&script);
+  script_start (&script);
+
+  /* 파일 반복 재생처럼 타임스탬프가 되돌아가면 기존 트랙은 SOURCE_RESET으로 exit 합니다. */
+  script_run (&script, 10000, 11000, ids, 1);
+  script_run (&script, 0, 1000, ids, 1);
+
+  g_assert_cmpuint (script.events->len, ==, 3);
+  assert_event (&script, 0, PROTOTYPE_TRACK_EVENT_ENTER, 1, 10000);
+  assert_exit (&script, 1, 1, 10900, PROTOTYPE_TRACK_EXIT_SOURCE_RESET);
+  assert_event (&script, 2, PROTOTYPE_TRACK_EVENT_ENTER, 1, 0);
+
+  script_clear (&script);
+}
+
+static void
+test_remove_source (void)
+{
+  Script script;
+  const guint64 entered[] = { 1, 2 };
+  const guint64 pending[] = { 3 };
+
+  script_init (&script);
+  script_start (&script);
+
+  script_run (&script, 0, 500, entered, 2);
+  script_frame (&script, 500, pending, 1);
+  prototype_track_lifecycle_remove_source (script.lifecycle, SOURCE_ID,
+      record_event, &script);
+
+  /* enter한 트랙만 exit를 내고, 소스 상태는 사라집니다. */
+  g_assert_cmpuint (script.events->len, ==, 4);
+  assert_exit (&script, 2, 1, 400, PROTOTYPE_TRACK_EXIT_SOURCE_RESET);
+  assert_exit (&script, 3, 2, 400, PROTOTYPE_TRACK_EXIT_SOURCE_RESET);
+  g_assert_cmpuint (prototype_track_lifecycle_num_tracks (script.lifecycle,
+          SOURCE_ID), ==, 0);
+
+  script_clear (&script);
+}
+
+static void
+count_event (const PrototypeTrackEvent * event, gpointer user_data)
+{
+  guint *counts = (guint *) user_data;
+
+  counts[event->type]++;
+}
+
+/* 동시 트랙 10k, 30 fps, 초당 1% 교체 */
+static void
+bench_observe (void)
+{
+  PrototypeTrackLifecycleConfig config = {
+    .enable = TRUE,
+    .dwell_interval_sec = 10,
+    .exit_timeout_ms = 2000,
+    .min_observations = 3,
+    .max_tracks_per_source = 16384,
+    .tick_ms = 100,
+  };
+  const guint num_tracks = 10000, fps = 30, seconds = 20;
+  const guint turnover_per_frame = num_tracks / 100 / fps + 1;
+  PrototypeTrackLifecycle *lifecycle = NULL;
+  guint64 *ids = g_new (guint64, num_tracks);
+  guint64 next_id = 0, observations = 0;
+  guint counts[3] = { 0 };
+  PrototypeTrackBox box = { 100, 100, 20, 40 };
+  gdouble elapsed;
+  guint frame, i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    g_free (ids);
+    return;
+  }
+
+  lifecycle = prototype_track_lifecycle_new (&config);
+  for (i = 0; i < num_tracks; i++)
+    ids[i] = next_id++;
+
+  g_test_timer_start ();
+  for (frame = 0; frame < fps * seconds; frame++) {
+    GstClockTime ts = (GstClockTime) frame * GST_SECOND / fps;
+
+    for (i = 0; i < turnover_per_frame; i++)
+      ids[(frame * turnover_per_frame + i) % num_tracks] = next_id++;
+    for (i = 0; i < num_tracks; i++) {
+      box.left = (gfloat) (ids[i] % 1000) + frame;
+      prototype_track_lifecycle_observe (lifecycle, SOURCE_ID, ids[i], 2, 0,
+          0.5f, &box, ts);
+    }
+    observations += num_tracks;
+    prototype_track_lifecycle_advance (lifecycle, SOURCE_ID, ts, count_event,
+        counts);
+  }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed * 1e9 / observations,
+      "observe+advance: %.1f ns/observation (%u tracks, %u enter, %u dwell, "
+      "%u exit)", elapsed * 1e9 / observations, num_tracks,
+      counts[PROTOTYPE_TRACK_EVENT_ENTER], counts[PROTOTYPE_TRACK_EVENT_DWELL],
+      counts[PROTOTYPE_TRACK_EVENT_EXIT]);
+  g_assert_cmpuint (counts[PROTOTYPE_TRACK_EVENT_ENTER], >=, num_tracks);
+
+  prototype_track_lifecycle_free (lifecycle);
+  g_free (ids);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/track-lifecycle/enter-exit", test_enter_exit);
+  g_test_add_func ("/track-lifecycle/occlusion/short", test_short_occlusion);
+  g_test_add_func ("/track-lifecycle/occlusion/long", test_long_occlusion);
+  g_test_add_func ("/track-lifecycle/id-switch", test_id_switch);
+  g_test_add_func ("/track-lifecycle/flicker", test_flicker);
+  g_test_add_func ("/track-lifecycle/dwell", test_dwell);
+  g_test_add_func ("/track-lifecycle/eviction", test_eviction);
+  g_test_add_func ("/track-lifecycle/timestamp-reset", test_timestamp_reset);
+  g_test_add_func ("/track-lifecycle/remove-source", test_remove_source);
+  g_test_add_func ("/track-lifecycle/bench/observe", bench_observe);
+
+  return g_test_run ();
+}
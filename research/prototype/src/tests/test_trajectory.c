@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+
+#include "prototype_trajectory.h"
+
+#define WALK_POINTS 20000
+/* float 누적 오차 허용치 (픽셀) */
+#define EPSILON 1e-3f
+
+/*
+ * 걷는 사람의 발 위치처럼 속도가 천천히 바뀌고 검출 위치가 ±1 px 흔들리는
+ * 궤적을 만듭니다. t_ms는 점 번호(30 fps)로 단조 증가합니다.
+ */
+static PrototypeTrajectoryPoint *
+random_walk (GRand * rand, guint n)
+{
+  PrototypeTrajectoryPoint *points = g_new (PrototypeTrajectoryPoint, n);
+  gdouble x = 960, y = 540, vx = 2, vy = 0;
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    vx = CLAMP (vx + g_rand_double_range (rand, -0.3, 0.3), -6, 6);
+    vy = CLAMP (vy + g_rand_double_range (rand, -0.3, 0.3), -6, 6);
+    x += vx;
+    y += vy;
+    points[i].x = x + g_rand_double_range (rand, -1, 1);
+    points[i].y = y + g_rand_double_range (rand, -1, 1);
+    points[i].t_ms = i * 33;
+  }
+  return points;
+}
+
+/* 시각으로 점 p를 포함하는 선분을 찾아 거리를 잽니다. */
+static gfloat
+polyline_distance (const PrototypeTrajectoryPoint * out, guint num,
+    const PrototypeTrajectoryPoint * p)
+{
+  guint i;
+
+  if (num == 1)
+    return hypotf (p->x - out[0].x, p->y - out[0].y);
+  for (i = 0; i + 1 < num; i++) {
+    if (out[i].t_ms <= p->t_ms && p->t_ms <= out[i + 1].t_ms)
+      return prototype_trajectory_segment_distance (p, &out[i], &out[i + 1]);
+  }
+  g_assert_not_reached ();
+  return G_MAXFLOAT;
+}
+
+/*
+ * points를 chunk개씩 넣고 flush 하면서 (트랙 이벤트마다 flush 하는 것과 같음)
+ * 각 점이 그 flush 결과에서 보고된 오차 이내인지 확인합니다.
+ * @return 전체 flush 결과의 꼭짓점 수 (겹치는 끝점 제외)
+ */
+static guint
+check_bound (PrototypeTrajectoryBuffer * buffer,
+    const PrototypeTrajectoryPoint * points, guint n, guint chunk,
+    gfloat expected_bound)
+{
+  PrototypeTrajectoryPoint *out =
+      g_new (PrototypeTrajectoryPoint, buffer->max_points + 1);
+  PrototypeTrajectoryPoint last = { 0 };
+  guint start, i, total = 0;
+  gboolean first = TRUE;
+
+  for (start = 0; start < n; start += chunk) {
+    guint end = MIN (start + chunk, n);
+    gfloat error = -1;
+    guint num;
+
+    for (i = start; i < end; i++)
+      prototype_trajectory_add (buffer, points[i].x, points[i].y,
+          points[i].t_ms);
+    num = prototype_trajectory_flush (buffer, out, &error);
+
+    g_assert_cmpuint (num, >=, 1);
+    g_assert_cmpuint (num, <=, buffer->max_points + 1);
+    g_assert_cmpfloat (error, >=, 0);
+    if (expected_bound >= 0)
+      g_assert_cmpfloat (error, <=, expected_bound + EPSILON);
+    /* 연속한 flush는 직전 끝점에서 시작하고, 끝점은 마지막 입력점입니다. */
+    if (!first) {
+      g_assert_cmpfloat (out[0].x, ==, last.x);
+      g_assert_cmpuint (out[0].t_ms, ==, last.t_ms);
+    }
+    g_assert_cmpuint (out[num - 1].t_ms, ==, points[end - 1].t_ms);
+    for (i = start; i < end; i++)
+      g_assert_cmpfloat (polyline_distance (out, num, &points[i]), <=,
+          error + EPSILON);
+
+    total += first ? num : num - 1;
+    last = out[num - 1];
+    first = FALSE;
+  }
+
+  g_free (out);
+  return total;
+}
+
+static void
+test_bound_unmerged (void)
+{
+  static const gfloat tolerances[] = { 0.5f, 1, 2, 4, 8 };
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  PrototypeTrajectoryPoint *points = random_walk (rand, WALK_POINTS);
+  guint i;
+
+  /* 꼭짓점 수 제한에 닿지 않으면 모든 점은 tolerance 이내입니다. */
+  for (i = 0; i < G_N_ELEMENTS (tolerances); i++) {
+    PrototypeTrajectoryBuffer buffer;
+
+    prototype_trajectory_init (&buffer, tolerances[i], 4096);
+    check_bound (&buffer, points, WALK_POINTS, 300, tolerances[i]);
+    prototype_trajectory_clear (&buffer);
+  }
+
+  g_free (points);
+  g_rand_free (rand);
+}
+
+static void
+test_bound_merged (void)
+{
+  static const guint max_points[] = { 3, 8, 32 };
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  PrototypeTrajectoryPoint *points = random_walk (rand, WALK_POINTS);
+  guint i;
+
+  /* 꼭짓점을 합치면 오차는 커지지만 보고된 상한은 여전히 지켜집니다. */
+  for (i = 0; i < G_N_ELEMENTS (max_points); i++) {
+    PrototypeTrajectoryBuffer buffer;
+    guint total;
+
+    prototype_trajectory_init (&buffer, 1, max_points[i]);
+    total = check_bound (&buffer, points, WALK_POINTS, 1000, -1);
+    g_assert_cmpuint (total, <=, (WALK_POINTS / 1000) * max_points[i] + 1);
+    prototype_trajectory_clear (&buffer);
+  }
+
+  g_free (points);
+  g_rand_free (rand);
+}
+
+static void
+test_straight_line (void)
+{
+  PrototypeTrajectoryBuffer buffer;
+  PrototypeTrajectoryPoint out[65];
+  gfloat error = -1;
+  guint i, num;
+
+  /* 직선 위의 점은 창이 찰 때(WINDOW 점마다)만 꼭짓점이 생깁니다. */
+  prototype_trajectory_init (&buffer, 1, 64);
+  for (i = 0; i < 1000; i++)
+    prototype_trajectory_add (&buffer, i * 3.0f, 100 + i * 1.5f, i * 33);
+  num = prototype_trajectory_flush (&buffer, out, &error);
+
+  g_assert_cmpuint (num, <=, 1000 / PROTOTYPE_TRAJECTORY_WINDOW + 2);
+  g_assert_cmpfloat (error, <=, EPSILON);
+  g_assert_cmpfloat (out[0].x, ==, 0);
+  g_assert_cmpfloat (out[num - 1].x, ==, 999 * 3.0f);
+  prototype_trajectory_clear (&buffer);
+}
+
+static void
+test_corner (void)
+{
+  PrototypeTrajectoryBuffer buffer;
+  PrototypeTrajectoryPoint out[9];
+  gfloat error = -1;
+  guint i, num;
+
+  /* ㄱ자 궤적은 모서리 하나만 꼭짓점으로 남깁니다. */
+  prototype_trajectory_init (&buffer, 1, 8);
+  for (i = 0; i <= 20; i++)
+    prototype_trajectory_add (&buffer, i * 5.0f, 0, i);
+  for (i = 1; i <= 20; i++)
+    prototype_trajectory_add (&buffer, 100, i * 5.0f, 20 + i);
+  num = prototype_trajectory_flush (&buffer, out, &error);
+
+  g_assert_cmpuint (num, ==, 3);
+  g_assert_cmpfloat (out[1].x, ==, 100);
+  g_assert_cmpfloat (out[1].y, ==, 0);
+  g_assert_cmpuint (out[1].t_ms, ==, 20);
+  g_assert_cmpfloat (error, <=, EPSILON);
+  prototype_trajectory_clear (&buffer);
+}
+
+static void
+test_flush_edges (void)
+{
+  PrototypeTrajectoryBuffer buffer;
+  PrototypeTrajectoryPoint out[4];
+  gfloat error = -1;
+
+  prototype_trajectory_init (&buffer, 1, 3);
+
+  /* 빈 버퍼 */
+  g_assert_cmpuint (prototype_trajectory_flush (&buffer, out, &error), ==, 0);
+  g_assert_cmpfloat (error, ==, 0);
+
+  /* 점 하나, 그리고 새 점 없이 다시 flush 하면 끝점 하나만 남습니다. */
+  prototype_trajectory_add (&buffer, 10, 20, 5);
+  g_assert_cmpuint (prototype_trajectory_flush (&buffer, out, NULL), ==, 1);
+  g_assert_cmpuint (prototype_trajectory_flush (&buffer, out, &error), ==, 1);
+  g_assert_cmpfloat (out[0].x, ==, 10);
+  g_assert_cmpuint (out[0].t_ms, ==, 5);
+
+  /* reset 뒤에는 이전 끝점 없이 새로 시작합니다. */
+  prototype_trajectory_reset (&buffer);
+  prototype_trajectory_add (&buffer, 1, 2, 0);
+  prototype_trajectory_add (&buffer, 3, 4, 1);
+  g_assert_cmpuint (prototype_trajectory_flush (&buffer, out, NULL), ==, 2);
+  g_assert_cmpfloat (out[0].x, ==, 1);
+  g_assert_cmpfloat (out[1].x, ==, 3);
+
+  prototype_trajectory_clear (&buffer);
+}
+
+/* 허용 오차별 보존 비율 (꼭짓점 수 / 입력 점 수) */
+static void
+bench_retention (void)
+{
+  static const gfloat tolerances[] = { 0.5f, 1, 2, 4, 8 };
+  const guint n = 200000;
+  GRand *rand = NULL;
+  PrototypeTrajectoryPoint *points = NULL;
+  PrototypeTrajectoryPoint *out = NULL;
+  guint i, j;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (42);
+  points = random_walk (rand, n);
+  out = g_new (PrototypeTrajectoryPoint, 1025);
+  for (i = 0; i < G_N_ELEMENTS (tolerances); i++) {
+    PrototypeTrajectoryBuffer buffer;
+    guint64 kept = 0;
+    gdouble elapsed;
+
+    prototype_trajectory_init (&buffer, tolerances[i], 1024);
+    g_test_timer_start ();
+    /* 10 s(300점)마다 이벤트가 나가는 트랙 */
+    for (j = 0; j < n; j++) {
+      prototype_trajectory_add (&buffer, points[j].x, points[j].y,
+          points[j].t_ms);
+      if (j % 300 == 299 || j == n - 1)
+        kept += prototype_trajectory_flush (&buffer, out, NULL) - 1;
+    }
+    elapsed = g_test_timer_elapsed ();
+    prototype_trajectory_clear (&buffer);
+
+    g_test_minimized_result (100.0 * kept / n,
+        "tolerance %.1f px: retention %.1f%%, %.1f ns/point", tolerances[i],
+        100.0 * kept / n, elapsed * 1e9 / n);
+  }
+
+  g_free (out);
+  g_free (points);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/trajectory/error-bound/unmerged", test_bound_unmerged);
+  g_test_add_func ("/trajectory/error-bound/merged", test_bound_merged);
+  g_test_add_func ("/trajectory/straight-line", test_straight_line);
+  g_test_add_func ("/trajectory/corner", test_corner);
+  g_test_add_func ("/trajectory/flush-edges", test_flush_edges);
+  g_test_add_func ("/trajectory/bench/retention", bench_retention);
+
+  return g_test_run ();
+}
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+
+#include "prototype_zones.h"
+
+#define NUM_ZONES PROTOTYPE_ZONES_MAX_PER_SOURCE
+#define GRID_WIDTH 128
+#define GRID_HEIGHT 72
+/*
+ * 경계에서 이보다 가까운 질의는 float 판정과 double 참조가 갈릴 수 있으므로
+ * 해당 zone 비트는 비교하지 않습니다.
+ */
+#define AMBIGUOUS_DISTANCE 1e-5
+
+/* 참조 구현: double 짝홀(ray casting) 판정 */
+static gboolean
+reference_contains (const gfloat * polygon, guint n, gdouble x, gdouble y)
+{
+  gboolean inside = FALSE;
+  guint i, j;
+
+  for (i = 0, j = n - 1; i < n; j = i++) {
+    gdouble xi = polygon[2 * i], yi = polygon[2 * i + 1];
+    gdouble xj = polygon[2 * j], yj = polygon[2 * j + 1];
+
+    if ((yi > y) != (yj > y)) {
+      gdouble cross_x = xi + (y - yi) * (xj - xi) / (yj - yi);
+
+      if (x < cross_x)
+        inside = !inside;
+    }
+  }
+  return inside;
+}
+
+static gdouble
+point_segment_distance (gdouble px, gdouble py, gdouble ax, gdouble ay,
+    gdouble bx, gdouble by)
+{
+  gdouble dx = bx - ax, dy = by - ay;
+  gdouble len2 = dx * dx + dy * dy;
+  gdouble t = len2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0;
+
+  t = CLAMP (t, 0, 1);
+  return hypot (px - (ax + t * dx), py - (ay + t * dy));
+}
+
+static gdouble
+orient (gdouble ax, gdouble ay, gdouble bx, gdouble by, gdouble cx, gdouble cy)
+{
+  return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/* 두 선분 사이 거리. 교차하면 0 */
+static gdouble
+segment_segment_distance (const gdouble * s, const gdouble * t)
+{
+  gdouble o1 = orient (s[0], s[1], s[2], s[3], t[0], t[1]);
+  gdouble o2 = orient (s[0], s[1], s[2], s[3], t[2], t[3]);
+  gdouble o3 = orient (t[0], t[1], t[2], t[3], s[0], s[1]);
+  gdouble o4 = orient (t[0], t[1], t[2], t[3], s[2], s[3]);
+  gdouble d;
+
+  if (((o1 > 0) != (o2 > 0)) && ((o3 > 0) != (o4 > 0)) && o1 != 0 && o2 != 0
+      && o3 != 0 && o4 != 0)
+    return 0;
+  d = point_segment_distance (t[0], t[1], s[0], s[1], s[2], s[3]);
+  d = MIN (d, point_segment_distance (t[2], t[3], s[0], s[1], s[2], s[3]));
+  d = MIN (d, point_segment_distance (s[0], s[1], t[0], t[1], t[2], t[3]));
+  d = MIN (d, point_segment_distance (s[2], s[3], t[0], t[1], t[2], t[3]));
+  return d;
+}
+
+static gdouble
+polygon_point_distance (const gfloat * polygon, guint n, gdouble x, gdouble y)
+{
+  gdouble d = G_MAXDOUBLE;
+  guint i, j;
+
+  for (i = 0, j = n - 1; i < n; j = i++)
+    d = MIN (d, point_segment_distance (x, y, polygon[2 * j],
+            polygon[2 * j + 1], polygon[2 * i], polygon[2 * i + 1]));
+  return d;
+}
+
+/*
+ * 참조 구현: 폴리곤과 닫힌 사각형이 만나는지.
+ * 변끼리 닿거나, 사각형 모서리가 폴리곤 안이거나, 꼭짓점이 사각형 안이면 겹칩니다.
+ * *gap에는 폴리곤 경계와 사각형 경계 사이의 최소 거리를 씁니다.
+ */
+static gboolean
+reference_hits_box (const gfloat * polygon, guint n,
+    const PrototypeZoneBox * box, gdouble * gap)
+{
+  gdouble l = box->left, t = box->top;
+  gdouble r = l + box->width, b = t + box->height;
+  gdouble sides[4][4] = {
+    {l, t, r, t}, {r, t, r, b}, {r, b, l, b}, {l, b, l, t}
+  };
+  gboolean hit = FALSE;
+  guint i, j, k;
+
+  *gap = G_MAXDOUBLE;
+  for (i = 0, j = n - 1; i < n; j = i++) {
+    gdouble edge[4] = { polygon[2 * j], polygon[2 * j + 1], polygon[2 * i],
+      polygon[2 * i + 1]
+    };
+
+    for (k = 0; k < 4; k++)
+      *gap = MIN (*gap, segment_segment_distance (edge, sides[k]));
+    if (edge[2] >= l && edge[2] <= r && edge[3] >= t && edge[3] <= b)
+      hit = TRUE;
+  }
+  return hit || *gap == 0 || reference_contains (polygon, n, l, t);
+}
+
+/* 오목하거나 꼬인 폴리곤, 프레임 밖으로 나가는 폴리곤을 섞어 만듭니다. */
+static void
+random_zones (GRand * rand, PrototypeZoneConfig * zones, guint num_zones)
+{
+  guint z, i;
+
+  for (z = 0; z < num_zones; z++) {
+    gdouble cx = g_rand_double_range (rand, -0.05, 1.05);
+    gdouble cy = g_rand_double_range (rand, -0.05, 1.05);
+    gdouble radius = g_rand_double_range (rand, 0.02, 0.4);
+    guint n = g_rand_int_range (rand, 3, 13);
+    gboolean tangled = g_rand_int_range (rand, 0, 5) == 0;
+
+    zones[z].source_id = 0;
+    zones[z].name = g_strdup_printf ("zone-%u", z);
+    zones[z].num_points = n;
+    zones[z].points = g_new (gfloat, 2 * n);
+    for (i = 0; i < n; i++) {
+      /* 꼬인 폴리곤은 각도를 섞어 변이 서로 교차하게 합니다. */
+      gdouble angle = tangled ? g_rand_double_range (rand, 0, 2 * G_PI) :
+          2 * G_PI * (i + g_rand_double_range (rand, 0, 0.9)) / n;
+      gdouble r = radius * g_rand_double_range (rand, 0.3, 1.0);
+
+      zones[z].points[2 * i] = cx + r * cos (angle);
+      zones[z].points[2 * i + 1] = cy + r * sin (angle);
+    }
+  }
+}
+
+static void
+free_zones (PrototypeZoneConfig * zones, guint num_zones)
+{
+  guint z;
+
+  for (z = 0; z < num_zones; z++) {
+    g_free (zones[z].name);
+    g_free (zones[z].points);
+  }
+}
+
+static void
+test_points_match_reference (void)
+{
+  PrototypeZoneConfig zones[NUM_ZONES];
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  const guint num_points = 20000;
+  gfloat *points = g_new (gfloat, 2 * num_points);
+  guint64 *masks = g_new (guint64, num_points);
+  PrototypeZoneMap *map = NULL;
+  guint round, i, z, compared = 0;
+
+  for (round = 0; round < 3; round++) {
+    random_zones (rand, zones, NUM_ZONES);
+    map = prototype_zone_map_new (zones, NUM_ZONES, GRID_WIDTH, GRID_HEIGHT);
+    g_assert_nonnull (map);
+
+    /* 프레임 밖 점도 섞습니다. */
+    for (i = 0; i < 2 * num_points; i++)
+      points[i] = g_rand_double_range (rand, -0.02, 1.02);
+    prototype_zone_map_lookup_points (map, points, num_points, masks);
+
+    for (i = 0; i < num_points; i++) {
+      gdouble x = points[2 * i], y = points[2 * i + 1];
+
+      for (z = 0; z < NUM_ZONES; z++) {
+        gboolean expected;
+
+        if (polygon_point_distance (zones[z].points, zones[z].num_points, x,
+                y) < AMBIGUOUS_DISTANCE)
+          continue;
+        expected = reference_contains (zones[z].points, zones[z].num_points,
+            x, y);
+        if (expected != ((masks[i] >> z) & 1))
+          g_test_message ("point (%f, %f) zone %u", x, y, z);
+        g_assert_cmpint (expected, ==, (masks[i] >> z) & 1);
+        compared++;
+      }
+    }
+    prototype_zone_map_unref (map);
+    free_zones (zones, NUM_ZONES);
+  }
+  g_assert_cmpuint (compared, >, 3 * num_points * NUM_ZONES * 99 / 100);
+
+  g_free (masks);
+  g_free (points);
+  g_rand_free (rand);
+}
+
+static void
+test_boxes_match_reference (void)
+{
+  PrototypeZoneConfig zones[NUM_ZONES];
+  GRand *rand = g_rand_new_with_seed (g_test_rand_int ());
+  const guint num_boxes = 5000;
+  PrototypeZoneBox *boxes = g_new (PrototypeZoneBox, num_boxes);
+  guint64 *masks = g_new (guint64, num_boxes);
+  PrototypeZoneMap *map = NULL;
+  guint round, i, z;
+
+  for (round = 0; round < 3; round++) {
+    random_zones (rand, zones, NUM_ZONES);
+    map = prototype_zone_map_new (zones, NUM_ZONES, GRID_WIDTH, GRID_HEIGHT);
+
+    for (i = 0; i < num_boxes; i++) {
+      boxes[i].width = g_rand_double_range (rand, 0.001, 0.2);
+      boxes[i].height = g_rand_double_range (rand, 0.001, 0.3);
+      boxes[i].left = g_rand_double_range (rand, -0.05, 1.0);
+      boxes[i].top = g_rand_double_range (rand, -0.05, 1.0);
+    }
+    prototype_zone_map_lookup_boxes (map, boxes, num_boxes, masks);
+
+    for (i = 0; i < num_boxes; i++) {
+      for (z = 0; z < NUM_ZONES; z++) {
+        gdouble gap;
+        gboolean expected = reference_hits_box (zones[z].points,
+            zones[z].num_points, &boxes[i], &gap);
+
+        if (gap > 0 && gap < AMBIGUOUS_DISTANCE)
+          continue;
+        if (expected != ((masks[i] >> z) & 1))
+          g_test_message ("box (%f, %f, %f, %f) zone %u", boxes[i].left,
+              boxes[i].top, boxes[i].width, boxes[i].height, z);
+        g_assert_cmpint (expected, ==, (masks[i] >> z) & 1);
+      }
+    }
+    prototype_zone_map_unref (map);
+    free_zones (zones, NUM_ZONES);
+  }
+
+  g_free (masks);
+  g_free (boxes);
+  g_rand_free (rand);
+}
+
+static void
+test_grid_aligned (void)
+{
+  /* 꼭짓점이 셀 경계에 정확히 놓인 사각형: 셀 안쪽 가장자리 점들 */
+  gfloat rect[] = { 16.0f / GRID_WIDTH, 8.0f / GRID_HEIGHT,
+    48.0f / GRID_WIDTH, 8.0f / GRID_HEIGHT,
+    48.0f / GRID_WIDTH, 40.0f / GRID_HEIGHT,
+    16.0f / GRID_WIDTH, 40.0f / GRID_HEIGHT
+  };
+  PrototypeZoneConfig zone = { 0, (gchar *) "rect", rect, 4 };
+  PrototypeZoneMap *map = prototype_zone_map_new (&zone, 1, GRID_WIDTH,
+      GRID_HEIGHT);
+  gfloat delta = 1e-4f;
+  gfloat points[] = {
+    rect[0] + delta, rect[1] + delta,
+    rect[0] - delta, rect[1] + delta,
+    rect[4] - delta, rect[5] - delta,
+    rect[4] + delta, rect[5] - delta,
+    (rect[0] + rect[4]) / 2, (rect[1] + rect[5]) / 2,
+  };
+  guint64 masks[5];
+  PrototypeZoneBox touching = { rect[4] + delta, rect[5] - delta, 0.1f, 0.1f };
+  PrototypeZoneBox apart = { rect[4] + delta, rect[5] + delta, 0.1f, 0.1f };
+
+  g_assert_nonnull (map);
+  prototype_zone_map_lookup_points (map, points, 5, masks);
+  g_assert_cmpuint (masks[0], ==, 1);
+  g_assert_cmpuint (masks[1], ==, 0);
+  g_assert_cmpuint (masks[2], ==, 1);
+  g_assert_cmpuint (masks[3], ==, 0);
+  g_assert_cmpuint (masks[4], ==, 1);
+
+  prototype_zone_map_lookup_boxes (map, &touching, 1, masks);
+  g_assert_cmpuint (masks[0], ==, 0);
+  touching.left = rect[4] - delta;
+  prototype_zone_map_lookup_boxes (map, &touching, 1, masks);
+  g_assert_cmpuint (masks[0], ==, 1);
+  prototype_zone_map_lookup_boxes (map, &apart, 1, masks);
+  g_assert_cmpuint (masks[0], ==, 0);
+
+  prototype_zone_map_unref (map);
+}
+
+static void
+test_invalid (void)
+{
+  gfloat line[] = { 0, 0, 1, 1 };
+  PrototypeZoneConfig zone = { 0, (gchar *) "line", line, 2 };
+  PrototypeZoneConfig zones[NUM_ZONES + 1];
+
+  g_assert_null (prototype_zone_map_new (&zone, 1, GRID_WIDTH, GRID_HEIGHT));
+  g_assert_null (prototype_zone_map_new (zones, NUM_ZONES + 1, GRID_WIDTH,
+          GRID_HEIGHT));
+  zone.num_points = 3;
+  g_assert_null (prototype_zone_map_new (&zone, 1, 0, GRID_HEIGHT));
+}
+
+/* 카메라 하나에 zone 64개, 프레임당 객체 200개 */
+static void
+bench_lookup (void)
+{
+  PrototypeZoneConfig zones[NUM_ZONES];
+  const guint num_objects = 200, frames = 2000;
+  GRand *rand = NULL;
+  PrototypeZoneMap *map = NULL;
+  PrototypeZoneBox *boxes = NULL;
+  gfloat *points = NULL;
+  guint64 masks[200];
+  gdouble elapsed;
+  guint frame, i, z;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("run with -m perf");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (42);
+  random_zones (rand, zones, NUM_ZONES);
+  g_test_timer_start ();
+  map = prototype_zone_map_new (zones, NUM_ZONES, GRID_WIDTH, GRID_HEIGHT);
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e3, "build %ux%u grid: %.2f ms",
+      GRID_WIDTH, GRID_HEIGHT, elapsed * 1e3);
+
+  boxes = g_new (PrototypeZoneBox, num_objects * frames);
+  points = g_new (gfloat, 2 * num_objects * frames);
+  for (i = 0; i < num_objects * frames; i++) {
+    boxes[i].width = g_rand_double_range (rand, 0.01, 0.08);
+    boxes[i].height = g_rand_double_range (rand, 0.02, 0.2);
+    boxes[i].left = g_rand_double_range (rand, 0, 1 - boxes[i].width);
+    boxes[i].top = g_rand_double_range (rand, 0, 1 - boxes[i].height);
+    points[2 * i] = boxes[i].left + boxes[i].width / 2;
+    points[2 * i + 1] = boxes[i].top + boxes[i].height;
+  }
+
+  g_test_timer_start ();
+  for (frame = 0; frame < frames; frame++)
+    prototype_zone_map_lookup_points (map, &points[2 * frame * num_objects],
+        num_objects, masks);
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e6 / frames,
+      "points: %.2f us/frame (%u zones x %u objects)", elapsed * 1e6 / frames,
+      NUM_ZONES, num_objects);
+
+  /* 격자 없이 모든 zone에 ray casting 하는 경우 */
+  g_test_timer_start ();
+  for (frame = 0; frame < frames; frame++) {
+    for (i = 0; i < num_objects; i++) {
+      const gfloat *p = &points[2 * (frame * num_objects + i)];
+      guint64 mask = 0;
+
+      for (z = 0; z < NUM_ZONES; z++) {
+        if (prototype_zone_contains (zones[z].points, zones[z].num_points,
+                p[0], p[1]))
+          mask |= G_GUINT64_CONSTANT (1) << z;
+      }
+      masks[i] = mask;
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e6 / frames,
+      "points, brute force: %.2f us/frame", elapsed * 1e6 / frames);
+
+  g_test_timer_start ();
+  for (frame = 0; frame < frames; frame++)
+    prototype_zone_map_lookup_boxes (map, &boxes[frame * num_objects],
+        num_objects, masks);
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed * 1e6 / frames,
+      "boxes: %.2f us/frame (%u zones x %u objects)", elapsed * 1e6 / frames,
+      NUM_ZONES, num_objects);
+
+  prototype_zone_map_unref (map);
+  free_zones (zones, NUM_ZONES);
+  g_free (points);
+  g_free (boxes);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/zones/points-match-reference",
+      test_points_match_reference);
+  g_test_add_func ("/zones/boxes-match-reference", test_boxes_match_reference);
+  g_test_add_func ("/zones/grid-aligned", test_grid_aligned);
+  g_test_add_func ("/zones/invalid", test_invalid);
+  g_test_add_func ("/zones/bench/lookup", bench_lookup);
+
+  return g_test_run ();
+}